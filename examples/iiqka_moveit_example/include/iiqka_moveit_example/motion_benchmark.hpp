@@ -0,0 +1,186 @@
+// Copyright 2022 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef IIQKA_MOVEIT_EXAMPLE__MOTION_BENCHMARK_HPP_
+#define IIQKA_MOVEIT_EXAMPLE__MOTION_BENCHMARK_HPP_
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Planning and execution results of the examples, summarized per planner
+ *
+ * Every planning request adds a sample, the execution of a planned trajectory is added to the
+ *  sample of its plan. Can be used from several threads, e.g. executing and planning at once.
+ */
+class MotionBenchmark
+{
+public:
+  struct Sample
+  {
+    std::string planner;
+    double planning_time = 0;         // s
+    bool planned = false;
+    double trajectory_duration = 0;   // s
+    bool executed = false;
+    double execution_time = 0;        // s
+    bool execution_succeeded = false;
+  };
+
+  // The trajectory identifies the plan for AddExecution, nullptr if the planning failed
+  void AddPlan(
+    const void * trajectory, const std::string & planner, double planning_time,
+    double trajectory_duration)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Sample sample;
+    sample.planner = planner;
+    sample.planning_time = planning_time;
+    sample.planned = trajectory != nullptr;
+    sample.trajectory_duration = trajectory_duration;
+    if (trajectory != nullptr) {
+      plans_[trajectory] = samples_.size();
+    }
+    samples_.push_back(sample);
+  }
+
+  void AddExecution(const void * trajectory, double execution_time, bool succeeded)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto plan = plans_.find(trajectory);
+    if (plan == plans_.end()) {
+      return;
+    }
+    Sample & sample = samples_[plan->second];
+    sample.executed = true;
+    sample.execution_time = execution_time;
+    sample.execution_succeeded = succeeded;
+    plans_.erase(plan);
+  }
+
+  /**
+   * @brief Writes the summary per planner as JSON if the path ends with .json, otherwise as CSV
+   * @return false if the file could not be written
+   */
+  bool Write(const std::string & path) const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    FILE * file = std::fopen(path.c_str(), "w");
+    if (file == nullptr) {
+      return false;
+    }
+    const bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+    if (json) {
+      std::fprintf(file, "[\n");
+    } else {
+      std::fprintf(
+        file, "planner,requests,success_rate,planning_time_mean,planning_time_p50,"
+        "planning_time_max,trajectory_duration_mean,executions,execution_success_rate,"
+        "execution_time_mean\n");
+    }
+    std::map<std::string, std::vector<const Sample *>> planners;
+    for (const auto & sample : samples_) {
+      planners[sample.planner].push_back(&sample);
+    }
+    std::size_t index = 0;
+    for (const auto & planner : planners) {
+      const Summary summary = Summarize(planner.second);
+      if (json) {
+        std::fprintf(
+          file, "  {\"planner\": \"%s\", \"requests\": %zu, \"success_rate\": %.4f, "
+          "\"planning_time_mean\": %.6f, \"planning_time_p50\": %.6f, \"planning_time_max\": %.6f, "
+          "\"trajectory_duration_mean\": %.6f, \"executions\": %zu, "
+          "\"execution_success_rate\": %.4f, \"execution_time_mean\": %.6f}%s\n",
+          planner.first.c_str(), summary.requests, summary.success_rate,
+          summary.planning_time_mean, summary.planning_time_p50, summary.planning_time_max,
+          summary.trajectory_duration_mean, summary.executions, summary.execution_success_rate,
+          summary.execution_time_mean, ++index < planners.size() ? "," : "");
+      } else {
+        std::fprintf(
+          file, "%s,%zu,%.4f,%.6f,%.6f,%.6f,%.6f,%zu,%.4f,%.6f\n", planner.first.c_str(),
+          summary.requests, summary.success_rate, summary.planning_time_mean,
+          summary.planning_time_p50, summary.planning_time_max, summary.trajectory_duration_mean,
+          summary.executions, summary.execution_success_rate, summary.execution_time_mean);
+      }
+    }
+    if (json) {
+      std::fprintf(file, "]\n");
+    }
+    return std::fclose(file) == 0;
+  }
+
+private:
+  struct Summary
+  {
+    std::size_t requests = 0;
+    double success_rate = 0;
+    double planning_time_mean = 0;
+    double planning_time_p50 = 0;
+    double planning_time_max = 0;
+    double trajectory_duration_mean = 0;
+    std::size_t executions = 0;
+    double execution_success_rate = 0;
+    double execution_time_mean = 0;
+  };
+
+  // The trajectory duration is averaged over the successful plans, the execution time over the
+  //  successful executions
+  static Summary Summarize(const std::vector<const Sample *> & samples)
+  {
+    Summary summary;
+    summary.requests = samples.size();
+    std::vector<double> planning_times;
+    std::size_t planned = 0;
+    std::size_t executed_successfully = 0;
+    const double requests = static_cast<double>(samples.size());
+    for (const Sample * sample : samples) {
+      planning_times.push_back(sample->planning_time);
+      summary.planning_time_mean += sample->planning_time / requests;
+      if (sample->planned) {
+        planned++;
+        summary.trajectory_duration_mean += sample->trajectory_duration;
+      }
+      if (sample->executed) {
+        summary.executions++;
+        if (sample->execution_succeeded) {
+          executed_successfully++;
+          summary.execution_time_mean += sample->execution_time;
+        }
+      }
+    }
+    std::sort(planning_times.begin(), planning_times.end());
+    summary.planning_time_p50 = planning_times[planning_times.size() / 2];
+    summary.planning_time_max = planning_times.back();
+    summary.success_rate = static_cast<double>(planned) / requests;
+    summary.trajectory_duration_mean = planned > 0 ?
+      summary.trajectory_duration_mean / static_cast<double>(planned) : 0;
+    summary.execution_success_rate = summary.executions > 0 ?
+      static_cast<double>(executed_successfully) / static_cast<double>(summary.executions) : 0;
+    summary.execution_time_mean = executed_successfully > 0 ?
+      summary.execution_time_mean / static_cast<double>(executed_successfully) : 0;
+    return summary;
+  }
+
+  mutable std::mutex mutex_;
+  std::vector<Sample> samples_;
+  // Sample index of the plans not executed yet
+  std::unordered_map<const void *, std::size_t> plans_;
+};
+
+#endif  // IIQKA_MOVEIT_EXAMPLE__MOTION_BENCHMARK_HPP_
@@ -15,321 +15,289 @@
 #ifndef IIQKA_MOVEIT_EXAMPLE__MOVEIT_EXAMPLE_HPP_
 #define IIQKA_MOVEIT_EXAMPLE__MOVEIT_EXAMPLE_HPP_
 
-#include <math.h>
-
+#include <chrono>
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
+#include "iiqka_moveit_example/motion_benchmark.hpp"
 #include "rclcpp/rclcpp.hpp"
 #include "moveit/move_group_interface/move_group_interface.h"
 #include "moveit/planning_scene_interface/planning_scene_interface.h"
 #include "moveit_msgs/msg/collision_object.hpp"
+#include "moveit_msgs/srv/get_cartesian_path.hpp"
+#include "moveit_msgs/srv/get_motion_plan.hpp"
+#include "moveit_msgs/srv/get_position_ik.hpp"
+#include "moveit_msgs/srv/get_state_validity.hpp"
 #include "moveit_visual_tools/moveit_visual_tools.h"
 #include "geometry_msgs/msg/vector3.hpp"
 
-class MoveitExample : public rclcpp::Node
+
+/**
+ * Plans keyed by the quantized start joint positions, the goal pose and the planner
+ *
+ * The entries remember the revision of the planning scene they were planned in, a plan of
+ * an earlier revision must be checked for collisions before reusing it. The start positions
+ * are quantized finer than the start state tolerance of the trajectory execution.
+ */
+class TrajectoryCache
 {
 public:
-  MoveitExample()
-  : rclcpp::Node("moveit_example")
+  struct Key
   {
-  }
+    std::vector<int64_t> values;
+    std::string planner;
 
-  void initialize()
+    bool operator==(const Key & other) const
+    {
+      return values == other.values && planner == other.planner;
+    }
+  };
+
+  struct Entry
+  {
+    moveit_msgs::msg::RobotTrajectory trajectory;
+    uint64_t scene_revision;
+  };
+
+  /**
+   * @param joint_resolution: quantization of the start joint positions in radians
+   * @param position_resolution: quantization of the goal position in meters
+   * @param orientation_resolution: quantization of the goal quaternion
+   */
+  explicit TrajectoryCache(
+    double joint_resolution = 1e-3, double position_resolution = 1e-3,
+    double orientation_resolution = 1e-3)
+  : joint_resolution_(joint_resolution), position_resolution_(position_resolution),
+    orientation_resolution_(orientation_resolution)
   {
-    move_group_interface_ = std::make_shared<moveit::planning_interface::MoveGroupInterface>(
-      shared_from_this(),
-      PLANNING_GROUP);
+  }
 
-    moveit_visual_tools_ = std::make_shared<moveit_visual_tools::MoveItVisualTools>(
-      shared_from_this(), "base_link", rviz_visual_tools::RVIZ_MARKER_TOPIC,
-      move_group_interface_->getRobotModel());
+  Key MakeKey(
+    const std::vector<double> & start, const Eigen::Isometry3d & goal,
+    const std::string & planning_pipeline, const std::string & planner_id) const;
 
-    moveit_visual_tools_->deleteAllMarkers();
-    moveit_visual_tools_->loadRemoteControl();
-    moveit_visual_tools_->trigger();
+  // Key of a Cartesian path through the waypoints, interpolated with the given step in meters
+  Key MakeKey(
+    const std::vector<double> & start, const std::vector<geometry_msgs::msg::Pose> & waypoints,
+    double max_step, const std::string & planner) const;
 
-    planning_scene_diff_publisher_ = this->create_publisher<moveit_msgs::msg::PlanningScene>(
-      "planning_scene", 10);
+  // Returns nullptr if there is no plan for the key
+  Entry * Find(const Key & key);
 
-    move_group_interface_->setMaxVelocityScalingFactor(0.1);
-    move_group_interface_->setMaxAccelerationScalingFactor(0.1);
+  void Store(
+    const Key & key, const moveit_msgs::msg::RobotTrajectory & trajectory,
+    uint64_t scene_revision)
+  {
+    entries_[key] = Entry{trajectory, scene_revision};
   }
 
-  moveit_msgs::msg::RobotTrajectory::SharedPtr drawCircle()
+  void Erase(const Key & key) {entries_.erase(key);}
+
+  void Clear() {entries_.clear();}
+
+  std::size_t Size() const {return entries_.size();}
+  uint64_t Hits() const {return hits_;}
+  uint64_t Misses() const {return misses_;}
+
+private:
+  void AddJoints(Key & key, const std::vector<double> & positions) const;
+
+  void AddPose(Key & key, const Eigen::Vector3d & position, Eigen::Quaterniond orientation) const;
+
+  struct KeyHash
   {
-    std::vector<geometry_msgs::msg::Pose> waypoints;
-    moveit_msgs::msg::RobotTrajectory trajectory;
-    geometry_msgs::msg::Pose msg;
-
-    // circle facing forward
-    msg.orientation.x = 0.0;
-    msg.orientation.y = sqrt(2) / 2;
-    msg.orientation.z = 0.0;
-    msg.orientation.w = sqrt(2) / 2;
-    msg.position.x = 0.4;
-    // Define waypoints in a circle
-    for (int i = 0; i < 63; i++) {
-      msg.position.y = -0.2 + sin(0.1 * i) * 0.15;
-      msg.position.z = 0.4 + cos(0.1 * i) * 0.15;
-      waypoints.push_back(msg);
-    }
+    std::size_t operator()(const Key & key) const;
+  };
+
+  double joint_resolution_;
+  double position_resolution_;
+  double orientation_resolution_;
+  std::unordered_map<Key, Entry, KeyHash> entries_;
+  uint64_t hits_ = 0;
+  uint64_t misses_ = 0;
+};
 
-    RCLCPP_INFO(LOGGER, "Start planning");
-    double fraction =
-      move_group_interface_->computeCartesianPath(waypoints, 0.005, 0.0, trajectory);
-    RCLCPP_INFO(LOGGER, "Planning done!");
+// Planning pipeline and planner of a request in planToPointRace
+struct PlannerCandidate
+{
+  std::string planning_pipeline;
+  std::string planner_id;
+};
 
-    if (fraction < 1) {
-      RCLCPP_ERROR(LOGGER, "Could not compute trajectory through all waypoints!");
-      return nullptr;
-    } else {
-      return std::make_shared<moveit_msgs::msg::RobotTrajectory>(trajectory);
-    }
-  }
+class MoveitExample : public rclcpp::Node
+{
+public:
+  enum class RaceSelection
+  {
+    // The first successful plan
+    FIRST,
+    // The successful plan with the shortest duration until the deadline
+    SHORTEST
+  };
+
+  MoveitExample();
+
+  void initialize();
+
+  moveit_msgs::msg::RobotTrajectory::SharedPtr drawCircle();
+
+  /**
+   * @brief Same as computeCartesianPath of the MoveGroupInterface, but the waypoints are split
+   *  into segments planned concurrently and the paths are cached
+   *
+   * The start states of the segments are solved one after the other by IK at the last waypoint
+   *  of the previous segment, seeded with the start state of that segment, so the segments
+   *  continue the same IK solution. A segment not starting where the previous one ended (e.g. the
+   *  IK jumped to another configuration) is replanned from the end of the previous one. The
+   *  stitched path is timed as a whole, so the robot does not stop between the segments. A
+   *  cached path of an earlier planning scene revision is reused if none of its waypoints
+   *  collides in the current scene. How many segments plan in parallel depends on the threads of
+   *  the move_group executor. The node must be spinning in another thread.
+   * @param max_step: maximum distance between the interpolated points in meters
+   * @param start_state: diff to the current state to plan from, the current state if nullptr
+   * @return fraction of the path that could be planned, the trajectory ends there
+   */
+  double computeCartesianPathParallel(
+    const std::vector<geometry_msgs::msg::Pose> & waypoints, double max_step,
+    moveit_msgs::msg::RobotTrajectory & trajectory, std::size_t segment_count = 4,
+    const moveit_msgs::msg::RobotState * start_state = nullptr);
 
   moveit_msgs::msg::RobotTrajectory::SharedPtr planToPoint(
     const Eigen::Isometry3d & pose,
     const std::string & planning_pipeline = "pilz_industrial_motion_planner",
-    const std::string & planner_id = "PTP")
-  {
-    // Create planning request using pilz industrial motion planner
-    move_group_interface_->setPlanningPipelineId(planning_pipeline);
-    move_group_interface_->setPlannerId(planner_id);
-    move_group_interface_->setPoseTarget(pose);
-
-    moveit::planning_interface::MoveGroupInterface::Plan plan;
-    RCLCPP_INFO(LOGGER, "Sending planning request");
-    if (!move_group_interface_->plan(plan)) {
-      RCLCPP_INFO(LOGGER, "Planning failed");
-      return nullptr;
-    } else {
-      RCLCPP_INFO(LOGGER, "Planning successful");
-      return std::make_shared<moveit_msgs::msg::RobotTrajectory>(plan.trajectory_);
-    }
-  }
+    const std::string & planner_id = "PTP");
 
   moveit_msgs::msg::RobotTrajectory::SharedPtr planToPosition(
-    const std::vector<double> & joint_pos)
-  {
-    move_group_interface_->setJointValueTarget(joint_pos);
-
-    moveit::planning_interface::MoveGroupInterface::Plan plan;
-    RCLCPP_INFO(LOGGER, "Sending planning request");
-    if (!move_group_interface_->plan(plan)) {
-      RCLCPP_INFO(LOGGER, "Planning failed");
-      return nullptr;
-    } else {
-      RCLCPP_INFO(LOGGER, "Planning successful");
-      return std::make_shared<moveit_msgs::msg::RobotTrajectory>(plan.trajectory_);
-    }
-  }
+    const std::vector<double> & joint_pos);
 
   moveit_msgs::msg::RobotTrajectory::SharedPtr planToPointUntilSuccess(
     const Eigen::Isometry3d & pose,
     const std::string & planning_pipeline = "pilz_industrial_motion_planner",
-    const std::string & planner_id = "PTP")
+    const std::string & planner_id = "PTP");
+
+  /**
+   * @brief Plans with several planners concurrently and returns the first or the shortest plan
+   *
+   * A candidate can appear more than once, e.g. sampling based planners find a different plan
+   *  with every request. The requests are limited to the planning time until the deadline, the
+   *  ones still running when the result is selected are abandoned. How many plan in parallel
+   *  depends on the threads of the move_group executor. The node must be spinning in another
+   *  thread.
+   * @return nullptr if no candidate found a plan until the deadline
+   */
+  moveit_msgs::msg::RobotTrajectory::SharedPtr planToPointRace(
+    const Eigen::Isometry3d & pose, const std::vector<PlannerCandidate> & candidates,
+    std::chrono::milliseconds deadline, RaceSelection selection = RaceSelection::FIRST);
+
+  /**
+   * @brief Same as planToPointUntilSuccess, but plans from the same start state to the same goal
+   *  are planned only once
+   *
+   * A plan of an earlier planning scene revision is reused if none of its waypoints collides in
+   *  the current scene. The node must be spinning in another thread for the collision checks.
+   *  Plans from a start state diff are planned with a MoveGroupInterface of their own, so they
+   *  can be planned while execute() is running in another thread.
+   * @param start_state: diff to the current state to plan from (e.g. the end of a trajectory
+   *  still executing with the objects it attaches or detaches), the current state if nullptr
+   */
+  moveit_msgs::msg::RobotTrajectory::SharedPtr planToPointCached(
+    const Eigen::Isometry3d & pose,
+    const std::string & planning_pipeline = "pilz_industrial_motion_planner",
+    const std::string & planner_id = "PTP",
+    const moveit_msgs::msg::RobotState * start_state = nullptr);
+
+  /**
+   * @brief Checks every waypoint of the trajectory against the current planning scene of
+   *  move_group, with the attached objects of the start state diff if given
+   */
+  bool isTrajectoryValid(
+    const moveit_msgs::msg::RobotTrajectory & trajectory,
+    const moveit_msgs::msg::RobotState * start_state = nullptr);
+
+  /**
+   * @brief The state at the end of the trajectory as a diff to the current state, with the
+   *  object attached to or detached from the flange at the end if given
+   */
+  moveit_msgs::msg::RobotState endState(
+    const moveit_msgs::msg::RobotTrajectory & trajectory, const std::string & object_id = "",
+    bool attach = true) const;
+
+  TrajectoryCache & trajectoryCache()
   {
-    // Create planning request using given motion planner
-    move_group_interface_->setPlanningPipelineId(planning_pipeline);
-    move_group_interface_->setPlannerId(planner_id);
-    move_group_interface_->setPoseTarget(pose);
-
-    moveit::planning_interface::MoveGroupInterface::Plan plan;
-    RCLCPP_INFO(LOGGER, "Sending planning request");
-    moveit::core::MoveItErrorCode err_code;
-    auto start = std::chrono::high_resolution_clock::now();
-    do{
-      RCLCPP_INFO(LOGGER, "Planning ...");
-      err_code = move_group_interface_->plan(plan);
-    } while (err_code != moveit::core::MoveItErrorCode::SUCCESS);
-    auto stop = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start);
-    RCLCPP_INFO(LOGGER, "Planning successful after %li ms", duration.count());
-    return std::make_shared<moveit_msgs::msg::RobotTrajectory>(plan.trajectory_);
+    return trajectory_cache_;
   }
 
-  void AddObject(const moveit_msgs::msg::CollisionObject & object)
-  {
-    moveit_msgs::msg::PlanningScene planning_scene;
-    planning_scene.name = "scene";
-    planning_scene.world.collision_objects.push_back(object);
-    planning_scene.is_diff = true;
-    planning_scene_diff_publisher_->publish(planning_scene);
-  }
+  /**
+   * @brief Executes the trajectory, the execution time is added to the benchmark sample of the
+   *  planning request that returned it
+   * @return false if the execution failed
+   */
+  bool execute(const moveit_msgs::msg::RobotTrajectory::SharedPtr & trajectory);
 
-  void addRobotPlatform()
-  {
-    moveit_msgs::msg::CollisionObject collision_object;
-    collision_object.header.frame_id = move_group_interface_->getPlanningFrame();
-    collision_object.id = "robot_stand";
-    shape_msgs::msg::SolidPrimitive primitive;
-    primitive.type = primitive.BOX;
-    primitive.dimensions.resize(3);
-    primitive.dimensions[primitive.BOX_X] = 0.5;
-    primitive.dimensions[primitive.BOX_Y] = 0.5;
-    primitive.dimensions[primitive.BOX_Z] = 1.2;
-
-    // Define a pose for the box (specified relative to frame_id).
-    geometry_msgs::msg::Pose stand_pose1;
-    stand_pose1.orientation.w = 1.0;
-    stand_pose1.position.x = 0.0;
-    stand_pose1.position.y = 0.0;
-    stand_pose1.position.z = -0.6;
-
-    collision_object.primitives.push_back(primitive);
-    collision_object.primitive_poses.push_back(stand_pose1);
-    collision_object.operation = collision_object.ADD;
-
-    AddObject(collision_object);
-  }
+  // Sets the scaling factors of the planning and of the pipelined planning
+  void setScalingFactors(double velocity, double acceleration);
 
-  void addCollisionBox(
-    const geometry_msgs::msg::Vector3 & position,
-    const geometry_msgs::msg::Vector3 & size)
+  bool benchmarkMode() const
   {
-    moveit_msgs::msg::CollisionObject collision_object;
-    collision_object.header.frame_id = move_group_interface_->getPlanningFrame();
-    collision_object.id = "collision_box";
-    shape_msgs::msg::SolidPrimitive primitive;
-    primitive.type = primitive.BOX;
-    primitive.dimensions.resize(3);
-    primitive.dimensions[primitive.BOX_X] = size.x;
-    primitive.dimensions[primitive.BOX_Y] = size.y;
-    primitive.dimensions[primitive.BOX_Z] = size.z;
-
-    // Define a pose for the box (specified relative to frame_id).
-    geometry_msgs::msg::Pose stand_pose;
-    stand_pose.orientation.w = 1.0;
-    stand_pose.position.x = position.x;
-    stand_pose.position.y = position.y;
-    stand_pose.position.z = position.z;
-
-    collision_object.primitives.push_back(primitive);
-    collision_object.primitive_poses.push_back(stand_pose);
-    collision_object.operation = collision_object.ADD;
-
-    AddObject(collision_object);
+    return benchmark_iterations_ > 0;
   }
 
-  void addPalletObjects()
+  // Number of times the example runs its motions, 1 if not benchmarking
+  int iterations() const
   {
-    for (int k = 0; k < 3; k++) {
-      for (int j = 0; j < 3; j++) {
-        for (int i = 0; i < 3; i++) {
-          moveit_msgs::msg::CollisionObject pallet_object;
-          pallet_object.header.frame_id = move_group_interface_->getPlanningFrame();
-
-          pallet_object.id = "pallet_" + std::to_string(9 * k + 3 * j + i);
-          shape_msgs::msg::SolidPrimitive primitive;
-          primitive.type = primitive.BOX;
-          primitive.dimensions.resize(3);
-          primitive.dimensions[primitive.BOX_X] = 0.097;
-          primitive.dimensions[primitive.BOX_Y] = 0.097;
-          primitive.dimensions[primitive.BOX_Z] = 0.097;
-
-          // Define a pose for the box (specified relative to frame_id).
-          geometry_msgs::msg::Pose stand_pose;
-          stand_pose.orientation.w = 1.0;
-          stand_pose.position.x = 0.3 + i * 0.1;
-          stand_pose.position.y = -0.1 + j * 0.1;
-          stand_pose.position.z = 0.3 - 0.1 * k;
-
-          pallet_object.primitives.push_back(primitive);
-          pallet_object.primitive_poses.push_back(stand_pose);
-          pallet_object.operation = pallet_object.ADD;
-
-          AddObject(pallet_object);
-          std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        }
-      }
-    }
+    return benchmarkMode() ? benchmark_iterations_ : 1;
   }
 
-  void AttachObject(const std::string & object_id)
-  {
-    moveit_msgs::msg::PlanningScene planning_scene;
-    planning_scene.name = "scene";
-    moveit_msgs::msg::AttachedCollisionObject attached_object;
-
-    attached_object.link_name = "flange";
-    attached_object.object.id = object_id;
-
-    // Carry out the REMOVE + ATTACH operation
-    RCLCPP_INFO(LOGGER, "Attaching the object to the hand and removing it from the world.");
-    planning_scene.robot_state.attached_collision_objects.push_back(attached_object);
-    planning_scene.robot_state.is_diff = true;
-    planning_scene.is_diff = true;
-    planning_scene_diff_publisher_->publish(planning_scene);
-  }
+  // Writes the results per planner to benchmark_output in benchmark mode
+  void writeBenchmark() const;
 
-  void DetachAndRemoveObject(const std::string & object_id)
+  void AddObject(const moveit_msgs::msg::CollisionObject & object)
   {
-    moveit_msgs::msg::PlanningScene planning_scene;
-    planning_scene.name = "scene";
-    moveit_msgs::msg::AttachedCollisionObject attached_object;
-
-    attached_object.link_name = "flange";
-    attached_object.object.id = object_id;
-    attached_object.object.operation = attached_object.object.REMOVE;
-
-    // Carry out the DETACH operation
-    RCLCPP_INFO(LOGGER, "Detaching the object from the hand");
-    planning_scene.robot_state.attached_collision_objects.push_back(attached_object);
-    planning_scene.robot_state.is_diff = true;
-    planning_scene.world.collision_objects.push_back(attached_object.object);
-    planning_scene.is_diff = true;
-    planning_scene_diff_publisher_->publish(planning_scene);
+    AddObjects({object});
   }
 
-  void setOrientationConstraint(const geometry_msgs::msg::Quaternion & orientation)
+  // Adds the objects in one planning scene diff, so move_group updates the scene only once
+  void AddObjects(const std::vector<moveit_msgs::msg::CollisionObject> & objects);
+
+  // The objects added until commitSceneBatch() are collected and published in one diff
+  void startSceneBatch()
   {
-    moveit_msgs::msg::OrientationConstraint orientation_constraint;
-    moveit_msgs::msg::Constraints constraints;
-    orientation_constraint.header.frame_id = move_group_interface_->getPlanningFrame();
-    orientation_constraint.link_name = move_group_interface_->getEndEffectorLink();
-    orientation_constraint.orientation = orientation;
-    orientation_constraint.absolute_x_axis_tolerance = 0.2;
-    orientation_constraint.absolute_y_axis_tolerance = 0.2;
-    orientation_constraint.absolute_z_axis_tolerance = 0.2;
-    orientation_constraint.weight = 1.0;
-
-    constraints.orientation_constraints.emplace_back(orientation_constraint);
-    move_group_interface_->setPathConstraints(constraints);
+    scene_batching_ = true;
   }
 
+  void commitSceneBatch();
+
+  void addRobotPlatform();
+
+  void addCollisionBox(
+    const geometry_msgs::msg::Vector3 & position,
+    const geometry_msgs::msg::Vector3 & size);
+
+  void addPalletObjects();
+
+  void RemoveObject(const std::string & object_id);
+
+  void AttachObject(const std::string & object_id);
+
+  void DetachAndRemoveObject(const std::string & object_id);
+
+  void setOrientationConstraint(const geometry_msgs::msg::Quaternion & orientation);
+
   void clearConstraints()
   {
     move_group_interface_->clearPathConstraints();
   }
 
-  void drawTrajectory(const moveit_msgs::msg::RobotTrajectory & trajectory)
-  {
-    moveit_visual_tools_->deleteAllMarkers();
-    moveit_visual_tools_->publishTrajectoryLine(
-      trajectory,
-      moveit_visual_tools_->getRobotModel()->getJointModelGroup(PLANNING_GROUP));
-  }
+  void drawTrajectory(const moveit_msgs::msg::RobotTrajectory & trajectory);
 
-  void drawTitle(const std::string & text)
-  {
-    auto const text_pose = []
-      {
-        auto msg = Eigen::Isometry3d::Identity();
-        msg.translation().z() = 1.0;
-        return msg;
-      } ();
-    moveit_visual_tools_->publishText(
-      text_pose, text, rviz_visual_tools::RED,
-      rviz_visual_tools::XXLARGE);
-  }
+  void drawTitle(const std::string & text);
 
-  void addBreakPoint()
-  {
-    moveit_visual_tools_->trigger();
-    moveit_visual_tools_->prompt("Press 'Next' in the RvizVisualToolsGui window to execute");
-  }
+  void addBreakPoint();
 
   std::shared_ptr<moveit::planning_interface::MoveGroupInterface> moveGroupInterface()
   {
@@ -337,9 +305,49 @@ public:
   }
 
 protected:
+  // Plans with the interface until a plan is found, the target must be set
+  moveit_msgs::msg::RobotTrajectory::SharedPtr planUntilSuccess(
+    moveit::planning_interface::MoveGroupInterface & interface, const std::string & planner);
+
+  // Solves the IK of the flange at the pose, seeded with and in the same format as the seed
+  bool solveIk(
+    const geometry_msgs::msg::Pose & pose, const moveit_msgs::msg::RobotState & seed,
+    moveit_msgs::msg::RobotState & solution);
+
+  // The response of a segment of computeCartesianPathParallel, nullptr if it failed
+  moveit_msgs::srv::GetCartesianPath::Response::SharedPtr waitForSegment(
+    rclcpp::Client<moveit_msgs::srv::GetCartesianPath>::FutureAndRequestId & request);
+
+  // Whether the path of a segment starts at the point, within the start state tolerance
+  bool continues(
+    const trajectory_msgs::msg::JointTrajectoryPoint & point,
+    const moveit_msgs::msg::RobotTrajectory & segment) const;
+
+  // Adds the planning request started at start to the benchmark, nullptr if it failed
+  moveit_msgs::msg::RobotTrajectory::SharedPtr recordPlan(
+    const std::string & planner, std::chrono::steady_clock::time_point start,
+    moveit_msgs::msg::RobotTrajectory::SharedPtr trajectory);
+
   std::shared_ptr<moveit::planning_interface::MoveGroupInterface> move_group_interface_;
+  // Plans from the start state diffs of planToPointCached, as a MoveGroupInterface must not plan
+  //  while it executes in another thread
+  std::shared_ptr<moveit::planning_interface::MoveGroupInterface> pipeline_interface_;
   rclcpp::Publisher<moveit_msgs::msg::PlanningScene>::SharedPtr planning_scene_diff_publisher_;
   std::shared_ptr<moveit_visual_tools::MoveItVisualTools> moveit_visual_tools_;
+  rclcpp::Client<moveit_msgs::srv::GetMotionPlan>::SharedPtr plan_client_;
+  rclcpp::Client<moveit_msgs::srv::GetStateValidity>::SharedPtr state_validity_client_;
+  rclcpp::Client<moveit_msgs::srv::GetCartesianPath>::SharedPtr cartesian_path_client_;
+  rclcpp::Client<moveit_msgs::srv::GetPositionIK>::SharedPtr ik_client_;
+  TrajectoryCache trajectory_cache_;
+  // Incremented with every change of the planning scene published by the example
+  uint64_t scene_revision_ = 0;
+  bool scene_batching_ = false;
+  std::vector<moveit_msgs::msg::CollisionObject> scene_batch_;
+  int benchmark_iterations_ = 0;
+  std::string benchmark_output_;
+  double cartesian_step_ = 0.005;
+  int cartesian_segments_ = 4;
+  MotionBenchmark benchmark_;
   const rclcpp::Logger LOGGER = rclcpp::get_logger("moveit_basic_plan");
   const std::string PLANNING_GROUP = "manipulator";
 };
@@ -38,64 +38,70 @@ int main(int argc, char * argv[])
   // Add robot platform
   example_node->addRobotPlatform();
 
-  // Pilz PTP planner
-  auto standing_pose = Eigen::Isometry3d(
-    Eigen::Translation3d(
-      0.1, 0,
-      0.8) *
-    Eigen::Quaterniond::Identity());
+  for (int iteration = 0; iteration < example_node->iterations(); iteration++) {
+    // Pilz PTP planner
+    auto standing_pose = Eigen::Isometry3d(
+      Eigen::Translation3d(
+        0.1, 0,
+        0.8) *
+      Eigen::Quaterniond::Identity());
 
-  auto planned_trajectory = example_node->planToPoint(
-    standing_pose,
-    "pilz_industrial_motion_planner", "PTP");
-  if (planned_trajectory != nullptr) {
-    example_node->drawTrajectory(*planned_trajectory);
+    auto planned_trajectory = example_node->planToPoint(
+      standing_pose,
+      "pilz_industrial_motion_planner", "PTP");
+    if (planned_trajectory != nullptr) {
+      example_node->drawTrajectory(*planned_trajectory);
+      example_node->addBreakPoint();
+      example_node->execute(planned_trajectory);
+    }
     example_node->addBreakPoint();
-    example_node->moveGroupInterface()->execute(*planned_trajectory);
-  }
-  example_node->addBreakPoint();
 
-  // Pilz LIN planner
-  auto cart_goal = Eigen::Isometry3d(
-    Eigen::Translation3d(
-      0.4, -0.15,
-      0.55) *
-    Eigen::Quaterniond::Identity());
-  planned_trajectory =
-    example_node->planToPoint(cart_goal, "pilz_industrial_motion_planner", "LIN");
-  if (planned_trajectory != nullptr) {
-    example_node->drawTrajectory(*planned_trajectory);
+    // Pilz LIN planner
+    auto cart_goal = Eigen::Isometry3d(
+      Eigen::Translation3d(
+        0.4, -0.15,
+        0.55) *
+      Eigen::Quaterniond::Identity());
+    planned_trajectory =
+      example_node->planToPoint(cart_goal, "pilz_industrial_motion_planner", "LIN");
+    if (planned_trajectory != nullptr) {
+      example_node->drawTrajectory(*planned_trajectory);
+      example_node->addBreakPoint();
+      example_node->execute(planned_trajectory);
+    }
+
+    // Add collision object
+    example_node->addCollisionBox(
+      geometry_msgs::build<geometry_msgs::msg::Vector3>().x(0.25).y(-0.075).z(0.675),
+      geometry_msgs::build<geometry_msgs::msg::Vector3>().x(0.1).y(0.4).z(0.1));
     example_node->addBreakPoint();
-    example_node->moveGroupInterface()->execute(*planned_trajectory);
-  }
 
-  // Add collision object
-  example_node->addCollisionBox(
-    geometry_msgs::build<geometry_msgs::msg::Vector3>().x(0.25).y(-0.075).z(0.675),
-    geometry_msgs::build<geometry_msgs::msg::Vector3>().x(0.1).y(0.4).z(0.1));
-  example_node->addBreakPoint();
+    // Try moving back with Pilz LIN
+    planned_trajectory = example_node->planToPoint(
+      standing_pose, "pilz_industrial_motion_planner",
+      "LIN");
+    if (planned_trajectory != nullptr) {
+      example_node->drawTrajectory(*planned_trajectory);
+    } else {
+      example_node->drawTitle("Failed planning with Pilz LIN");
+    }
+    example_node->addBreakPoint();
 
-  // Try moving back with Pilz LIN
-  planned_trajectory = example_node->planToPoint(
-    standing_pose, "pilz_industrial_motion_planner",
-    "LIN");
-  if (planned_trajectory != nullptr) {
-    example_node->drawTrajectory(*planned_trajectory);
-  } else {
-    example_node->drawTitle("Failed planning with Pilz LIN");
-  }
-  example_node->addBreakPoint();
+    // Try moving back with Pilz PTP
+    planned_trajectory = example_node->planToPoint(
+      standing_pose, "pilz_industrial_motion_planner",
+      "PTP");
+    if (planned_trajectory != nullptr) {
+      example_node->drawTrajectory(*planned_trajectory);
+    } else {
+      example_node->drawTitle("Failed planning with Pilz PTP");
+    }
+    example_node->addBreakPoint();
 
-  // Try moving back with Pilz PTP
-  planned_trajectory = example_node->planToPoint(
-    standing_pose, "pilz_industrial_motion_planner",
-    "PTP");
-  if (planned_trajectory != nullptr) {
-    example_node->drawTrajectory(*planned_trajectory);
-  } else {
-    example_node->drawTitle("Failed planning with Pilz PTP");
+    // Start the next iteration without the collision object
+    example_node->RemoveObject("collision_box");
   }
-  example_node->addBreakPoint();
+  example_node->writeBenchmark();
 
   // Shutdown ROS
   rclcpp::shutdown();
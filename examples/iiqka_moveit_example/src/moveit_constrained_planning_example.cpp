@@ -35,42 +35,47 @@ int main(int argc, char * argv[])
   // Add robot platform
   example_node->addRobotPlatform();
 
-  // Go to correct position for the example
-  auto init_trajectory = example_node->planToPosition(
-    std::vector<double>{0.0017, -2.096, 1.514, 0.0012, -0.9888, -0.0029});
-  if (init_trajectory != nullptr) {
-    example_node->moveGroupInterface()->execute(*init_trajectory);
-  }
+  for (int iteration = 0; iteration < example_node->iterations(); iteration++) {
+    // Go to correct position for the example
+    auto init_trajectory = example_node->planToPosition(
+      std::vector<double>{0.0017, -2.096, 1.514, 0.0012, -0.9888, -0.0029});
+    if (init_trajectory != nullptr) {
+      example_node->execute(init_trajectory);
+    }
 
-  // Add collision object
-  example_node->addCollisionBox(
-    geometry_msgs::build<geometry_msgs::msg::Vector3>().x(0.125).y(0.15).z(0.5),
-    geometry_msgs::build<geometry_msgs::msg::Vector3>().x(0.1).y(1.0).z(0.1));
-  example_node->addBreakPoint();
+    // Add collision object
+    example_node->addCollisionBox(
+      geometry_msgs::build<geometry_msgs::msg::Vector3>().x(0.125).y(0.15).z(0.5),
+      geometry_msgs::build<geometry_msgs::msg::Vector3>().x(0.1).y(1.0).z(0.1));
+    example_node->addBreakPoint();
 
-  auto cart_goal = Eigen::Isometry3d(
-    Eigen::Translation3d(
-      0.4, -0.15,
-      0.55) *
-    Eigen::Quaterniond::Identity());
+    auto cart_goal = Eigen::Isometry3d(
+      Eigen::Translation3d(
+        0.4, -0.15,
+        0.55) *
+      Eigen::Quaterniond::Identity());
 
-  geometry_msgs::msg::Quaternion q;
-  q.x = 0;
-  q.y = 0;
-  q.z = 0;
-  q.w = 1;
+    geometry_msgs::msg::Quaternion q;
+    q.x = 0;
+    q.y = 0;
+    q.z = 0;
+    q.w = 1;
 
-  example_node->moveGroupInterface()->setPlanningTime(30.0);
+    example_node->moveGroupInterface()->setPlanningTime(30.0);
 
-  example_node->setOrientationConstraint(q);
-  // Plan with collision avoidance
-  auto planned_trajectory =
-    example_node->planToPointUntilSuccess(cart_goal, "ompl", "RRTkConfigDefault");
-  if (planned_trajectory != nullptr) {
-    example_node->drawTrajectory(*planned_trajectory);
-    example_node->addBreakPoint();
-    example_node->moveGroupInterface()->execute(*planned_trajectory);
+    example_node->setOrientationConstraint(q);
+    // Plan with collision avoidance
+    auto planned_trajectory =
+      example_node->planToPointUntilSuccess(cart_goal, "ompl", "RRTkConfigDefault");
+    if (planned_trajectory != nullptr) {
+      example_node->drawTrajectory(*planned_trajectory);
+      example_node->addBreakPoint();
+      example_node->execute(planned_trajectory);
+    }
+    // The initial motion of the next iteration is not constrained
+    example_node->clearConstraints();
   }
+  example_node->writeBenchmark();
 
   // Shutdown ROS
   rclcpp::shutdown();
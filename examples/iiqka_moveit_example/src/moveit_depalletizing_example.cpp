@@ -14,55 +14,90 @@
 
 #include <math.h>
 
+#include <future>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "iiqka_moveit_example/moveit_example.hpp"
 
 class Depalletizer : public MoveitExample
 {
 public:
-  void Depalletize()
+  /**
+   * Picks up the boxes and drops them off one after the other
+   *
+   * The segments are pipelined: while a segment is executing, the next one is planned from its
+   *  end state, with the box attached after a pickup and released after a drop off. The scene is
+   *  only updated when the execution of the segment has finished, so the planner sees the box
+   *  where it will be, not where it is.
+   * @return false if a segment could not be planned or executed
+   */
+  bool Depalletize()
   {
+    struct Segment
+    {
+      Eigen::Isometry3d pose;
+      std::string object_name;
+      // Attach the object at the end (pickup) or detach it (drop off)
+      bool attach;
+    };
+
+    // Drop off to -0.3, 0.0, 0.35 pointing down
+    const Eigen::Isometry3d dropoff_pose = Eigen::Isometry3d(
+      Eigen::Translation3d(-0.3, 0.0, 0.35) * Eigen::Quaterniond(0, 1, 0, 0));
+    std::vector<Segment> segments;
     for (int k = 0; k < 3; k++) {
       for (int j = 0; j < 3; j++) {
         for (int i = 0; i < 3; i++) {
           std::string object_name = "pallet_" + std::to_string(9 * k + 3 * j + i);
-          RCLCPP_INFO(LOGGER, "Going for object %s", object_name.c_str());
-
-          // Go to pickup
           Eigen::Isometry3d pose = Eigen::Isometry3d(
             Eigen::Translation3d(
               0.3 + i * 0.1, j * 0.1 - 0.1,
               0.35 - 0.1 * k) *
             Eigen::Quaterniond(0, 1, 0, 0));
-          auto planned_trajectory =
-            planToPointUntilSuccess(pose, "ompl", "RRTConnectkConfigDefault");
-          if (planned_trajectory != nullptr) {
-            move_group_interface_->execute(*planned_trajectory);
-          } else {
-            RCLCPP_ERROR(LOGGER, "Planning failed");
-          }
+          segments.push_back(Segment{pose, object_name, true});
+          segments.push_back(Segment{dropoff_pose, object_name, false});
+        }
+      }
+    }
 
-          // Attach object
-          AttachObject(object_name);
+    auto trajectory = planToPointCached(segments[0].pose, "ompl", "RRTConnectkConfigDefault");
+    for (std::size_t n = 0; n < segments.size(); n++) {
+      const Segment & segment = segments[n];
+      if (trajectory == nullptr) {
+        RCLCPP_ERROR(LOGGER, "Planning failed");
+        return false;
+      }
+      RCLCPP_INFO(
+        LOGGER, "%s object %s", segment.attach ? "Going for" : "Dropping off",
+        segment.object_name.c_str());
+      auto execution = std::async(
+        std::launch::async, [this, trajectory]() {
+          return execute(trajectory);
+        });
 
-          // Drop off to -0.3, 0.0, 0.35 pointing down
-          Eigen::Isometry3d dropoff_pose = Eigen::Isometry3d(
-            Eigen::Translation3d(-0.3, 0.0, 0.35) * Eigen::Quaterniond(0, 1, 0, 0));
-          auto drop_trajectory = planToPointUntilSuccess(
-            dropoff_pose, "ompl",
-            "RRTConnectkConfigDefault");
-          if (drop_trajectory != nullptr) {
-            move_group_interface_->execute(*drop_trajectory);
-          } else {
-            RCLCPP_ERROR(LOGGER, "Planning failed");
-          }
+      // Plan the next segment from the predicted end of this one, planToPointCached() plans
+      //  from a start state with another MoveGroupInterface than the executing one
+      moveit_msgs::msg::RobotTrajectory::SharedPtr next_trajectory;
+      if (n + 1 < segments.size()) {
+        const auto start_state = endState(*trajectory, segment.object_name, segment.attach);
+        next_trajectory = planToPointCached(
+          segments[n + 1].pose, "ompl", "RRTConnectkConfigDefault", &start_state);
+      }
 
-          // Detach
-          DetachAndRemoveObject(object_name);
-        }
+      if (!execution.get()) {
+        RCLCPP_ERROR(LOGGER, "Execution failed, the next segment does not start at its end");
+        return false;
+      }
+      if (segment.attach) {
+        AttachObject(segment.object_name);
+      } else {
+        DetachAndRemoveObject(segment.object_name);
       }
+      trajectory = next_trajectory;
     }
+    return true;
   }
 };
 
@@ -81,17 +116,24 @@ int main(int argc, char * argv[])
 
   node->initialize();
 
-  node->moveGroupInterface()->setMaxVelocityScalingFactor(1.0);
-  node->moveGroupInterface()->setMaxAccelerationScalingFactor(1.0);
-  // Add robot platform
+  node->setScalingFactors(1.0, 1.0);
+  // Add robot platform and pallets in one scene update
+  node->startSceneBatch();
   node->addRobotPlatform();
-  node->addBreakPoint();
-
-  // Add pallets
   node->addPalletObjects();
+  node->commitSceneBatch();
   node->addBreakPoint();
 
-  node->Depalletize();
+  for (int iteration = 0; iteration < node->iterations(); iteration++) {
+    // All boxes were dropped off and removed by the previous iteration
+    if (iteration > 0) {
+      node->addPalletObjects();
+    }
+    if (!node->Depalletize()) {
+      break;
+    }
+  }
+  node->writeBenchmark();
 
   // Shutdown ROS
   rclcpp::shutdown();
@@ -0,0 +1,902 @@
+// Copyright 2022 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "iiqka_moveit_example/moveit_example.hpp"
+
+#include <math.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "moveit/robot_trajectory/robot_trajectory.h"
+#include "moveit/trajectory_processing/iterative_time_parameterization.h"
+
+TrajectoryCache::Key TrajectoryCache::MakeKey(
+  const std::vector<double> & start, const Eigen::Isometry3d & goal,
+  const std::string & planning_pipeline, const std::string & planner_id) const
+{
+  Key key;
+  key.planner = planning_pipeline + "/" + planner_id;
+  key.values.reserve(start.size() + 7);
+  AddJoints(key, start);
+  AddPose(key, goal.translation(), Eigen::Quaterniond(goal.rotation()));
+  return key;
+}
+
+TrajectoryCache::Key TrajectoryCache::MakeKey(
+  const std::vector<double> & start, const std::vector<geometry_msgs::msg::Pose> & waypoints,
+  double max_step, const std::string & planner) const
+{
+  Key key;
+  key.planner = planner + "/" + std::to_string(max_step);
+  key.values.reserve(start.size() + 7 * waypoints.size());
+  AddJoints(key, start);
+  for (const auto & pose : waypoints) {
+    AddPose(
+      key, Eigen::Vector3d(pose.position.x, pose.position.y, pose.position.z),
+      Eigen::Quaterniond(
+        pose.orientation.w, pose.orientation.x, pose.orientation.y, pose.orientation.z));
+  }
+  return key;
+}
+
+TrajectoryCache::Entry * TrajectoryCache::Find(const Key & key)
+{
+  auto entry = entries_.find(key);
+  if (entry == entries_.end()) {
+    misses_++;
+    return nullptr;
+  }
+  hits_++;
+  return &entry->second;
+}
+
+void TrajectoryCache::AddJoints(Key & key, const std::vector<double> & positions) const
+{
+  for (double position : positions) {
+    key.values.push_back(std::llround(position / joint_resolution_));
+  }
+}
+
+void TrajectoryCache::AddPose(
+  Key & key, const Eigen::Vector3d & position, Eigen::Quaterniond orientation) const
+{
+  for (int i = 0; i < 3; i++) {
+    key.values.push_back(std::llround(position[i] / position_resolution_));
+  }
+  // q and -q are the same orientation
+  if (orientation.w() < 0) {
+    orientation.coeffs() *= -1;
+  }
+  for (int i = 0; i < 4; i++) {
+    key.values.push_back(std::llround(orientation.coeffs()[i] / orientation_resolution_));
+  }
+}
+
+std::size_t TrajectoryCache::KeyHash::operator()(const Key & key) const
+{
+  std::size_t hash = std::hash<std::string>()(key.planner);
+  for (int64_t value : key.values) {
+    hash ^= std::hash<int64_t>()(value) + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+  }
+  return hash;
+}
+
+MoveitExample::MoveitExample()
+: rclcpp::Node("moveit_example")
+{
+  // In benchmark mode the motions of the example are repeated without the breakpoints
+  benchmark_iterations_ = this->declare_parameter<int>("benchmark_iterations", 0);
+  benchmark_output_ = this->declare_parameter<std::string>(
+    "benchmark_output", "moveit_benchmark.csv");
+  // Interpolation step of the Cartesian paths in meters and the segments planned in parallel
+  cartesian_step_ = this->declare_parameter<double>("cartesian_step", 0.005);
+  cartesian_segments_ = this->declare_parameter<int>("cartesian_segments", 4);
+}
+
+void MoveitExample::initialize()
+{
+  move_group_interface_ = std::make_shared<moveit::planning_interface::MoveGroupInterface>(
+    shared_from_this(),
+    PLANNING_GROUP);
+  pipeline_interface_ = std::make_shared<moveit::planning_interface::MoveGroupInterface>(
+    shared_from_this(),
+    PLANNING_GROUP);
+
+  moveit_visual_tools_ = std::make_shared<moveit_visual_tools::MoveItVisualTools>(
+    shared_from_this(), "base_link", rviz_visual_tools::RVIZ_MARKER_TOPIC,
+    move_group_interface_->getRobotModel());
+
+  moveit_visual_tools_->deleteAllMarkers();
+  moveit_visual_tools_->loadRemoteControl();
+  moveit_visual_tools_->trigger();
+
+  planning_scene_diff_publisher_ = this->create_publisher<moveit_msgs::msg::PlanningScene>(
+    "planning_scene", 10);
+
+  // Planning requests of planToPointRace are sent to move_group directly, as the planning
+  //  of a MoveGroupInterface cannot run concurrently
+  plan_client_ = this->create_client<moveit_msgs::srv::GetMotionPlan>("plan_kinematic_path");
+  // Provided by move_group, used for checking the cached plans against the current scene
+  state_validity_client_ = this->create_client<moveit_msgs::srv::GetStateValidity>(
+    "check_state_validity");
+  // The segments of computeCartesianPathParallel are requested from move_group directly
+  cartesian_path_client_ = this->create_client<moveit_msgs::srv::GetCartesianPath>(
+    "compute_cartesian_path");
+  ik_client_ = this->create_client<moveit_msgs::srv::GetPositionIK>("compute_ik");
+
+  setScalingFactors(0.1, 0.1);
+}
+
+moveit_msgs::msg::RobotTrajectory::SharedPtr MoveitExample::drawCircle()
+{
+  std::vector<geometry_msgs::msg::Pose> waypoints;
+  moveit_msgs::msg::RobotTrajectory trajectory;
+  geometry_msgs::msg::Pose msg;
+
+  // circle facing forward
+  msg.orientation.x = 0.0;
+  msg.orientation.y = sqrt(2) / 2;
+  msg.orientation.z = 0.0;
+  msg.orientation.w = sqrt(2) / 2;
+  msg.position.x = 0.4;
+  // Define waypoints in a circle
+  for (int i = 0; i < 63; i++) {
+    msg.position.y = -0.2 + sin(0.1 * i) * 0.15;
+    msg.position.z = 0.4 + cos(0.1 * i) * 0.15;
+    waypoints.push_back(msg);
+  }
+
+  RCLCPP_INFO(LOGGER, "Start planning");
+  const auto start = std::chrono::steady_clock::now();
+  double fraction = computeCartesianPathParallel(
+    waypoints, cartesian_step_, trajectory, static_cast<std::size_t>(cartesian_segments_));
+  RCLCPP_INFO(LOGGER, "Planning done!");
+
+  if (fraction < 1) {
+    RCLCPP_ERROR(LOGGER, "Could not compute trajectory through all waypoints!");
+    return recordPlan("cartesian_path", start, nullptr);
+  } else {
+    return recordPlan(
+      "cartesian_path", start, std::make_shared<moveit_msgs::msg::RobotTrajectory>(trajectory));
+  }
+}
+
+double MoveitExample::computeCartesianPathParallel(
+  const std::vector<geometry_msgs::msg::Pose> & waypoints, double max_step,
+  moveit_msgs::msg::RobotTrajectory & trajectory, std::size_t segment_count,
+  const moveit_msgs::msg::RobotState * start_state)
+{
+  trajectory = moveit_msgs::msg::RobotTrajectory();
+  if (waypoints.empty()) {
+    return 0;
+  }
+  if (!cartesian_path_client_->wait_for_service(std::chrono::seconds(1)) ||
+    !ik_client_->wait_for_service(std::chrono::seconds(1)))
+  {
+    RCLCPP_ERROR(LOGGER, "Cartesian path or IK service not available");
+    return 0;
+  }
+
+  moveit_msgs::msg::RobotState first_state;
+  if (start_state != nullptr) {
+    first_state = *start_state;
+  } else {
+    first_state.joint_state.name = move_group_interface_->getVariableNames();
+    first_state.joint_state.position = move_group_interface_->getCurrentJointValues();
+  }
+  first_state.is_diff = true;
+
+  // Paths with different attached objects must not be mixed up
+  std::string attached_objects;
+  for (const auto & attached : first_state.attached_collision_objects) {
+    attached_objects +=
+      (attached.object.operation == attached.object.REMOVE ? "-" : "+") + attached.object.id;
+  }
+  const auto key = trajectory_cache_.MakeKey(
+    first_state.joint_state.position, waypoints, max_step, "cartesian" + attached_objects);
+  auto * entry = trajectory_cache_.Find(key);
+  if (entry != nullptr && entry->scene_revision != scene_revision_) {
+    if (isTrajectoryValid(entry->trajectory, start_state)) {
+      entry->scene_revision = scene_revision_;
+    } else {
+      RCLCPP_INFO(LOGGER, "Cached Cartesian path collides in the current scene, replanning");
+      trajectory_cache_.Erase(key);
+      entry = nullptr;
+    }
+  }
+  if (entry != nullptr) {
+    RCLCPP_INFO(
+      LOGGER, "Reusing cached Cartesian path (%lu hits, %lu misses)", trajectory_cache_.Hits(),
+      trajectory_cache_.Misses());
+    trajectory = entry->trajectory;
+    return 1;
+  }
+
+  // Segment i plans from the last waypoint before begin[i] through the waypoints until
+  //  begin[i + 1], the first one starts at the start state
+  segment_count = std::max<std::size_t>(1, std::min(segment_count, waypoints.size()));
+  std::vector<std::size_t> begin;
+  for (std::size_t i = 0; i <= segment_count; ++i) {
+    begin.push_back(i * waypoints.size() / segment_count);
+  }
+  std::vector<moveit_msgs::msg::RobotState> seeds(segment_count, first_state);
+  for (std::size_t i = 1; i < segment_count; ++i) {
+    if (!solveIk(waypoints[begin[i] - 1], seeds[i - 1], seeds[i])) {
+      // Planned from the end of the previous segment instead
+      seeds.resize(i);
+      break;
+    }
+  }
+
+  using FutureAndRequestId =
+    rclcpp::Client<moveit_msgs::srv::GetCartesianPath>::FutureAndRequestId;
+  const auto send_segment = [&](std::size_t i, const moveit_msgs::msg::RobotState & seed)
+    {
+      auto request = std::make_shared<moveit_msgs::srv::GetCartesianPath::Request>();
+      request->header.frame_id = move_group_interface_->getPlanningFrame();
+      request->start_state = seed;
+      request->group_name = PLANNING_GROUP;
+      request->link_name = move_group_interface_->getEndEffectorLink();
+      request->waypoints.assign(waypoints.begin() + begin[i], waypoints.begin() + begin[i + 1]);
+      request->max_step = max_step;
+      request->jump_threshold = 0.0;
+      request->avoid_collisions = true;
+      return cartesian_path_client_->async_send_request(request);
+    };
+  std::vector<FutureAndRequestId> pending;
+  for (std::size_t i = 0; i < seeds.size(); ++i) {
+    pending.push_back(send_segment(i, seeds[i]));
+  }
+
+  std::size_t reached = 0;
+  auto & points = trajectory.joint_trajectory.points;
+  for (std::size_t i = 0; i < segment_count; ++i) {
+    moveit_msgs::srv::GetCartesianPath::Response::SharedPtr response;
+    if (i < pending.size()) {
+      response = waitForSegment(pending[i]);
+    }
+    // Replanned from where the path is, if the segment was planned from another configuration
+    if (i > 0 && (response == nullptr || !continues(points.back(), response->solution))) {
+      auto seed = first_state;
+      seed.joint_state.name = trajectory.joint_trajectory.joint_names;
+      seed.joint_state.position = points.back().positions;
+      auto replanned = send_segment(i, seed);
+      response = waitForSegment(replanned);
+    }
+    if (response == nullptr || response->solution.joint_trajectory.points.empty()) {
+      break;
+    }
+    const auto & segment = response->solution.joint_trajectory;
+    if (i == 0) {
+      trajectory.joint_trajectory.joint_names = segment.joint_names;
+    }
+    // The first point of a later segment is the last one of the previous segment
+    points.insert(points.end(), segment.points.begin() + (i == 0 ? 0 : 1), segment.points.end());
+    reached += static_cast<std::size_t>(
+      std::floor(response->fraction * static_cast<double>(begin[i + 1] - begin[i]) + 1e-9));
+    if (response->fraction < 1) {
+      break;
+    }
+  }
+  for (std::size_t i = 0; i < pending.size(); ++i) {
+    cartesian_path_client_->remove_pending_request(pending[i]);
+  }
+  if (points.empty()) {
+    return 0;
+  }
+
+  // The segments stop at their ends, the stitched path is timed again
+  moveit::core::RobotState reference(move_group_interface_->getRobotModel());
+  reference.setToDefaultValues();
+  robot_trajectory::RobotTrajectory timed(move_group_interface_->getRobotModel(), PLANNING_GROUP);
+  timed.setRobotTrajectoryMsg(reference, trajectory);
+  trajectory_processing::IterativeParabolicTimeParameterization time_parameterization;
+  time_parameterization.computeTimeStamps(timed, 1.0);
+  timed.getRobotTrajectoryMsg(trajectory);
+
+  const double fraction = static_cast<double>(reached) / static_cast<double>(waypoints.size());
+  // Incomplete paths are planned again, they might succeed in a changed scene
+  if (reached == waypoints.size()) {
+    trajectory_cache_.Store(key, trajectory, scene_revision_);
+  }
+  return fraction;
+}
+
+moveit_msgs::msg::RobotTrajectory::SharedPtr MoveitExample::planToPoint(
+  const Eigen::Isometry3d & pose, const std::string & planning_pipeline,
+  const std::string & planner_id)
+{
+  // Create planning request using pilz industrial motion planner
+  move_group_interface_->setPlanningPipelineId(planning_pipeline);
+  move_group_interface_->setPlannerId(planner_id);
+  move_group_interface_->setPoseTarget(pose);
+
+  moveit::planning_interface::MoveGroupInterface::Plan plan;
+  RCLCPP_INFO(LOGGER, "Sending planning request");
+  const auto start = std::chrono::steady_clock::now();
+  if (!move_group_interface_->plan(plan)) {
+    RCLCPP_INFO(LOGGER, "Planning failed");
+    return recordPlan(planning_pipeline + "/" + planner_id, start, nullptr);
+  } else {
+    RCLCPP_INFO(LOGGER, "Planning successful");
+    return recordPlan(
+      planning_pipeline + "/" + planner_id, start,
+      std::make_shared<moveit_msgs::msg::RobotTrajectory>(plan.trajectory_));
+  }
+}
+
+moveit_msgs::msg::RobotTrajectory::SharedPtr MoveitExample::planToPosition(
+  const std::vector<double> & joint_pos)
+{
+  move_group_interface_->setJointValueTarget(joint_pos);
+  // The planner of the previous request, or the default one of move_group
+  const std::string & pipeline = move_group_interface_->getPlanningPipelineId();
+  const std::string planner = (pipeline.empty() ? "default" : pipeline) + "/" +
+    move_group_interface_->getPlannerId();
+
+  moveit::planning_interface::MoveGroupInterface::Plan plan;
+  RCLCPP_INFO(LOGGER, "Sending planning request");
+  const auto start = std::chrono::steady_clock::now();
+  if (!move_group_interface_->plan(plan)) {
+    RCLCPP_INFO(LOGGER, "Planning failed");
+    return recordPlan(planner, start, nullptr);
+  } else {
+    RCLCPP_INFO(LOGGER, "Planning successful");
+    return recordPlan(
+      planner, start, std::make_shared<moveit_msgs::msg::RobotTrajectory>(plan.trajectory_));
+  }
+}
+
+moveit_msgs::msg::RobotTrajectory::SharedPtr MoveitExample::planToPointUntilSuccess(
+  const Eigen::Isometry3d & pose, const std::string & planning_pipeline,
+  const std::string & planner_id)
+{
+  // Create planning request using given motion planner
+  move_group_interface_->setPlanningPipelineId(planning_pipeline);
+  move_group_interface_->setPlannerId(planner_id);
+  move_group_interface_->setPoseTarget(pose);
+  return planUntilSuccess(*move_group_interface_, planning_pipeline + "/" + planner_id);
+}
+
+moveit_msgs::msg::RobotTrajectory::SharedPtr MoveitExample::planToPointRace(
+  const Eigen::Isometry3d & pose, const std::vector<PlannerCandidate> & candidates,
+  std::chrono::milliseconds deadline, RaceSelection selection)
+{
+  if (!plan_client_->wait_for_service(std::chrono::seconds(1))) {
+    RCLCPP_ERROR(LOGGER, "Motion plan service not available");
+    return nullptr;
+  }
+  move_group_interface_->setPoseTarget(pose);
+  moveit_msgs::msg::MotionPlanRequest base_request;
+  move_group_interface_->constructMotionPlanRequest(base_request);
+  base_request.allowed_planning_time = std::chrono::duration<double>(deadline).count();
+
+  const auto start = std::chrono::steady_clock::now();
+  const auto end = start + deadline;
+  using FutureAndRequestId =
+    rclcpp::Client<moveit_msgs::srv::GetMotionPlan>::FutureAndRequestId;
+  std::vector<FutureAndRequestId> pending;
+  for (const auto & candidate : candidates) {
+    auto request = std::make_shared<moveit_msgs::srv::GetMotionPlan::Request>();
+    request->motion_plan_request = base_request;
+    request->motion_plan_request.pipeline_id = candidate.planning_pipeline;
+    request->motion_plan_request.planner_id = candidate.planner_id;
+    pending.push_back(plan_client_->async_send_request(request));
+  }
+
+  moveit_msgs::msg::RobotTrajectory::SharedPtr best;
+  double best_duration = 0;
+  std::size_t best_index = 0;
+  std::vector<bool> done(pending.size(), false);
+  std::size_t remaining = pending.size();
+  while (remaining > 0 && std::chrono::steady_clock::now() < end &&
+    !(best != nullptr && selection == RaceSelection::FIRST))
+  {
+    for (std::size_t i = 0; i < pending.size(); ++i) {
+      if (done[i] ||
+        pending[i].future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+      {
+        continue;
+      }
+      done[i] = true;
+      remaining--;
+      const auto response = pending[i].future.get();
+      if (response->motion_plan_response.error_code.val !=
+        moveit_msgs::msg::MoveItErrorCodes::SUCCESS)
+      {
+        continue;
+      }
+      const auto & points = response->motion_plan_response.trajectory.joint_trajectory.points;
+      const double duration =
+        points.empty() ? 0 : rclcpp::Duration(points.back().time_from_start).seconds();
+      if (best == nullptr || duration < best_duration) {
+        best = std::make_shared<moveit_msgs::msg::RobotTrajectory>(
+          response->motion_plan_response.trajectory);
+        best_duration = duration;
+        best_index = i;
+      }
+      if (selection == RaceSelection::FIRST) {
+        break;
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  for (std::size_t i = 0; i < pending.size(); ++i) {
+    if (!done[i]) {
+      plan_client_->remove_pending_request(pending[i]);
+    }
+  }
+
+  const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now() - start);
+  if (best == nullptr) {
+    RCLCPP_INFO(LOGGER, "No planner succeeded within %li ms", elapsed.count());
+    return recordPlan("race", start, nullptr);
+  }
+  RCLCPP_INFO(
+    LOGGER, "Planning with %s/%s successful after %li ms, duration of the plan: %.2f s",
+    candidates[best_index].planning_pipeline.c_str(), candidates[best_index].planner_id.c_str(),
+    elapsed.count(), best_duration);
+  // Recorded for the winner, the time is the one of the whole race
+  return recordPlan(
+    "race:" + candidates[best_index].planning_pipeline + "/" + candidates[best_index].planner_id,
+    start, best);
+}
+
+moveit_msgs::msg::RobotTrajectory::SharedPtr MoveitExample::planToPointCached(
+  const Eigen::Isometry3d & pose, const std::string & planning_pipeline,
+  const std::string & planner_id, const moveit_msgs::msg::RobotState * start_state)
+{
+  // Plans with different attached objects must not be mixed up
+  std::string attached_objects;
+  if (start_state != nullptr) {
+    for (const auto & attached : start_state->attached_collision_objects) {
+      attached_objects +=
+        (attached.object.operation == attached.object.REMOVE ? "-" : "+") + attached.object.id;
+    }
+  }
+  const auto start = std::chrono::steady_clock::now();
+  const auto key = trajectory_cache_.MakeKey(
+    start_state != nullptr ? start_state->joint_state.position :
+    move_group_interface_->getCurrentJointValues(), pose, planning_pipeline,
+    planner_id + attached_objects);
+  auto * entry = trajectory_cache_.Find(key);
+  if (entry != nullptr && entry->scene_revision != scene_revision_) {
+    if (isTrajectoryValid(entry->trajectory, start_state)) {
+      entry->scene_revision = scene_revision_;
+    } else {
+      RCLCPP_INFO(LOGGER, "Cached plan collides in the current scene, replanning");
+      trajectory_cache_.Erase(key);
+      entry = nullptr;
+    }
+  }
+  if (entry != nullptr) {
+    RCLCPP_INFO(
+      LOGGER, "Reusing cached plan (%lu hits, %lu misses)", trajectory_cache_.Hits(),
+      trajectory_cache_.Misses());
+    return recordPlan(
+      "cached:" + planning_pipeline + "/" + planner_id, start,
+      std::make_shared<moveit_msgs::msg::RobotTrajectory>(entry->trajectory));
+  }
+
+  moveit_msgs::msg::RobotTrajectory::SharedPtr trajectory;
+  if (start_state != nullptr) {
+    // move_group_interface_ might be executing the trajectory ending in the start state
+    pipeline_interface_->setPlanningPipelineId(planning_pipeline);
+    pipeline_interface_->setPlannerId(planner_id);
+    pipeline_interface_->setPoseTarget(pose);
+    pipeline_interface_->setStartState(*start_state);
+    trajectory = planUntilSuccess(*pipeline_interface_, planning_pipeline + "/" + planner_id);
+  } else {
+    trajectory = planToPointUntilSuccess(pose, planning_pipeline, planner_id);
+  }
+  if (trajectory != nullptr) {
+    trajectory_cache_.Store(key, *trajectory, scene_revision_);
+  }
+  return trajectory;
+}
+
+bool MoveitExample::isTrajectoryValid(
+  const moveit_msgs::msg::RobotTrajectory & trajectory,
+  const moveit_msgs::msg::RobotState * start_state)
+{
+  if (!state_validity_client_->wait_for_service(std::chrono::seconds(1))) {
+    RCLCPP_ERROR(LOGGER, "State validity service not available");
+    return false;
+  }
+  auto request = std::make_shared<moveit_msgs::srv::GetStateValidity::Request>();
+  request->group_name = PLANNING_GROUP;
+  if (start_state != nullptr) {
+    request->robot_state = *start_state;
+  }
+  // The attached objects of the current state are kept
+  request->robot_state.is_diff = true;
+  request->robot_state.joint_state.name = trajectory.joint_trajectory.joint_names;
+  for (const auto & point : trajectory.joint_trajectory.points) {
+    request->robot_state.joint_state.position = point.positions;
+    auto response = state_validity_client_->async_send_request(request);
+    if (response.wait_for(std::chrono::seconds(1)) != std::future_status::ready ||
+      !response.get()->valid)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+moveit_msgs::msg::RobotState MoveitExample::endState(
+  const moveit_msgs::msg::RobotTrajectory & trajectory, const std::string & object_id,
+  bool attach) const
+{
+  moveit_msgs::msg::RobotState state;
+  state.is_diff = true;
+  state.joint_state.name = trajectory.joint_trajectory.joint_names;
+  if (!trajectory.joint_trajectory.points.empty()) {
+    state.joint_state.position = trajectory.joint_trajectory.points.back().positions;
+  }
+  if (!object_id.empty()) {
+    // Attaching takes the object from the world, detaching puts it back at its current pose
+    moveit_msgs::msg::AttachedCollisionObject attached_object;
+    attached_object.link_name = "flange";
+    attached_object.object.id = object_id;
+    attached_object.object.operation =
+      attach ? attached_object.object.ADD : attached_object.object.REMOVE;
+    state.attached_collision_objects.push_back(attached_object);
+  }
+  return state;
+}
+
+bool MoveitExample::execute(const moveit_msgs::msg::RobotTrajectory::SharedPtr & trajectory)
+{
+  const auto start = std::chrono::steady_clock::now();
+  const bool succeeded =
+    move_group_interface_->execute(*trajectory) == moveit::core::MoveItErrorCode::SUCCESS;
+  benchmark_.AddExecution(
+    trajectory.get(),
+    std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), succeeded);
+  return succeeded;
+}
+
+void MoveitExample::setScalingFactors(double velocity, double acceleration)
+{
+  move_group_interface_->setMaxVelocityScalingFactor(velocity);
+  move_group_interface_->setMaxAccelerationScalingFactor(acceleration);
+  pipeline_interface_->setMaxVelocityScalingFactor(velocity);
+  pipeline_interface_->setMaxAccelerationScalingFactor(acceleration);
+}
+
+void MoveitExample::writeBenchmark() const
+{
+  if (!benchmarkMode()) {
+    return;
+  }
+  if (benchmark_.Write(benchmark_output_)) {
+    RCLCPP_INFO(LOGGER, "Benchmark results written to %s", benchmark_output_.c_str());
+  } else {
+    RCLCPP_ERROR(
+      LOGGER, "Could not write the benchmark results to %s", benchmark_output_.c_str());
+  }
+}
+
+void MoveitExample::AddObjects(const std::vector<moveit_msgs::msg::CollisionObject> & objects)
+{
+  if (scene_batching_) {
+    scene_batch_.insert(scene_batch_.end(), objects.begin(), objects.end());
+    return;
+  }
+  scene_revision_++;
+  moveit_msgs::msg::PlanningScene planning_scene;
+  planning_scene.name = "scene";
+  planning_scene.world.collision_objects = objects;
+  planning_scene.is_diff = true;
+  planning_scene_diff_publisher_->publish(planning_scene);
+}
+
+void MoveitExample::commitSceneBatch()
+{
+  scene_batching_ = false;
+  if (!scene_batch_.empty()) {
+    AddObjects(scene_batch_);
+    scene_batch_.clear();
+  }
+}
+
+void MoveitExample::addRobotPlatform()
+{
+  moveit_msgs::msg::CollisionObject collision_object;
+  collision_object.header.frame_id = move_group_interface_->getPlanningFrame();
+  collision_object.id = "robot_stand";
+  shape_msgs::msg::SolidPrimitive primitive;
+  primitive.type = primitive.BOX;
+  primitive.dimensions.resize(3);
+  primitive.dimensions[primitive.BOX_X] = 0.5;
+  primitive.dimensions[primitive.BOX_Y] = 0.5;
+  primitive.dimensions[primitive.BOX_Z] = 1.2;
+
+  // Define a pose for the box (specified relative to frame_id).
+  geometry_msgs::msg::Pose stand_pose1;
+  stand_pose1.orientation.w = 1.0;
+  stand_pose1.position.x = 0.0;
+  stand_pose1.position.y = 0.0;
+  stand_pose1.position.z = -0.6;
+
+  collision_object.primitives.push_back(primitive);
+  collision_object.primitive_poses.push_back(stand_pose1);
+  collision_object.operation = collision_object.ADD;
+
+  AddObject(collision_object);
+}
+
+void MoveitExample::addCollisionBox(
+  const geometry_msgs::msg::Vector3 & position,
+  const geometry_msgs::msg::Vector3 & size)
+{
+  moveit_msgs::msg::CollisionObject collision_object;
+  collision_object.header.frame_id = move_group_interface_->getPlanningFrame();
+  collision_object.id = "collision_box";
+  shape_msgs::msg::SolidPrimitive primitive;
+  primitive.type = primitive.BOX;
+  primitive.dimensions.resize(3);
+  primitive.dimensions[primitive.BOX_X] = size.x;
+  primitive.dimensions[primitive.BOX_Y] = size.y;
+  primitive.dimensions[primitive.BOX_Z] = size.z;
+
+  // Define a pose for the box (specified relative to frame_id).
+  geometry_msgs::msg::Pose stand_pose;
+  stand_pose.orientation.w = 1.0;
+  stand_pose.position.x = position.x;
+  stand_pose.position.y = position.y;
+  stand_pose.position.z = position.z;
+
+  collision_object.primitives.push_back(primitive);
+  collision_object.primitive_poses.push_back(stand_pose);
+  collision_object.operation = collision_object.ADD;
+
+  AddObject(collision_object);
+}
+
+void MoveitExample::addPalletObjects()
+{
+  std::vector<moveit_msgs::msg::CollisionObject> pallet_objects;
+  for (int k = 0; k < 3; k++) {
+    for (int j = 0; j < 3; j++) {
+      for (int i = 0; i < 3; i++) {
+        moveit_msgs::msg::CollisionObject pallet_object;
+        pallet_object.header.frame_id = move_group_interface_->getPlanningFrame();
+
+        pallet_object.id = "pallet_" + std::to_string(9 * k + 3 * j + i);
+        shape_msgs::msg::SolidPrimitive primitive;
+        primitive.type = primitive.BOX;
+        primitive.dimensions.resize(3);
+        primitive.dimensions[primitive.BOX_X] = 0.097;
+        primitive.dimensions[primitive.BOX_Y] = 0.097;
+        primitive.dimensions[primitive.BOX_Z] = 0.097;
+
+        // Define a pose for the box (specified relative to frame_id).
+        geometry_msgs::msg::Pose stand_pose;
+        stand_pose.orientation.w = 1.0;
+        stand_pose.position.x = 0.3 + i * 0.1;
+        stand_pose.position.y = -0.1 + j * 0.1;
+        stand_pose.position.z = 0.3 - 0.1 * k;
+
+        pallet_object.primitives.push_back(primitive);
+        pallet_object.primitive_poses.push_back(stand_pose);
+        pallet_object.operation = pallet_object.ADD;
+
+        pallet_objects.push_back(pallet_object);
+      }
+    }
+  }
+  AddObjects(pallet_objects);
+}
+
+void MoveitExample::RemoveObject(const std::string & object_id)
+{
+  moveit_msgs::msg::CollisionObject collision_object;
+  collision_object.id = object_id;
+  collision_object.operation = collision_object.REMOVE;
+  AddObject(collision_object);
+}
+
+void MoveitExample::AttachObject(const std::string & object_id)
+{
+  scene_revision_++;
+  moveit_msgs::msg::PlanningScene planning_scene;
+  planning_scene.name = "scene";
+  moveit_msgs::msg::AttachedCollisionObject attached_object;
+
+  attached_object.link_name = "flange";
+  attached_object.object.id = object_id;
+
+  // Carry out the REMOVE + ATTACH operation
+  RCLCPP_INFO(LOGGER, "Attaching the object to the hand and removing it from the world.");
+  planning_scene.robot_state.attached_collision_objects.push_back(attached_object);
+  planning_scene.robot_state.is_diff = true;
+  planning_scene.is_diff = true;
+  planning_scene_diff_publisher_->publish(planning_scene);
+}
+
+void MoveitExample::DetachAndRemoveObject(const std::string & object_id)
+{
+  scene_revision_++;
+  moveit_msgs::msg::PlanningScene planning_scene;
+  planning_scene.name = "scene";
+  moveit_msgs::msg::AttachedCollisionObject attached_object;
+
+  attached_object.link_name = "flange";
+  attached_object.object.id = object_id;
+  attached_object.object.operation = attached_object.object.REMOVE;
+
+  // Carry out the DETACH operation
+  RCLCPP_INFO(LOGGER, "Detaching the object from the hand");
+  planning_scene.robot_state.attached_collision_objects.push_back(attached_object);
+  planning_scene.robot_state.is_diff = true;
+  planning_scene.world.collision_objects.push_back(attached_object.object);
+  planning_scene.is_diff = true;
+  planning_scene_diff_publisher_->publish(planning_scene);
+}
+
+void MoveitExample::setOrientationConstraint(const geometry_msgs::msg::Quaternion & orientation)
+{
+  moveit_msgs::msg::OrientationConstraint orientation_constraint;
+  moveit_msgs::msg::Constraints constraints;
+  orientation_constraint.header.frame_id = move_group_interface_->getPlanningFrame();
+  orientation_constraint.link_name = move_group_interface_->getEndEffectorLink();
+  orientation_constraint.orientation = orientation;
+  orientation_constraint.absolute_x_axis_tolerance = 0.2;
+  orientation_constraint.absolute_y_axis_tolerance = 0.2;
+  orientation_constraint.absolute_z_axis_tolerance = 0.2;
+  orientation_constraint.weight = 1.0;
+
+  constraints.orientation_constraints.emplace_back(orientation_constraint);
+  move_group_interface_->setPathConstraints(constraints);
+}
+
+void MoveitExample::drawTrajectory(const moveit_msgs::msg::RobotTrajectory & trajectory)
+{
+  moveit_visual_tools_->deleteAllMarkers();
+  moveit_visual_tools_->publishTrajectoryLine(
+    trajectory,
+    moveit_visual_tools_->getRobotModel()->getJointModelGroup(PLANNING_GROUP));
+}
+
+void MoveitExample::drawTitle(const std::string & text)
+{
+  auto const text_pose = []
+    {
+      auto msg = Eigen::Isometry3d::Identity();
+      msg.translation().z() = 1.0;
+      return msg;
+    } ();
+  moveit_visual_tools_->publishText(
+    text_pose, text, rviz_visual_tools::RED,
+    rviz_visual_tools::XXLARGE);
+}
+
+void MoveitExample::addBreakPoint()
+{
+  moveit_visual_tools_->trigger();
+  if (!benchmarkMode()) {
+    moveit_visual_tools_->prompt("Press 'Next' in the RvizVisualToolsGui window to execute");
+  }
+}
+
+moveit_msgs::msg::RobotTrajectory::SharedPtr MoveitExample::planUntilSuccess(
+  moveit::planning_interface::MoveGroupInterface & interface, const std::string & planner)
+{
+  moveit::planning_interface::MoveGroupInterface::Plan plan;
+  RCLCPP_INFO(LOGGER, "Sending planning request");
+  moveit::core::MoveItErrorCode err_code;
+  const auto start = std::chrono::steady_clock::now();
+  do{
+    RCLCPP_INFO(LOGGER, "Planning ...");
+    err_code = interface.plan(plan);
+  } while (err_code != moveit::core::MoveItErrorCode::SUCCESS);
+  auto stop = std::chrono::steady_clock::now();
+  auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start);
+  RCLCPP_INFO(LOGGER, "Planning successful after %li ms", duration.count());
+  // The retries are part of the planning time, a plan is always found
+  return recordPlan(
+    planner, start, std::make_shared<moveit_msgs::msg::RobotTrajectory>(plan.trajectory_));
+}
+
+bool MoveitExample::solveIk(
+  const geometry_msgs::msg::Pose & pose, const moveit_msgs::msg::RobotState & seed,
+  moveit_msgs::msg::RobotState & solution)
+{
+  auto request = std::make_shared<moveit_msgs::srv::GetPositionIK::Request>();
+  request->ik_request.group_name = PLANNING_GROUP;
+  request->ik_request.robot_state = seed;
+  request->ik_request.avoid_collisions = true;
+  request->ik_request.ik_link_name = move_group_interface_->getEndEffectorLink();
+  request->ik_request.pose_stamped.header.frame_id = move_group_interface_->getPlanningFrame();
+  request->ik_request.pose_stamped.pose = pose;
+  request->ik_request.timeout = rclcpp::Duration::from_seconds(0.1);
+  auto response = ik_client_->async_send_request(request);
+  if (response.wait_for(std::chrono::seconds(1)) != std::future_status::ready) {
+    return false;
+  }
+  const auto result = response.get();
+  if (result->error_code.val != moveit_msgs::msg::MoveItErrorCodes::SUCCESS) {
+    return false;
+  }
+  solution = seed;
+  solution.joint_state.position.clear();
+  // The solution contains every joint of the robot, the ones of the seed are taken from it
+  const auto & solved = result->solution.joint_state;
+  for (const auto & name : seed.joint_state.name) {
+    const auto joint = std::find(solved.name.begin(), solved.name.end(), name);
+    if (joint == solved.name.end()) {
+      return false;
+    }
+    solution.joint_state.position.push_back(solved.position[joint - solved.name.begin()]);
+  }
+  return true;
+}
+
+moveit_msgs::srv::GetCartesianPath::Response::SharedPtr MoveitExample::waitForSegment(
+  rclcpp::Client<moveit_msgs::srv::GetCartesianPath>::FutureAndRequestId & request)
+{
+  if (request.future.wait_for(std::chrono::seconds(10)) != std::future_status::ready) {
+    RCLCPP_ERROR(LOGGER, "Cartesian path segment timed out");
+    cartesian_path_client_->remove_pending_request(request);
+    return nullptr;
+  }
+  auto response = request.future.get();
+  if (response->error_code.val != moveit_msgs::msg::MoveItErrorCodes::SUCCESS) {
+    return nullptr;
+  }
+  return response;
+}
+
+bool MoveitExample::continues(
+  const trajectory_msgs::msg::JointTrajectoryPoint & point,
+  const moveit_msgs::msg::RobotTrajectory & segment) const
+{
+  if (segment.joint_trajectory.points.empty()) {
+    return false;
+  }
+  const auto & positions = segment.joint_trajectory.points.front().positions;
+  if (positions.size() != point.positions.size()) {
+    return false;
+  }
+  for (std::size_t i = 0; i < positions.size(); ++i) {
+    if (std::abs(positions[i] - point.positions[i]) > 1e-3) {
+      return false;
+    }
+  }
+  return true;
+}
+
+moveit_msgs::msg::RobotTrajectory::SharedPtr MoveitExample::recordPlan(
+  const std::string & planner, std::chrono::steady_clock::time_point start,
+  moveit_msgs::msg::RobotTrajectory::SharedPtr trajectory)
+{
+  const double planning_time =
+    std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  double duration = 0;
+  if (trajectory != nullptr && !trajectory->joint_trajectory.points.empty()) {
+    duration = rclcpp::Duration(trajectory->joint_trajectory.points.back().time_from_start)
+      .seconds();
+  }
+  benchmark_.AddPlan(trajectory.get(), planner, planning_time, duration);
+  return trajectory;
+}
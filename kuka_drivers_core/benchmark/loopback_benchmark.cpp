@@ -0,0 +1,559 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// End-to-end benchmark of a hardware interface plugin: the hardware of a URDF is loaded and
+// driven with read() -> update -> write() against a robot simulator over UDP loopback. The
+// latency from the return of read() (state received) to the return of write() (reply sent),
+// the cycle period, the CPU time of the cycles and the deadline misses are printed as one
+// JSON object or CSV row, so that runs of different driver versions can be compared. With a
+// fault profile the driver applies network faults to the traffic, to measure its degradation.
+// Built with the TRACK_RT_ALLOCATIONS option, the heap usage of read() and write() is counted
+// and can be asserted with --max-allocations.
+
+#include <getopt.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "hardware_interface/component_parser.hpp"
+#include "hardware_interface/system.hpp"
+#include "hardware_interface/system_interface.hpp"
+#include "lifecycle_msgs/msg/state.hpp"
+#include "pluginlib/class_loader.hpp"
+#include "rclcpp/rclcpp.hpp"
+
+#include "kuka_drivers_core/allocation_tracker.hpp"
+#include "kuka_drivers_core/latency_histogram.hpp"
+
+namespace
+{
+// 1 us buckets up to 20 ms, which covers the 12 ms RSI cycle with a margin
+using Histogram = kuka_drivers_core::LatencyHistogram<20000, 1000>;
+
+struct Options
+{
+  std::string urdf_path;
+  std::string hardware_name;
+  std::string simulator;
+  std::string fault_profile;
+  int64_t cycle_ns = 4000000;
+  int64_t deadline_ns = 0;
+  uint64_t cycles = 10000;
+  uint64_t warmup = 100;
+  int priority = 0;
+  bool paced = false;
+  bool csv = false;
+  bool fault_scenarios = false;
+  // Allowed calls of the allocation functions in the measured cycles, negative if not checked
+  int64_t max_allocations = -1;
+};
+
+struct Results
+{
+  Histogram latency;
+  Histogram period;
+  Histogram cpu_time;
+  uint64_t cycles = 0;
+  uint64_t deadline_misses = 0;
+  uint64_t late_cycles = 0;
+  uint64_t errors = 0;
+  int64_t total_cpu_ns = 0;
+  long involuntary_switches = 0;  // NOLINT(runtime/int)
+  // Heap usage of read() and write() in the measured cycles, with TRACK_RT_ALLOCATIONS
+  uint64_t allocations = 0;
+  uint64_t frees = 0;
+};
+
+void PrintUsage(const char * program)
+{
+  printf(
+    "Usage: %s [options] --urdf <file>\n"
+    "  --urdf <file>         robot description containing the ros2_control hardware\n"
+    "  --hardware <name>     name of the hardware in the description (default: the first one)\n"
+    "  --simulator <command> robot simulator started before and stopped after the run\n"
+    "  --cycle-us <us>       nominal cycle time of the robot (default: 4000)\n"
+    "  --deadline-us <us>    maximal state to reply latency (default: half of the cycle)\n"
+    "  --cycles <n>          number of measured cycles (default: 10000)\n"
+    "  --warmup <n>          number of cycles before the measurement (default: 100)\n"
+    "  --paced               sleep until the next nominal cycle before read(), for hardware\n"
+    "                        that does not block in read()\n"
+    "  --priority <p>        run with SCHED_FIFO and the given priority\n"
+    "  --fault-profile <p>   network faults applied by the driver, set as its fault_profile\n"
+    "                        hardware parameter, e.g. delay_us=500,jitter_us=300,loss=0.01\n"
+    "  --fault-scenarios     run with the built-in fault profiles one after another (delay,\n"
+    "                        jitter, loss, burst loss, reordering and reply loss scaled to\n"
+    "                        the cycle time) and print one result for each\n"
+    "  --max-allocations <n> fail if read() and write() call the allocation functions (malloc,\n"
+    "                        free, ...) more than n times in the measured cycles and print the\n"
+    "                        backtraces, needs the TRACK_RT_ALLOCATIONS build option\n"
+    "  --csv                 print a CSV header and row instead of JSON\n", program);
+}
+
+int64_t Now(clockid_t clock)
+{
+  struct timespec time;
+  clock_gettime(clock, &time);
+  return static_cast<int64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+}
+
+void RecordDuration(Histogram & histogram, int64_t duration_ns)
+{
+  histogram.Record(duration_ns > 0 ? static_cast<uint64_t>(duration_ns) : 0);
+}
+
+bool ReadFile(const std::string & path, std::string & content)
+{
+  std::ifstream file(path);
+  if (!file) {
+    return false;
+  }
+  std::stringstream stream;
+  stream << file.rdbuf();
+  content = stream.str();
+  return true;
+}
+
+// Starts the simulator in its own process group, so that its children are also stopped
+pid_t StartSimulator(const std::string & command)
+{
+  const pid_t pid = fork();
+  if (pid == 0) {
+    setpgid(0, 0);
+    execl("/bin/sh", "sh", "-c", command.c_str(), static_cast<char *>(nullptr));
+    _exit(127);
+  }
+  return pid;
+}
+
+void StopSimulator(pid_t pid)
+{
+  if (pid <= 0) {
+    return;
+  }
+  kill(-pid, SIGINT);
+  for (int i = 0; i < 100; ++i) {
+    if (waitpid(pid, nullptr, WNOHANG) == pid) {
+      return;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  kill(-pid, SIGKILL);
+  waitpid(pid, nullptr, 0);
+}
+
+// Position commands follow the measured positions, so the robot holds its pose
+std::vector<std::pair<const hardware_interface::StateInterface *,
+  hardware_interface::CommandInterface *>> PairInterfaces(
+  const std::vector<hardware_interface::StateInterface> & states,
+  std::vector<hardware_interface::CommandInterface> & commands)
+{
+  std::vector<std::pair<const hardware_interface::StateInterface *,
+    hardware_interface::CommandInterface *>> pairs;
+  for (auto & command : commands) {
+    for (const auto & state : states) {
+      if (state.get_name() == command.get_name()) {
+        pairs.emplace_back(&state, &command);
+        break;
+      }
+    }
+  }
+  return pairs;
+}
+
+bool RunCycles(
+  hardware_interface::System & system, const Options & options, Results & results)
+{
+  auto states = system.export_state_interfaces();
+  auto commands = system.export_command_interfaces();
+  const auto pairs = PairInterfaces(states, commands);
+
+  const rclcpp::Duration period = rclcpp::Duration::from_nanoseconds(options.cycle_ns);
+  const int64_t deadline_ns = options.deadline_ns > 0 ? options.deadline_ns : options.cycle_ns / 2;
+  int64_t next_cycle = Now(CLOCK_MONOTONIC);
+  int64_t previous_receive = 0;
+
+  namespace tracker = kuka_drivers_core::allocation_tracker;
+  auto heap_calls = [](tracker::Kind kind) {
+      return tracker::Count(tracker::Phase::READ, kind) +
+             tracker::Count(tracker::Phase::WRITE, kind);
+    };
+
+  struct rusage usage_start;
+  getrusage(RUSAGE_THREAD, &usage_start);
+  int64_t measurement_cpu_start = Now(CLOCK_THREAD_CPUTIME_ID);
+  uint64_t allocations_start = heap_calls(tracker::Kind::ALLOCATION);
+  uint64_t frees_start = heap_calls(tracker::Kind::FREE);
+
+  for (uint64_t i = 0; i < options.warmup + options.cycles; ++i) {
+    const bool measured = i >= options.warmup;
+    if (i == options.warmup) {
+      getrusage(RUSAGE_THREAD, &usage_start);
+      measurement_cpu_start = Now(CLOCK_THREAD_CPUTIME_ID);
+      // Allocations in the first cycles (e.g. lazy initialization) are not checked
+      allocations_start = heap_calls(tracker::Kind::ALLOCATION);
+      frees_start = heap_calls(tracker::Kind::FREE);
+      tracker::Allocation allocation;
+      while (tracker::Pop(allocation)) {
+      }
+    }
+    if (options.paced) {
+      next_cycle += options.cycle_ns;
+      struct timespec wakeup;
+      wakeup.tv_sec = static_cast<time_t>(next_cycle / 1000000000);
+      wakeup.tv_nsec = static_cast<long>(next_cycle % 1000000000);  // NOLINT(runtime/int)
+      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeup, nullptr);
+    }
+
+    const int64_t cpu_before = Now(CLOCK_THREAD_CPUTIME_ID);
+    const rclcpp::Time time(Now(CLOCK_MONOTONIC), RCL_STEADY_TIME);
+    hardware_interface::return_type result;
+    {
+      tracker::ScopedPhase phase(tracker::Phase::READ);
+      result = system.read(time, period);
+    }
+    if (result != hardware_interface::return_type::OK) {
+      ++results.errors;
+      return false;
+    }
+    const int64_t receive = Now(CLOCK_MONOTONIC);
+
+    for (const auto & pair : pairs) {
+      pair.second->set_value(pair.first->get_value());
+    }
+
+    {
+      tracker::ScopedPhase phase(tracker::Phase::WRITE);
+      result = system.write(time, period);
+    }
+    if (result != hardware_interface::return_type::OK) {
+      ++results.errors;
+      return false;
+    }
+    const int64_t reply = Now(CLOCK_MONOTONIC);
+    const int64_t cpu_after = Now(CLOCK_THREAD_CPUTIME_ID);
+
+    if (measured) {
+      ++results.cycles;
+      RecordDuration(results.latency, reply - receive);
+      RecordDuration(results.cpu_time, cpu_after - cpu_before);
+      results.deadline_misses += reply - receive > deadline_ns;
+      if (previous_receive != 0) {
+        RecordDuration(results.period, receive - previous_receive);
+        results.late_cycles += receive - previous_receive > options.cycle_ns * 3 / 2;
+      }
+    }
+    previous_receive = receive;
+  }
+
+  struct rusage usage_end;
+  getrusage(RUSAGE_THREAD, &usage_end);
+  results.total_cpu_ns = Now(CLOCK_THREAD_CPUTIME_ID) - measurement_cpu_start;
+  results.involuntary_switches = usage_end.ru_nivcsw - usage_start.ru_nivcsw;
+  results.allocations = heap_calls(tracker::Kind::ALLOCATION) - allocations_start;
+  results.frees = heap_calls(tracker::Kind::FREE) - frees_start;
+  return true;
+}
+
+// Prints the backtrace of every call site of the allocation functions in the measured cycles
+void PrintAllocations()
+{
+  namespace tracker = kuka_drivers_core::allocation_tracker;
+  std::set<std::vector<void *>> call_sites;
+  tracker::Allocation allocation;
+  while (tracker::Pop(allocation)) {
+    if (call_sites.insert(
+        std::vector<void *>(allocation.frames, allocation.frames + allocation.depth)).second)
+    {
+      fprintf(stderr, "%s\n", tracker::Describe(allocation).c_str());
+    }
+  }
+  if (tracker::Dropped() > 0) {
+    fprintf(
+      stderr, "%" PRIu64 " backtraces were not recorded, the call sites might be incomplete\n",
+      tracker::Dropped());
+  }
+}
+
+void PrintResults(
+  const hardware_interface::HardwareInfo & info, const Options & options,
+  const Results & results, bool completed, bool header)
+{
+  const std::vector<std::pair<const char *, Histogram::Snapshot>> distributions = {
+    {"latency", results.latency.GetSnapshot()},
+    {"period", results.period.GetSnapshot()},
+    {"cpu_time", results.cpu_time.GetSnapshot()}};
+  const double mean_cpu_ns = results.cycles > 0 ?
+    static_cast<double>(results.total_cpu_ns) / static_cast<double>(results.cycles) : 0.0;
+
+  if (options.csv) {
+    if (header) {
+      printf("hardware,plugin,fault_profile,completed,cycle_ns,cycles,deadline_misses,late_cycles,"
+        "errors,cpu_mean_ns,involuntary_switches");
+      if (kuka_drivers_core::allocation_tracker::ENABLED) {
+        printf(",allocations,frees");
+      }
+      for (const auto & distribution : distributions) {
+        printf(
+          ",%s_p50_ns,%s_p99_ns,%s_p999_ns,%s_max_ns", distribution.first, distribution.first,
+          distribution.first, distribution.first);
+      }
+      printf("\n");
+    }
+    printf(
+      "%s,%s,\"%s\",%d,%" PRId64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%.0f,%ld",
+      info.name.c_str(), info.hardware_class_type.c_str(), options.fault_profile.c_str(),
+      completed ? 1 : 0, options.cycle_ns,
+      results.cycles, results.deadline_misses, results.late_cycles, results.errors, mean_cpu_ns,
+      results.involuntary_switches);
+    if (kuka_drivers_core::allocation_tracker::ENABLED) {
+      printf(",%" PRIu64 ",%" PRIu64, results.allocations, results.frees);
+    }
+    for (const auto & distribution : distributions) {
+      const auto & snapshot = distribution.second;
+      printf(
+        ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64, snapshot.Percentile(50),
+        snapshot.Percentile(99), snapshot.Percentile(99.9), snapshot.max_ns);
+    }
+    printf("\n");
+    return;
+  }
+
+  printf(
+    "{\"hardware\": \"%s\", \"plugin\": \"%s\", \"fault_profile\": \"%s\", \"completed\": %s"
+    ", \"cycle_ns\": %" PRId64
+    ", \"cycles\": %" PRIu64 ", \"deadline_misses\": %" PRIu64 ", \"late_cycles\": %" PRIu64
+    ", \"errors\": %" PRIu64 ", \"cpu_mean_ns\": %.0f, \"involuntary_switches\": %ld",
+    info.name.c_str(), info.hardware_class_type.c_str(), options.fault_profile.c_str(),
+    completed ? "true" : "false",
+    options.cycle_ns, results.cycles, results.deadline_misses, results.late_cycles,
+    results.errors, mean_cpu_ns, results.involuntary_switches);
+  if (kuka_drivers_core::allocation_tracker::ENABLED) {
+    printf(
+      ", \"allocations\": %" PRIu64 ", \"frees\": %" PRIu64, results.allocations, results.frees);
+  }
+  for (const auto & distribution : distributions) {
+    const auto & snapshot = distribution.second;
+    printf(
+      ", \"%s_ns\": {\"p50\": %" PRIu64 ", \"p99\": %" PRIu64 ", \"p999\": %" PRIu64
+      ", \"max\": %" PRIu64 "}", distribution.first, snapshot.Percentile(50),
+      snapshot.Percentile(99), snapshot.Percentile(99.9), snapshot.max_ns);
+  }
+  printf("}\n");
+}
+
+// Loads, runs and unloads the hardware once, with the fault profile of the options
+bool RunHardware(
+  const hardware_interface::HardwareInfo & description, const Options & options, bool header)
+{
+  hardware_interface::HardwareInfo info = description;
+  if (!options.fault_profile.empty()) {
+    info.hardware_parameters["fault_profile"] = options.fault_profile;
+  }
+
+  // The loader must outlive the plugin instance
+  pluginlib::ClassLoader<hardware_interface::SystemInterface> loader(
+    "hardware_interface", "hardware_interface::SystemInterface");
+  std::unique_ptr<hardware_interface::System> system;
+  try {
+    system = std::make_unique<hardware_interface::System>(
+      std::unique_ptr<hardware_interface::SystemInterface>(
+        loader.createUnmanagedInstance(info.hardware_class_type)));
+  } catch (const pluginlib::PluginlibException & ex) {
+    fprintf(stderr, "Loading %s failed: %s\n", info.hardware_class_type.c_str(), ex.what());
+    return false;
+  }
+
+  const pid_t simulator = options.simulator.empty() ? 0 : StartSimulator(options.simulator);
+  if (simulator < 0) {
+    fprintf(stderr, "Starting the simulator failed: %s\n", strerror(errno));
+    return false;
+  }
+
+  auto results = std::make_unique<Results>();
+  bool completed = false;
+  using lifecycle_msgs::msg::State;
+  if (system->initialize(info).id() != State::PRIMARY_STATE_UNCONFIGURED) {
+    fprintf(stderr, "Initializing %s failed\n", info.name.c_str());
+  } else if (system->configure().id() != State::PRIMARY_STATE_INACTIVE) {
+    fprintf(stderr, "Configuring %s failed\n", info.name.c_str());
+  } else if (system->activate().id() != State::PRIMARY_STATE_ACTIVE) {
+    fprintf(stderr, "Activating %s failed\n", info.name.c_str());
+  } else {
+    completed = RunCycles(*system, options, *results);
+    system->deactivate();
+    // The last reply carries the stop flag of the drivers
+    const rclcpp::Time time(Now(CLOCK_MONOTONIC), RCL_STEADY_TIME);
+    const rclcpp::Duration period = rclcpp::Duration::from_nanoseconds(options.cycle_ns);
+    if (system->read(time, period) == hardware_interface::return_type::OK) {
+      system->write(time, period);
+    }
+    system->cleanup();
+  }
+  system->shutdown();
+  StopSimulator(simulator);
+
+  PrintResults(info, options, *results, completed, header);
+  if (completed && options.max_allocations >= 0 &&
+    results->allocations + results->frees > static_cast<uint64_t>(options.max_allocations))
+  {
+    fprintf(
+      stderr, "%s: %" PRIu64 " allocations and %" PRIu64 " frees in read() and write(), "
+      "at most %" PRId64 " are allowed\n", info.name.c_str(), results->allocations,
+      results->frees, options.max_allocations);
+    PrintAllocations();
+    return false;
+  }
+  return completed;
+}
+
+// Scenarios of --fault-scenarios, the durations are relative to the cycle time
+std::vector<std::string> FaultScenarios(int64_t cycle_us)
+{
+  const auto us = [cycle_us](int64_t numerator, int64_t denominator) {
+      return std::to_string(cycle_us * numerator / denominator);
+    };
+  return {
+    "",
+    "delay_us=" + us(1, 4),
+    "delay_us=" + us(1, 2),
+    "delay_us=" + us(9, 10),
+    "delay_us=" + us(1, 4) + ",jitter_us=" + us(1, 2),
+    "delay_us=" + us(1, 4) + ",jitter_us=" + us(3, 2),
+    "loss=0.01",
+    "loss=0.05",
+    "loss=0.01,loss_burst=5",
+    "reorder=0.01,reorder_us=" + us(3, 2),
+    "reply_loss=0.01",
+    "reply_loss=0.01,loss=0.01,delay_us=" + us(1, 4) + ",jitter_us=" + us(1, 2)};
+}
+}  // namespace
+
+int main(int argc, char * argv[])
+{
+  static const struct option kOptions[] = {
+    {"urdf", required_argument, nullptr, 'u'},
+    {"hardware", required_argument, nullptr, 'w'},
+    {"simulator", required_argument, nullptr, 's'},
+    {"cycle-us", required_argument, nullptr, 'c'},
+    {"deadline-us", required_argument, nullptr, 'd'},
+    {"cycles", required_argument, nullptr, 'n'},
+    {"warmup", required_argument, nullptr, 'W'},
+    {"paced", no_argument, nullptr, 'P'},
+    {"priority", required_argument, nullptr, 'r'},
+    {"csv", no_argument, nullptr, 'C'},
+    {"fault-profile", required_argument, nullptr, 'f'},
+    {"fault-scenarios", no_argument, nullptr, 'F'},
+    {"max-allocations", required_argument, nullptr, 'A'},
+    {"help", no_argument, nullptr, 'h'},
+    {nullptr, 0, nullptr, 0}};
+
+  Options options;
+  int option;
+  while ((option = getopt_long(argc, argv, "h", kOptions, nullptr)) != -1) {
+    switch (option) {
+      case 'u': options.urdf_path = optarg; break;
+      case 'w': options.hardware_name = optarg; break;
+      case 's': options.simulator = optarg; break;
+      case 'c': options.cycle_ns = std::stoll(optarg) * 1000; break;
+      case 'd': options.deadline_ns = std::stoll(optarg) * 1000; break;
+      case 'n': options.cycles = std::stoull(optarg); break;
+      case 'W': options.warmup = std::stoull(optarg); break;
+      case 'P': options.paced = true; break;
+      case 'r': options.priority = std::stoi(optarg); break;
+      case 'C': options.csv = true; break;
+      case 'f': options.fault_profile = optarg; break;
+      case 'F': options.fault_scenarios = true; break;
+      case 'A': options.max_allocations = std::stoll(optarg); break;
+      default:
+        PrintUsage(argv[0]);
+        return option == 'h' ? 0 : 1;
+    }
+  }
+  if (options.urdf_path.empty() || options.cycle_ns <= 0) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+  if (options.max_allocations >= 0 && !kuka_drivers_core::allocation_tracker::ENABLED) {
+    fprintf(stderr, "--max-allocations needs the TRACK_RT_ALLOCATIONS build option\n");
+    return 1;
+  }
+
+  std::string urdf;
+  if (!ReadFile(options.urdf_path, urdf)) {
+    fprintf(stderr, "Could not read %s\n", options.urdf_path.c_str());
+    return 1;
+  }
+  std::vector<hardware_interface::HardwareInfo> hardware_infos;
+  try {
+    hardware_infos = hardware_interface::parse_control_resources_from_urdf(urdf);
+  } catch (const std::exception & ex) {
+    fprintf(stderr, "Invalid robot description: %s\n", ex.what());
+    return 1;
+  }
+  const hardware_interface::HardwareInfo * info = nullptr;
+  for (const auto & hardware_info : hardware_infos) {
+    if (hardware_info.type == "system" &&
+      (options.hardware_name.empty() || hardware_info.name == options.hardware_name))
+    {
+      info = &hardware_info;
+      break;
+    }
+  }
+  if (info == nullptr) {
+    fprintf(stderr, "No matching system hardware in %s\n", options.urdf_path.c_str());
+    return 1;
+  }
+
+  if (options.priority > 0) {
+    struct sched_param param;
+    param.sched_priority = options.priority;
+    if (sched_setscheduler(0, SCHED_FIFO, &param) == -1) {
+      fprintf(stderr, "Setting SCHED_FIFO priority failed: %s\n", strerror(errno));
+      return 1;
+    }
+  }
+
+  if (!options.fault_scenarios) {
+    return RunHardware(*info, options, true) ? 0 : 1;
+  }
+  // The hardware and the simulator are restarted for every scenario, a failed scenario does not
+  //  stop the others
+  bool completed = true;
+  bool header = true;
+  for (const auto & profile : FaultScenarios(options.cycle_ns / 1000)) {
+    options.fault_profile = profile;
+    completed &= RunHardware(*info, options, header);
+    header = false;
+    fflush(stdout);
+  }
+  return completed ? 0 : 1;
+}
\ No newline at end of file
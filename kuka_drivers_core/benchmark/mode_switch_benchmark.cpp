@@ -0,0 +1,354 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// End-to-end benchmark of the control mode switch of a running driver: the mode parameter of the
+// robot manager is switched back and forth through its set_parameters service, and the phases of
+// every switch published by the SwitchTrace of the robot manager (controller lists, controller
+// switch, events of the robot controller) are collected. With the mode log of a simulator
+// (mock_controller of the EAC driver, fri_simulator) the first command received in the new mode
+// closes the switch. All timestamps are on the steady clock of the host, the time of each phase
+// from the request is printed with its distribution over the switches as JSON or CSV.
+
+#include <getopt.h>
+#include <time.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "diagnostic_msgs/msg/diagnostic_status.hpp"
+#include "rclcpp/rclcpp.hpp"
+
+#include "kuka_drivers_core/latency_histogram.hpp"
+
+namespace
+{
+// 100 us buckets up to 2 s, a switch waits for the robot controller for up to 2 s
+using Histogram = kuka_drivers_core::LatencyHistogram<20000, 100000>;
+
+struct Options
+{
+  std::string node = "robot_manager";
+  std::string parameter = "control_mode";
+  std::vector<std::string> values = {"1", "2"};
+  std::string mode_log;
+  uint64_t switches = 20;
+  int64_t settle_ms = 500;
+  int64_t timeout_ms = 5000;
+  bool csv = false;
+};
+
+struct Phase
+{
+  std::string name;
+  int64_t stamp_ns;
+};
+
+void PrintUsage(const char * program)
+{
+  printf(
+    "Usage: %s [options]\n"
+    "  --node <name>        robot manager node (default: robot_manager)\n"
+    "  --parameter <name>   mode parameter switched (default: control_mode)\n"
+    "  --values <a,b,...>   values set one after another, the first one before the measurement;\n"
+    "                       integers and true/false are sent as such, e.g. position,torque for\n"
+    "                       the command_mode of the FRI driver (default: 1,2)\n"
+    "  --switches <n>       number of measured switches (default: 20)\n"
+    "  --settle-ms <ms>     time after each switch for the late events (default: 500)\n"
+    "  --timeout-ms <ms>    maximal time of a set_parameters call (default: 5000)\n"
+    "  --mode-log <file>    mode log of the simulator, the first command in the new mode is\n"
+    "                       reported as the first_command phase\n"
+    "  --csv                print a CSV header and a row per phase instead of JSON\n", program);
+}
+
+int64_t Now()
+{
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return static_cast<int64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+}
+
+std::vector<std::string> Split(const std::string & list)
+{
+  std::vector<std::string> values;
+  std::stringstream stream(list);
+  std::string value;
+  while (std::getline(stream, value, ',')) {
+    if (!value.empty()) {
+      values.push_back(value);
+    }
+  }
+  return values;
+}
+
+rclcpp::Parameter MakeParameter(const std::string & name, const std::string & value)
+{
+  char * end = nullptr;
+  const int64_t integer = std::strtoll(value.c_str(), &end, 10);
+  if (end != value.c_str() && *end == '\0') {
+    return rclcpp::Parameter(name, integer);
+  }
+  if (value == "true" || value == "false") {
+    return rclcpp::Parameter(name, value == "true");
+  }
+  return rclcpp::Parameter(name, value);
+}
+
+// First entry of the mode log in [begin_ns, end_ns), 0 if there is none
+int64_t FirstCommand(const std::string & path, int64_t begin_ns, int64_t end_ns)
+{
+  std::ifstream file(path);
+  int64_t stamp_ns;
+  int mode;
+  while (file >> stamp_ns >> mode) {
+    if (stamp_ns >= begin_ns && stamp_ns < end_ns) {
+      return stamp_ns;
+    }
+  }
+  return 0;
+}
+
+class PhaseCollector
+{
+public:
+  PhaseCollector(rclcpp::Node::SharedPtr node, const std::string & robot_manager)
+  {
+    subscription_ = node->create_subscription<diagnostic_msgs::msg::DiagnosticStatus>(
+      robot_manager + "/mode_switch_trace", rclcpp::QoS(rclcpp::KeepLast(100)).reliable(),
+      [this](diagnostic_msgs::msg::DiagnosticStatus::SharedPtr status) {
+        Phase phase{"", 0};
+        for (const auto & value : status->values) {
+          if (value.key == "phase") {
+            phase.name = value.value;
+          } else if (value.key == "stamp_ns") {
+            phase.stamp_ns = std::stoll(value.value);
+          }
+        }
+        std::lock_guard<std::mutex> lk(mutex_);
+        phases_.push_back(phase);
+      });
+  }
+
+  std::vector<Phase> Take()
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    std::vector<Phase> phases;
+    phases.swap(phases_);
+    return phases;
+  }
+
+private:
+  rclcpp::Subscription<diagnostic_msgs::msg::DiagnosticStatus>::SharedPtr subscription_;
+  std::mutex mutex_;
+  std::vector<Phase> phases_;
+};
+
+// Sets the parameter, returns false with the reason in error if it was not successful
+bool SetMode(
+  rclcpp::AsyncParametersClient & client, const Options & options, const std::string & value,
+  std::string & error)
+{
+  auto future = client.set_parameters({MakeParameter(options.parameter, value)});
+  if (future.wait_for(std::chrono::milliseconds(options.timeout_ms)) !=
+    std::future_status::ready)
+  {
+    error = "timeout";
+    return false;
+  }
+  const auto results = future.get();
+  if (results.empty() || !results.front().successful) {
+    error = results.empty() ? "no result" : results.front().reason;
+    return false;
+  }
+  return true;
+}
+
+void PrintResults(
+  const Options & options, uint64_t switches, uint64_t failed,
+  const std::map<std::string, std::unique_ptr<Histogram>> & phases)
+{
+  // In the order of their median, which is the order of the phases in a typical switch
+  std::vector<std::pair<std::string, Histogram::Snapshot>> snapshots;
+  for (const auto & phase : phases) {
+    snapshots.emplace_back(phase.first, phase.second->GetSnapshot());
+  }
+  std::stable_sort(
+    snapshots.begin(), snapshots.end(), [](const auto & a, const auto & b) {
+      return a.second.Percentile(50) < b.second.Percentile(50);
+    });
+
+  if (options.csv) {
+    printf("node,parameter,switches,failed,phase,count,p50_ns,p90_ns,max_ns\n");
+    for (const auto & phase : snapshots) {
+      const auto & snapshot = phase.second;
+      printf(
+        "%s,%s,%" PRIu64 ",%" PRIu64 ",%s,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 "\n",
+        options.node.c_str(), options.parameter.c_str(), switches, failed, phase.first.c_str(),
+        snapshot.count, snapshot.Percentile(50), snapshot.Percentile(90), snapshot.max_ns);
+    }
+    return;
+  }
+
+  printf(
+    "{\"node\": \"%s\", \"parameter\": \"%s\", \"switches\": %" PRIu64 ", \"failed\": %" PRIu64
+    ", \"phases_ns\": {", options.node.c_str(), options.parameter.c_str(), switches, failed);
+  for (std::size_t i = 0; i < snapshots.size(); ++i) {
+    const auto & snapshot = snapshots[i].second;
+    printf(
+      "%s\"%s\": {\"count\": %" PRIu64 ", \"p50\": %" PRIu64 ", \"p90\": %" PRIu64
+      ", \"max\": %" PRIu64 "}", i == 0 ? "" : ", ", snapshots[i].first.c_str(), snapshot.count,
+      snapshot.Percentile(50), snapshot.Percentile(90), snapshot.max_ns);
+  }
+  printf("}}\n");
+}
+}  // namespace
+
+int main(int argc, char * argv[])
+{
+  static const struct option kOptions[] = {
+    {"node", required_argument, nullptr, 'N'},
+    {"parameter", required_argument, nullptr, 'p'},
+    {"values", required_argument, nullptr, 'v'},
+    {"switches", required_argument, nullptr, 'n'},
+    {"settle-ms", required_argument, nullptr, 's'},
+    {"timeout-ms", required_argument, nullptr, 't'},
+    {"mode-log", required_argument, nullptr, 'l'},
+    {"csv", no_argument, nullptr, 'C'},
+    {"help", no_argument, nullptr, 'h'},
+    {nullptr, 0, nullptr, 0}};
+
+  // The ROS arguments are removed before the options are parsed
+  const auto arguments = rclcpp::init_and_remove_ros_arguments(argc, argv);
+  std::vector<char *> args;
+  for (const auto & argument : arguments) {
+    args.push_back(const_cast<char *>(argument.c_str()));
+  }
+  args.push_back(nullptr);
+
+  Options options;
+  int option;
+  while ((option = getopt_long(
+      static_cast<int>(arguments.size()), args.data(), "h", kOptions, nullptr)) != -1)
+  {
+    switch (option) {
+      case 'N': options.node = optarg; break;
+      case 'p': options.parameter = optarg; break;
+      case 'v': options.values = Split(optarg); break;
+      case 'n': options.switches = std::stoull(optarg); break;
+      case 's': options.settle_ms = std::stoll(optarg); break;
+      case 't': options.timeout_ms = std::stoll(optarg); break;
+      case 'l': options.mode_log = optarg; break;
+      case 'C': options.csv = true; break;
+      default:
+        PrintUsage(argv[0]);
+        rclcpp::shutdown();
+        return option == 'h' ? 0 : 1;
+    }
+  }
+  if (options.values.size() < 2 || options.settle_ms < 0 || options.timeout_ms <= 0) {
+    PrintUsage(argv[0]);
+    rclcpp::shutdown();
+    return 1;
+  }
+
+  auto node = std::make_shared<rclcpp::Node>("mode_switch_benchmark");
+  PhaseCollector collector(node, options.node);
+  auto client = std::make_shared<rclcpp::AsyncParametersClient>(node, options.node);
+  rclcpp::executors::SingleThreadedExecutor executor;
+  executor.add_node(node);
+  std::thread spin_thread([&executor]() {executor.spin();});
+
+  int result = 0;
+  std::string error;
+  if (!client->wait_for_service(std::chrono::seconds(5))) {
+    fprintf(stderr, "The parameter services of %s are not available\n", options.node.c_str());
+    result = 1;
+  } else if (!SetMode(*client, options, options.values.front(), error)) {
+    fprintf(
+      stderr, "Setting the initial %s %s failed: %s\n", options.parameter.c_str(),
+      options.values.front().c_str(), error.c_str());
+    result = 1;
+  } else {
+    std::this_thread::sleep_for(std::chrono::milliseconds(options.settle_ms));
+  }
+
+  std::map<std::string, std::unique_ptr<Histogram>> phases;
+  const auto record = [&phases](const std::string & phase, int64_t duration_ns) {
+      auto & histogram = phases[phase];
+      if (!histogram) {
+        histogram = std::make_unique<Histogram>();
+      }
+      histogram->Record(duration_ns > 0 ? static_cast<uint64_t>(duration_ns) : 0);
+    };
+
+  uint64_t switches = 0;
+  uint64_t failed = 0;
+  for (uint64_t i = 0; result == 0 && i < options.switches; ++i) {
+    // Late events of the previous switch are not part of this one
+    collector.Take();
+    const std::string & value = options.values[(i + 1) % options.values.size()];
+
+    const int64_t request_ns = Now();
+    const bool successful = SetMode(*client, options, value, error);
+    const int64_t response_ns = Now();
+    ++switches;
+    if (!successful) {
+      ++failed;
+      fprintf(
+        stderr, "Switch %" PRIu64 " to %s failed: %s\n", i, value.c_str(), error.c_str());
+      continue;
+    }
+    record("response", response_ns - request_ns);
+
+    // The events of the robot controller can arrive after the response
+    std::this_thread::sleep_for(std::chrono::milliseconds(options.settle_ms));
+    const int64_t end_ns = Now();
+    std::vector<std::string> seen;
+    for (const auto & phase : collector.Take()) {
+      // Repeated events (e.g. sampling) are counted at their first occurrence
+      if (phase.stamp_ns < request_ns ||
+        std::find(seen.begin(), seen.end(), phase.name) != seen.end())
+      {
+        continue;
+      }
+      seen.push_back(phase.name);
+      record(phase.name, phase.stamp_ns - request_ns);
+    }
+    if (!options.mode_log.empty()) {
+      const int64_t first_command_ns = FirstCommand(options.mode_log, request_ns, end_ns);
+      if (first_command_ns != 0) {
+        record("first_command", first_command_ns - request_ns);
+      }
+    }
+  }
+
+  executor.cancel();
+  spin_thread.join();
+  if (result == 0) {
+    PrintResults(options, switches, failed, phases);
+  }
+  rclcpp::shutdown();
+  return result != 0 ? result : (failed > 0 ? 2 : 0);
+}
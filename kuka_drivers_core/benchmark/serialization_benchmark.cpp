@@ -0,0 +1,92 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "communication_helpers/serialization.hpp"
+
+namespace
+{
+// The serialization used before the buffer writer (insert and reverse per value on a little
+//   endian host), kept as reference
+void legacySerialize(double value, std::vector<std::uint8_t> & serialized_out)
+{
+  std::uint8_t * bytes = reinterpret_cast<std::uint8_t *>(&value);
+  serialized_out.insert(serialized_out.end(), bytes, bytes + sizeof(double));
+  auto from_it = std::prev(serialized_out.end(), sizeof(double));
+  std::reverse(from_it, serialized_out.end());
+}
+
+// Stiffness and damping values of the joint impedance control mode command
+const std::vector<double> kValues = {
+  1000.0, 1000.0, 1000.0, 1000.0, 1000.0, 1000.0, 1000.0, 0.7, 0.7, 0.7, 0.7, 0.7, 0.7, 0.7};
+
+void BM_SerializeLegacy(benchmark::State & state)
+{
+  // Allocated once, as the buffer writer does not allocate either, only the insertion is timed
+  std::vector<std::uint8_t> legacy;
+  legacy.reserve(kValues.size() * sizeof(double));
+  for (auto _ : state) {
+    legacy.clear();
+    for (double value : kValues) {
+      legacySerialize(value, legacy);
+    }
+    benchmark::DoNotOptimize(legacy.data());
+  }
+}
+BENCHMARK(BM_SerializeLegacy);
+
+void BM_SerializeBufferWriter(benchmark::State & state)
+{
+  std::uint8_t buffer[14 * sizeof(double)];
+  for (auto _ : state) {
+    kuka_drivers_core::BufferWriter writer(buffer);
+    for (double value : kValues) {
+      writer.writeDouble(value);
+    }
+    benchmark::DoNotOptimize(buffer);
+  }
+
+  std::vector<std::uint8_t> legacy;
+  for (double value : kValues) {
+    legacySerialize(value, legacy);
+  }
+  if (!std::equal(legacy.begin(), legacy.end(), buffer)) {
+    state.SkipWithError("The serialized bytes differ from the legacy serialization");
+  }
+}
+BENCHMARK(BM_SerializeBufferWriter);
+
+void BM_DeserializeBufferReader(benchmark::State & state)
+{
+  std::uint8_t buffer[14 * sizeof(double)];
+  kuka_drivers_core::BufferWriter writer(buffer);
+  for (double value : kValues) {
+    writer.writeDouble(value);
+  }
+  for (auto _ : state) {
+    kuka_drivers_core::BufferReader reader(buffer, sizeof(buffer));
+    double value = 0;
+    while (reader.readDouble(value)) {
+      benchmark::DoNotOptimize(value);
+    }
+  }
+}
+BENCHMARK(BM_DeserializeBufferReader);
+}  // namespace
+
+BENCHMARK_MAIN();
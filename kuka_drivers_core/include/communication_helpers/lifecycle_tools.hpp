@@ -0,0 +1,237 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef COMMUNICATION_HELPERS__LIFECYCLE_TOOLS_HPP_
+#define COMMUNICATION_HELPERS__LIFECYCLE_TOOLS_HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rclcpp/rclcpp.hpp"
+#include "lifecycle_msgs/msg/transition.hpp"
+#include "lifecycle_msgs/srv/change_state.hpp"
+#include "communication_helpers/service_tools.hpp"
+
+namespace kuka_drivers_core
+{
+/**
+ * @brief Brings up several lifecycle nodes (e.g. the robot managers of a cell) concurrently
+ *
+ * Every node runs the given transitions in order. A transition of a node is requested as soon
+ *  as the node finished its previous transition and its dependencies finished the same one,
+ *  so independent nodes are transitioned at the same time and a node can already be
+ *  activated while an unrelated one is still configuring. After a failed or timed out
+ *  transition no new requests are sent, the running ones are awaited.
+ */
+class LifecycleBringUp
+{
+public:
+  struct StepResult
+  {
+    std::string node;
+    uint8_t transition;
+    bool ok;
+    std::chrono::steady_clock::duration duration;
+  };
+
+  explicit LifecycleBringUp(const rclcpp::Node::SharedPtr & node)
+  : node_(node)
+  {
+  }
+
+  // The dependencies must also be added, their transitions are completed before the ones of
+  //  the node
+  void addNode(const std::string & name, const std::vector<std::string> & dependencies = {})
+  {
+    Target target;
+    target.name = name;
+    target.dependencies = dependencies;
+    target.client =
+      node_->create_client<lifecycle_msgs::srv::ChangeState>(name + "/change_state");
+    targets_.push_back(std::move(target));
+  }
+
+  // Run the transitions (e.g. TRANSITION_CONFIGURE, TRANSITION_ACTIVATE) on all nodes,
+  //  returns false if any of them failed or did not finish within the timeout
+  bool execute(const std::vector<uint8_t> & transitions, int timeout_ms = 10000)
+  {
+    results_.clear();
+    if (!resolveDependencies()) {
+      return false;
+    }
+    const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    for (auto & target : targets_) {
+      target.step = 0;
+      target.call.reset();
+      const auto time_left = deadline - std::chrono::steady_clock::now();
+      if (!target.client->wait_for_service(std::max(time_left, decltype(time_left)::zero()))) {
+        RCLCPP_ERROR(
+          node_->get_logger(), "Lifecycle service of %s is not available", target.name.c_str());
+        return false;
+      }
+    }
+
+    bool failed = false;
+    std::size_t in_flight = 0;
+    while (true) {
+      if (!failed) {
+        for (auto & target : targets_) {
+          if (target.call == nullptr && target.step < transitions.size() &&
+            isReady(target))
+          {
+            send(target, transitions[target.step]);
+            ++in_flight;
+          }
+        }
+      }
+      if (in_flight == 0) {
+        break;
+      }
+
+      uint64_t completions;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        condition_.wait_until(lock, deadline, [this]() {return completions_ > handled_;});
+        completions = completions_;
+      }
+      const bool timed_out = std::chrono::steady_clock::now() >= deadline;
+      for (auto & target : targets_) {
+        if (target.call == nullptr) {
+          continue;
+        }
+        if (!target.call->done()) {
+          if (!timed_out) {
+            continue;
+          }
+          RCLCPP_ERROR(
+            node_->get_logger(), "Transition %u of %s timed out",
+            static_cast<unsigned int>(transitions[target.step]), target.name.c_str());
+          target.call->cancel();
+        }
+        failed = !finish(target, transitions[target.step]) || failed;
+        --in_flight;
+      }
+      // Completions arriving during the scan wake up the next wait immediately
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        handled_ = completions;
+      }
+    }
+
+    if (!failed) {
+      for (const auto & target : targets_) {
+        if (target.step < transitions.size()) {
+          RCLCPP_ERROR(
+            node_->get_logger(), "%s is blocked by a dependency cycle", target.name.c_str());
+          failed = true;
+        }
+      }
+    }
+    return !failed;
+  }
+
+  const std::vector<StepResult> & results() const {return results_;}
+
+private:
+  struct Target
+  {
+    std::string name;
+    std::vector<std::string> dependencies;
+    rclcpp::Client<lifecycle_msgs::srv::ChangeState>::SharedPtr client;
+    std::vector<const Target *> resolved_dependencies;
+    std::size_t step = 0;
+    std::shared_ptr<ServiceCall<lifecycle_msgs::srv::ChangeState>> call;
+    std::chrono::steady_clock::time_point start;
+  };
+
+  bool resolveDependencies()
+  {
+    for (auto & target : targets_) {
+      target.resolved_dependencies.clear();
+      for (const auto & dependency : target.dependencies) {
+        auto it = std::find_if(
+          targets_.begin(), targets_.end(),
+          [&dependency](const Target & other) {return other.name == dependency;});
+        if (it == targets_.end()) {
+          RCLCPP_ERROR(
+            node_->get_logger(), "Unknown dependency %s of %s", dependency.c_str(),
+            target.name.c_str());
+          return false;
+        }
+        target.resolved_dependencies.push_back(&*it);
+      }
+    }
+    return true;
+  }
+
+  bool isReady(const Target & target) const
+  {
+    return std::all_of(
+      target.resolved_dependencies.begin(), target.resolved_dependencies.end(),
+      [&target](const Target * dependency) {return dependency->step > target.step;});
+  }
+
+  void send(Target & target, uint8_t transition)
+  {
+    auto request = std::make_shared<lifecycle_msgs::srv::ChangeState::Request>();
+    request->transition.id = transition;
+    target.start = std::chrono::steady_clock::now();
+    // Only counts the completions, the results are collected by execute()
+    target.call = sendRequestAsync(
+      target.client, request,
+      [this](std::shared_ptr<lifecycle_msgs::srv::ChangeState::Response>) {
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          ++completions_;
+        }
+        condition_.notify_all();
+      });
+  }
+
+  bool finish(Target & target, uint8_t transition)
+  {
+    const auto response = target.call->response();
+    const bool ok = response != nullptr && response->success;
+    const auto duration = std::chrono::steady_clock::now() - target.start;
+    results_.push_back(StepResult{target.name, transition, ok, duration});
+    RCLCPP_INFO(
+      node_->get_logger(), "Transition %u of %s %s in %.1f ms",
+      static_cast<unsigned int>(transition), target.name.c_str(), ok ? "succeeded" : "failed",
+      std::chrono::duration<double, std::milli>(duration).count());
+    target.call.reset();
+    if (ok) {
+      ++target.step;
+    }
+    return ok;
+  }
+
+  rclcpp::Node::SharedPtr node_;
+  std::vector<Target> targets_;
+  std::vector<StepResult> results_;
+
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  uint64_t completions_ = 0;
+  uint64_t handled_ = 0;
+};
+}  // namespace kuka_drivers_core
+
+#endif  // COMMUNICATION_HELPERS__LIFECYCLE_TOOLS_HPP_
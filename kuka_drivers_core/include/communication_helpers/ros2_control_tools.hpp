@@ -15,6 +15,8 @@
 #ifndef COMMUNICATION_HELPERS__ROS2_CONTROL_TOOLS_HPP_
 #define COMMUNICATION_HELPERS__ROS2_CONTROL_TOOLS_HPP_
 
+#include <chrono>
+#include <functional>
 #include <string>
 #include <vector>
 #include <memory>
@@ -35,19 +37,16 @@ bool changeHardwareState(
     std::make_shared<controller_manager_msgs::srv::SetHardwareComponentState::Request>();
   hw_request->name = hardware_name;
   hw_request->target_state.id = state;
-  auto hw_response = sendRequest<controller_manager_msgs::srv::SetHardwareComponentState::Response>(
-    client, hw_request, 0, timeout_ms);
-  if (!hw_response || !hw_response->ok) {
-    return false;
-  }
-  return true;
+  auto call = sendRequestAsync(client, hw_request);
+  return call->waitFor(std::chrono::milliseconds(timeout_ms)) && call->response()->ok;
 }
 
 bool changeControllerState(
   rclcpp::Client<controller_manager_msgs::srv::SwitchController>::SharedPtr client,
   const std::vector<std::string> & activate_controllers,
   const std::vector<std::string> & deactivate_controllers,
-  int32_t strictness = controller_manager_msgs::srv::SwitchController::Request::STRICT)
+  int32_t strictness = controller_manager_msgs::srv::SwitchController::Request::STRICT,
+  int timeout_ms = 2000)
 {
   auto controller_request =
     std::make_shared<controller_manager_msgs::srv::SwitchController::Request>();
@@ -55,13 +54,142 @@ bool changeControllerState(
   controller_request->activate_controllers = activate_controllers;
   controller_request->deactivate_controllers = deactivate_controllers;
 
-  auto controller_response = sendRequest<controller_manager_msgs::srv::SwitchController::Response>(
-    client, controller_request, 0, 2000);
-  if (!controller_response || !controller_response->ok) {
-    return false;
-  }
-  return true;
+  auto call = sendRequestAsync(client, controller_request);
+  return call->waitFor(std::chrono::milliseconds(timeout_ms)) && call->response()->ok;
 }
+
+/**
+ * @brief Hardware and controller state changes of a lifecycle transition, grouped into phases
+ *
+ * The requests of a phase are independent of each other, they are sent together and their
+ *  responses are awaited together, so a phase takes one round trip to the controller manager
+ *  instead of one per request. The phases are executed in order, execution stops at the first
+ *  failed request. The duration of every phase is logged and available in the results.
+ */
+class ControlTransition
+{
+public:
+  struct PhaseResult
+  {
+    std::string name;
+    bool ok;
+    std::chrono::steady_clock::duration duration;
+  };
+
+  explicit ControlTransition(const rclcpp::Logger & logger)
+  : logger_(logger)
+  {
+  }
+
+  // Start a new phase, the following requests are sent after the previous phase succeeded
+  ControlTransition & phase(const std::string & name)
+  {
+    phases_.push_back(Phase{name, {}});
+    return *this;
+  }
+
+  ControlTransition & changeHardwareState(
+    rclcpp::Client<controller_manager_msgs::srv::SetHardwareComponentState>::SharedPtr client,
+    const std::string & hardware_name, uint8_t state, int timeout_ms = 2000)
+  {
+    auto request =
+      std::make_shared<controller_manager_msgs::srv::SetHardwareComponentState::Request>();
+    request->name = hardware_name;
+    request->target_state.id = state;
+    addRequest(client, request, timeout_ms, "Changing the state of " + hardware_name);
+    return *this;
+  }
+
+  // A single request activates and deactivates the controllers in the same update cycle,
+  //  empty switches are skipped
+  ControlTransition & changeControllerState(
+    rclcpp::Client<controller_manager_msgs::srv::SwitchController>::SharedPtr client,
+    const std::vector<std::string> & activate_controllers,
+    const std::vector<std::string> & deactivate_controllers,
+    int32_t strictness = controller_manager_msgs::srv::SwitchController::Request::STRICT,
+    int timeout_ms = 2000)
+  {
+    if (activate_controllers.empty() && deactivate_controllers.empty()) {
+      return *this;
+    }
+    auto request = std::make_shared<controller_manager_msgs::srv::SwitchController::Request>();
+    request->strictness = strictness;
+    request->activate_controllers = activate_controllers;
+    request->deactivate_controllers = deactivate_controllers;
+    addRequest(client, request, timeout_ms, "Switching controllers");
+    return *this;
+  }
+
+  // Execute the phases in order, returns false at the first failed request
+  bool execute()
+  {
+    results_.clear();
+    for (auto & phase : phases_) {
+      const auto start = std::chrono::steady_clock::now();
+      std::vector<std::function<bool()>> responses;
+      responses.reserve(phase.requests.size());
+      for (auto & send : phase.requests) {
+        responses.push_back(send());
+      }
+      // All responses are awaited, so that no request is left pending after a failure
+      bool ok = true;
+      for (auto & response : responses) {
+        ok = response() && ok;
+      }
+      const auto duration = std::chrono::steady_clock::now() - start;
+      results_.push_back(PhaseResult{phase.name, ok, duration});
+      RCLCPP_INFO(
+        logger_, "Phase '%s' %s in %.1f ms (%zu requests)", phase.name.c_str(),
+        ok ? "succeeded" : "failed",
+        std::chrono::duration<double, std::milli>(duration).count(), phase.requests.size());
+      if (!ok) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  const std::vector<PhaseResult> & results() const {return results_;}
+
+private:
+  struct Phase
+  {
+    std::string name;
+    // Sends the request and returns the function awaiting its response
+    std::vector<std::function<std::function<bool()>()>> requests;
+  };
+
+  template<typename ClientT, typename RequestT>
+  void addRequest(
+    ClientT client, RequestT request, int timeout_ms, const std::string & description)
+  {
+    if (phases_.empty()) {
+      phase("transition");
+    }
+    auto logger = logger_;
+    phases_.back().requests.push_back(
+      [client, request, timeout_ms, description, logger]() -> std::function<bool()> {
+        const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+        auto call = sendRequestAsync(client, request);
+        return [call, deadline, description, logger]() {
+                 if (!call->waitUntil(deadline)) {
+                   RCLCPP_ERROR(logger, "%s timed out", description.c_str());
+                   return false;
+                 }
+                 if (!call->response()->ok) {
+                   RCLCPP_ERROR(logger, "%s was rejected", description.c_str());
+                   return false;
+                 }
+                 return true;
+               };
+      });
+  }
+
+  rclcpp::Logger logger_;
+  std::vector<Phase> phases_;
+  std::vector<PhaseResult> results_;
+};
 }  // namespace kuka_drivers_core
 
 #endif  // COMMUNICATION_HELPERS__ROS2_CONTROL_TOOLS_HPP_
@@ -15,58 +15,224 @@
 #ifndef COMMUNICATION_HELPERS__SERIALIZATION_HPP_
 #define COMMUNICATION_HELPERS__SERIALIZATION_HPP_
 
-#include <vector>
+#include <cstddef>
 #include <cstdint>
-#include <algorithm>
+#include <cstring>
+#include <vector>
 
 namespace kuka_drivers_core
 {
+// The FRI TCP protocol uses the big endian order of Java streams
+enum class ByteOrder
+{
+  BIG,
+  LITTLE
+};
+
+/**
+ * @brief Writes values with an explicit byte order into a fixed buffer
+ *
+ * The byte order does not depend on the host. A value that does not fit into the rest of the
+ *  buffer is not written and the writer fails, the following writes are ignored.
+ */
+class BufferWriter
+{
+public:
+  constexpr BufferWriter(
+    std::uint8_t * data, std::size_t capacity, ByteOrder order = ByteOrder::BIG)
+  : data_(data), capacity_(capacity), order_(order)
+  {
+  }
+
+  template<std::size_t N>
+  constexpr explicit BufferWriter(std::uint8_t (& data)[N], ByteOrder order = ByteOrder::BIG)
+  : BufferWriter(data, N, order)
+  {
+  }
+
+  constexpr bool writeUint8(std::uint8_t value) {return writeUnsigned(value, 1);}
+  constexpr bool writeUint16(std::uint16_t value) {return writeUnsigned(value, 2);}
+  constexpr bool writeUint32(std::uint32_t value) {return writeUnsigned(value, 4);}
+  constexpr bool writeUint64(std::uint64_t value) {return writeUnsigned(value, 8);}
+  constexpr bool writeInt32(std::int32_t value)
+  {
+    return writeUnsigned(static_cast<std::uint32_t>(value), 4);
+  }
+
+  bool writeDouble(double value)
+  {
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return writeUnsigned(bits, 8);
+  }
+
+  // Raw bytes, e.g. a header, are copied without reordering
+  constexpr bool writeBytes(const std::uint8_t * bytes, std::size_t count)
+  {
+    if (!reserve(count)) {
+      return false;
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+      data_[size_ + i] = bytes[i];
+    }
+    size_ += count;
+    return true;
+  }
+
+  constexpr std::size_t size() const {return size_;}
+  constexpr bool ok() const {return ok_;}
+
+private:
+  constexpr bool reserve(std::size_t count)
+  {
+    ok_ = ok_ && count <= capacity_ - size_;
+    return ok_;
+  }
+
+  constexpr bool writeUnsigned(std::uint64_t value, std::size_t count)
+  {
+    if (!reserve(count)) {
+      return false;
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+      const std::size_t shift = 8 * (order_ == ByteOrder::BIG ? count - 1 - i : i);
+      data_[size_ + i] = static_cast<std::uint8_t>(value >> shift);
+    }
+    size_ += count;
+    return true;
+  }
+
+  std::uint8_t * data_;
+  std::size_t capacity_;
+  std::size_t size_ = 0;
+  ByteOrder order_;
+  bool ok_ = true;
+};
+
+/**
+ * @brief Reads values with an explicit byte order from a buffer
+ *
+ * A value that is longer than the rest of the buffer is not read and the reader fails, the
+ *  following reads are ignored.
+ */
+class BufferReader
+{
+public:
+  constexpr BufferReader(
+    const std::uint8_t * data, std::size_t size, ByteOrder order = ByteOrder::BIG)
+  : data_(data), size_(size), order_(order)
+  {
+  }
+
+  constexpr bool readUint8(std::uint8_t & value) {return readUnsigned(value, 1);}
+  constexpr bool readUint16(std::uint16_t & value) {return readUnsigned(value, 2);}
+  constexpr bool readUint32(std::uint32_t & value) {return readUnsigned(value, 4);}
+  constexpr bool readUint64(std::uint64_t & value) {return readUnsigned(value, 8);}
+  constexpr bool readInt32(std::int32_t & value)
+  {
+    std::uint32_t bits = 0;
+    if (!readUnsigned(bits, 4)) {
+      return false;
+    }
+    // Two's complement conversion without implementation defined narrowing
+    value = bits < 0x80000000u ? static_cast<std::int32_t>(bits) :
+      -static_cast<std::int32_t>(~bits) - 1;
+    return true;
+  }
+
+  bool readDouble(double & value)
+  {
+    std::uint64_t bits = 0;
+    if (!readUnsigned(bits, 8)) {
+      return false;
+    }
+    std::memcpy(&value, &bits, sizeof(value));
+    return true;
+  }
+
+  constexpr bool skip(std::size_t count)
+  {
+    if (!available(count)) {
+      return false;
+    }
+    position_ += count;
+    return true;
+  }
+
+  constexpr std::size_t position() const {return position_;}
+  constexpr std::size_t remaining() const {return size_ - position_;}
+  constexpr bool ok() const {return ok_;}
+
+private:
+  constexpr bool available(std::size_t count)
+  {
+    ok_ = ok_ && count <= size_ - position_;
+    return ok_;
+  }
+
+  template<typename T>
+  constexpr bool readUnsigned(T & value, std::size_t count)
+  {
+    if (!available(count)) {
+      return false;
+    }
+    std::uint64_t result = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+      const std::size_t shift = 8 * (order_ == ByteOrder::BIG ? count - 1 - i : i);
+      result |= static_cast<std::uint64_t>(data_[position_ + i]) << shift;
+    }
+    value = static_cast<T>(result);
+    position_ += count;
+    return true;
+  }
+
+  const std::uint8_t * data_;
+  std::size_t size_;
+  std::size_t position_ = 0;
+  ByteOrder order_;
+  bool ok_ = true;
+};
+
+static_assert(sizeof(int) == 4, "The serialized integers have 4 bytes");
 
-int serializeNext(int integer_in, std::vector<std::uint8_t> & serialized_out)
+// Appends the value in big endian order, returns the number of bytes written
+inline int serializeNext(int integer_in, std::vector<std::uint8_t> & serialized_out)
 {
-  std::uint8_t * bytes = reinterpret_cast<std::uint8_t *>(&integer_in);
-  auto it = serialized_out.end();
-  serialized_out.insert(it, bytes, bytes + sizeof(int));
-
-  // Redefine iterator because of possible invalidation
-  auto from_it = std::prev(serialized_out.end(), sizeof(int));
-  std::reverse(from_it, serialized_out.end());
-  // TODO(resizoltan): assert that int is 4 bytes long
-  // TODO(resizoltan): check endiannes
-  return sizeof(int);
+  const std::size_t offset = serialized_out.size();
+  serialized_out.resize(offset + sizeof(std::int32_t));
+  BufferWriter writer(serialized_out.data() + offset, sizeof(std::int32_t));
+  writer.writeInt32(integer_in);
+  return sizeof(std::int32_t);
 }
 
-int deserializeNext(const std::vector<std::uint8_t> & serialized_in, int & integer_out)
+// Reads the big endian value from the start of the data, returns 0 if the data is too short
+inline int deserializeNext(const std::vector<std::uint8_t> & serialized_in, int & integer_out)
 {
-  if (serialized_in.size() < sizeof(int)) {
-    // TODO(resizoltan): error
+  BufferReader reader(serialized_in.data(), serialized_in.size());
+  std::int32_t value = 0;
+  if (!reader.readInt32(value)) {
+    return 0;
   }
-  std::vector<std::uint8_t> serialized_copy = serialized_in;
-  integer_out = *(reinterpret_cast<int *>(serialized_copy.data()));
-  return sizeof(int);
+  integer_out = value;
+  return sizeof(std::int32_t);
 }
 
-int serializeNext(double double_in, std::vector<std::uint8_t> & serialized_out)
+inline int serializeNext(double double_in, std::vector<std::uint8_t> & serialized_out)
 {
-  std::uint8_t * bytes = reinterpret_cast<std::uint8_t *>(&double_in);
-  serialized_out.insert(serialized_out.end(), bytes, bytes + sizeof(double));
-
-  // Redefine iterator because of possible invalidation
-  auto from_it = std::prev(serialized_out.end(), sizeof(double));
-  std::reverse(from_it, serialized_out.end());
-  // TODO(resizoltan): assert that int is 4 bytes long
-  // TODO(resizoltan): check endiannes
-  return sizeof(int);
+  const std::size_t offset = serialized_out.size();
+  serialized_out.resize(offset + sizeof(double));
+  BufferWriter writer(serialized_out.data() + offset, sizeof(double));
+  writer.writeDouble(double_in);
+  return sizeof(double);
 }
 
-int deserializeNext(const std::vector<std::uint8_t> & serialized_in, double & double_out)
+inline int deserializeNext(const std::vector<std::uint8_t> & serialized_in, double & double_out)
 {
-  if (serialized_in.size() < sizeof(double)) {
-    // TODO(resizoltan): error
+  BufferReader reader(serialized_in.data(), serialized_in.size());
+  if (!reader.readDouble(double_out)) {
+    return 0;
   }
-  std::vector<std::uint8_t> serialized_copy = serialized_in;
-  double_out = *(reinterpret_cast<int *>(serialized_copy.data()));
-  return sizeof(int);
+  return sizeof(double);
 }
 
 }  // namespace kuka_drivers_core
@@ -15,8 +15,13 @@
 #ifndef COMMUNICATION_HELPERS__SERVICE_TOOLS_HPP_
 #define COMMUNICATION_HELPERS__SERVICE_TOOLS_HPP_
 
+#include <chrono>
+#include <condition_variable>
+#include <functional>
 #include <future>
 #include <memory>
+#include <mutex>
+#include <utility>
 
 #include "rclcpp/rclcpp.hpp"
 
@@ -40,6 +45,124 @@ std::future_status wait_for_result(FutureT & future, WaitTimeT time_to_wait)
   return status;
 }
 
+/**
+ * @brief Asynchronous call of a service, completed by the response callback of the client
+ *
+ * The callback runs in the executor thread of the node of the client, with the response or
+ *  with nullptr if the call was cancelled or timed out. Callers that need the result can wait
+ *  for the completion, which wakes up as soon as the response arrives.
+ */
+template<typename ServiceT>
+class ServiceCall : public std::enable_shared_from_this<ServiceCall<ServiceT>>
+{
+public:
+  using ResponseSharedPtr = std::shared_ptr<typename ServiceT::Response>;
+  using Callback = std::function<void (ResponseSharedPtr)>;
+
+  explicit ServiceCall(Callback callback = nullptr)
+  : callback_(std::move(callback))
+  {
+  }
+
+  void send(
+    const std::shared_ptr<rclcpp::Client<ServiceT>> & client,
+    const std::shared_ptr<typename ServiceT::Request> & request)
+  {
+    auto self = this->shared_from_this();
+    std::lock_guard<std::mutex> lock(mutex_);
+    client_ = client;
+    request_id_ = client->async_send_request(
+      request, [self](typename rclcpp::Client<ServiceT>::SharedFuture future) {
+        self->complete(future.get());
+      }).request_id;
+  }
+
+  // Wait for the response until the deadline, the call is cancelled if it did not arrive
+  bool waitUntil(std::chrono::steady_clock::time_point deadline)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!condition_.wait_until(lock, deadline, [this]() {return done_;})) {
+      lock.unlock();
+      cancel();
+      lock.lock();
+    }
+    return response_ != nullptr;
+  }
+
+  bool waitFor(std::chrono::milliseconds timeout)
+  {
+    return waitUntil(std::chrono::steady_clock::now() + timeout);
+  }
+
+  // The callback is called with nullptr, a response arriving later is ignored
+  void cancel()
+  {
+    std::shared_ptr<rclcpp::Client<ServiceT>> client;
+    int64_t request_id;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (done_) {
+        return;
+      }
+      client = client_.lock();
+      request_id = request_id_;
+    }
+    if (client) {
+      client->remove_pending_request(request_id);
+    }
+    complete(nullptr);
+  }
+
+  bool done() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return done_;
+  }
+
+  ResponseSharedPtr response() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return response_;
+  }
+
+private:
+  void complete(ResponseSharedPtr response)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (done_) {
+        return;
+      }
+      done_ = true;
+      response_ = std::move(response);
+    }
+    condition_.notify_all();
+    if (callback_) {
+      callback_(response_);
+    }
+  }
+
+  Callback callback_;
+  mutable std::mutex mutex_;
+  std::condition_variable condition_;
+  std::weak_ptr<rclcpp::Client<ServiceT>> client_;
+  int64_t request_id_ = 0;
+  bool done_ = false;
+  ResponseSharedPtr response_;
+};
+
+template<typename ServiceT>
+std::shared_ptr<ServiceCall<ServiceT>>
+sendRequestAsync(
+  const std::shared_ptr<rclcpp::Client<ServiceT>> & client,
+  const std::shared_ptr<typename ServiceT::Request> & request,
+  typename ServiceCall<ServiceT>::Callback callback = nullptr)
+{
+  auto call = std::make_shared<ServiceCall<ServiceT>>(std::move(callback));
+  call->send(client, request);
+  return call;
+}
+
 template<typename ResponseT, typename RequestT, typename ClientT>
 std::shared_ptr<ResponseT>
 sendRequest(
@@ -52,14 +175,12 @@ sendRequest(
     printf("Wait for service failed\n");
     return nullptr;
   }
-  auto future_result = client->async_send_request(request);
-  auto future_status = wait_for_result(
-    future_result, std::chrono::milliseconds(response_timeout_ms));
-  if (future_status != std::future_status::ready) {
+  auto call = sendRequestAsync(client, request);
+  if (!call->waitFor(std::chrono::milliseconds(response_timeout_ms))) {
     printf("Request timed out\n");
     return nullptr;
   }
-  return future_result.get();
+  return call->response();
 }
 }  // namespace kuka_drivers_core
 
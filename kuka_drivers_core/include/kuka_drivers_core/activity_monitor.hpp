@@ -0,0 +1,88 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KUKA_DRIVERS_CORE__ACTIVITY_MONITOR_HPP_
+#define KUKA_DRIVERS_CORE__ACTIVITY_MONITOR_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+namespace kuka_drivers_core
+{
+/**
+ * @brief Tells the control loop whether a hardware interface of the process is active
+ *
+ * Without an active hardware interface, read() of the drivers only sleeps and an unpaced loop
+ *  wakes the real-time core every millisecond or two for nothing. In idle mode the control loop
+ *  blocks in WaitForActivity() instead and only updates the controller manager at its
+ *  housekeeping rate. The hardware interfaces set their Flag when they are activated, which
+ *  wakes the loop at once, and clear it when they do not need the loop any more, also from the
+ *  control loop itself (e.g. after the stop of the RSI session was sent).
+ */
+class ActivityMonitor
+{
+public:
+  // Activity of one hardware interface, cleared on destruction
+  class Flag
+  {
+public:
+    Flag() = default;
+    ~Flag() {Clear();}
+
+    Flag(const Flag &) = delete;
+    Flag & operator=(const Flag &) = delete;
+
+    // Called from the lifecycle transitions, wakes the waiting control loop
+    void Set();
+    // Real-time safe, the loop notices it at the end of the cycle
+    void Clear();
+
+private:
+    std::atomic<bool> set_{false};
+  };
+
+  // The monitor shared by the hardware interfaces and the control loop of the process
+  static ActivityMonitor & Instance();
+
+  ActivityMonitor() = default;
+  ActivityMonitor(const ActivityMonitor &) = delete;
+  ActivityMonitor & operator=(const ActivityMonitor &) = delete;
+
+  // True if a hardware interface is active, real-time safe
+  bool Active() const {return active_count_.load(std::memory_order_acquire) > 0;}
+
+  // Wakes the waiting loop without an activation, e.g. when the configuration changed
+  void Notify();
+
+  /**
+   * @brief Blocks until a hardware interface is active, Notify() is called or the timeout passed
+   * @returns whether a hardware interface is active
+   */
+  bool WaitForActivity(std::chrono::nanoseconds timeout);
+
+private:
+  void Added();
+
+  std::atomic<int> active_count_{0};
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  uint64_t notifications_ = 0;
+};
+}  // namespace kuka_drivers_core
+
+#endif  // KUKA_DRIVERS_CORE__ACTIVITY_MONITOR_HPP_
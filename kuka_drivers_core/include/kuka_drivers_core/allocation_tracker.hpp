@@ -0,0 +1,126 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_DRIVERS_CORE__ALLOCATION_TRACKER_HPP_
+#define KUKA_DRIVERS_CORE__ALLOCATION_TRACKER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace kuka_drivers_core
+{
+/**
+ * Debug instrumentation of the heap usage of the real-time phases
+ *
+ * If the executable is built with the TRACK_RT_ALLOCATIONS CMake option, it links the
+ *  rt_allocation_tracker library, which replaces malloc, calloc, realloc, the aligned
+ *  allocations and free. While a thread is inside a ScopedPhase, every call is counted and its
+ *  backtrace is handed over to a consumer thread through a lock-free queue. The consumer
+ *  resolves the shared object that made the call (the driver or controller library) and the
+ *  symbols. Taking the backtraces makes the phases slower, the mode is meant for finding
+ *  allocations, not for production. Without the option all functions are no-ops.
+ *
+ * Only one thread may be inside a phase at a time, the queue has a single producer.
+ */
+namespace allocation_tracker
+{
+enum class Phase : uint8_t
+{
+  NONE,
+  READ,
+  UPDATE,
+  WRITE
+};
+constexpr std::size_t PHASE_COUNT = 4;
+
+enum class Kind : uint8_t
+{
+  ALLOCATION,
+  FREE
+};
+
+constexpr std::size_t MAX_FRAMES = 24;
+
+struct Allocation
+{
+  Phase phase;
+  Kind kind;
+  std::size_t size;
+  int depth;
+  void * frames[MAX_FRAMES];
+};
+
+inline const char * PhaseName(Phase phase)
+{
+  switch (phase) {
+    case Phase::READ:
+      return "read";
+    case Phase::UPDATE:
+      return "update";
+    case Phase::WRITE:
+      return "write";
+    default:
+      return "none";
+  }
+}
+
+#ifdef KUKA_TRACK_RT_ALLOCATIONS
+constexpr bool ENABLED = true;
+
+/**
+ * @brief Marks the calling thread to be in the given phase until the end of the scope
+ */
+class ScopedPhase
+{
+public:
+  explicit ScopedPhase(Phase phase);
+  ~ScopedPhase();
+
+  ScopedPhase(const ScopedPhase &) = delete;
+  ScopedPhase & operator=(const ScopedPhase &) = delete;
+
+private:
+  Phase previous_;
+};
+
+// Number of allocations and frees in the phase since the start of the process
+uint64_t Count(Phase phase, Kind kind);
+// Number of backtraces not taken over by the consumer in time, the calls are still counted
+uint64_t Dropped();
+// Takes the oldest recorded call, only called from one consumer thread
+bool Pop(Allocation & allocation);
+// File name of the shared object (or the executable) that made the call
+std::string Origin(const Allocation & allocation);
+// One line of the phase, kind, size and origin, followed by the demangled backtrace
+std::string Describe(const Allocation & allocation);
+#else
+constexpr bool ENABLED = false;
+
+class ScopedPhase
+{
+public:
+  explicit ScopedPhase(Phase) {}
+};
+
+inline uint64_t Count(Phase, Kind) {return 0;}
+inline uint64_t Dropped() {return 0;}
+inline bool Pop(Allocation &) {return false;}
+inline std::string Origin(const Allocation &) {return "";}
+inline std::string Describe(const Allocation &) {return "";}
+#endif
+}  // namespace allocation_tracker
+}  // namespace kuka_drivers_core
+
+#endif  // KUKA_DRIVERS_CORE__ALLOCATION_TRACKER_HPP_
@@ -0,0 +1,298 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_DRIVERS_CORE__CLOCK_SYNC_HPP_
+#define KUKA_DRIVERS_CORE__CLOCK_SYNC_HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include "kuka_drivers_core/hardware_parameters.hpp"
+
+namespace kuka_drivers_core
+{
+/**
+ * @brief Maps the timestamps of the controller (IPOC, FRI time) to the steady clock of the host
+ *
+ * Every message carries the time the controller sent it in controller ticks, the arrival on the
+ *  host is measured. The arrival minus the mapped send time is the one-way latency, which is
+ *  at least the latency of an empty network path and grows with queueing and scheduling delays.
+ *  The estimator therefore keeps the message of every bucket (1 s by default) with the lowest
+ *  arrival relative to its send time, fits a line through these minima of the last buckets
+ *  (the window) and shifts it below all of them. The slope of the line is the length of a tick
+ *  on the host clock, its deviation from the nominal tick length is the drift.
+ *
+ * The minimal latency of the path cannot be observed in one direction, it is given in the
+ *  constructor (e.g. measured once with synchronized clocks), the exported latency is the
+ *  delay above the fastest message of the window otherwise.
+ * The estimate restarts when the controller time jumps backwards, or the messages or the
+ *  mapping jump by more than MAX_GAP_NS, e.g. after the program on the controller was restarted.
+ * Update() runs in constant time without allocations, it is meant for read().
+ */
+class ClockSync
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr std::size_t MAX_BUCKETS = 32;
+  // Messages further apart start a new estimate
+  static constexpr int64_t MAX_GAP_NS = 10000000000;
+
+  /**
+   * @param nominal_tick: length of a controller tick in seconds, e.g. 1e-3 for the IPOC of
+   *  RSI, 0 if unknown: the tick length is learned and no drift is reported
+   * @param min_latency: latency of the fastest possible message, added to the estimated one
+   * @param bucket: time span of the messages a minimum is taken from
+   * @param buckets: number of buckets in the window of the fit, at most MAX_BUCKETS
+   */
+  explicit ClockSync(
+    double nominal_tick = 0.0, std::chrono::nanoseconds min_latency = std::chrono::nanoseconds(0),
+    std::chrono::milliseconds bucket = std::chrono::milliseconds(1000),
+    std::size_t buckets = MAX_BUCKETS)
+  : nominal_tick_ns_(nominal_tick * 1e9),
+    min_latency_ns_(static_cast<double>(min_latency.count())),
+    bucket_ns_(std::chrono::duration_cast<std::chrono::nanoseconds>(bucket).count()),
+    window_(buckets > MAX_BUCKETS ? MAX_BUCKETS : std::max<std::size_t>(buckets, 2))
+  {}
+
+  /**
+   * @brief Reads the clock_sync_min_latency_us hardware parameter (default: 0)
+   * @return false with the reason in error if it is invalid
+   */
+  static bool ParseMinLatency(
+    const std::unordered_map<std::string, std::string> & parameters,
+    std::chrono::nanoseconds & min_latency, std::string & error)
+  {
+    min_latency = std::chrono::nanoseconds(0);
+    auto param = parameters.find("clock_sync_min_latency_us");
+    if (param == parameters.end() || param->second.empty()) {
+      return true;
+    }
+    // At most a second, so that the latency in ns stays far from the limits of int64_t
+    double latency_us = 0.0;
+    if (!HardwareParameters::Convert(param->second, latency_us, 0.0, 1e6)) {
+      error = "clock_sync_min_latency_us must be a number between 0 and 1000000";
+      return false;
+    }
+    min_latency = std::chrono::nanoseconds(static_cast<int64_t>(latency_us * 1000.0));
+    return true;
+  }
+
+  void Reset()
+  {
+    started_ = false;
+    valid_ = false;
+    count_ = 0;
+    head_ = 0;
+    learn_ = Regression();
+    offset_ns_ = 0.0;
+    latency_ = 0.0;
+    resets_++;
+  }
+
+  /**
+   * @brief Adds a message
+   * @param ticks: send time of the message in controller ticks
+   * @param arrival: arrival time of the message on the host
+   */
+  void Update(int64_t ticks, Clock::time_point arrival)
+  {
+    const int64_t host_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(arrival.time_since_epoch()).count();
+    if (started_ && ticks == last_ticks_) {
+      // Repeated message, it tells nothing new
+      return;
+    }
+    if (started_ && (ticks < last_ticks_ || host_ns - last_host_ns_ > MAX_GAP_NS ||
+      (valid_ && std::abs(
+        Residual(
+          static_cast<double>(ticks - origin_ticks_),
+          static_cast<double>(host_ns - origin_host_ns_))) > static_cast<double>(MAX_GAP_NS))))
+    {
+      Reset();
+    }
+    if (!started_) {
+      started_ = true;
+      origin_ticks_ = ticks;
+      origin_host_ns_ = host_ns;
+      tick_ns_ = nominal_tick_ns_;
+      current_ = Bucket{0.0, 0.0, host_ns};
+      current_empty_ = true;
+    }
+    last_ticks_ = ticks;
+    last_host_ns_ = host_ns;
+
+    const double x = static_cast<double>(ticks - origin_ticks_);
+    const double y = static_cast<double>(host_ns - origin_host_ns_);
+    if (nominal_tick_ns_ <= 0.0 && count_ < 2) {
+      // Without a nominal tick, the first slope comes from all messages until two minima exist
+      learn_.Add(x, y);
+      if (learn_.count > 1 && learn_.Slope() > 0.0) {
+        tick_ns_ = learn_.Slope();
+      }
+    }
+
+    if (current_empty_ || y - tick_ns_ * x < current_.y - tick_ns_ * current_.x) {
+      current_.x = x;
+      current_.y = y;
+      current_empty_ = false;
+    }
+    if (host_ns - current_.start_ns >= bucket_ns_) {
+      buckets_[head_] = current_;
+      head_ = (head_ + 1) % window_;
+      count_ = std::min(count_ + 1, window_);
+      Fit();
+      current_ = Bucket{0.0, 0.0, host_ns};
+      current_empty_ = true;
+    }
+
+    latency_ = valid_ ? (std::max(Residual(x, y), 0.0) + min_latency_ns_) * 1e-9 : 0.0;
+  }
+
+  // At least one bucket was completed, the mapping is an estimate from then on
+  bool Valid() const {return valid_;}
+
+  // Host time the controller sent the message with the given time
+  Clock::time_point ToHost(int64_t ticks) const
+  {
+    const double host_ns = static_cast<double>(origin_host_ns_) + offset_ns_ +
+      tick_ns_ * static_cast<double>(ticks - origin_ticks_) - min_latency_ns_;
+    return Clock::time_point(
+      std::chrono::duration_cast<Clock::duration>(
+        std::chrono::nanoseconds(static_cast<int64_t>(host_ns))));
+  }
+
+  // Host time the last message was sent
+  Clock::time_point SendTime() const {return ToHost(last_ticks_);}
+
+  // Host time the last message was sent in seconds of the steady clock
+  double Stamp() const
+  {
+    return std::chrono::duration<double>(SendTime().time_since_epoch()).count();
+  }
+
+  // Estimated one-way latency of the last message in seconds (0 until the first estimate)
+  double Latency() const {return latency_;}
+
+  // Rate difference of the controller and the host clock in ppm, 0 without a nominal tick
+  double Drift() const
+  {
+    return nominal_tick_ns_ > 0.0 && valid_ ? (tick_ns_ / nominal_tick_ns_ - 1.0) * 1e6 : 0.0;
+  }
+
+  // Estimated length of a controller tick in seconds on the host clock
+  double Tick() const {return tick_ns_ * 1e-9;}
+
+  // Number of restarts of the estimate
+  uint64_t Resets() const {return resets_;}
+
+private:
+  struct Bucket
+  {
+    double x;
+    double y;
+    int64_t start_ns;
+  };
+
+  struct Regression
+  {
+    double count = 0.0;
+    double sum_x = 0.0;
+    double sum_y = 0.0;
+    double sum_xx = 0.0;
+    double sum_xy = 0.0;
+
+    void Add(double x, double y)
+    {
+      count += 1.0;
+      sum_x += x;
+      sum_y += y;
+      sum_xx += x * x;
+      sum_xy += x * y;
+    }
+
+    double Slope() const
+    {
+      const double denominator = count * sum_xx - sum_x * sum_x;
+      return denominator > 0.0 ? (count * sum_xy - sum_x * sum_y) / denominator : 0.0;
+    }
+  };
+
+  double Residual(double x, double y) const {return y - offset_ns_ - tick_ns_ * x;}
+
+  // Line through the minima of the window, shifted below all of them
+  void Fit()
+  {
+    if (count_ > 1) {
+      // Relative to the mean, as the coordinates grow over the session
+      double mean_x = 0.0;
+      double mean_y = 0.0;
+      for (std::size_t i = 0; i < count_; ++i) {
+        mean_x += buckets_[i].x;
+        mean_y += buckets_[i].y;
+      }
+      mean_x /= static_cast<double>(count_);
+      mean_y /= static_cast<double>(count_);
+      Regression regression;
+      for (std::size_t i = 0; i < count_; ++i) {
+        regression.Add(buckets_[i].x - mean_x, buckets_[i].y - mean_y);
+      }
+      const double slope = regression.Slope();
+      if (slope > 0.0) {
+        tick_ns_ = slope;
+      }
+    }
+    double offset = 0.0;
+    for (std::size_t i = 0; i < count_; ++i) {
+      const double candidate = buckets_[i].y - tick_ns_ * buckets_[i].x;
+      offset = i == 0 ? candidate : std::min(offset, candidate);
+    }
+    offset_ns_ = offset;
+    valid_ = tick_ns_ > 0.0;
+  }
+
+  double nominal_tick_ns_;
+  double min_latency_ns_;
+  int64_t bucket_ns_;
+  std::size_t window_;
+
+  bool started_ = false;
+  bool valid_ = false;
+  int64_t origin_ticks_ = 0;
+  int64_t origin_host_ns_ = 0;
+  int64_t last_ticks_ = 0;
+  int64_t last_host_ns_ = 0;
+
+  // Host time of the controller tick 0 of the origin relative to its arrival, and tick length
+  double offset_ns_ = 0.0;
+  double tick_ns_ = 0.0;
+  Regression learn_;
+
+  Bucket buckets_[MAX_BUCKETS] = {};
+  std::size_t count_ = 0;
+  std::size_t head_ = 0;
+  Bucket current_ = {};
+  bool current_empty_ = true;
+
+  double latency_ = 0.0;
+  uint64_t resets_ = 0;
+};
+}  // namespace kuka_drivers_core
+
+#endif  // KUKA_DRIVERS_CORE__CLOCK_SYNC_HPP_
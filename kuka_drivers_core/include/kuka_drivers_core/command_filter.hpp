@@ -0,0 +1,459 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_DRIVERS_CORE__COMMAND_FILTER_HPP_
+#define KUKA_DRIVERS_CORE__COMMAND_FILTER_HPP_
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <initializer_list>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+
+#include "kuka_drivers_core/hardware_parameters.hpp"
+
+namespace kuka_drivers_core
+{
+/**
+ * Filters of the joint commands, applied in place in write() before the commands are sent.
+ *
+ * Every filter keeps its state in fixed-size arrays, Apply() runs over all joints without
+ *  allocations or virtual calls, a disabled filter returns immediately. The first Apply()
+ *  after Reset() passes the commands through and initializes the state, Reset() should be
+ *  called on activation. The limits are given per joint, a single value applies to all.
+ */
+constexpr std::size_t COMMAND_FILTER_MAX_JOINTS = 12;
+
+using JointLimits = std::array<double, COMMAND_FILTER_MAX_JOINTS>;
+
+// Keeps the previous command until the input moves away from it by more than the threshold
+class DeadbandFilter
+{
+public:
+  void Configure(const JointLimits & thresholds)
+  {
+    thresholds_ = thresholds;
+    enabled_ = true;
+  }
+  // Takes over the configuration of the other filter, the state is kept if it stays enabled
+  void CopyConfiguration(const DeadbandFilter & other)
+  {
+    if (other.enabled_ && !enabled_) {
+      initialized_ = false;
+    }
+    enabled_ = other.enabled_;
+    thresholds_ = other.thresholds_;
+  }
+  bool Enabled() const {return enabled_;}
+  void Reset() {initialized_ = false;}
+
+  void Apply(double * values, std::size_t count, double)
+  {
+    if (!enabled_) {
+      return;
+    }
+    if (!initialized_) {
+      std::copy_n(values, count, output_.begin());
+      initialized_ = true;
+      return;
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+      if (std::abs(values[i] - output_[i]) > thresholds_[i]) {
+        output_[i] = values[i];
+      }
+      values[i] = output_[i];
+    }
+  }
+
+private:
+  bool enabled_ = false;
+  bool initialized_ = false;
+  JointLimits thresholds_{};
+  JointLimits output_{};
+};
+
+// First order low-pass, the coefficient is derived from the cutoff frequency and the period
+class LowPassFilter
+{
+public:
+  void Configure(const JointLimits & cutoff_frequencies)
+  {
+    cutoff_frequencies_ = cutoff_frequencies;
+    enabled_ = true;
+  }
+  // Takes over the configuration of the other filter, the state is kept if it stays enabled
+  void CopyConfiguration(const LowPassFilter & other)
+  {
+    if (other.enabled_ && !enabled_) {
+      initialized_ = false;
+    }
+    enabled_ = other.enabled_;
+    cutoff_frequencies_ = other.cutoff_frequencies_;
+    // The coefficients are derived again in the next Apply()
+    period_ = 0;
+  }
+  bool Enabled() const {return enabled_;}
+  void Reset() {initialized_ = false;}
+
+  void Apply(double * values, std::size_t count, double period)
+  {
+    if (!enabled_) {
+      return;
+    }
+    if (!initialized_ || period <= 0) {
+      std::copy_n(values, count, output_.begin());
+      initialized_ = true;
+      return;
+    }
+    // The coefficients only change with the period
+    if (period != period_) {
+      for (std::size_t i = 0; i < count; ++i) {
+        const double time_constant = 1 / (2 * M_PI * cutoff_frequencies_[i]);
+        alpha_[i] = period / (period + time_constant);
+      }
+      period_ = period;
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+      output_[i] += alpha_[i] * (values[i] - output_[i]);
+      values[i] = output_[i];
+    }
+  }
+
+private:
+  bool enabled_ = false;
+  bool initialized_ = false;
+  double period_ = 0;
+  JointLimits cutoff_frequencies_{};
+  JointLimits alpha_{};
+  JointLimits output_{};
+};
+
+// Limits the change of the commands to the maximal velocity
+class VelocityLimitFilter
+{
+public:
+  void Configure(const JointLimits & max_velocities)
+  {
+    max_velocities_ = max_velocities;
+    enabled_ = true;
+  }
+  // Takes over the configuration of the other filter, the state is kept if it stays enabled
+  void CopyConfiguration(const VelocityLimitFilter & other)
+  {
+    if (other.enabled_ && !enabled_) {
+      initialized_ = false;
+    }
+    enabled_ = other.enabled_;
+    max_velocities_ = other.max_velocities_;
+  }
+  bool Enabled() const {return enabled_;}
+  void Reset() {initialized_ = false;}
+
+  void Apply(double * values, std::size_t count, double period)
+  {
+    if (!enabled_) {
+      return;
+    }
+    if (!initialized_) {
+      std::copy_n(values, count, output_.begin());
+      initialized_ = true;
+      return;
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+      const double max_step = max_velocities_[i] * period;
+      output_[i] += std::min(std::max(values[i] - output_[i], -max_step), max_step);
+      values[i] = output_[i];
+    }
+  }
+
+private:
+  bool enabled_ = false;
+  bool initialized_ = false;
+  JointLimits max_velocities_{};
+  JointLimits output_{};
+};
+
+/**
+ * Limits the change of the velocity of the commands to the maximal acceleration
+ * The velocity towards the input is also limited so that the output can stop at it without
+ *  exceeding the acceleration, a constant input is reached without overshoot.
+ */
+class AccelerationLimitFilter
+{
+public:
+  void Configure(const JointLimits & max_accelerations)
+  {
+    max_accelerations_ = max_accelerations;
+    enabled_ = true;
+  }
+  // Takes over the configuration of the other filter, the state is kept if it stays enabled
+  void CopyConfiguration(const AccelerationLimitFilter & other)
+  {
+    if (other.enabled_ && !enabled_) {
+      initialized_ = false;
+    }
+    enabled_ = other.enabled_;
+    max_accelerations_ = other.max_accelerations_;
+  }
+  bool Enabled() const {return enabled_;}
+  void Reset() {initialized_ = false;}
+
+  void Apply(double * values, std::size_t count, double period)
+  {
+    if (!enabled_) {
+      return;
+    }
+    if (!initialized_ || period <= 0) {
+      std::copy_n(values, count, output_.begin());
+      velocity_.fill(0);
+      initialized_ = true;
+      return;
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+      const double error = values[i] - output_[i];
+      const double braking_velocity = std::sqrt(2 * max_accelerations_[i] * std::abs(error));
+      const double target_velocity =
+        std::copysign(std::min(std::abs(error) / period, braking_velocity), error);
+      const double max_change = max_accelerations_[i] * period;
+      velocity_[i] += std::min(std::max(target_velocity - velocity_[i], -max_change), max_change);
+      output_[i] += velocity_[i] * period;
+      values[i] = output_[i];
+    }
+  }
+
+private:
+  bool enabled_ = false;
+  bool initialized_ = false;
+  JointLimits max_accelerations_{};
+  JointLimits output_{};
+  JointLimits velocity_{};
+};
+
+/**
+ * Limits the change of the acceleration of the commands to the maximal jerk
+ * Meant for smoothing commands that are already continuous (e.g. after the acceleration limit),
+ *  steps of the input can be overshot.
+ */
+class JerkLimitFilter
+{
+public:
+  void Configure(const JointLimits & max_jerks)
+  {
+    max_jerks_ = max_jerks;
+    enabled_ = true;
+  }
+  // Takes over the configuration of the other filter, the state is kept if it stays enabled
+  void CopyConfiguration(const JerkLimitFilter & other)
+  {
+    if (other.enabled_ && !enabled_) {
+      initialized_ = false;
+    }
+    enabled_ = other.enabled_;
+    max_jerks_ = other.max_jerks_;
+  }
+  bool Enabled() const {return enabled_;}
+  void Reset() {initialized_ = false;}
+
+  void Apply(double * values, std::size_t count, double period)
+  {
+    if (!enabled_) {
+      return;
+    }
+    if (!initialized_ || period <= 0) {
+      std::copy_n(values, count, output_.begin());
+      velocity_.fill(0);
+      acceleration_.fill(0);
+      initialized_ = true;
+      return;
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+      const double target_velocity = (values[i] - output_[i]) / period;
+      const double target_acceleration = (target_velocity - velocity_[i]) / period;
+      const double max_change = max_jerks_[i] * period;
+      acceleration_[i] += std::min(
+        std::max(target_acceleration - acceleration_[i], -max_change), max_change);
+      velocity_[i] += acceleration_[i] * period;
+      output_[i] += velocity_[i] * period;
+      values[i] = output_[i];
+    }
+  }
+
+private:
+  bool enabled_ = false;
+  bool initialized_ = false;
+  JointLimits max_jerks_{};
+  JointLimits output_{};
+  JointLimits velocity_{};
+  JointLimits acceleration_{};
+};
+
+/**
+ * @brief Compile-time composition of command filters, applied in the order of the arguments
+ *
+ * @tparam Filters: classes with Reset(), Enabled(), CopyConfiguration() and
+ *  Apply(double *, std::size_t, double)
+ */
+template<typename ... Filters>
+class CommandFilterChain
+{
+public:
+  template<typename Filter>
+  Filter & Get() {return std::get<Filter>(filters_);}
+
+  // True if any of the filters is configured
+  bool Enabled() const {return EnabledImpl(std::index_sequence_for<Filters...>());}
+
+  void Reset() {ResetImpl(std::index_sequence_for<Filters...>());}
+
+  /**
+   * @brief Takes over the configuration of the other chain, e.g. a new one from the parameters,
+   *  without losing the state of the filters that stay enabled, no allocations
+   */
+  void CopyConfiguration(const CommandFilterChain & other)
+  {
+    CopyConfigurationImpl(other, std::index_sequence_for<Filters...>());
+  }
+
+  /**
+   * @brief Filter the commands in place
+   * @param count: number of joints, at most COMMAND_FILTER_MAX_JOINTS if a filter is enabled
+   * @param period: time since the previous commands in seconds
+   * @return false without filtering if a filter is enabled and there are more joints than the
+   *  filters support, ConfigureCommandFilter() rejects such a configuration
+   */
+  bool Apply(double * values, std::size_t count, double period)
+  {
+    if (count > COMMAND_FILTER_MAX_JOINTS) {
+      return !Enabled();
+    }
+    ApplyImpl(values, count, period, std::index_sequence_for<Filters...>());
+    return true;
+  }
+
+private:
+  template<std::size_t ... I>
+  bool EnabledImpl(std::index_sequence<I...>) const
+  {
+    bool enabled = false;
+    (void)std::initializer_list<int>{(enabled = enabled || std::get<I>(filters_).Enabled(), 0)...};
+    return enabled;
+  }
+
+  template<std::size_t ... I>
+  void ResetImpl(std::index_sequence<I...>)
+  {
+    (void)std::initializer_list<int>{(std::get<I>(filters_).Reset(), 0)...};
+  }
+
+  template<std::size_t ... I>
+  void CopyConfigurationImpl(const CommandFilterChain & other, std::index_sequence<I...>)
+  {
+    (void)std::initializer_list<int>{
+      (std::get<I>(filters_).CopyConfiguration(std::get<I>(other.filters_)), 0)...};
+  }
+
+  template<std::size_t ... I>
+  void ApplyImpl(double * values, std::size_t count, double period, std::index_sequence<I...>)
+  {
+    (void)std::initializer_list<int>{(std::get<I>(filters_).Apply(values, count, period), 0)...};
+  }
+
+  std::tuple<Filters...> filters_;
+};
+
+// Chain of the drivers, every filter is disabled until it is configured
+using JointCommandFilter = CommandFilterChain<
+  DeadbandFilter, LowPassFilter, VelocityLimitFilter, AccelerationLimitFilter, JerkLimitFilter>;
+
+// Names of the hardware parameters read by ConfigureCommandFilter()
+constexpr const char * COMMAND_FILTER_PARAMETERS[] = {
+  "command_deadband", "command_cutoff_frequency", "command_max_velocity",
+  "command_max_acceleration", "command_max_jerk"};
+
+/**
+ * @brief Configure the filters of the drivers from the hardware parameters command_deadband,
+ *  command_cutoff_frequency, command_max_velocity, command_max_acceleration and
+ *  command_max_jerk, each a single value or a comma separated value per joint
+ * @return false with the reason in error if a parameter is invalid, or if a filter is configured
+ *  for more than COMMAND_FILTER_MAX_JOINTS joints
+ */
+inline bool ConfigureCommandFilter(
+  const std::unordered_map<std::string, std::string> & parameters, std::size_t joint_count,
+  JointCommandFilter & filter, std::string & error)
+{
+  auto parse = [&](const char * name, bool & found, JointLimits & limits) {
+      found = false;
+      auto param = parameters.find(name);
+      if (param == parameters.end() || param->second.empty()) {
+        return true;
+      }
+      found = true;
+      if (joint_count > COMMAND_FILTER_MAX_JOINTS) {
+        error = std::string(name) + " is supported for at most " +
+          std::to_string(COMMAND_FILTER_MAX_JOINTS) + " joints";
+        return false;
+      }
+      std::size_t count = 0;
+      std::size_t start = 0;
+      while (start <= param->second.size()) {
+        std::size_t end = param->second.find(',', start);
+        end = end == std::string::npos ? param->second.size() : end;
+        if (count == COMMAND_FILTER_MAX_JOINTS) {
+          error = std::string(name) + " has more values than joints";
+          return false;
+        }
+        if (!HardwareParameters::Convert(
+            param->second.substr(start, end - start), limits[count++]))
+        {
+          error = std::string(name) + " must be a number or a comma separated list of numbers";
+          return false;
+        }
+        start = end + 1;
+      }
+      if (count == 1) {
+        limits.fill(limits[0]);
+      } else if (count != joint_count) {
+        error = std::string(name) + " must have one value or one for each joint";
+        return false;
+      }
+      for (std::size_t i = 0; i < joint_count; ++i) {
+        if (!(limits[i] > 0)) {
+          error = std::string(name) + " must be positive";
+          return false;
+        }
+      }
+      return true;
+    };
+
+  bool found;
+  JointLimits limits{};
+  if (!parse("command_deadband", found, limits)) {return false;}
+  if (found) {filter.Get<DeadbandFilter>().Configure(limits);}
+  if (!parse("command_cutoff_frequency", found, limits)) {return false;}
+  if (found) {filter.Get<LowPassFilter>().Configure(limits);}
+  if (!parse("command_max_velocity", found, limits)) {return false;}
+  if (found) {filter.Get<VelocityLimitFilter>().Configure(limits);}
+  if (!parse("command_max_acceleration", found, limits)) {return false;}
+  if (found) {filter.Get<AccelerationLimitFilter>().Configure(limits);}
+  if (!parse("command_max_jerk", found, limits)) {return false;}
+  if (found) {filter.Get<JerkLimitFilter>().Configure(limits);}
+  return true;
+}
+}  // namespace kuka_drivers_core
+
+#endif  // KUKA_DRIVERS_CORE__COMMAND_FILTER_HPP_
@@ -0,0 +1,217 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_DRIVERS_CORE__COMMAND_INTERPOLATOR_HPP_
+#define KUKA_DRIVERS_CORE__COMMAND_INTERPOLATOR_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "kuka_drivers_core/hardware_parameters.hpp"
+
+namespace kuka_drivers_core
+{
+/**
+ * @brief Interpolates the joint commands of controllers running slower than the robot cycle
+ *
+ * A new target is set in every controller update together with the time until the next one,
+ *  the interpolator returns the commands of the robot cycles in between. The linear, cubic and
+ *  quintic modes reach the target at the end of the segment, so they delay the commands by one
+ *  controller update. The cubic mode keeps the velocity continuous by using the slope of the
+ *  previous segment as the initial slope of the next one, the quintic mode additionally starts
+ *  and ends the segments without acceleration, so the acceleration is continuous as well. The
+ *  velocity limited mode moves towards the latest target with at most the given rate, without
+ *  delay for commands the robot can follow anyway. Next() does not allocate.
+ */
+class CommandInterpolator
+{
+public:
+  enum class Mode
+  {
+    NONE,
+    LINEAR,
+    CUBIC,
+    QUINTIC,
+    VELOCITY_LIMITED
+  };
+
+  // Returns false if the name is not one of 'none', 'linear', 'cubic', 'quintic' or
+  //  'velocity_limited'
+  static bool ParseMode(const std::string & name, Mode & mode)
+  {
+    if (name == "none") {
+      mode = Mode::NONE;
+    } else if (name == "linear") {
+      mode = Mode::LINEAR;
+    } else if (name == "cubic") {
+      mode = Mode::CUBIC;
+    } else if (name == "quintic") {
+      mode = Mode::QUINTIC;
+    } else if (name == "velocity_limited") {
+      mode = Mode::VELOCITY_LIMITED;
+    } else {
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * @brief Configure from the command_interpolation and interpolation_max_rate hardware
+   *  parameters, the interpolation is disabled if they are not given
+   * @return false with the reason in error if a parameter is invalid
+   */
+  bool Configure(
+    const std::unordered_map<std::string, std::string> & parameters, std::size_t size,
+    std::string & error)
+  {
+    Mode mode = Mode::NONE;
+    auto mode_param = parameters.find("command_interpolation");
+    if (mode_param != parameters.end() && !ParseMode(mode_param->second, mode)) {
+      error =
+        "command_interpolation must be 'none', 'linear', 'cubic', 'quintic' or 'velocity_limited'";
+      return false;
+    }
+    auto max_rate_param = parameters.find("interpolation_max_rate");
+    double max_rate = 0;
+    if (max_rate_param != parameters.end() &&
+      !HardwareParameters::Convert(max_rate_param->second, max_rate))
+    {
+      error = "interpolation_max_rate must be a number";
+      return false;
+    }
+    if (mode == Mode::VELOCITY_LIMITED && !(max_rate > 0)) {
+      error = "interpolation_max_rate must be positive for velocity limited interpolation";
+      return false;
+    }
+    Configure(mode, size, max_rate);
+    return true;
+  }
+
+  /**
+   * @brief Allocates the buffers, must be called before the control loop
+   * @param max_rate maximal change of the commands per second in velocity limited mode
+   */
+  void Configure(Mode mode, std::size_t size, double max_rate)
+  {
+    mode_ = mode;
+    max_rate_ = max_rate;
+    start_.assign(size, 0);
+    target_.assign(size, 0);
+    start_slope_.assign(size, 0);
+    end_slope_.assign(size, 0);
+    output_.assign(size, 0);
+  }
+
+  Mode GetMode() const {return mode_;}
+
+  // Maximal change of the commands per second in velocity limited mode
+  double MaxRate() const {return max_rate_;}
+
+  bool Enabled() const {return mode_ != Mode::NONE;}
+
+  // Holds the given commands until the next target
+  void Reset(const double * current)
+  {
+    std::copy_n(current, output_.size(), output_.begin());
+    std::copy(output_.begin(), output_.end(), target_.begin());
+    std::fill(end_slope_.begin(), end_slope_.end(), 0);
+    elapsed_ = duration_ = 0;
+  }
+
+  /**
+   * @brief Starts a new segment from the current output towards the target
+   * @param duration time until the target is reached (the next controller update) in seconds
+   */
+  void SetTarget(const double * target, double duration)
+  {
+    duration_ = duration > 0 ? duration : 0;
+    elapsed_ = 0;
+    for (std::size_t i = 0; i < output_.size(); ++i) {
+      start_[i] = output_[i];
+      target_[i] = target[i];
+      start_slope_[i] = end_slope_[i];
+      end_slope_[i] = duration_ > 0 ? (target_[i] - start_[i]) / duration_ : 0;
+    }
+  }
+
+  // Advances the output by one robot cycle, the returned array holds the commands to send
+  const double * Next(double cycle_time)
+  {
+    if (mode_ == Mode::VELOCITY_LIMITED) {
+      const double max_step = max_rate_ * cycle_time;
+      for (std::size_t i = 0; i < output_.size(); ++i) {
+        output_[i] += std::min(std::max(target_[i] - output_[i], -max_step), max_step);
+      }
+      return output_.data();
+    }
+    // A small tolerance makes sure that the target is reached in the last cycle of the segment
+    elapsed_ += cycle_time;
+    if (elapsed_ >= duration_ * (1 - 1e-6)) {
+      std::copy(target_.begin(), target_.end(), output_.begin());
+      return output_.data();
+    }
+
+    const double s = elapsed_ / duration_;
+    if (mode_ == Mode::CUBIC) {
+      // Hermite basis, the slopes are scaled to the duration of the segment
+      const double h00 = (1 + 2 * s) * (1 - s) * (1 - s);
+      const double h10 = s * (1 - s) * (1 - s);
+      const double h01 = s * s * (3 - 2 * s);
+      const double h11 = s * s * (s - 1);
+      for (std::size_t i = 0; i < output_.size(); ++i) {
+        output_[i] = h00 * start_[i] + h10 * duration_ * start_slope_[i] + h01 * target_[i] +
+          h11 * duration_ * end_slope_[i];
+      }
+    } else if (mode_ == Mode::QUINTIC) {
+      // Quintic Hermite basis with zero acceleration at both ends
+      const double s3 = s * s * s;
+      const double s4 = s3 * s;
+      const double s5 = s4 * s;
+      const double h0 = 1 - 10 * s3 + 15 * s4 - 6 * s5;
+      const double h1 = s - 6 * s3 + 8 * s4 - 3 * s5;
+      const double h3 = 10 * s3 - 15 * s4 + 6 * s5;
+      const double h4 = -4 * s3 + 7 * s4 - 3 * s5;
+      for (std::size_t i = 0; i < output_.size(); ++i) {
+        output_[i] = h0 * start_[i] + h1 * duration_ * start_slope_[i] + h3 * target_[i] +
+          h4 * duration_ * end_slope_[i];
+      }
+    } else {
+      for (std::size_t i = 0; i < output_.size(); ++i) {
+        output_[i] = start_[i] + s * (target_[i] - start_[i]);
+      }
+    }
+    return output_.data();
+  }
+
+  // Commands of the last cycle
+  const std::vector<double> & Output() const {return output_;}
+
+private:
+  Mode mode_ = Mode::NONE;
+  double max_rate_ = 0;
+  double elapsed_ = 0;
+  double duration_ = 0;
+  std::vector<double> start_;
+  std::vector<double> target_;
+  // In unit per second
+  std::vector<double> start_slope_;
+  std::vector<double> end_slope_;
+  std::vector<double> output_;
+};
+}  // namespace kuka_drivers_core
+
+#endif  // KUKA_DRIVERS_CORE__COMMAND_INTERPOLATOR_HPP_
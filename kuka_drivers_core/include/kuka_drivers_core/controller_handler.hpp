@@ -15,6 +15,7 @@
 #ifndef KUKA_DRIVERS_CORE__CONTROLLER_HANDLER_HPP_
 #define KUKA_DRIVERS_CORE__CONTROLLER_HANDLER_HPP_
 
+#include <array>
 #include <string>
 #include <vector>
 #include <map>
@@ -34,9 +35,17 @@ namespace kuka_drivers_core
  *  - GetControllersForSwitch() or GetControllersForDeactivation()
  *  - ApproveControllerActivation()
  *  - ApproveControllerDeactivation()
+ *
+ * The controllers to switch are precomputed for every pair of control modes when the first
+ *  switch is requested after the controller names changed, so the lookup is constant time
+ *  while the active controllers correspond to a control mode.
  */
 class ControllerHandler
 {
+public:
+  // Controllers to activate (first) and to deactivate (second)
+  using SwitchLists = std::pair<std::vector<std::string>, std::vector<std::string>>;
+
 private:
   struct ControllerTypes
   {
@@ -44,6 +53,10 @@ private:
     std::string impedance_controller;
   };
 
+  // Number of ControlMode values, UNSPECIFIED_CONTROL_MODE stands for no active controllers
+  static constexpr std::size_t CONTROL_MODE_COUNT =
+    static_cast<std::size_t>(ControlMode::WRENCH_CONTROL) + 1;
+
   /**
    * @brief Controller names thats have to be active in all control modes
    */
@@ -56,19 +69,51 @@ private:
   std::set<std::string> active_controllers_;
 
   /**
-   * @brief These controllers will be activated after they get approved
+   * @brief Lists of the requested switch, the controllers are activated and deactivated
+   *  in active_controllers_ after they get approved
+   */
+  const SwitchLists * pending_switch_ = nullptr;
+  bool activation_pending_ = false;
+  bool deactivation_pending_ = false;
+
+  /**
+   * @brief Look up table for which controllers are needed for each control mode
    */
-  std::set<std::string> activate_controllers_;
+  std::map<ControlMode, ControllerTypes> control_mode_map_;
 
   /**
-   * @brief These controllers will be deactivated after they get approved
+   * @brief Controllers to switch, indexed by the active and the new control mode
+   * Only valid if switch_table_valid_ is set, rebuilt after the controller names changed
    */
-  std::set<std::string> deactivate_controllers_;
+  std::array<std::array<SwitchLists, CONTROL_MODE_COUNT>, CONTROL_MODE_COUNT> switch_table_;
+  bool switch_table_valid_ = false;
 
   /**
-   * @brief Look up table for which controllers are needed for each control mode
+   * @brief Sorted controllers of each control mode, including the fixed controllers
    */
-  std::map<ControlMode, ControllerTypes> control_mode_map_;
+  std::array<std::vector<std::string>, CONTROL_MODE_COUNT> mode_controllers_;
+
+  /**
+   * @brief Control mode whose controllers are active, if active_mode_known_ is set
+   */
+  ControlMode active_mode_ = ControlMode::UNSPECIFIED_CONTROL_MODE;
+  bool active_mode_known_ = true;
+
+  /**
+   * @brief Control mode of the requested switch, applied to active_mode_ after approval
+   */
+  ControlMode pending_mode_ = ControlMode::UNSPECIFIED_CONTROL_MODE;
+
+  /**
+   * @brief Lists of the switch that were computed from the active controllers
+   */
+  SwitchLists computed_switch_;
+
+  void BuildSwitchTable();
+  // Sets the lists of the switch without using the table, in case of an unknown state
+  const SwitchLists & ComputeSwitch(ControlMode new_control_mode);
+  // Checks whether the active controllers correspond to the pending or to the active mode
+  void UpdateActiveMode();
 
 public:
   /**
@@ -99,19 +144,18 @@ public:
    * @brief Calculates the controllers that have to be activated and deactivated for the control mode change
    *
    * @param new_control_mode: The new control mode. It is based on Controller_handler::control_mode enum.
-   * @return std::pair<std::vector<std::string>, std::vector<std::string>>:
-   * Two vectors, first has the controllers to activate, second has the controllers to deactivate
+   * @return SwitchLists: Two vectors, first has the controllers to activate,
+   * second has the controllers to deactivate. They are valid until the next call.
    * @exception std::out_of_range: new_control_mode attribute is invalid
    */
-  std::pair<std::vector<std::string>, std::vector<std::string>> GetControllersForSwitch(
-    ControlMode new_control_mode);
+  const SwitchLists & GetControllersForSwitch(ControlMode new_control_mode);
 
   /**
    * @brief Returns all controllers that has active state (used for driver deactivation)
    *
    * @return std::vector<std::string>: Vector that contains controllers for deactivation
    */
-  std::vector<std::string> GetControllersForDeactivation();
+  const std::vector<std::string> & GetControllersForDeactivation();
 
   /**
    * @brief Approves that the controller activation was successful
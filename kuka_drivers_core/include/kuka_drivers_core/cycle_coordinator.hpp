@@ -0,0 +1,142 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_DRIVERS_CORE__CYCLE_COORDINATOR_HPP_
+#define KUKA_DRIVERS_CORE__CYCLE_COORDINATOR_HPP_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace kuka_drivers_core
+{
+/**
+ * @brief Aligns the control loop to the cycles of several robots of one process
+ *
+ * With blocking reads, the loop of a cell with several robots (e.g. an LBR on FRI and a KR on
+ *  EAC) is paced by whichever message arrives last, and the phase between the robots wanders.
+ *  The hardware interfaces running with the I/O thread report the send time of every message
+ *  (mapped to the host clock by ClockSync) and its arrival instead. The coordinator learns the
+ *  period and the phase of every robot and the latest arrival relative to the send time, and the
+ *  control loop starts each cycle right after the messages of all robots belonging to the next
+ *  cycle of the master robot are expected to have arrived. The time from the send of the
+ *  message to the start of the cycle (the lead) is then constant per robot.
+ *
+ * The robots are registered with Join() and Leave() from the lifecycle transitions, the
+ *  messages and the cycles are reported from the control loop only, without locking.
+ */
+class CycleCoordinator
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr std::size_t MAX_ROBOTS = 8;
+  // Number of messages after which the oldest arrivals leave the latency window
+  static constexpr uint32_t LATENCY_WINDOW = 1000;
+
+  struct Options
+  {
+    bool enabled = false;
+    // The loop follows the cycles of the master, the first robot that joined if none is set
+    bool master = false;
+  };
+
+  struct RobotStatus
+  {
+    std::string name;
+    bool master;
+    // Period of the messages and time from their send to the start of the cycle in seconds
+    double period;
+    double lead;
+    // Cycles that started without a new message of the robot
+    uint64_t deadline_misses;
+  };
+
+  /**
+   * @brief Reads the cycle_coordination and cycle_master hardware parameters (default: false)
+   * @return false with the reason in error if they are invalid
+   */
+  static bool ParseOptions(
+    const std::unordered_map<std::string, std::string> & parameters, Options & options,
+    std::string & error);
+
+  // The coordinator shared by the hardware interfaces and the control loop of the process
+  static CycleCoordinator & Instance();
+
+  CycleCoordinator() = default;
+  CycleCoordinator(const CycleCoordinator &) = delete;
+  CycleCoordinator & operator=(const CycleCoordinator &) = delete;
+
+  /**
+   * @brief Registers a robot, its phase is learned from its messages
+   * @returns the index of the robot, or -1 if MAX_ROBOTS robots are registered
+   */
+  int Join(const std::string & name, bool master);
+
+  // Removes the robot, the loop falls back to its own timeline without robots
+  void Leave(int robot);
+
+  // Called from read() with the mapped send time and the arrival of each new message
+  void OnMessage(int robot, Clock::time_point send, Clock::time_point arrival);
+
+  // Called from read() in every cycle, whether the cycle found a new message of the robot
+  void OnRead(int robot, bool fresh);
+
+  /**
+   * @brief Start of the next cycle, called by the control loop after the previous cycle
+   * @param now_ns: current time of the steady clock in nanoseconds
+   * @param guard_ns: margin after the expected arrival of the last message
+   * @param start_ns: set to the start of the next cycle, at or after now_ns
+   * @param skipped: set to the number of master cycles passed without a loop cycle
+   * @returns false if no robot has reported its period yet, the loop keeps its own timeline then
+   */
+  bool NextCycleStart(int64_t now_ns, int64_t guard_ns, int64_t & start_ns, uint64_t & skipped);
+
+  // Copies the status of the registered robots, returns their number
+  std::size_t Status(std::array<RobotStatus, MAX_ROBOTS> & status) const;
+
+private:
+  struct Robot
+  {
+    std::atomic<bool> active{false};
+    bool master = false;
+    std::string name;
+    // Written by the control loop, read by Status()
+    std::atomic<int64_t> last_send_ns{0};
+    std::atomic<int64_t> period_ns{0};
+    std::atomic<int64_t> lead_ns{0};
+    std::atomic<uint64_t> deadline_misses{0};
+    // Latest arrival relative to the send time, in the current and in the previous window
+    int64_t latency_max_ns = 0;
+    int64_t previous_latency_max_ns = 0;
+    uint32_t latency_samples = 0;
+  };
+
+  // Send time of the message of the robot nearest to the given time
+  static int64_t NearestSend(const Robot & robot, int64_t time_ns);
+
+  mutable std::mutex mutex_;
+  std::array<Robot, MAX_ROBOTS> robots_;
+  // Send time of the master message the last cycle was aligned to
+  int64_t reference_ns_ = 0;
+  std::atomic<bool> scheduling_{false};
+};
+}  // namespace kuka_drivers_core
+
+#endif  // KUKA_DRIVERS_CORE__CYCLE_COORDINATOR_HPP_
@@ -0,0 +1,320 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_DRIVERS_CORE__FAULT_INJECTION_HPP_
+#define KUKA_DRIVERS_CORE__FAULT_INJECTION_HPP_
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+#include "kuka_drivers_core/hardware_parameters.hpp"
+
+namespace kuka_drivers_core
+{
+/**
+ * @brief Network faults applied by a UdpTransport to the traffic with the controller
+ *
+ * Meant for testing the timeout and packet loss handling of the drivers against a simulator,
+ *  never for production. Received datagrams can be dropped (also in bursts), delayed with a
+ *  constant latency and a random jitter, or held back so that the following ones overtake
+ *  them; sent datagrams can be dropped. Delayed datagrams are kept in fixed-size slots, the
+ *  random numbers come from a seeded generator, so a profile gives the same sequence of faults
+ *  in every run. Nothing is allocated after construction.
+ */
+class FaultInjector
+{
+public:
+  struct Profile
+  {
+    // Constant latency added to every received datagram
+    std::chrono::microseconds delay{0};
+    // Upper limit of the uniformly distributed latency added on top of the delay
+    std::chrono::microseconds jitter{0};
+    // Probability that a received datagram is lost
+    double loss = 0;
+    // Mean number of consecutive datagrams lost once a loss occurred
+    double loss_burst = 1;
+    // Probability that a received datagram is held back by reorder_hold
+    double reorder = 0;
+    std::chrono::microseconds reorder_hold{0};
+    // Probability that a sent datagram is lost
+    double reply_loss = 0;
+    uint32_t seed = 1;
+  };
+
+  struct Stats
+  {
+    uint64_t received = 0;
+    uint64_t dropped = 0;
+    uint64_t delayed = 0;
+    uint64_t reordered = 0;
+    // Dropped because all slots were occupied by delayed datagrams
+    uint64_t overflows = 0;
+    uint64_t sent = 0;
+    uint64_t replies_dropped = 0;
+  };
+
+  // Number of datagrams that can be delayed at the same time
+  static constexpr std::size_t SLOTS = 64;
+  static constexpr std::size_t SLOT_SIZE = 1500;
+
+  /**
+   * @brief Parses a profile given as comma separated key=value pairs, e.g.
+   *  "delay_us=500,jitter_us=300,loss=0.01,loss_burst=3,reorder=0.001,reorder_us=8000,
+   *  reply_loss=0.01,seed=7", the missing keys keep their value
+   * @return false with the reason in error if the profile is invalid
+   */
+  static bool ParseProfile(const std::string & text, Profile & profile, std::string & error)
+  {
+    std::size_t start = 0;
+    while (start < text.size()) {
+      std::size_t end = text.find(',', start);
+      end = end == std::string::npos ? text.size() : end;
+      const std::string entry = text.substr(start, end - start);
+      start = end + 1;
+      if (entry.empty()) {
+        continue;
+      }
+      const std::size_t separator = entry.find('=');
+      if (separator == std::string::npos) {
+        error = "Fault profile entry '" + entry + "' is not a key=value pair";
+        return false;
+      }
+      const std::string key = entry.substr(0, separator);
+      const std::string value = entry.substr(separator + 1);
+      double number = 0;
+      if (!HardwareParameters::Convert(value, number)) {
+        error = "Value of " + key + " in the fault profile must be a number";
+        return false;
+      }
+      const bool probability = key == "loss" || key == "reorder" || key == "reply_loss";
+      if (number < 0 || (probability && number > 1)) {
+        error = "Value of " + key + " in the fault profile is out of range";
+        return false;
+      }
+      const std::chrono::microseconds duration(static_cast<int64_t>(number));
+      if (key == "delay_us") {
+        profile.delay = duration;
+      } else if (key == "jitter_us") {
+        profile.jitter = duration;
+      } else if (key == "loss") {
+        profile.loss = number;
+      } else if (key == "loss_burst") {
+        profile.loss_burst = number;
+      } else if (key == "reorder") {
+        profile.reorder = number;
+      } else if (key == "reorder_us") {
+        profile.reorder_hold = duration;
+      } else if (key == "reply_loss") {
+        profile.reply_loss = number;
+      } else if (key == "seed") {
+        profile.seed = static_cast<uint32_t>(number);
+      } else {
+        error = "Unknown key " + key + " in the fault profile";
+        return false;
+      }
+    }
+    if (profile.loss_burst < 1) {
+      error = "loss_burst of the fault profile must be at least 1";
+      return false;
+    }
+    if (profile.reorder > 0 && profile.reorder_hold.count() == 0) {
+      error = "reorder_us of the fault profile must be set if reorder is enabled";
+      return false;
+    }
+    return true;
+  }
+
+  explicit FaultInjector(const Profile & profile)
+  : profile_(profile), generator_(profile.seed)
+  {
+  }
+
+  const Profile & GetProfile() const {return profile_;}
+
+  const Stats & GetStats() const {return stats_;}
+
+  // Counters for the log, not meant for the control loop
+  std::string Summary() const
+  {
+    return std::to_string(stats_.dropped) + " of " + std::to_string(stats_.received) +
+           " received datagrams lost, " + std::to_string(stats_.delayed) + " delayed, " +
+           std::to_string(stats_.reordered) + " reordered, " + std::to_string(stats_.overflows) +
+           " overflows, " + std::to_string(stats_.replies_dropped) + " of " +
+           std::to_string(stats_.sent) + " replies lost";
+  }
+
+  // Decides whether the next received datagram is lost
+  bool DropReceived()
+  {
+    ++stats_.received;
+    // Once in a loss, the burst continues with the probability giving the mean burst length
+    const double probability = in_loss_burst_ ? 1 - 1 / profile_.loss_burst : profile_.loss;
+    in_loss_burst_ = probability > 0 && Uniform() < probability;
+    stats_.dropped += in_loss_burst_;
+    return in_loss_burst_;
+  }
+
+  /**
+   * @brief Time at which a datagram received at arrival is delivered
+   * Datagrams that are not held back are delivered in the order of their arrival, as on a link
+   *  with a varying latency
+   */
+  std::chrono::steady_clock::time_point ReleaseTime(std::chrono::steady_clock::time_point arrival)
+  {
+    auto release = arrival + profile_.delay;
+    if (profile_.jitter.count() > 0) {
+      release += std::chrono::nanoseconds(
+        static_cast<int64_t>(
+          Uniform() *
+          static_cast<double>(std::chrono::nanoseconds(profile_.jitter).count())));
+    }
+    if (profile_.reorder > 0 && Uniform() < profile_.reorder) {
+      ++stats_.reordered;
+      return release + profile_.reorder_hold;
+    }
+    release = std::max(release, last_release_);
+    last_release_ = release;
+    stats_.delayed += release > arrival;
+    return release;
+  }
+
+  // Keeps a copy of the datagram until the release time, false if all slots are occupied
+  bool Hold(
+    const char * data, std::size_t size, std::chrono::steady_clock::time_point release,
+    std::chrono::system_clock::time_point kernel_timestamp)
+  {
+    if (held_ == SLOTS) {
+      ++stats_.overflows;
+      return false;
+    }
+    Slot & slot = slots_[held_++];
+    slot.size = size < SLOT_SIZE ? size : SLOT_SIZE;
+    std::memcpy(slot.data.data(), data, slot.size);
+    slot.release = release;
+    slot.kernel_timestamp = kernel_timestamp;
+    slot.order = next_order_++;
+    return true;
+  }
+
+  /**
+   * @brief Copies the first datagram due at now into the buffer, longer ones are truncated
+   * @return false if no datagram is due
+   */
+  bool Release(
+    std::chrono::steady_clock::time_point now, char * buffer, std::size_t size,
+    std::size_t & bytes, std::chrono::system_clock::time_point & kernel_timestamp)
+  {
+    const std::size_t next = Next();
+    if (next == held_ || slots_[next].release > now) {
+      return false;
+    }
+    const Slot & slot = slots_[next];
+    bytes = std::min(slot.size, size);
+    std::memcpy(buffer, slot.data.data(), bytes);
+    kernel_timestamp = slot.kernel_timestamp;
+    // The last slot takes the place of the released one
+    if (next != held_ - 1) {
+      slots_[next] = slots_[held_ - 1];
+    }
+    --held_;
+    return true;
+  }
+
+  // Release time of the next held datagram, time_point::max() if there is none
+  std::chrono::steady_clock::time_point NextRelease() const
+  {
+    const std::size_t next = Next();
+    return next == held_ ? std::chrono::steady_clock::time_point::max() : slots_[next].release;
+  }
+
+  bool Empty() const {return held_ == 0;}
+
+  // Decides whether the next sent datagram is lost
+  bool DropSent()
+  {
+    ++stats_.sent;
+    const bool drop = profile_.reply_loss > 0 && Uniform() < profile_.reply_loss;
+    stats_.replies_dropped += drop;
+    return drop;
+  }
+
+private:
+  struct Slot
+  {
+    std::array<char, SLOT_SIZE> data;
+    std::size_t size = 0;
+    std::chrono::steady_clock::time_point release;
+    std::chrono::system_clock::time_point kernel_timestamp;
+    uint64_t order = 0;
+  };
+
+  double Uniform() {return distribution_(generator_);}
+
+  // Index of the held datagram with the earliest release, of the earliest arrival among equal
+  std::size_t Next() const
+  {
+    std::size_t next = held_;
+    for (std::size_t i = 0; i < held_; ++i) {
+      if (next == held_ || slots_[i].release < slots_[next].release ||
+        (slots_[i].release == slots_[next].release && slots_[i].order < slots_[next].order))
+      {
+        next = i;
+      }
+    }
+    return next;
+  }
+
+  Profile profile_;
+  Stats stats_;
+  std::mt19937 generator_;
+  std::uniform_real_distribution<double> distribution_{0.0, 1.0};
+  bool in_loss_burst_ = false;
+  std::chrono::steady_clock::time_point last_release_;
+
+  std::array<Slot, SLOTS> slots_;
+  std::size_t held_ = 0;
+  uint64_t next_order_ = 0;
+};
+
+/**
+ * @brief Creates the injector if the fault_profile hardware parameter is set, see ParseProfile()
+ * @returns false with the reason in error if the profile is invalid
+ */
+inline bool ConfigureFaultInjection(
+  const std::unordered_map<std::string, std::string> & parameters,
+  std::unique_ptr<FaultInjector> & injector, std::string & error)
+{
+  auto param = parameters.find("fault_profile");
+  if (param == parameters.end() || param->second.empty()) {
+    return true;
+  }
+  FaultInjector::Profile profile;
+  if (!FaultInjector::ParseProfile(param->second, profile, error)) {
+    return false;
+  }
+  injector = std::make_unique<FaultInjector>(profile);
+  return true;
+}
+}  // namespace kuka_drivers_core
+
+#endif  // KUKA_DRIVERS_CORE__FAULT_INJECTION_HPP_
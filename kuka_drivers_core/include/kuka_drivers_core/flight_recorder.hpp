@@ -0,0 +1,280 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_DRIVERS_CORE__FLIGHT_RECORDER_HPP_
+#define KUKA_DRIVERS_CORE__FLIGHT_RECORDER_HPP_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "kuka_drivers_core/hardware_parameters.hpp"
+
+namespace kuka_drivers_core
+{
+/**
+ * @brief Records one fixed-size record per control cycle into a memory-mapped ring file,
+ *  which can be dumped with flight_recorder_dump after a fault.
+ *
+ * The hardware interface fills Current() during read() and write() and calls Commit() once
+ * per cycle, which copies the record into the next slot of the mapping. There are no system
+ * calls, locks or allocations, the pages are populated when the file is opened. The file
+ * is written by the kernel also if the process crashes, the oldest cycles are overwritten
+ * when the ring is full. Only one thread may record.
+ */
+class FlightRecorder
+{
+public:
+  static constexpr std::size_t MAX_JOINTS = 12;
+
+  // Flags of a cycle, the bits from DRIVER upwards are defined by the drivers
+  enum Flag : uint32_t
+  {
+    RECEIVED = 1 << 0,
+    SENT = 1 << 1,
+    MISSED = 1 << 2,
+    ERROR = 1 << 3,
+    DRIVER = 1 << 16
+  };
+
+  struct Record
+  {
+    // IPOC or sequence counter of the message of the cycle
+    uint64_t counter;
+    // CLOCK_MONOTONIC (steady_clock) time of the receive and of the send, 0 if not done
+    int64_t receive_time_ns;
+    int64_t send_time_ns;
+    uint32_t flags;
+    // Control mode of the driver
+    uint16_t mode;
+    uint16_t joint_count;
+    double states[MAX_JOINTS];
+    // Joint commands of the active control mode
+    double commands[MAX_JOINTS];
+  };
+
+  struct FileHeader
+  {
+    char magic[8];
+    uint32_t record_size;
+    uint32_t reserved;
+    uint64_t slot_count;
+    std::atomic<uint64_t> next_sequence;
+  };
+
+  struct Slot
+  {
+    // Sequence number + 1 of the cycle, 0 while the slot is written or was never used
+    std::atomic<uint64_t> sequence;
+    Record record;
+  };
+
+  /**
+   * @brief Create (or overwrite) the recorder file
+   * @throws std::runtime_error if the file cannot be created or mapped
+   */
+  FlightRecorder(const std::string & path, std::size_t slot_count)
+  : slot_count_(std::max<std::size_t>(slot_count, 1))
+  {
+    size_ = sizeof(FileHeader) + slot_count_ * sizeof(Slot);
+    const int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+      throw std::runtime_error("Error opening recorder file " + path + ": " + strerror(errno));
+    }
+    if (ftruncate(fd, static_cast<off_t>(size_)) < 0) {
+      close(fd);
+      throw std::runtime_error("Error resizing recorder file " + path + ": " + strerror(errno));
+    }
+    void * mapping = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+      throw std::runtime_error("Error mapping recorder file " + path + ": " + strerror(errno));
+    }
+    base_ = static_cast<char *>(mapping);
+
+    header_ = new(base_) FileHeader;
+    std::memcpy(header_->magic, Magic(), sizeof(header_->magic));
+    header_->record_size = sizeof(Record);
+    header_->reserved = 0;
+    header_->slot_count = slot_count_;
+    header_->next_sequence.store(0, std::memory_order_relaxed);
+    slots_ = reinterpret_cast<Slot *>(base_ + sizeof(FileHeader));
+    for (std::size_t i = 0; i < slot_count_; ++i) {
+      new(&slots_[i]) Slot;
+      slots_[i].sequence.store(0, std::memory_order_relaxed);
+    }
+    Clear();
+  }
+
+  ~FlightRecorder()
+  {
+    msync(base_, size_, MS_ASYNC);
+    munmap(base_, size_);
+  }
+
+  FlightRecorder(const FlightRecorder &) = delete;
+  FlightRecorder & operator=(const FlightRecorder &) = delete;
+
+  // Record of the running cycle, written to the file by Commit()
+  Record & Current() {return current_;}
+
+  void SetStates(const double * values, std::size_t count)
+  {
+    count = count < MAX_JOINTS ? count : MAX_JOINTS;
+    std::copy_n(values, count, current_.states);
+    current_.joint_count =
+      static_cast<uint16_t>(std::max<std::size_t>(current_.joint_count, count));
+  }
+
+  void SetCommands(const double * values, std::size_t count)
+  {
+    count = count < MAX_JOINTS ? count : MAX_JOINTS;
+    std::copy_n(values, count, current_.commands);
+    current_.joint_count =
+      static_cast<uint16_t>(std::max<std::size_t>(current_.joint_count, count));
+  }
+
+  // Write the record of the cycle into the ring and start a new one
+  void Commit()
+  {
+    const uint64_t sequence = header_->next_sequence.load(std::memory_order_relaxed);
+    Slot & target = slots_[sequence % slot_count_];
+
+    target.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(&target.record, &current_, sizeof(Record));
+    target.sequence.store(sequence + 1, std::memory_order_release);
+    header_->next_sequence.store(sequence + 1, std::memory_order_relaxed);
+    Clear();
+  }
+
+  static int64_t Now()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  struct Cycle
+  {
+    uint64_t sequence;
+    Record record;
+  };
+
+  /**
+   * @brief Read the cycles of a recorder file in recording order
+   * @throws std::runtime_error if the file cannot be read or has a wrong format
+   */
+  static std::vector<Cycle> ReadFile(const std::string & path)
+  {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::runtime_error("Error opening recorder file " + path + ": " + strerror(errno));
+    }
+    const off_t file_size = lseek(fd, 0, SEEK_END);
+    void * mapping = file_size >= static_cast<off_t>(sizeof(FileHeader)) ?
+      mmap(nullptr, static_cast<std::size_t>(file_size), PROT_READ, MAP_SHARED, fd, 0) :
+      MAP_FAILED;
+    close(fd);
+    if (mapping == MAP_FAILED) {
+      throw std::runtime_error("Error mapping recorder file " + path);
+    }
+    const char * base = static_cast<const char *>(mapping);
+    const auto * header = reinterpret_cast<const FileHeader *>(base);
+
+    std::vector<Cycle> cycles;
+    const bool valid = std::memcmp(header->magic, Magic(), sizeof(header->magic)) == 0 &&
+      header->record_size == sizeof(Record) &&
+      sizeof(FileHeader) + header->slot_count * sizeof(Slot) <= static_cast<uint64_t>(file_size);
+    const auto * slots = reinterpret_cast<const Slot *>(base + sizeof(FileHeader));
+    for (uint64_t i = 0; valid && i < header->slot_count; ++i) {
+      const uint64_t sequence = slots[i].sequence.load(std::memory_order_acquire);
+      if (sequence == 0) {
+        continue;
+      }
+      Cycle cycle;
+      cycle.sequence = sequence - 1;
+      std::memcpy(&cycle.record, &slots[i].record, sizeof(Record));
+      cycle.record.joint_count = std::min<uint16_t>(cycle.record.joint_count, MAX_JOINTS);
+      cycles.push_back(cycle);
+    }
+    munmap(mapping, static_cast<std::size_t>(file_size));
+    if (!valid) {
+      throw std::runtime_error("Invalid recorder file " + path);
+    }
+
+    std::sort(
+      cycles.begin(), cycles.end(), [](const Cycle & a, const Cycle & b) {
+        return a.sequence < b.sequence;
+      });
+    return cycles;
+  }
+
+private:
+  static const char * Magic() {return "KDFREC01";}
+
+  void Clear()
+  {
+    std::memset(&current_, 0, sizeof(Record));
+  }
+
+  std::size_t slot_count_;
+  std::size_t size_ = 0;
+  char * base_ = nullptr;
+  FileHeader * header_ = nullptr;
+  Slot * slots_ = nullptr;
+  Record current_;
+};
+
+/**
+ * @brief Creates the recorder if the flight_recorder_file hardware parameter is set,
+ *  flight_recorder_cycles gives the number of cycles kept (default: 60000)
+ * @returns false with the reason in error if the parameters are invalid or the file cannot be
+ *  created
+ */
+inline bool ConfigureFlightRecorder(
+  const std::unordered_map<std::string, std::string> & parameters,
+  std::unique_ptr<FlightRecorder> & recorder, std::string & error)
+{
+  HardwareParameters checked(parameters);
+  const std::string path = checked.String("flight_recorder_file");
+  std::size_t cycles = 60000;
+  if (path.empty()) {
+    return true;
+  }
+  if (!checked.Get("flight_recorder_cycles", cycles, 1)) {
+    error = checked.Error();
+    return false;
+  }
+  try {
+    recorder = std::make_unique<FlightRecorder>(path, cycles);
+  } catch (const std::exception & ex) {
+    error = ex.what();
+    return false;
+  }
+  return true;
+}
+}  // namespace kuka_drivers_core
+
+#endif  // KUKA_DRIVERS_CORE__FLIGHT_RECORDER_HPP_
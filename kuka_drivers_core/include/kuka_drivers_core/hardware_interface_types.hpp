@@ -25,6 +25,12 @@ static constexpr char HW_IF_STIFFNESS[] = "stiffness";
 static constexpr char HW_IF_DAMPING[] = "damping";
 // Constant defining external torque interface
 static constexpr char HW_IF_EXTERNAL_TORQUE[] = "external_torque";
+// Constant defining the joint position commanded by the controller
+static constexpr char HW_IF_COMMANDED_POSITION[] = "commanded_position";
+// Constant defining the joint torque commanded by the controller
+static constexpr char HW_IF_COMMANDED_EFFORT[] = "commanded_effort";
+// Constant defining the joint position of the robot controller interpolator
+static constexpr char HW_IF_IPO_POSITION[] = "ipo_position";
 
 /* Interface prefixes */
 // Constant defining prefix for I/O interfaces
@@ -33,6 +39,20 @@ static constexpr char IO_PREFIX[] = "gpio";
 static constexpr char CONFIG_PREFIX[] = "runtime_config";
 // Constant defining prefix for fri state
 static constexpr char FRI_STATE_PREFIX[] = "fri_state";
+// Constant defining prefix for rsi state
+static constexpr char RSI_STATE_PREFIX[] = "rsi_state";
+// Constant defining prefix for eac state
+static constexpr char EAC_STATE_PREFIX[] = "eac_state";
+// Constant defining prefix for the measured Cartesian pose
+static constexpr char CARTESIAN_STATE_PREFIX[] = "cartesian_state";
+// Constant defining prefix for Cartesian correction commands
+static constexpr char CARTESIAN_CORRECTION_PREFIX[] = "cartesian_correction";
+// Constant defining prefix for absolute Cartesian pose commands
+static constexpr char CARTESIAN_COMMAND_PREFIX[] = "cartesian_command";
+// Constant defining prefix for Cartesian velocity commands
+static constexpr char TWIST_COMMAND_PREFIX[] = "twist_command";
+// Constant defining prefix for Cartesian force and torque commands
+static constexpr char WRENCH_COMMAND_PREFIX[] = "wrench_command";
 
 /* Configuration interfaces */
 // Constant defining control_mode configuration interface
@@ -49,6 +69,70 @@ static constexpr char OPERATION_MODE[] = "operation_mode";
 static constexpr char DRIVE_STATE[] = "drive_state";
 static constexpr char OVERLAY_TYPE[] = "overlay_type";
 static constexpr char TRACKING_PERFORMANCE[] = "tracking_performance";
+// Timestamp of the last monitoring message, set by the controller
+static constexpr char TIMESTAMP_SEC[] = "timestamp_sec";
+static constexpr char TIMESTAMP_NANOSEC[] = "timestamp_nanosec";
+// Host receive time minus controller timestamp in seconds, includes the offset of the clocks
+static constexpr char RECEIVE_LATENCY[] = "receive_latency";
+// Controller time from a monitoring message to the first one reflecting its answer in seconds
+static constexpr char ROUND_TRIP_LATENCY[] = "round_trip_latency";
+// Time from the arrival of a monitoring message to the send of its answer in seconds
+static constexpr char HOST_LATENCY[] = "host_latency";
+// Answers reflected by a later monitoring message than the next one, since activation
+static constexpr char LATE_ANSWERS[] = "late_answers";
+
+/* RSI state interfaces */
+static constexpr char IPOC_DELTA[] = "ipoc_delta";
+static constexpr char MISSED_CYCLES[] = "missed_cycles";
+static constexpr char DUPLICATE_PACKETS[] = "duplicate_packets";
+static constexpr char OUT_OF_ORDER_PACKETS[] = "out_of_order_packets";
+static constexpr char LATE_PACKETS[] = "late_packets";
+static constexpr char EXTRAPOLATED_CYCLES[] = "extrapolated_cycles";
+
+/* EAC state interfaces, besides the packet counters of RSI */
+static constexpr char MEASURED_CYCLE_TIME[] = "measured_cycle_time";
+// Number of times external control was re-established after an error of the controller
+static constexpr char CONTROL_RECOVERIES[] = "control_recoveries";
+// Time from the error until the first request of the re-opened control channel in seconds
+static constexpr char RECOVERY_TIME[] = "recovery_time";
+// 1 while the gRPC channel to the controller is connected, 0 otherwise
+static constexpr char GRPC_CONNECTED[] = "grpc_connected";
+
+/* Clock synchronization state interfaces of all drivers, see ClockSync */
+// Estimated steady clock time of the host in seconds the controller sent the last state
+static constexpr char STATE_STAMP[] = "state_stamp";
+// Estimated time from sending the last state until its reception on the host in seconds
+static constexpr char ONE_WAY_LATENCY[] = "one_way_latency";
+// Rate difference of the clocks of the controller and the host in ppm
+static constexpr char CLOCK_DRIFT[] = "clock_drift";
+
+/* Cartesian interfaces: position in meters, KUKA A, B, C Euler angles in radians */
+static constexpr char CARTESIAN_X[] = "x";
+static constexpr char CARTESIAN_Y[] = "y";
+static constexpr char CARTESIAN_Z[] = "z";
+static constexpr char CARTESIAN_A[] = "a";
+static constexpr char CARTESIAN_B[] = "b";
+static constexpr char CARTESIAN_C[] = "c";
+
+/* Twist interfaces: linear velocity in m/s, angular velocity in rad/s */
+static constexpr char TWIST_LINEAR_X[] = "linear.x";
+static constexpr char TWIST_LINEAR_Y[] = "linear.y";
+static constexpr char TWIST_LINEAR_Z[] = "linear.z";
+static constexpr char TWIST_ANGULAR_X[] = "angular.x";
+static constexpr char TWIST_ANGULAR_Y[] = "angular.y";
+static constexpr char TWIST_ANGULAR_Z[] = "angular.z";
+
+/* Wrench interfaces: force in N, torque in Nm */
+static constexpr char WRENCH_FORCE_X[] = "force.x";
+static constexpr char WRENCH_FORCE_Y[] = "force.y";
+static constexpr char WRENCH_FORCE_Z[] = "force.z";
+static constexpr char WRENCH_TORQUE_X[] = "torque.x";
+static constexpr char WRENCH_TORQUE_Y[] = "torque.y";
+static constexpr char WRENCH_TORQUE_Z[] = "torque.z";
+// Torques around the axes of the KUKA A, B, C Euler angles, as expected by FRI
+static constexpr char WRENCH_TORQUE_A[] = "torque.a";
+static constexpr char WRENCH_TORQUE_B[] = "torque.b";
+static constexpr char WRENCH_TORQUE_C[] = "torque.c";
 
 
 }  // namespace hardware_interface
@@ -0,0 +1,227 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_DRIVERS_CORE__HARDWARE_PARAMETERS_HPP_
+#define KUKA_DRIVERS_CORE__HARDWARE_PARAMETERS_HPP_
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <initializer_list>
+#include <limits>
+#include <locale>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+namespace kuka_drivers_core
+{
+/**
+ * @brief Checked conversion of the hardware parameters of a driver
+ *
+ * The value of a numeric parameter must be a number as a whole, integers for integral types, and
+ * is read independent of the locale. Flags must be 'true' or 'false', choices one of the given
+ * values. A missing or empty parameter keeps the value, an invalid one too, and its error is kept
+ * until the end of the parsing: on_init() reads the parameters one after the other and checks
+ * Ok() once. Only the first error is kept.
+ */
+class HardwareParameters
+{
+  template<typename T>
+  struct NonDeduced
+  {
+    using type = T;
+  };
+
+public:
+  explicit HardwareParameters(const std::unordered_map<std::string, std::string> & parameters)
+  : parameters_(parameters) {}
+
+  /**
+   * @brief Reads an optional numeric parameter in [min, max]
+   * @return false if the parameter is set, but invalid
+   */
+  template<typename T>
+  bool Get(
+    const std::string & name, T & value,
+    typename NonDeduced<T>::type min = std::numeric_limits<T>::lowest(),
+    typename NonDeduced<T>::type max = std::numeric_limits<T>::max())
+  {
+    auto param = parameters_.find(name);
+    if (param == parameters_.end() || param->second.empty()) {
+      return true;
+    }
+    return Convert(param->second, value, min, max) || Fail(name, min, max);
+  }
+
+  // Durations are given as a count of their unit, not negative unless min allows it
+  template<typename Rep, typename Period>
+  bool Get(
+    const std::string & name, std::chrono::duration<Rep, Period> & value,
+    typename NonDeduced<Rep>::type min = 0,
+    typename NonDeduced<Rep>::type max = std::numeric_limits<Rep>::max())
+  {
+    Rep count = value.count();
+    if (!Get(name, count, min, max)) {
+      return false;
+    }
+    value = std::chrono::duration<Rep, Period>(count);
+    return true;
+  }
+
+  // Same as Get(), but a missing parameter is an error
+  template<typename T>
+  bool Require(
+    const std::string & name, T & value,
+    typename NonDeduced<T>::type min = std::numeric_limits<T>::lowest(),
+    typename NonDeduced<T>::type max = std::numeric_limits<T>::max())
+  {
+    auto param = parameters_.find(name);
+    if (param == parameters_.end() || param->second.empty()) {
+      if (error_.empty()) {
+        error_ = name + " must be set";
+      }
+      return false;
+    }
+    return Get(name, value, min, max);
+  }
+
+  // Reads an optional 'true' or 'false'
+  bool GetFlag(const std::string & name, bool & value)
+  {
+    return GetChoice(name, value, {{"true", true}, {"false", false}});
+  }
+
+  /**
+   * @brief Reads an optional parameter with one of a fixed set of values
+   * @param choices: the accepted texts and their values
+   */
+  template<typename T>
+  bool GetChoice(
+    const std::string & name, T & value,
+    std::initializer_list<std::pair<const char *, T>> choices)
+  {
+    auto param = parameters_.find(name);
+    if (param == parameters_.end() || param->second.empty()) {
+      return true;
+    }
+    std::string accepted;
+    std::size_t index = 0;
+    for (const auto & choice : choices) {
+      if (param->second == choice.first) {
+        value = choice.second;
+        return true;
+      }
+      if (index > 0) {
+        accepted += index + 1 == choices.size() ? " or " : ", ";
+      }
+      accepted += std::string("'") + choice.first + "'";
+      ++index;
+    }
+    if (error_.empty()) {
+      error_ = name + " must be " + accepted;
+    }
+    return false;
+  }
+
+  // Text of a parameter, the fallback if it is missing
+  std::string String(const std::string & name, const std::string & fallback = "") const
+  {
+    auto param = parameters_.find(name);
+    return param != parameters_.end() ? param->second : fallback;
+  }
+
+  bool Ok() const {return error_.empty();}
+
+  // The first invalid parameter, empty if all were valid
+  const std::string & Error() const {return error_;}
+
+  /**
+   * @brief Checked conversion of a single value, e.g. the initial value of an interface
+   * @return false if the text is not a number in [min, max], the value is kept then
+   */
+  template<typename T>
+  static bool Convert(
+    const std::string & text, T & value,
+    typename NonDeduced<T>::type min = std::numeric_limits<T>::lowest(),
+    typename NonDeduced<T>::type max = std::numeric_limits<T>::max())
+  {
+    static_assert(std::is_arithmetic<T>::value, "Numeric parameters only");
+    // Parsed in the widest type of the same kind, so the range check sees out of range values
+    using Wide = typename std::conditional<
+      std::is_floating_point<T>::value, long double,
+      typename std::conditional<std::is_signed<T>::value, long long, unsigned long long>::type
+      >::type;
+    Wide wide;
+    // The range check is not enough, NaN compares false to every bound
+    if (!Parse(text, wide) || !std::isfinite(static_cast<long double>(wide)) ||
+      wide < static_cast<Wide>(min) || wide > static_cast<Wide>(max))
+    {
+      return false;
+    }
+    value = static_cast<T>(wide);
+    return true;
+  }
+
+private:
+  template<typename Wide>
+  static bool Parse(const std::string & text, Wide & value)
+  {
+    // The stream accepts "-1" for an unsigned value and wraps it around
+    if (std::is_unsigned<Wide>::value && text.find('-') != std::string::npos) {
+      return false;
+    }
+    std::istringstream stream(text);
+    stream.imbue(std::locale::classic());
+    stream >> value;
+    if (stream.fail()) {
+      return false;
+    }
+    stream >> std::ws;
+    return stream.eof();
+  }
+
+  template<typename T>
+  bool Fail(const std::string & name, T min, T max)
+  {
+    if (!error_.empty()) {
+      return false;
+    }
+    const bool has_min = min != std::numeric_limits<T>::lowest() &&
+      !(std::is_unsigned<T>::value && min == 0);
+    const bool has_max = max != std::numeric_limits<T>::max();
+    std::ostringstream message;
+    message.imbue(std::locale::classic());
+    message << name << " must be " << (!std::is_integral<T>::value ? "a number" :
+      std::is_unsigned<T>::value && !has_min ? "a non-negative integer" : "an integer");
+    // Promoted, so that char sized types are not printed as characters
+    if (has_min && has_max) {
+      message << " between " << +min << " and " << +max;
+    } else if (has_min) {
+      message << " of at least " << +min;
+    } else if (has_max) {
+      message << " of at most " << +max;
+    }
+    error_ = message.str();
+    return false;
+  }
+
+  const std::unordered_map<std::string, std::string> & parameters_;
+  std::string error_;
+};
+}  // namespace kuka_drivers_core
+
+#endif  // KUKA_DRIVERS_CORE__HARDWARE_PARAMETERS_HPP_
@@ -0,0 +1,120 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_DRIVERS_CORE__INTERFACE_STORAGE_HPP_
+#define KUKA_DRIVERS_CORE__INTERFACE_STORAGE_HPP_
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "hardware_interface/handle.hpp"
+
+namespace kuka_drivers_core
+{
+/**
+ * @brief One block of memory for the per-joint state and command interfaces of a robot
+ *
+ * A field is one interface (e.g. position) of all components (the joints). The values of a field
+ *  are contiguous and every field starts on a cache line, the states come before the commands:
+ *
+ *  | state 0: j0 j1 ... pad | state 1: j0 j1 ... pad | ... | command 0: j0 j1 ... pad | ...
+ *
+ * so copying a field from or into a message is one linear pass over aligned memory, which the
+ *  compiler can vectorize, and a cycle touches a few lines instead of separately allocated
+ *  vectors. The fields are added before Allocate(), the views returned after it stay valid until
+ *  the storage is destroyed or allocated again.
+ */
+class InterfaceStorage
+{
+public:
+  static constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+  /**
+   * @brief Non-owning view of the values of a field, used like the vector it replaces
+   */
+  class Values
+  {
+public:
+    Values() = default;
+    Values(double * data, std::size_t size)
+    : data_(data), size_(size) {}
+
+    double & operator[](std::size_t i) const {return data_[i];}
+    double * data() const {return data_;}
+    std::size_t size() const {return size_;}
+    bool empty() const {return size_ == 0;}
+    double * begin() const {return data_;}
+    double * end() const {return data_ + size_;}
+
+private:
+    double * data_ = nullptr;
+    std::size_t size_ = 0;
+  };
+
+  // Decides whether the interface of a field is exported for the component with the given index
+  using ExportFilter = std::function<bool (std::size_t component, const std::string & interface)>;
+
+  InterfaceStorage() = default;
+
+  InterfaceStorage(const InterfaceStorage &) = delete;
+  InterfaceStorage & operator=(const InterfaceStorage &) = delete;
+
+  // Adds a state interface field and returns its index, the values start at initial_value
+  std::size_t AddState(const std::string & interface, double initial_value = 0.0);
+
+  // Adds a command interface field and returns its index, the values start at initial_value
+  std::size_t AddCommand(const std::string & interface, double initial_value = 0.0);
+
+  // Allocates the block for the components (the joint names) and sets the initial values
+  void Allocate(const std::vector<std::string> & components);
+
+  Values State(std::size_t field) const;
+  Values Command(std::size_t field) const;
+
+  // All state (or command) values, including the padding between the fields
+  Values States() const;
+  Values Commands() const;
+
+  std::size_t Components() const {return components_.size();}
+
+  // Appends an interface per component and field, in the order of the components
+  void ExportStateInterfaces(
+    std::vector<hardware_interface::StateInterface> & interfaces,
+    const ExportFilter & filter = ExportFilter()) const;
+  void ExportCommandInterfaces(
+    std::vector<hardware_interface::CommandInterface> & interfaces,
+    const ExportFilter & filter = ExportFilter()) const;
+
+private:
+  struct Field
+  {
+    std::string interface;
+    double initial_value;
+  };
+
+  // Values of a field including the padding to the next cache line
+  std::size_t Stride() const;
+
+  std::vector<std::string> components_;
+  std::vector<Field> states_;
+  std::vector<Field> commands_;
+  // Over-allocated by a cache line, data_ is the aligned start inside it
+  std::vector<double> buffer_;
+  double * data_ = nullptr;
+};
+}  // namespace kuka_drivers_core
+
+#endif  // KUKA_DRIVERS_CORE__INTERFACE_STORAGE_HPP_
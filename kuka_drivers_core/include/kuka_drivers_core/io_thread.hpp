@@ -0,0 +1,91 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_DRIVERS_CORE__IO_THREAD_HPP_
+#define KUKA_DRIVERS_CORE__IO_THREAD_HPP_
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace kuka_drivers_core
+{
+/**
+ * @brief Thread exchanging the messages of a driver outside of the control loop
+ *
+ * With the inline I/O of the hardware interfaces, read() waits for the message of the
+ *  controller, so the network jitter adds up with the update time of the controllers. The I/O
+ *  thread owns the socket instead: it waits for the messages, decodes them into a TripleBuffer
+ *  and answers them with the newest commands of another TripleBuffer, read() and write() only
+ *  swap the buffers. The controllers then work on the newest state at their own rate, the
+ *  messages are answered in any case.
+ *
+ * The cycle function is called in a loop until it returns false or Stop() is called, it must
+ *  return at least every few milliseconds (e.g. waiting with a timeout) to notice the stop.
+ */
+class IOThread
+{
+public:
+  struct Options
+  {
+    bool enabled = false;
+    // SCHED_FIFO priority, 0 keeps the scheduling of the creating thread
+    int priority = 0;
+    // CPU the thread is pinned to, -1 for no pinning
+    int cpu = -1;
+  };
+
+  /**
+   * @brief Reads the io_thread, io_thread_priority and io_thread_cpu hardware parameters
+   *  (default: false, 0 and -1)
+   * @return false with the reason in error if they are invalid
+   */
+  static bool ParseOptions(
+    const std::unordered_map<std::string, std::string> & parameters, Options & options,
+    std::string & error);
+
+  IOThread() = default;
+  ~IOThread() {Stop();}
+
+  IOThread(const IOThread &) = delete;
+  IOThread & operator=(const IOThread &) = delete;
+
+  // Starts calling cycle on a new thread, a running thread is stopped first
+  void Start(std::function<bool()> cycle, const Options & options);
+
+  // Waits for the current call of the cycle function to return
+  void Stop();
+
+  // The cycle function has not returned false since Start()
+  bool Running() const {return running_.load(std::memory_order_acquire);}
+
+  /**
+   * @brief Applies the priority and the CPU of the options to the calling thread
+   * @return false with the reason in error if the scheduling could not be changed
+   */
+  static bool ConfigureCurrentThread(const Options & options, std::string & error);
+
+private:
+  void Run(const Options & options);
+
+  std::function<bool()> cycle_;
+  std::atomic<bool> stop_{false};
+  std::atomic<bool> running_{false};
+  std::thread thread_;
+};
+}  // namespace kuka_drivers_core
+
+#endif  // KUKA_DRIVERS_CORE__IO_THREAD_HPP_
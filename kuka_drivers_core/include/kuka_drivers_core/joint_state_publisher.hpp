@@ -0,0 +1,114 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_DRIVERS_CORE__JOINT_STATE_PUBLISHER_HPP_
+#define KUKA_DRIVERS_CORE__JOINT_STATE_PUBLISHER_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "rclcpp/rclcpp.hpp"
+#include "sensor_msgs/msg/joint_state.hpp"
+
+#include "kuka_drivers_core/spsc_queue.hpp"
+
+namespace kuka_drivers_core
+{
+/**
+ * @brief Publishes the joint states of a hardware interface at a fraction of the control rate
+ *
+ * Update() is called in every read(), every decimation-th call copies the states into a
+ *  lock-free queue, without locks, allocations or system calls. A separate thread with its own
+ *  node takes the latest snapshot and publishes it as sensor_msgs/JointState, into a loaned
+ *  message if the middleware supports loaning, otherwise from a preallocated message. The
+ *  control loop can therefore run at the full rate while the joint states are published for
+ *  visualization at e.g. 100 Hz, without a joint_state_broadcaster in the control loop.
+ */
+class JointStatePublisher
+{
+public:
+  static constexpr std::size_t MAX_JOINTS = 12;
+
+  /**
+   * @param node_name: name of the node of the publisher thread
+   * @param topic: topic of the joint states
+   * @param joint_names: names of the joints, at most MAX_JOINTS are published
+   * @param decimation: every decimation-th update is published
+   */
+  JointStatePublisher(
+    const std::string & node_name, const std::string & topic,
+    const std::vector<std::string> & joint_names, std::size_t decimation);
+  ~JointStatePublisher();
+
+  JointStatePublisher(const JointStatePublisher &) = delete;
+  JointStatePublisher & operator=(const JointStatePublisher &) = delete;
+
+  /**
+   * @brief Called from the control loop in every cycle, velocities and efforts can be nullptr
+   *  if the driver does not provide them
+   */
+  void Update(const double * positions, const double * velocities, const double * efforts);
+
+  // Number of snapshots not taken over by the publisher thread in time
+  uint64_t Dropped() const {return dropped_.load(std::memory_order_relaxed);}
+
+private:
+  struct Snapshot
+  {
+    // CLOCK_REALTIME time of the update, the stamp of the message
+    int64_t stamp_ns;
+    bool has_velocities;
+    bool has_efforts;
+    double positions[MAX_JOINTS];
+    double velocities[MAX_JOINTS];
+    double efforts[MAX_JOINTS];
+  };
+
+  void PublishLoop();
+  void Fill(const Snapshot & snapshot, sensor_msgs::msg::JointState & message) const;
+
+  std::vector<std::string> joint_names_;
+  std::size_t decimation_;
+  std::size_t cycle_ = 0;
+
+  SPSCQueue<Snapshot, 4> queue_;
+  std::atomic<uint64_t> dropped_{0};
+
+  rclcpp::Node::SharedPtr node_;
+  rclcpp::Publisher<sensor_msgs::msg::JointState>::SharedPtr publisher_;
+  sensor_msgs::msg::JointState message_;
+
+  std::atomic<bool> terminate_{false};
+  std::thread publish_thread_;
+};
+
+/**
+ * @brief Creates the publisher if the joint_state_decimation hardware parameter is set to a
+ *  positive value, the topic is given by joint_state_topic (default: joint_states)
+ * @param hardware_name: name of the hardware, the node is <hardware_name>_joint_state_publisher
+ * @returns false with the reason in error if the parameters are invalid
+ */
+bool ConfigureJointStatePublisher(
+  const std::unordered_map<std::string, std::string> & parameters,
+  const std::string & hardware_name, const std::vector<std::string> & joint_names,
+  std::unique_ptr<JointStatePublisher> & publisher, std::string & error);
+}  // namespace kuka_drivers_core
+
+#endif  // KUKA_DRIVERS_CORE__JOINT_STATE_PUBLISHER_HPP_
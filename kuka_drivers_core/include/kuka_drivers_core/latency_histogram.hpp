@@ -0,0 +1,152 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_DRIVERS_CORE__LATENCY_HISTOGRAM_HPP_
+#define KUKA_DRIVERS_CORE__LATENCY_HISTOGRAM_HPP_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace kuka_drivers_core
+{
+/**
+ * @brief Fixed-bucket latency histogram that can be filled from a real-time thread
+ *  and read concurrently from any other thread.
+ *
+ * Recording is a few relaxed atomic increments, nothing is allocated or locked.
+ * Values above the range of the histogram are counted in the last bucket.
+ *
+ * @tparam BucketCount: number of buckets, including the overflow bucket
+ * @tparam BucketWidthNs: width of one bucket in nanoseconds
+ */
+template<std::size_t BucketCount = 1000, uint64_t BucketWidthNs = 10000>
+class LatencyHistogram
+{
+public:
+  /**
+   * @brief Copy of the histogram content at a given time, differences of snapshots
+   *  give the distribution in the time window between them
+   */
+  struct Snapshot
+  {
+    std::array<uint64_t, BucketCount> buckets{};
+    uint64_t count = 0;
+    // Maximum since the start of the histogram, also in a difference
+    uint64_t max_ns = 0;
+    // Maximum of the samples counted in the snapshot, the same as max_ns in a snapshot of the
+    //  histogram. In a difference it is exact if the maximum since the start grew in the window,
+    //  otherwise the upper bound of the highest non-empty bucket, at most max_ns.
+    uint64_t interval_max_ns = 0;
+
+    /**
+     * @brief Returns the upper bound of the bucket containing the given percentile
+     * @param percentile: requested percentile in the [0, 100] range
+     */
+    uint64_t Percentile(double percentile) const
+    {
+      if (count == 0) {
+        return 0;
+      }
+      const uint64_t rank = static_cast<uint64_t>(percentile / 100.0 * (count - 1)) + 1;
+      uint64_t cumulative = 0;
+      for (std::size_t i = 0; i < BucketCount; ++i) {
+        cumulative += buckets[i];
+        if (cumulative >= rank) {
+          return (i + 1) * BucketWidthNs;
+        }
+      }
+      return BucketCount * BucketWidthNs;
+    }
+
+    Snapshot operator-(const Snapshot & other) const
+    {
+      Snapshot result;
+      for (std::size_t i = 0; i < BucketCount; ++i) {
+        result.buckets[i] = buckets[i] - other.buckets[i];
+      }
+      result.count = count - other.count;
+      result.max_ns = max_ns;
+      if (max_ns > other.max_ns) {
+        result.interval_max_ns = max_ns;
+      } else {
+        for (std::size_t i = BucketCount; i > 0; --i) {
+          if (result.buckets[i - 1] > 0) {
+            result.interval_max_ns = i < BucketCount && i * BucketWidthNs < max_ns ?
+              i * BucketWidthNs : max_ns;
+            break;
+          }
+        }
+      }
+      return result;
+    }
+  };
+
+  LatencyHistogram() {Reset();}
+
+  LatencyHistogram(const LatencyHistogram &) = delete;
+  LatencyHistogram & operator=(const LatencyHistogram &) = delete;
+
+  void Record(uint64_t latency_ns)
+  {
+    std::size_t index = static_cast<std::size_t>(latency_ns / BucketWidthNs);
+    if (index >= BucketCount) {
+      index = BucketCount - 1;
+    }
+    buckets_[index].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t max = max_ns_.load(std::memory_order_relaxed);
+    while (latency_ns > max &&
+      !max_ns_.compare_exchange_weak(max, latency_ns, std::memory_order_relaxed))
+    {
+    }
+  }
+
+  /**
+   * @brief Reads the histogram, the buckets are read one by one, so the snapshot
+   *  might contain a few samples more than count if recording is in progress
+   */
+  Snapshot GetSnapshot() const
+  {
+    Snapshot snapshot;
+    snapshot.count = count_.load(std::memory_order_relaxed);
+    for (std::size_t i = 0; i < BucketCount; ++i) {
+      snapshot.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    }
+    snapshot.max_ns = max_ns_.load(std::memory_order_relaxed);
+    snapshot.interval_max_ns = snapshot.max_ns;
+    return snapshot;
+  }
+
+  /**
+   * @brief Clears the histogram, should not be called concurrently with Record()
+   */
+  void Reset()
+  {
+    for (auto & bucket : buckets_) {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    max_ns_.store(0, std::memory_order_relaxed);
+  }
+
+private:
+  std::array<std::atomic<uint64_t>, BucketCount> buckets_;
+  std::atomic<uint64_t> count_;
+  std::atomic<uint64_t> max_ns_;
+};
+}  // namespace kuka_drivers_core
+
+#endif  // KUKA_DRIVERS_CORE__LATENCY_HISTOGRAM_HPP_
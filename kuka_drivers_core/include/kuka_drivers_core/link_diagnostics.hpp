@@ -0,0 +1,148 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_DRIVERS_CORE__LINK_DIAGNOSTICS_HPP_
+#define KUKA_DRIVERS_CORE__LINK_DIAGNOSTICS_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "diagnostic_msgs/msg/diagnostic_array.hpp"
+#include "rclcpp/rclcpp.hpp"
+
+#include "kuka_drivers_core/spsc_queue.hpp"
+
+namespace kuka_drivers_core
+{
+/**
+ * @brief Windowed statistics and degradation alerts of the link quality metrics of a driver
+ *
+ * Update() is called in every read() with the current values of the metrics, it only aggregates
+ *  them into batches of BATCH_PERIOD and hands the batches over through a lock-free queue,
+ *  without locks, allocations or system calls. A separate thread with its own node keeps the
+ *  batches of the last window and publishes one DiagnosticStatus on /diagnostics per period.
+ *
+ * Level metrics (e.g. the FRI connection quality) are reported with their mean, minimum and
+ *  the slope of a line fitted to the batch means. The status is a warning not only if the current
+ *  value crosses the warning threshold, but also if the trend reaches the error threshold within
+ *  one window, so that a slowly degrading network is reported before the session is lost.
+ *  Counter metrics (e.g. missed cycles) are cumulative, the rate of their increase is checked.
+ */
+class LinkDiagnostics
+{
+public:
+  static constexpr std::size_t MAX_METRICS = 8;
+  static constexpr std::chrono::milliseconds BATCH_PERIOD{100};
+
+  enum class Kind
+  {
+    LEVEL,
+    COUNTER
+  };
+
+  struct Metric
+  {
+    std::string name;
+    Kind kind;
+    // Thresholds of the value for levels, of the rate per second for counters
+    double warning_threshold;
+    double error_threshold;
+    // Levels can be worse if lower (quality) or if higher (latency), counters are worse if higher
+    bool lower_is_worse;
+  };
+
+  /**
+   * @param hardware_name: name of the hardware, used in the name of the node and the status
+   * @param metrics: metrics in the order of the values given to Update(), at most MAX_METRICS
+   * @param window: length of the window of the statistics
+   * @param publish_period: period of the diagnostics message
+   */
+  LinkDiagnostics(
+    const std::string & hardware_name, const std::vector<Metric> & metrics,
+    std::chrono::milliseconds window, std::chrono::milliseconds publish_period);
+  ~LinkDiagnostics();
+
+  LinkDiagnostics(const LinkDiagnostics &) = delete;
+  LinkDiagnostics & operator=(const LinkDiagnostics &) = delete;
+
+  /**
+   * @brief Called from the control loop in every cycle with one value per metric
+   */
+  void Update(const double * values);
+
+  // Number of batches not taken over by the publisher thread in time
+  uint64_t Dropped() const {return dropped_.load(std::memory_order_relaxed);}
+
+private:
+  struct Batch
+  {
+    int64_t start_ns;
+    int64_t end_ns;
+    uint32_t samples;
+    // Sum of the values for levels, sum of the increases for counters
+    double sum[MAX_METRICS];
+    double min[MAX_METRICS];
+    double max[MAX_METRICS];
+  };
+
+  static int64_t Now();
+  void PublishLoop();
+  diagnostic_msgs::msg::DiagnosticStatus Evaluate() const;
+
+  std::string hardware_name_;
+  std::vector<Metric> metrics_;
+  std::chrono::milliseconds window_;
+  std::chrono::milliseconds publish_period_;
+
+  // Batch being aggregated by the control loop
+  Batch current_{};
+  // Previous values of the counters, a decrease (reset of the counter) is not counted
+  double previous_[MAX_METRICS] = {};
+  bool has_previous_ = false;
+  SPSCQueue<Batch, 32> queue_;
+  std::atomic<uint64_t> dropped_{0};
+
+  // Batches of the last window, only used by the publisher thread
+  std::deque<Batch> batches_;
+
+  rclcpp::Node::SharedPtr node_;
+  rclcpp::Publisher<diagnostic_msgs::msg::DiagnosticArray>::SharedPtr publisher_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool terminate_ = false;
+  std::thread publish_thread_;
+};
+
+/**
+ * @brief Creates the link diagnostics if the link_diagnostics_period_ms hardware parameter is
+ *  set to a positive value, the window is given by link_diagnostics_window_s (default: 10)
+ * @returns false with the reason in error if the parameters are invalid
+ */
+bool ConfigureLinkDiagnostics(
+  const std::unordered_map<std::string, std::string> & parameters,
+  const std::string & hardware_name, const std::vector<LinkDiagnostics::Metric> & metrics,
+  std::unique_ptr<LinkDiagnostics> & diagnostics, std::string & error);
+}  // namespace kuka_drivers_core
+
+#endif  // KUKA_DRIVERS_CORE__LINK_DIAGNOSTICS_HPP_
@@ -0,0 +1,179 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_DRIVERS_CORE__METRICS_EXPORTER_HPP_
+#define KUKA_DRIVERS_CORE__METRICS_EXPORTER_HPP_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace kuka_drivers_core
+{
+/**
+ * @brief Serves the performance counters of the drivers of a process for Prometheus
+ *
+ * The counters, gauges and histograms are updated from the control loop with relaxed atomics,
+ *  without locks or allocations. A separate thread answers GET /metrics over HTTP with the
+ *  current values in the text exposition format (which OpenMetrics scrapers accept as well).
+ *  Every component (e.g. a hardware interface) adds its metrics in a Group, labelled with
+ *  component="<name>". The groups of all components of the process are served on one port,
+ *  the first Start() opens it.
+ */
+class MetricsExporter
+{
+public:
+  class Counter
+  {
+public:
+    void Add(uint64_t increase = 1) {value_.fetch_add(increase, std::memory_order_relaxed);}
+    // For totals counted by the driver anyway, e.g. the missed cycles of the cycle monitor
+    void Set(uint64_t value) {value_.store(value, std::memory_order_relaxed);}
+    uint64_t Value() const {return value_.load(std::memory_order_relaxed);}
+
+private:
+    std::atomic<uint64_t> value_{0};
+  };
+
+  class Gauge
+  {
+public:
+    void Set(double value) {value_.store(value, std::memory_order_relaxed);}
+    double Value() const {return value_.load(std::memory_order_relaxed);}
+
+private:
+    std::atomic<double> value_{0.0};
+  };
+
+  /**
+   * @brief Durations in fixed buckets from 50 us to 10 s, exported in seconds
+   */
+  class Histogram
+  {
+public:
+    static constexpr std::size_t BUCKETS = 15;
+    // Upper bounds of the buckets in nanoseconds
+    static const std::array<uint64_t, BUCKETS> & Bounds();
+
+    void Record(uint64_t duration_ns);
+
+private:
+    friend class MetricsExporter;
+    // Not cumulative, the last one counts the durations above the highest bound
+    std::array<std::atomic<uint64_t>, BUCKETS + 1> buckets_{};
+    std::atomic<uint64_t> sum_ns_{0};
+  };
+
+  /**
+   * @brief The metrics of a component, served from the construction until the destruction
+   *
+   * The metrics are added before the control loop starts, the returned references stay valid
+   *  for the lifetime of the group. The names get the "kuka_" prefix, counters should end with
+   *  "_total" and histograms with "_seconds".
+   */
+  class Group
+  {
+public:
+    explicit Group(const std::string & component);
+    ~Group();
+
+    Group(const Group &) = delete;
+    Group & operator=(const Group &) = delete;
+
+    Counter & AddCounter(const std::string & name, const std::string & help);
+    Gauge & AddGauge(const std::string & name, const std::string & help);
+    Histogram & AddHistogram(const std::string & name, const std::string & help);
+    // Read on every request, e.g. for existing atomic counters, must not block
+    void AddCounter(
+      const std::string & name, const std::string & help, std::function<uint64_t()> read);
+
+private:
+    friend class MetricsExporter;
+
+    enum class Type
+    {
+      COUNTER,
+      GAUGE,
+      HISTOGRAM
+    };
+
+    struct Entry
+    {
+      std::string name;
+      std::string help;
+      Type type;
+      const Counter * counter;
+      const Gauge * gauge;
+      const Histogram * histogram;
+      std::function<uint64_t()> read;
+    };
+
+    std::string component_;
+    std::deque<Counter> counters_;
+    std::deque<Gauge> gauges_;
+    std::deque<Histogram> histograms_;
+    std::vector<Entry> entries_;
+  };
+
+  static MetricsExporter & Instance();
+
+  ~MetricsExporter();
+
+  /**
+   * @brief Starts serving on the address and port, if not serving yet
+   * @returns false with the reason in error if the socket cannot be opened, or if the process
+   *  already serves on another port
+   */
+  bool Start(const std::string & address, uint16_t port, std::string & error);
+
+  bool Serving() const;
+
+  // The metrics of all groups in the text exposition format
+  std::string Render() const;
+
+private:
+  MetricsExporter() = default;
+
+  void ServeLoop();
+
+  mutable std::mutex mutex_;
+  std::vector<const Group *> groups_;
+  int socket_ = -1;
+  uint16_t port_ = 0;
+  std::atomic<bool> terminate_{false};
+  std::thread serve_thread_;
+};
+
+/**
+ * @brief Creates the metrics group of a hardware interface and starts the exporter if the
+ *  metrics_port hardware parameter is set to a positive value, metrics_address defaults to
+ *  0.0.0.0
+ * @returns false with the reason in error if the parameters are invalid or the port cannot be
+ *  opened
+ */
+bool ConfigureMetrics(
+  const std::unordered_map<std::string, std::string> & parameters,
+  const std::string & component, std::unique_ptr<MetricsExporter::Group> & group,
+  std::string & error);
+}  // namespace kuka_drivers_core
+
+#endif  // KUKA_DRIVERS_CORE__METRICS_EXPORTER_HPP_
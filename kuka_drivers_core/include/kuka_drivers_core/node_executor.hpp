@@ -0,0 +1,47 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_DRIVERS_CORE__NODE_EXECUTOR_HPP_
+#define KUKA_DRIVERS_CORE__NODE_EXECUTOR_HPP_
+
+#include <memory>
+
+#include "kuka_drivers_core/ros2_base_lc_node.hpp"
+
+namespace kuka_drivers_core
+{
+/**
+ * @brief Spins a robot manager with the executor selected by its executor parameter
+ *
+ * - multi_threaded: every callback group is dispatched by one MultiThreadedExecutor
+ * - dedicated_threads: each dedicated callback group of the node is dispatched by a
+ *   SingleThreadedExecutor on its own thread, so e.g. a service response awaited in a mode
+ *   switch is handled as soon as it arrives instead of waiting in the wait set of the shared
+ *   threads behind parameter requests and timers. The other groups, including the ones created
+ *   later, are dispatched by a MultiThreadedExecutor on the calling thread.
+ */
+class NodeExecutor
+{
+public:
+  explicit NodeExecutor(std::shared_ptr<ROS2BaseLCNode> node);
+
+  // Returns after rclcpp::shutdown()
+  void Spin();
+
+private:
+  std::shared_ptr<ROS2BaseLCNode> node_;
+};
+}  // namespace kuka_drivers_core
+
+#endif  // KUKA_DRIVERS_CORE__NODE_EXECUTOR_HPP_
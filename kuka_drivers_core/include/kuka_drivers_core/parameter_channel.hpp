@@ -0,0 +1,83 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KUKA_DRIVERS_CORE__PARAMETER_CHANNEL_HPP_
+#define KUKA_DRIVERS_CORE__PARAMETER_CHANNEL_HPP_
+
+#include <mutex>
+
+#include "kuka_drivers_core/triple_buffer.hpp"
+
+namespace kuka_drivers_core
+{
+/**
+ * @brief Hands snapshots of tuning parameters from parameter callbacks to the control loop
+ *
+ * The callbacks publish a complete snapshot, the control loop takes over the newest one with
+ *  Update() at the start of a cycle and reads it through Current() until the next one, so the
+ *  values never change in the middle of a cycle and the loop never waits for a callback.
+ *  The snapshots are only copied by the publishers, taking one over swaps the index of a
+ *  TripleBuffer, without locks or allocations; a snapshot may contain containers then.
+ *
+ * @tparam T: copyable snapshot
+ */
+template<typename T>
+class ParameterChannel
+{
+public:
+  explicit ParameterChannel(const T & initial = T())
+  : latest_(initial)
+  {
+    buffer_.Back() = initial;
+    buffer_.Publish();
+    buffer_.Update();
+  }
+
+  ParameterChannel(const ParameterChannel &) = delete;
+  ParameterChannel & operator=(const ParameterChannel &) = delete;
+
+  // The last published snapshot, the base of the next change, not real-time safe
+  T Latest() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return latest_;
+  }
+
+  // Publishes a new snapshot from any non real-time thread
+  void Publish(const T & snapshot)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    latest_ = snapshot;
+    buffer_.Back() = snapshot;
+    buffer_.Publish();
+  }
+
+  /**
+   * @brief Takes over the newest snapshot, called only from the control loop between cycles
+   * @returns true if a new snapshot was published since the last call
+   */
+  bool Update() {return buffer_.Update();}
+
+  // Snapshot taken over by the last Update(), valid until the next one
+  const T & Current() const {return buffer_.Front();}
+
+private:
+  mutable std::mutex mutex_;
+  T latest_;
+  TripleBuffer<T> buffer_;
+};
+}  // namespace kuka_drivers_core
+
+#endif  // KUKA_DRIVERS_CORE__PARAMETER_CHANNEL_HPP_
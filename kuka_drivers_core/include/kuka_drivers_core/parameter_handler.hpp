@@ -18,6 +18,8 @@
 #include <functional>
 #include <memory>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "rclcpp/node_interfaces/node_parameters_interface.hpp"
@@ -87,6 +89,11 @@ public:
       return paramIF_;
     }
 
+    bool hasType(const rclcpp::Parameter & param) const
+    {
+      return param.get_type() == default_value_.get_type();
+    }
+
     virtual void blockParameter() = 0;
 
     virtual bool callCallback(const rclcpp::Parameter &) const {return false;}
@@ -149,6 +156,20 @@ public:
     const std::vector<rclcpp::Parameter> & parameters) const;
   bool canSetParameter(const ParameterBase & param) const;
 
+  /**
+   * @brief Register functions called before and after the callbacks of a parameter batch
+   *
+   * The callbacks of a batch can collect their side effects in begin and apply them
+   *  together in end, which gets whether all callbacks succeeded and returns whether
+   *  applying the collected effects succeeded.
+   *
+   * A batch is applied as a whole or not at all: if a callback fails, the callbacks already
+   *  called are called again with the previous values of their parameters before end(false)
+   *  drops the collected effects. If end fails, all callbacks are called with the previous
+   *  values between begin and end(true), so that the previous state is applied again.
+   */
+  void registerBatchHooks(std::function<void()> begin, std::function<bool(bool)> end);
+
   template<typename T>
   void registerParameter(
     const std::string & name, const T & value, const ParameterSetAccessRights & rights,
@@ -173,9 +194,15 @@ public:
   }
 
 private:
-  std::vector<std::shared_ptr<ParameterBase>> params_;
+  std::unordered_map<std::string, std::shared_ptr<ParameterBase>> params_;
+  std::vector<std::pair<std::function<void()>, std::function<bool(bool)>>> batch_hooks_;
   rclcpp_lifecycle::LifecycleNode * node_;
   void registerParameter(std::shared_ptr<ParameterBase> param_shared_ptr, bool block);
+  // Calls the callbacks of the first applied parameters with their previous values
+  void rollBack(
+    const std::vector<const ParameterBase *> & params,
+    const std::vector<rclcpp::Parameter> & previous_values, std::size_t applied,
+    rcl_interfaces::msg::SetParametersResult & result) const;
 };
 }  // namespace kuka_drivers_core
 
@@ -71,8 +71,19 @@ public:
       name, value, rights,
       on_change_callback, this->get_node_parameters_interface(), true);
   }
+
+  void registerBatchHooks(std::function<void()> begin, std::function<bool(bool)> end)
+  {
+    param_handler_.registerBatchHooks(begin, end);
+  }
   const ParameterHandler & getParameterHandler() const;
 
+  // Mutually exclusive group for callbacks that must not wait behind the others, e.g. the
+  //  responses awaited in transitions, dispatched by its own thread with the dedicated_threads
+  //  executor of NodeExecutor
+  rclcpp::CallbackGroup::SharedPtr createDedicatedCallbackGroup();
+  const std::vector<rclcpp::CallbackGroup::SharedPtr> & getDedicatedCallbackGroups() const;
+
 protected:
   rclcpp::node_interfaces::OnSetParametersCallbackHandle::SharedPtr ParamCallback() const;
   static const rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn SUCCESS =
@@ -85,6 +96,7 @@ protected:
 private:
   ParameterHandler param_handler_;
   rclcpp::node_interfaces::OnSetParametersCallbackHandle::SharedPtr param_callback_;
+  std::vector<rclcpp::CallbackGroup::SharedPtr> dedicated_callback_groups_;
 };
 
 }  // namespace kuka_drivers_core
@@ -56,6 +56,11 @@ public:
       on_change_callback, this->get_node_parameters_interface(), true);
   }
 
+  void registerBatchHooks(std::function<void()> begin, std::function<bool(bool)> end)
+  {
+    param_handler_.registerBatchHooks(begin, end);
+  }
+
 protected:
   rclcpp::node_interfaces::OnSetParametersCallbackHandle::SharedPtr ParamCallback() const;
 
@@ -0,0 +1,341 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_DRIVERS_CORE__RT_LOG_HPP_
+#define KUKA_DRIVERS_CORE__RT_LOG_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+
+#include "kuka_drivers_core/spsc_queue.hpp"
+
+namespace kuka_drivers_core
+{
+/**
+ * @brief Preallocated log ring for the real-time thread.
+ *
+ * Log() only copies the format string and the arguments into a fixed-size slot, the message
+ * is formatted by the non real-time thread calling Drain(). It never blocks, allocates or
+ * writes to a stream, so the format string must be a literal, string arguments are copied.
+ * LogV() formats immediately and is meant for va_list interfaces of vendored code.
+ * Messages are truncated to the slot size and dropped if the ring is full, the number of
+ * dropped messages is returned by the next Drain().
+ */
+class RTLog
+{
+public:
+  // Number of slots, at most kCapacity - 1 messages are kept
+  static constexpr std::size_t kCapacity = 64;
+  // Number of arguments of a deferred message
+  static constexpr std::size_t kMaxArguments = 6;
+  static constexpr std::size_t kTextSize = 128;
+
+  enum class Level
+  {
+    INFO,
+    WARN,
+    ERROR
+  };
+
+  struct Argument
+  {
+    enum class Type : uint8_t
+    {
+      SIGNED,
+      UNSIGNED,
+      FLOATING,
+      STRING,
+      POINTER
+    };
+
+    Type type;
+    union {
+      long long signed_value;
+      unsigned long long unsigned_value;
+      double floating_value;
+      // Offset of the copied string in Entry::text
+      std::size_t string_offset;
+      const void * pointer_value;
+    };
+  };
+
+  struct Entry
+  {
+    Level level;
+    // nullptr if text holds the formatted message
+    const char * format;
+    std::size_t argument_count;
+    Argument arguments[kMaxArguments];
+    char text[kTextSize];
+  };
+
+  // Called only from the real-time thread
+  template<typename ... Args>
+  void Log(Level level, const char * format, const Args & ... args)
+  {
+    static_assert(sizeof...(Args) <= kMaxArguments, "Too many arguments for a log message");
+    Entry entry;
+    entry.level = level;
+    entry.format = format;
+    entry.argument_count = 0;
+    std::size_t text_size = 0;
+    // Expands to one Store() call per argument, in order
+    int expand[] = {0, (Store(entry, text_size, args), 0)...};
+    (void)expand;
+    (void)text_size;
+    Push(entry);
+  }
+
+  void LogV(Level level, const char * format, va_list args)
+  {
+    Entry entry;
+    entry.level = level;
+    entry.format = nullptr;
+    entry.argument_count = 0;
+    std::vsnprintf(entry.text, sizeof(entry.text), format, args);
+    Push(entry);
+  }
+
+  /**
+   * @brief Pass the queued messages to the function, called only from the consumer thread
+   * @param function: callable with (Level, const char *) arguments
+   * @returns the number of messages dropped since the last call
+   */
+  template<typename Function>
+  std::size_t Drain(Function function)
+  {
+    Entry entry;
+    char message[256];
+    while (queue_.Pop(entry)) {
+      if (entry.format == nullptr) {
+        function(entry.level, entry.text);
+      } else {
+        Format(entry, message, sizeof(message));
+        function(entry.level, message);
+      }
+    }
+    return dropped_.exchange(0, std::memory_order_relaxed);
+  }
+
+private:
+  void Push(const Entry & entry)
+  {
+    if (!queue_.Push(entry)) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  template<typename T>
+  static void Store(Entry & entry, std::size_t &, const T & value)
+  {
+    static_assert(
+      std::is_arithmetic<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value,
+      "Only numbers, enums, pointers and strings can be logged");
+    Argument & argument = entry.arguments[entry.argument_count++];
+    StoreValue(argument, value);
+  }
+
+  static void Store(Entry & entry, std::size_t & text_size, const char * value)
+  {
+    Argument & argument = entry.arguments[entry.argument_count++];
+    argument.type = Argument::Type::STRING;
+    argument.string_offset = text_size;
+    const std::size_t length =
+      value == nullptr ? 0 : strnlen(value, kTextSize - 1 - text_size);
+    if (length > 0) {
+      std::memcpy(entry.text + text_size, value, length);
+    }
+    text_size += length;
+    entry.text[text_size] = '\0';
+    if (text_size < kTextSize - 1) {
+      ++text_size;
+    }
+  }
+
+  static void Store(Entry & entry, std::size_t & text_size, char * value)
+  {
+    Store(entry, text_size, static_cast<const char *>(value));
+  }
+
+  template<typename T>
+  static typename std::enable_if<std::is_floating_point<T>::value>::type
+  StoreValue(Argument & argument, T value)
+  {
+    argument.type = Argument::Type::FLOATING;
+    argument.floating_value = value;
+  }
+
+  template<typename T>
+  static typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type
+  StoreValue(Argument & argument, T value)
+  {
+    argument.type = Argument::Type::SIGNED;
+    argument.signed_value = value;
+  }
+
+  template<typename T>
+  static typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value>::type
+  StoreValue(Argument & argument, T value)
+  {
+    argument.type = Argument::Type::UNSIGNED;
+    argument.unsigned_value = value;
+  }
+
+  template<typename T>
+  static typename std::enable_if<std::is_enum<T>::value>::type
+  StoreValue(Argument & argument, T value)
+  {
+    argument.type = Argument::Type::SIGNED;
+    argument.signed_value = static_cast<long long>(value);
+  }
+
+  template<typename T>
+  static typename std::enable_if<std::is_pointer<T>::value>::type
+  StoreValue(Argument & argument, T value)
+  {
+    argument.type = Argument::Type::POINTER;
+    argument.pointer_value = value;
+  }
+
+  // Formats the conversions one by one, the length modifiers of the format string are replaced
+  //  with the ones of the stored argument types
+  static void Format(const Entry & entry, char * message, std::size_t size)
+  {
+    std::size_t length = 0;
+    std::size_t next = 0;
+    const char * it = entry.format;
+    auto append = [&](int written) {
+        if (written > 0) {
+          length = std::min(length + static_cast<std::size_t>(written), size - 1);
+        }
+      };
+    message[0] = '\0';
+    while (*it != '\0' && length < size - 1) {
+      if (*it != '%') {
+        message[length++] = *it++;
+        message[length] = '\0';
+        continue;
+      }
+      if (it[1] == '%') {
+        message[length++] = '%';
+        message[length] = '\0';
+        it += 2;
+        continue;
+      }
+      // Flags, width and precision are kept
+      char spec[32] = "%";
+      std::size_t spec_length = 1;
+      ++it;
+      while (*it != '\0' && std::strchr("-+ #0123456789.", *it) != nullptr &&
+        spec_length < sizeof(spec) - 4)
+      {
+        spec[spec_length++] = *it++;
+      }
+      while (*it != '\0' && std::strchr("hljztL", *it) != nullptr) {
+        ++it;
+      }
+      const char conversion = *it;
+      if (conversion == '\0') {
+        break;
+      }
+      ++it;
+      if (next >= entry.argument_count) {
+        append(std::snprintf(message + length, size - length, "<missing>"));
+        continue;
+      }
+      const Argument & argument = entry.arguments[next++];
+      switch (argument.type) {
+        case Argument::Type::SIGNED:
+        case Argument::Type::UNSIGNED:
+          if (std::strchr("diouxXc", conversion) == nullptr) {
+            append(std::snprintf(message + length, size - length, "<invalid>"));
+            break;
+          }
+          spec[spec_length++] = 'l';
+          spec[spec_length++] = 'l';
+          spec[spec_length++] = conversion == 'c' ? 'd' : conversion;
+          spec[spec_length] = '\0';
+          if (argument.type == Argument::Type::SIGNED) {
+            append(std::snprintf(message + length, size - length, spec, argument.signed_value));
+          } else {
+            append(std::snprintf(message + length, size - length, spec, argument.unsigned_value));
+          }
+          break;
+        case Argument::Type::FLOATING:
+          if (std::strchr("fFeEgGaA", conversion) == nullptr) {
+            append(std::snprintf(message + length, size - length, "<invalid>"));
+            break;
+          }
+          spec[spec_length++] = conversion;
+          spec[spec_length] = '\0';
+          append(std::snprintf(message + length, size - length, spec, argument.floating_value));
+          break;
+        case Argument::Type::STRING:
+          spec[spec_length++] = 's';
+          spec[spec_length] = '\0';
+          append(
+            std::snprintf(
+              message + length, size - length, spec, entry.text + argument.string_offset));
+          break;
+        default:
+          append(std::snprintf(message + length, size - length, "%p", argument.pointer_value));
+      }
+    }
+  }
+
+  SPSCQueue<Entry, kCapacity> queue_;
+  std::atomic<std::size_t> dropped_{0};
+};
+
+/**
+ * @brief Rate limit of a log call site, used by KUKA_RT_LOG_THROTTLE
+ *
+ * Allow() returns true at most once per period and never blocks.
+ */
+class RTLogThrottle
+{
+public:
+  bool Allow(std::chrono::nanoseconds period)
+  {
+    const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+    int64_t last = last_.load(std::memory_order_relaxed);
+    if (last != 0 && now - last < period.count()) {
+      return false;
+    }
+    return last_.compare_exchange_strong(last, now, std::memory_order_relaxed);
+  }
+
+private:
+  std::atomic<int64_t> last_{0};
+};
+}  // namespace kuka_drivers_core
+
+// Logs at most once per period_ms from this call site, the throttle is shared by all instances
+#define KUKA_RT_LOG_THROTTLE(log, level, period_ms, ...) \
+  do { \
+    static kuka_drivers_core::RTLogThrottle kuka_rt_log_throttle; \
+    if (kuka_rt_log_throttle.Allow(std::chrono::milliseconds(period_ms))) { \
+      (log).Log(level, __VA_ARGS__); \
+    } \
+  } while (0)
+
+#endif  // KUKA_DRIVERS_CORE__RT_LOG_HPP_
@@ -0,0 +1,105 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_DRIVERS_CORE__RT_LOG_DRAIN_HPP_
+#define KUKA_DRIVERS_CORE__RT_LOG_DRAIN_HPP_
+
+#include <pthread.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "rclcpp/rclcpp.hpp"
+
+#include "kuka_drivers_core/rt_log.hpp"
+
+namespace kuka_drivers_core
+{
+/**
+ * @brief Background thread writing the messages of an RTLog to an rclcpp logger
+ *
+ * The thread runs with normal scheduling and drains the log every 10 ms, the remaining
+ * messages are written when it is stopped.
+ */
+class RTLogDrain
+{
+public:
+  RTLogDrain(RTLog & log, const std::string & logger_name)
+  : log_(log), logger_(rclcpp::get_logger(logger_name))
+  {
+  }
+  RTLogDrain(const RTLogDrain &) = delete;
+  RTLogDrain & operator=(const RTLogDrain &) = delete;
+
+  ~RTLogDrain() {Stop();}
+
+  void Start()
+  {
+    if (thread_.joinable()) {
+      return;
+    }
+    running_ = true;
+    thread_ = std::thread(
+      [this]() {
+        // Threads inherit the real-time scheduling of the control loop, which is not needed here
+        struct sched_param param;
+        param.sched_priority = 0;
+        pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+        while (running_) {
+          Drain();
+          std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+      });
+  }
+
+  void Stop()
+  {
+    running_ = false;
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+    Drain();
+  }
+
+private:
+  void Drain()
+  {
+    const std::size_t dropped = log_.Drain(
+      [this](RTLog::Level level, const char * text) {
+        switch (level) {
+          case RTLog::Level::INFO:
+            RCLCPP_INFO(logger_, "%s", text);
+            break;
+          case RTLog::Level::WARN:
+            RCLCPP_WARN(logger_, "%s", text);
+            break;
+          default:
+            RCLCPP_ERROR(logger_, "%s", text);
+        }
+      });
+    if (dropped > 0) {
+      RCLCPP_WARN(logger_, "%zu log messages of the control loop were dropped", dropped);
+    }
+  }
+
+  RTLog & log_;
+  rclcpp::Logger logger_;
+  std::thread thread_;
+  std::atomic<bool> running_{false};
+};
+}  // namespace kuka_drivers_core
+
+#endif  // KUKA_DRIVERS_CORE__RT_LOG_DRAIN_HPP_
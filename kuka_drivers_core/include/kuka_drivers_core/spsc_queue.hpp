@@ -0,0 +1,90 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_DRIVERS_CORE__SPSC_QUEUE_HPP_
+#define KUKA_DRIVERS_CORE__SPSC_QUEUE_HPP_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace kuka_drivers_core
+{
+/**
+ * @brief Bounded wait-free queue between exactly one producer and one consumer thread.
+ *
+ * Meant for handing events over to the real-time thread: Push() and Pop() never block,
+ * allocate or make system calls. One slot is kept free to tell a full queue from an empty one.
+ *
+ * @tparam T: copyable element type
+ * @tparam Capacity: number of slots, the queue holds at most Capacity - 1 elements
+ */
+template<typename T, std::size_t Capacity>
+class SPSCQueue
+{
+  static_assert(Capacity >= 2, "The queue needs at least 2 slots");
+
+public:
+  SPSCQueue() = default;
+  SPSCQueue(const SPSCQueue &) = delete;
+  SPSCQueue & operator=(const SPSCQueue &) = delete;
+
+  /**
+   * @brief Append an element, called only from the producer thread
+   * @returns false if the queue is full, the element is dropped then
+   */
+  bool Push(const T & element)
+  {
+    const std::size_t tail = tail_.load(std::memory_order_relaxed);
+    const std::size_t next = (tail + 1) % Capacity;
+    if (next == head_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    buffer_[tail] = element;
+    tail_.store(next, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Remove the oldest element, called only from the consumer thread
+   * @returns false if the queue is empty
+   */
+  bool Pop(T & element)
+  {
+    const std::size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    element = buffer_[head];
+    head_.store((head + 1) % Capacity, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Drop all elements, called only from the consumer thread
+   */
+  void Clear()
+  {
+    head_.store(tail_.load(std::memory_order_acquire), std::memory_order_release);
+  }
+
+private:
+  std::array<T, Capacity> buffer_{};
+  // The indices are written by different threads, keep them on separate cache lines
+  alignas(64) std::atomic<std::size_t> head_{0};
+  alignas(64) std::atomic<std::size_t> tail_{0};
+};
+}  // namespace kuka_drivers_core
+
+#endif  // KUKA_DRIVERS_CORE__SPSC_QUEUE_HPP_
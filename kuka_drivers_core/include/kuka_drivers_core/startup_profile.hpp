@@ -0,0 +1,116 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_DRIVERS_CORE__STARTUP_PROFILE_HPP_
+#define KUKA_DRIVERS_CORE__STARTUP_PROFILE_HPP_
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "diagnostic_msgs/msg/diagnostic_status.hpp"
+#include "rclcpp/rclcpp.hpp"
+
+namespace kuka_drivers_core
+{
+/**
+ * @brief Durations of the phases of a bring-up, for finding where the startup time goes
+ *
+ * The components of a cell (control_node, the hardware interfaces and the robot managers) each
+ *  record the phases of their part of the bring-up, e.g. on_init, the gRPC calls of the EAC
+ *  driver or the wait for the first packet, and log the summary as one line of JSON at its end.
+ *  The phases are in the order they started, nested phases are named with a slash (e.g.
+ *  "on_activate/first_packet"). The start of the bring-up is given as a steady clock timestamp,
+ *  which is shared by the processes of the host, so the summaries of the components can be put
+ *  on one timeline.
+ */
+class StartupProfile
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit StartupProfile(std::string component)
+  : component_(std::move(component)) {}
+
+  // The name in the summary, e.g. the hardware name known in on_init()
+  void SetComponent(const std::string & component);
+
+  // Forgets the phases of the last bring-up, the next one starts with its first phase
+  void Reset();
+
+  // Adds a finished phase, the first one after a reset starts the bring-up
+  void Add(const std::string & phase, Clock::time_point begin, Clock::time_point end);
+
+  /**
+   * @brief Adds the phase from the construction until Finish() or the end of the scope
+   */
+  class Scope
+  {
+public:
+    Scope(StartupProfile & profile, std::string phase)
+    : profile_(profile), phase_(std::move(phase)), begin_(Clock::now()) {}
+    ~Scope() {Finish();}
+
+    Scope(const Scope &) = delete;
+    Scope & operator=(const Scope &) = delete;
+
+    // Ends the phase before the end of the scope, e.g. to log the summary including it
+    void Finish()
+    {
+      if (!finished_) {
+        profile_.Add(phase_, begin_, Clock::now());
+        finished_ = true;
+      }
+    }
+
+private:
+    StartupProfile & profile_;
+    std::string phase_;
+    Clock::time_point begin_;
+    bool finished_ = false;
+  };
+
+  // Time from the start of the bring-up until the end of the last phase
+  std::chrono::nanoseconds Total() const;
+
+  // One line of JSON with the component, the start on the steady clock, the total and the phases
+  std::string Summary() const;
+
+  // Logs the summary as "Startup profile: {...}"
+  void Log(const rclcpp::Logger & logger) const;
+
+  // The phases and their durations in milliseconds as values, e.g. for ~/startup_profile
+  diagnostic_msgs::msg::DiagnosticStatus ToStatus(bool successful) const;
+
+private:
+  struct Phase
+  {
+    std::string name;
+    Clock::time_point begin;
+    Clock::time_point end;
+  };
+
+  std::chrono::nanoseconds TotalLocked() const;
+
+  mutable std::mutex mutex_;
+  std::string component_;
+  bool started_ = false;
+  Clock::time_point start_;
+  std::vector<Phase> phases_;
+};
+}  // namespace kuka_drivers_core
+
+#endif  // KUKA_DRIVERS_CORE__STARTUP_PROFILE_HPP_
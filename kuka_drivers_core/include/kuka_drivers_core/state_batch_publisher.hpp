@@ -0,0 +1,131 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KUKA_DRIVERS_CORE__STATE_BATCH_PUBLISHER_HPP_
+#define KUKA_DRIVERS_CORE__STATE_BATCH_PUBLISHER_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "kuka_driver_interfaces/msg/joint_state_batch.hpp"
+#include "rclcpp/rclcpp.hpp"
+
+#include "kuka_drivers_core/spsc_queue.hpp"
+
+namespace kuka_drivers_core
+{
+/**
+ * @brief Publishes every state of a hardware interface, batch_size consecutive samples in one
+ *  kuka_driver_interfaces/JointStateBatch message
+ *
+ * Update() is called in every read() with a new state and copies the sample into a lock-free
+ *  queue, without locks, allocations or system calls. A separate thread with its own node
+ *  collects the samples into a preallocated message and publishes it when batch_size samples
+ *  are in it. Unlike JointStatePublisher no sample is skipped, so logging and analysis get the
+ *  full-rate data, while the middleware handles one message per batch instead of per cycle.
+ */
+class StateBatchPublisher
+{
+public:
+  static constexpr std::size_t MAX_JOINTS = 12;
+  // Samples buffered for the publisher thread, about a second at 1 kHz
+  static constexpr std::size_t QUEUE_SIZE = 1024;
+
+  /**
+   * @param node_name: name of the node of the publisher thread
+   * @param topic: topic of the batches
+   * @param joint_names: names of the joints, at most MAX_JOINTS are published
+   * @param batch_size: number of samples in a message
+   */
+  StateBatchPublisher(
+    const std::string & node_name, const std::string & topic,
+    const std::vector<std::string> & joint_names, std::size_t batch_size);
+  ~StateBatchPublisher();
+
+  StateBatchPublisher(const StateBatchPublisher &) = delete;
+  StateBatchPublisher & operator=(const StateBatchPublisher &) = delete;
+
+  // Called from write() after sending, the commands are part of the sample of the next Update()
+  void SetCommands(const double * commands, std::size_t count);
+
+  /**
+   * @brief Called from the control loop with every new state, velocities and efforts can be
+   *  nullptr if the driver does not provide them
+   * @param counter: IPOC or sequence counter of the message of the state
+   * @param flags: driver specific flags of the sample, from JointStateBatch::DRIVER upwards
+   */
+  void Update(
+    uint64_t counter, uint32_t flags, const double * positions, const double * velocities,
+    const double * efforts);
+
+  // Number of samples not taken over by the publisher thread in time
+  uint64_t Dropped() const {return dropped_.load(std::memory_order_relaxed);}
+
+private:
+  struct Sample
+  {
+    // CLOCK_REALTIME time of the update, the stamp of the sample
+    int64_t stamp_ns;
+    uint64_t counter;
+    uint32_t flags;
+    bool has_velocities;
+    bool has_efforts;
+    double positions[MAX_JOINTS];
+    double velocities[MAX_JOINTS];
+    double efforts[MAX_JOINTS];
+    double commands[MAX_JOINTS];
+  };
+
+  void PublishLoop();
+  // Adds the sample to the message, the batch is published when it is full
+  void Append(const Sample & sample);
+
+  std::vector<std::string> joint_names_;
+  std::size_t batch_size_;
+
+  // Sample of the next update, the commands are kept until they are overwritten
+  Sample current_{};
+  bool commanded_ = false;
+
+  SPSCQueue<Sample, QUEUE_SIZE> queue_;
+  std::atomic<uint64_t> dropped_{0};
+
+  rclcpp::Node::SharedPtr node_;
+  rclcpp::Publisher<kuka_driver_interfaces::msg::JointStateBatch>::SharedPtr publisher_;
+  kuka_driver_interfaces::msg::JointStateBatch message_;
+  std::size_t sample_count_ = 0;
+
+  std::atomic<bool> terminate_{false};
+  std::thread publish_thread_;
+};
+
+/**
+ * @brief Creates the publisher if the state_batch_size hardware parameter is set to a positive
+ *  value, the topic is given by state_batch_topic (default: joint_state_batches)
+ * @param hardware_name: name of the hardware, the node is <hardware_name>_state_batch_publisher
+ * @returns false with the reason in error if the parameters are invalid
+ */
+bool ConfigureStateBatchPublisher(
+  const std::unordered_map<std::string, std::string> & parameters,
+  const std::string & hardware_name, const std::vector<std::string> & joint_names,
+  std::unique_ptr<StateBatchPublisher> & publisher, std::string & error);
+}  // namespace kuka_drivers_core
+
+#endif  // KUKA_DRIVERS_CORE__STATE_BATCH_PUBLISHER_HPP_
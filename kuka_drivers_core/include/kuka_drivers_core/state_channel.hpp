@@ -0,0 +1,273 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_DRIVERS_CORE__STATE_CHANNEL_HPP_
+#define KUKA_DRIVERS_CORE__STATE_CHANNEL_HPP_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace kuka_drivers_core
+{
+/**
+ * @brief Latest state and command of a hardware interface in a memory-mapped file, for
+ *  processes outside of ROS that need the state at the full cycle rate
+ *
+ * The hardware interface fills Current() and calls Publish() once per cycle in read(), which
+ *  copies the fixed-size sample into the mapping guarded by a sequence lock: the sequence is
+ *  odd while the sample is written. There are no system calls, locks or allocations, so the
+ *  cost is constant, readers never block the writer. Placing the file on a tmpfs (/dev/shm)
+ *  keeps it in memory. Only one thread may publish.
+ */
+class StateChannel
+{
+public:
+  static constexpr std::size_t MAX_JOINTS = 12;
+
+  struct Sample
+  {
+    // IPOC or sequence counter of the message of the cycle
+    uint64_t counter;
+    // CLOCK_MONOTONIC (steady_clock) time of the receive of the state
+    int64_t receive_time_ns;
+    // Control mode of the driver
+    uint16_t mode;
+    uint16_t joint_count;
+    uint32_t reserved;
+    double positions[MAX_JOINTS];
+    // Measured joint torques, if provided by the controller
+    double efforts[MAX_JOINTS];
+    // Estimated external joint torques, if provided by the controller
+    double external_efforts[MAX_JOINTS];
+    // Joint commands of the active control mode sent in the previous cycle
+    double commands[MAX_JOINTS];
+  };
+
+  struct FileHeader
+  {
+    char magic[8];
+    uint32_t sample_size;
+    uint32_t reserved;
+    // Number of the started and finished writes, odd while a sample is written
+    std::atomic<uint64_t> sequence;
+    Sample sample;
+  };
+
+  /**
+   * @brief Create (or overwrite) the channel file
+   * @throws std::runtime_error if the file cannot be created or mapped
+   */
+  StateChannel(const std::string & path, std::size_t joint_count)
+  {
+    const int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+      throw std::runtime_error("Error opening state channel " + path + ": " + strerror(errno));
+    }
+    // The file is not truncated, so that readers of a previous run keep a valid mapping
+    if (ftruncate(fd, static_cast<off_t>(sizeof(FileHeader))) < 0) {
+      close(fd);
+      throw std::runtime_error("Error resizing state channel " + path + ": " + strerror(errno));
+    }
+    void * mapping = mmap(
+      nullptr, sizeof(FileHeader), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+      throw std::runtime_error("Error mapping state channel " + path + ": " + strerror(errno));
+    }
+
+    header_ = new(mapping) FileHeader;
+    std::memcpy(header_->magic, Magic(), sizeof(header_->magic));
+    header_->sample_size = sizeof(Sample);
+    header_->reserved = 0;
+    // Continue the sequence of a previous run, an even value marks the sample as consistent
+    sequence_ = header_->sequence.load(std::memory_order_relaxed) & ~uint64_t(1);
+    std::memset(&current_, 0, sizeof(Sample));
+    current_.joint_count = static_cast<uint16_t>(std::min<std::size_t>(joint_count, MAX_JOINTS));
+    Publish();
+  }
+
+  ~StateChannel()
+  {
+    munmap(header_, sizeof(FileHeader));
+  }
+
+  StateChannel(const StateChannel &) = delete;
+  StateChannel & operator=(const StateChannel &) = delete;
+
+  // Sample of the running cycle, the values are kept until they are overwritten
+  Sample & Current() {return current_;}
+
+  void SetPositions(const double * values, std::size_t count)
+  {
+    Copy(values, count, current_.positions);
+  }
+
+  void SetEfforts(const double * values, std::size_t count)
+  {
+    Copy(values, count, current_.efforts);
+  }
+
+  void SetExternalEfforts(const double * values, std::size_t count)
+  {
+    Copy(values, count, current_.external_efforts);
+  }
+
+  void SetCommands(const double * values, std::size_t count)
+  {
+    Copy(values, count, current_.commands);
+  }
+
+  // Make the current sample visible to the readers
+  void Publish()
+  {
+    header_->sequence.store(sequence_ + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(&header_->sample, &current_, sizeof(Sample));
+    sequence_ += 2;
+    header_->sequence.store(sequence_, std::memory_order_release);
+  }
+
+  static int64_t Now()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  static const char * Magic() {return "KDSTCH01";}
+
+private:
+  void Copy(const double * values, std::size_t count, double * target)
+  {
+    std::copy_n(values, std::min<std::size_t>(count, current_.joint_count), target);
+  }
+
+  FileHeader * header_ = nullptr;
+  uint64_t sequence_ = 0;
+  Sample current_;
+};
+
+/**
+ * @brief Creates the channel if the state_channel_file hardware parameter is set
+ * @returns false with the reason in error if the file cannot be created
+ */
+inline bool ConfigureStateChannel(
+  const std::unordered_map<std::string, std::string> & parameters, std::size_t joint_count,
+  std::unique_ptr<StateChannel> & channel, std::string & error)
+{
+  auto param = parameters.find("state_channel_file");
+  if (param == parameters.end() || param->second.empty()) {
+    return true;
+  }
+  try {
+    channel = std::make_unique<StateChannel>(param->second, joint_count);
+  } catch (const std::exception & ex) {
+    error = ex.what();
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Reads the samples of a StateChannel published by a hardware interface in another
+ *  process
+ *
+ * Reading copies the sample and retries if the writer changed it in the meantime, the writer
+ *  is never waited for. The channel can be opened before the driver starts, if the file
+ *  exists, and stays valid while the driver restarts.
+ */
+class StateChannelReader
+{
+public:
+  /**
+   * @brief Map an existing channel file
+   * @throws std::runtime_error if the file cannot be opened or has a wrong format
+   */
+  explicit StateChannelReader(const std::string & path)
+  {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::runtime_error("Error opening state channel " + path + ": " + strerror(errno));
+    }
+    const off_t file_size = lseek(fd, 0, SEEK_END);
+    void * mapping = file_size >= static_cast<off_t>(sizeof(StateChannel::FileHeader)) ?
+      mmap(nullptr, sizeof(StateChannel::FileHeader), PROT_READ, MAP_SHARED, fd, 0) :
+      MAP_FAILED;
+    close(fd);
+    if (mapping == MAP_FAILED) {
+      throw std::runtime_error("Error mapping state channel " + path);
+    }
+    header_ = static_cast<const StateChannel::FileHeader *>(mapping);
+    if (std::memcmp(header_->magic, StateChannel::Magic(), sizeof(header_->magic)) != 0 ||
+      header_->sample_size != sizeof(StateChannel::Sample))
+    {
+      munmap(mapping, sizeof(StateChannel::FileHeader));
+      throw std::runtime_error("Invalid state channel " + path);
+    }
+  }
+
+  ~StateChannelReader()
+  {
+    munmap(const_cast<StateChannel::FileHeader *>(header_), sizeof(StateChannel::FileHeader));
+  }
+
+  StateChannelReader(const StateChannelReader &) = delete;
+  StateChannelReader & operator=(const StateChannelReader &) = delete;
+
+  /**
+   * @brief Copy the latest consistent sample
+   * @param sequence: set to the sequence of the sample, increasing with every publish
+   * @return false if the writer changed the sample during all attempts
+   */
+  bool Read(StateChannel::Sample & sample, uint64_t & sequence, int attempts = 100) const
+  {
+    for (int i = 0; i < attempts; ++i) {
+      const uint64_t before = header_->sequence.load(std::memory_order_acquire);
+      if ((before & 1) != 0) {
+        continue;
+      }
+      std::memcpy(&sample, &header_->sample, sizeof(StateChannel::Sample));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (header_->sequence.load(std::memory_order_relaxed) == before) {
+        sequence = before / 2;
+        sample.joint_count = std::min<uint16_t>(sample.joint_count, StateChannel::MAX_JOINTS);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Sequence of the latest published sample, for polling without copying it
+  uint64_t Sequence() const
+  {
+    return header_->sequence.load(std::memory_order_acquire) / 2;
+  }
+
+private:
+  const StateChannel::FileHeader * header_ = nullptr;
+};
+}  // namespace kuka_drivers_core
+
+#endif  // KUKA_DRIVERS_CORE__STATE_CHANNEL_HPP_
@@ -0,0 +1,85 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_DRIVERS_CORE__SWITCH_TRACE_HPP_
+#define KUKA_DRIVERS_CORE__SWITCH_TRACE_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "diagnostic_msgs/msg/diagnostic_status.hpp"
+#include "rclcpp/rclcpp.hpp"
+
+#include "kuka_drivers_core/metrics_exporter.hpp"
+
+namespace kuka_drivers_core
+{
+/**
+ * @brief Timestamps of the phases of a control mode switch, for measuring where its time goes
+ *
+ * A switch passes the robot manager (parameter callback, controller lists, SwitchController),
+ *  the controller manager, the hardware interface and the robot controller, which reports it
+ *  with events on another thread. Every phase is published right away on
+ *  ~/mode_switch_trace as a DiagnosticStatus with the switch as message and the phase and its
+ *  time on the steady clock in nanoseconds as values, so that the events arriving after the
+ *  switch finished are recorded as well. The steady clock is shared by the processes of the host,
+ *  the phases can be compared with the mode logs of the simulators (see mode_switch_benchmark).
+ *  If the process serves metrics, the durations from the request to the end are exported as
+ *  kuka_mode_switch_duration_seconds as well.
+ */
+class SwitchTrace
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  template<typename NodeT>
+  explicit SwitchTrace(NodeT & node)
+  : publisher_(rclcpp::create_publisher<diagnostic_msgs::msg::DiagnosticStatus>(
+        node, "~/mode_switch_trace", rclcpp::QoS(rclcpp::KeepLast(100)).reliable())),
+    hardware_id_(node.get_fully_qualified_name())
+  {
+    InitMetrics();
+  }
+
+  // Starts a new switch with the "request" phase, e.g. "control_mode 1 -> 2"
+  void Start(const std::string & description);
+
+  // Marks a phase of the last switch, can be called from any thread
+  void Mark(const std::string & phase);
+
+  // Marks the end of the switch with the "finished" or "failed" phase
+  void Finish(bool successful);
+
+private:
+  void Publish(const std::string & phase, uint8_t level);
+  void InitMetrics();
+
+  rclcpp::Publisher<diagnostic_msgs::msg::DiagnosticStatus>::SharedPtr publisher_;
+  std::string hardware_id_;
+  std::mutex mutex_;
+  std::string description_;
+  Clock::time_point start_;
+
+  // Only created if the metrics exporter of the process is serving
+  std::unique_ptr<MetricsExporter::Group> metrics_group_;
+  MetricsExporter::Histogram * duration_ = nullptr;
+  MetricsExporter::Counter * switches_ = nullptr;
+  MetricsExporter::Counter * failures_ = nullptr;
+};
+}  // namespace kuka_drivers_core
+
+#endif  // KUKA_DRIVERS_CORE__SWITCH_TRACE_HPP_
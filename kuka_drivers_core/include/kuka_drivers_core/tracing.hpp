@@ -0,0 +1,119 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_DRIVERS_CORE__TRACING_HPP_
+#define KUKA_DRIVERS_CORE__TRACING_HPP_
+
+#include <cstdint>
+
+// Generated by CMake, defines KUKA_DRIVERS_TRACING if the tracepoints are enabled
+#include "kuka_drivers_core/tracing_config.hpp"
+
+namespace kuka_drivers_core
+{
+/**
+ * LTTng tracepoints of the real-time paths of the drivers
+ *
+ * If kuka_drivers_core is built with the KUKA_DRIVERS_TRACING CMake option, the functions emit
+ *  the events of the kuka_drivers LTTng-UST provider: the begin and the end of the phases of the
+ *  control loop and of the message handling, and the lifecycle transitions of the robot managers.
+ *  An event costs a few hundred nanoseconds while a session records it, a call and a branch
+ *  otherwise.
+ *  Without the option all functions are inline no-ops, the drivers are built without any trace
+ *  code. See trace_timeline.py for the per-cycle timelines built from a recorded trace.
+ *
+ * The instance is the address of the object handling the phase, InstanceName() gives it a name
+ *  in the trace.
+ */
+namespace tracing
+{
+// The values are part of the trace format, new phases are only added at the end
+enum class Phase : uint8_t
+{
+  // Phases of the control loop of control_node
+  READ,
+  UPDATE,
+  WRITE,
+  // Message handling of the drivers, receive includes waiting for the message
+  RECEIVE,
+  SEND,
+  DECODE,
+  ENCODE,
+  GPIO
+};
+
+#ifdef KUKA_DRIVERS_TRACING
+constexpr bool ENABLED = true;
+
+void PhaseBegin(Phase phase, const void * instance);
+void PhaseEnd(Phase phase, const void * instance);
+void InstanceName(const void * instance, const char * name);
+void TransitionBegin(const char * node, const char * transition);
+void TransitionEnd(const char * node, const char * transition);
+#else
+constexpr bool ENABLED = false;
+
+inline void PhaseBegin(Phase, const void *) {}
+inline void PhaseEnd(Phase, const void *) {}
+inline void InstanceName(const void *, const char *) {}
+inline void TransitionBegin(const char *, const char *) {}
+inline void TransitionEnd(const char *, const char *) {}
+#endif
+
+/**
+ * @brief Traces the phase from the construction until the end of the scope
+ */
+class ScopedPhase
+{
+public:
+  ScopedPhase(Phase phase, const void * instance)
+  : phase_(phase), instance_(instance)
+  {
+    PhaseBegin(phase_, instance_);
+  }
+  ~ScopedPhase() {PhaseEnd(phase_, instance_);}
+
+  ScopedPhase(const ScopedPhase &) = delete;
+  ScopedPhase & operator=(const ScopedPhase &) = delete;
+
+private:
+  Phase phase_;
+  const void * instance_;
+};
+
+/**
+ * @brief Traces a lifecycle transition of a node until the end of the scope, the strings must
+ *  outlive the scope
+ */
+class ScopedTransition
+{
+public:
+  ScopedTransition(const char * node, const char * transition)
+  : node_(node), transition_(transition)
+  {
+    TransitionBegin(node_, transition_);
+  }
+  ~ScopedTransition() {TransitionEnd(node_, transition_);}
+
+  ScopedTransition(const ScopedTransition &) = delete;
+  ScopedTransition & operator=(const ScopedTransition &) = delete;
+
+private:
+  const char * node_;
+  const char * transition_;
+};
+}  // namespace tracing
+}  // namespace kuka_drivers_core
+
+#endif  // KUKA_DRIVERS_CORE__TRACING_HPP_
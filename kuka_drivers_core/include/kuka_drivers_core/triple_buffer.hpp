@@ -0,0 +1,82 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_DRIVERS_CORE__TRIPLE_BUFFER_HPP_
+#define KUKA_DRIVERS_CORE__TRIPLE_BUFFER_HPP_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace kuka_drivers_core
+{
+/**
+ * @brief Hands the newest value from one producer thread to one consumer thread
+ *
+ * Unlike SPSCQueue, older values are overwritten: the producer fills the back buffer and
+ *  publishes it, the consumer takes over the newest published one. Publishing and taking over
+ *  only swap the back or the front buffer with the middle one, neither side waits for the
+ *  other, copies or allocates, and the buffer of each side stays valid until its next swap.
+ *
+ * @tparam T: element type, default constructed in all three buffers
+ */
+template<typename T>
+class TripleBuffer
+{
+public:
+  TripleBuffer() = default;
+  TripleBuffer(const TripleBuffer &) = delete;
+  TripleBuffer & operator=(const TripleBuffer &) = delete;
+
+  // Buffer of the producer, filled before Publish()
+  T & Back() {return buffers_[back_];}
+
+  // Makes the back buffer the newest value, the producer continues in an older buffer
+  void Publish()
+  {
+    back_ = middle_.exchange(back_ | FRESH, std::memory_order_acq_rel) & INDEX;
+  }
+
+  /**
+   * @brief Takes over the newest published value, called only from the consumer thread
+   * @returns false if nothing was published since the last call, Front() is unchanged then
+   */
+  bool Update()
+  {
+    if ((middle_.load(std::memory_order_relaxed) & FRESH) == 0) {
+      return false;
+    }
+    front_ = middle_.exchange(front_, std::memory_order_acq_rel) & INDEX;
+    return true;
+  }
+
+  // Buffer of the consumer, the value taken over by the last Update()
+  const T & Front() const {return buffers_[front_];}
+
+  // A value was published that was not taken over yet
+  bool Fresh() const {return (middle_.load(std::memory_order_acquire) & FRESH) != 0;}
+
+private:
+  static constexpr uint8_t INDEX = 0x3;
+  static constexpr uint8_t FRESH = 0x4;
+
+  std::array<T, 3> buffers_{};
+  // The indices are written by different threads, keep them on separate cache lines
+  alignas(64) std::atomic<uint8_t> middle_{1};
+  alignas(64) uint8_t back_ = 0;
+  alignas(64) uint8_t front_ = 2;
+};
+}  // namespace kuka_drivers_core
+
+#endif  // KUKA_DRIVERS_CORE__TRIPLE_BUFFER_HPP_
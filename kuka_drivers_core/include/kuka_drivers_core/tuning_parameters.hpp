@@ -0,0 +1,192 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KUKA_DRIVERS_CORE__TUNING_PARAMETERS_HPP_
+#define KUKA_DRIVERS_CORE__TUNING_PARAMETERS_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "rclcpp/rclcpp.hpp"
+
+#include "kuka_drivers_core/command_filter.hpp"
+#include "kuka_drivers_core/hardware_parameters.hpp"
+#include "kuka_drivers_core/parameter_channel.hpp"
+#include "kuka_drivers_core/ros2_base_node.hpp"
+
+namespace kuka_drivers_core
+{
+/**
+ * @brief Node of the tuning parameters of a hardware interface, spun by its own thread
+ *
+ * The hardware interfaces have no node of their own, the parameters are set on this one
+ *  (e.g. ros2 param set /<hardware name>_tuning command_max_velocity 1.0).
+ */
+class TuningNode : public ROS2BaseNode
+{
+public:
+  explicit TuningNode(const std::string & node_name);
+  ~TuningNode() override;
+
+  // Starts spinning, after the parameters are registered
+  void Start();
+
+private:
+  rclcpp::executors::SingleThreadedExecutor executor_;
+  std::atomic<bool> terminate_{false};
+  std::thread spin_thread_;
+};
+
+/**
+ * @brief Tuning parameters of a hardware interface, changed at runtime without locking the
+ *  control loop
+ *
+ * Every parameter applies its value to a copy of the latest snapshot, a set of parameters is
+ *  published as one snapshot through a ParameterChannel after all of them were applied, and
+ *  rejected as a whole if one of them fails. read() or write() takes the new snapshot over with
+ *  Update() at the start of a cycle.
+ *
+ * @tparam Snapshot: copyable struct of the tuned values
+ */
+template<typename Snapshot>
+class TuningParameters
+{
+public:
+  TuningParameters(const std::string & node_name, const Snapshot & initial)
+  : channel_(initial), staging_(initial), node_(std::make_shared<TuningNode>(node_name))
+  {
+    node_->registerBatchHooks(
+      [this] {staging_ = channel_.Latest();},
+      [this](bool successful) {
+        if (successful) {
+          channel_.Publish(staging_);
+        }
+        return true;
+      });
+  }
+
+  TuningParameters(const TuningParameters &) = delete;
+  TuningParameters & operator=(const TuningParameters &) = delete;
+
+  /**
+   * @brief Declares a parameter, also the initial value (or override) is applied
+   * @param apply: changes the snapshot to the value, returns false to reject the value
+   */
+  template<typename T>
+  void Register(
+    const std::string & name, const T & value,
+    std::function<bool(const T &, Snapshot &)> apply)
+  {
+    node_->registerParameter<T>(
+      name, value, [this, apply](const T & new_value) {return apply(new_value, staging_);});
+  }
+
+  void Start() {node_->Start();}
+
+  rclcpp::Logger Logger() const {return node_->get_logger();}
+
+  // Real-time safe, see ParameterChannel
+  bool Update() {return channel_.Update();}
+  const Snapshot & Current() const {return channel_.Current();}
+
+private:
+  ParameterChannel<Snapshot> channel_;
+  // Copy of the latest snapshot changed by the parameters of a set, only used by the callbacks
+  Snapshot staging_;
+  // Destroyed first, the callbacks use the members above
+  std::shared_ptr<TuningNode> node_;
+};
+
+// Configuration of the command filters as tuning parameters
+struct CommandFilterTuning
+{
+  std::unordered_map<std::string, std::string> parameters;
+  // Only the configuration is used, see JointCommandFilter::CopyConfiguration()
+  JointCommandFilter filter;
+};
+
+/**
+ * @brief Registers the parameters of ConfigureCommandFilter() as tuning parameters, starting
+ *  from the hardware parameters
+ *
+ * An empty value disables the filter, an invalid one is rejected with the result of
+ *  ConfigureCommandFilter().
+ */
+template<typename Snapshot>
+void RegisterCommandFilterTuning(
+  TuningParameters<Snapshot> & tuning,
+  const std::unordered_map<std::string, std::string> & hardware_parameters,
+  std::size_t joint_count, CommandFilterTuning Snapshot::* member)
+{
+  for (const char * name : COMMAND_FILTER_PARAMETERS) {
+    auto param = hardware_parameters.find(name);
+    const rclcpp::Logger logger = tuning.Logger();
+    tuning.template Register<std::string>(
+      name, param != hardware_parameters.end() ? param->second : "",
+      [name, joint_count, member, logger](const std::string & value, Snapshot & snapshot) {
+        CommandFilterTuning & filter_tuning = snapshot.*member;
+        filter_tuning.parameters[name] = value;
+        JointCommandFilter filter;
+        std::string error;
+        if (!ConfigureCommandFilter(filter_tuning.parameters, joint_count, filter, error)) {
+          RCLCPP_ERROR(logger, "%s", error.c_str());
+          return false;
+        }
+        filter_tuning.filter = filter;
+        return true;
+      });
+  }
+}
+
+/**
+ * @brief Creates and starts the tuning parameters if the tuning_parameters hardware parameter is
+ *  'true', with the command filters registered by RegisterCommandFilterTuning()
+ * @param hardware_name: name of the hardware, the node is <hardware_name>_tuning
+ * @param register_parameters: registers the parameters specific to the driver, may be empty
+ * @returns false with the reason in error if tuning_parameters is invalid
+ */
+template<typename Snapshot>
+bool ConfigureTuningParameters(
+  const std::unordered_map<std::string, std::string> & hardware_parameters,
+  const std::string & hardware_name, std::size_t joint_count,
+  CommandFilterTuning Snapshot::* member, std::unique_ptr<TuningParameters<Snapshot>> & tuning,
+  std::string & error,
+  const std::function<void(TuningParameters<Snapshot> &)> & register_parameters = nullptr)
+{
+  HardwareParameters checked(hardware_parameters);
+  bool enabled = false;
+  if (!checked.GetFlag("tuning_parameters", enabled)) {
+    error = checked.Error();
+    return false;
+  }
+  if (!enabled) {
+    return true;
+  }
+  tuning = std::make_unique<TuningParameters<Snapshot>>(hardware_name + "_tuning", Snapshot());
+  RegisterCommandFilterTuning(*tuning, hardware_parameters, joint_count, member);
+  if (register_parameters) {
+    register_parameters(*tuning);
+  }
+  tuning->Start();
+  return true;
+}
+}  // namespace kuka_drivers_core
+
+#endif  // KUKA_DRIVERS_CORE__TUNING_PARAMETERS_HPP_
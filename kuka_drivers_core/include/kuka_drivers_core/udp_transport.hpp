@@ -0,0 +1,617 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_DRIVERS_CORE__UDP_TRANSPORT_HPP_
+#define KUKA_DRIVERS_CORE__UDP_TRANSPORT_HPP_
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+#include "kuka_drivers_core/fault_injection.hpp"
+#include "kuka_drivers_core/hardware_parameters.hpp"
+#include "kuka_drivers_core/tracing.hpp"
+#include "kuka_drivers_core/wire_capture.hpp"
+#include "kuka_drivers_core/xdp_socket.hpp"
+
+namespace kuka_drivers_core
+{
+/**
+ * @brief UDP socket answering the controller, shared by the RSI, EAC and FRI drivers
+ *
+ * The socket is bound to a local address, received datagrams are answered to their sender
+ *  (or to the connected controller). Datagrams are received into a preallocated buffer or into
+ *  a buffer of the caller, with a timeout or a deadline, nothing is allocated after Open().
+ *  The waiting strategy, kernel receive timestamps, the socket priority and the DSCP of the
+ *  sent datagrams can be configured, and the traffic can be recorded into a WireCapture.
+ *  For testing, a FaultInjector can drop, delay and reorder the traffic.
+ *  Optionally, the datagrams are exchanged through an AF_XDP socket bound to a queue of the
+ *  robot-facing interface instead of the socket layer of the kernel, see XdpSocket. The kernel
+ *  socket stays bound to the port then, but does not receive the redirected datagrams.
+ *  Errors are reported with return values, the reason is available from Error().
+ */
+class UdpTransport
+{
+public:
+  /**
+   * Strategy for waiting for the next datagram
+   *  - SELECT: poll() with the timeout, then receive (default)
+   *  - BUSY_POLL: blocking receive with SO_RCVTIMEO, the kernel busy polls the device queue
+   *      (SO_BUSY_POLL) instead of sleeping until the interrupt arrives
+   *  - SPIN: non-blocking receive repeated until data arrives or the timeout expires,
+   *      keeps the core fully busy, meant for isolated cores
+   */
+  enum class ReceiveMode
+  {
+    SELECT,
+    BUSY_POLL,
+    SPIN
+  };
+
+  struct Options
+  {
+    ReceiveMode receive_mode = ReceiveMode::SELECT;
+    // Busy polling time of BUSY_POLL, raising it above net.core.busy_read needs CAP_NET_ADMIN
+    int busy_poll_us = 50;
+    // SO_PRIORITY of the socket (queueing discipline of the sent datagrams), -1 keeps the default
+    int socket_priority = -1;
+    // Differentiated services code point of the sent datagrams, -1 keeps the default
+    int dscp = -1;
+    bool kernel_timestamps = false;
+    // Interface of the AF_XDP socket, empty uses the kernel socket (default)
+    std::string xdp_interface;
+    // Receive queue of the interface the datagrams of the controller are steered to
+    int xdp_queue = 0;
+    // Require the zero-copy mode of the NIC driver instead of falling back to copy mode
+    bool xdp_zero_copy = false;
+  };
+
+  // Maximal size of a datagram received into the internal buffer
+  static constexpr std::size_t BUFFER_SIZE = 1500;
+
+  /**
+   * Received datagram, with the internal buffer valid until the next receive
+   * The data is null-terminated for convenience, size does not include the terminator
+   */
+  struct Packet
+  {
+    const char * data = nullptr;
+    std::size_t size = 0;
+    std::chrono::steady_clock::time_point timestamp;
+    // Arrival time measured by the kernel (CLOCK_REALTIME), zero if not enabled
+    std::chrono::system_clock::time_point kernel_timestamp;
+  };
+
+  UdpTransport() = default;
+  ~UdpTransport() {Close();}
+
+  UdpTransport(const UdpTransport &) = delete;
+  UdpTransport & operator=(const UdpTransport &) = delete;
+
+  /**
+   * @brief Reads the receive_mode ("select", "busy_poll" or "spin"), busy_poll_us,
+   *  socket_priority, dscp, xdp_interface, xdp_queue and xdp_zero_copy hardware parameters,
+   *  the missing ones keep their value
+   * @return false with the reason in error if a parameter is invalid
+   */
+  static bool ParseOptions(
+    const std::unordered_map<std::string, std::string> & parameters, Options & options,
+    std::string & error)
+  {
+    auto mode = parameters.find("receive_mode");
+    if (mode != parameters.end()) {
+      if (mode->second == "select") {
+        options.receive_mode = ReceiveMode::SELECT;
+      } else if (mode->second == "busy_poll") {
+        options.receive_mode = ReceiveMode::BUSY_POLL;
+      } else if (mode->second == "spin") {
+        options.receive_mode = ReceiveMode::SPIN;
+      } else {
+        error = "receive_mode must be 'select', 'busy_poll' or 'spin'";
+        return false;
+      }
+    }
+    auto busy_poll = parameters.find("busy_poll_us");
+    if (busy_poll != parameters.end()) {
+      if (!HardwareParameters::Convert(busy_poll->second, options.busy_poll_us, 0)) {
+        error = "busy_poll_us must be a non-negative integer";
+        return false;
+      }
+    }
+    auto priority = parameters.find("socket_priority");
+    if (priority != parameters.end()) {
+      if (!HardwareParameters::Convert(priority->second, options.socket_priority, 0, 7)) {
+        error = "socket_priority must be an integer between 0 and 7";
+        return false;
+      }
+    }
+    auto dscp = parameters.find("dscp");
+    if (dscp != parameters.end()) {
+      if (!HardwareParameters::Convert(dscp->second, options.dscp, 0, 63)) {
+        error = "dscp must be an integer between 0 and 63";
+        return false;
+      }
+    }
+    auto xdp_interface = parameters.find("xdp_interface");
+    if (xdp_interface != parameters.end()) {
+      options.xdp_interface = xdp_interface->second;
+    }
+    auto xdp_queue = parameters.find("xdp_queue");
+    if (xdp_queue != parameters.end()) {
+      if (!HardwareParameters::Convert(xdp_queue->second, options.xdp_queue, 0)) {
+        error = "xdp_queue must be a non-negative integer";
+        return false;
+      }
+    }
+    auto zero_copy = parameters.find("xdp_zero_copy");
+    if (zero_copy != parameters.end()) {
+      options.xdp_zero_copy = zero_copy->second == "true";
+    }
+    return true;
+  }
+
+  // Create the socket and bind it to the local address (empty or "0.0.0.0": all interfaces)
+  bool Open(const std::string & local_address, uint16_t port)
+  {
+    return Open(local_address, port, Options());
+  }
+
+  bool Open(const std::string & local_address, uint16_t port, const Options & options)
+  {
+    Close();
+    fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd_ < 0) {
+      return Fail("Error opening socket");
+    }
+    int reuse = 1;
+    setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    struct sockaddr_in address;
+    if (!ToAddress(local_address, port, address)) {
+      Close();
+      error_ = "Invalid local address " + local_address;
+      return false;
+    }
+    if (bind(fd_, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) < 0) {
+      const bool result = Fail("Error binding socket to port " + std::to_string(port));
+      Close();
+      return result;
+    }
+    port_ = port;
+    if (!Configure(options)) {
+      Close();
+      return false;
+    }
+    return true;
+  }
+
+  void Close()
+  {
+    xdp_.Close();
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+    fd_ = -1;
+    has_remote_ = false;
+    connected_ = false;
+    receive_timeout_us_ = -1;
+  }
+
+  bool IsOpen() const {return fd_ >= 0;}
+
+  // Socket descriptor, for waiting on several transports with epoll
+  int Fd() const {return xdp_.IsOpen() ? xdp_.Fd() : fd_;}
+
+  // Whether the datagrams are exchanged through the AF_XDP socket
+  bool UsesXdp() const {return xdp_.IsOpen();}
+
+  // Only datagrams of the given controller are received, the replies are sent there
+  bool Connect(const std::string & remote_address, uint16_t port)
+  {
+    if (!ToAddress(remote_address, port, remote_) ||
+      connect(fd_, reinterpret_cast<struct sockaddr *>(&remote_), sizeof(remote_)) < 0)
+    {
+      return Fail("Error connecting to " + remote_address);
+    }
+    remote_size_ = sizeof(remote_);
+    has_remote_ = true;
+    connected_ = true;
+    xdp_.SetPeer(remote_);
+    return true;
+  }
+
+  bool Configure(const Options & options)
+  {
+    if (options.receive_mode == ReceiveMode::BUSY_POLL &&
+      setsockopt(
+        fd_, SOL_SOCKET, SO_BUSY_POLL, &options.busy_poll_us, sizeof(options.busy_poll_us)) < 0)
+    {
+      return Fail("Enabling busy polling failed");
+    }
+    if (receive_mode_ == ReceiveMode::BUSY_POLL && options.receive_mode != ReceiveMode::BUSY_POLL) {
+      // Restore blocking receive without timeout, poll takes care of the timeout
+      SetReceiveTimeout(0);
+    }
+    receive_mode_ = options.receive_mode;
+
+    if (options.socket_priority >= 0 &&
+      setsockopt(
+        fd_, SOL_SOCKET, SO_PRIORITY, &options.socket_priority,
+        sizeof(options.socket_priority)) < 0)
+    {
+      return Fail("Setting the socket priority failed");
+    }
+    if (options.dscp >= 0) {
+      const int tos = options.dscp << 2;
+      if (setsockopt(fd_, IPPROTO_IP, IP_TOS, &tos, sizeof(tos)) < 0) {
+        return Fail("Setting the DSCP failed");
+      }
+    }
+
+    const int timestamps = options.kernel_timestamps ? 1 : 0;
+    if ((options.kernel_timestamps || kernel_timestamps_) &&
+      setsockopt(fd_, SOL_SOCKET, SO_TIMESTAMPNS, &timestamps, sizeof(timestamps)) < 0)
+    {
+      return Fail("Enabling kernel timestamps failed");
+    }
+    kernel_timestamps_ = options.kernel_timestamps;
+
+    if (options.xdp_interface.empty()) {
+      xdp_.Close();
+      return true;
+    }
+    if (!xdp_.Open(
+        options.xdp_interface, static_cast<uint32_t>(options.xdp_queue), port_,
+        options.xdp_zero_copy))
+    {
+      error_ = "Opening the AF_XDP socket on " + options.xdp_interface + " failed: " +
+        xdp_.Error();
+      return false;
+    }
+    xdp_.SetDscp(options.dscp);
+    if (connected_) {
+      xdp_.SetPeer(remote_);
+    }
+    return true;
+  }
+
+  /**
+   * @brief Receive the next datagram into the internal buffer
+   * @param timeout: maximal waiting time, non-positive values wait without limit
+   * @return the size of the datagram, 0 on timeout, -1 on error
+   */
+  ssize_t Receive(Packet & packet, std::chrono::microseconds timeout)
+  {
+    return ReceiveInto(buffer_, sizeof(buffer_), packet, timeout);
+  }
+
+  // Receive the next datagram into the internal buffer until the deadline
+  ssize_t ReceiveUntil(Packet & packet, std::chrono::steady_clock::time_point deadline)
+  {
+    const auto timeout = std::chrono::duration_cast<std::chrono::microseconds>(
+      deadline - std::chrono::steady_clock::now());
+    if (timeout.count() <= 0) {
+      return ReceiveInto(buffer_, sizeof(buffer_), packet, std::chrono::microseconds(1));
+    }
+    return ReceiveInto(buffer_, sizeof(buffer_), packet, timeout);
+  }
+
+  // Receive the next datagram into the buffer of the caller, longer datagrams are truncated
+  ssize_t ReceiveInto(
+    char * buffer, std::size_t size, Packet & packet, std::chrono::microseconds timeout)
+  {
+    tracing::ScopedPhase trace(tracing::Phase::RECEIVE, this);
+    return faults_ == nullptr ? ReceiveDatagram(buffer, size, packet, timeout) :
+           ReceiveWithFaults(buffer, size, packet, timeout);
+  }
+
+  // Send a datagram to the sender of the last received one (or to the connected controller)
+  ssize_t Send(const void * data, std::size_t size)
+  {
+    tracing::ScopedPhase trace(tracing::Phase::SEND, this);
+    if (fd_ < 0 || !has_remote_) {
+      error_ = "No datagram received yet";
+      return -1;
+    }
+    if (faults_ != nullptr && faults_->DropSent()) {
+      // Lost on the way, the caller does not notice
+      return static_cast<ssize_t>(size);
+    }
+    ssize_t bytes = 0;
+    if (xdp_.IsOpen()) {
+      bytes = xdp_.Send(data, size);
+      if (bytes < 0) {
+        error_ = xdp_.Error();
+      }
+    } else {
+      bytes = connected_ ? send(fd_, data, size, 0) :
+        sendto(fd_, data, size, 0, reinterpret_cast<struct sockaddr *>(&remote_), remote_size_);
+      if (bytes < 0) {
+        Fail("Error in send");
+      }
+    }
+    if (bytes >= 0 && capture_ != nullptr) {
+      capture_->Record(WireCapture::Direction::SENT, data, size);
+    }
+    return bytes;
+  }
+
+  bool HasRemote() const {return has_remote_;}
+
+  // Records the received and sent datagrams into the capture, nullptr disables recording
+  void SetCapture(WireCapture * capture) {capture_ = capture;}
+
+  // Applies the faults of the injector to the traffic, nullptr disables fault injection
+  void SetFaultInjector(FaultInjector * faults) {faults_ = faults;}
+
+  // Reason of the last failure
+  const std::string & Error() const {return error_;}
+
+private:
+  ssize_t ReceiveDatagram(
+    char * buffer, std::size_t size, Packet & packet, std::chrono::microseconds timeout)
+  {
+    packet.data = nullptr;
+    packet.size = 0;
+    if (fd_ < 0 || size == 0) {
+      return -1;
+    }
+    if (xdp_.IsOpen()) {
+      return ReceiveXdp(buffer, size, packet, timeout);
+    }
+    const bool limited = timeout.count() > 0;
+
+    if (limited && receive_mode_ == ReceiveMode::SELECT) {
+      struct pollfd descriptor = {fd_, POLLIN, 0};
+      struct timespec wait;
+      wait.tv_sec = static_cast<time_t>(timeout.count() / 1000000);
+      wait.tv_nsec = static_cast<long>(timeout.count() % 1000000) * 1000;  // NOLINT
+      const int ready = ppoll(&descriptor, 1, &wait, nullptr);
+      if (ready == 0) {
+        return 0;
+      }
+      if (ready < 0) {
+        // An interrupted wait is handled like a timeout
+        return errno == EINTR ? 0 : (Fail("Error in poll"), -1);
+      }
+    } else if (receive_mode_ == ReceiveMode::BUSY_POLL) {
+      SetReceiveTimeout(limited ? timeout.count() : 0);
+    }
+
+    struct iovec iov;
+    iov.iov_base = buffer;
+    // One byte is kept for the terminator
+    iov.iov_len = size - 1;
+
+    struct sockaddr_in sender;
+    struct msghdr message;
+    std::memset(&message, 0, sizeof(message));
+    message.msg_name = connected_ ? nullptr : &sender;
+    message.msg_namelen = connected_ ? 0 : sizeof(sender);
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    if (kernel_timestamps_) {
+      message.msg_control = control_buffer_;
+      message.msg_controllen = sizeof(control_buffer_);
+    }
+
+    ssize_t bytes = 0;
+    if (receive_mode_ == ReceiveMode::SPIN) {
+      const auto deadline = std::chrono::steady_clock::now() + timeout;
+      while ((bytes = recvmsg(fd_, &message, MSG_DONTWAIT)) < 0 &&
+        (errno == EAGAIN || errno == EWOULDBLOCK) &&
+        (!limited || std::chrono::steady_clock::now() < deadline))
+      {
+      }
+    } else {
+      bytes = recvmsg(fd_, &message, 0);
+    }
+    if (bytes < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        // Timeout in BUSY_POLL or SPIN mode
+        return 0;
+      }
+      Fail("Error in receive");
+      return -1;
+    }
+    packet.timestamp = std::chrono::steady_clock::now();
+    if (!connected_) {
+      remote_ = sender;
+      remote_size_ = message.msg_namelen;
+      has_remote_ = true;
+    }
+
+    packet.kernel_timestamp = std::chrono::system_clock::time_point();
+    if (kernel_timestamps_) {
+      for (struct cmsghdr * cmsg = CMSG_FIRSTHDR(&message); cmsg != nullptr;
+        cmsg = CMSG_NXTHDR(&message, cmsg))
+      {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+          struct timespec time;
+          std::memcpy(&time, CMSG_DATA(cmsg), sizeof(time));
+          packet.kernel_timestamp = std::chrono::system_clock::time_point(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(
+              std::chrono::seconds(time.tv_sec) + std::chrono::nanoseconds(time.tv_nsec)));
+        }
+      }
+    }
+
+    buffer[bytes] = '\0';
+    packet.data = buffer;
+    packet.size = static_cast<std::size_t>(bytes);
+    if (capture_ != nullptr) {
+      capture_->Record(WireCapture::Direction::RECEIVED, buffer, packet.size, packet.timestamp);
+    }
+    return bytes;
+  }
+
+  ssize_t ReceiveXdp(
+    char * buffer, std::size_t size, Packet & packet, std::chrono::microseconds timeout)
+  {
+    const char * payload = nullptr;
+    const ssize_t bytes = xdp_.Receive(payload, timeout, receive_mode_ == ReceiveMode::SPIN);
+    if (bytes <= 0) {
+      if (bytes < 0) {
+        error_ = xdp_.Error();
+      }
+      return bytes;
+    }
+    packet.timestamp = std::chrono::steady_clock::now();
+    // There is no receive path of the kernel to stamp the datagram, the frame is taken from the
+    //  ring right after its arrival
+    packet.kernel_timestamp = kernel_timestamps_ ? std::chrono::system_clock::now() :
+      std::chrono::system_clock::time_point();
+    has_remote_ = true;
+
+    packet.size = static_cast<std::size_t>(bytes);
+    if (buffer == buffer_ && faults_ == nullptr) {
+      // The internal buffer is not needed, the datagram is passed on in the frame itself
+      packet.data = payload;
+    } else {
+      packet.size = std::min(packet.size, size - 1);
+      std::memcpy(buffer, payload, packet.size);
+      buffer[packet.size] = '\0';
+      packet.data = buffer;
+    }
+    if (capture_ != nullptr) {
+      capture_->Record(
+        WireCapture::Direction::RECEIVED, packet.data, packet.size, packet.timestamp);
+    }
+    return static_cast<ssize_t>(packet.size);
+  }
+
+  /**
+   * Datagrams are taken from the socket as they arrive (and recorded into the capture then),
+   *  but delivered to the caller only at their release time, the timeout applies to the
+   *  delivery. Lost datagrams are discarded while waiting.
+   */
+  ssize_t ReceiveWithFaults(
+    char * buffer, std::size_t size, Packet & packet, std::chrono::microseconds timeout)
+  {
+    using std::chrono::steady_clock;
+    const bool limited = timeout.count() > 0;
+    const auto deadline = steady_clock::now() + timeout;
+    while (true) {
+      const auto now = steady_clock::now();
+      std::size_t bytes = 0;
+      if (faults_->Release(now, buffer, size - 1, bytes, packet.kernel_timestamp)) {
+        buffer[bytes] = '\0';
+        packet.data = buffer;
+        packet.size = bytes;
+        packet.timestamp = now;
+        return static_cast<ssize_t>(bytes);
+      }
+      auto wait_until = faults_->NextRelease();
+      if (limited) {
+        if (now >= deadline) {
+          packet.data = nullptr;
+          packet.size = 0;
+          return 0;
+        }
+        wait_until = std::min(wait_until, deadline);
+      }
+      // No limit if nothing is held and the caller waits without limit
+      std::chrono::microseconds wait(0);
+      if (wait_until != steady_clock::time_point::max()) {
+        wait = std::max(
+          std::chrono::duration_cast<std::chrono::microseconds>(wait_until - now),
+          std::chrono::microseconds(1));
+      }
+
+      const ssize_t received = ReceiveDatagram(buffer, size, packet, wait);
+      if (received < 0) {
+        return received;
+      }
+      if (received == 0 || faults_->DropReceived()) {
+        continue;
+      }
+      const auto release = faults_->ReleaseTime(packet.timestamp);
+      if (release <= packet.timestamp && faults_->Empty()) {
+        return received;
+      }
+      // The kernel timestamp is shifted as if the datagram arrived at the release time
+      auto kernel_timestamp = packet.kernel_timestamp;
+      if (kernel_timestamp != std::chrono::system_clock::time_point()) {
+        kernel_timestamp += std::chrono::duration_cast<std::chrono::system_clock::duration>(
+          release - packet.timestamp);
+      }
+      faults_->Hold(buffer, packet.size, release, kernel_timestamp);
+    }
+  }
+
+  static bool ToAddress(const std::string & host, uint16_t port, struct sockaddr_in & address)
+  {
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    if (host.empty()) {
+      address.sin_addr.s_addr = htonl(INADDR_ANY);
+      return true;
+    }
+    return inet_pton(AF_INET, host.c_str(), &address.sin_addr) == 1;
+  }
+
+  bool Fail(const std::string & message)
+  {
+    error_ = message + ": " + std::strerror(errno);
+    return false;
+  }
+
+  // SO_RCVTIMEO of BUSY_POLL, only changed if it differs from the current one
+  void SetReceiveTimeout(int64_t timeout_us)
+  {
+    if (timeout_us == receive_timeout_us_) {
+      return;
+    }
+    struct timeval time;
+    time.tv_sec = static_cast<time_t>(timeout_us / 1000000);
+    time.tv_usec = static_cast<suseconds_t>(timeout_us % 1000000);
+    setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &time, sizeof(time));
+    receive_timeout_us_ = timeout_us;
+  }
+
+  int fd_ = -1;
+  uint16_t port_ = 0;
+  ReceiveMode receive_mode_ = ReceiveMode::SELECT;
+  bool kernel_timestamps_ = false;
+  int64_t receive_timeout_us_ = -1;
+
+  struct sockaddr_in remote_ = {};
+  socklen_t remote_size_ = sizeof(struct sockaddr_in);
+  bool has_remote_ = false;
+  bool connected_ = false;
+
+  WireCapture * capture_ = nullptr;
+  FaultInjector * faults_ = nullptr;
+  XdpSocket xdp_;
+  std::string error_;
+  char buffer_[BUFFER_SIZE + 1];
+  char control_buffer_[CMSG_SPACE(sizeof(struct timespec))];
+};
+}  // namespace kuka_drivers_core
+
+#endif  // KUKA_DRIVERS_CORE__UDP_TRANSPORT_HPP_
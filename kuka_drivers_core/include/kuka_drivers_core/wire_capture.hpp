@@ -0,0 +1,256 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_DRIVERS_CORE__WIRE_CAPTURE_HPP_
+#define KUKA_DRIVERS_CORE__WIRE_CAPTURE_HPP_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "kuka_drivers_core/hardware_parameters.hpp"
+
+namespace kuka_drivers_core
+{
+/**
+ * @brief Records the datagrams exchanged with the robot controller into a memory-mapped
+ *  ring file, so that sessions can be analyzed and replayed offline.
+ *
+ * The file consists of a FileHeader followed by slot_count fixed-size slots. Recording
+ * reserves a slot with one atomic increment and copies the datagram into the mapping,
+ * there are no system calls, locks or allocations, so it can be called from the real-time
+ * thread (and from several threads). The pages are populated when the file is opened.
+ * When the ring is full, the oldest datagrams are overwritten.
+ */
+class WireCapture
+{
+public:
+  enum class Direction : uint8_t
+  {
+    RECEIVED = 0,
+    SENT = 1
+  };
+
+  static constexpr uint32_t SLOT_SIZE = 1536;
+
+  struct FileHeader
+  {
+    char magic[8];
+    uint32_t slot_size;
+    uint32_t reserved;
+    uint64_t slot_count;
+    std::atomic<uint64_t> next_sequence;
+  };
+
+  struct SlotHeader
+  {
+    // Sequence number + 1 of the datagram, 0 while the slot is written or was never used
+    std::atomic<uint64_t> sequence;
+    // CLOCK_MONOTONIC (steady_clock) time of the datagram
+    int64_t timestamp_ns;
+    uint32_t size;
+    Direction direction;
+    uint8_t reserved[3];
+  };
+
+  static constexpr std::size_t MAX_PAYLOAD = SLOT_SIZE - sizeof(SlotHeader);
+
+  /**
+   * @brief Create (or overwrite) the capture file
+   * @throws std::runtime_error if the file cannot be created or mapped
+   */
+  WireCapture(const std::string & path, std::size_t slot_count)
+  : slot_count_(std::max<std::size_t>(slot_count, 1))
+  {
+    size_ = sizeof(FileHeader) + slot_count_ * SLOT_SIZE;
+    const int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+      throw std::runtime_error("Error opening capture file " + path + ": " + strerror(errno));
+    }
+    if (ftruncate(fd, static_cast<off_t>(size_)) < 0) {
+      close(fd);
+      throw std::runtime_error("Error resizing capture file " + path + ": " + strerror(errno));
+    }
+    void * mapping = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+      throw std::runtime_error("Error mapping capture file " + path + ": " + strerror(errno));
+    }
+    base_ = static_cast<char *>(mapping);
+
+    header_ = new(base_) FileHeader;
+    std::memcpy(header_->magic, Magic(), sizeof(header_->magic));
+    header_->slot_size = SLOT_SIZE;
+    header_->reserved = 0;
+    header_->slot_count = slot_count_;
+    header_->next_sequence.store(0, std::memory_order_relaxed);
+    for (std::size_t i = 0; i < slot_count_; ++i) {
+      new(slot(i)) SlotHeader;
+      slot(i)->sequence.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  ~WireCapture()
+  {
+    msync(base_, size_, MS_ASYNC);
+    munmap(base_, size_);
+  }
+
+  WireCapture(const WireCapture &) = delete;
+  WireCapture & operator=(const WireCapture &) = delete;
+
+  /**
+   * @brief Record a datagram, datagrams longer than MAX_PAYLOAD are truncated
+   */
+  void Record(
+    Direction direction, const void * data, std::size_t size,
+    std::chrono::steady_clock::time_point timestamp)
+  {
+    const uint64_t sequence = header_->next_sequence.fetch_add(1, std::memory_order_relaxed);
+    SlotHeader * target = slot(sequence % slot_count_);
+
+    target->sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    target->timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      timestamp.time_since_epoch()).count();
+    target->size = static_cast<uint32_t>(std::min(size, std::size_t{MAX_PAYLOAD}));
+    target->direction = direction;
+    std::memcpy(reinterpret_cast<char *>(target) + sizeof(SlotHeader), data, target->size);
+    target->sequence.store(sequence + 1, std::memory_order_release);
+  }
+
+  void Record(Direction direction, const void * data, std::size_t size)
+  {
+    Record(direction, data, size, std::chrono::steady_clock::now());
+  }
+
+  struct Datagram
+  {
+    uint64_t sequence;
+    std::chrono::steady_clock::time_point timestamp;
+    Direction direction;
+    std::string data;
+  };
+
+  /**
+   * @brief Read the datagrams of a capture file in recording order
+   * @throws std::runtime_error if the file cannot be read or has a wrong format
+   */
+  static std::vector<Datagram> ReadFile(const std::string & path)
+  {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::runtime_error("Error opening capture file " + path + ": " + strerror(errno));
+    }
+    const off_t file_size = lseek(fd, 0, SEEK_END);
+    void * mapping = file_size >= static_cast<off_t>(sizeof(FileHeader)) ?
+      mmap(nullptr, static_cast<std::size_t>(file_size), PROT_READ, MAP_SHARED, fd, 0) :
+      MAP_FAILED;
+    close(fd);
+    if (mapping == MAP_FAILED) {
+      throw std::runtime_error("Error mapping capture file " + path);
+    }
+    const char * base = static_cast<const char *>(mapping);
+    const auto * header = reinterpret_cast<const FileHeader *>(base);
+
+    std::vector<Datagram> datagrams;
+    const bool valid = std::memcmp(header->magic, Magic(), sizeof(header->magic)) == 0 &&
+      header->slot_size == SLOT_SIZE &&
+      sizeof(FileHeader) + header->slot_count * SLOT_SIZE <= static_cast<uint64_t>(file_size);
+    for (uint64_t i = 0; valid && i < header->slot_count; ++i) {
+      const auto * entry = reinterpret_cast<const SlotHeader *>(
+        base + sizeof(FileHeader) + i * SLOT_SIZE);
+      const uint64_t sequence = entry->sequence.load(std::memory_order_acquire);
+      if (sequence == 0) {
+        continue;
+      }
+      Datagram datagram;
+      datagram.sequence = sequence - 1;
+      datagram.timestamp = std::chrono::steady_clock::time_point(
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::nanoseconds(entry->timestamp_ns)));
+      datagram.direction = entry->direction;
+      datagram.data.assign(
+        reinterpret_cast<const char *>(entry) + sizeof(SlotHeader),
+        std::min<std::size_t>(entry->size, std::size_t{MAX_PAYLOAD}));
+      datagrams.push_back(std::move(datagram));
+    }
+    munmap(mapping, static_cast<std::size_t>(file_size));
+    if (!valid) {
+      throw std::runtime_error("Invalid capture file " + path);
+    }
+
+    std::sort(
+      datagrams.begin(), datagrams.end(), [](const Datagram & a, const Datagram & b) {
+        return a.sequence < b.sequence;
+      });
+    return datagrams;
+  }
+
+private:
+  static const char * Magic() {return "KDWCAP01";}
+
+  SlotHeader * slot(std::size_t index)
+  {
+    return reinterpret_cast<SlotHeader *>(base_ + sizeof(FileHeader) + index * SLOT_SIZE);
+  }
+
+  std::size_t slot_count_;
+  std::size_t size_ = 0;
+  char * base_ = nullptr;
+  FileHeader * header_ = nullptr;
+};
+
+/**
+ * @brief Creates the capture if the capture_file hardware parameter is set, capture_slots gives
+ *  the number of datagrams kept (default: 16384)
+ * @returns false with the reason in error if the parameters are invalid or the file cannot be
+ *  created
+ */
+inline bool ConfigureWireCapture(
+  const std::unordered_map<std::string, std::string> & parameters,
+  std::unique_ptr<WireCapture> & capture, std::string & error)
+{
+  HardwareParameters checked(parameters);
+  const std::string path = checked.String("capture_file");
+  std::size_t slots = 16384;
+  if (path.empty()) {
+    return true;
+  }
+  if (!checked.Get("capture_slots", slots, 1)) {
+    error = checked.Error();
+    return false;
+  }
+  try {
+    capture = std::make_unique<WireCapture>(path, slots);
+  } catch (const std::exception & ex) {
+    error = ex.what();
+    return false;
+  }
+  return true;
+}
+}  // namespace kuka_drivers_core
+
+#endif  // KUKA_DRIVERS_CORE__WIRE_CAPTURE_HPP_
@@ -0,0 +1,158 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_DRIVERS_CORE__XDP_SOCKET_HPP_
+#define KUKA_DRIVERS_CORE__XDP_SOCKET_HPP_
+
+#include <linux/if_xdp.h>
+#include <netinet/in.h>
+#include <sys/types.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace kuka_drivers_core
+{
+/**
+ * @brief AF_XDP socket exchanging the UDP datagrams of one port on one queue of a NIC
+ *
+ * Kernel bypass for UdpTransport: a small XDP program attached to the interface redirects the
+ *  IPv4 UDP datagrams to the local port from the given receive queue into the socket, all other
+ *  traffic (e.g. ARP) goes through the kernel stack as before. The frames are written by the
+ *  driver (or copied by the kernel in copy mode) into a memory area shared with the process,
+ *  the datagrams are parsed in place and the replies are built with their Ethernet, IP and UDP
+ *  headers in the same area, without the socket layer of the kernel.
+ *
+ * The datagrams of the controller must arrive on the given queue, either with a single queue
+ *  or by steering the flow, e.g. `ethtool -N eth1 flow-type udp4 dst-port 59152 action 2`.
+ *  Opening needs CAP_NET_ADMIN and CAP_BPF (or root) and a kernel of at least 5.9. The program
+ *  is detached when the socket is closed, also if the process ends.
+ *  Errors are reported with return values, the reason is available from Error().
+ */
+class XdpSocket
+{
+public:
+  // Maximal size of a received or sent Ethernet frame
+  static constexpr std::size_t FRAME_SIZE = 2048;
+
+  XdpSocket() = default;
+  ~XdpSocket() {Close();}
+
+  XdpSocket(const XdpSocket &) = delete;
+  XdpSocket & operator=(const XdpSocket &) = delete;
+
+  /**
+   * @param interface: name of the robot-facing network interface
+   * @param queue: receive queue of the interface the datagrams arrive on
+   * @param port: local UDP port of the datagrams in host byte order
+   * @param zero_copy: require the zero-copy mode of the NIC driver, otherwise the kernel falls
+   *  back to copying the frames if the driver does not support it
+   */
+  bool Open(const std::string & interface, uint32_t queue, uint16_t port, bool zero_copy);
+  void Close();
+
+  bool IsOpen() const {return fd_ >= 0;}
+
+  // Socket descriptor, readable if a datagram is waiting
+  int Fd() const {return fd_;}
+
+  /**
+   * @brief Waits for the next datagram, the previous one is released
+   * @param payload: set to the datagram in the shared area, null-terminated, valid until the
+   *  next call
+   * @param timeout: maximal waiting time, non-positive values wait without limit
+   * @param spin: check the receive ring in a loop instead of sleeping in poll()
+   * @return the size of the datagram, 0 on timeout, -1 on error
+   */
+  ssize_t Receive(const char *& payload, std::chrono::microseconds timeout, bool spin);
+
+  // Only datagrams of the given sender are received, the replies are sent there
+  void SetPeer(const struct sockaddr_in & peer);
+
+  // Differentiated services code point of the sent datagrams
+  void SetDscp(int dscp) {tos_ = static_cast<uint8_t>(dscp > 0 ? dscp << 2 : 0);}
+
+  // Sends a datagram to the sender of the last received one
+  ssize_t Send(const void * data, std::size_t size);
+
+  bool HasRemote() const {return has_remote_;}
+
+  // Reason of the last failure
+  const std::string & Error() const {return error_;}
+
+private:
+  struct Ring
+  {
+    uint32_t * producer = nullptr;
+    uint32_t * consumer = nullptr;
+    void * descriptors = nullptr;
+    uint32_t size = 0;
+    void * map = nullptr;
+    std::size_t map_size = 0;
+  };
+
+  static constexpr uint32_t RING_SIZE = 64;
+  // The first half of the frames is used for receiving, the second half for sending
+  static constexpr uint32_t FRAME_COUNT = 2 * RING_SIZE;
+  static constexpr std::size_t HEADER_SIZE = 14 + 20 + 8;
+
+  bool LoadProgram(uint16_t port, uint32_t queue);
+  bool AttachProgram(int ifindex);
+  bool MapRing(
+    Ring & ring, uint64_t page_offset, const struct xdp_ring_offset & offsets,
+    std::size_t descriptor_size);
+  bool CreateSocket(int ifindex, uint32_t queue, bool zero_copy);
+  // Checks the headers of a received frame, the length of the payload or -1 if not ours
+  ssize_t Parse(uint8_t * frame, std::size_t length, std::size_t room, const char *& payload);
+  void Release();
+  void Reclaim();
+  bool Fail(const std::string & message);
+
+  int fd_ = -1;
+  int map_fd_ = -1;
+  int program_fd_ = -1;
+  int link_fd_ = -1;
+  uint16_t port_ = 0;
+
+  uint8_t * umem_ = nullptr;
+  Ring fill_;
+  Ring completion_;
+  Ring rx_;
+  Ring tx_;
+  // Frame of the last datagram, returned to the fill ring at the next receive
+  uint64_t held_frame_ = 0;
+  bool holding_ = false;
+  // Frames of the second half not in the transmit or completion ring
+  uint64_t free_tx_[RING_SIZE] = {};
+  uint32_t free_tx_count_ = 0;
+
+  // Addresses of the last received datagram, swapped in the replies
+  uint8_t remote_mac_[6] = {};
+  uint8_t local_mac_[6] = {};
+  uint32_t remote_ip_ = 0;
+  uint32_t local_ip_ = 0;
+  uint16_t remote_port_ = 0;
+  bool has_remote_ = false;
+  bool has_peer_ = false;
+  struct sockaddr_in peer_ = {};
+  uint8_t tos_ = 0;
+  uint16_t ip_id_ = 0;
+
+  std::string error_;
+};
+}  // namespace kuka_drivers_core
+
+#endif  // KUKA_DRIVERS_CORE__XDP_SOCKET_HPP_
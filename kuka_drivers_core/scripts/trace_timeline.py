@@ -0,0 +1,271 @@
+#!/usr/bin/env python3
+# Copyright 2023 Áron Svastits
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""
+Per-cycle timelines of the control loop from an LTTng trace of the kuka_drivers events.
+
+The read, update and write phases of control_node on one thread make up a cycle, the phases of
+the drivers (receive, decode, gpio, encode, send) are nested into them. Phases of other threads
+(e.g. the I/O threads of the drivers) belong to the cycle in which they ended. The critical
+path of a cycle is the chain of the longest nested phase within each loop phase, it shows where
+the time of a slow cycle went.
+
+The trace must have been recorded with the vtid context, see the tracing section of the README
+of kuka_drivers_core.
+"""
+
+import argparse
+import csv
+import sys
+
+PHASES = ('read', 'update', 'write', 'receive', 'send', 'decode', 'encode', 'gpio')
+LOOP_PHASES = ('read', 'update', 'write')
+
+
+class Span:
+    """A phase between its begin and end event on one thread."""
+
+    def __init__(self, phase, instance, tid, begin):
+        self.phase = phase
+        self.instance = instance
+        self.tid = tid
+        self.begin = begin
+        self.end = begin
+        self.children = []
+
+    def duration(self):
+        return self.end - self.begin
+
+    def label(self, names):
+        if self.phase in LOOP_PHASES:
+            return self.phase
+        return '%s(%s)' % (self.phase, names.get(self.instance, '0x%x' % self.instance))
+
+
+class Cycle:
+    """The loop phases of one cycle and the phases of the other threads ended in it."""
+
+    def __init__(self, index, begin):
+        self.index = index
+        self.begin = begin
+        self.end = begin
+        self.loop = []
+        self.other = []
+
+    def duration(self):
+        return self.end - self.begin
+
+    def loop_duration(self, phase):
+        return sum(span.duration() for span in self.loop if span.phase == phase)
+
+    def critical_path(self, names):
+        parts = []
+        for span in self.loop:
+            chain = [span]
+            while chain[-1].children:
+                chain.append(max(chain[-1].children, key=Span.duration))
+            parts.append(' > '.join(
+                '%s %.0f us' % (link.label(names), link.duration() / 1000.0) for link in chain))
+        return ' | '.join(parts)
+
+
+def field_value(event, name, default=None):
+    try:
+        return event[name]
+    except KeyError:
+        return default
+
+
+def phase_name(field):
+    labels = getattr(field, 'labels', None)
+    if labels:
+        return labels[0]
+    index = int(field)
+    return PHASES[index] if index < len(PHASES) else 'phase %d' % index
+
+
+def read_trace(path):
+    """Yield the time, name, thread and event of every kuka_drivers event of the trace."""
+    try:
+        import bt2
+    except ImportError:
+        sys.exit('The babeltrace2 Python bindings (python3-bt2) are required')
+    for message in bt2.TraceCollectionMessageIterator(path):
+        if type(message) is not bt2._EventMessageConst:
+            continue
+        event = message.event
+        if not event.name.startswith('kuka_drivers:'):
+            continue
+        tid = field_value(event, 'vtid', 0)
+        yield (message.default_clock_snapshot.ns_from_origin, event.name[len('kuka_drivers:'):],
+               int(tid), event)
+
+
+def build_spans(events):
+    """Pair the begin and end events per thread, return the outermost spans and the names."""
+    stacks = {}
+    spans = []
+    names = {}
+    transitions = []
+    open_transitions = {}
+    for time, name, tid, event in events:
+        if name == 'phase_begin':
+            span = Span(phase_name(event['phase']), int(event['instance']), tid, time)
+            stack = stacks.setdefault(tid, [])
+            if stack:
+                stack[-1].children.append(span)
+            else:
+                spans.append(span)
+            stack.append(span)
+        elif name == 'phase_end':
+            phase = phase_name(event['phase'])
+            instance = int(event['instance'])
+            stack = stacks.get(tid, [])
+            # An end without its begin (the session started inside the phase) is dropped
+            for i in range(len(stack) - 1, -1, -1):
+                if stack[i].phase == phase and stack[i].instance == instance:
+                    stack[i].end = time
+                    del stack[i:]
+                    break
+        elif name == 'instance_name':
+            names[int(event['instance'])] = str(event['name'])
+        elif name == 'transition_begin':
+            open_transitions[(str(event['node']), str(event['transition']))] = time
+        elif name == 'transition_end':
+            key = (str(event['node']), str(event['transition']))
+            if key in open_transitions:
+                transitions.append((open_transitions.pop(key), time, key))
+    return spans, names, transitions
+
+
+def build_cycles(spans):
+    """Group the outermost spans into cycles starting with the read of control_node."""
+    loop_tids = {span.tid for span in spans if span.phase == 'read'}
+    if not loop_tids:
+        return []
+    # The thread with the most reads is the control loop
+    loop_tid = max(
+        loop_tids, key=lambda tid: sum(
+            1 for span in spans if span.tid == tid and span.phase == 'read'))
+    cycles = []
+    for span in spans:
+        if span.tid != loop_tid or span.phase not in LOOP_PHASES:
+            continue
+        if span.phase == 'read' or not cycles:
+            cycles.append(Cycle(len(cycles), span.begin))
+        cycles[-1].loop.append(span)
+        cycles[-1].end = span.end
+
+    others = sorted(
+        (span for span in spans if span.tid != loop_tid), key=lambda span: span.end)
+    index = 0
+    for span in others:
+        while index < len(cycles) and cycles[index].end < span.end:
+            index += 1
+        if index == len(cycles):
+            break
+        cycles[index].other.append(span)
+    return cycles
+
+
+def percentile(values, percent):
+    if not values:
+        return 0
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(percent / 100.0 * (len(ordered) - 1) + 0.5))]
+
+
+def collect_durations(cycles, names):
+    """Return the durations of every phase label over the cycles, nested phases included."""
+    durations = {}
+
+    def visit(span):
+        durations.setdefault(span.label(names), []).append(span.duration())
+        for child in span.children:
+            visit(child)
+
+    for cycle in cycles:
+        durations.setdefault('cycle', []).append(cycle.duration())
+        for span in cycle.loop + cycle.other:
+            visit(span)
+    return durations
+
+
+def print_timeline(cycle, names):
+    print('cycle %d: %.1f us' % (cycle.index, cycle.duration() / 1000.0))
+
+    def visit(span, depth):
+        print('  %s%-28s +%8.1f us %8.1f us  [tid %d]' % (
+            '  ' * depth, span.label(names), (span.begin - cycle.begin) / 1000.0,
+            span.duration() / 1000.0, span.tid))
+        for child in span.children:
+            visit(child, depth + 1)
+
+    for span in sorted(cycle.loop + cycle.other, key=lambda span: span.begin):
+        visit(span, 0)
+    print('  critical path: %s' % cycle.critical_path(names))
+
+
+def write_csv(path, cycles, names):
+    with open(path, 'w', newline='') as output:
+        writer = csv.writer(output)
+        writer.writerow([
+            'cycle', 'begin_ns', 'duration_ns', 'read_ns', 'update_ns', 'write_ns',
+            'critical_path'])
+        for cycle in cycles:
+            writer.writerow([
+                cycle.index, cycle.begin, cycle.duration(), cycle.loop_duration('read'),
+                cycle.loop_duration('update'), cycle.loop_duration('write'),
+                cycle.critical_path(names)])
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument('trace', help='directory of the recorded trace, e.g. ~/lttng-traces/kuka')
+    parser.add_argument(
+        '--worst', type=int, default=5, help='number of slowest cycles shown (default: 5)')
+    parser.add_argument(
+        '--cycles', type=int, default=0, help='number of first cycles shown (default: 0)')
+    parser.add_argument('--csv', help='write one row per cycle into this file')
+    args = parser.parse_args()
+
+    spans, names, transitions = build_spans(read_trace(args.trace))
+    cycles = build_cycles(spans)
+    if not cycles and not transitions:
+        sys.exit('No kuka_drivers events in the trace')
+
+    if cycles:
+        print('%d cycles' % len(cycles))
+        print('%-32s %8s %10s %10s %10s' % ('phase', 'count', 'p50 [us]', 'p99 [us]', 'max [us]'))
+        for label, values in sorted(collect_durations(cycles, names).items()):
+            print('%-32s %8d %10.1f %10.1f %10.1f' % (
+                label, len(values), percentile(values, 50) / 1000.0,
+                percentile(values, 99) / 1000.0, max(values) / 1000.0))
+        print()
+        for cycle in cycles[:args.cycles]:
+            print_timeline(cycle, names)
+        for cycle in sorted(cycles, key=Cycle.duration, reverse=True)[:args.worst]:
+            print_timeline(cycle, names)
+    if transitions:
+        print()
+        print('lifecycle transitions')
+        for begin, end, (node, transition) in transitions:
+            print('  %-32s %-12s %10.1f ms' % (node, transition, (end - begin) / 1e6))
+    if args.csv:
+        write_csv(args.csv, cycles, names)
+
+
+if __name__ == '__main__':
+    main()
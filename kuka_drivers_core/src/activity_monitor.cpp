@@ -0,0 +1,70 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <chrono>
+#include <mutex>
+
+#include "kuka_drivers_core/activity_monitor.hpp"
+
+namespace kuka_drivers_core
+{
+void ActivityMonitor::Flag::Set()
+{
+  if (!set_.exchange(true)) {
+    Instance().Added();
+  }
+}
+
+void ActivityMonitor::Flag::Clear()
+{
+  if (set_.exchange(false)) {
+    Instance().active_count_.fetch_sub(1, std::memory_order_release);
+  }
+}
+
+ActivityMonitor & ActivityMonitor::Instance()
+{
+  static ActivityMonitor monitor;
+  return monitor;
+}
+
+void ActivityMonitor::Added()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    active_count_.fetch_add(1, std::memory_order_release);
+    ++notifications_;
+  }
+  cv_.notify_all();
+}
+
+void ActivityMonitor::Notify()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++notifications_;
+  }
+  cv_.notify_all();
+}
+
+bool ActivityMonitor::WaitForActivity(std::chrono::nanoseconds timeout)
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  const uint64_t notifications = notifications_;
+  cv_.wait_for(
+    lock, timeout, [this, notifications] {return Active() || notifications_ != notifications;});
+  return Active();
+}
+}  // namespace kuka_drivers_core
@@ -0,0 +1,252 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Replacement of the glibc allocation functions, linked only with the TRACK_RT_ALLOCATIONS
+//  option. The replacements forward to the __libc_* implementations, which glibc exports for
+//  this purpose, so no dlsym is needed before the first allocation.
+
+#ifndef KUKA_TRACK_RT_ALLOCATIONS
+#define KUKA_TRACK_RT_ALLOCATIONS
+#endif
+
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <errno.h>
+#include <execinfo.h>
+
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "kuka_drivers_core/allocation_tracker.hpp"
+#include "kuka_drivers_core/spsc_queue.hpp"
+
+extern "C" {
+void * __libc_malloc(std::size_t size);
+void * __libc_calloc(std::size_t count, std::size_t size);
+void * __libc_realloc(void * memory, std::size_t size);
+void * __libc_memalign(std::size_t alignment, std::size_t size);
+void __libc_free(void * memory);
+}
+
+namespace kuka_drivers_core
+{
+namespace allocation_tracker
+{
+namespace
+{
+// The hook and the replaced function are not part of the reported backtrace
+constexpr int SKIPPED_FRAMES = 2;
+
+thread_local Phase current_phase = Phase::NONE;
+// Set while a call is recorded, allocations of backtrace() itself are not tracked
+thread_local bool recording = false;
+
+std::array<std::array<std::atomic<uint64_t>, 2>, PHASE_COUNT> counts{};
+std::atomic<uint64_t> dropped{0};
+SPSCQueue<Allocation, 256> queue;
+
+void Record(Kind kind, std::size_t size)
+{
+  if (current_phase == Phase::NONE || recording) {
+    return;
+  }
+  recording = true;
+  counts[static_cast<std::size_t>(current_phase)][static_cast<std::size_t>(kind)].fetch_add(
+    1, std::memory_order_relaxed);
+  Allocation allocation;
+  allocation.phase = current_phase;
+  allocation.kind = kind;
+  allocation.size = size;
+  allocation.depth = backtrace(allocation.frames, static_cast<int>(MAX_FRAMES));
+  if (!queue.Push(allocation)) {
+    dropped.fetch_add(1, std::memory_order_relaxed);
+  }
+  recording = false;
+}
+
+const char * BaseName(const char * path)
+{
+  const char * slash = std::strrchr(path, '/');
+  return slash != nullptr ? slash + 1 : path;
+}
+
+bool IsRuntimeLibrary(const char * name)
+{
+  static const char * const prefixes[] = {
+    "libc.so", "libc-", "libstdc++", "libgcc_s", "libm.so", "ld-linux"};
+  for (const char * prefix : prefixes) {
+    if (std::strncmp(name, prefix, std::strlen(prefix)) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// backtrace() loads libgcc_s at its first call, which must not happen inside a hook
+struct Warmup
+{
+  Warmup()
+  {
+    void * frames[2];
+    backtrace(frames, 2);
+  }
+} warmup;
+}  // namespace
+
+ScopedPhase::ScopedPhase(Phase phase)
+: previous_(current_phase)
+{
+  current_phase = phase;
+}
+
+ScopedPhase::~ScopedPhase()
+{
+  current_phase = previous_;
+}
+
+uint64_t Count(Phase phase, Kind kind)
+{
+  return counts[static_cast<std::size_t>(phase)][static_cast<std::size_t>(kind)].load(
+    std::memory_order_relaxed);
+}
+
+uint64_t Dropped()
+{
+  return dropped.load(std::memory_order_relaxed);
+}
+
+bool Pop(Allocation & allocation)
+{
+  return queue.Pop(allocation);
+}
+
+std::string Origin(const Allocation & allocation)
+{
+  // The first frame outside the executable and the runtime libraries made the call, the
+  //  executable itself only if no plugin is on the stack
+  Dl_info own;
+  const bool own_known = dladdr(reinterpret_cast<void *>(&Record), &own) != 0;
+  std::string fallback = "unknown";
+  for (int i = SKIPPED_FRAMES; i < allocation.depth; ++i) {
+    Dl_info info;
+    if (dladdr(allocation.frames[i], &info) == 0 || info.dli_fname == nullptr ||
+      IsRuntimeLibrary(BaseName(info.dli_fname)))
+    {
+      continue;
+    }
+    if (own_known && info.dli_fbase == own.dli_fbase) {
+      if (fallback == "unknown") {
+        fallback = BaseName(info.dli_fname);
+      }
+      continue;
+    }
+    return BaseName(info.dli_fname);
+  }
+  return fallback;
+}
+
+std::string Describe(const Allocation & allocation)
+{
+  std::string description = std::string(allocation.kind == Kind::FREE ? "free" : "allocation") +
+    " in " + PhaseName(allocation.phase);
+  if (allocation.kind == Kind::ALLOCATION) {
+    description += " of " + std::to_string(allocation.size) + " bytes";
+  }
+  description += " by " + Origin(allocation);
+
+  for (int i = SKIPPED_FRAMES; i < allocation.depth; ++i) {
+    char line[512];
+    Dl_info info;
+    if (dladdr(allocation.frames[i], &info) == 0) {
+      std::snprintf(line, sizeof(line), "\n  #%d %p", i - SKIPPED_FRAMES, allocation.frames[i]);
+      description += line;
+      continue;
+    }
+    const char * object = info.dli_fname != nullptr ? BaseName(info.dli_fname) : "?";
+    int status = -1;
+    char * demangled = info.dli_sname != nullptr ?
+      abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status) : nullptr;
+    const char * symbol = status == 0 ? demangled :
+      (info.dli_sname != nullptr ? info.dli_sname : "?");
+    const std::ptrdiff_t offset = static_cast<char *>(allocation.frames[i]) -
+      static_cast<char *>(info.dli_saddr != nullptr ? info.dli_saddr : info.dli_fbase);
+    std::snprintf(
+      line, sizeof(line), "\n  #%d %s(%s+0x%tx)", i - SKIPPED_FRAMES, object, symbol, offset);
+    std::free(demangled);
+    description += line;
+  }
+  return description;
+}
+}  // namespace allocation_tracker
+}  // namespace kuka_drivers_core
+
+namespace tracker = kuka_drivers_core::allocation_tracker;
+
+extern "C" {
+void * malloc(std::size_t size)
+{
+  tracker::Record(tracker::Kind::ALLOCATION, size);
+  return __libc_malloc(size);
+}
+
+void * calloc(std::size_t count, std::size_t size)
+{
+  tracker::Record(tracker::Kind::ALLOCATION, count * size);
+  return __libc_calloc(count, size);
+}
+
+void * realloc(void * memory, std::size_t size)
+{
+  tracker::Record(tracker::Kind::ALLOCATION, size);
+  return __libc_realloc(memory, size);
+}
+
+void * memalign(std::size_t alignment, std::size_t size)
+{
+  tracker::Record(tracker::Kind::ALLOCATION, size);
+  return __libc_memalign(alignment, size);
+}
+
+void * aligned_alloc(std::size_t alignment, std::size_t size)
+{
+  tracker::Record(tracker::Kind::ALLOCATION, size);
+  return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void ** memory, std::size_t alignment, std::size_t size)
+{
+  if (alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0) {
+    return EINVAL;
+  }
+  tracker::Record(tracker::Kind::ALLOCATION, size);
+  void * result = __libc_memalign(alignment, size);
+  if (result == nullptr) {
+    return ENOMEM;
+  }
+  *memory = result;
+  return 0;
+}
+
+void free(void * memory)
+{
+  if (memory != nullptr) {
+    tracker::Record(tracker::Kind::FREE, 0);
+  }
+  __libc_free(memory);
+}
+}
@@ -12,57 +12,531 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-#include <thread>
+#include <alloca.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <time.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include "controller_manager/controller_manager.hpp"
+#include "diagnostic_msgs/msg/diagnostic_array.hpp"
 #include "rclcpp/rclcpp.hpp"
+#include "rclcpp_components/component_manager.hpp"
 #include "std_msgs/msg/bool.hpp"
 
+#include "kuka_drivers_core/allocation_tracker.hpp"
+#include "kuka_drivers_core/activity_monitor.hpp"
+#include "kuka_drivers_core/cycle_coordinator.hpp"
+#include "kuka_drivers_core/latency_histogram.hpp"
+#include "kuka_drivers_core/metrics_exporter.hpp"
+#include "kuka_drivers_core/startup_profile.hpp"
+#include "kuka_drivers_core/tracing.hpp"
+
+namespace
+{
+// 10 us buckets up to 50 ms, above the cycles of all drivers
+using Histogram = kuka_drivers_core::LatencyHistogram<5000, 10000>;
+
+/**
+ * Durations of the phases of the control loop, recorded by the loop and published on
+ * /diagnostics by a separate thread
+ */
+struct LoopStatistics
+{
+  Histogram read;
+  Histogram update;
+  Histogram write;
+  // Time between the start of consecutive cycles
+  Histogram period;
+  std::atomic<uint64_t> overruns{0};
+  std::atomic<uint64_t> missed_cycles{0};
+};
+
+// Settings of the control loop thread, parameters of the controller_manager
+struct RealTimeSettings
+{
+  // SCHED_FIFO priority, 0 keeps the default scheduling
+  int priority;
+  // Cores the thread may run on, empty keeps the affinity of the process
+  std::vector<int64_t> cpu_affinity;
+  // Lock the current and future pages of the process into memory
+  bool lock_memory;
+  // Bytes of the heap and the stack of the thread touched in advance
+  int64_t prefault_heap_size;
+  int64_t prefault_stack_size;
+};
+
+template<typename T>
+T getParameter(rclcpp::Node & node, const std::string & name, const T & default_value)
+{
+  // The controller_manager declares the parameters of the parameter file automatically
+  T value = default_value;
+  if (!node.get_parameter(name, value)) {
+    node.declare_parameter<T>(name, default_value);
+  }
+  return value;
+}
+
+void prefaultStack(std::size_t size)
+{
+  // Writing the memory maps the pages, the volatile pointer keeps the write
+  volatile char * stack = static_cast<volatile char *>(alloca(size));
+  for (std::size_t i = 0; i < size; i += 4096) {
+    stack[i] = 0;
+  }
+}
+
+void prefaultHeap(std::size_t size)
+{
+  // Freed memory must stay in the heap instead of being returned to the system
+  mallopt(M_TRIM_THRESHOLD, -1);
+  mallopt(M_MMAP_MAX, 0);
+  char * heap = static_cast<char *>(std::malloc(size));
+  if (heap != nullptr) {
+    std::memset(heap, 0, size);
+    std::free(heap);
+  }
+}
+
+// Applied by the control loop thread on itself, failures are reported but not fatal
+void applyRealTimeSettings(const RealTimeSettings & settings, const rclcpp::Logger & logger)
+{
+  if (!settings.cpu_affinity.empty()) {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (int64_t cpu : settings.cpu_affinity) {
+      CPU_SET(static_cast<int>(cpu), &cpu_set);
+    }
+    const int result = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+    if (result != 0) {
+      RCLCPP_ERROR(logger, "Setting the CPU affinity failed: %s", strerror(result));
+    }
+  }
+
+  if (settings.priority > 0) {
+    struct sched_param param;
+    param.sched_priority = settings.priority;
+    if (sched_setscheduler(0, SCHED_FIFO, &param) == -1) {
+      RCLCPP_ERROR(logger, "setscheduler error");
+      RCLCPP_ERROR(logger, strerror(errno));
+      RCLCPP_WARN(logger, "You can use the driver but scheduler priority was not set");
+    }
+  }
+
+  if (settings.lock_memory && mlockall(MCL_CURRENT | MCL_FUTURE) == -1) {
+    RCLCPP_ERROR(logger, "Locking the memory failed: %s", strerror(errno));
+  }
+  if (settings.prefault_heap_size > 0) {
+    prefaultHeap(static_cast<std::size_t>(settings.prefault_heap_size));
+  }
+  if (settings.prefault_stack_size > 0) {
+    prefaultStack(static_cast<std::size_t>(settings.prefault_stack_size));
+  }
+}
+
+int64_t toNs(const timespec & time)
+{
+  return static_cast<int64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+}
+
+timespec fromNs(int64_t ns)
+{
+  timespec time;
+  time.tv_sec = static_cast<time_t>(ns / 1000000000);
+  time.tv_nsec = static_cast<long>(ns % 1000000000);  // NOLINT
+  return time;
+}
+
+int64_t monotonicNs()
+{
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return toNs(now);
+}
+
+void recordDuration(Histogram & histogram, int64_t duration_ns)
+{
+  histogram.Record(duration_ns > 0 ? static_cast<uint64_t>(duration_ns) : 0);
+}
+
+// Collects the calls of the allocation functions in the real-time phases, recorded only if the
+//  node is built with the TRACK_RT_ALLOCATIONS option
+class AllocationReport
+{
+public:
+  // Takes over the recorded calls, the backtrace of each new call site is logged once
+  //  returns the number of calls since the previous check
+  uint64_t Collect(const rclcpp::Logger & logger)
+  {
+    namespace tracker = kuka_drivers_core::allocation_tracker;
+    uint64_t calls = 0;
+    tracker::Allocation allocation;
+    while (tracker::Pop(allocation)) {
+      ++calls;
+      const std::string origin = tracker::Origin(allocation);
+      ++calls_by_origin_[std::string(tracker::PhaseName(allocation.phase)) + " " +
+        (allocation.kind == tracker::Kind::FREE ? "frees" : "allocations") + " by " + origin];
+      const std::vector<void *> call_site(
+        allocation.frames, allocation.frames + allocation.depth);
+      if (reported_call_sites_.size() < MAX_REPORTED_CALL_SITES &&
+        reported_call_sites_.insert(call_site).second)
+      {
+        RCLCPP_WARN(
+          logger, "Heap usage in the control loop: %s", tracker::Describe(allocation).c_str());
+      }
+    }
+    return calls;
+  }
+
+  const std::map<std::string, uint64_t> & CallsByOrigin() const {return calls_by_origin_;}
+
+private:
+  static constexpr std::size_t MAX_REPORTED_CALL_SITES = 100;
+  std::set<std::vector<void *>> reported_call_sites_;
+  std::map<std::string, uint64_t> calls_by_origin_;
+};
+
+void publishStatistics(
+  const LoopStatistics & statistics, rclcpp::Node & node,
+  rclcpp::Publisher<diagnostic_msgs::msg::DiagnosticArray> & publisher,
+  std::mutex & mutex, std::condition_variable & cv, const bool & terminate)
+{
+  auto to_us = [](uint64_t ns) {return std::to_string(ns / 1000);};
+  const std::vector<std::pair<std::string, const Histogram *>> phases = {
+    {"read", &statistics.read}, {"update", &statistics.update}, {"write", &statistics.write},
+    {"period", &statistics.period}};
+  std::vector<Histogram::Snapshot> previous;
+  for (const auto & phase : phases) {
+    previous.push_back(phase.second->GetSnapshot());
+  }
+  uint64_t previous_overruns = 0;
+  AllocationReport allocation_report;
+
+  std::unique_lock<std::mutex> lk(mutex);
+  while (!cv.wait_for(lk, std::chrono::seconds(1), [&terminate] {return terminate;})) {
+    diagnostic_msgs::msg::DiagnosticStatus status;
+    status.name = std::string(node.get_name()) + ": control loop";
+    status.hardware_id = node.get_name();
+
+    const uint64_t overruns = statistics.overruns.load(std::memory_order_relaxed);
+    const uint64_t window_overruns = overruns - previous_overruns;
+    previous_overruns = overruns;
+    if (window_overruns > 0) {
+      status.level = diagnostic_msgs::msg::DiagnosticStatus::WARN;
+      status.message = "Cycle overruns in the last period";
+    } else {
+      status.level = diagnostic_msgs::msg::DiagnosticStatus::OK;
+      status.message = "OK";
+    }
+
+    auto add_value = [&status](const std::string & key, const std::string & value) {
+        diagnostic_msgs::msg::KeyValue key_value;
+        key_value.key = key;
+        key_value.value = value;
+        status.values.push_back(key_value);
+      };
+    add_value("overruns", std::to_string(window_overruns));
+    add_value("overruns since start", std::to_string(overruns));
+    add_value(
+      "missed cycles since start",
+      std::to_string(statistics.missed_cycles.load(std::memory_order_relaxed)));
+    // Robots aligned by the cycle coordinator, there are none without cycle_coordination
+    std::array<kuka_drivers_core::CycleCoordinator::RobotStatus,
+      kuka_drivers_core::CycleCoordinator::MAX_ROBOTS> robots;
+    const std::size_t robot_count = kuka_drivers_core::CycleCoordinator::Instance().Status(robots);
+    for (std::size_t i = 0; i < robot_count; ++i) {
+      const auto & robot = robots[i];
+      add_value(robot.name + " period [us]", std::to_string(robot.period * 1e6));
+      add_value(robot.name + " lead [us]", std::to_string(robot.lead * 1e6));
+      add_value(
+        robot.name + " deadline misses since start", std::to_string(robot.deadline_misses));
+    }
+    if (kuka_drivers_core::allocation_tracker::ENABLED) {
+      const uint64_t allocations = allocation_report.Collect(node.get_logger());
+      if (allocations > 0 && status.level == diagnostic_msgs::msg::DiagnosticStatus::OK) {
+        status.level = diagnostic_msgs::msg::DiagnosticStatus::WARN;
+        status.message = "Heap usage in the real-time phases in the last period";
+      }
+      for (const auto & origin : allocation_report.CallsByOrigin()) {
+        add_value(origin.first + " since start", std::to_string(origin.second));
+      }
+      add_value(
+        "untracked allocation backtraces",
+        std::to_string(kuka_drivers_core::allocation_tracker::Dropped()));
+    }
+    for (std::size_t i = 0; i < phases.size(); ++i) {
+      const auto current = phases[i].second->GetSnapshot();
+      const auto window = current - previous[i];
+      previous[i] = current;
+      add_value(phases[i].first + " p50 [us]", to_us(window.Percentile(50)));
+      add_value(phases[i].first + " p99 [us]", to_us(window.Percentile(99)));
+      add_value(phases[i].first + " max [us]", to_us(window.interval_max_ns));
+      add_value(phases[i].first + " max since start [us]", to_us(window.max_ns));
+    }
+
+    diagnostic_msgs::msg::DiagnosticArray msg;
+    msg.header.stamp = node.now();
+    msg.status.push_back(status);
+    publisher.publish(msg);
+  }
+}
+}  // namespace
 
 int main(int argc, char ** argv)
 {
   rclcpp::init(argc, argv);
   auto executor = std::make_shared<rclcpp::executors::MultiThreadedExecutor>();
-  auto controller_manager = std::make_shared<controller_manager::ControllerManager>(
-    executor,
-    "controller_manager");
+  // The controller manager loads the hardware plugins and calls their on_init() on construction
+  kuka_drivers_core::StartupProfile startup_profile("control_node");
+  std::shared_ptr<controller_manager::ControllerManager> controller_manager;
+  {
+    kuka_drivers_core::StartupProfile::Scope phase(startup_profile, "load_hardware");
+    controller_manager = std::make_shared<controller_manager::ControllerManager>(
+      executor,
+      "controller_manager");
+  }
+
+  // With deadline scheduling the loop sleeps until the start of the next period on an absolute
+  //  timeline, otherwise it is paced by the blocking read of the drivers
+  const bool deadline_scheduling =
+    getParameter<bool>(*controller_manager, "deadline_scheduling", false);
+  // The deadlines follow the cycles of the robots instead, if their drivers report them
+  const bool cycle_coordination =
+    getParameter<bool>(*controller_manager, "cycle_coordination", false);
+  const int64_t cycle_guard_ns = 1000 * getParameter<int64_t>(
+    *controller_manager, "cycle_guard_us", 100);
+  // Without an active hardware interface the loop blocks until an activation, and only updates
+  //  the controller manager (e.g. for the controller switches of a configuration) in between
+  const bool idle_mode = getParameter<bool>(*controller_manager, "idle_mode", false);
+  const int64_t idle_period_ns = 1000000000LL / std::max<int64_t>(
+    1, getParameter<int64_t>(*controller_manager, "idle_rate", 10));
+  if (cycle_coordination && !deadline_scheduling) {
+    RCLCPP_ERROR(
+      controller_manager->get_logger(),
+      "cycle_coordination requires deadline_scheduling, the loop is paced by the drivers");
+  }
+
+  RealTimeSettings rt_settings;
+  rt_settings.priority = static_cast<int>(getParameter<int64_t>(
+      *controller_manager, "rt_priority", 95));
+  rt_settings.cpu_affinity = getParameter<std::vector<int64_t>>(
+    *controller_manager, "cpu_affinity", {});
+  rt_settings.lock_memory = getParameter<bool>(*controller_manager, "lock_memory", false);
+  rt_settings.prefault_heap_size = getParameter<int64_t>(
+    *controller_manager, "prefault_heap_size", 0);
+  rt_settings.prefault_stack_size = getParameter<int64_t>(
+    *controller_manager, "prefault_stack_size", 0);
+
+  // The robot manager can be loaded into this process as a component, its messages to the loop
+  //  are then passed within the process
+  const bool component_container =
+    getParameter<bool>(*controller_manager, "component_container", false);
+  std::shared_ptr<rclcpp_components::ComponentManager> component_manager;
+  if (component_container) {
+    component_manager = std::make_shared<rclcpp_components::ComponentManager>(
+      executor, "control_container");
+    executor->add_node(component_manager);
+  }
 
   auto qos = rclcpp::QoS(rclcpp::KeepLast(1));
   qos.best_effort();
+  rclcpp::SubscriptionOptions is_configured_options;
+  if (component_container) {
+    is_configured_options.use_intra_process_comm = rclcpp::IntraProcessSetting::Enable;
+  }
+
+  // The update_rate can be changed at runtime, e.g. by a robot manager changing the cycle time of
+  //  the robot, the loop takes the new period over at the start of its next cycle
+  std::atomic<int64_t> loop_period_ns{1000000000LL / getParameter<int64_t>(
+      *controller_manager, "update_rate", controller_manager->get_update_rate())};
+  auto update_rate_callback = controller_manager->add_on_set_parameters_callback(
+    [&loop_period_ns](const std::vector<rclcpp::Parameter> & parameters) {
+      rcl_interfaces::msg::SetParametersResult result;
+      result.successful = true;
+      for (const auto & parameter : parameters) {
+        if (parameter.get_name() != "update_rate") {
+          continue;
+        }
+        if (parameter.get_type() != rclcpp::ParameterType::PARAMETER_INTEGER ||
+        parameter.as_int() <= 0)
+        {
+          result.successful = false;
+          result.reason = "update_rate must be a positive integer";
+          return result;
+        }
+        loop_period_ns.store(1000000000LL / parameter.as_int(), std::memory_order_relaxed);
+      }
+      return result;
+    });
 
   std::atomic_bool is_configured = false;
   auto is_configured_sub = controller_manager->create_subscription<std_msgs::msg::Bool>(
     "robot_manager/is_configured", qos,
     [&is_configured](std_msgs::msg::Bool::SharedPtr msg) {
       is_configured = msg->data;
-    });
+      kuka_drivers_core::ActivityMonitor::Instance().Notify();
+    }, is_configured_options);
 
+  auto statistics = std::make_unique<LoopStatistics>();
+  // Optional export of the overruns for Prometheus, shared with the hardware interfaces
+  std::unique_ptr<kuka_drivers_core::MetricsExporter::Group> metrics_group;
+  const int64_t metrics_port = getParameter<int64_t>(*controller_manager, "metrics_port", 0);
+  if (metrics_port > 0) {
+    std::string metrics_error;
+    if (metrics_port > 65535 ||
+      !kuka_drivers_core::MetricsExporter::Instance().Start(
+        getParameter<std::string>(*controller_manager, "metrics_address", "0.0.0.0"),
+        static_cast<uint16_t>(metrics_port), metrics_error))
+    {
+      RCLCPP_ERROR(
+        controller_manager->get_logger(), "Metrics are not exported: %s",
+        metrics_error.empty() ? "metrics_port must be below 65536" : metrics_error.c_str());
+    } else {
+      metrics_group = std::make_unique<kuka_drivers_core::MetricsExporter::Group>("control_node");
+      const LoopStatistics * loop_statistics = statistics.get();
+      metrics_group->AddCounter(
+        "loop_overruns_total", "Cycles of the control loop that exceeded their period",
+        [loop_statistics]() {return loop_statistics->overruns.load(std::memory_order_relaxed);});
+      metrics_group->AddCounter(
+        "loop_missed_cycles_total", "Cycles of the control loop skipped after an overrun",
+        [loop_statistics]() {
+          return loop_statistics->missed_cycles.load(std::memory_order_relaxed);
+        });
+    }
+  }
+  auto diagnostics_publisher =
+    controller_manager->create_publisher<diagnostic_msgs::msg::DiagnosticArray>(
+    "/diagnostics", rclcpp::SystemDefaultsQoS());
+  std::mutex diagnostics_mutex;
+  std::condition_variable diagnostics_cv;
+  bool terminate_diagnostics = false;
+  std::thread diagnostics_thread([&]() {
+      publishStatistics(
+        *statistics, *controller_manager, *diagnostics_publisher, diagnostics_mutex,
+        diagnostics_cv, terminate_diagnostics);
+    });
 
-  std::thread control_loop([controller_manager, &is_configured]() {
-      struct sched_param param;
-      param.sched_priority = 95;
-      if (sched_setscheduler(0, SCHED_FIFO, &param) == -1) {
-        RCLCPP_ERROR(controller_manager->get_logger(), "setscheduler error");
-        RCLCPP_ERROR(controller_manager->get_logger(), strerror(errno));
-        RCLCPP_WARN(
-          controller_manager->get_logger(),
-          "You can use the driver but scheduler priority was not set");
+  std::thread control_loop([controller_manager, &is_configured, &statistics, &loop_period_ns,
+      &startup_profile, deadline_scheduling, cycle_coordination, cycle_guard_ns, idle_mode,
+      idle_period_ns, rt_settings]() {
+      {
+        kuka_drivers_core::StartupProfile::Scope phase(startup_profile, "real_time_settings");
+        applyRealTimeSettings(rt_settings, controller_manager->get_logger());
       }
+      startup_profile.Log(controller_manager->get_logger());
 
-      const rclcpp::Duration dt =
-      rclcpp::Duration::from_seconds(1.0 / controller_manager->get_update_rate());
-      std::chrono::milliseconds dt_ms {1000 / controller_manager->get_update_rate()};
+      int64_t period_ns = loop_period_ns.load(std::memory_order_relaxed);
+      rclcpp::Duration dt = rclcpp::Duration(std::chrono::nanoseconds(period_ns));
 
+      int64_t next_start_ns = monotonicNs();
+      int64_t previous_start_ns = 0;
+      const rclcpp::Duration idle_dt = rclcpp::Duration(std::chrono::nanoseconds(idle_period_ns));
+      auto & activity = kuka_drivers_core::ActivityMonitor::Instance();
       try {
         while (rclcpp::ok()) {
+          if (idle_mode && !activity.Active()) {
+            controller_manager->update(controller_manager->now(), idle_dt);
+            activity.WaitForActivity(std::chrono::nanoseconds(idle_period_ns));
+            // The idle time is not a cycle, the timeline starts again with the next one
+            next_start_ns = monotonicNs();
+            previous_start_ns = 0;
+            continue;
+          }
+          const int64_t start_ns = monotonicNs();
+          // A changed update_rate is applied at the cycle boundary, the timeline continues from
+          //  the start of this cycle with the new period
+          const int64_t new_period_ns = loop_period_ns.load(std::memory_order_relaxed);
+          if (new_period_ns != period_ns) {
+            period_ns = new_period_ns;
+            dt = rclcpp::Duration(std::chrono::nanoseconds(period_ns));
+            next_start_ns = start_ns;
+            previous_start_ns = 0;
+          }
+          const bool paced = deadline_scheduling || !is_configured;
+          if (previous_start_ns != 0) {
+            recordDuration(statistics->period, start_ns - previous_start_ns);
+            // Without a timeline, a cycle longer than 1.5 periods means a missed cycle
+            if (!paced && 2 * (start_ns - previous_start_ns) > 3 * period_ns) {
+              statistics->overruns.fetch_add(1, std::memory_order_relaxed);
+            }
+          }
+          previous_start_ns = start_ns;
+
+          using kuka_drivers_core::allocation_tracker::Phase;
+          using kuka_drivers_core::allocation_tracker::ScopedPhase;
+          namespace tracing = kuka_drivers_core::tracing;
           if (is_configured) {
-            controller_manager->read(controller_manager->now(), dt);
-            controller_manager->update(controller_manager->now(), dt);
-            controller_manager->write(controller_manager->now(), dt);
+            {
+              ScopedPhase phase(Phase::READ);
+              tracing::ScopedPhase trace(tracing::Phase::READ, controller_manager.get());
+              controller_manager->read(controller_manager->now(), dt);
+            }
+            const int64_t read_end_ns = monotonicNs();
+            {
+              ScopedPhase phase(Phase::UPDATE);
+              tracing::ScopedPhase trace(tracing::Phase::UPDATE, controller_manager.get());
+              controller_manager->update(controller_manager->now(), dt);
+            }
+            const int64_t update_end_ns = monotonicNs();
+            {
+              ScopedPhase phase(Phase::WRITE);
+              tracing::ScopedPhase trace(tracing::Phase::WRITE, controller_manager.get());
+              controller_manager->write(controller_manager->now(), dt);
+            }
+            const int64_t write_end_ns = monotonicNs();
+            recordDuration(statistics->read, read_end_ns - start_ns);
+            recordDuration(statistics->update, update_end_ns - read_end_ns);
+            recordDuration(statistics->write, write_end_ns - update_end_ns);
           } else {
             controller_manager->update(controller_manager->now(), dt);
-            std::this_thread::sleep_for(dt_ms);
+          }
+
+          if (!paced) {
+            next_start_ns = monotonicNs();
+            continue;
+          }
+          // The timeline is kept absolute, so the sleep does not accumulate the jitter
+          next_start_ns += period_ns;
+          const int64_t end_ns = monotonicNs();
+          int64_t aligned_start_ns = 0;
+          uint64_t skipped = 0;
+          if (cycle_coordination && is_configured &&
+            kuka_drivers_core::CycleCoordinator::Instance().NextCycleStart(
+              end_ns, cycle_guard_ns, aligned_start_ns, skipped))
+          {
+            // Aligned to the master robot, which skips the cycles that have passed itself
+            next_start_ns = aligned_start_ns;
+            if (skipped > 0) {
+              statistics->overruns.fetch_add(1, std::memory_order_relaxed);
+              statistics->missed_cycles.fetch_add(skipped, std::memory_order_relaxed);
+            }
+          } else if (end_ns > next_start_ns) {
+            statistics->overruns.fetch_add(1, std::memory_order_relaxed);
+            // Periods that have already passed are skipped instead of run back to back
+            const int64_t missed = (end_ns - next_start_ns) / period_ns + 1;
+            statistics->missed_cycles.fetch_add(
+              static_cast<uint64_t>(missed), std::memory_order_relaxed);
+            next_start_ns += missed * period_ns;
+          }
+          const timespec next_start = fromNs(next_start_ns);
+          while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next_start, nullptr) == EINTR) {
           }
         }
       } catch (std::exception & e) {
@@ -76,6 +550,12 @@ int main(int argc, char ** argv)
 
   executor->spin();
   control_loop.join();
+  {
+    std::lock_guard<std::mutex> lk(diagnostics_mutex);
+    terminate_diagnostics = true;
+  }
+  diagnostics_cv.notify_all();
+  diagnostics_thread.join();
 
   // shutdown
   rclcpp::shutdown();
@@ -11,6 +11,9 @@
 // WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 // See the License for the specific language governing permissions and
 // limitations under the License.
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
 #include <string>
 #include <vector>
 #include <utility>
@@ -19,6 +22,14 @@
 
 namespace kuka_drivers_core
 {
+namespace
+{
+std::size_t Index(ControlMode control_mode)
+{
+  return static_cast<std::size_t>(control_mode);
+}
+}  // namespace
+
 ControllerHandler::ControllerHandler(std::vector<std::string> fixed_controllers)
 : fixed_controllers_(fixed_controllers.begin(), fixed_controllers.end())
 {}
@@ -68,10 +79,14 @@ bool ControllerHandler::UpdateControllerName(
       RCLCPP_INFO(rclcpp::get_logger("ControllerHandler"), "Invalid Controller type");
       return false;
   }
+  // The active controllers might not belong to any control mode with the new names
+  switch_table_valid_ = false;
+  active_mode_known_ = active_controllers_.empty();
+  active_mode_ = ControlMode::UNSPECIFIED_CONTROL_MODE;
   return true;
 }
 
-std::pair<std::vector<std::string>, std::vector<std::string>>
+const ControllerHandler::SwitchLists &
 ControllerHandler::GetControllersForSwitch(ControlMode new_control_mode)
 {
   if (control_mode_map_.find(new_control_mode) == control_mode_map_.end()) {
@@ -83,70 +98,129 @@ ControllerHandler::GetControllersForSwitch(ControlMode new_control_mode)
     throw std::logic_error("UNSPECIFIED_CONTROL_MODE is not valid control mode");
   }
 
-  // Set controllers wich should be activated and deactivated
-  activate_controllers_.clear();
-  auto control_mode_controllers = control_mode_map_.at(new_control_mode);
-  activate_controllers_.insert(control_mode_controllers.standard_controller);
-  if (!control_mode_controllers.impedance_controller.empty()) {
-    activate_controllers_.insert(control_mode_controllers.impedance_controller);
+  if (!switch_table_valid_) {
+    BuildSwitchTable();
   }
-
-  activate_controllers_.insert(fixed_controllers_.begin(), fixed_controllers_.end());
-
-  deactivate_controllers_ = active_controllers_;
-
-
-  // Goes through every controllers that should be activated
-  for (auto activate_controllers_it = activate_controllers_.begin();
-    activate_controllers_it != activate_controllers_.end(); )
-  {
-    // Finds the controller in the deactivate controllers
-    auto deactivate_controllers_it =
-      deactivate_controllers_.find(*activate_controllers_it);
-    if (deactivate_controllers_it != deactivate_controllers_.end()) {
-      // Delete those controllers wich not need to be activated or deactivated.
-      activate_controllers_it = activate_controllers_.erase(activate_controllers_it);
-      deactivate_controllers_.erase(deactivate_controllers_it);
-    } else {
-      ++activate_controllers_it;
-    }
-  }
-
-  return std::make_pair(
-    std::vector<std::string>(
-      activate_controllers_.begin(),
-      activate_controllers_.end()),
-    std::vector<std::string>(
-      deactivate_controllers_.begin(),
-      deactivate_controllers_.end()));
+  pending_mode_ = new_control_mode;
+  pending_switch_ = active_mode_known_ ?
+    &switch_table_[Index(active_mode_)][Index(new_control_mode)] :
+    &ComputeSwitch(new_control_mode);
+  activation_pending_ = true;
+  deactivation_pending_ = true;
+  return *pending_switch_;
 }
 
-std::vector<std::string> ControllerHandler::GetControllersForDeactivation()
+const std::vector<std::string> & ControllerHandler::GetControllersForDeactivation()
 {
-  deactivate_controllers_ = active_controllers_;
-  return std::vector<std::string>(deactivate_controllers_.begin(), deactivate_controllers_.end());
+  if (!switch_table_valid_) {
+    BuildSwitchTable();
+  }
+  pending_mode_ = ControlMode::UNSPECIFIED_CONTROL_MODE;
+  if (active_mode_known_) {
+    pending_switch_ = &switch_table_[Index(active_mode_)][Index(pending_mode_)];
+  } else {
+    computed_switch_.first.clear();
+    computed_switch_.second.assign(active_controllers_.begin(), active_controllers_.end());
+    pending_switch_ = &computed_switch_;
+  }
+  activation_pending_ = false;
+  deactivation_pending_ = true;
+  return pending_switch_->second;
 }
 
 void ControllerHandler::ApproveControllerActivation()
 {
-  if (!activate_controllers_.empty()) {
-    active_controllers_.insert(activate_controllers_.begin(), activate_controllers_.end());
-    activate_controllers_.clear();
+  if (activation_pending_ && pending_switch_ != nullptr) {
+    active_controllers_.insert(pending_switch_->first.begin(), pending_switch_->first.end());
+    activation_pending_ = false;
+    UpdateActiveMode();
   }
 }
 
 bool ControllerHandler::ApproveControllerDeactivation()
 {
-  for (auto && controller : deactivate_controllers_) {
+  if (!deactivation_pending_ || pending_switch_ == nullptr) {
+    return true;
+  }
+  for (auto && controller : pending_switch_->second) {
     auto active_controller_it = active_controllers_.find(controller);
     if (active_controller_it == active_controllers_.end()) {
       // We should not reach this, active controllers should always contain the ones to deactivate
+      active_mode_known_ = false;
       return false;
     }
     active_controllers_.erase(active_controller_it);
   }
-  deactivate_controllers_.clear();
+  deactivation_pending_ = false;
+  UpdateActiveMode();
 
   return true;
 }
+
+void ControllerHandler::BuildSwitchTable()
+{
+  for (auto & controllers : mode_controllers_) {
+    controllers.clear();
+  }
+  for (const auto & entry : control_mode_map_) {
+    std::set<std::string> controllers = fixed_controllers_;
+    controllers.insert(entry.second.standard_controller);
+    if (!entry.second.impedance_controller.empty()) {
+      controllers.insert(entry.second.impedance_controller);
+    }
+    mode_controllers_[Index(entry.first)].assign(controllers.begin(), controllers.end());
+  }
+  // No controllers are active without a control mode
+  mode_controllers_[Index(ControlMode::UNSPECIFIED_CONTROL_MODE)].clear();
+
+  for (std::size_t active = 0; active < CONTROL_MODE_COUNT; ++active) {
+    const auto & active_controllers = mode_controllers_[active];
+    for (std::size_t target = 0; target < CONTROL_MODE_COUNT; ++target) {
+      const auto & target_controllers = mode_controllers_[target];
+      SwitchLists & lists = switch_table_[active][target];
+      lists.first.clear();
+      lists.second.clear();
+      std::set_difference(
+        target_controllers.begin(), target_controllers.end(), active_controllers.begin(),
+        active_controllers.end(), std::back_inserter(lists.first));
+      std::set_difference(
+        active_controllers.begin(), active_controllers.end(), target_controllers.begin(),
+        target_controllers.end(), std::back_inserter(lists.second));
+    }
+  }
+  switch_table_valid_ = true;
+}
+
+const ControllerHandler::SwitchLists & ControllerHandler::ComputeSwitch(
+  ControlMode new_control_mode)
+{
+  const auto & target_controllers = mode_controllers_[Index(new_control_mode)];
+  computed_switch_.first.clear();
+  computed_switch_.second.clear();
+  std::set_difference(
+    target_controllers.begin(), target_controllers.end(), active_controllers_.begin(),
+    active_controllers_.end(), std::back_inserter(computed_switch_.first));
+  std::set_difference(
+    active_controllers_.begin(), active_controllers_.end(), target_controllers.begin(),
+    target_controllers.end(), std::back_inserter(computed_switch_.second));
+  return computed_switch_;
+}
+
+void ControllerHandler::UpdateActiveMode()
+{
+  auto matches = [this](ControlMode control_mode) {
+      const auto & controllers = mode_controllers_[Index(control_mode)];
+      return controllers.size() == active_controllers_.size() &&
+             std::equal(controllers.begin(), controllers.end(), active_controllers_.begin());
+    };
+  if (!switch_table_valid_) {
+    // The names changed during the switch, the state is resolved by the next switch
+    active_mode_known_ = false;
+  } else if (matches(pending_mode_)) {
+    active_mode_ = pending_mode_;
+    active_mode_known_ = true;
+  } else if (!active_mode_known_ || !matches(active_mode_)) {
+    active_mode_known_ = false;
+  }
+}
 }   // namespace kuka_drivers_core
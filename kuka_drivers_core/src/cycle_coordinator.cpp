@@ -0,0 +1,229 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <string>
+
+#include "kuka_drivers_core/cycle_coordinator.hpp"
+
+namespace kuka_drivers_core
+{
+namespace
+{
+bool ParseBool(
+  const std::unordered_map<std::string, std::string> & parameters, const std::string & name,
+  bool & value, std::string & error)
+{
+  auto param = parameters.find(name);
+  if (param == parameters.end()) {
+    return true;
+  }
+  if (param->second != "true" && param->second != "false") {
+    error = name + " must be 'true' or 'false'";
+    return false;
+  }
+  value = param->second == "true";
+  return true;
+}
+
+int64_t ToNs(CycleCoordinator::Clock::time_point time)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+// Integer division rounded to the nearest integer, also for negative numerators
+int64_t DivideRounded(int64_t numerator, int64_t denominator)
+{
+  return numerator >= 0 ? (numerator + denominator / 2) / denominator :
+         -((-numerator + denominator / 2) / denominator);
+}
+}  // namespace
+
+bool CycleCoordinator::ParseOptions(
+  const std::unordered_map<std::string, std::string> & parameters, Options & options,
+  std::string & error)
+{
+  return ParseBool(parameters, "cycle_coordination", options.enabled, error) &&
+         ParseBool(parameters, "cycle_master", options.master, error);
+}
+
+CycleCoordinator & CycleCoordinator::Instance()
+{
+  static CycleCoordinator coordinator;
+  return coordinator;
+}
+
+int CycleCoordinator::Join(const std::string & name, bool master)
+{
+  std::lock_guard<std::mutex> lk(mutex_);
+  for (std::size_t i = 0; i < MAX_ROBOTS; ++i) {
+    Robot & robot = robots_[i];
+    if (robot.active.load(std::memory_order_relaxed)) {
+      continue;
+    }
+    robot.master = master;
+    robot.name = name;
+    robot.last_send_ns.store(0, std::memory_order_relaxed);
+    robot.period_ns.store(0, std::memory_order_relaxed);
+    robot.lead_ns.store(0, std::memory_order_relaxed);
+    robot.deadline_misses.store(0, std::memory_order_relaxed);
+    robot.latency_max_ns = 0;
+    robot.previous_latency_max_ns = 0;
+    robot.latency_samples = 0;
+    robot.active.store(true, std::memory_order_release);
+    return static_cast<int>(i);
+  }
+  return -1;
+}
+
+void CycleCoordinator::Leave(int robot)
+{
+  if (robot < 0 || robot >= static_cast<int>(MAX_ROBOTS)) {
+    return;
+  }
+  std::lock_guard<std::mutex> lk(mutex_);
+  robots_[robot].active.store(false, std::memory_order_release);
+}
+
+void CycleCoordinator::OnMessage(int robot_index, Clock::time_point send, Clock::time_point arrival)
+{
+  if (robot_index < 0 || robot_index >= static_cast<int>(MAX_ROBOTS)) {
+    return;
+  }
+  Robot & robot = robots_[robot_index];
+  const int64_t send_ns = ToNs(send);
+  const int64_t last_send_ns = robot.last_send_ns.load(std::memory_order_relaxed);
+  const int64_t period_ns = robot.period_ns.load(std::memory_order_relaxed);
+  const int64_t delta_ns = send_ns - last_send_ns;
+  if (last_send_ns != 0 && delta_ns > 0) {
+    // The mapped send times are already smooth, a gap of lost messages is not a period
+    if (period_ns == 0) {
+      robot.period_ns.store(delta_ns, std::memory_order_relaxed);
+    } else if (2 * delta_ns < 3 * period_ns) {
+      robot.period_ns.store(period_ns + (delta_ns - period_ns) / 8, std::memory_order_relaxed);
+    }
+  }
+  robot.last_send_ns.store(send_ns, std::memory_order_relaxed);
+
+  // Maximum of the current and the previous window, a spike is forgotten after two windows
+  robot.latency_max_ns = std::max(robot.latency_max_ns, ToNs(arrival) - send_ns);
+  if (++robot.latency_samples >= LATENCY_WINDOW) {
+    robot.previous_latency_max_ns = robot.latency_max_ns;
+    robot.latency_max_ns = 0;
+    robot.latency_samples = 0;
+  }
+}
+
+void CycleCoordinator::OnRead(int robot, bool fresh)
+{
+  if (fresh || robot < 0 || robot >= static_cast<int>(MAX_ROBOTS) ||
+    !scheduling_.load(std::memory_order_relaxed) ||
+    robots_[robot].period_ns.load(std::memory_order_relaxed) == 0)
+  {
+    return;
+  }
+  robots_[robot].deadline_misses.fetch_add(1, std::memory_order_relaxed);
+}
+
+int64_t CycleCoordinator::NearestSend(const Robot & robot, int64_t time_ns)
+{
+  const int64_t last_send_ns = robot.last_send_ns.load(std::memory_order_relaxed);
+  const int64_t period_ns = robot.period_ns.load(std::memory_order_relaxed);
+  return last_send_ns + DivideRounded(time_ns - last_send_ns, period_ns) * period_ns;
+}
+
+bool CycleCoordinator::NextCycleStart(
+  int64_t now_ns, int64_t guard_ns, int64_t & start_ns, uint64_t & skipped)
+{
+  // An explicit master, otherwise the first robot that knows its period
+  const Robot * master = nullptr;
+  for (const Robot & robot : robots_) {
+    if (!robot.active.load(std::memory_order_acquire) ||
+      robot.period_ns.load(std::memory_order_relaxed) == 0)
+    {
+      continue;
+    }
+    if (master == nullptr || (robot.master && !master->master)) {
+      master = &robot;
+    }
+  }
+  if (master == nullptr) {
+    scheduling_.store(false, std::memory_order_relaxed);
+    reference_ns_ = 0;
+    return false;
+  }
+
+  // The master message following the one of the last cycle, re-anchored on its latest message
+  const int64_t period_ns = master->period_ns.load(std::memory_order_relaxed);
+  const int64_t last_send_ns = master->last_send_ns.load(std::memory_order_relaxed);
+  int64_t target_ns = reference_ns_ + period_ns;
+  if (reference_ns_ == 0 || target_ns < last_send_ns - 10 * period_ns ||
+    target_ns > last_send_ns + 10 * period_ns)
+  {
+    target_ns = last_send_ns + period_ns;
+  }
+  target_ns = NearestSend(*master, target_ns);
+
+  // The cycle starts when the message of every robot nearest to the master one has arrived
+  int64_t ready_ns = target_ns;
+  for (const Robot & robot : robots_) {
+    if (!robot.active.load(std::memory_order_acquire) ||
+      robot.period_ns.load(std::memory_order_relaxed) == 0)
+    {
+      continue;
+    }
+    const int64_t latency_ns = std::max(robot.latency_max_ns, robot.previous_latency_max_ns);
+    ready_ns = std::max(ready_ns, NearestSend(robot, target_ns) + latency_ns);
+  }
+  start_ns = ready_ns + guard_ns;
+
+  // Cycles whose start has already passed are skipped, like on the timeline of the loop
+  skipped = 0;
+  if (start_ns < now_ns) {
+    skipped = static_cast<uint64_t>((now_ns - start_ns + period_ns - 1) / period_ns);
+    start_ns += static_cast<int64_t>(skipped) * period_ns;
+    target_ns += static_cast<int64_t>(skipped) * period_ns;
+  }
+  reference_ns_ = target_ns;
+
+  for (Robot & robot : robots_) {
+    if (robot.active.load(std::memory_order_acquire) &&
+      robot.period_ns.load(std::memory_order_relaxed) != 0)
+    {
+      robot.lead_ns.store(start_ns - NearestSend(robot, target_ns), std::memory_order_relaxed);
+    }
+  }
+  scheduling_.store(true, std::memory_order_relaxed);
+  return true;
+}
+
+std::size_t CycleCoordinator::Status(std::array<RobotStatus, MAX_ROBOTS> & status) const
+{
+  std::lock_guard<std::mutex> lk(mutex_);
+  std::size_t count = 0;
+  for (const Robot & robot : robots_) {
+    if (!robot.active.load(std::memory_order_acquire)) {
+      continue;
+    }
+    RobotStatus & robot_status = status[count++];
+    robot_status.name = robot.name;
+    robot_status.master = robot.master;
+    robot_status.period = static_cast<double>(robot.period_ns.load(std::memory_order_relaxed)) *
+      1e-9;
+    robot_status.lead = static_cast<double>(robot.lead_ns.load(std::memory_order_relaxed)) * 1e-9;
+    robot_status.deadline_misses = robot.deadline_misses.load(std::memory_order_relaxed);
+  }
+  return count;
+}
+}  // namespace kuka_drivers_core
@@ -0,0 +1,135 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Prints the cycles of a flight recorder file as CSV, optionally only the last ones
+
+#include <getopt.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "kuka_drivers_core/flight_recorder.hpp"
+
+using kuka_drivers_core::FlightRecorder;
+
+namespace
+{
+void PrintUsage(const char * program)
+{
+  printf(
+    "Usage: %s [options] <recorder file>\n"
+    "  --last <cycles>     print only the last cycles (default: all)\n"
+    "  --summary           print the number of cycles and of the flagged ones instead\n",
+    program);
+}
+
+void PrintHeader(std::size_t joints)
+{
+  printf("sequence,counter,receive_time_ns,send_time_ns,flags,mode");
+  for (std::size_t i = 0; i < joints; ++i) {
+    printf(",state_%zu", i);
+  }
+  for (std::size_t i = 0; i < joints; ++i) {
+    printf(",command_%zu", i);
+  }
+  printf("\n");
+}
+
+void PrintCycle(const FlightRecorder::Cycle & cycle, std::size_t joints)
+{
+  const auto & record = cycle.record;
+  printf(
+    "%" PRIu64 ",%" PRIu64 ",%" PRId64 ",%" PRId64 ",0x%08x,%u", cycle.sequence, record.counter,
+    record.receive_time_ns, record.send_time_ns, record.flags,
+    static_cast<unsigned int>(record.mode));
+  for (std::size_t i = 0; i < joints; ++i) {
+    printf(",%.9g", record.states[i]);
+  }
+  for (std::size_t i = 0; i < joints; ++i) {
+    printf(",%.9g", record.commands[i]);
+  }
+  printf("\n");
+}
+}  // namespace
+
+int main(int argc, char * argv[])
+{
+  static const struct option kOptions[] = {
+    {"last", required_argument, nullptr, 'l'},
+    {"summary", no_argument, nullptr, 's'},
+    {"help", no_argument, nullptr, 'h'},
+    {nullptr, 0, nullptr, 0}};
+
+  std::size_t last = 0;
+  bool summary = false;
+  int option;
+  while ((option = getopt_long(argc, argv, "h", kOptions, nullptr)) != -1) {
+    switch (option) {
+      case 'l': last = std::strtoul(optarg, nullptr, 10); break;
+      case 's': summary = true; break;
+      default:
+        PrintUsage(argv[0]);
+        return option == 'h' ? 0 : 1;
+    }
+  }
+  if (optind != argc - 1) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  std::vector<FlightRecorder::Cycle> cycles;
+  try {
+    cycles = FlightRecorder::ReadFile(argv[optind]);
+  } catch (const std::exception & ex) {
+    fprintf(stderr, "%s\n", ex.what());
+    return 1;
+  }
+  if (cycles.empty()) {
+    fprintf(stderr, "The recorder file is empty\n");
+    return 1;
+  }
+  if (last > 0 && last < cycles.size()) {
+    cycles.erase(cycles.begin(), cycles.end() - static_cast<std::ptrdiff_t>(last));
+  }
+
+  if (summary) {
+    std::size_t missed = 0;
+    std::size_t errors = 0;
+    for (const auto & cycle : cycles) {
+      missed += (cycle.record.flags & FlightRecorder::MISSED) != 0;
+      errors += (cycle.record.flags & FlightRecorder::ERROR) != 0;
+    }
+    const double duration_s = static_cast<double>(
+      cycles.back().record.receive_time_ns - cycles.front().record.receive_time_ns) * 1e-9;
+    printf(
+      "cycles: %zu (sequence %" PRIu64 " - %" PRIu64 "), %.3f s, missed: %zu, errors: %zu\n",
+      cycles.size(), cycles.front().sequence, cycles.back().sequence, duration_s, missed, errors);
+    return 0;
+  }
+
+  std::size_t joints = 0;
+  for (const auto & cycle : cycles) {
+    joints = std::max<std::size_t>(joints, cycle.record.joint_count);
+  }
+  PrintHeader(joints);
+  for (const auto & cycle : cycles) {
+    PrintCycle(cycle, joints);
+  }
+  return 0;
+}
@@ -0,0 +1,114 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "kuka_drivers_core/interface_storage.hpp"
+
+namespace kuka_drivers_core
+{
+namespace
+{
+constexpr std::size_t VALUES_PER_LINE = InterfaceStorage::CACHE_LINE_SIZE / sizeof(double);
+}  // namespace
+
+std::size_t InterfaceStorage::AddState(const std::string & interface, double initial_value)
+{
+  states_.push_back({interface, initial_value});
+  return states_.size() - 1;
+}
+
+std::size_t InterfaceStorage::AddCommand(const std::string & interface, double initial_value)
+{
+  commands_.push_back({interface, initial_value});
+  return commands_.size() - 1;
+}
+
+std::size_t InterfaceStorage::Stride() const
+{
+  return (components_.size() + VALUES_PER_LINE - 1) / VALUES_PER_LINE * VALUES_PER_LINE;
+}
+
+void InterfaceStorage::Allocate(const std::vector<std::string> & components)
+{
+  components_ = components;
+  const std::size_t stride = Stride();
+  const std::size_t size = (states_.size() + commands_.size()) * stride;
+  buffer_.assign(size + VALUES_PER_LINE, 0.0);
+
+  // The vector is only aligned to the double, the block starts at the next cache line in it
+  const auto address = reinterpret_cast<std::uintptr_t>(buffer_.data());
+  const std::size_t offset = (CACHE_LINE_SIZE - address % CACHE_LINE_SIZE) % CACHE_LINE_SIZE;
+  data_ = buffer_.data() + offset / sizeof(double);
+
+  for (std::size_t i = 0; i < states_.size(); ++i) {
+    const Values values = State(i);
+    std::fill(values.begin(), values.end(), states_[i].initial_value);
+  }
+  for (std::size_t i = 0; i < commands_.size(); ++i) {
+    const Values values = Command(i);
+    std::fill(values.begin(), values.end(), commands_[i].initial_value);
+  }
+}
+
+InterfaceStorage::Values InterfaceStorage::State(std::size_t field) const
+{
+  return Values(data_ + field * Stride(), components_.size());
+}
+
+InterfaceStorage::Values InterfaceStorage::Command(std::size_t field) const
+{
+  return Values(data_ + (states_.size() + field) * Stride(), components_.size());
+}
+
+InterfaceStorage::Values InterfaceStorage::States() const
+{
+  return Values(data_, states_.size() * Stride());
+}
+
+InterfaceStorage::Values InterfaceStorage::Commands() const
+{
+  return Values(data_ + states_.size() * Stride(), commands_.size() * Stride());
+}
+
+void InterfaceStorage::ExportStateInterfaces(
+  std::vector<hardware_interface::StateInterface> & interfaces, const ExportFilter & filter) const
+{
+  for (std::size_t component = 0; component < components_.size(); ++component) {
+    for (std::size_t field = 0; field < states_.size(); ++field) {
+      if (!filter || filter(component, states_[field].interface)) {
+        interfaces.emplace_back(
+          components_[component], states_[field].interface, &State(field)[component]);
+      }
+    }
+  }
+}
+
+void InterfaceStorage::ExportCommandInterfaces(
+  std::vector<hardware_interface::CommandInterface> & interfaces,
+  const ExportFilter & filter) const
+{
+  for (std::size_t component = 0; component < components_.size(); ++component) {
+    for (std::size_t field = 0; field < commands_.size(); ++field) {
+      if (!filter || filter(component, commands_[field].interface)) {
+        interfaces.emplace_back(
+          components_[component], commands_[field].interface, &Command(field)[component]);
+      }
+    }
+  }
+}
+}  // namespace kuka_drivers_core
@@ -0,0 +1,115 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include "rclcpp/rclcpp.hpp"
+
+#include "kuka_drivers_core/hardware_parameters.hpp"
+#include "kuka_drivers_core/io_thread.hpp"
+
+namespace kuka_drivers_core
+{
+bool IOThread::ParseOptions(
+  const std::unordered_map<std::string, std::string> & parameters, Options & options,
+  std::string & error)
+{
+  auto enabled = parameters.find("io_thread");
+  if (enabled != parameters.end()) {
+    if (enabled->second != "true" && enabled->second != "false") {
+      error = "io_thread must be 'true' or 'false'";
+      return false;
+    }
+    options.enabled = enabled->second == "true";
+  }
+  auto priority = parameters.find("io_thread_priority");
+  if (priority != parameters.end() &&
+    !HardwareParameters::Convert(priority->second, options.priority, 0, 99))
+  {
+    error = "io_thread_priority must be an integer between 0 and 99";
+    return false;
+  }
+  auto cpu = parameters.find("io_thread_cpu");
+  if (cpu != parameters.end() &&
+    !HardwareParameters::Convert(cpu->second, options.cpu, -1, CPU_SETSIZE - 1))
+  {
+    error = "io_thread_cpu must be -1 or the index of a CPU";
+    return false;
+  }
+  return true;
+}
+
+void IOThread::Start(std::function<bool()> cycle, const Options & options)
+{
+  Stop();
+  cycle_ = std::move(cycle);
+  stop_ = false;
+  running_ = true;
+  thread_ = std::thread(&IOThread::Run, this, options);
+}
+
+void IOThread::Stop()
+{
+  stop_ = true;
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  running_ = false;
+}
+
+bool IOThread::ConfigureCurrentThread(const Options & options, std::string & error)
+{
+  if (options.cpu >= 0) {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(options.cpu, &cpu_set);
+    const int result = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+    if (result != 0) {
+      error = std::string("Could not pin the I/O thread: ") + std::strerror(result);
+      return false;
+    }
+  }
+  if (options.priority > 0) {
+    struct sched_param param;
+    param.sched_priority = options.priority;
+    const int result = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (result != 0) {
+      error = std::string("Could not set the real-time priority of the I/O thread: ") +
+        std::strerror(result);
+      return false;
+    }
+  }
+  return true;
+}
+
+void IOThread::Run(const Options & options)
+{
+  // The thread is on the path of every message, a failure is not fatal but worth knowing
+  std::string error;
+  if (!ConfigureCurrentThread(options, error)) {
+    RCLCPP_WARN(rclcpp::get_logger("IOThread"), "%s", error.c_str());
+  }
+  while (!stop_.load(std::memory_order_relaxed)) {
+    if (!cycle_()) {
+      break;
+    }
+  }
+  running_.store(false, std::memory_order_release);
+}
+}  // namespace kuka_drivers_core
@@ -0,0 +1,144 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "kuka_drivers_core/hardware_parameters.hpp"
+#include "kuka_drivers_core/joint_state_publisher.hpp"
+
+namespace kuka_drivers_core
+{
+JointStatePublisher::JointStatePublisher(
+  const std::string & node_name, const std::string & topic,
+  const std::vector<std::string> & joint_names, std::size_t decimation)
+: joint_names_(
+    joint_names.begin(),
+    joint_names.begin() + static_cast<std::ptrdiff_t>(
+      joint_names.size() < MAX_JOINTS ? joint_names.size() : MAX_JOINTS)),
+  decimation_(std::max<std::size_t>(decimation, 1))
+{
+  node_ = rclcpp::Node::make_shared(node_name);
+  publisher_ = node_->create_publisher<sensor_msgs::msg::JointState>(
+    topic, rclcpp::SystemDefaultsQoS());
+
+  // The message is allocated once, publishing only overwrites the values
+  message_.name = joint_names_;
+  message_.position.resize(joint_names_.size());
+  publish_thread_ = std::thread(&JointStatePublisher::PublishLoop, this);
+}
+
+JointStatePublisher::~JointStatePublisher()
+{
+  terminate_ = true;
+  if (publish_thread_.joinable()) {
+    publish_thread_.join();
+  }
+}
+
+void JointStatePublisher::Update(
+  const double * positions, const double * velocities, const double * efforts)
+{
+  if (++cycle_ < decimation_) {
+    return;
+  }
+  cycle_ = 0;
+
+  Snapshot snapshot;
+  snapshot.stamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+  snapshot.has_velocities = velocities != nullptr;
+  snapshot.has_efforts = efforts != nullptr;
+  const std::size_t joints = joint_names_.size();
+  std::copy_n(positions, joints, snapshot.positions);
+  if (velocities != nullptr) {
+    std::copy_n(velocities, joints, snapshot.velocities);
+  }
+  if (efforts != nullptr) {
+    std::copy_n(efforts, joints, snapshot.efforts);
+  }
+  if (!queue_.Push(snapshot)) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void JointStatePublisher::Fill(
+  const Snapshot & snapshot, sensor_msgs::msg::JointState & message) const
+{
+  const std::size_t joints = joint_names_.size();
+  message.header.stamp = rclcpp::Time(snapshot.stamp_ns, RCL_SYSTEM_TIME);
+  if (message.name.size() != joints) {
+    message.name = joint_names_;
+  }
+  message.position.assign(snapshot.positions, snapshot.positions + joints);
+  if (snapshot.has_velocities) {
+    message.velocity.assign(snapshot.velocities, snapshot.velocities + joints);
+  } else {
+    message.velocity.clear();
+  }
+  if (snapshot.has_efforts) {
+    message.effort.assign(snapshot.efforts, snapshot.efforts + joints);
+  } else {
+    message.effort.clear();
+  }
+}
+
+void JointStatePublisher::PublishLoop()
+{
+  Snapshot snapshot;
+  while (!terminate_) {
+    // Only the latest snapshot is published if several arrived since the last check
+    bool received = false;
+    while (queue_.Pop(snapshot)) {
+      received = true;
+    }
+    if (!received) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      continue;
+    }
+
+    if (publisher_->can_loan_messages()) {
+      auto loaned = publisher_->borrow_loaned_message();
+      Fill(snapshot, loaned.get());
+      publisher_->publish(std::move(loaned));
+    } else {
+      Fill(snapshot, message_);
+      publisher_->publish(message_);
+    }
+  }
+}
+
+bool ConfigureJointStatePublisher(
+  const std::unordered_map<std::string, std::string> & parameters,
+  const std::string & hardware_name, const std::vector<std::string> & joint_names,
+  std::unique_ptr<JointStatePublisher> & publisher, std::string & error)
+{
+  HardwareParameters checked(parameters);
+  std::size_t decimation = 0;
+  if (!checked.Get("joint_state_decimation", decimation)) {
+    error = checked.Error();
+    return false;
+  }
+  if (decimation > 0) {
+    publisher = std::make_unique<JointStatePublisher>(
+      hardware_name + "_joint_state_publisher", checked.String("joint_state_topic", "joint_states"),
+      joint_names, decimation);
+  }
+  return true;
+}
+}  // namespace kuka_drivers_core
@@ -0,0 +1,115 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Configures and activates the lifecycle nodes given in the parameters concurrently,
+//  respecting the dependencies between them, and exits with the result
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "lifecycle_msgs/msg/transition.hpp"
+#include "rclcpp/rclcpp.hpp"
+
+#include "communication_helpers/lifecycle_tools.hpp"
+
+namespace
+{
+// Parses "node:dependency1,dependency2" into the node and its dependencies
+bool parseDependencies(
+  const std::string & entry, std::string & node, std::vector<std::string> & dependencies)
+{
+  const auto separator = entry.find(':');
+  if (separator == std::string::npos || separator == 0) {
+    return false;
+  }
+  node = entry.substr(0, separator);
+  std::size_t start = separator + 1;
+  while (start < entry.size()) {
+    std::size_t end = entry.find(',', start);
+    if (end == std::string::npos) {
+      end = entry.size();
+    }
+    if (end > start) {
+      dependencies.push_back(entry.substr(start, end - start));
+    }
+    start = end + 1;
+  }
+  return true;
+}
+}  // namespace
+
+int main(int argc, char ** argv)
+{
+  rclcpp::init(argc, argv);
+  auto node = std::make_shared<rclcpp::Node>("lifecycle_bringup");
+  const auto nodes = node->declare_parameter<std::vector<std::string>>(
+    "nodes", std::vector<std::string>{});
+  const auto dependency_entries = node->declare_parameter<std::vector<std::string>>(
+    "dependencies", std::vector<std::string>{});
+  const bool activate = node->declare_parameter<bool>("activate", true);
+  const int timeout_ms = static_cast<int>(node->declare_parameter<int64_t>("timeout_ms", 30000));
+
+  std::vector<std::vector<std::string>> node_dependencies(nodes.size());
+  for (const auto & entry : dependency_entries) {
+    std::string name;
+    std::vector<std::string> dependencies;
+    if (!parseDependencies(entry, name, dependencies)) {
+      RCLCPP_ERROR(node->get_logger(), "Invalid dependency entry '%s'", entry.c_str());
+      rclcpp::shutdown();
+      return 1;
+    }
+    bool found = false;
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+      if (nodes[i] == name) {
+        node_dependencies[i].insert(
+          node_dependencies[i].end(), dependencies.begin(), dependencies.end());
+        found = true;
+      }
+    }
+    if (!found) {
+      RCLCPP_ERROR(node->get_logger(), "Dependencies given for unknown node %s", name.c_str());
+      rclcpp::shutdown();
+      return 1;
+    }
+  }
+
+  kuka_drivers_core::LifecycleBringUp bring_up(node);
+  for (std::size_t i = 0; i < nodes.size(); ++i) {
+    bring_up.addNode(nodes[i], node_dependencies[i]);
+  }
+
+  // The responses are processed by the executor while the main thread waits for them
+  rclcpp::executors::MultiThreadedExecutor executor;
+  executor.add_node(node);
+  std::thread spinner([&executor]() {executor.spin();});
+
+  std::vector<uint8_t> transitions = {lifecycle_msgs::msg::Transition::TRANSITION_CONFIGURE};
+  if (activate) {
+    transitions.push_back(lifecycle_msgs::msg::Transition::TRANSITION_ACTIVATE);
+  }
+  const auto start = std::chrono::steady_clock::now();
+  const bool success = bring_up.execute(transitions, timeout_ms);
+  RCLCPP_INFO(
+    node->get_logger(), "Bring-up of %zu nodes %s in %.1f ms", nodes.size(),
+    success ? "succeeded" : "failed", std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - start).count());
+
+  executor.cancel();
+  spinner.join();
+  rclcpp::shutdown();
+  return success ? 0 : 1;
+}
@@ -0,0 +1,267 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "kuka_drivers_core/hardware_parameters.hpp"
+#include "kuka_drivers_core/link_diagnostics.hpp"
+
+namespace kuka_drivers_core
+{
+constexpr std::size_t LinkDiagnostics::MAX_METRICS;
+constexpr std::chrono::milliseconds LinkDiagnostics::BATCH_PERIOD;
+
+LinkDiagnostics::LinkDiagnostics(
+  const std::string & hardware_name, const std::vector<Metric> & metrics,
+  std::chrono::milliseconds window, std::chrono::milliseconds publish_period)
+: hardware_name_(hardware_name),
+  metrics_(
+    metrics.begin(),
+    metrics.begin() + static_cast<std::ptrdiff_t>(std::min(metrics.size(), MAX_METRICS))),
+  window_(std::max(window, BATCH_PERIOD)), publish_period_(publish_period)
+{
+  node_ = rclcpp::Node::make_shared(hardware_name_ + "_link_diagnostics");
+  publisher_ = node_->create_publisher<diagnostic_msgs::msg::DiagnosticArray>(
+    "/diagnostics", rclcpp::SystemDefaultsQoS());
+  publish_thread_ = std::thread(&LinkDiagnostics::PublishLoop, this);
+}
+
+LinkDiagnostics::~LinkDiagnostics()
+{
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    terminate_ = true;
+  }
+  cv_.notify_all();
+  if (publish_thread_.joinable()) {
+    publish_thread_.join();
+  }
+}
+
+int64_t LinkDiagnostics::Now()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void LinkDiagnostics::Update(const double * values)
+{
+  const int64_t now = Now();
+  const std::size_t metrics = metrics_.size();
+  if (current_.samples == 0) {
+    current_.start_ns = now;
+    std::copy_n(values, metrics, current_.min);
+    std::copy_n(values, metrics, current_.max);
+    std::fill_n(current_.sum, metrics, 0.0);
+  }
+  for (std::size_t i = 0; i < metrics; ++i) {
+    if (metrics_[i].kind == Kind::COUNTER) {
+      current_.sum[i] += has_previous_ ? std::max(values[i] - previous_[i], 0.0) : 0.0;
+    } else {
+      current_.sum[i] += values[i];
+    }
+    current_.min[i] = std::min(current_.min[i], values[i]);
+    current_.max[i] = std::max(current_.max[i], values[i]);
+  }
+  std::copy_n(values, metrics, previous_);
+  has_previous_ = true;
+  ++current_.samples;
+
+  if (now - current_.start_ns <
+    std::chrono::duration_cast<std::chrono::nanoseconds>(BATCH_PERIOD).count())
+  {
+    return;
+  }
+  current_.end_ns = now;
+  if (!queue_.Push(current_)) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+  }
+  current_.samples = 0;
+}
+
+diagnostic_msgs::msg::DiagnosticStatus LinkDiagnostics::Evaluate() const
+{
+  using diagnostic_msgs::msg::DiagnosticStatus;
+  auto to_string = [](double value) {
+      char buffer[32];
+      std::snprintf(buffer, sizeof(buffer), "%.4g", value);
+      return std::string(buffer);
+    };
+  auto add_value = [](DiagnosticStatus & status, const std::string & key, std::string value) {
+      diagnostic_msgs::msg::KeyValue key_value;
+      key_value.key = key;
+      key_value.value = std::move(value);
+      status.values.push_back(std::move(key_value));
+    };
+
+  DiagnosticStatus status;
+  status.name = hardware_name_ + ": link quality";
+  status.hardware_id = hardware_name_;
+  status.level = DiagnosticStatus::OK;
+  if (batches_.empty()) {
+    status.level = DiagnosticStatus::STALE;
+    status.message = "No samples in the last window";
+    return status;
+  }
+
+  const Batch & oldest = batches_.front();
+  const Batch & newest = batches_.back();
+  const double span_s = static_cast<double>(newest.end_ns - oldest.start_ns) * 1e-9;
+  const double window_s = std::chrono::duration<double>(window_).count();
+  uint64_t samples = 0;
+  for (const auto & batch : batches_) {
+    samples += batch.samples;
+  }
+  add_value(status, "samples", std::to_string(samples));
+  add_value(status, "window [s]", to_string(span_s));
+
+  std::string message;
+  auto raise = [&](uint8_t level, const std::string & reason) {
+      if (level > status.level) {
+        status.level = level;
+        message = reason;
+      } else if (level == status.level && level != DiagnosticStatus::OK) {
+        message += ", " + reason;
+      }
+    };
+
+  for (std::size_t i = 0; i < metrics_.size(); ++i) {
+    const Metric & metric = metrics_[i];
+    auto worse = [&metric](double value, double threshold) {
+        return metric.lower_is_worse ? value < threshold : value > threshold;
+      };
+
+    if (metric.kind == Kind::COUNTER) {
+      double increase = 0.0;
+      for (const auto & batch : batches_) {
+        increase += batch.sum[i];
+      }
+      const double rate = span_s > 0.0 ? increase / span_s : 0.0;
+      add_value(status, metric.name + " in window", to_string(increase));
+      add_value(status, metric.name + " rate [1/s]", to_string(rate));
+      if (rate > metric.error_threshold) {
+        raise(DiagnosticStatus::ERROR, metric.name + " rate above error threshold");
+      } else if (rate > metric.warning_threshold) {
+        raise(DiagnosticStatus::WARN, metric.name + " rate above warning threshold");
+      }
+      continue;
+    }
+
+    // Least-squares line through the batch means, the slope is the trend per second
+    double sum = 0.0;
+    double min = std::numeric_limits<double>::max();
+    double max = std::numeric_limits<double>::lowest();
+    double sum_t = 0.0;
+    double sum_y = 0.0;
+    double sum_tt = 0.0;
+    double sum_ty = 0.0;
+    for (const auto & batch : batches_) {
+      const double t = static_cast<double>(batch.end_ns - oldest.start_ns) * 1e-9;
+      const double y = batch.sum[i] / batch.samples;
+      sum += batch.sum[i];
+      min = std::min(min, batch.min[i]);
+      max = std::max(max, batch.max[i]);
+      sum_t += t;
+      sum_y += y;
+      sum_tt += t * t;
+      sum_ty += t * y;
+    }
+    const double n = static_cast<double>(batches_.size());
+    const double denominator = n * sum_tt - sum_t * sum_t;
+    const double slope = batches_.size() > 1 && denominator > 0.0 ?
+      (n * sum_ty - sum_t * sum_y) / denominator : 0.0;
+    const double current = newest.sum[i] / newest.samples;
+    const double predicted = current + slope * window_s;
+
+    add_value(status, metric.name + " current", to_string(current));
+    add_value(status, metric.name + " mean", to_string(sum / samples));
+    add_value(status, metric.name + " min", to_string(min));
+    add_value(status, metric.name + " max", to_string(max));
+    add_value(status, metric.name + " trend [1/s]", to_string(slope));
+
+    if (worse(current, metric.error_threshold)) {
+      raise(DiagnosticStatus::ERROR, metric.name + " beyond error threshold");
+    } else if (worse(current, metric.warning_threshold)) {
+      raise(DiagnosticStatus::WARN, metric.name + " beyond warning threshold");
+    } else if (worse(predicted, metric.error_threshold)) {
+      raise(DiagnosticStatus::WARN, metric.name + " degrading towards error threshold");
+    }
+  }
+  status.message = status.level == DiagnosticStatus::OK ? "OK" : message;
+  return status;
+}
+
+void LinkDiagnostics::PublishLoop()
+{
+  std::unique_lock<std::mutex> lk(mutex_);
+  while (!cv_.wait_for(lk, publish_period_, [this] {return terminate_;})) {
+    Batch batch;
+    while (queue_.Pop(batch)) {
+      batches_.push_back(batch);
+    }
+    const int64_t window_start =
+      Now() - std::chrono::duration_cast<std::chrono::nanoseconds>(window_).count();
+    while (!batches_.empty() && batches_.front().end_ns < window_start) {
+      batches_.pop_front();
+    }
+
+    diagnostic_msgs::msg::DiagnosticArray msg;
+    msg.header.stamp = node_->now();
+    msg.status.push_back(Evaluate());
+    publisher_->publish(msg);
+  }
+}
+
+bool ConfigureLinkDiagnostics(
+  const std::unordered_map<std::string, std::string> & parameters,
+  const std::string & hardware_name, const std::vector<LinkDiagnostics::Metric> & metrics,
+  std::unique_ptr<LinkDiagnostics> & diagnostics, std::string & error)
+{
+  auto period_param = parameters.find("link_diagnostics_period_ms");
+  if (period_param == parameters.end() || period_param->second.empty()) {
+    return true;
+  }
+  auto window_param = parameters.find("link_diagnostics_window_s");
+  int period_ms = 0;
+  double window_s = 10.0;
+  if (!HardwareParameters::Convert(period_param->second, period_ms)) {
+    error = "link_diagnostics_period_ms must be an integer";
+    return false;
+  }
+  // At most a day, so that the window in ms stays far from the limits of int64_t
+  if (window_param != parameters.end() && !window_param->second.empty() &&
+    !HardwareParameters::Convert(window_param->second, window_s, 0.0, 86400.0))
+  {
+    error = "link_diagnostics_window_s must be a number of at most 86400";
+    return false;
+  }
+  if (period_ms <= 0) {
+    return true;
+  }
+  if (window_s <= 0.0) {
+    error = "link_diagnostics_window_s must be positive";
+    return false;
+  }
+  diagnostics = std::make_unique<LinkDiagnostics>(
+    hardware_name, metrics,
+    std::chrono::milliseconds(static_cast<int64_t>(window_s * 1000.0)),
+    std::chrono::milliseconds(period_ms));
+  return true;
+}
+}  // namespace kuka_drivers_core
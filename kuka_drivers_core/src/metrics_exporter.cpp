@@ -0,0 +1,349 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "kuka_drivers_core/hardware_parameters.hpp"
+#include "kuka_drivers_core/metrics_exporter.hpp"
+
+namespace kuka_drivers_core
+{
+namespace
+{
+std::string EscapeLabel(const std::string & value)
+{
+  std::string escaped;
+  for (char c : value) {
+    if (c == '\\' || c == '"') {
+      escaped += '\\';
+      escaped += c;
+    } else if (c == '\n') {
+      escaped += "\\n";
+    } else {
+      escaped += c;
+    }
+  }
+  return escaped;
+}
+
+std::string FormatDouble(double value)
+{
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+  return buffer;
+}
+
+void SendAll(int socket, const std::string & data)
+{
+  std::size_t sent = 0;
+  while (sent < data.size()) {
+    const ssize_t result = ::send(socket, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+    if (result <= 0) {
+      return;
+    }
+    sent += static_cast<std::size_t>(result);
+  }
+}
+}  // namespace
+
+const std::array<uint64_t, MetricsExporter::Histogram::BUCKETS> &
+MetricsExporter::Histogram::Bounds()
+{
+  static const std::array<uint64_t, BUCKETS> bounds = {
+    50000, 100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000, 25000000, 50000000,
+    100000000, 250000000, 1000000000, 2500000000, 10000000000};
+  return bounds;
+}
+
+void MetricsExporter::Histogram::Record(uint64_t duration_ns)
+{
+  const auto & bounds = Bounds();
+  std::size_t bucket = 0;
+  while (bucket < BUCKETS && duration_ns > bounds[bucket]) {
+    ++bucket;
+  }
+  buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+  sum_ns_.fetch_add(duration_ns, std::memory_order_relaxed);
+}
+
+MetricsExporter::Group::Group(const std::string & component)
+: component_(component)
+{
+  auto & exporter = MetricsExporter::Instance();
+  std::lock_guard<std::mutex> lk(exporter.mutex_);
+  exporter.groups_.push_back(this);
+}
+
+MetricsExporter::Group::~Group()
+{
+  auto & exporter = MetricsExporter::Instance();
+  std::lock_guard<std::mutex> lk(exporter.mutex_);
+  for (auto it = exporter.groups_.begin(); it != exporter.groups_.end(); ++it) {
+    if (*it == this) {
+      exporter.groups_.erase(it);
+      break;
+    }
+  }
+}
+
+MetricsExporter::Counter & MetricsExporter::Group::AddCounter(
+  const std::string & name, const std::string & help)
+{
+  auto & exporter = MetricsExporter::Instance();
+  std::lock_guard<std::mutex> lk(exporter.mutex_);
+  counters_.emplace_back();
+  entries_.push_back({name, help, Type::COUNTER, &counters_.back(), nullptr, nullptr, nullptr});
+  return counters_.back();
+}
+
+MetricsExporter::Gauge & MetricsExporter::Group::AddGauge(
+  const std::string & name, const std::string & help)
+{
+  auto & exporter = MetricsExporter::Instance();
+  std::lock_guard<std::mutex> lk(exporter.mutex_);
+  gauges_.emplace_back();
+  entries_.push_back({name, help, Type::GAUGE, nullptr, &gauges_.back(), nullptr, nullptr});
+  return gauges_.back();
+}
+
+MetricsExporter::Histogram & MetricsExporter::Group::AddHistogram(
+  const std::string & name, const std::string & help)
+{
+  auto & exporter = MetricsExporter::Instance();
+  std::lock_guard<std::mutex> lk(exporter.mutex_);
+  histograms_.emplace_back();
+  entries_.push_back(
+    {name, help, Type::HISTOGRAM, nullptr, nullptr, &histograms_.back(), nullptr});
+  return histograms_.back();
+}
+
+void MetricsExporter::Group::AddCounter(
+  const std::string & name, const std::string & help, std::function<uint64_t()> read)
+{
+  auto & exporter = MetricsExporter::Instance();
+  std::lock_guard<std::mutex> lk(exporter.mutex_);
+  entries_.push_back({name, help, Type::COUNTER, nullptr, nullptr, nullptr, std::move(read)});
+}
+
+MetricsExporter & MetricsExporter::Instance()
+{
+  static MetricsExporter instance;
+  return instance;
+}
+
+MetricsExporter::~MetricsExporter()
+{
+  terminate_ = true;
+  if (serve_thread_.joinable()) {
+    serve_thread_.join();
+  }
+  if (socket_ >= 0) {
+    ::close(socket_);
+  }
+}
+
+bool MetricsExporter::Start(const std::string & address, uint16_t port, std::string & error)
+{
+  std::lock_guard<std::mutex> lk(mutex_);
+  if (socket_ >= 0) {
+    if (port != port_) {
+      error = "Metrics are already served on port " + std::to_string(port_) + ", not on " +
+        std::to_string(port);
+      return false;
+    }
+    return true;
+  }
+
+  sockaddr_in socket_address{};
+  socket_address.sin_family = AF_INET;
+  socket_address.sin_port = htons(port);
+  if (inet_pton(AF_INET, address.c_str(), &socket_address.sin_addr) != 1) {
+    error = "Invalid metrics address " + address;
+    return false;
+  }
+  const int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    error = std::string("Could not create the metrics socket: ") + std::strerror(errno);
+    return false;
+  }
+  const int reuse = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  if (::bind(fd, reinterpret_cast<sockaddr *>(&socket_address), sizeof(socket_address)) < 0 ||
+    ::listen(fd, 8) < 0)
+  {
+    error = "Could not listen on " + address + ":" + std::to_string(port) + " for metrics: " +
+      std::strerror(errno);
+    ::close(fd);
+    return false;
+  }
+  socket_ = fd;
+  port_ = port;
+  serve_thread_ = std::thread(&MetricsExporter::ServeLoop, this);
+  return true;
+}
+
+bool MetricsExporter::Serving() const
+{
+  std::lock_guard<std::mutex> lk(mutex_);
+  return socket_ >= 0;
+}
+
+std::string MetricsExporter::Render() const
+{
+  struct Family
+  {
+    std::string help;
+    Group::Type type;
+    std::string samples;
+  };
+  // The samples of a metric of all groups follow its HELP and TYPE lines
+  std::map<std::string, Family> families;
+
+  std::lock_guard<std::mutex> lk(mutex_);
+  for (const Group * group : groups_) {
+    const std::string label = "component=\"" + EscapeLabel(group->component_) + "\"";
+    for (const auto & entry : group->entries_) {
+      const std::string name = "kuka_" + entry.name;
+      auto & family = families[name];
+      family.help = entry.help;
+      family.type = entry.type;
+      switch (entry.type) {
+        case Group::Type::COUNTER:
+          family.samples += name + "{" + label + "} " +
+            std::to_string(entry.read ? entry.read() : entry.counter->Value()) + "\n";
+          break;
+        case Group::Type::GAUGE:
+          family.samples += name + "{" + label + "} " + FormatDouble(entry.gauge->Value()) + "\n";
+          break;
+        case Group::Type::HISTOGRAM:
+          {
+            const Histogram & histogram = *entry.histogram;
+            const auto & bounds = Histogram::Bounds();
+            uint64_t cumulative = 0;
+            for (std::size_t i = 0; i <= Histogram::BUCKETS; ++i) {
+              cumulative += histogram.buckets_[i].load(std::memory_order_relaxed);
+              const std::string bound =
+                i < Histogram::BUCKETS ? FormatDouble(static_cast<double>(bounds[i]) * 1e-9) :
+                "+Inf";
+              family.samples += name + "_bucket{" + label + ",le=\"" + bound + "\"} " +
+                std::to_string(cumulative) + "\n";
+            }
+            // Read after the buckets, a sample recorded in between is only counted there
+            family.samples += name + "_sum{" + label + "} " + FormatDouble(
+              static_cast<double>(histogram.sum_ns_.load(std::memory_order_relaxed)) * 1e-9) +
+              "\n";
+            family.samples += name + "_count{" + label + "} " + std::to_string(cumulative) + "\n";
+          }
+          break;
+      }
+    }
+  }
+
+  std::string text;
+  for (const auto & family : families) {
+    static const char * const TYPES[] = {"counter", "gauge", "histogram"};
+    text += "# HELP " + family.first + " " + family.second.help + "\n";
+    text += "# TYPE " + family.first + " " + TYPES[static_cast<int>(family.second.type)] + "\n";
+    text += family.second.samples;
+  }
+  return text;
+}
+
+void MetricsExporter::ServeLoop()
+{
+  while (!terminate_) {
+    pollfd listening{socket_, POLLIN, 0};
+    if (::poll(&listening, 1, 200) <= 0) {
+      continue;
+    }
+    const int client = ::accept4(socket_, nullptr, nullptr, SOCK_CLOEXEC);
+    if (client < 0) {
+      continue;
+    }
+    // A scraper sends its request at once, a slow client cannot block the others for long
+    timeval timeout{1, 0};
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+      const ssize_t received = ::recv(client, buffer, sizeof(buffer), 0);
+      if (received <= 0) {
+        break;
+      }
+      request.append(buffer, static_cast<std::size_t>(received));
+    }
+    if (request.compare(0, 13, "GET /metrics ") == 0 ||
+      request.compare(0, 13, "GET /metrics?") == 0)
+    {
+      const std::string body = Render();
+      SendAll(
+        client, "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+        "Content-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" +
+        body);
+    } else {
+      SendAll(
+        client,
+        "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+    }
+    ::close(client);
+  }
+}
+
+bool ConfigureMetrics(
+  const std::unordered_map<std::string, std::string> & parameters,
+  const std::string & component, std::unique_ptr<MetricsExporter::Group> & group,
+  std::string & error)
+{
+  auto port_param = parameters.find("metrics_port");
+  if (port_param == parameters.end() || port_param->second.empty()) {
+    return true;
+  }
+  int port = 0;
+  if (!HardwareParameters::Convert(port_param->second, port)) {
+    error = "metrics_port must be an integer";
+    return false;
+  }
+  if (port <= 0) {
+    return true;
+  }
+  if (port > 65535) {
+    error = "metrics_port must be below 65536";
+    return false;
+  }
+  auto address_param = parameters.find("metrics_address");
+  const std::string address = address_param != parameters.end() &&
+    !address_param->second.empty() ? address_param->second : "0.0.0.0";
+  if (!MetricsExporter::Instance().Start(address, static_cast<uint16_t>(port), error)) {
+    return false;
+  }
+  group = std::make_unique<MetricsExporter::Group>(component);
+  return true;
+}
+}  // namespace kuka_drivers_core
@@ -0,0 +1,59 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "kuka_drivers_core/node_executor.hpp"
+
+namespace kuka_drivers_core
+{
+NodeExecutor::NodeExecutor(std::shared_ptr<ROS2BaseLCNode> node)
+: node_(std::move(node))
+{
+}
+
+void NodeExecutor::Spin()
+{
+  const std::string mode = node_->get_parameter("executor").as_string();
+  std::vector<std::shared_ptr<rclcpp::executors::SingleThreadedExecutor>> dedicated_executors;
+  std::vector<std::thread> dedicated_threads;
+  if (mode == "dedicated_threads") {
+    // The groups must be taken before the node is added to the shared executor
+    for (const auto & group : node_->getDedicatedCallbackGroups()) {
+      auto executor = std::make_shared<rclcpp::executors::SingleThreadedExecutor>();
+      executor->add_callback_group(group, node_->get_node_base_interface());
+      dedicated_executors.push_back(executor);
+      dedicated_threads.emplace_back([executor]() {executor->spin();});
+    }
+    RCLCPP_INFO(
+      node_->get_logger(), "Dispatching %zu callback groups on dedicated threads",
+      dedicated_executors.size());
+  }
+
+  rclcpp::executors::MultiThreadedExecutor executor;
+  executor.add_node(node_->get_node_base_interface());
+  executor.spin();
+
+  for (const auto & dedicated_executor : dedicated_executors) {
+    dedicated_executor->cancel();
+  }
+  for (auto & thread : dedicated_threads) {
+    thread.join();
+  }
+}
+}  // namespace kuka_drivers_core
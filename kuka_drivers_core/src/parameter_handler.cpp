@@ -15,6 +15,7 @@
 #include "kuka_drivers_core/parameter_handler.hpp"
 
 #include <string>
+#include <utility>
 #include <vector>
 #include <memory>
 
@@ -30,23 +31,100 @@ rcl_interfaces::msg::SetParametersResult ParameterHandler::onParamChange(
 {
   rcl_interfaces::msg::SetParametersResult result;
   result.successful = false;
+
+  // The whole batch is validated before any callback is called, the current values are kept
+  //  for rolling back the callbacks if the batch fails
+  std::vector<const ParameterBase *> found_params;
+  std::vector<rclcpp::Parameter> previous_values;
+  found_params.reserve(parameters.size());
+  previous_values.reserve(parameters.size());
   for (const rclcpp::Parameter & param : parameters) {
-    auto found_param_it = std::find_if(
-      params_.begin(), params_.end(),
-      [&param](auto param_ptr) {
-        return param_ptr->getName() == param.get_name();
-      });
+    auto found_param_it = params_.find(param.get_name());
     // When used properly, we should not reach this
     // but better to keep additional check to filter improper use
     if (found_param_it == params_.end()) {
       printf("Invalid parameter name\n");
-    } else if (canSetParameter(*(*found_param_it))) {
-      result.successful = (*found_param_it)->callCallback(param);
+      result.reason = "Invalid parameter name " + param.get_name();
+      return result;
+    }
+    if (!found_param_it->second->hasType(param)) {
+      printf("Invalid type for parameter %s\n", param.get_name().c_str());
+      result.reason = "Invalid type for parameter " + param.get_name();
+      return result;
+    }
+    if (!canSetParameter(*found_param_it->second)) {
+      result.reason = "Parameter " + param.get_name() + " cannot be changed in this state";
+      return result;
+    }
+    // The parameter server still holds the values from before the batch
+    rclcpp::Parameter previous;
+    if (!found_param_it->second->getParameterInterface()->get_parameter(
+        param.get_name(), previous))
+    {
+      previous = rclcpp::Parameter(param.get_name(), found_param_it->second->getDefaultValue());
+    }
+    found_params.push_back(found_param_it->second.get());
+    previous_values.push_back(previous);
+  }
+
+  for (const auto & hooks : batch_hooks_) {
+    hooks.first();
+  }
+  bool successful = true;
+  std::size_t applied = 0;
+  for (; applied < parameters.size(); ++applied) {
+    if (!found_params[applied]->callCallback(parameters[applied])) {
+      successful = false;
+      result.reason = "Setting parameter " + parameters[applied].get_name() + " failed";
+      break;
+    }
+  }
+  if (!successful) {
+    // Undone before the hooks drop the collected effects, so that nothing of the batch remains
+    rollBack(found_params, previous_values, applied, result);
+    for (const auto & hooks : batch_hooks_) {
+      hooks.second(false);
+    }
+    return result;
+  }
+
+  for (const auto & hooks : batch_hooks_) {
+    if (!hooks.second(true) && successful) {
+      successful = false;
+      result.reason = "Applying the parameters failed";
+    }
+  }
+  if (!successful) {
+    // The hooks apply the previous values again, as parts of the batch may have taken effect
+    for (const auto & hooks : batch_hooks_) {
+      hooks.first();
+    }
+    rollBack(found_params, previous_values, applied, result);
+    for (const auto & hooks : batch_hooks_) {
+      if (!hooks.second(true)) {
+        result.reason += ", restoring the previous values failed";
+        break;
+      }
     }
   }
+  result.successful = successful;
   return result;
 }
 
+void ParameterHandler::rollBack(
+  const std::vector<const ParameterBase *> & params,
+  const std::vector<rclcpp::Parameter> & previous_values, std::size_t applied,
+  rcl_interfaces::msg::SetParametersResult & result) const
+{
+  // In reverse order, as later callbacks may depend on the values set by earlier ones
+  for (std::size_t i = applied; i-- > 0; ) {
+    if (!params[i]->callCallback(previous_values[i])) {
+      printf("Restoring parameter %s failed\n", previous_values[i].get_name().c_str());
+      result.reason += ", restoring " + previous_values[i].get_name() + " failed";
+    }
+  }
+}
+
 bool ParameterHandler::canSetParameter(const ParameterBase & param) const
 {
   if (node_ == nullptr) {
@@ -75,7 +153,7 @@ void ParameterHandler::registerParameter(
   std::shared_ptr<ParameterBase> param_shared_ptr,
   bool block)
 {
-  params_.emplace_back(param_shared_ptr);
+  params_.emplace(param_shared_ptr->getName(), param_shared_ptr);
   param_shared_ptr->getParameterInterface()->declare_parameter(
     param_shared_ptr->getName(), param_shared_ptr->getDefaultValue());
   if (block) {
@@ -83,4 +161,10 @@ void ParameterHandler::registerParameter(
   }
 }
 
+void ParameterHandler::registerBatchHooks(
+  std::function<void()> begin, std::function<bool(bool)> end)
+{
+  batch_hooks_.emplace_back(std::move(begin), std::move(end));
+}
+
 }  // namespace kuka_drivers_core
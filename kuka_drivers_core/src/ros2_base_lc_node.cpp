@@ -12,10 +12,12 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <memory>
 
+#include "kuka_drivers_core/metrics_exporter.hpp"
 #include "kuka_drivers_core/ros2_base_lc_node.hpp"
 #include "rclcpp_lifecycle/lifecycle_node.hpp"
 
@@ -30,6 +32,30 @@ ROS2BaseLCNode::ROS2BaseLCNode(const std::string & node_name, const rclcpp::Node
     [this](const std::vector<rclcpp::Parameter> & parameters) {
       return param_handler_.onParamChange(parameters);
     });
+  // Read by NodeExecutor before spinning, so it can only be given at startup
+  registerStaticParameter<std::string>(
+    "executor", "multi_threaded", ParameterSetAccessRights {true, false, false, false, false},
+    [](const std::string & executor) {
+      return executor == "multi_threaded" || executor == "dedicated_threads";
+    });
+  // Optional export of the mode switch durations for Prometheus, started before the
+  //  SwitchTrace of the robot manager is created
+  registerStaticParameter<std::string>(
+    "metrics_address", "0.0.0.0", ParameterSetAccessRights {true, false, false, false, false},
+    [](const std::string &) {return true;});
+  registerStaticParameter<int>(
+    "metrics_port", 0, ParameterSetAccessRights {true, false, false, false, false},
+    [](int port) {return port >= 0 && port <= 65535;});
+  const int64_t metrics_port = this->get_parameter("metrics_port").as_int();
+  if (metrics_port > 0) {
+    std::string metrics_error;
+    if (!MetricsExporter::Instance().Start(
+        this->get_parameter("metrics_address").as_string(),
+        static_cast<uint16_t>(metrics_port), metrics_error))
+    {
+      RCLCPP_ERROR(get_logger(), "Metrics are not exported: %s", metrics_error.c_str());
+    }
+  }
 }
 
 rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn
@@ -91,6 +117,19 @@ const ParameterHandler & ROS2BaseLCNode::getParameterHandler() const
   return param_handler_;
 }
 
+rclcpp::CallbackGroup::SharedPtr ROS2BaseLCNode::createDedicatedCallbackGroup()
+{
+  dedicated_callback_groups_.push_back(
+    this->create_callback_group(rclcpp::CallbackGroupType::MutuallyExclusive));
+  return dedicated_callback_groups_.back();
+}
+
+const std::vector<rclcpp::CallbackGroup::SharedPtr> &
+ROS2BaseLCNode::getDedicatedCallbackGroups() const
+{
+  return dedicated_callback_groups_;
+}
+
 rclcpp::node_interfaces::OnSetParametersCallbackHandle::SharedPtr ROS2BaseLCNode::ParamCallback()
 const
 {
@@ -0,0 +1,124 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+#include "diagnostic_msgs/msg/key_value.hpp"
+
+#include "kuka_drivers_core/startup_profile.hpp"
+
+namespace kuka_drivers_core
+{
+namespace
+{
+std::string Milliseconds(std::chrono::nanoseconds duration)
+{
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "%.1f", static_cast<double>(duration.count()) / 1e6);
+  return buffer;
+}
+}  // namespace
+
+void StartupProfile::SetComponent(const std::string & component)
+{
+  std::lock_guard<std::mutex> lk(mutex_);
+  component_ = component;
+}
+
+void StartupProfile::Reset()
+{
+  std::lock_guard<std::mutex> lk(mutex_);
+  phases_.clear();
+  started_ = false;
+}
+
+void StartupProfile::Add(const std::string & phase, Clock::time_point begin, Clock::time_point end)
+{
+  std::lock_guard<std::mutex> lk(mutex_);
+  // An enclosing phase is added after its nested ones, but it started before them
+  if (!started_ || begin < start_) {
+    start_ = begin;
+    started_ = true;
+  }
+  // Listed in the order they started
+  auto position = phases_.end();
+  while (position != phases_.begin() && (position - 1)->begin > begin) {
+    --position;
+  }
+  phases_.insert(position, {phase, begin, end});
+}
+
+std::chrono::nanoseconds StartupProfile::Total() const
+{
+  std::lock_guard<std::mutex> lk(mutex_);
+  return TotalLocked();
+}
+
+std::chrono::nanoseconds StartupProfile::TotalLocked() const
+{
+  Clock::time_point end = start_;
+  for (const auto & phase : phases_) {
+    end = std::max(end, phase.end);
+  }
+  return end - start_;
+}
+
+std::string StartupProfile::Summary() const
+{
+  std::lock_guard<std::mutex> lk(mutex_);
+  // The names are identifiers of the code, they need no escaping
+  std::string summary = "{\"component\": \"" + component_ + "\", \"start_ns\": " +
+    std::to_string(
+    std::chrono::duration_cast<std::chrono::nanoseconds>(start_.time_since_epoch()).count()) +
+    ", \"total_ms\": " + Milliseconds(TotalLocked()) + ", \"phases\": [";
+  for (std::size_t i = 0; i < phases_.size(); ++i) {
+    summary += (i == 0 ? "" : ", ");
+    summary += "{\"phase\": \"" + phases_[i].name + "\", \"offset_ms\": " +
+      Milliseconds(phases_[i].begin - start_) + ", \"duration_ms\": " +
+      Milliseconds(phases_[i].end - phases_[i].begin) + "}";
+  }
+  return summary + "]}";
+}
+
+void StartupProfile::Log(const rclcpp::Logger & logger) const
+{
+  RCLCPP_INFO(logger, "Startup profile: %s", Summary().c_str());
+}
+
+diagnostic_msgs::msg::DiagnosticStatus StartupProfile::ToStatus(bool successful) const
+{
+  diagnostic_msgs::msg::DiagnosticStatus status;
+  status.level = successful ? diagnostic_msgs::msg::DiagnosticStatus::OK :
+    diagnostic_msgs::msg::DiagnosticStatus::ERROR;
+  status.name = "startup_profile";
+  status.hardware_id = component_;
+
+  std::lock_guard<std::mutex> lk(mutex_);
+  status.message = (successful ? "Started in " : "Failed after ") +
+    Milliseconds(TotalLocked()) + " ms";
+  diagnostic_msgs::msg::KeyValue value;
+  value.key = "start_ns";
+  value.value = std::to_string(
+    std::chrono::duration_cast<std::chrono::nanoseconds>(start_.time_since_epoch()).count());
+  status.values.push_back(value);
+  for (const auto & phase : phases_) {
+    value.key = phase.name + " [ms]";
+    value.value = Milliseconds(phase.end - phase.begin);
+    status.values.push_back(value);
+  }
+  return status;
+}
+}  // namespace kuka_drivers_core
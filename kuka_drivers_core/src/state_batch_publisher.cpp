@@ -0,0 +1,159 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "kuka_drivers_core/hardware_parameters.hpp"
+#include "kuka_drivers_core/state_batch_publisher.hpp"
+
+namespace kuka_drivers_core
+{
+StateBatchPublisher::StateBatchPublisher(
+  const std::string & node_name, const std::string & topic,
+  const std::vector<std::string> & joint_names, std::size_t batch_size)
+: joint_names_(
+    joint_names.begin(),
+    joint_names.begin() + static_cast<std::ptrdiff_t>(
+      joint_names.size() < MAX_JOINTS ? joint_names.size() : MAX_JOINTS)),
+  batch_size_(std::max<std::size_t>(batch_size, 1))
+{
+  node_ = rclcpp::Node::make_shared(node_name);
+  // Every batch is needed by the loggers, a lost message would leave a gap of batch_size cycles
+  publisher_ = node_->create_publisher<kuka_driver_interfaces::msg::JointStateBatch>(
+    topic, rclcpp::QoS(rclcpp::KeepLast(10)).reliable());
+
+  // The message is allocated once, publishing only overwrites the values
+  const std::size_t values = batch_size_ * joint_names_.size();
+  message_.joint_names = joint_names_;
+  message_.stamps.resize(batch_size_);
+  message_.counters.resize(batch_size_);
+  message_.flags.resize(batch_size_);
+  message_.positions.resize(values);
+  message_.velocities.reserve(values);
+  message_.efforts.reserve(values);
+  message_.commands.resize(values);
+  publish_thread_ = std::thread(&StateBatchPublisher::PublishLoop, this);
+}
+
+StateBatchPublisher::~StateBatchPublisher()
+{
+  terminate_ = true;
+  if (publish_thread_.joinable()) {
+    publish_thread_.join();
+  }
+}
+
+void StateBatchPublisher::SetCommands(const double * commands, std::size_t count)
+{
+  std::copy_n(commands, std::min(count, joint_names_.size()), current_.commands);
+  commanded_ = true;
+}
+
+void StateBatchPublisher::Update(
+  uint64_t counter, uint32_t flags, const double * positions, const double * velocities,
+  const double * efforts)
+{
+  current_.stamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+  current_.counter = counter;
+  current_.flags = flags |
+    (commanded_ ? kuka_driver_interfaces::msg::JointStateBatch::COMMANDED : 0);
+  current_.has_velocities = velocities != nullptr;
+  current_.has_efforts = efforts != nullptr;
+  const std::size_t joints = joint_names_.size();
+  std::copy_n(positions, joints, current_.positions);
+  if (velocities != nullptr) {
+    std::copy_n(velocities, joints, current_.velocities);
+  }
+  if (efforts != nullptr) {
+    std::copy_n(efforts, joints, current_.efforts);
+  }
+  commanded_ = false;
+  if (!queue_.Push(current_)) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void StateBatchPublisher::Append(const Sample & sample)
+{
+  const std::size_t joints = joint_names_.size();
+  // The first sample decides whether the batch has velocities and efforts, the capacity is
+  //  reserved, so resizing does not allocate
+  if (sample_count_ == 0) {
+    message_.velocities.resize(sample.has_velocities ? batch_size_ * joints : 0);
+    message_.efforts.resize(sample.has_efforts ? batch_size_ * joints : 0);
+  }
+
+  const std::size_t offset = sample_count_ * joints;
+  message_.stamps[sample_count_] = rclcpp::Time(sample.stamp_ns, RCL_SYSTEM_TIME);
+  message_.counters[sample_count_] = sample.counter;
+  message_.flags[sample_count_] = sample.flags;
+  std::copy_n(sample.positions, joints, message_.positions.begin() + offset);
+  if (!message_.velocities.empty()) {
+    std::copy_n(sample.velocities, joints, message_.velocities.begin() + offset);
+  }
+  if (!message_.efforts.empty()) {
+    std::copy_n(sample.efforts, joints, message_.efforts.begin() + offset);
+  }
+  std::copy_n(sample.commands, joints, message_.commands.begin() + offset);
+
+  if (++sample_count_ < batch_size_) {
+    return;
+  }
+  message_.sample_count = static_cast<uint32_t>(sample_count_);
+  message_.dropped = Dropped();
+  publisher_->publish(message_);
+  sample_count_ = 0;
+}
+
+void StateBatchPublisher::PublishLoop()
+{
+  Sample sample;
+  while (!terminate_) {
+    bool received = false;
+    while (queue_.Pop(sample)) {
+      Append(sample);
+      received = true;
+    }
+    if (!received) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+}
+
+bool ConfigureStateBatchPublisher(
+  const std::unordered_map<std::string, std::string> & parameters,
+  const std::string & hardware_name, const std::vector<std::string> & joint_names,
+  std::unique_ptr<StateBatchPublisher> & publisher, std::string & error)
+{
+  HardwareParameters checked(parameters);
+  std::size_t batch_size = 0;
+  if (!checked.Get("state_batch_size", batch_size)) {
+    error = checked.Error();
+    return false;
+  }
+  if (batch_size > 0) {
+    publisher = std::make_unique<StateBatchPublisher>(
+      hardware_name + "_state_batch_publisher",
+      checked.String("state_batch_topic", "joint_state_batches"), joint_names, batch_size);
+  }
+  return true;
+}
+}  // namespace kuka_drivers_core
@@ -0,0 +1,130 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Prints the samples published into a state channel as CSV, an example of a non-ROS reader
+
+#include <getopt.h>
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <thread>
+
+#include "kuka_drivers_core/state_channel.hpp"
+
+using kuka_drivers_core::StateChannel;
+using kuka_drivers_core::StateChannelReader;
+
+namespace
+{
+void PrintUsage(const char * program)
+{
+  printf(
+    "Usage: %s [options] <state channel file>\n"
+    "  --count <samples>   stop after the given number of samples (default: run until killed)\n"
+    "  --poll-us <us>      time between the checks for a new sample (default: 100)\n"
+    "  --once              print the latest sample and exit\n",
+    program);
+}
+
+void PrintHeader(std::size_t joints)
+{
+  printf("sequence,counter,receive_time_ns,latency_ns,mode");
+  for (const char * name : {"position", "effort", "external_effort", "command"}) {
+    for (std::size_t i = 0; i < joints; ++i) {
+      printf(",%s_%zu", name, i);
+    }
+  }
+  printf("\n");
+}
+
+void PrintSample(uint64_t sequence, const StateChannel::Sample & sample, int64_t read_time_ns)
+{
+  printf(
+    "%" PRIu64 ",%" PRIu64 ",%" PRId64 ",%" PRId64 ",%u", sequence, sample.counter,
+    sample.receive_time_ns, read_time_ns - sample.receive_time_ns,
+    static_cast<unsigned int>(sample.mode));
+  for (const double * values :
+    {sample.positions, sample.efforts, sample.external_efforts, sample.commands})
+  {
+    for (std::size_t i = 0; i < sample.joint_count; ++i) {
+      printf(",%.9g", values[i]);
+    }
+  }
+  printf("\n");
+}
+}  // namespace
+
+int main(int argc, char * argv[])
+{
+  static const struct option kOptions[] = {
+    {"count", required_argument, nullptr, 'c'},
+    {"poll-us", required_argument, nullptr, 'p'},
+    {"once", no_argument, nullptr, 'o'},
+    {"help", no_argument, nullptr, 'h'},
+    {nullptr, 0, nullptr, 0}};
+
+  uint64_t count = 0;
+  long poll_us = 100;  // NOLINT
+  bool once = false;
+  int option;
+  while ((option = getopt_long(argc, argv, "h", kOptions, nullptr)) != -1) {
+    switch (option) {
+      case 'c': count = std::strtoull(optarg, nullptr, 10); break;
+      case 'p': poll_us = std::strtol(optarg, nullptr, 10); break;
+      case 'o': once = true; break;
+      default:
+        PrintUsage(argv[0]);
+        return option == 'h' ? 0 : 1;
+    }
+  }
+  if (optind != argc - 1) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  try {
+    StateChannelReader reader(argv[optind]);
+    StateChannel::Sample sample;
+    uint64_t sequence = 0;
+    if (!reader.Read(sample, sequence)) {
+      fprintf(stderr, "Could not read a consistent sample\n");
+      return 1;
+    }
+    PrintHeader(sample.joint_count);
+    if (once) {
+      PrintSample(sequence, sample, StateChannel::Now());
+      return 0;
+    }
+
+    uint64_t last = sequence;
+    for (uint64_t printed = 0; count == 0 || printed < count; ) {
+      if (reader.Sequence() == last) {
+        std::this_thread::sleep_for(std::chrono::microseconds(poll_us));
+        continue;
+      }
+      if (reader.Read(sample, sequence)) {
+        PrintSample(sequence, sample, StateChannel::Now());
+        last = sequence;
+        ++printed;
+      }
+    }
+  } catch (const std::exception & ex) {
+    fprintf(stderr, "%s\n", ex.what());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,92 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+#include <string>
+
+#include "diagnostic_msgs/msg/key_value.hpp"
+
+#include "kuka_drivers_core/switch_trace.hpp"
+
+namespace kuka_drivers_core
+{
+void SwitchTrace::Start(const std::string & description)
+{
+  std::lock_guard<std::mutex> lk(mutex_);
+  description_ = description;
+  start_ = Clock::now();
+  Publish("request", diagnostic_msgs::msg::DiagnosticStatus::OK);
+}
+
+void SwitchTrace::Mark(const std::string & phase)
+{
+  std::lock_guard<std::mutex> lk(mutex_);
+  // Events of the controller before the first switch do not belong to any
+  if (!description_.empty()) {
+    Publish(phase, diagnostic_msgs::msg::DiagnosticStatus::OK);
+  }
+}
+
+void SwitchTrace::Finish(bool successful)
+{
+  std::lock_guard<std::mutex> lk(mutex_);
+  Publish(
+    successful ? "finished" : "failed",
+    successful ? diagnostic_msgs::msg::DiagnosticStatus::OK :
+    diagnostic_msgs::msg::DiagnosticStatus::ERROR);
+  if (metrics_group_ != nullptr && !description_.empty()) {
+    duration_->Record(
+      static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::now() - start_).count()));
+    switches_->Add();
+    if (!successful) {
+      failures_->Add();
+    }
+  }
+}
+
+void SwitchTrace::InitMetrics()
+{
+  if (!MetricsExporter::Instance().Serving()) {
+    return;
+  }
+  metrics_group_ = std::make_unique<MetricsExporter::Group>(hardware_id_);
+  duration_ = &metrics_group_->AddHistogram(
+    "mode_switch_duration_seconds", "Time from the request of a control mode switch to its end");
+  switches_ = &metrics_group_->AddCounter("mode_switches_total", "Finished control mode switches");
+  failures_ = &metrics_group_->AddCounter(
+    "mode_switch_failures_total", "Control mode switches that failed");
+}
+
+void SwitchTrace::Publish(const std::string & phase, uint8_t level)
+{
+  // Taken before the message is built, the allocations are not part of the phase
+  const int64_t stamp_ns =
+    std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+
+  diagnostic_msgs::msg::DiagnosticStatus status;
+  status.level = level;
+  status.name = "mode_switch";
+  status.hardware_id = hardware_id_;
+  status.message = description_;
+  diagnostic_msgs::msg::KeyValue value;
+  value.key = "phase";
+  value.value = phase;
+  status.values.push_back(value);
+  value.key = "stamp_ns";
+  value.value = std::to_string(stamp_ns);
+  status.values.push_back(value);
+  publisher_->publish(status);
+}
+}  // namespace kuka_drivers_core
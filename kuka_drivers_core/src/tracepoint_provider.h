@@ -0,0 +1,94 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// LTTng-UST provider of the kuka_drivers events, see tracing.hpp. The header is included several
+//  times by the LTTng macros, so it only has the guard required by them.
+
+#undef TRACEPOINT_PROVIDER
+#define TRACEPOINT_PROVIDER kuka_drivers
+
+#undef TRACEPOINT_INCLUDE
+#define TRACEPOINT_INCLUDE "tracepoint_provider.h"
+
+#if !defined(KUKA_DRIVERS_CORE__TRACEPOINT_PROVIDER_H_) || defined(TRACEPOINT_HEADER_MULTI_READ)
+#define KUKA_DRIVERS_CORE__TRACEPOINT_PROVIDER_H_
+
+#include <stdint.h>
+#include <lttng/tracepoint.h>
+
+// The labels of tracing::Phase, trace_timeline.py reads them from the trace
+TRACEPOINT_ENUM(
+  kuka_drivers, phase,
+  TP_ENUM_VALUES(
+    ctf_enum_value("read", 0)
+    ctf_enum_value("update", 1)
+    ctf_enum_value("write", 2)
+    ctf_enum_value("receive", 3)
+    ctf_enum_value("send", 4)
+    ctf_enum_value("decode", 5)
+    ctf_enum_value("encode", 6)
+    ctf_enum_value("gpio", 7)
+  )
+)
+
+TRACEPOINT_EVENT_CLASS(
+  kuka_drivers, phase_class,
+  TP_ARGS(uint8_t, phase, const void *, instance),
+  TP_FIELDS(
+    ctf_enum(kuka_drivers, phase, uint8_t, phase, phase)
+    ctf_integer_hex(uintptr_t, instance, (uintptr_t)instance)
+  )
+)
+
+TRACEPOINT_EVENT_INSTANCE(
+  kuka_drivers, phase_class, phase_begin,
+  TP_ARGS(uint8_t, phase, const void *, instance)
+)
+
+TRACEPOINT_EVENT_INSTANCE(
+  kuka_drivers, phase_class, phase_end,
+  TP_ARGS(uint8_t, phase, const void *, instance)
+)
+
+TRACEPOINT_EVENT(
+  kuka_drivers, instance_name,
+  TP_ARGS(const void *, instance, const char *, name),
+  TP_FIELDS(
+    ctf_integer_hex(uintptr_t, instance, (uintptr_t)instance)
+    ctf_string(name, name)
+  )
+)
+
+TRACEPOINT_EVENT_CLASS(
+  kuka_drivers, transition_class,
+  TP_ARGS(const char *, node, const char *, transition),
+  TP_FIELDS(
+    ctf_string(node, node)
+    ctf_string(transition, transition)
+  )
+)
+
+TRACEPOINT_EVENT_INSTANCE(
+  kuka_drivers, transition_class, transition_begin,
+  TP_ARGS(const char *, node, const char *, transition)
+)
+
+TRACEPOINT_EVENT_INSTANCE(
+  kuka_drivers, transition_class, transition_end,
+  TP_ARGS(const char *, node, const char *, transition)
+)
+
+#endif  // KUKA_DRIVERS_CORE__TRACEPOINT_PROVIDER_H_
+
+#include <lttng/tracepoint-event.h>
@@ -0,0 +1,51 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Only built with the KUKA_DRIVERS_TRACING option, the probes of the provider are defined here
+#define TRACEPOINT_CREATE_PROBES
+#define TRACEPOINT_DEFINE
+#include "tracepoint_provider.h"
+
+#include "kuka_drivers_core/tracing.hpp"
+
+namespace kuka_drivers_core
+{
+namespace tracing
+{
+void PhaseBegin(Phase phase, const void * instance)
+{
+  tracepoint(kuka_drivers, phase_begin, static_cast<uint8_t>(phase), instance);
+}
+
+void PhaseEnd(Phase phase, const void * instance)
+{
+  tracepoint(kuka_drivers, phase_end, static_cast<uint8_t>(phase), instance);
+}
+
+void InstanceName(const void * instance, const char * name)
+{
+  tracepoint(kuka_drivers, instance_name, instance, name);
+}
+
+void TransitionBegin(const char * node, const char * transition)
+{
+  tracepoint(kuka_drivers, transition_begin, node, transition);
+}
+
+void TransitionEnd(const char * node, const char * transition)
+{
+  tracepoint(kuka_drivers, transition_end, node, transition);
+}
+}  // namespace tracing
+}  // namespace kuka_drivers_core
@@ -0,0 +1,47 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <chrono>
+#include <string>
+
+#include "kuka_drivers_core/tuning_parameters.hpp"
+
+namespace kuka_drivers_core
+{
+TuningNode::TuningNode(const std::string & node_name)
+: ROS2BaseNode(node_name)
+{
+}
+
+TuningNode::~TuningNode()
+{
+  terminate_ = true;
+  if (spin_thread_.joinable()) {
+    spin_thread_.join();
+  }
+}
+
+void TuningNode::Start()
+{
+  executor_.add_node(get_node_base_interface());
+  // Spun in steps, so that the thread also ends if it is stopped before it started
+  spin_thread_ = std::thread(
+    [this] {
+      while (!terminate_ && rclcpp::ok()) {
+        executor_.spin_once(std::chrono::milliseconds(100));
+      }
+    });
+}
+}  // namespace kuka_drivers_core
@@ -0,0 +1,207 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Replays the controller side of a wire capture against a running driver: the datagrams
+// the driver received are sent again with the recorded timing (optionally accelerated),
+// and the replies of the driver are compared to the recorded ones.
+
+#include <arpa/inet.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "kuka_drivers_core/latency_histogram.hpp"
+#include "kuka_drivers_core/wire_capture.hpp"
+
+using kuka_drivers_core::WireCapture;
+
+namespace
+{
+void PrintUsage(const char * program)
+{
+  printf(
+    "Usage: %s [options] <capture file>\n"
+    "  --ip <address>      IP address of the driver (default: 127.0.0.1)\n"
+    "  --port <port>       port of the driver (default: 59152)\n"
+    "  --speed <factor>    replay speed, 0 sends as fast as the replies arrive (default: 1)\n"
+    "  --timeout-ms <ms>   time to wait for a reply (default: 100)\n"
+    "  --dump              print the captured datagrams instead of replaying them\n", program);
+}
+
+void PrintDatagram(
+  const WireCapture::Datagram & datagram, std::chrono::steady_clock::time_point start)
+{
+  printf(
+    "%8lu %12.6f %s %4zu %s\n", datagram.sequence,
+    std::chrono::duration<double>(datagram.timestamp - start).count(),
+    datagram.direction == WireCapture::Direction::RECEIVED ? "<-" : "->",
+    datagram.data.size(), datagram.data.c_str());
+}
+
+void SleepUntil(std::chrono::steady_clock::time_point time_point)
+{
+  const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    time_point.time_since_epoch()).count();
+  struct timespec deadline;
+  deadline.tv_sec = ns / 1000000000;
+  deadline.tv_nsec = ns % 1000000000;
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR) {
+  }
+}
+}  // namespace
+
+int main(int argc, char * argv[])
+{
+  static const struct option kOptions[] = {
+    {"ip", required_argument, nullptr, 'i'},
+    {"port", required_argument, nullptr, 'p'},
+    {"speed", required_argument, nullptr, 's'},
+    {"timeout-ms", required_argument, nullptr, 't'},
+    {"dump", no_argument, nullptr, 'd'},
+    {"help", no_argument, nullptr, 'h'},
+    {nullptr, 0, nullptr, 0}};
+
+  std::string ip = "127.0.0.1";
+  int port = 59152;
+  double speed = 1.0;
+  int timeout_ms = 100;
+  bool dump = false;
+  int option;
+  while ((option = getopt_long(argc, argv, "h", kOptions, nullptr)) != -1) {
+    switch (option) {
+      case 'i': ip = optarg; break;
+      case 'p': port = std::atoi(optarg); break;
+      case 's': speed = std::atof(optarg); break;
+      case 't': timeout_ms = std::atoi(optarg); break;
+      case 'd': dump = true; break;
+      default:
+        PrintUsage(argv[0]);
+        return option == 'h' ? 0 : 1;
+    }
+  }
+  if (optind != argc - 1 || speed < 0) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  std::vector<WireCapture::Datagram> datagrams;
+  try {
+    datagrams = WireCapture::ReadFile(argv[optind]);
+  } catch (const std::exception & ex) {
+    fprintf(stderr, "%s\n", ex.what());
+    return 1;
+  }
+  if (datagrams.empty()) {
+    fprintf(stderr, "The capture is empty\n");
+    return 1;
+  }
+  if (datagrams.size() > 1 && datagrams.back().sequence - datagrams.front().sequence + 1 !=
+    datagrams.size())
+  {
+    fprintf(stderr, "Warning: the ring overflowed or the capture was interrupted, "
+      "the sequence has gaps\n");
+  }
+
+  if (dump) {
+    for (const auto & datagram : datagrams) {
+      PrintDatagram(datagram, datagrams.front().timestamp);
+    }
+    return 0;
+  }
+
+  const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  struct sockaddr_in driver_address;
+  memset(&driver_address, 0, sizeof(driver_address));
+  driver_address.sin_family = AF_INET;
+  driver_address.sin_addr.s_addr = inet_addr(ip.c_str());
+  driver_address.sin_port = htons(static_cast<uint16_t>(port));
+  if (fd < 0 ||
+    connect(fd, reinterpret_cast<struct sockaddr *>(&driver_address), sizeof(driver_address)) < 0)
+  {
+    fprintf(stderr, "Error connecting to %s:%i: %s\n", ip.c_str(), port, strerror(errno));
+    return 1;
+  }
+
+  kuka_drivers_core::LatencyHistogram<> latency;
+  uint64_t sent = 0;
+  uint64_t missing_replies = 0;
+  uint64_t identical_replies = 0;
+  char buffer[WireCapture::MAX_PAYLOAD + 1];
+
+  const auto capture_start = datagrams.front().timestamp;
+  const auto replay_start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < datagrams.size(); ++i) {
+    const auto & datagram = datagrams[i];
+    if (datagram.direction != WireCapture::Direction::RECEIVED) {
+      continue;
+    }
+    if (speed > 0) {
+      SleepUntil(
+        replay_start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          (datagram.timestamp - capture_start) / speed));
+    }
+
+    const auto send_time = std::chrono::steady_clock::now();
+    if (send(fd, datagram.data.data(), datagram.data.size(), 0) < 0) {
+      fprintf(stderr, "Error in send: %s\n", strerror(errno));
+      return 1;
+    }
+    ++sent;
+
+    struct pollfd poll_fd = {fd, POLLIN, 0};
+    ssize_t bytes = -1;
+    if (poll(&poll_fd, 1, timeout_ms) > 0) {
+      bytes = recv(fd, buffer, sizeof(buffer) - 1, 0);
+    }
+    if (bytes < 0) {
+      ++missing_replies;
+      continue;
+    }
+    latency.Record(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - send_time).count());
+
+    // The recorded reply is the next sent datagram before the next received one
+    for (std::size_t j = i + 1;
+      j < datagrams.size() && datagrams[j].direction == WireCapture::Direction::SENT; ++j)
+    {
+      if (datagrams[j].data.compare(0, std::string::npos, buffer, bytes) == 0) {
+        ++identical_replies;
+        break;
+      }
+    }
+  }
+  close(fd);
+
+  const auto snapshot = latency.GetSnapshot();
+  printf(
+    "sent: %lu, replies: %lu, missing replies: %lu, identical to the capture: %lu\n", sent,
+    snapshot.count, missing_replies, identical_replies);
+  printf(
+    "reply latency [us] p50: %lu, p90: %lu, p99: %lu, p99.9: %lu, max: %lu\n",
+    snapshot.Percentile(50) / 1000, snapshot.Percentile(90) / 1000,
+    snapshot.Percentile(99) / 1000, snapshot.Percentile(99.9) / 1000, snapshot.max_ns / 1000);
+  return 0;
+}
@@ -0,0 +1,512 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <arpa/inet.h>
+#include <linux/bpf.h>
+#include <linux/if_ether.h>
+#include <linux/if_link.h>
+#include <net/if.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#include "kuka_drivers_core/xdp_socket.hpp"
+
+// Older C libraries do not define the address family yet
+#ifndef AF_XDP
+#define AF_XDP 44
+#endif
+#ifndef SOL_XDP
+#define SOL_XDP 283
+#endif
+
+namespace kuka_drivers_core
+{
+constexpr std::size_t XdpSocket::FRAME_SIZE;
+constexpr uint32_t XdpSocket::RING_SIZE;
+constexpr uint32_t XdpSocket::FRAME_COUNT;
+constexpr std::size_t XdpSocket::HEADER_SIZE;
+
+namespace
+{
+int Bpf(int command, union bpf_attr & attr)
+{
+  return static_cast<int>(syscall(__NR_bpf, command, &attr, sizeof(attr)));
+}
+
+struct bpf_insn Instruction(uint8_t code, uint8_t dst, uint8_t src, int16_t off, int32_t imm)
+{
+  struct bpf_insn instruction;
+  std::memset(&instruction, 0, sizeof(instruction));
+  instruction.code = code;
+  instruction.dst_reg = dst & 0xf;
+  instruction.src_reg = src & 0xf;
+  instruction.off = off;
+  instruction.imm = imm;
+  return instruction;
+}
+
+uint16_t Checksum(const uint8_t * data, std::size_t size, uint32_t sum)
+{
+  for (std::size_t i = 0; i + 1 < size; i += 2) {
+    sum += static_cast<uint32_t>(data[i]) << 8 | data[i + 1];
+  }
+  if (size % 2 == 1) {
+    sum += static_cast<uint32_t>(data[size - 1]) << 8;
+  }
+  while (sum >> 16) {
+    sum = (sum & 0xffff) + (sum >> 16);
+  }
+  return static_cast<uint16_t>(~sum);
+}
+
+uint16_t Load16(const uint8_t * data)
+{
+  return static_cast<uint16_t>(data[0] << 8 | data[1]);
+}
+
+void Store16(uint8_t * data, uint16_t value)
+{
+  data[0] = static_cast<uint8_t>(value >> 8);
+  data[1] = static_cast<uint8_t>(value);
+}
+}  // namespace
+
+bool XdpSocket::Open(
+  const std::string & interface, uint32_t queue, uint16_t port, bool zero_copy)
+{
+  Close();
+  const int ifindex = static_cast<int>(if_nametoindex(interface.c_str()));
+  if (ifindex == 0) {
+    return Fail("Unknown network interface " + interface);
+  }
+  port_ = port;
+  // Nothing is redirected until the program is attached, after the socket is ready
+  if (!LoadProgram(port, queue) || !CreateSocket(ifindex, queue, zero_copy) ||
+    !AttachProgram(ifindex))
+  {
+    const std::string error = error_;
+    Close();
+    error_ = error;
+    return false;
+  }
+  return true;
+}
+
+void XdpSocket::Close()
+{
+  // Closing the link detaches the program from the interface
+  for (int * fd : {&link_fd_, &program_fd_, &fd_, &map_fd_}) {
+    if (*fd >= 0) {
+      close(*fd);
+    }
+    *fd = -1;
+  }
+  for (Ring * ring : {&fill_, &completion_, &rx_, &tx_}) {
+    if (ring->map != nullptr) {
+      munmap(ring->map, ring->map_size);
+    }
+    *ring = Ring();
+  }
+  if (umem_ != nullptr) {
+    munmap(umem_, FRAME_COUNT * FRAME_SIZE);
+  }
+  umem_ = nullptr;
+  holding_ = false;
+  free_tx_count_ = 0;
+  has_remote_ = false;
+  has_peer_ = false;
+}
+
+bool XdpSocket::LoadProgram(uint16_t port, uint32_t queue)
+{
+  union bpf_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.map_type = BPF_MAP_TYPE_XSKMAP;
+  attr.key_size = sizeof(uint32_t);
+  attr.value_size = sizeof(uint32_t);
+  attr.max_entries = queue + 1;
+  map_fd_ = Bpf(BPF_MAP_CREATE, attr);
+  if (map_fd_ < 0) {
+    return Fail("Creating the XSK map failed");
+  }
+
+  // IPv4 datagrams without options and fragmentation to the port are redirected to the socket
+  //  of the receive queue, everything else is passed to the kernel stack
+  constexpr uint8_t LDX_W = BPF_LDX | BPF_MEM | BPF_W;
+  constexpr uint8_t LDX_H = BPF_LDX | BPF_MEM | BPF_H;
+  constexpr uint8_t LDX_B = BPF_LDX | BPF_MEM | BPF_B;
+  constexpr uint8_t JNE = BPF_JMP | BPF_JNE | BPF_K;
+  constexpr int PASS = 22;
+  const struct bpf_insn program[] = {
+    Instruction(LDX_W, BPF_REG_2, BPF_REG_1, offsetof(struct xdp_md, data), 0),
+    Instruction(LDX_W, BPF_REG_3, BPF_REG_1, offsetof(struct xdp_md, data_end), 0),
+    Instruction(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_4, BPF_REG_2, 0, 0),
+    Instruction(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_4, 0, 0, HEADER_SIZE),
+    Instruction(BPF_JMP | BPF_JGT | BPF_X, BPF_REG_4, BPF_REG_3, PASS - 5, 0),
+    Instruction(LDX_H, BPF_REG_4, BPF_REG_2, 12, 0),
+    Instruction(JNE, BPF_REG_4, 0, PASS - 7, htons(ETH_P_IP)),
+    Instruction(LDX_B, BPF_REG_4, BPF_REG_2, 14, 0),
+    Instruction(JNE, BPF_REG_4, 0, PASS - 9, 0x45),
+    Instruction(LDX_B, BPF_REG_4, BPF_REG_2, 23, 0),
+    Instruction(JNE, BPF_REG_4, 0, PASS - 11, IPPROTO_UDP),
+    Instruction(LDX_H, BPF_REG_4, BPF_REG_2, 20, 0),
+    Instruction(BPF_ALU64 | BPF_AND | BPF_K, BPF_REG_4, 0, 0, htons(0x3fff)),
+    Instruction(JNE, BPF_REG_4, 0, PASS - 14, 0),
+    Instruction(LDX_H, BPF_REG_4, BPF_REG_2, 36, 0),
+    Instruction(JNE, BPF_REG_4, 0, PASS - 16, htons(port)),
+    Instruction(LDX_W, BPF_REG_2, BPF_REG_1, offsetof(struct xdp_md, rx_queue_index), 0),
+    Instruction(BPF_LD | BPF_DW | BPF_IMM, BPF_REG_1, BPF_PSEUDO_MAP_FD, 0, map_fd_),
+    Instruction(0, 0, 0, 0, 0),
+    // The flags of the redirect are the action if the queue has no socket
+    Instruction(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_3, 0, 0, XDP_PASS),
+    Instruction(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_redirect_map),
+    Instruction(BPF_JMP | BPF_EXIT, 0, 0, 0, 0),
+    Instruction(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_0, 0, 0, XDP_PASS),
+    Instruction(BPF_JMP | BPF_EXIT, 0, 0, 0, 0)};
+  static const char license[] = "Dual BSD/GPL";
+
+  std::memset(&attr, 0, sizeof(attr));
+  attr.prog_type = BPF_PROG_TYPE_XDP;
+  attr.insns = reinterpret_cast<uint64_t>(program);
+  attr.insn_cnt = sizeof(program) / sizeof(program[0]);
+  attr.license = reinterpret_cast<uint64_t>(license);
+  program_fd_ = Bpf(BPF_PROG_LOAD, attr);
+  if (program_fd_ < 0) {
+    // Loaded again with the log of the verifier for the reason
+    const int error = errno;
+    std::string log(4096, '\0');
+    attr.log_buf = reinterpret_cast<uint64_t>(&log[0]);
+    attr.log_size = static_cast<uint32_t>(log.size());
+    attr.log_level = 1;
+    Bpf(BPF_PROG_LOAD, attr);
+    errno = error;
+    return Fail("Loading the XDP program failed (" + std::string(log.c_str()) + ")");
+  }
+  return true;
+}
+
+bool XdpSocket::MapRing(
+  Ring & ring, uint64_t page_offset, const struct xdp_ring_offset & offsets,
+  std::size_t descriptor_size)
+{
+  ring.map_size = offsets.desc + RING_SIZE * descriptor_size;
+  void * map = mmap(
+    nullptr, ring.map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+    static_cast<off_t>(page_offset));
+  if (map == MAP_FAILED) {
+    ring.map_size = 0;
+    return Fail("Mapping the rings of the XDP socket failed");
+  }
+  auto * base = static_cast<uint8_t *>(map);
+  ring.map = map;
+  ring.producer = reinterpret_cast<uint32_t *>(base + offsets.producer);
+  ring.consumer = reinterpret_cast<uint32_t *>(base + offsets.consumer);
+  ring.descriptors = base + offsets.desc;
+  ring.size = RING_SIZE;
+  return true;
+}
+
+bool XdpSocket::CreateSocket(int ifindex, uint32_t queue, bool zero_copy)
+{
+  fd_ = socket(AF_XDP, SOCK_RAW, 0);
+  if (fd_ < 0) {
+    return Fail("Error opening the XDP socket");
+  }
+  void * umem = mmap(
+    nullptr, FRAME_COUNT * FRAME_SIZE, PROT_READ | PROT_WRITE,
+    MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+  if (umem == MAP_FAILED) {
+    return Fail("Allocating the frames of the XDP socket failed");
+  }
+  umem_ = static_cast<uint8_t *>(umem);
+
+  struct xdp_umem_reg registration;
+  std::memset(&registration, 0, sizeof(registration));
+  registration.addr = reinterpret_cast<uint64_t>(umem_);
+  registration.len = FRAME_COUNT * FRAME_SIZE;
+  registration.chunk_size = FRAME_SIZE;
+  if (setsockopt(fd_, SOL_XDP, XDP_UMEM_REG, &registration, sizeof(registration)) < 0) {
+    return Fail("Registering the frames of the XDP socket failed");
+  }
+  const uint32_t ring_size = RING_SIZE;
+  for (int ring : {XDP_UMEM_FILL_RING, XDP_UMEM_COMPLETION_RING, XDP_RX_RING, XDP_TX_RING}) {
+    if (setsockopt(fd_, SOL_XDP, ring, &ring_size, sizeof(ring_size)) < 0) {
+      return Fail("Creating the rings of the XDP socket failed");
+    }
+  }
+  struct xdp_mmap_offsets offsets;
+  socklen_t offsets_size = sizeof(offsets);
+  if (getsockopt(fd_, SOL_XDP, XDP_MMAP_OFFSETS, &offsets, &offsets_size) < 0) {
+    return Fail("Querying the rings of the XDP socket failed");
+  }
+  if (!MapRing(fill_, XDP_UMEM_PGOFF_FILL_RING, offsets.fr, sizeof(uint64_t)) ||
+    !MapRing(completion_, XDP_UMEM_PGOFF_COMPLETION_RING, offsets.cr, sizeof(uint64_t)) ||
+    !MapRing(rx_, XDP_PGOFF_RX_RING, offsets.rx, sizeof(struct xdp_desc)) ||
+    !MapRing(tx_, XDP_PGOFF_TX_RING, offsets.tx, sizeof(struct xdp_desc)))
+  {
+    return false;
+  }
+
+  // The first half of the frames waits for received datagrams, the second half for replies
+  auto * fill = static_cast<uint64_t *>(fill_.descriptors);
+  for (uint32_t i = 0; i < RING_SIZE; ++i) {
+    fill[i] = static_cast<uint64_t>(i) * FRAME_SIZE;
+    free_tx_[i] = static_cast<uint64_t>(RING_SIZE + i) * FRAME_SIZE;
+  }
+  free_tx_count_ = RING_SIZE;
+  __atomic_store_n(fill_.producer, RING_SIZE, __ATOMIC_RELEASE);
+
+  struct sockaddr_xdp address;
+  std::memset(&address, 0, sizeof(address));
+  address.sxdp_family = AF_XDP;
+  address.sxdp_ifindex = static_cast<uint32_t>(ifindex);
+  address.sxdp_queue_id = queue;
+  address.sxdp_flags = zero_copy ? XDP_ZEROCOPY : 0;
+  if (bind(fd_, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) < 0) {
+    return Fail("Binding the XDP socket to queue " + std::to_string(queue) + " failed");
+  }
+
+  union bpf_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.map_fd = static_cast<uint32_t>(map_fd_);
+  attr.key = reinterpret_cast<uint64_t>(&queue);
+  attr.value = reinterpret_cast<uint64_t>(&fd_);
+  if (Bpf(BPF_MAP_UPDATE_ELEM, attr) < 0) {
+    return Fail("Registering the XDP socket in the XSK map failed");
+  }
+  return true;
+}
+
+bool XdpSocket::AttachProgram(int ifindex)
+{
+  // The native mode of the NIC driver is preferred, the generic one works with all interfaces
+  for (uint32_t mode : {XDP_FLAGS_DRV_MODE, XDP_FLAGS_SKB_MODE}) {
+    union bpf_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.link_create.prog_fd = static_cast<uint32_t>(program_fd_);
+    attr.link_create.target_ifindex = static_cast<uint32_t>(ifindex);
+    attr.link_create.attach_type = BPF_XDP;
+    attr.link_create.flags = mode;
+    link_fd_ = Bpf(BPF_LINK_CREATE, attr);
+    if (link_fd_ >= 0) {
+      return true;
+    }
+  }
+  return Fail("Attaching the XDP program failed");
+}
+
+void XdpSocket::SetPeer(const struct sockaddr_in & peer)
+{
+  peer_ = peer;
+  has_peer_ = true;
+}
+
+ssize_t XdpSocket::Parse(
+  uint8_t * frame, std::size_t length, std::size_t room, const char *& payload)
+{
+  if (length < HEADER_SIZE || Load16(frame + 12) != ETH_P_IP || frame[14] != 0x45 ||
+    frame[23] != IPPROTO_UDP || Load16(frame + 36) != port_)
+  {
+    return -1;
+  }
+  const uint8_t * ip = frame + 14;
+  const uint8_t * udp = ip + 20;
+  std::size_t size = Load16(udp + 4);
+  if (size < 8 || 14 + 20 + size > length) {
+    return -1;
+  }
+  size -= 8;
+  uint32_t source_ip;
+  std::memcpy(&source_ip, ip + 12, sizeof(source_ip));
+  const uint16_t source_port = Load16(udp);
+  if (has_peer_ &&
+    (source_ip != peer_.sin_addr.s_addr || source_port != ntohs(peer_.sin_port)))
+  {
+    return -1;
+  }
+  // The terminator is written behind the datagram, over a possible Ethernet padding
+  if (HEADER_SIZE + size >= room) {
+    return -1;
+  }
+  frame[HEADER_SIZE + size] = '\0';
+
+  std::memcpy(remote_mac_, frame + 6, sizeof(remote_mac_));
+  std::memcpy(local_mac_, frame, sizeof(local_mac_));
+  remote_ip_ = source_ip;
+  std::memcpy(&local_ip_, ip + 16, sizeof(local_ip_));
+  remote_port_ = source_port;
+  has_remote_ = true;
+  payload = reinterpret_cast<const char *>(frame + HEADER_SIZE);
+  return static_cast<ssize_t>(size);
+}
+
+void XdpSocket::Release()
+{
+  if (!holding_) {
+    return;
+  }
+  // The fill ring has room for all receive frames, it cannot overflow
+  const uint32_t producer = *fill_.producer;
+  static_cast<uint64_t *>(fill_.descriptors)[producer & (fill_.size - 1)] = held_frame_;
+  __atomic_store_n(fill_.producer, producer + 1, __ATOMIC_RELEASE);
+  holding_ = false;
+}
+
+ssize_t XdpSocket::Receive(
+  const char *& payload, std::chrono::microseconds timeout, bool spin)
+{
+  using std::chrono::steady_clock;
+  payload = nullptr;
+  if (fd_ < 0) {
+    error_ = "XDP socket is not open";
+    return -1;
+  }
+  Release();
+  const bool limited = timeout.count() > 0;
+  const auto deadline = steady_clock::now() + timeout;
+  while (true) {
+    const uint32_t consumer = *rx_.consumer;
+    if (__atomic_load_n(rx_.producer, __ATOMIC_ACQUIRE) != consumer) {
+      const struct xdp_desc descriptor =
+        static_cast<struct xdp_desc *>(rx_.descriptors)[consumer & (rx_.size - 1)];
+      __atomic_store_n(rx_.consumer, consumer + 1, __ATOMIC_RELEASE);
+      // The frame starts after the headroom of the kernel within its chunk
+      held_frame_ = descriptor.addr - descriptor.addr % FRAME_SIZE;
+      holding_ = true;
+      const ssize_t size = Parse(
+        umem_ + descriptor.addr, descriptor.len, FRAME_SIZE - descriptor.addr % FRAME_SIZE,
+        payload);
+      if (size >= 0) {
+        return size;
+      }
+      Release();
+      continue;
+    }
+
+    const auto now = steady_clock::now();
+    if (limited && now >= deadline) {
+      return 0;
+    }
+    if (spin) {
+      continue;
+    }
+    struct pollfd descriptor = {fd_, POLLIN, 0};
+    struct timespec wait;
+    const auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now);
+    wait.tv_sec = static_cast<time_t>(remaining.count() / 1000000000);
+    wait.tv_nsec = static_cast<long>(remaining.count() % 1000000000);  // NOLINT
+    const int ready = ppoll(&descriptor, 1, limited ? &wait : nullptr, nullptr);
+    if (ready == 0 || (ready < 0 && errno == EINTR)) {
+      // An interrupted wait is handled like a timeout
+      return 0;
+    }
+    if (ready < 0) {
+      Fail("Error in poll");
+      return -1;
+    }
+  }
+}
+
+void XdpSocket::Reclaim()
+{
+  uint32_t consumer = *completion_.consumer;
+  const uint32_t producer = __atomic_load_n(completion_.producer, __ATOMIC_ACQUIRE);
+  const auto * completed = static_cast<const uint64_t *>(completion_.descriptors);
+  while (consumer != producer && free_tx_count_ < RING_SIZE) {
+    free_tx_[free_tx_count_++] = completed[consumer & (completion_.size - 1)];
+    ++consumer;
+  }
+  __atomic_store_n(completion_.consumer, consumer, __ATOMIC_RELEASE);
+}
+
+ssize_t XdpSocket::Send(const void * data, std::size_t size)
+{
+  if (fd_ < 0 || !has_remote_) {
+    error_ = "No datagram received yet";
+    return -1;
+  }
+  if (HEADER_SIZE + size > FRAME_SIZE) {
+    error_ = "Datagram does not fit into a frame";
+    return -1;
+  }
+  Reclaim();
+  if (free_tx_count_ == 0) {
+    error_ = "Transmit ring of the XDP socket is full";
+    return -1;
+  }
+  const uint64_t address = free_tx_[--free_tx_count_];
+  uint8_t * frame = umem_ + address;
+
+  // Ethernet, IPv4 and UDP headers with the addresses of the received datagram swapped
+  std::memcpy(frame, remote_mac_, sizeof(remote_mac_));
+  std::memcpy(frame + 6, local_mac_, sizeof(local_mac_));
+  Store16(frame + 12, ETH_P_IP);
+  uint8_t * ip = frame + 14;
+  ip[0] = 0x45;
+  ip[1] = tos_;
+  Store16(ip + 2, static_cast<uint16_t>(20 + 8 + size));
+  Store16(ip + 4, ip_id_++);
+  // Do not fragment
+  Store16(ip + 6, 0x4000);
+  ip[8] = 64;
+  ip[9] = IPPROTO_UDP;
+  Store16(ip + 10, 0);
+  std::memcpy(ip + 12, &local_ip_, sizeof(local_ip_));
+  std::memcpy(ip + 16, &remote_ip_, sizeof(remote_ip_));
+  Store16(ip + 10, Checksum(ip, 20, 0));
+  uint8_t * udp = ip + 20;
+  Store16(udp, port_);
+  Store16(udp + 2, remote_port_);
+  Store16(udp + 4, static_cast<uint16_t>(8 + size));
+  Store16(udp + 6, 0);
+  std::memcpy(udp + 8, data, size);
+  // Pseudo header of the UDP checksum: addresses, protocol and length
+  uint32_t pseudo = IPPROTO_UDP + static_cast<uint32_t>(8 + size);
+  for (int i = 12; i < 20; i += 2) {
+    pseudo += Load16(ip + i);
+  }
+  uint16_t checksum = Checksum(udp, 8 + size, pseudo);
+  Store16(udp + 6, checksum == 0 ? 0xffff : checksum);
+
+  const uint32_t producer = *tx_.producer;
+  struct xdp_desc & descriptor =
+    static_cast<struct xdp_desc *>(tx_.descriptors)[producer & (tx_.size - 1)];
+  descriptor.addr = address;
+  descriptor.len = static_cast<uint32_t>(HEADER_SIZE + size);
+  descriptor.options = 0;
+  __atomic_store_n(tx_.producer, producer + 1, __ATOMIC_RELEASE);
+  // The kernel sends the frames of the transmit ring when woken up, a busy device is retried at
+  //  the next send
+  if (sendto(fd_, nullptr, 0, MSG_DONTWAIT, nullptr, 0) < 0 &&
+    errno != EAGAIN && errno != EBUSY && errno != ENOBUFS)
+  {
+    Fail("Error in send");
+    return -1;
+  }
+  return static_cast<ssize_t>(size);
+}
+
+bool XdpSocket::Fail(const std::string & message)
+{
+  error_ = message + ": " + std::strerror(errno);
+  return false;
+}
+}  // namespace kuka_drivers_core
@@ -0,0 +1,264 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <clocale>
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+
+#include "kuka_drivers_core/clock_sync.hpp"
+#include "kuka_drivers_core/command_filter.hpp"
+#include "kuka_drivers_core/command_interpolator.hpp"
+#include "kuka_drivers_core/fault_injection.hpp"
+#include "kuka_drivers_core/flight_recorder.hpp"
+#include "kuka_drivers_core/hardware_parameters.hpp"
+#include "kuka_drivers_core/udp_transport.hpp"
+#include "kuka_drivers_core/wire_capture.hpp"
+
+using kuka_drivers_core::HardwareParameters;
+
+TEST(HardwareParameters, ReadsValidValues)
+{
+  const std::unordered_map<std::string, std::string> values = {
+    {"port", "59152"}, {"tolerance", " 0.25 "}, {"slots", "16384"}, {"deadline_ms", "10"},
+    {"offset", "-3"}};
+  HardwareParameters parameters(values);
+  int port = 0;
+  double tolerance = 0;
+  std::size_t slots = 0;
+  std::chrono::milliseconds deadline(0);
+  int offset = 0;
+  EXPECT_TRUE(parameters.Require("port", port, 1, 65535));
+  EXPECT_TRUE(parameters.Get("tolerance", tolerance, 0.0));
+  EXPECT_TRUE(parameters.Get("slots", slots, 1));
+  EXPECT_TRUE(parameters.Get("deadline_ms", deadline, 1));
+  EXPECT_TRUE(parameters.Get("offset", offset));
+  EXPECT_TRUE(parameters.Ok());
+  EXPECT_EQ(port, 59152);
+  EXPECT_DOUBLE_EQ(tolerance, 0.25);
+  EXPECT_EQ(slots, 16384u);
+  EXPECT_EQ(deadline, std::chrono::milliseconds(10));
+  EXPECT_EQ(offset, -3);
+}
+
+TEST(HardwareParameters, KeepsMissingAndEmptyValues)
+{
+  const std::unordered_map<std::string, std::string> values = {{"empty", ""}};
+  HardwareParameters parameters(values);
+  int missing = 7;
+  int empty = 8;
+  EXPECT_TRUE(parameters.Get("missing", missing));
+  EXPECT_TRUE(parameters.Get("empty", empty));
+  EXPECT_EQ(missing, 7);
+  EXPECT_EQ(empty, 8);
+  EXPECT_TRUE(parameters.Ok());
+  EXPECT_FALSE(parameters.Require("missing", missing));
+  EXPECT_EQ(parameters.Error(), "missing must be set");
+}
+
+TEST(HardwareParameters, RejectsInvalidValues)
+{
+  const std::unordered_map<std::string, std::string> values = {
+    {"text", "abc"}, {"trailing", "12abc"}, {"fraction", "1.5"}, {"overflow", "99999999999"},
+    {"negative", "-1"}, {"range", "64"}, {"nan", "nan"}};
+  for (const auto & value : values) {
+    HardwareParameters parameters(values);
+    int integer = 5;
+    unsigned int count = 5;
+    double number = 5;
+    bool valid = true;
+    if (value.first == "negative") {
+      valid = parameters.Get(value.first, count);
+      EXPECT_EQ(count, 5u);
+    } else if (value.first == "range") {
+      valid = parameters.Get(value.first, integer, 0, 63);
+      EXPECT_EQ(integer, 5);
+    } else if (value.first == "nan") {
+      valid = parameters.Get(value.first, number);
+    } else {
+      valid = parameters.Get(value.first, integer);
+      EXPECT_EQ(integer, 5);
+    }
+    EXPECT_FALSE(valid) << value.first;
+    EXPECT_FALSE(parameters.Ok()) << value.first;
+    EXPECT_EQ(parameters.Error().rfind(value.first + " must be ", 0), 0u) << parameters.Error();
+  }
+}
+
+TEST(HardwareParameters, KeepsTheFirstError)
+{
+  const std::unordered_map<std::string, std::string> values = {
+    {"dscp", "64"}, {"priority", "-1"}};
+  HardwareParameters parameters(values);
+  int dscp = 0;
+  int priority = 0;
+  EXPECT_FALSE(parameters.Get("dscp", dscp, 0, 63));
+  EXPECT_FALSE(parameters.Get("priority", priority, 0));
+  EXPECT_EQ(parameters.Error(), "dscp must be an integer between 0 and 63");
+}
+
+TEST(HardwareParameters, IgnoresTheDecimalSeparatorOfTheLocale)
+{
+  // Only changes anything if a locale with a decimal comma is installed
+  const std::string previous = std::setlocale(LC_NUMERIC, nullptr);
+  std::setlocale(LC_NUMERIC, "de_DE.UTF-8");
+  const std::unordered_map<std::string, std::string> values = {{"tolerance", "0.5"}};
+  HardwareParameters parameters(values);
+  double tolerance = 0;
+  EXPECT_TRUE(parameters.Get("tolerance", tolerance));
+  EXPECT_DOUBLE_EQ(tolerance, 0.5);
+  std::setlocale(LC_NUMERIC, previous.c_str());
+}
+
+TEST(HardwareParameters, ConvertsSingleValues)
+{
+  double value = 1;
+  EXPECT_TRUE(HardwareParameters::Convert("-2.5", value));
+  EXPECT_DOUBLE_EQ(value, -2.5);
+  EXPECT_FALSE(HardwareParameters::Convert("2.5.1", value));
+  EXPECT_FALSE(HardwareParameters::Convert("3", value, -1.0, 1.0));
+  EXPECT_DOUBLE_EQ(value, -2.5);
+}
+
+TEST(HardwareParameters, RejectsMalformedValues)
+{
+  for (const char * text :
+    {"", " ", "10ms", "0,5", "1.5.2", "nan", "-nan", "inf", "-inf", "1e5000", "0x10", "--1"})
+  {
+    double number = 7;
+    int integer = 7;
+    EXPECT_FALSE(HardwareParameters::Convert(text, number)) << text;
+    EXPECT_FALSE(HardwareParameters::Convert(text, integer)) << text;
+    EXPECT_DOUBLE_EQ(number, 7) << text;
+    EXPECT_EQ(integer, 7) << text;
+  }
+  int integer = 7;
+  EXPECT_FALSE(HardwareParameters::Convert("2147483648", integer));
+  EXPECT_FALSE(HardwareParameters::Convert("99999999999999999999999", integer));
+  EXPECT_FALSE(HardwareParameters::Convert("1.0", integer));
+  EXPECT_EQ(integer, 7);
+}
+
+TEST(HardwareParameters, CoreParsersRejectMalformedValues)
+{
+  std::string error;
+  std::chrono::nanoseconds min_latency(0);
+  for (const char * text : {"x", "nan", "inf", "10us", "-1", "2e6"}) {
+    error.clear();
+    EXPECT_FALSE(
+      kuka_drivers_core::ClockSync::ParseMinLatency(
+        {{"clock_sync_min_latency_us", text}}, min_latency, error)) << text;
+    EXPECT_FALSE(error.empty()) << text;
+  }
+  EXPECT_TRUE(
+    kuka_drivers_core::ClockSync::ParseMinLatency(
+      {{"clock_sync_min_latency_us", "250.5"}}, min_latency, error));
+  EXPECT_EQ(min_latency, std::chrono::nanoseconds(250500));
+
+  kuka_drivers_core::FaultInjector::Profile profile;
+  EXPECT_FALSE(kuka_drivers_core::FaultInjector::ParseProfile("delay_us=10ms", profile, error));
+  EXPECT_FALSE(kuka_drivers_core::FaultInjector::ParseProfile("loss=0,5", profile, error));
+  EXPECT_FALSE(kuka_drivers_core::FaultInjector::ParseProfile("loss=nan", profile, error));
+
+  kuka_drivers_core::CommandInterpolator interpolator;
+  EXPECT_FALSE(
+    interpolator.Configure(
+      {{"command_interpolation", "velocity_limited"}, {"interpolation_max_rate", "1.5rad"}}, 6,
+      error));
+
+  kuka_drivers_core::JointCommandFilter filter;
+  EXPECT_FALSE(
+    kuka_drivers_core::ConfigureCommandFilter(
+      {{"command_max_velocity", "1.0,2.0x,1,1,1,1"}}, 6, filter, error));
+  EXPECT_FALSE(
+    kuka_drivers_core::ConfigureCommandFilter(
+      {{"command_max_velocity", "nan"}}, 6, filter, error));
+
+  for (const auto & parameter : std::unordered_map<std::string, std::string>{
+      {"busy_poll_us", "50us"}, {"socket_priority", "8"}, {"dscp", "4 6"}, {"xdp_queue", "-1"}})
+  {
+    kuka_drivers_core::UdpTransport::Options options;
+    EXPECT_FALSE(
+      kuka_drivers_core::UdpTransport::ParseOptions({parameter}, options, error)) <<
+      parameter.first;
+  }
+}
+
+TEST(HardwareParameters, ReadsFlagsAndChoices)
+{
+  const std::unordered_map<std::string, std::string> values = {
+    {"enabled", "true"}, {"mode", "linear"}, {"topic", ""}};
+  HardwareParameters parameters(values);
+  bool enabled = false;
+  bool missing = true;
+  int mode = 0;
+  EXPECT_TRUE(parameters.GetFlag("enabled", enabled));
+  EXPECT_TRUE(parameters.GetFlag("missing", missing));
+  EXPECT_TRUE(parameters.GetChoice("mode", mode, {{"hold", 0}, {"linear", 1}}));
+  EXPECT_TRUE(enabled);
+  EXPECT_TRUE(missing);
+  EXPECT_EQ(mode, 1);
+  EXPECT_EQ(parameters.String("topic", "joint_states"), "");
+  EXPECT_EQ(parameters.String("missing", "joint_states"), "joint_states");
+  EXPECT_TRUE(parameters.Ok());
+}
+
+TEST(HardwareParameters, RejectsUnknownFlagsAndChoices)
+{
+  const std::unordered_map<std::string, std::string> values = {
+    {"enabled", "yes"}, {"mode", "cubic"}};
+  HardwareParameters flags(values);
+  bool enabled = false;
+  EXPECT_FALSE(flags.GetFlag("enabled", enabled));
+  EXPECT_FALSE(enabled);
+  EXPECT_EQ(flags.Error(), "enabled must be 'true' or 'false'");
+  HardwareParameters choices(values);
+  int mode = 0;
+  EXPECT_FALSE(choices.GetChoice("mode", mode, {{"hold", 0}, {"linear", 1}, {"quadratic", 2}}));
+  EXPECT_EQ(mode, 0);
+  EXPECT_EQ(choices.Error(), "mode must be 'hold', 'linear' or 'quadratic'");
+}
+
+TEST(HardwareParameters, ConfiguresOnlyTheSetFeatures)
+{
+  std::string error;
+  std::unique_ptr<kuka_drivers_core::WireCapture> capture;
+  std::unique_ptr<kuka_drivers_core::FlightRecorder> recorder;
+  std::unique_ptr<kuka_drivers_core::FaultInjector> injector;
+  EXPECT_TRUE(kuka_drivers_core::ConfigureWireCapture({{"capture_file", ""}}, capture, error));
+  EXPECT_TRUE(kuka_drivers_core::ConfigureFlightRecorder({}, recorder, error));
+  EXPECT_TRUE(kuka_drivers_core::ConfigureFaultInjection({}, injector, error));
+  EXPECT_EQ(capture, nullptr);
+  EXPECT_EQ(recorder, nullptr);
+  EXPECT_EQ(injector, nullptr);
+
+  EXPECT_TRUE(
+    kuka_drivers_core::ConfigureFaultInjection({{"fault_profile", "loss=0.5"}}, injector, error));
+  EXPECT_NE(injector, nullptr);
+
+  // The sizes are checked before the files are created
+  EXPECT_FALSE(
+    kuka_drivers_core::ConfigureWireCapture(
+      {{"capture_file", "/nonexistent/capture"}, {"capture_slots", "0"}}, capture, error));
+  EXPECT_EQ(error, "capture_slots must be an integer of at least 1");
+  EXPECT_FALSE(
+    kuka_drivers_core::ConfigureFlightRecorder(
+      {{"flight_recorder_file", "/nonexistent/recorder"}, {"flight_recorder_cycles", "1k"}},
+      recorder, error));
+  EXPECT_EQ(capture, nullptr);
+  EXPECT_EQ(recorder, nullptr);
+}
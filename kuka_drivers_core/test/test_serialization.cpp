@@ -0,0 +1,202 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "communication_helpers/serialization.hpp"
+
+using kuka_drivers_core::BufferReader;
+using kuka_drivers_core::BufferWriter;
+using kuka_drivers_core::ByteOrder;
+
+namespace
+{
+// The integer paths are constexpr, so they are also checked at compile time
+constexpr std::uint32_t RoundTripUint32(std::uint32_t value, ByteOrder order)
+{
+  std::uint8_t buffer[4] = {};
+  BufferWriter writer(buffer, order);
+  writer.writeUint32(value);
+  BufferReader reader(buffer, sizeof(buffer), order);
+  std::uint32_t result = 0;
+  reader.readUint32(result);
+  return result;
+}
+
+constexpr std::int32_t RoundTripInt32(std::int32_t value, ByteOrder order)
+{
+  std::uint8_t buffer[4] = {};
+  BufferWriter writer(buffer, order);
+  writer.writeInt32(value);
+  BufferReader reader(buffer, sizeof(buffer), order);
+  std::int32_t result = 0;
+  reader.readInt32(result);
+  return result;
+}
+
+constexpr std::uint8_t FirstByte(std::uint16_t value, ByteOrder order)
+{
+  std::uint8_t buffer[2] = {};
+  BufferWriter writer(buffer, order);
+  writer.writeUint16(value);
+  return buffer[0];
+}
+
+constexpr bool OverflowFails()
+{
+  std::uint8_t buffer[3] = {};
+  BufferWriter writer(buffer);
+  return !writer.writeUint32(1) && !writer.ok() && writer.size() == 0;
+}
+
+static_assert(RoundTripUint32(0xDEADBEEF, ByteOrder::BIG) == 0xDEADBEEF, "big endian uint32");
+static_assert(RoundTripUint32(0xDEADBEEF, ByteOrder::LITTLE) == 0xDEADBEEF, "little endian uint32");
+static_assert(RoundTripInt32(-1, ByteOrder::BIG) == -1, "negative int32");
+static_assert(
+  RoundTripInt32(std::numeric_limits<std::int32_t>::min(), ByteOrder::LITTLE) ==
+  std::numeric_limits<std::int32_t>::min(), "minimal int32");
+static_assert(FirstByte(0x1234, ByteOrder::BIG) == 0x12, "big endian order");
+static_assert(FirstByte(0x1234, ByteOrder::LITTLE) == 0x34, "little endian order");
+static_assert(OverflowFails(), "overflowing write");
+
+class SerializationTest : public ::testing::TestWithParam<ByteOrder>
+{
+};
+}  // namespace
+
+TEST_P(SerializationTest, RoundTripsEveryType)
+{
+  std::uint8_t buffer[1 + 2 + 4 + 8 + 4 + 8 + 3] = {};
+  BufferWriter writer(buffer, GetParam());
+  const std::uint8_t bytes[3] = {1, 2, 3};
+  EXPECT_TRUE(writer.writeUint8(0xAB));
+  EXPECT_TRUE(writer.writeUint16(0xBEEF));
+  EXPECT_TRUE(writer.writeUint32(0xDEADBEEF));
+  EXPECT_TRUE(writer.writeUint64(0x0123456789ABCDEFULL));
+  EXPECT_TRUE(writer.writeInt32(-123456));
+  EXPECT_TRUE(writer.writeDouble(-0.7));
+  EXPECT_TRUE(writer.writeBytes(bytes, sizeof(bytes)));
+  EXPECT_TRUE(writer.ok());
+  EXPECT_EQ(writer.size(), sizeof(buffer));
+
+  BufferReader reader(buffer, sizeof(buffer), GetParam());
+  std::uint8_t u8 = 0;
+  std::uint16_t u16 = 0;
+  std::uint32_t u32 = 0;
+  std::uint64_t u64 = 0;
+  std::int32_t i32 = 0;
+  double d = 0;
+  EXPECT_TRUE(reader.readUint8(u8));
+  EXPECT_TRUE(reader.readUint16(u16));
+  EXPECT_TRUE(reader.readUint32(u32));
+  EXPECT_TRUE(reader.readUint64(u64));
+  EXPECT_TRUE(reader.readInt32(i32));
+  EXPECT_TRUE(reader.readDouble(d));
+  EXPECT_EQ(u8, 0xAB);
+  EXPECT_EQ(u16, 0xBEEF);
+  EXPECT_EQ(u32, 0xDEADBEEFu);
+  EXPECT_EQ(u64, 0x0123456789ABCDEFULL);
+  EXPECT_EQ(i32, -123456);
+  EXPECT_EQ(d, -0.7);
+  EXPECT_EQ(reader.remaining(), sizeof(bytes));
+  EXPECT_TRUE(reader.skip(sizeof(bytes)));
+  EXPECT_EQ(reader.remaining(), 0u);
+  EXPECT_TRUE(reader.ok());
+}
+
+TEST_P(SerializationTest, ReadsNegativeInt32)
+{
+  for (const std::int32_t value :
+    {-1, -2, -65536, std::numeric_limits<std::int32_t>::min(),
+      std::numeric_limits<std::int32_t>::max()})
+  {
+    std::uint8_t buffer[4] = {};
+    BufferWriter writer(buffer, GetParam());
+    ASSERT_TRUE(writer.writeInt32(value));
+    BufferReader reader(buffer, sizeof(buffer), GetParam());
+    std::int32_t result = 0;
+    ASSERT_TRUE(reader.readInt32(result));
+    EXPECT_EQ(result, value);
+  }
+}
+
+TEST_P(SerializationTest, OverflowingWriteFails)
+{
+  std::uint8_t buffer[6] = {};
+  BufferWriter writer(buffer, GetParam());
+  EXPECT_TRUE(writer.writeUint32(1));
+  EXPECT_FALSE(writer.writeUint32(2));
+  EXPECT_FALSE(writer.ok());
+  EXPECT_EQ(writer.size(), 4u);
+  // The writer stays failed even if the next value would fit
+  EXPECT_FALSE(writer.writeUint8(3));
+  EXPECT_EQ(writer.size(), 4u);
+  EXPECT_FALSE(writer.writeDouble(1.0));
+  EXPECT_FALSE(writer.writeBytes(buffer, 1));
+}
+
+TEST_P(SerializationTest, OverflowingReadFails)
+{
+  const std::uint8_t buffer[6] = {0, 0, 0, 1, 0, 2};
+  BufferReader reader(buffer, sizeof(buffer), GetParam());
+  std::uint32_t u32 = 0;
+  std::uint64_t u64 = 42;
+  EXPECT_TRUE(reader.readUint32(u32));
+  EXPECT_FALSE(reader.readUint64(u64));
+  EXPECT_EQ(u64, 42u);
+  EXPECT_FALSE(reader.ok());
+  // The reader stays failed even if the next value would fit
+  std::uint8_t u8 = 0;
+  EXPECT_FALSE(reader.readUint8(u8));
+  EXPECT_FALSE(reader.skip(1));
+  EXPECT_EQ(reader.position(), 4u);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+  ByteOrders, SerializationTest, ::testing::Values(ByteOrder::BIG, ByteOrder::LITTLE));
+
+TEST(Serialization, ByteOrderOfTheWire)
+{
+  std::uint8_t big[4] = {};
+  std::uint8_t little[4] = {};
+  BufferWriter(big, ByteOrder::BIG).writeUint32(0x01020304);
+  BufferWriter(little, ByteOrder::LITTLE).writeUint32(0x01020304);
+  EXPECT_EQ(std::vector<std::uint8_t>(big, big + 4), (std::vector<std::uint8_t>{1, 2, 3, 4}));
+  EXPECT_EQ(
+    std::vector<std::uint8_t>(little, little + 4), (std::vector<std::uint8_t>{4, 3, 2, 1}));
+}
+
+TEST(Serialization, VectorHelpers)
+{
+  std::vector<std::uint8_t> serialized;
+  EXPECT_EQ(kuka_drivers_core::serializeNext(-5, serialized), 4);
+  EXPECT_EQ(serialized, (std::vector<std::uint8_t>{0xFF, 0xFF, 0xFF, 0xFB}));
+  int integer = 0;
+  EXPECT_EQ(kuka_drivers_core::deserializeNext(serialized, integer), 4);
+  EXPECT_EQ(integer, -5);
+
+  serialized.clear();
+  EXPECT_EQ(kuka_drivers_core::serializeNext(2.5, serialized), 8);
+  double value = 0;
+  EXPECT_EQ(kuka_drivers_core::deserializeNext(serialized, value), 8);
+  EXPECT_EQ(value, 2.5);
+
+  serialized.resize(3);
+  EXPECT_EQ(kuka_drivers_core::deserializeNext(serialized, integer), 0);
+  EXPECT_EQ(kuka_drivers_core::deserializeNext(serialized, value), 0);
+}
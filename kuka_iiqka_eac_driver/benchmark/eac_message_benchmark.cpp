@@ -0,0 +1,132 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+#include "kuka_drivers_core/wire_capture.hpp"
+#include "kuka_iiqka_eac_driver/control_signal_encoder.hpp"
+#include "kuka_iiqka_eac_driver/motion_state_decoder.hpp"
+#include "nanopb-helpers/nanopb_serialization_helper.h"
+#include "nanopb/kuka/ecs/v1/motion_state_external.pb.hh"
+
+namespace
+{
+using kuka_drivers_core::WireCapture;
+
+constexpr std::size_t kJoints = 6;
+
+// Datagrams of a session with the mock controller in joint position control, recorded with the
+//   capture_file parameter
+std::vector<std::string> recordedPayloads(WireCapture::Direction direction)
+{
+  std::vector<std::string> payloads;
+  for (auto & datagram : WireCapture::ReadFile(TEST_DATA_DIR "/eac_session.wcap")) {
+    if (datagram.direction == direction) {
+      payloads.push_back(std::move(datagram.data));
+    }
+  }
+  return payloads;
+}
+
+const std::vector<std::string> & recordedMotionStates()
+{
+  static const auto requests = recordedPayloads(WireCapture::Direction::RECEIVED);
+  return requests;
+}
+
+const std::vector<nanopb::kuka::ecs::v1::ControlSignalExternal> & recordedControlSignals()
+{
+  static const auto replies = []() {
+      std::vector<nanopb::kuka::ecs::v1::ControlSignalExternal> messages;
+      for (const auto & payload : recordedPayloads(WireCapture::Direction::SENT)) {
+        nanopb::kuka::ecs::v1::ControlSignalExternal message;
+        if (nanopb::Decode(
+            reinterpret_cast<const uint8_t *>(payload.data()), payload.size(), message))
+        {
+          messages.push_back(message);
+        }
+      }
+      return messages;
+    }();
+  return replies;
+}
+
+#ifdef NON_MOCK_SETUP
+// nanopb::Decode of the motion state is not available in the mock setup
+void BM_DecodeNanopb(benchmark::State & state)
+{
+  const auto & requests = recordedMotionStates();
+  nanopb::kuka::ecs::v1::MotionStateExternal message;
+  std::size_t i = 0;
+  for (auto _ : state) {
+    const std::string & request = requests[i++ % requests.size()];
+    benchmark::DoNotOptimize(
+      nanopb::Decode(
+        reinterpret_cast<const uint8_t *>(request.data()), request.size(), message));
+  }
+}
+BENCHMARK(BM_DecodeNanopb);
+#endif
+
+void BM_DecodeSinglePass(benchmark::State & state, bool velocities)
+{
+  const auto & requests = recordedMotionStates();
+  double positions[kJoints];
+  double torques[kJoints];
+  double measured_velocities[kJoints];
+  kuka_eac::MotionStateDecoder::Output output{
+    positions, torques, velocities ? measured_velocities : nullptr, kJoints, 0, false, false,
+    false, false};
+  std::size_t i = 0;
+  for (auto _ : state) {
+    const std::string & request = requests[i++ % requests.size()];
+    benchmark::DoNotOptimize(
+      kuka_eac::MotionStateDecoder::Decode(
+        reinterpret_cast<const uint8_t *>(request.data()), request.size(), output));
+  }
+}
+BENCHMARK_CAPTURE(BM_DecodeSinglePass, positions_and_torques, false);
+BENCHMARK_CAPTURE(BM_DecodeSinglePass, with_velocities, true);
+
+void BM_EncodeNanopb(benchmark::State & state)
+{
+  const auto & replies = recordedControlSignals();
+  uint8_t buffer[1500];
+  std::size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+      nanopb::Encode(replies[i++ % replies.size()], buffer, sizeof(buffer)));
+  }
+}
+BENCHMARK(BM_EncodeNanopb);
+
+void BM_EncodePatched(benchmark::State & state)
+{
+  const auto & replies = recordedControlSignals();
+  uint8_t buffer[1500];
+  kuka_eac::ControlSignalEncoder encoder;
+  std::size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+      encoder.Encode(replies[i++ % replies.size()], buffer, sizeof(buffer)));
+  }
+  state.SetLabel(encoder.IsPatching() ? "patched in place" : "encoded with nanopb");
+}
+BENCHMARK(BM_EncodePatched);
+}  // namespace
+
+BENCHMARK_MAIN();
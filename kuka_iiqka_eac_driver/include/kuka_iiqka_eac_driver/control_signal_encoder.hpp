@@ -0,0 +1,285 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_IIQKA_EAC_DRIVER__CONTROL_SIGNAL_ENCODER_HPP_
+#define KUKA_IIQKA_EAC_DRIVER__CONTROL_SIGNAL_ENCODER_HPP_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <vector>
+
+#include "nanopb-helpers/nanopb_serialization_helper.h"
+#include "nanopb/kuka/ecs/v1/control_signal_external.pb.hh"
+
+namespace kuka_eac
+{
+/**
+ * @brief Encoder of the ControlSignalExternal replies that patches a pre-encoded message.
+ *
+ * Between control mode switches only the IPOC and the command values of the reply change, so
+ * the message is encoded with nanopb only if its layout (the present fields, the value counts
+ * and the length of the IPOC varint) changes. The offsets of the values are found by encoding
+ * the message once with marker values, afterwards the values are copied in place.
+ * If the offsets cannot be found, every message is encoded with nanopb.
+ *
+ * Present double fields are always kept in the template, even if proto3 would omit them for
+ * a zero value, which is decoded to the same message.
+ */
+class ControlSignalEncoder
+{
+public:
+  using Message = nanopb::kuka::ecs::v1::ControlSignalExternal;
+
+  /**
+   * @brief Encode the message into the buffer, which must be kept unchanged between the calls
+   * @returns the encoded size or -1 if encoding failed
+   */
+  int Encode(const Message & message, uint8_t * buffer, std::size_t size)
+  {
+    // An IPOC of 0 is omitted in proto3 and 1 cannot be located, see BuildTemplate()
+    if (message.has_header && message.header.ipoc <= 1) {
+      return nanopb::Encode<Message>(message, buffer, size);
+    }
+    const Layout layout = GetLayout(message);
+    if (state_ == State::NONE || buffer != buffer_ || size != size_ || !(layout == layout_)) {
+      state_ = BuildTemplate(message, layout, buffer, size) ? State::TEMPLATE : State::FALLBACK;
+      ++template_builds_;
+    }
+    if (state_ == State::FALLBACK) {
+      return nanopb::Encode<Message>(message, buffer, size);
+    }
+
+    if (ipoc_size_ > 0) {
+      WriteVarint(message.header.ipoc, buffer_ + ipoc_offset_);
+    }
+    std::size_t index = 0;
+    ForEachValue(
+      message, [this, &index](const double & value) {
+        std::memcpy(buffer_ + value_offsets_[index++], &value, sizeof(value));
+      });
+    return encoded_size_;
+  }
+
+  // Forces a full encoding of the next message
+  void Reset() {state_ = State::NONE;}
+
+  // Number of layouts encoded so far, which should only grow on layout changes
+  std::size_t TemplateBuilds() const {return template_builds_;}
+
+  // Whether the current layout is patched in place or encoded with nanopb in every cycle
+  bool IsPatching() const {return state_ == State::TEMPLATE;}
+
+private:
+  // Everything that changes the positions of the values in the encoded message
+  struct Layout
+  {
+    bool has_header;
+    uint32_t message_id;
+    std::size_t ipoc_size;
+    bool has_control_signal;
+    bool stop_ipo;
+    int control_mode;
+    std::array<bool, 12> has_fields;
+    std::array<pb_size_t, 10> counts;
+
+    bool operator==(const Layout & other) const
+    {
+      return std::tie(
+        has_header, message_id, ipoc_size, has_control_signal, stop_ipo, control_mode,
+        has_fields, counts) == std::tie(
+        other.has_header, other.message_id, other.ipoc_size, other.has_control_signal,
+        other.stop_ipo, other.control_mode, other.has_fields, other.counts);
+    }
+  };
+
+  static Layout GetLayout(const Message & message)
+  {
+    const auto & signal = message.control_signal;
+    const auto & attributes = signal.cartesian_attributes;
+    return Layout{
+      message.has_header, message.header.message_id, VarintSize(message.header.ipoc),
+      message.has_control_signal, signal.stop_ipo, static_cast<int>(signal.control_mode),
+      {signal.has_joint_command, signal.has_cartesian_command, signal.has_joint_velocity_command,
+        signal.has_twist_command, signal.has_joint_torque_command, signal.has_wrench_command,
+        signal.has_joint_attributes, signal.has_cartesian_attributes,
+        signal.cartesian_command.has_translation, signal.cartesian_command.has_rotation,
+        signal.twist_command.has_linear, signal.twist_command.has_angular},
+      {signal.joint_command.values_count, signal.joint_velocity_command.values_count,
+        signal.joint_torque_command.values_count, signal.wrench_command.values_count,
+        signal.joint_attributes.stiffness_count, signal.joint_attributes.damping_count,
+        attributes.stiffness_count, attributes.damping_count,
+        attributes.nullspace_stiffness_count, attributes.nullspace_damping_count}};
+  }
+
+  // Calls the function with every double of the present fields, in a fixed order
+  template<typename MessageType, typename Function>
+  static void ForEachValue(MessageType & message, Function function)
+  {
+    if (!message.has_control_signal) {
+      return;
+    }
+    auto & signal = message.control_signal;
+    auto each = [&function](auto * values, pb_size_t count) {
+        std::for_each(values, values + count, function);
+      };
+    if (signal.has_joint_command) {
+      each(signal.joint_command.values, signal.joint_command.values_count);
+    }
+    if (signal.has_cartesian_command) {
+      auto & pose = signal.cartesian_command;
+      if (pose.has_translation) {
+        function(pose.translation.x);
+        function(pose.translation.y);
+        function(pose.translation.z);
+      }
+      if (pose.has_rotation) {
+        function(pose.rotation.qx);
+        function(pose.rotation.qy);
+        function(pose.rotation.qz);
+        function(pose.rotation.qw);
+      }
+    }
+    if (signal.has_joint_velocity_command) {
+      each(signal.joint_velocity_command.values, signal.joint_velocity_command.values_count);
+    }
+    if (signal.has_twist_command) {
+      auto & twist = signal.twist_command;
+      if (twist.has_linear) {
+        function(twist.linear.x);
+        function(twist.linear.y);
+        function(twist.linear.z);
+      }
+      if (twist.has_angular) {
+        function(twist.angular.x);
+        function(twist.angular.y);
+        function(twist.angular.z);
+      }
+    }
+    if (signal.has_joint_torque_command) {
+      each(signal.joint_torque_command.values, signal.joint_torque_command.values_count);
+    }
+    if (signal.has_wrench_command) {
+      each(signal.wrench_command.values, signal.wrench_command.values_count);
+    }
+    if (signal.has_joint_attributes) {
+      auto & attributes = signal.joint_attributes;
+      each(attributes.stiffness, attributes.stiffness_count);
+      each(attributes.damping, attributes.damping_count);
+    }
+    if (signal.has_cartesian_attributes) {
+      auto & attributes = signal.cartesian_attributes;
+      each(attributes.stiffness, attributes.stiffness_count);
+      each(attributes.damping, attributes.damping_count);
+      each(attributes.nullspace_stiffness, attributes.nullspace_stiffness_count);
+      each(attributes.nullspace_damping, attributes.nullspace_damping_count);
+    }
+  }
+
+  bool BuildTemplate(
+    const Message & message, const Layout & layout, uint8_t * buffer, std::size_t size)
+  {
+    buffer_ = buffer;
+    size_ = size;
+    layout_ = layout;
+    value_offsets_.clear();
+    probe_buffer_.resize(size);
+
+    // Quiet NaNs with the index as payload, which are never omitted and unlikely in a message
+    scratch_ = message;
+    uint64_t marker = kMarkerBase;
+    ForEachValue(
+      scratch_, [&marker](double & value) {
+        std::memcpy(&value, &marker, sizeof(value));
+        ++marker;
+      });
+    encoded_size_ = nanopb::Encode<Message>(scratch_, buffer_, size_);
+    if (encoded_size_ < 0) {
+      return false;
+    }
+    for (uint64_t searched = kMarkerBase; searched != marker; ++searched) {
+      uint8_t bytes[sizeof(double)];
+      std::memcpy(bytes, &searched, sizeof(bytes));
+      const uint8_t * found = std::search(
+        buffer_, buffer_ + encoded_size_, bytes, bytes + sizeof(bytes));
+      if (found == buffer_ + encoded_size_) {
+        return false;
+      }
+      value_offsets_.push_back(found - buffer_);
+    }
+
+    // The IPOC is found by encoding it with its lowest bit flipped, which keeps its length
+    ipoc_size_ = 0;
+    if (message.has_header) {
+      scratch_.header.ipoc ^= 1;
+      if (nanopb::Encode<Message>(scratch_, probe_buffer_.data(), size_) != encoded_size_) {
+        return false;
+      }
+      const auto mismatch = std::mismatch(buffer_, buffer_ + encoded_size_, probe_buffer_.data());
+      if (mismatch.first == buffer_ + encoded_size_) {
+        return false;
+      }
+      ipoc_offset_ = mismatch.first - buffer_;
+      ipoc_size_ = layout.ipoc_size;
+    }
+    return true;
+  }
+
+  static std::size_t VarintSize(uint64_t value)
+  {
+    std::size_t size = 1;
+    while (value >= 0x80) {
+      value >>= 7;
+      ++size;
+    }
+    return size;
+  }
+
+  static void WriteVarint(uint64_t value, uint8_t * it)
+  {
+    while (value >= 0x80) {
+      *it++ = static_cast<uint8_t>(value | 0x80);
+      value >>= 7;
+    }
+    *it = static_cast<uint8_t>(value);
+  }
+
+  static constexpr uint64_t kMarkerBase = 0x7FF8C0DE00000000;
+
+  enum class State
+  {
+    NONE,
+    TEMPLATE,
+    FALLBACK
+  };
+
+  State state_ = State::NONE;
+  std::size_t template_builds_ = 0;
+  uint8_t * buffer_ = nullptr;
+  std::size_t size_ = 0;
+  Layout layout_{};
+  int encoded_size_ = -1;
+  std::size_t ipoc_offset_ = 0;
+  std::size_t ipoc_size_ = 0;
+  std::vector<std::size_t> value_offsets_;
+  // Only used to build the template
+  Message scratch_{};
+  std::vector<uint8_t> probe_buffer_;
+};
+}  // namespace kuka_eac
+
+#endif  // KUKA_IIQKA_EAC_DRIVER__CONTROL_SIGNAL_ENCODER_HPP_
@@ -0,0 +1,214 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_IIQKA_EAC_DRIVER__CYCLE_MONITOR_HPP_
+#define KUKA_IIQKA_EAC_DRIVER__CYCLE_MONITOR_HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace kuka_eac
+{
+/**
+ * @brief Measures the cycle of the controller requests and tracks the packet losses
+ *  against the QoS profile configured on the controller.
+ *
+ * Missed cycles are detected from IPOC gaps, late requests from arrival intervals longer
+ * than the receive timeout. Both are counted as losses, as the controller does not get an
+ * answer in time for them. The receive timeout is derived from the measured cycle.
+ * The counters are stored as doubles, so that they can be exported as state interfaces.
+ */
+class CycleMonitor
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Statistics
+  {
+    double missed_cycles = 0;        // Cycles skipped based on the nominal IPOC increment
+    double late_packets = 0;         // Requests arriving after the receive timeout
+    double duplicate_packets = 0;    // Requests with the same IPOC as the previous one
+    double measured_cycle_time = 0;  // Smoothed request interval in seconds
+  };
+
+  enum class Result
+  {
+    OK,
+    DUPLICATE,
+    OUT_OF_ORDER
+  };
+
+  // Timeout until the first request of a session arrives
+  static constexpr std::chrono::milliseconds kFirstRequestTimeout{100};
+  // Receive timeout relative to the measured cycle
+  static constexpr double kTimeoutFactor = 1.5;
+
+  /**
+   * @param consequent_lost_packets: losses in a row the controller tolerates
+   * @param lost_packets_in_timeframe: losses the controller tolerates within the timeframe
+   * @param timeframe: length of the QoS timeframe
+   */
+  CycleMonitor(
+    int consequent_lost_packets, int lost_packets_in_timeframe,
+    std::chrono::milliseconds timeframe)
+  : consequent_limit_(consequent_lost_packets),
+    timeframe_limit_(lost_packets_in_timeframe),
+    timeframe_(timeframe),
+    losses_(static_cast<std::size_t>(std::max(lost_packets_in_timeframe, 1)))
+  {}
+
+  CycleMonitor()
+  : CycleMonitor(1, 1, std::chrono::milliseconds(1000)) {}
+
+  /**
+   * @brief Start a new session, the counters are kept, the cycle is measured again
+   */
+  void Reset()
+  {
+    has_request_ = false;
+    nominal_delta_ = 0;
+    cycle_ = Clock::duration::zero();
+    consequent_losses_ = 0;
+    loss_count_ = 0;
+    warning_due_ = false;
+  }
+
+  /**
+   * @brief Update the statistics with a received request
+   * @returns DUPLICATE or OUT_OF_ORDER if the request is not newer than the previous one
+   */
+  Result OnRequest(uint32_t ipoc, Clock::time_point arrival)
+  {
+    if (!has_request_) {
+      has_request_ = true;
+      last_ipoc_ = ipoc;
+      last_arrival_ = arrival;
+      return Result::OK;
+    }
+    if (ipoc == last_ipoc_) {
+      statistics_.duplicate_packets++;
+      return Result::DUPLICATE;
+    }
+    if (ipoc < last_ipoc_) {
+      return Result::OUT_OF_ORDER;
+    }
+
+    const uint32_t delta = ipoc - last_ipoc_;
+    const auto interval = arrival - last_arrival_;
+    last_ipoc_ = ipoc;
+    last_arrival_ = arrival;
+
+    if (nominal_delta_ == 0 || delta < nominal_delta_) {
+      nominal_delta_ = delta;
+    }
+    const uint32_t cycles = delta / nominal_delta_;
+    if (cycles > 1) {
+      statistics_.missed_cycles += cycles - 1;
+      for (uint32_t i = 1; i < cycles; ++i) {
+        RecordLoss(arrival);
+      }
+    } else if (cycle_ != Clock::duration::zero() && interval > Timeout()) {
+      statistics_.late_packets++;
+      RecordLoss(arrival);
+    } else {
+      consequent_losses_ = 0;
+    }
+
+    // Exponential smoothing of the interval of one cycle, gaps are spread over the cycles
+    const auto cycle_interval = interval / static_cast<int>(std::max<uint32_t>(cycles, 1));
+    cycle_ = cycle_ == Clock::duration::zero() ? cycle_interval :
+      cycle_ + (cycle_interval - cycle_) / 16;
+    statistics_.measured_cycle_time = std::chrono::duration<double>(cycle_).count();
+    return Result::OK;
+  }
+
+  /**
+   * @brief Timeout for receiving the next request
+   * @param fallback: timeout used until the cycle is measured
+   */
+  std::chrono::microseconds ReceiveTimeout(std::chrono::microseconds fallback) const
+  {
+    if (!has_request_) {
+      return kFirstRequestTimeout;
+    }
+    if (cycle_ == Clock::duration::zero()) {
+      return fallback;
+    }
+    return std::chrono::duration_cast<std::chrono::microseconds>(Timeout());
+  }
+
+  /**
+   * @brief Returns true once after a loss, which leaves the QoS profile without reserve:
+   *  the next loss would make the controller abort external control
+   */
+  bool TakeWarning()
+  {
+    const bool warning_due = warning_due_;
+    warning_due_ = false;
+    return warning_due;
+  }
+
+  int ConsequentLosses() const {return consequent_losses_;}
+  int LossesInTimeframe(Clock::time_point now) const
+  {
+    const std::size_t stored = std::min<std::size_t>(loss_count_, losses_.size());
+    int count = 0;
+    for (std::size_t i = 0; i < stored; ++i) {
+      if (now - losses_[i] < timeframe_) {
+        count++;
+      }
+    }
+    return count;
+  }
+
+  Statistics & statistics() {return statistics_;}
+
+private:
+  Clock::duration Timeout() const
+  {
+    return std::chrono::duration_cast<Clock::duration>(cycle_ * kTimeoutFactor);
+  }
+
+  void RecordLoss(Clock::time_point time)
+  {
+    consequent_losses_++;
+    // Only the last timeframe_limit_ losses are relevant for the timeframe check
+    losses_[loss_count_ % losses_.size()] = time;
+    loss_count_++;
+    if (consequent_losses_ >= consequent_limit_ || LossesInTimeframe(time) >= timeframe_limit_) {
+      warning_due_ = true;
+    }
+  }
+
+  int consequent_limit_;
+  int timeframe_limit_;
+  Clock::duration timeframe_;
+
+  bool has_request_ = false;
+  uint32_t last_ipoc_ = 0;
+  uint32_t nominal_delta_ = 0;
+  Clock::time_point last_arrival_;
+  Clock::duration cycle_ = Clock::duration::zero();
+
+  int consequent_losses_ = 0;
+  std::vector<Clock::time_point> losses_;
+  std::size_t loss_count_ = 0;
+  bool warning_due_ = false;
+  Statistics statistics_;
+};
+}  // namespace kuka_eac
+
+#endif  // KUKA_IIQKA_EAC_DRIVER__CYCLE_MONITOR_HPP_
@@ -0,0 +1,56 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_IIQKA_EAC_DRIVER__CYCLE_TIME_HPP_
+#define KUKA_IIQKA_EAC_DRIVER__CYCLE_TIME_HPP_
+
+namespace kuka_eac
+{
+// Cycle time of external control in milliseconds if not configured
+static constexpr int DEFAULT_CYCLE_TIME_MS = 4;
+
+/**
+ * @brief Checks whether the external control cycle can be requested from the controller
+ */
+inline bool IsCycleTimeSupported(int cycle_time_ms)
+{
+  return cycle_time_ms == 1 || cycle_time_ms == 2 || cycle_time_ms == 4;
+}
+
+/**
+ * @brief Checks whether the control mode can be run with the given cycle time,
+ *  Cartesian impedance control is not implemented
+ *  (values of kuka::motion::external::ExternalControlMode)
+ */
+inline bool IsCycleTimeSupported(int cycle_time_ms, int control_mode)
+{
+  if (!IsCycleTimeSupported(cycle_time_ms)) {
+    return false;
+  }
+  switch (control_mode) {
+    case 1:  // JOINT_POSITION_CONTROL
+    case 2:  // JOINT_IMPEDANCE_CONTROL
+    case 3:  // JOINT_VELOCITY_CONTROL
+    case 4:  // JOINT_TORQUE_CONTROL
+    case 5:  // CARTESIAN_POSITION_CONTROL
+    case 7:  // CARTESIAN_VELOCITY_CONTROL
+    case 8:  // WRENCH_CONTROL
+      return true;
+    default:
+      return false;
+  }
+}
+}  // namespace kuka_eac
+
+#endif  // KUKA_IIQKA_EAC_DRIVER__CYCLE_TIME_HPP_
@@ -15,11 +15,14 @@
 #ifndef KUKA_IIQKA_EAC_DRIVER__HARDWARE_INTERFACE_HPP_
 #define KUKA_IIQKA_EAC_DRIVER__HARDWARE_INTERFACE_HPP_
 
+#include <array>
+#include <atomic>
 #include <vector>
 #include <string>
 #include <memory>
 #include <chrono>
 #include <cmath>
+#include <condition_variable>
 #include <mutex>
 #include <thread>
 
@@ -28,13 +31,39 @@
 #include "rclcpp_lifecycle/state.hpp"
 #include "pluginlib/class_list_macros.hpp"
 #include "hardware_interface/system_interface.hpp"
+#include "kuka_drivers_core/clock_sync.hpp"
+#include "kuka_drivers_core/command_filter.hpp"
+#include "kuka_drivers_core/activity_monitor.hpp"
+#include "kuka_drivers_core/command_interpolator.hpp"
+#include "kuka_drivers_core/cycle_coordinator.hpp"
+#include "kuka_drivers_core/fault_injection.hpp"
+#include "kuka_drivers_core/flight_recorder.hpp"
+#include "kuka_drivers_core/interface_storage.hpp"
+#include "kuka_drivers_core/io_thread.hpp"
+#include "kuka_drivers_core/joint_state_publisher.hpp"
+#include "kuka_drivers_core/link_diagnostics.hpp"
+#include "kuka_drivers_core/metrics_exporter.hpp"
+#include "kuka_drivers_core/rt_log.hpp"
+#include "kuka_drivers_core/rt_log_drain.hpp"
+#include "kuka_drivers_core/spsc_queue.hpp"
+#include "kuka_drivers_core/startup_profile.hpp"
+#include "kuka_drivers_core/state_batch_publisher.hpp"
+#include "kuka_drivers_core/state_channel.hpp"
+#include "kuka_drivers_core/tracing.hpp"
+#include "kuka_drivers_core/tuning_parameters.hpp"
+#include "kuka_drivers_core/triple_buffer.hpp"
+#include "kuka_drivers_core/udp_transport.hpp"
+#include "kuka_drivers_core/wire_capture.hpp"
 
+#include "grpcpp/channel.h"
 #include "kuka/ecs/v1/motion_services_ecs.grpc.pb.h"
 #include "nanopb/kuka/core/motion/joint.pb.hh"
 #include "nanopb/kuka/ecs/v1/control_signal_external.pb.hh"
-#include "nanopb/kuka/ecs/v1/motion_state_external.pb.hh"
-#include "os-core-udp-communication/replier.h"
 
+#include "kuka_iiqka_eac_driver/control_signal_encoder.hpp"
+#include "kuka_iiqka_eac_driver/cycle_monitor.hpp"
+#include "kuka_iiqka_eac_driver/cycle_time.hpp"
+#include "kuka_iiqka_eac_driver/motion_state_decoder.hpp"
 #include "kuka_iiqka_eac_driver/visibility_control.h"
 
 using hardware_interface::return_type;
@@ -48,6 +77,8 @@ class KukaEACHardwareInterface : public hardware_interface::SystemInterface
 public:
   RCLCPP_SHARED_PTR_DEFINITIONS(KukaEACHardwareInterface)
 
+  KUKA_IIQKA_EAC_DRIVER_PUBLIC ~KukaEACHardwareInterface();
+
   KUKA_IIQKA_EAC_DRIVER_PUBLIC CallbackReturn on_init(const hardware_interface::HardwareInfo & info)
   override;
 
@@ -60,6 +91,9 @@ public:
   KUKA_IIQKA_EAC_DRIVER_PUBLIC CallbackReturn on_configure(
     const rclcpp_lifecycle::State & previous_state) override;
 
+  KUKA_IIQKA_EAC_DRIVER_PUBLIC CallbackReturn on_cleanup(
+    const rclcpp_lifecycle::State & previous_state) override;
+
   KUKA_IIQKA_EAC_DRIVER_PUBLIC CallbackReturn on_activate(
     const rclcpp_lifecycle::State & previous_state) override;
 
@@ -74,39 +108,262 @@ public:
     const rclcpp::Time & time,
     const rclcpp::Duration & period) override;
 
+  KUKA_IIQKA_EAC_DRIVER_PUBLIC return_type perform_command_mode_switch(
+    const std::vector<std::string> & start_interfaces,
+    const std::vector<std::string> & stop_interfaces) override;
+
 private:
   KUKA_IIQKA_EAC_DRIVER_LOCAL void ObserveControl();
+  // Opens the observe stream if it is not open, it is kept open until cleanup
+  KUKA_IIQKA_EAC_DRIVER_LOCAL void StartObserveControl();
+  KUKA_IIQKA_EAC_DRIVER_LOCAL void StopObserveControl();
+  // Keeps the gRPC channel connected in the background and tracks its state
+  KUKA_IIQKA_EAC_DRIVER_LOCAL void StartChannelMonitor();
+  KUKA_IIQKA_EAC_DRIVER_LOCAL void StopChannelMonitor();
+  // Selects the fields of the reply that are needed in the given control mode
+  KUKA_IIQKA_EAC_DRIVER_LOCAL void SetEncodingProfile(
+    kuka_motion_external_ExternalControlMode mode);
+  // Requests external control in the given mode, blocks until the deadline of the call
+  KUKA_IIQKA_EAC_DRIVER_LOCAL bool OpenControlChannel(int control_mode);
+  // Starts re-opening the control channel after an error event, if enabled and within budget
+  KUKA_IIQKA_EAC_DRIVER_LOCAL void StartRecovery();
+  // Runs on recovery_thread_, ends at the first successful attempt or at deactivation
+  KUKA_IIQKA_EAC_DRIVER_LOCAL void RecoverControl();
+  KUKA_IIQKA_EAC_DRIVER_LOCAL void StopRecovery();
+  // Creates the gRPC channel to the controller and starts connecting
+  KUKA_IIQKA_EAC_DRIVER_LOCAL void CreateChannel();
+  // Allocates the joint interfaces and points the messages to them
+  KUKA_IIQKA_EAC_DRIVER_LOCAL void AllocateInterfaces(const std::vector<std::string> & joint_names);
+  // Adds the counters and histograms of the driver, if the metrics are exported
+  KUKA_IIQKA_EAC_DRIVER_LOCAL void RegisterMetrics();
+  // Sets the command interface of the given name to the latest state, velocities to zero
+  KUKA_IIQKA_EAC_DRIVER_LOCAL void SeedCommand(const std::string & name);
+  // Writes the record of the failed cycle before the exception ends the control loop
+  KUKA_IIQKA_EAC_DRIVER_LOCAL void RecordFailure();
+  // Takes over the request decoded into motion_state_, inline or from the I/O thread
+  KUKA_IIQKA_EAC_DRIVER_LOCAL void OnRequest(
+    CycleMonitor::Clock::time_point arrival, std::chrono::steady_clock::time_point timestamp);
+  // Runs on io_thread_: receives and decodes the next request and answers it
+  KUKA_IIQKA_EAC_DRIVER_LOCAL bool ExchangeOnIOThread();
+
+  // Events of the external control service handed over to the control loop
+  enum class ControlEvent
+  {
+    SAMPLING,
+    CONTROL_MODE_SWITCH,
+    STOPPED,
+    ERROR
+  };
+  KUKA_IIQKA_EAC_DRIVER_LOCAL void HandleControlEvents();
+  KUKA_IIQKA_EAC_DRIVER_LOCAL void PublishControlEvent(ControlEvent event);
+
+  // Written by the observer thread, read by the control loop and on_deactivate()
+  std::atomic<bool> is_active_{false};
+  // Set by on_deactivate(), applied by the control loop in the next reply
+  std::atomic<bool> stop_requested_{false};
+
+  // Optional re-opening of the control channel after the controller stopped it with an error,
+  //  e.g. because the packet losses exceeded the QoS profile
+  int control_recovery_attempts_ = 0;
+  std::chrono::milliseconds control_recovery_delay_{1000};
+  // Recovered errors per activation, the driver has to be reactivated afterwards
+  int max_control_recoveries_ = 3;
+  int recoveries_in_activation_ = 0;
+  std::thread recovery_thread_;
+  std::atomic<bool> recovery_running_{false};
+  // Set while the channel is re-opened, cleared by the first request of the new session
+  std::atomic<bool> recovering_{false};
+  std::atomic<std::chrono::steady_clock::time_point> recovery_start_{};
+  // State interfaces: recovered errors since start and the duration of the last recovery in s
+  double control_recoveries_ = 0;
+  double recovery_time_ = 0;
+  kuka_drivers_core::SPSCQueue<ControlEvent, 16> control_events_;
+  std::mutex observe_mutex_;
+  std::condition_variable observe_cv_;
 
-  bool is_active_ = false;
   bool msg_received_ = false;
+  // Mock setup only: exchange the messages with the mock controller instead of skipping them
+  bool mock_loopback_ = false;
+
+  // The joint states and commands in one block, the members below are views into it
+  kuka_drivers_core::InterfaceStorage joint_storage_;
+  using JointValues = kuka_drivers_core::InterfaceStorage::Values;
 
-  std::vector<double> hw_position_commands_;
-  std::vector<double> hw_torque_commands_;
-  std::vector<double> hw_stiffness_commands_;
-  std::vector<double> hw_damping_commands_;
+  JointValues hw_position_commands_;
+  JointValues hw_velocity_commands_;
+  JointValues hw_torque_commands_;
+  JointValues hw_stiffness_commands_;
+  JointValues hw_damping_commands_;
+  // Pose as x, y, z, A, B, C, twist and wrench with the linear part first
+  std::array<double, 6> hw_cartesian_commands_{};
+  std::array<double, 6> hw_twist_commands_{};
+  std::array<double, 6> hw_wrench_commands_{};
 
-  std::vector<double> hw_position_states_;
-  std::vector<double> hw_torque_states_;
+  JointValues hw_position_states_;
+  JointValues hw_torque_states_;
+  // Only exported and decoded for the joints with a velocity state interface in the URDF
+  JointValues hw_velocity_states_;
 
   double hw_control_mode_command_;
+  // Control mode of the hardware parameters, requested again by a recovery before the first reply
+  int configured_control_mode_ = 0;
+  // Control mode the fields of control_signal_ext_ are set up for, -1 before the first reply
+  std::atomic<int> encoded_control_mode_{-1};
+  // Changes of the control mode wait for the controller switch, if control_mode_handover is set
+  static constexpr std::chrono::milliseconds kHandoverTimeout{500};
+  bool control_mode_handover_ = false;
+  std::size_t handover_window_ = 1;
+  // Cycles since the requested mode differs from the encoded one, or since the last switch
+  std::size_t staged_cycles_ = 0;
+  std::size_t switched_cycles_left_ = 0;
 
 #ifdef NON_MOCK_SETUP
-  kuka::ecs::v1::CommandState command_state_;
+  // Created in on_init(), so that the connection is set up until the first call
+  std::shared_ptr<grpc::Channel> channel_;
   std::unique_ptr<kuka::ecs::v1::ExternalControlService::Stub> stub_;
   std::unique_ptr<grpc::ClientContext> context_;
+  std::thread channel_monitor_thread_;
+  std::mutex channel_monitor_mutex_;
+  std::condition_variable channel_monitor_cv_;
+  bool channel_monitor_stop_ = false;
 #endif
+  // Deadline of the unary gRPC calls
+  std::chrono::milliseconds grpc_deadline_{3000};
+  // Interval of the HTTP/2 pings on the channel, 0 disables them
+  std::chrono::milliseconds grpc_keepalive_{0};
+  // Interval of the checks of the channel state, also the longest reconnect backoff
+  std::chrono::milliseconds grpc_probe_period_{1000};
+  // Written by the channel monitor, exported as eac_state/grpc_connected by read()
+  std::atomic<bool> channel_connected_{false};
+  double grpc_connected_ = 0;
 
   std::thread observe_thread_;
+  // Cleared by the observer thread if the stream is closed by the controller
+  std::atomic<bool> observe_stream_open_{false};
+
+  std::chrono::microseconds receive_timeout_ {CycleMonitor::kFirstRequestTimeout};
+  // External control cycle requested from the controller
+  std::chrono::milliseconds cycle_time_ {DEFAULT_CYCLE_TIME_MS};
+  // Receive timeout until the cycle of the controller is measured, derived from cycle_time_
+  std::chrono::microseconds fallback_timeout_ {6000};
+  // QoS profile of the hardware parameters, sent in on_configure()
+  int consequent_lost_packets_ = 1;
+  int lost_packets_in_timeframe_ = 1;
+  std::chrono::milliseconds qos_timeframe_{1000};
+  CycleMonitor cycle_monitor_;
+  // Send time of the requests on the host clock, estimated from the IPOC
+  kuka_drivers_core::ClockSync clock_sync_;
+  double state_stamp_ = 0;
+  double one_way_latency_ = 0;
+  // Declared before the transport, which records into it until it is destroyed
+  std::unique_ptr<kuka_drivers_core::WireCapture> wire_capture_;
+  // Optional network faults of the fault_profile parameter, applied by the transport
+  std::unique_ptr<kuka_drivers_core::FaultInjector> fault_injector_;
+  kuka_drivers_core::UdpTransport udp_transport_;
+  // Optional per-cycle record of the states and commands, see flight_recorder_dump
+  std::unique_ptr<kuka_drivers_core::FlightRecorder> flight_recorder_;
+  // Driver specific flag of the flight recorder
+  static constexpr uint32_t IPO_STOPPED = kuka_drivers_core::FlightRecorder::DRIVER;
+  // Optional shared memory copy of the latest state for other processes, see state_channel_echo
+  std::unique_ptr<kuka_drivers_core::StateChannel> state_channel_;
+  // Optional decimated joint states, published by a separate thread
+  std::unique_ptr<kuka_drivers_core::JointStatePublisher> joint_state_publisher_;
+  // Optional batches of all states, published by a separate thread
+  std::unique_ptr<kuka_drivers_core::StateBatchPublisher> state_batch_publisher_;
+  // Driver specific flag of the state batches
+  static constexpr uint32_t BATCH_IPO_STOPPED =
+    kuka_driver_interfaces::msg::JointStateBatch::DRIVER;
+  // Optional rate of the missed and late requests on /diagnostics, against the QoS profile
+  std::unique_ptr<kuka_drivers_core::LinkDiagnostics> link_diagnostics_;
+  // Optional counters and latencies of the loop for Prometheus, if metrics_port is set
+  std::unique_ptr<kuka_drivers_core::MetricsExporter::Group> metrics_group_;
+  struct Metrics
+  {
+    kuka_drivers_core::MetricsExporter::Counter * missed_requests = nullptr;
+    kuka_drivers_core::MetricsExporter::Counter * late_requests = nullptr;
+    kuka_drivers_core::MetricsExporter::Counter * decode_failures = nullptr;
+    kuka_drivers_core::MetricsExporter::Histogram * one_way_latency = nullptr;
+    kuka_drivers_core::MetricsExporter::Histogram * reply_latency = nullptr;
+  } metrics_;
+  // Arrival of the last request, the reply latency is measured from it
+  CycleMonitor::Clock::time_point request_arrival_;
+  // Filters of the joint position commands, configured by the command_* hardware parameters
+  kuka_drivers_core::JointCommandFilter command_filter_;
+  // Initial joint stiffness and damping commands, also the defaults of the tuning parameters
+  static constexpr double DEFAULT_STIFFNESS = 30;
+  static constexpr double DEFAULT_DAMPING = 0.7;
+  // Values of the tuning parameters, taken over at the start of read()
+  struct Tuning
+  {
+    double joint_stiffness = DEFAULT_STIFFNESS;
+    double joint_damping = DEFAULT_DAMPING;
+    kuka_drivers_core::CommandFilterTuning command_filter;
+  };
+  // Optional node of the tuning parameters, if tuning_parameters is set
+  std::unique_ptr<kuka_drivers_core::TuningParameters<Tuning>> tuning_;
+  // Last tuned values, written into the stiffness and damping commands when they change
+  double tuned_stiffness_ = DEFAULT_STIFFNESS;
+  double tuned_damping_ = DEFAULT_DAMPING;
+  // Position commands of controllers updated only every command_update_cycles_ robot cycles
+  kuka_drivers_core::CommandInterpolator command_interpolator_;
+  std::size_t command_update_cycles_ = 1;
+  std::size_t command_update_counter_ = 0;
+  // Messages of the control loop, written to the rclcpp log by log_drain_
+  kuka_drivers_core::RTLog rt_log_;
+  kuka_drivers_core::RTLogDrain log_drain_{rt_log_, "KukaEACHardwareInterface"};
 
-  std::unique_ptr<os::core::udp::communication::Replier> udp_replier_;
-  std::chrono::milliseconds receive_timeout_ {100};
+  // Phases of the bring-up, logged at the end of on_activate()
+  kuka_drivers_core::StartupProfile startup_profile_{"KukaEACHardwareInterface"};
+  // The delay of the first request after the activation is logged from read()
+  kuka_drivers_core::StartupProfile::Clock::time_point activation_end_;
+  std::atomic<bool> first_request_pending_{false};
 
   uint8_t out_buff_arr_[1500];
+  // Keeps the encoded reply in out_buff_arr_ and patches the values of the next one into it
+  ControlSignalEncoder control_signal_encoder_;
 
   nanopb::kuka::ecs::v1::ControlSignalExternal control_signal_ext_{
     nanopb::kuka::ecs::v1::ControlSignalExternal_init_default};
-  nanopb::kuka::ecs::v1::MotionStateExternal motion_state_external_{
-    nanopb::kuka::ecs::v1::MotionStateExternal_init_default};
+  // Points to the state interface storage
+  MotionStateDecoder::Output motion_state_{};
+
+  // Optional I/O thread of the io_thread parameter, which receives and answers the requests
+  //  instead of read() and write()
+  static constexpr std::size_t kMaxIOJoints = 12;
+  struct IORequest
+  {
+    std::array<double, kMaxIOJoints> positions;
+    std::array<double, kMaxIOJoints> torques;
+    std::array<double, kMaxIOJoints> velocities;
+    uint32_t ipoc;
+    bool ipo_stopped;
+    CycleMonitor::Clock::time_point arrival;
+    std::chrono::steady_clock::time_point timestamp;
+  };
+  struct IOReply
+  {
+    nanopb::kuka::ecs::v1::ControlSignalExternal message;
+    // Cleared at the end of a session, until the first write() of the next one
+    bool valid;
+  };
+  kuka_drivers_core::IOThread::Options io_thread_options_;
+  // Index of the robot in the cycle coordinator while active, -1 without cycle_coordination
+  kuka_drivers_core::CycleCoordinator::Options cycle_coordination_options_;
+  int cycle_robot_ = -1;
+  // Wakes the control loop in idle mode, set while the driver needs the cycles of the loop
+  kuka_drivers_core::ActivityMonitor::Flag activity_;
+  kuka_drivers_core::TripleBuffer<IORequest> io_requests_;
+  kuka_drivers_core::TripleBuffer<IOReply> io_replies_;
+  // Reason of the failure that ended the I/O thread, a string literal
+  std::atomic<const char *> io_error_{nullptr};
+  // Only accessed by the I/O thread
+  uint8_t io_buffer_[1500];
+  ControlSignalEncoder io_encoder_;
+  nanopb::kuka::ecs::v1::ControlSignalExternal io_message_{
+    nanopb::kuka::ecs::v1::ControlSignalExternal_init_default};
+  MotionStateDecoder::Output io_state_{};
+  // Declared last, so that it is stopped before the buffers are destroyed
+  kuka_drivers_core::IOThread io_thread_;
 };
 }  // namespace kuka_eac
 
@@ -0,0 +1,286 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_IIQKA_EAC_DRIVER__MOTION_STATE_DECODER_HPP_
+#define KUKA_IIQKA_EAC_DRIVER__MOTION_STATE_DECODER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace kuka_eac
+{
+/**
+ * @brief Single-pass decoder of the MotionStateExternal protobuf message.
+ *
+ * The joint values are written straight into the state interface storage instead of
+ * the nanopb struct, which would have to be copied afterwards. Only the header, the
+ * ipo_stopped flag, the measured positions, torques and (if requested) velocities are
+ * extracted, all other fields are skipped without decoding.
+ */
+class MotionStateDecoder
+{
+public:
+  /**
+   * @brief Decoded values, the position and torque arrays must hold joint_count values
+   *
+   * The velocities are skipped if the array is null, it must hold joint_count values otherwise.
+   */
+  struct Output
+  {
+    double * positions;
+    double * torques;
+    double * velocities;
+    std::size_t joint_count;
+    uint32_t ipoc;
+    bool ipo_stopped;
+    bool has_positions;
+    bool has_torques;
+    bool has_velocities;
+  };
+
+  /**
+   * @brief Decode a request message, values of joints beyond joint_count are dropped
+   * @returns false if the message is malformed, the arrays might be partially written then
+   */
+  static bool Decode(const uint8_t * data, std::size_t size, Output & output)
+  {
+    // Fields missing from the message have their default values in proto3
+    output.ipoc = 0;
+    output.ipo_stopped = false;
+    output.has_positions = false;
+    output.has_torques = false;
+    output.has_velocities = false;
+
+    Reader reader{data, data + size};
+    while (reader.it < reader.end) {
+      uint32_t field;
+      uint32_t wire_type;
+      if (!reader.ReadKey(field, wire_type)) {
+        return false;
+      }
+      Reader nested{nullptr, nullptr};
+      if (wire_type == kLengthDelimited && field == kExternalHeaderField) {
+        if (!reader.ReadSubmessage(nested) || !DecodeHeader(nested, output)) {
+          return false;
+        }
+      } else if (wire_type == kLengthDelimited && field == kMotionStateField) {
+        if (!reader.ReadSubmessage(nested) || !DecodeMotionState(nested, output)) {
+          return false;
+        }
+      } else if (!reader.Skip(wire_type)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+private:
+  // Field numbers of motion_state_external.proto, motion_state_internal.proto,
+  // external_header.proto and joint.proto
+  static constexpr uint32_t kExternalHeaderField = 1;
+  static constexpr uint32_t kMotionStateField = 2;
+  static constexpr uint32_t kIpocField = 2;
+  static constexpr uint32_t kIpoStoppedField = 1;
+  static constexpr uint32_t kMeasuredPositionsField = 3;
+  static constexpr uint32_t kMeasuredVelocitiesField = 4;
+  static constexpr uint32_t kMeasuredTorquesField = 5;
+  static constexpr uint32_t kJointValuesField = 1;
+
+  static constexpr uint32_t kVarint = 0;
+  static constexpr uint32_t kFixed64 = 1;
+  static constexpr uint32_t kLengthDelimited = 2;
+  static constexpr uint32_t kFixed32 = 5;
+
+  struct Reader
+  {
+    const uint8_t * it;
+    const uint8_t * end;
+
+    bool ReadVarint(uint64_t & value)
+    {
+      value = 0;
+      for (int shift = 0; shift < 64 && it < end; shift += 7) {
+        const uint8_t byte = *it++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    bool ReadKey(uint32_t & field, uint32_t & wire_type)
+    {
+      uint64_t key;
+      if (!ReadVarint(key)) {
+        return false;
+      }
+      field = static_cast<uint32_t>(key >> 3);
+      wire_type = static_cast<uint32_t>(key & 0x07);
+      return true;
+    }
+
+    bool ReadSubmessage(Reader & nested)
+    {
+      uint64_t length;
+      if (!ReadVarint(length) || length > static_cast<uint64_t>(end - it)) {
+        return false;
+      }
+      nested = Reader{it, it + length};
+      it += length;
+      return true;
+    }
+
+    // Protobuf encodes doubles as little-endian IEEE 754, as the supported targets store them
+    bool ReadDouble(double & value)
+    {
+      if (end - it < 8) {
+        return false;
+      }
+      std::memcpy(&value, it, sizeof(value));
+      it += 8;
+      return true;
+    }
+
+    bool Skip(uint32_t wire_type)
+    {
+      uint64_t value;
+      Reader nested{nullptr, nullptr};
+      switch (wire_type) {
+        case kVarint:
+          return ReadVarint(value);
+        case kFixed64:
+          if (end - it < 8) {return false;}
+          it += 8;
+          return true;
+        case kLengthDelimited:
+          return ReadSubmessage(nested);
+        case kFixed32:
+          if (end - it < 4) {return false;}
+          it += 4;
+          return true;
+        default:
+          return false;
+      }
+    }
+  };
+
+  static bool DecodeHeader(Reader & reader, Output & output)
+  {
+    while (reader.it < reader.end) {
+      uint32_t field;
+      uint32_t wire_type;
+      if (!reader.ReadKey(field, wire_type)) {
+        return false;
+      }
+      uint64_t value;
+      if (wire_type == kVarint && field == kIpocField) {
+        if (!reader.ReadVarint(value)) {
+          return false;
+        }
+        output.ipoc = static_cast<uint32_t>(value);
+      } else if (!reader.Skip(wire_type)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  static bool DecodeMotionState(Reader & reader, Output & output)
+  {
+    while (reader.it < reader.end) {
+      uint32_t field;
+      uint32_t wire_type;
+      if (!reader.ReadKey(field, wire_type)) {
+        return false;
+      }
+      uint64_t value;
+      Reader nested{nullptr, nullptr};
+      if (wire_type == kVarint && field == kIpoStoppedField) {
+        if (!reader.ReadVarint(value)) {
+          return false;
+        }
+        output.ipo_stopped = value != 0;
+      } else if (wire_type == kLengthDelimited && field == kMeasuredPositionsField) {
+        if (!reader.ReadSubmessage(nested) ||
+          !DecodeJointValues(nested, output.positions, output.joint_count))
+        {
+          return false;
+        }
+        output.has_positions = true;
+      } else if (wire_type == kLengthDelimited && field == kMeasuredTorquesField) {
+        if (!reader.ReadSubmessage(nested) ||
+          !DecodeJointValues(nested, output.torques, output.joint_count))
+        {
+          return false;
+        }
+        output.has_torques = true;
+      } else if (wire_type == kLengthDelimited && field == kMeasuredVelocitiesField &&
+        output.velocities != nullptr)
+      {
+        if (!reader.ReadSubmessage(nested) ||
+          !DecodeJointValues(nested, output.velocities, output.joint_count))
+        {
+          return false;
+        }
+        output.has_velocities = true;
+      } else if (!reader.Skip(wire_type)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // The repeated values are packed by default, but the unpacked encoding must be accepted too
+  static bool DecodeJointValues(Reader & reader, double * values, std::size_t count)
+  {
+    std::size_t index = 0;
+    while (reader.it < reader.end) {
+      uint32_t field;
+      uint32_t wire_type;
+      if (!reader.ReadKey(field, wire_type)) {
+        return false;
+      }
+      double value;
+      Reader packed{nullptr, nullptr};
+      if (field == kJointValuesField && wire_type == kLengthDelimited) {
+        if (!reader.ReadSubmessage(packed) || (packed.end - packed.it) % 8 != 0) {
+          return false;
+        }
+        while (packed.it < packed.end) {
+          packed.ReadDouble(value);
+          if (index < count) {
+            values[index] = value;
+          }
+          ++index;
+        }
+      } else if (field == kJointValuesField && wire_type == kFixed64) {
+        if (!reader.ReadDouble(value)) {
+          return false;
+        }
+        if (index < count) {
+          values[index] = value;
+        }
+        ++index;
+      } else if (!reader.Skip(wire_type)) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+}  // namespace kuka_eac
+
+#endif  // KUKA_IIQKA_EAC_DRIVER__MOTION_STATE_DECODER_HPP_
@@ -15,8 +15,11 @@
 #ifndef KUKA_IIQKA_EAC_DRIVER__ROBOT_MANAGER_NODE_HPP_
 #define KUKA_IIQKA_EAC_DRIVER__ROBOT_MANAGER_NODE_HPP_
 
+#include <condition_variable>
 #include <string>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <map>
 
@@ -26,18 +29,24 @@
 #include "std_msgs/msg/u_int32.hpp"
 #include "controller_manager_msgs/srv/set_hardware_component_state.hpp"
 #include "controller_manager_msgs/srv/switch_controller.hpp"
+#include "diagnostic_msgs/msg/diagnostic_status.hpp"
 
 #include "kuka_drivers_core/controller_handler.hpp"
 #include "kuka_drivers_core/ros2_base_lc_node.hpp"
+#include "kuka_drivers_core/startup_profile.hpp"
+#include "kuka_drivers_core/switch_trace.hpp"
+#include "kuka_drivers_core/tracing.hpp"
 
 #include "kuka/ecs/v1/motion_services_ecs.grpc.pb.h"
 
+#include "kuka_iiqka_eac_driver/cycle_time.hpp"
+
 namespace kuka_eac
 {
 class RobotManagerNode : public kuka_drivers_core::ROS2BaseLCNode
 {
 public:
-  RobotManagerNode();
+  explicit RobotManagerNode(const rclcpp::NodeOptions & options = rclcpp::NodeOptions());
   ~RobotManagerNode();
 
   rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn
@@ -53,8 +62,22 @@ public:
   on_deactivate(const rclcpp_lifecycle::State &) override;
 
 private:
+  // The transitions of a bring-up, on_configure() and on_activate() profile them
+  rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn Configure();
+  rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn Activate();
+  // Logs the profile of the bring-up and publishes it on ~/startup_profile
+  void PublishStartupProfile(bool successful);
   void ObserveControl();
+  // Deactivates if the hardware interface does not re-establish control within the timeout
+  void WatchRecovery();
+  void StopRecoveryWatch();
   bool onControlModeChangeRequest(int control_mode);
+  // Switches the controllers in one step, the hardware interface changes the mode with them
+  bool HandOverControlMode(
+    int control_mode, const kuka_drivers_core::ControllerHandler::SwitchLists & switch_controllers);
+  // Waits for the CONTROL_MODE_SWITCH event of the controller
+  bool WaitForControlModeSwitch();
+  bool onCycleTimeChangeRequest(int cycle_time);
   bool onRobotModelChangeRequest(const std::string & robot_model);
 
   rclcpp::Client<controller_manager_msgs::srv::SetHardwareComponentState>::SharedPtr
@@ -69,6 +92,13 @@ private:
   std::thread observe_thread_;
   std::atomic<bool> terminate_{false};
   bool param_declared_ = false;
+
+  // Waits for sampling to restart after an error, see control_recovery_timeout_ms
+  std::thread recovery_thread_;
+  std::mutex recovery_m_;
+  std::condition_variable recovery_cv_;
+  bool recovery_pending_ = false;
+  bool recovery_cancelled_ = false;
 #ifdef NON_MOCK_SETUP
   std::unique_ptr<kuka::ecs::v1::ExternalControlService::Stub> stub_;
   std::unique_ptr<grpc::ClientContext> context_;
@@ -79,6 +109,10 @@ private:
 #endif
 
   rclcpp::Publisher<std_msgs::msg::UInt32>::SharedPtr control_mode_pub_;
+  // Phases of the control mode switches, also marked by the events of ObserveControl
+  std::unique_ptr<kuka_drivers_core::SwitchTrace> switch_trace_;
+  kuka_drivers_core::StartupProfile startup_profile_{"robot_manager"};
+  rclcpp::Publisher<diagnostic_msgs::msg::DiagnosticStatus>::SharedPtr startup_profile_pub_;
 
   std::shared_ptr<rclcpp_lifecycle::LifecyclePublisher<std_msgs::msg::Bool>> is_configured_pub_;
   std_msgs::msg::Bool is_configured_msg_;
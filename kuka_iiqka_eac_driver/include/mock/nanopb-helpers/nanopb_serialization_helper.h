@@ -4,6 +4,8 @@
 #include <cstdint>
 #include <cstring>
 
+#include "nanopb-helpers/wire_format_mock.h"
+
 namespace nanopb{
 
 template <typename T>
@@ -17,4 +19,21 @@ inline bool Decode(const uint8_t *, size_t , T &) {
   // only a mock
   return false;
 }
-}  // namespace nanopb
\ No newline at end of file
+
+// The messages of the real-time channel are serialized, so that the mock setup can be
+// run against the mock controller
+template <>
+inline int Encode(const kuka_ecs_v1_ControlSignalExternal & message, uint8_t * buffer, size_t size) {
+  return mock::EncodeControlSignal(message, buffer, size);
+}
+
+template <>
+inline int Encode(const kuka_ecs_v1_MotionStateExternal & message, uint8_t * buffer, size_t size) {
+  return mock::EncodeMotionState(message, buffer, size);
+}
+
+template <>
+inline bool Decode(const uint8_t * data, size_t size, kuka_ecs_v1_ControlSignalExternal & message) {
+  return mock::DecodeControlSignal(data, size, message);
+}
+}  // namespace nanopb
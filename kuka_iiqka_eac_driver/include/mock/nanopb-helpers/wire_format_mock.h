@@ -0,0 +1,590 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "nanopb/kuka/ecs/v1/control_signal_external.pb.h"
+#include "nanopb/kuka/ecs/v1/motion_state_external.pb.h"
+
+// Protobuf wire format of the mock nanopb messages, so that the mock setup exchanges the same
+// datagrams as the real one. The field numbers follow the order of the struct members.
+// The Cartesian impedance attributes are neither encoded nor decoded.
+namespace nanopb::mock
+{
+class Writer
+{
+public:
+  Writer(uint8_t * buffer, size_t size)
+  : begin_(buffer), it_(buffer), end_(buffer + size) {}
+
+  void Varint(uint64_t value)
+  {
+    do {
+      uint8_t byte = value & 0x7F;
+      value >>= 7;
+      if (value != 0) {
+        byte |= 0x80;
+      }
+      Byte(byte);
+    } while (value != 0);
+  }
+
+  void Key(uint32_t field, uint32_t wire_type) {Varint((field << 3) | wire_type);}
+
+  void Bytes(const void * data, size_t size)
+  {
+    if (static_cast<size_t>(end_ - it_) < size) {
+      ok_ = false;
+      return;
+    }
+    std::memcpy(it_, data, size);
+    it_ += size;
+  }
+
+  // Scalars with default value are omitted in proto3
+  void UintField(uint32_t field, uint64_t value)
+  {
+    if (value != 0) {
+      Key(field, kVarint);
+      Varint(value);
+    }
+  }
+
+  void DoubleField(uint32_t field, double value)
+  {
+    if (value != 0) {
+      Key(field, kFixed64);
+      Bytes(&value, sizeof(value));
+    }
+  }
+
+  void PackedDoubles(uint32_t field, const double * values, size_t count)
+  {
+    Key(field, kLengthDelimited);
+    Varint(count * sizeof(double));
+    Bytes(values, count * sizeof(double));
+  }
+
+  template<typename EncodeFunction>
+  void Submessage(uint32_t field, EncodeFunction encode)
+  {
+    uint8_t nested_buffer[kMaxMessageSize];
+    Writer nested(nested_buffer, sizeof(nested_buffer));
+    encode(nested);
+    if (!nested.ok_) {
+      ok_ = false;
+      return;
+    }
+    Key(field, kLengthDelimited);
+    Varint(nested.it_ - nested.begin_);
+    Bytes(nested_buffer, nested.it_ - nested.begin_);
+  }
+
+  int Size() const {return ok_ ? static_cast<int>(it_ - begin_) : -1;}
+
+  static constexpr uint32_t kVarint = 0;
+  static constexpr uint32_t kFixed64 = 1;
+  static constexpr uint32_t kLengthDelimited = 2;
+  static constexpr uint32_t kFixed32 = 5;
+  static constexpr size_t kMaxMessageSize = 1500;
+
+private:
+  void Byte(uint8_t byte)
+  {
+    if (it_ == end_) {
+      ok_ = false;
+      return;
+    }
+    *it_++ = byte;
+  }
+
+  uint8_t * begin_;
+  uint8_t * it_;
+  uint8_t * end_;
+  bool ok_ = true;
+};
+
+class Reader
+{
+public:
+  Reader(const uint8_t * data, size_t size)
+  : it_(data), end_(data + size) {}
+
+  bool AtEnd() const {return it_ >= end_;}
+
+  bool Varint(uint64_t & value)
+  {
+    value = 0;
+    for (int shift = 0; shift < 64 && it_ < end_; shift += 7) {
+      const uint8_t byte = *it_++;
+      value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool Key(uint32_t & field, uint32_t & wire_type)
+  {
+    uint64_t key;
+    if (!Varint(key)) {
+      return false;
+    }
+    field = static_cast<uint32_t>(key >> 3);
+    wire_type = static_cast<uint32_t>(key & 0x07);
+    return true;
+  }
+
+  bool Submessage(Reader & nested)
+  {
+    uint64_t length;
+    if (!Varint(length) || length > static_cast<uint64_t>(end_ - it_)) {
+      return false;
+    }
+    nested = Reader(it_, length);
+    it_ += length;
+    return true;
+  }
+
+  // Accepts the packed and the unpacked encoding, values beyond the capacity are dropped
+  bool Doubles(uint32_t wire_type, double * values, pb_size_t & count, pb_size_t capacity)
+  {
+    if (wire_type == Writer::kFixed64) {
+      return Double(values, count, capacity);
+    }
+    Reader packed(nullptr, 0);
+    if (wire_type != Writer::kLengthDelimited || !Submessage(packed)) {
+      return false;
+    }
+    while (!packed.AtEnd()) {
+      if (!packed.Double(values, count, capacity)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Reads the fields of a message that consists of doubles only, numbered from 1
+  bool DoubleFields(double * const * fields, uint32_t field_count)
+  {
+    while (!AtEnd()) {
+      uint32_t field;
+      uint32_t wire_type;
+      if (!Key(field, wire_type)) {
+        return false;
+      }
+      if (wire_type == Writer::kFixed64 && field >= 1 && field <= field_count) {
+        if (end_ - it_ < 8) {
+          return false;
+        }
+        std::memcpy(fields[field - 1], it_, sizeof(double));
+        it_ += 8;
+      } else if (!Skip(wire_type)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool Skip(uint32_t wire_type)
+  {
+    uint64_t value;
+    Reader nested(nullptr, 0);
+    switch (wire_type) {
+      case Writer::kVarint:
+        return Varint(value);
+      case Writer::kFixed64:
+        return Advance(8);
+      case Writer::kLengthDelimited:
+        return Submessage(nested);
+      case Writer::kFixed32:
+        return Advance(4);
+      default:
+        return false;
+    }
+  }
+
+private:
+  bool Double(double * values, pb_size_t & count, pb_size_t capacity)
+  {
+    if (end_ - it_ < 8) {
+      return false;
+    }
+    if (count < capacity) {
+      std::memcpy(&values[count++], it_, sizeof(double));
+    }
+    it_ += 8;
+    return true;
+  }
+
+  bool Advance(size_t size)
+  {
+    if (static_cast<size_t>(end_ - it_) < size) {
+      return false;
+    }
+    it_ += size;
+    return true;
+  }
+
+  const uint8_t * it_;
+  const uint8_t * end_;
+};
+
+inline void EncodeHeader(Writer & writer, const kuka_ecs_v1_ExternalHeader & header)
+{
+  writer.UintField(1, header.message_id);
+  writer.UintField(2, header.ipoc);
+}
+
+inline void EncodeJointValues(
+  Writer & writer, uint32_t field, const kuka_core_motion_JointPositions & joints)
+{
+  writer.Submessage(
+    field, [&joints](Writer & nested) {
+      nested.PackedDoubles(1, joints.values, joints.values_count);
+    });
+}
+
+inline void EncodeVector(Writer & writer, uint32_t field, const kuka_core_geometry_Vector & vector)
+{
+  writer.Submessage(
+    field, [&vector](Writer & nested) {
+      nested.DoubleField(1, vector.x);
+      nested.DoubleField(2, vector.y);
+      nested.DoubleField(3, vector.z);
+    });
+}
+
+inline void EncodeTransform(
+  Writer & writer, uint32_t field, const kuka_core_geometry_Transform & transform)
+{
+  writer.Submessage(
+    field, [&transform](Writer & nested) {
+      if (transform.has_translation) {
+        EncodeVector(nested, 1, transform.translation);
+      }
+      if (transform.has_rotation) {
+        const auto & rotation = transform.rotation;
+        nested.Submessage(
+          2, [&rotation](Writer & rotation_writer) {
+            rotation_writer.DoubleField(1, rotation.qx);
+            rotation_writer.DoubleField(2, rotation.qy);
+            rotation_writer.DoubleField(3, rotation.qz);
+            rotation_writer.DoubleField(4, rotation.qw);
+          });
+      }
+    });
+}
+
+inline void EncodeTwist(Writer & writer, uint32_t field, const kuka_core_motion_Twist & twist)
+{
+  writer.Submessage(
+    field, [&twist](Writer & nested) {
+      if (twist.has_linear) {
+        EncodeVector(nested, 1, twist.linear);
+      }
+      if (twist.has_angular) {
+        EncodeVector(nested, 2, twist.angular);
+      }
+    });
+}
+
+inline int EncodeMotionState(
+  const kuka_ecs_v1_MotionStateExternal & message, uint8_t * buffer, size_t size)
+{
+  Writer writer(buffer, size);
+  if (message.has_header) {
+    writer.Submessage(1, [&message](Writer & nested) {EncodeHeader(nested, message.header);});
+  }
+  if (message.has_motion_state) {
+    const auto & state = message.motion_state;
+    writer.Submessage(
+      2, [&state](Writer & nested) {
+        nested.UintField(1, state.ipo_stopped);
+        nested.UintField(2, static_cast<uint64_t>(state.control_mode));
+        if (state.has_measured_positions) {
+          EncodeJointValues(nested, 3, state.measured_positions);
+        }
+        if (state.has_measured_velocities) {
+          EncodeJointValues(nested, 4, state.measured_velocities);
+        }
+        if (state.has_measured_torques) {
+          EncodeJointValues(nested, 5, state.measured_torques);
+        }
+      });
+  }
+  return writer.Size();
+}
+
+inline int EncodeControlSignal(
+  const kuka_ecs_v1_ControlSignalExternal & message, uint8_t * buffer, size_t size)
+{
+  Writer writer(buffer, size);
+  if (message.has_header) {
+    writer.Submessage(1, [&message](Writer & nested) {EncodeHeader(nested, message.header);});
+  }
+  if (message.has_control_signal) {
+    const auto & signal = message.control_signal;
+    writer.Submessage(
+      2, [&signal](Writer & nested) {
+        nested.UintField(1, signal.stop_ipo);
+        if (signal.has_joint_command) {
+          EncodeJointValues(nested, 2, signal.joint_command);
+        }
+        if (signal.has_cartesian_command) {
+          EncodeTransform(nested, 3, signal.cartesian_command);
+        }
+        if (signal.has_joint_velocity_command) {
+          EncodeJointValues(nested, 4, signal.joint_velocity_command);
+        }
+        if (signal.has_twist_command) {
+          EncodeTwist(nested, 5, signal.twist_command);
+        }
+        if (signal.has_joint_torque_command) {
+          EncodeJointValues(nested, 6, signal.joint_torque_command);
+        }
+        if (signal.has_wrench_command) {
+          EncodeJointValues(nested, 7, signal.wrench_command);
+        }
+        if (signal.has_joint_attributes) {
+          const auto & attributes = signal.joint_attributes;
+          nested.Submessage(
+            8, [&attributes](Writer & attributes_writer) {
+              attributes_writer.PackedDoubles(1, attributes.stiffness, attributes.stiffness_count);
+              attributes_writer.PackedDoubles(2, attributes.damping, attributes.damping_count);
+            });
+        }
+        nested.UintField(10, static_cast<uint64_t>(signal.control_mode));
+      });
+  }
+  return writer.Size();
+}
+
+inline bool DecodeHeader(Reader & reader, kuka_ecs_v1_ExternalHeader & header)
+{
+  while (!reader.AtEnd()) {
+    uint32_t field;
+    uint32_t wire_type;
+    uint64_t value;
+    if (!reader.Key(field, wire_type)) {
+      return false;
+    }
+    if (wire_type == Writer::kVarint && (field == 1 || field == 2)) {
+      if (!reader.Varint(value)) {
+        return false;
+      }
+      (field == 1 ? header.message_id : header.ipoc) = static_cast<uint32_t>(value);
+    } else if (!reader.Skip(wire_type)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+inline bool DecodeJointValues(Reader & reader, kuka_core_motion_JointPositions & joints)
+{
+  joints.values_count = 0;
+  while (!reader.AtEnd()) {
+    uint32_t field;
+    uint32_t wire_type;
+    if (!reader.Key(field, wire_type)) {
+      return false;
+    }
+    if (field == 1) {
+      if (!reader.Doubles(wire_type, joints.values, joints.values_count, 24)) {
+        return false;
+      }
+    } else if (!reader.Skip(wire_type)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+inline bool DecodeVector(Reader & reader, kuka_core_geometry_Vector & vector)
+{
+  double * const fields[] = {&vector.x, &vector.y, &vector.z};
+  return reader.DoubleFields(fields, 3);
+}
+
+// Decodes a message with two optional submessages, the setters decode and flag the fields
+template<typename DecodeFirst, typename DecodeSecond>
+inline bool DecodePair(Reader & reader, DecodeFirst decode_first, DecodeSecond decode_second)
+{
+  while (!reader.AtEnd()) {
+    uint32_t field;
+    uint32_t wire_type;
+    Reader nested(nullptr, 0);
+    if (!reader.Key(field, wire_type)) {
+      return false;
+    }
+    if (wire_type == Writer::kLengthDelimited && (field == 1 || field == 2)) {
+      if (!reader.Submessage(nested) ||
+        !(field == 1 ? decode_first(nested) : decode_second(nested)))
+      {
+        return false;
+      }
+    } else if (!reader.Skip(wire_type)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+inline bool DecodeTransform(Reader & reader, kuka_core_geometry_Transform & transform)
+{
+  transform = kuka_core_geometry_Transform_init_default;
+  return DecodePair(
+    reader,
+    [&transform](Reader & nested) {
+      transform.has_translation = true;
+      return DecodeVector(nested, transform.translation);
+    },
+    [&transform](Reader & nested) {
+      auto & rotation = transform.rotation;
+      double * const fields[] = {&rotation.qx, &rotation.qy, &rotation.qz, &rotation.qw};
+      transform.has_rotation = true;
+      return nested.DoubleFields(fields, 4);
+    });
+}
+
+inline bool DecodeTwist(Reader & reader, kuka_core_motion_Twist & twist)
+{
+  twist = kuka_core_motion_Twist_init_default;
+  return DecodePair(
+    reader,
+    [&twist](Reader & nested) {
+      twist.has_linear = true;
+      return DecodeVector(nested, twist.linear);
+    },
+    [&twist](Reader & nested) {
+      twist.has_angular = true;
+      return DecodeVector(nested, twist.angular);
+    });
+}
+
+inline bool DecodeControlSignalInternal(
+  Reader & reader, kuka_motion_external_ControlSignalInternal & signal)
+{
+  while (!reader.AtEnd()) {
+    uint32_t field;
+    uint32_t wire_type;
+    uint64_t value;
+    Reader nested(nullptr, 0);
+    if (!reader.Key(field, wire_type)) {
+      return false;
+    }
+    if (wire_type == Writer::kVarint && (field == 1 || field == 10)) {
+      if (!reader.Varint(value)) {
+        return false;
+      }
+      if (field == 1) {
+        signal.stop_ipo = value != 0;
+      } else {
+        signal.control_mode = static_cast<kuka_motion_external_ExternalControlMode>(value);
+      }
+    } else if (wire_type == Writer::kLengthDelimited && (field == 2 || field == 4 || field == 6)) {
+      auto & joints = field == 2 ? signal.joint_command :
+        (field == 4 ? signal.joint_velocity_command : signal.joint_torque_command);
+      (field == 2 ? signal.has_joint_command :
+      (field == 4 ? signal.has_joint_velocity_command : signal.has_joint_torque_command)) = true;
+      if (!reader.Submessage(nested) || !DecodeJointValues(nested, joints)) {
+        return false;
+      }
+    } else if (wire_type == Writer::kLengthDelimited && field == 7) {
+      signal.has_wrench_command = true;
+      if (!reader.Submessage(nested) || !DecodeJointValues(nested, signal.wrench_command)) {
+        return false;
+      }
+    } else if (wire_type == Writer::kLengthDelimited && field == 3) {
+      signal.has_cartesian_command = true;
+      if (!reader.Submessage(nested) || !DecodeTransform(nested, signal.cartesian_command)) {
+        return false;
+      }
+    } else if (wire_type == Writer::kLengthDelimited && field == 5) {
+      signal.has_twist_command = true;
+      if (!reader.Submessage(nested) || !DecodeTwist(nested, signal.twist_command)) {
+        return false;
+      }
+    } else if (wire_type == Writer::kLengthDelimited && field == 8) {
+      auto & attributes = signal.joint_attributes;
+      signal.has_joint_attributes = true;
+      attributes.stiffness_count = 0;
+      attributes.damping_count = 0;
+      if (!reader.Submessage(nested)) {
+        return false;
+      }
+      while (!nested.AtEnd()) {
+        uint32_t attribute_field;
+        uint32_t attribute_wire_type;
+        if (!nested.Key(attribute_field, attribute_wire_type)) {
+          return false;
+        }
+        bool ok = true;
+        if (attribute_field == 1) {
+          ok = nested.Doubles(
+            attribute_wire_type, attributes.stiffness, attributes.stiffness_count, 24);
+        } else if (attribute_field == 2) {
+          ok = nested.Doubles(
+            attribute_wire_type, attributes.damping, attributes.damping_count, 24);
+        } else {
+          ok = nested.Skip(attribute_wire_type);
+        }
+        if (!ok) {
+          return false;
+        }
+      }
+    } else if (!reader.Skip(wire_type)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+inline bool DecodeControlSignal(
+  const uint8_t * data, size_t size, kuka_ecs_v1_ControlSignalExternal & message)
+{
+  message = kuka_ecs_v1_ControlSignalExternal_init_default;
+  Reader reader(data, size);
+  while (!reader.AtEnd()) {
+    uint32_t field;
+    uint32_t wire_type;
+    Reader nested(nullptr, 0);
+    if (!reader.Key(field, wire_type)) {
+      return false;
+    }
+    if (wire_type == Writer::kLengthDelimited && field == 1) {
+      message.has_header = true;
+      if (!reader.Submessage(nested) || !DecodeHeader(nested, message.header)) {
+        return false;
+      }
+    } else if (wire_type == Writer::kLengthDelimited && field == 2) {
+      message.has_control_signal = true;
+      if (!reader.Submessage(nested) ||
+        !DecodeControlSignalInternal(nested, message.control_signal))
+      {
+        return false;
+      }
+    } else if (!reader.Skip(wire_type)) {
+      return false;
+    }
+  }
+  return true;
+}
+}  // namespace nanopb::mock
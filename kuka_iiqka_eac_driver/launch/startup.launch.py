@@ -12,18 +12,31 @@
 # See the License for the specific language governing permissions and
 # limitations under the License.
 
+import yaml
+
 from ament_index_python.packages import get_package_share_directory
 
 from launch import LaunchDescription
 from launch.actions import DeclareLaunchArgument, OpaqueFunction
 from launch.substitutions import Command, FindExecutable, PathJoinSubstitution, LaunchConfiguration
-from launch_ros.actions import Node, LifecycleNode
+from launch_ros.actions import LifecycleNode, LoadComposableNodes, Node
+from launch_ros.descriptions import ComposableNode
 from launch_ros.substitutions import FindPackageShare
 
 
 def launch_setup(context, *args, **kwargs):
     robot_model = LaunchConfiguration('robot_model')
 
+    driver_config = (get_package_share_directory(
+        'kuka_iiqka_eac_driver') + "/config/driver_config.yaml")
+
+    # The external control cycle sets the update rate of the controller_manager
+    with open(driver_config) as config_file:
+        robot_manager_params = yaml.safe_load(config_file)['robot_manager']['ros__parameters']
+    cycle_time = int(robot_manager_params.get('cycle_time', 4))
+    if cycle_time not in (1, 2, 4):
+        raise RuntimeError('Cycle time of %d ms is not supported, use 1, 2 or 4 ms' % cycle_time)
+
     # Get URDF via xacro
     robot_description_content = Command(
         [
@@ -34,6 +47,7 @@ def launch_setup(context, *args, **kwargs):
                  "urdf", robot_model.perform(context) + ".urdf.xacro"]
             ),
             " ",
+            "cycle_time:=" + str(cycle_time),
         ], on_stderr='capture'
     )
 
@@ -49,24 +63,47 @@ def launch_setup(context, *args, **kwargs):
                                 "/config/effort_controller_config.yaml")
     joint_imp_controller_config = (get_package_share_directory('kuka_iiqka_eac_driver') +
                                    "/config/joint_impedance_controller_config.yaml")
-
-    driver_config = (get_package_share_directory(
-        'kuka_iiqka_eac_driver') + "/config/driver_config.yaml")
+    velocity_controller_config = (get_package_share_directory('kuka_iiqka_eac_driver') +
+                                  "/config/velocity_controller_config.yaml")
+    cartesian_position_controller_config = (
+        get_package_share_directory('kuka_iiqka_eac_driver') +
+        "/config/cartesian_position_controller_config.yaml")
+    twist_controller_config = (get_package_share_directory('kuka_iiqka_eac_driver') +
+                               "/config/twist_controller_config.yaml")
+    wrench_controller_config = (get_package_share_directory('kuka_iiqka_eac_driver') +
+                                "/config/wrench_controller_config.yaml")
 
     controller_manager_node = '/controller_manager'
+    composable = LaunchConfiguration('composable').perform(context) == 'true'
 
     control_node = Node(
         package='kuka_drivers_core',
         executable='control_node',
-        parameters=[robot_description, controller_config]
-    )
-    robot_manager_node = LifecycleNode(
-        name=['robot_manager'],
-        namespace='',
-        package="kuka_iiqka_eac_driver",
-        executable="robot_manager_node",
-        parameters=[driver_config, {'robot_model': robot_model.perform(context)}]
+        parameters=[robot_description, controller_config,
+                    {'update_rate': 1000 // cycle_time},
+                    {'component_container': composable}]
     )
+    if composable:
+        # Loaded into the process of the control node, the topics are passed within the process
+        robot_manager_node = LoadComposableNodes(
+            target_container='/control_container',
+            composable_node_descriptions=[ComposableNode(
+                package='kuka_iiqka_eac_driver',
+                plugin='kuka_eac::RobotManagerNode',
+                name='robot_manager',
+                namespace='',
+                parameters=[driver_config, {'robot_model': robot_model.perform(context)}],
+                extra_arguments=[{'use_intra_process_comms': True}]
+            )]
+        )
+    else:
+        robot_manager_node = LifecycleNode(
+            name=['robot_manager'],
+            namespace='',
+            package="kuka_iiqka_eac_driver",
+            executable="robot_manager_node",
+            parameters=[driver_config, {'robot_model': robot_model.perform(context)}]
+        )
     robot_state_publisher = Node(
         package='robot_state_publisher',
         executable='robot_state_publisher',
@@ -88,6 +125,10 @@ def launch_setup(context, *args, **kwargs):
         ("joint_trajectory_controller", joint_traj_controller_config),
         ("joint_group_impedance_controller", joint_imp_controller_config),
         ("effort_controller", effort_controller_config),
+        ("velocity_controller", velocity_controller_config),
+        ("cartesian_position_controller", cartesian_position_controller_config),
+        ("twist_controller", twist_controller_config),
+        ("wrench_controller", wrench_controller_config),
         ("control_mode_handler", [])
     ]
 
@@ -109,4 +150,8 @@ def generate_launch_description():
         'robot_model',
         default_value='lbr_iisy3_r760'
     ))
+    launch_arguments.append(DeclareLaunchArgument(
+        'composable',
+        default_value="false"
+    ))
     return LaunchDescription(launch_arguments + [OpaqueFunction(function=launch_setup)])
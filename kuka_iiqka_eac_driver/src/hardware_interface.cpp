@@ -12,13 +12,19 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <google/protobuf/arena.h>
 #include <grpcpp/create_channel.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <limits>
 #include <stdexcept>
 #include <string>
 #include <vector>
 
 #include "hardware_interface/types/hardware_interface_type_values.hpp"
 #include "kuka_drivers_core/hardware_interface_types.hpp"
+#include "kuka_drivers_core/hardware_parameters.hpp"
 
 #include "nanopb-helpers/nanopb_serialization_helper.h"
 
@@ -26,57 +32,270 @@
 
 using namespace kuka::ecs::v1;  // NOLINT
 
-using os::core::udp::communication::Socket;
 
 namespace kuka_eac
 {
+namespace
+{
+namespace tracing = kuka_drivers_core::tracing;
+
+// The I/O thread checks its stop request at least this often
+constexpr std::chrono::microseconds kIOReceiveTimeout{10000};
+
+constexpr const char * kCartesianInterfaces[] = {
+  hardware_interface::CARTESIAN_X, hardware_interface::CARTESIAN_Y,
+  hardware_interface::CARTESIAN_Z, hardware_interface::CARTESIAN_A,
+  hardware_interface::CARTESIAN_B, hardware_interface::CARTESIAN_C};
+constexpr const char * kTwistInterfaces[] = {
+  hardware_interface::TWIST_LINEAR_X, hardware_interface::TWIST_LINEAR_Y,
+  hardware_interface::TWIST_LINEAR_Z, hardware_interface::TWIST_ANGULAR_X,
+  hardware_interface::TWIST_ANGULAR_Y, hardware_interface::TWIST_ANGULAR_Z};
+constexpr const char * kWrenchInterfaces[] = {
+  hardware_interface::WRENCH_FORCE_X, hardware_interface::WRENCH_FORCE_Y,
+  hardware_interface::WRENCH_FORCE_Z, hardware_interface::WRENCH_TORQUE_X,
+  hardware_interface::WRENCH_TORQUE_Y, hardware_interface::WRENCH_TORQUE_Z};
+
+// The KUKA A, B, C angles are rotations around the Z, Y and X axes in this order
+void SetPose(const std::array<double, 6> & pose, kuka_core_geometry_Transform & transform)
+{
+  transform.translation.x = pose[0];
+  transform.translation.y = pose[1];
+  transform.translation.z = pose[2];
+  const double ca = std::cos(pose[3] / 2), sa = std::sin(pose[3] / 2);
+  const double cb = std::cos(pose[4] / 2), sb = std::sin(pose[4] / 2);
+  const double cc = std::cos(pose[5] / 2), sc = std::sin(pose[5] / 2);
+  transform.rotation.qw = ca * cb * cc + sa * sb * sc;
+  transform.rotation.qx = ca * cb * sc - sa * sb * cc;
+  transform.rotation.qy = ca * sb * cc + sa * cb * sc;
+  transform.rotation.qz = sa * cb * cc - ca * sb * sc;
+}
+
+void SetVector(const double * values, kuka_core_geometry_Vector & vector)
+{
+  vector.x = values[0];
+  vector.y = values[1];
+  vector.z = values[2];
+}
+
+// Optional state interfaces of the joints are selected in the URDF
+bool HasStateInterface(const hardware_interface::ComponentInfo & joint, const std::string & name)
+{
+  return std::any_of(
+    joint.state_interfaces.begin(), joint.state_interfaces.end(),
+    [&name](const hardware_interface::InterfaceInfo & state_if) {return state_if.name == name;});
+}
+
+#ifdef NON_MOCK_SETUP
+// The messages of a gRPC call are created on an arena starting in a block on the stack of the
+//  calling thread, so the call only allocates from the heap if they outgrow the block
+constexpr std::size_t ARENA_BLOCK_SIZE = 4096;
+
+google::protobuf::ArenaOptions ArenaOn(char * block)
+{
+  google::protobuf::ArenaOptions options;
+  options.initial_block = block;
+  options.initial_block_size = ARENA_BLOCK_SIZE;
+  return options;
+}
+
+// Waits for the single call started on the queue, the deadline of the call bounds the wait
+bool AwaitCall(grpc::CompletionQueue & cq)
+{
+  void * tag;
+  bool ok = false;
+  const bool completed = cq.Next(&tag, &ok);
+  cq.Shutdown();
+  while (cq.Next(&tag, &ok)) {}
+  return completed && ok;
+}
+#endif
+}  // namespace
+
+KukaEACHardwareInterface::~KukaEACHardwareInterface()
+{
+  StopRecovery();
+  StopObserveControl();
+  StopChannelMonitor();
+  log_drain_.Stop();
+}
+
 CallbackReturn KukaEACHardwareInterface::on_init(const hardware_interface::HardwareInfo & info)
 {
+  startup_profile_.Reset();
+  kuka_drivers_core::StartupProfile::Scope init_phase(startup_profile_, "on_init");
   if (hardware_interface::SystemInterface::on_init(info) != CallbackReturn::SUCCESS) {
     return CallbackReturn::ERROR;
   }
+  startup_profile_.SetComponent(info_.name);
+  // Numeric parameters, checked before the gRPC channel is created
+  kuka_drivers_core::HardwareParameters parameters(info_.hardware_parameters);
+  // Losses are tracked against the QoS profile set in on_configure()
+  parameters.Require("consequent_lost_packets", consequent_lost_packets_, 0);
+  parameters.Require("lost_packets_in_timeframe", lost_packets_in_timeframe_, 0);
+  parameters.Require("timeframe_ms", qos_timeframe_, 1);
+  // The channel arguments are int
+  const auto max_ms = std::numeric_limits<int>::max();
+  parameters.Get("grpc_deadline_ms", grpc_deadline_, 1, max_ms);
+  parameters.Get("grpc_keepalive_ms", grpc_keepalive_, 0, max_ms);
+  parameters.Get("grpc_probe_period_ms", grpc_probe_period_, 1, max_ms);
+  // Optional re-opening of the control channel if the controller aborted because of packet loss
+  parameters.Get("control_recovery_attempts", control_recovery_attempts_, 0);
+  parameters.Get("control_recovery_delay_ms", control_recovery_delay_);
+  parameters.Get("max_control_recoveries", max_control_recoveries_, 0);
+  parameters.Require("control_mode", configured_control_mode_, 1, 8);
+  hw_control_mode_command_ = configured_control_mode_;
+  parameters.Get("cycle_time", cycle_time_, 1, max_ms);
+  // Optional change of the control mode in the cycle of the controller switch
+  parameters.GetFlag("control_mode_handover", control_mode_handover_);
+  parameters.Get("command_update_cycles", command_update_cycles_, 1);
+#ifndef NON_MOCK_SETUP
+  parameters.GetFlag("mock_loopback", mock_loopback_);
+#endif
+  if (!parameters.Ok()) {
+    RCLCPP_FATAL(rclcpp::get_logger("KukaEACHardwareInterface"), "%s", parameters.Error().c_str());
+    return CallbackReturn::ERROR;
+  }
 
-  udp_replier_ = std::make_unique<os::core::udp::communication::Replier>(
-    os::core::udp::communication::SocketAddress(
-      info_.hardware_parameters.at("client_ip"), 44444));
-
-#ifdef NON_MOCK_SETUP
+  // Low latency receive strategy and traffic class of the replies, I/O thread, cycle
+  //  coordination, clock synchronization and interpolation, see kuka_drivers_core
+  const auto & hardware_parameters = info_.hardware_parameters;
+  kuka_drivers_core::UdpTransport::Options transport_options;
+  std::chrono::nanoseconds min_latency;
+  std::string error;
+  if (
+    !kuka_drivers_core::UdpTransport::ParseOptions(hardware_parameters, transport_options, error) ||
+    !kuka_drivers_core::IOThread::ParseOptions(hardware_parameters, io_thread_options_, error) ||
+    !kuka_drivers_core::CycleCoordinator::ParseOptions(
+      hardware_parameters, cycle_coordination_options_, error) ||
+    !kuka_drivers_core::ClockSync::ParseMinLatency(hardware_parameters, min_latency, error) ||
+    !command_interpolator_.Configure(hardware_parameters, info_.joints.size(), error))
+  {
+    RCLCPP_FATAL(rclcpp::get_logger("KukaEACHardwareInterface"), "%s", error.c_str());
+    return CallbackReturn::ERROR;
+  }
+  if (io_thread_options_.enabled && info_.joints.size() > kMaxIOJoints) {
+    RCLCPP_FATAL(
+      rclcpp::get_logger("KukaEACHardwareInterface"),
+      "io_thread supports at most %zu joints", kMaxIOJoints);
+    return CallbackReturn::ERROR;
+  }
+  // The interpolator assumes a write() in every robot cycle
+  if (io_thread_options_.enabled && command_interpolator_.Enabled()) {
+    RCLCPP_FATAL(
+      rclcpp::get_logger("KukaEACHardwareInterface"),
+      "command_interpolation cannot be combined with io_thread");
+    return CallbackReturn::ERROR;
+  }
+  // The cycles are started by the coordinator, read() must not wait for the request
+  if (cycle_coordination_options_.enabled && !io_thread_options_.enabled) {
+    RCLCPP_FATAL(
+      rclcpp::get_logger("KukaEACHardwareInterface"), "cycle_coordination requires io_thread");
+    return CallbackReturn::ERROR;
+  }
+  cycle_monitor_ = CycleMonitor(
+    consequent_lost_packets_, lost_packets_in_timeframe_, qos_timeframe_);
+  // The length of an IPOC tick is not specified by the protocol, it is learned
+  clock_sync_ = kuka_drivers_core::ClockSync(0.0, min_latency);
 
-  stub_ =
-    ExternalControlService::NewStub(
-    grpc::CreateChannel(
-      info_.hardware_parameters.at("controller_ip") + ":49335",
-      grpc::InsecureChannelCredentials()));
+  // Optional diagnostics, metrics, network faults, recordings, publishers, command filters and
+  //  tuning, see the README of kuka_drivers_core
+  // The error threshold of the loss rate is the rate allowed by the QoS profile, a warning is
+  //  given at half of it
+  const double allowed_loss_rate =
+    lost_packets_in_timeframe_ * 1000.0 / static_cast<double>(qos_timeframe_.count());
+  using LinkMetric = kuka_drivers_core::LinkDiagnostics::Metric;
+  const std::vector<LinkMetric> link_metrics = {
+    {"missed cycles", kuka_drivers_core::LinkDiagnostics::Kind::COUNTER, allowed_loss_rate / 2,
+      allowed_loss_rate, false},
+    {"late packets", kuka_drivers_core::LinkDiagnostics::Kind::COUNTER, allowed_loss_rate / 2,
+      allowed_loss_rate, false}};
+  std::vector<std::string> joint_names;
+  for (const auto & joint : info_.joints) {
+    joint_names.push_back(joint.name);
+  }
+  const std::size_t joint_count = info_.joints.size();
+  // The joint stiffness and damping are tuned next to the command filters
+  const auto register_tuning = [](kuka_drivers_core::TuningParameters<Tuning> & tuning) {
+      tuning.Register<double>(
+        "joint_stiffness", DEFAULT_STIFFNESS, [](const double & value, Tuning & snapshot) {
+          snapshot.joint_stiffness = value;
+          return value >= 0;
+        });
+      tuning.Register<double>(
+        "joint_damping", DEFAULT_DAMPING, [](const double & value, Tuning & snapshot) {
+          snapshot.joint_damping = value;
+          return value >= 0 && value <= 1;
+        });
+    };
+  if (
+    !kuka_drivers_core::ConfigureLinkDiagnostics(
+      hardware_parameters, info_.name, link_metrics, link_diagnostics_, error) ||
+    !kuka_drivers_core::ConfigureMetrics(hardware_parameters, info_.name, metrics_group_, error) ||
+    !kuka_drivers_core::ConfigureFaultInjection(hardware_parameters, fault_injector_, error) ||
+    !kuka_drivers_core::ConfigureWireCapture(hardware_parameters, wire_capture_, error) ||
+    !kuka_drivers_core::ConfigureFlightRecorder(hardware_parameters, flight_recorder_, error) ||
+    !kuka_drivers_core::ConfigureStateChannel(
+      hardware_parameters, joint_count, state_channel_, error) ||
+    !kuka_drivers_core::ConfigureJointStatePublisher(
+      hardware_parameters, info_.name, joint_names, joint_state_publisher_, error) ||
+    !kuka_drivers_core::ConfigureStateBatchPublisher(
+      hardware_parameters, info_.name, joint_names, state_batch_publisher_, error) ||
+    !kuka_drivers_core::ConfigureCommandFilter(
+      hardware_parameters, joint_count, command_filter_, error) ||
+    !kuka_drivers_core::ConfigureTuningParameters<Tuning>(
+      hardware_parameters, info_.name, joint_count, &Tuning::command_filter, tuning_, error,
+      register_tuning))
+  {
+    RCLCPP_FATAL(rclcpp::get_logger("KukaEACHardwareInterface"), "%s", error.c_str());
+    return CallbackReturn::ERROR;
+  }
+  if (fault_injector_ != nullptr) {
+    RCLCPP_WARN(
+      rclcpp::get_logger("KukaEACHardwareInterface"), "Fault injection enabled: %s",
+      parameters.String("fault_profile").c_str());
+  }
+  RegisterMetrics();
 
+  CreateChannel();
+  if (!IsCycleTimeSupported(
+      static_cast<int>(cycle_time_.count()), static_cast<int>(hw_control_mode_command_)))
+  {
+    RCLCPP_FATAL(
+      rclcpp::get_logger("KukaEACHardwareInterface"),
+      "Cycle time of %d ms is not supported in control mode %d, use 1, 2 or 4 ms in a mode "
+      "other than Cartesian impedance control", static_cast<int>(cycle_time_.count()),
+      static_cast<int>(hw_control_mode_command_));
+    return CallbackReturn::ERROR;
+  }
+  handover_window_ = std::max<std::size_t>(
+    1, static_cast<std::size_t>(kHandoverTimeout / cycle_time_));
+  // The controller_manager update rate must match the cycle, see ros2_controller_config.yaml
+  fallback_timeout_ = std::chrono::duration_cast<std::chrono::microseconds>(
+    cycle_time_ * CycleMonitor::kTimeoutFactor);
+  AllocateInterfaces(joint_names);
+  // In the mock setup, the transport is only needed if the mock controller is used
+  bool use_replier = true;
+#ifndef NON_MOCK_SETUP
+  use_replier = mock_loopback_;
+  if (!mock_loopback_) {
+    // Start from home position in mock mode
+    hw_position_commands_[1] = -90 * (M_PI / 180);
+    hw_position_commands_[2] = 90 * (M_PI / 180);
+    hw_position_commands_[4] = 90 * (M_PI / 180);
+  }
 #endif
-  hw_control_mode_command_ = std::stod(info_.hardware_parameters.at("control_mode"));
-  hw_position_states_.resize(info_.joints.size(), 0.0);
-  hw_torque_states_.resize(info_.joints.size(), 0.0);
-  hw_position_commands_.resize(info_.joints.size(), 0.0);
-  hw_torque_commands_.resize(info_.joints.size(), 0.0);
-  hw_stiffness_commands_.resize(info_.joints.size(), 30);
-  hw_damping_commands_.resize(info_.joints.size(), 0.7);
-  motion_state_external_.header.ipoc = 0;
-  control_signal_ext_.has_header = true;
-  control_signal_ext_.has_control_signal = true;
-  control_signal_ext_.control_signal.has_joint_command = true;
-  control_signal_ext_.control_signal.joint_command.values_count = info_.joints.size();
-  control_signal_ext_.control_signal.has_joint_torque_command = true;
-  control_signal_ext_.control_signal.joint_torque_command.values_count = info_.joints.size();
-  control_signal_ext_.control_signal.has_joint_attributes = true;
-  control_signal_ext_.control_signal.joint_attributes.stiffness_count = info_.joints.size();
-  control_signal_ext_.control_signal.joint_attributes.damping_count = info_.joints.size();
-#ifdef NON_MOCK_SETUP
-  if (udp_replier_->Setup() != Socket::ErrorCode::kSuccess) {
-    RCLCPP_ERROR(rclcpp::get_logger("KukaEACHardwareInterface"), "Could not setup udp replier");
+  udp_transport_.SetCapture(wire_capture_.get());
+  udp_transport_.SetFaultInjector(fault_injector_.get());
+  kuka_drivers_core::StartupProfile::Scope transport_phase(
+    startup_profile_, "on_init/udp_transport");
+  if (use_replier &&
+    !udp_transport_.Open(info_.hardware_parameters.at("client_ip"), 44444, transport_options))
+  {
+    RCLCPP_ERROR(
+      rclcpp::get_logger("KukaEACHardwareInterface"), "Could not setup udp transport: %s",
+      udp_transport_.Error().c_str());
     return CallbackReturn::FAILURE;
   }
-#else
-// Start from home position in mock mode
-  hw_position_commands_[1] = -90 * (M_PI / 180);
-  hw_position_commands_[2] = 90 * (M_PI / 180);
-  hw_position_commands_[4] = 90 * (M_PI / 180);
-#endif
 
   RCLCPP_INFO(rclcpp::get_logger("KukaEACHardwareInterface"), "Init successful");
 
@@ -88,17 +307,40 @@ KukaEACHardwareInterface::export_state_interfaces()
 {
   RCLCPP_INFO(rclcpp::get_logger("KukaEACHardwareInterface"), "Export state interfaces");
   std::vector<hardware_interface::StateInterface> state_interfaces;
-  for (size_t i = 0; i < info_.joints.size(); i++) {
-    state_interfaces.emplace_back(
-      info_.joints[i].name,
-      hardware_interface::HW_IF_POSITION,
-      &hw_position_states_[i]);
+  joint_storage_.ExportStateInterfaces(
+    state_interfaces, [this](std::size_t joint, const std::string & interface) {
+      return interface != hardware_interface::HW_IF_VELOCITY ||
+      HasStateInterface(info_.joints[joint], hardware_interface::HW_IF_VELOCITY);
+    });
 
+  auto & statistics = cycle_monitor_.statistics();
+  state_interfaces.emplace_back(
+    hardware_interface::EAC_STATE_PREFIX, hardware_interface::MISSED_CYCLES,
+    &statistics.missed_cycles);
+  state_interfaces.emplace_back(
+    hardware_interface::EAC_STATE_PREFIX, hardware_interface::LATE_PACKETS,
+    &statistics.late_packets);
+  state_interfaces.emplace_back(
+    hardware_interface::EAC_STATE_PREFIX, hardware_interface::DUPLICATE_PACKETS,
+    &statistics.duplicate_packets);
+  state_interfaces.emplace_back(
+    hardware_interface::EAC_STATE_PREFIX, hardware_interface::MEASURED_CYCLE_TIME,
+    &statistics.measured_cycle_time);
+  state_interfaces.emplace_back(
+    hardware_interface::EAC_STATE_PREFIX, hardware_interface::STATE_STAMP, &state_stamp_);
+  state_interfaces.emplace_back(
+    hardware_interface::EAC_STATE_PREFIX, hardware_interface::ONE_WAY_LATENCY,
+    &one_way_latency_);
+  if (control_recovery_attempts_ > 0) {
+    state_interfaces.emplace_back(
+      hardware_interface::EAC_STATE_PREFIX, hardware_interface::CONTROL_RECOVERIES,
+      &control_recoveries_);
     state_interfaces.emplace_back(
-      info_.joints[i].name,
-      hardware_interface::HW_IF_EFFORT,
-      &hw_torque_states_[i]);
+      hardware_interface::EAC_STATE_PREFIX, hardware_interface::RECOVERY_TIME,
+      &recovery_time_);
   }
+  state_interfaces.emplace_back(
+    hardware_interface::EAC_STATE_PREFIX, hardware_interface::GRPC_CONNECTED, &grpc_connected_);
   return state_interfaces;
 }
 
@@ -108,26 +350,16 @@ export_command_interfaces()
   RCLCPP_INFO(rclcpp::get_logger("KukaEACHardwareInterface"), "Export command interfaces");
 
   std::vector<hardware_interface::CommandInterface> command_interfaces;
-  for (size_t i = 0; i < info_.joints.size(); i++) {
-    command_interfaces.emplace_back(
-      info_.joints[i].name,
-      hardware_interface::HW_IF_POSITION,
-      &hw_position_commands_[i]);
+  joint_storage_.ExportCommandInterfaces(command_interfaces);
 
+  for (size_t i = 0; i < hw_cartesian_commands_.size(); i++) {
     command_interfaces.emplace_back(
-      info_.joints[i].name,
-      hardware_interface::HW_IF_EFFORT,
-      &hw_torque_commands_[i]);
-
+      hardware_interface::CARTESIAN_COMMAND_PREFIX, kCartesianInterfaces[i],
+      &hw_cartesian_commands_[i]);
     command_interfaces.emplace_back(
-      info_.joints[i].name,
-      hardware_interface::HW_IF_STIFFNESS,
-      &hw_stiffness_commands_[i]);
-
+      hardware_interface::TWIST_COMMAND_PREFIX, kTwistInterfaces[i], &hw_twist_commands_[i]);
     command_interfaces.emplace_back(
-      info_.joints[i].name,
-      hardware_interface::HW_IF_DAMPING,
-      &hw_damping_commands_[i]);
+      hardware_interface::WRENCH_COMMAND_PREFIX, kWrenchInterfaces[i], &hw_wrench_commands_[i]);
   }
 
   command_interfaces.emplace_back(
@@ -140,29 +372,53 @@ export_command_interfaces()
 
 CallbackReturn KukaEACHardwareInterface::on_configure(const rclcpp_lifecycle::State &)
 {
+  kuka_drivers_core::StartupProfile::Scope configure_phase(startup_profile_, "on_configure");
  #ifdef NON_MOCK_SETUP
-  SetQoSProfileRequest request;
-  SetQoSProfileResponse response;
+  // Connected since on_init() normally, otherwise the wait is bounded by the call deadline
+  kuka_drivers_core::StartupProfile::Scope connect_phase(
+    startup_profile_, "on_configure/grpc_connect");
+  if (!channel_->WaitForConnected(std::chrono::system_clock::now() + grpc_deadline_)) {
+    RCLCPP_ERROR(
+      rclcpp::get_logger("KukaEACHardwareInterface"),
+      "Could not connect to the controller within %d ms", static_cast<int>(grpc_deadline_.count()));
+    return CallbackReturn::FAILURE;
+  }
+  connect_phase.Finish();
+
+  alignas(std::max_align_t) char arena_block[ARENA_BLOCK_SIZE];
+  google::protobuf::Arena arena(ArenaOn(arena_block));
+  auto * request = google::protobuf::Arena::CreateMessage<SetQoSProfileRequest>(&arena);
+  auto * response = google::protobuf::Arena::CreateMessage<SetQoSProfileResponse>(&arena);
   grpc::ClientContext context;
+  context.set_deadline(std::chrono::system_clock::now() + grpc_deadline_);
+
+  request->add_qos_profiles();
+
+  request->mutable_qos_profiles()->at(0).mutable_rt_packet_loss_profile()->
+  set_consequent_lost_packets(consequent_lost_packets_);
+  request->mutable_qos_profiles()->at(0).mutable_rt_packet_loss_profile()->
+  set_lost_packets_in_timeframe(lost_packets_in_timeframe_);
+  request->mutable_qos_profiles()->at(0).mutable_rt_packet_loss_profile()->set_timeframe_ms(
+    static_cast<int>(qos_timeframe_.count()));
 
-  request.add_qos_profiles();
-
-  request.mutable_qos_profiles()->at(0).mutable_rt_packet_loss_profile()->
-  set_consequent_lost_packets(std::stoi(info_.hardware_parameters.at("consequent_lost_packets")));
-  request.mutable_qos_profiles()->at(0).mutable_rt_packet_loss_profile()->
-  set_lost_packets_in_timeframe(
-    std::stoi(
-      info_.hardware_parameters.at(
-        "lost_packets_in_timeframe")));
-  request.mutable_qos_profiles()->at(0).mutable_rt_packet_loss_profile()->set_timeframe_ms(
-    std::stoi(
-      info_.hardware_parameters.at(
-        "timeframe_ms")));
-
-  if (stub_->SetQoSProfile(&context, request, &response).error_code() != grpc::StatusCode::OK) {
-    RCLCPP_ERROR(rclcpp::get_logger("KukaEACHardwareInterface"), "SetQoSProfile failed");
+  kuka_drivers_core::StartupProfile::Scope qos_phase(startup_profile_, "on_configure/set_qos");
+  grpc::CompletionQueue cq;
+  grpc::Status status;
+  auto qos_call = stub_->PrepareAsyncSetQoSProfile(&context, *request, &cq);
+  qos_call->StartCall();
+  qos_call->Finish(response, &status, qos_call.get());
+
+  // The observe stream is independent of the QoS profile, it is opened in the meantime
+  StartObserveControl();
+
+  if (!AwaitCall(cq) || !status.ok()) {
+    RCLCPP_ERROR(
+      rclcpp::get_logger("KukaEACHardwareInterface"), "SetQoSProfile failed: %s",
+      status.error_message().c_str());
+    StopObserveControl();
     return CallbackReturn::FAILURE;
   }
+  qos_phase.Finish();
 
   RCLCPP_INFO(
     rclcpp::get_logger("KukaEACHardwareInterface"),
@@ -174,47 +430,112 @@ CallbackReturn KukaEACHardwareInterface::on_configure(const rclcpp_lifecycle::St
   return CallbackReturn::SUCCESS;
 }
 
+CallbackReturn KukaEACHardwareInterface::on_cleanup(const rclcpp_lifecycle::State &)
+{
+  StopObserveControl();
+  return CallbackReturn::SUCCESS;
+}
 
 CallbackReturn KukaEACHardwareInterface::on_activate(const rclcpp_lifecycle::State &)
 {
+  kuka_drivers_core::StartupProfile::Scope activate_phase(startup_profile_, "on_activate");
   RCLCPP_INFO(rclcpp::get_logger("KukaEACHardwareInterface"), "Connecting to robot . . .");
+  log_drain_.Start();
+  command_filter_.Reset();
+  tracing::InstanceName(this, info_.name.c_str());
+  tracing::InstanceName(&udp_transport_, info_.name.c_str());
   // Reset timeout to catch first tick message
-  receive_timeout_ = std::chrono::milliseconds(100);
-  control_signal_ext_.control_signal.stop_ipo = false;
+  cycle_monitor_.Reset();
+  clock_sync_.Reset();
+  receive_timeout_ = CycleMonitor::kFirstRequestTimeout;
+  // The recovery of the previous activation might still be waiting for its last call
+  StopRecovery();
+  stop_requested_ = false;
+  recoveries_in_activation_ = 0;
+  recovering_ = false;
+  // Events of the previous session are not relevant anymore, the loop is inactive here
+  control_events_.Clear();
+#ifndef NON_MOCK_SETUP
+  // The mock controller sends requests without being asked to
+  if (mock_loopback_) {
+    PublishControlEvent(ControlEvent::SAMPLING);
+  }
+#endif
+
 #ifdef NON_MOCK_SETUP
-  if (context_ != nullptr) {
-    context_->TryCancel();
+  // Reopen the stream if the controller closed it since the last activation
+  StartObserveControl();
+
+  kuka_drivers_core::StartupProfile::Scope open_phase(
+    startup_profile_, "on_activate/open_control_channel");
+  if (!OpenControlChannel(static_cast<int>(hw_control_mode_command_))) {
+    return CallbackReturn::FAILURE;
   }
+  open_phase.Finish();
 #endif
-  if (observe_thread_.joinable()) {
-    observe_thread_.join();
+
+  if (io_thread_options_.enabled && udp_transport_.IsOpen()) {
+    // Requests are not answered until the first write(), nothing is left from the last activation
+    io_replies_.Back().valid = false;
+    io_replies_.Publish();
+    io_requests_.Update();
+    io_error_ = nullptr;
+    io_thread_.Start([this] {return ExchangeOnIOThread();}, io_thread_options_);
+  }
+  if (cycle_coordination_options_.enabled) {
+    cycle_robot_ = kuka_drivers_core::CycleCoordinator::Instance().Join(
+      info_.name, cycle_coordination_options_.master);
+    if (cycle_robot_ < 0) {
+      RCLCPP_WARN(
+        rclcpp::get_logger("KukaEACHardwareInterface"),
+        "Too many robots for the cycle coordinator, the cycles are not aligned to this one");
+    }
   }
 
-#ifdef NON_MOCK_SETUP
-  observe_thread_ = std::thread(&KukaEACHardwareInterface::ObserveControl, this);
+  // The next bring-up (after a deactivation or a cleanup) is profiled from its first phase
+  activate_phase.Finish();
+  startup_profile_.Log(rclcpp::get_logger("KukaEACHardwareInterface"));
+  startup_profile_.Reset();
+  activation_end_ = kuka_drivers_core::StartupProfile::Clock::now();
+  first_request_pending_ = true;
+  activity_.Set();
+  return CallbackReturn::SUCCESS;
+}
 
-  OpenControlChannelRequest request;
-  OpenControlChannelResponse response;
+bool KukaEACHardwareInterface::OpenControlChannel(int control_mode)
+{
+#ifdef NON_MOCK_SETUP
+  // Also called by the recovery thread, the arena is on the stack of the caller
+  alignas(std::max_align_t) char arena_block[ARENA_BLOCK_SIZE];
+  google::protobuf::Arena arena(ArenaOn(arena_block));
+  auto * request = google::protobuf::Arena::CreateMessage<OpenControlChannelRequest>(&arena);
+  auto * response = google::protobuf::Arena::CreateMessage<OpenControlChannelResponse>(&arena);
   grpc::ClientContext context;
+  context.set_deadline(std::chrono::system_clock::now() + grpc_deadline_);
 
-  request.set_ip_address(info_.hardware_parameters.at("client_ip"));
-  request.set_timeout(5000);
-  request.set_cycle_time(4);
-  request.set_external_control_mode(
-    kuka::motion::external::ExternalControlMode(hw_control_mode_command_));
+  request->set_ip_address(info_.hardware_parameters.at("client_ip"));
+  request->set_timeout(5000);
+  request->set_cycle_time(cycle_time_.count());
+  request->set_external_control_mode(kuka::motion::external::ExternalControlMode(control_mode));
   RCLCPP_INFO(
-    rclcpp::get_logger("KukaEACHardwareInterface"), "Starting control in %s",
-    kuka::motion::external::ExternalControlMode_Name(
-      static_cast<int>(hw_control_mode_command_)).c_str());
+    rclcpp::get_logger("KukaEACHardwareInterface"), "Starting control in %s with %d ms cycle time",
+    kuka::motion::external::ExternalControlMode_Name(control_mode).c_str(),
+    static_cast<int>(cycle_time_.count()));
 
-  auto ret = stub_->OpenControlChannel(&context, request, &response);
-  if (ret.error_code() != grpc::StatusCode::OK) {
-    RCLCPP_ERROR(rclcpp::get_logger("KukaEACHardwareInterface"), "%s", ret.error_message().c_str());
-    return CallbackReturn::FAILURE;
+  grpc::CompletionQueue cq;
+  grpc::Status status;
+  auto open_call = stub_->PrepareAsyncOpenControlChannel(&context, *request, &cq);
+  open_call->StartCall();
+  open_call->Finish(response, &status, open_call.get());
+  if (!AwaitCall(cq) || !status.ok()) {
+    RCLCPP_ERROR(
+      rclcpp::get_logger("KukaEACHardwareInterface"), "%s", status.error_message().c_str());
+    return false;
   }
+#else
+  (void)control_mode;
 #endif
-
-  return CallbackReturn::SUCCESS;
+  return true;
 }
 
 CallbackReturn KukaEACHardwareInterface::on_deactivate(
@@ -222,18 +543,33 @@ CallbackReturn KukaEACHardwareInterface::on_deactivate(
 {
   RCLCPP_INFO(rclcpp::get_logger("KukaEACHardwareInterface"), "Deactivating");
 
-  control_signal_ext_.control_signal.stop_ipo = true;
-  while (is_active_) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  {
+    // Also ends the wait of a recovery between its attempts
+    std::lock_guard<std::mutex> lk(observe_mutex_);
+    stop_requested_ = true;
   }
-
-#ifdef NON_MOCK_SETUP
-  if (context_ != nullptr) {
-    context_->TryCancel();
+  observe_cv_.notify_all();
+#ifndef NON_MOCK_SETUP
+  if (mock_loopback_) {
+    PublishControlEvent(ControlEvent::STOPPED);
   }
 #endif
-  if (observe_thread_.joinable()) {
-    observe_thread_.join();
+  {
+    // Woken up by the observer thread when the control service reports the stop
+    std::unique_lock<std::mutex> lk(observe_mutex_);
+    observe_cv_.wait(lk, [this] {return !is_active_;});
+  }
+  // The stop has been answered, the I/O thread is not needed until the next activation
+  io_thread_.Stop();
+  kuka_drivers_core::CycleCoordinator::Instance().Leave(cycle_robot_);
+  cycle_robot_ = -1;
+  activity_.Clear();
+  // The observe stream stays open for the next activation
+  log_drain_.Stop();
+  if (fault_injector_ != nullptr) {
+    RCLCPP_INFO(
+      rclcpp::get_logger("KukaEACHardwareInterface"), "Fault injection: %s",
+      fault_injector_->Summary().c_str());
   }
   return CallbackReturn::SUCCESS;
 }
@@ -242,14 +578,43 @@ return_type KukaEACHardwareInterface::read(
   const rclcpp::Time &,
   const rclcpp::Duration &)
 {
+  grpc_connected_ = channel_connected_.load(std::memory_order_relaxed) ? 1.0 : 0.0;
+  if (tuning_ != nullptr && tuning_->Update()) {
+    const Tuning & tuning = tuning_->Current();
+    command_filter_.CopyConfiguration(tuning.command_filter.filter);
+    // Only a changed value overwrites the commands of the controllers, sent in write()
+    if (tuning.joint_stiffness != tuned_stiffness_) {
+      std::fill(
+        hw_stiffness_commands_.begin(), hw_stiffness_commands_.end(), tuning.joint_stiffness);
+      tuned_stiffness_ = tuning.joint_stiffness;
+    }
+    if (tuning.joint_damping != tuned_damping_) {
+      std::fill(hw_damping_commands_.begin(), hw_damping_commands_.end(), tuning.joint_damping);
+      tuned_damping_ = tuning.joint_damping;
+    }
+  }
 #ifndef NON_MOCK_SETUP
-  std::this_thread::sleep_for(std::chrono::microseconds(3900));
-  for (size_t i = 0; i < info_.joints.size(); i++) {
-    hw_position_states_[i] = hw_position_commands_[i];
+  if (!mock_loopback_) {
+    std::this_thread::sleep_for(cycle_time_ - std::chrono::microseconds(100));
+    const bool velocity_control = static_cast<int>(hw_control_mode_command_) ==
+      kuka_motion_external_ExternalControlMode_JOINT_VELOCITY_CONTROL;
+    for (size_t i = 0; i < info_.joints.size(); i++) {
+      const double previous_position = hw_position_states_[i];
+      if (velocity_control) {
+        hw_position_states_[i] += hw_velocity_commands_[i] *
+          std::chrono::duration<double>(cycle_time_).count();
+        hw_position_commands_[i] = hw_position_states_[i];
+      } else {
+        hw_position_states_[i] = hw_position_commands_[i];
+      }
+      hw_velocity_states_[i] = (hw_position_states_[i] - previous_position) /
+        std::chrono::duration<double>(cycle_time_).count();
+    }
+    return return_type::OK;
   }
-  return return_type::OK;
 #endif
 
+  HandleControlEvents();
   if (!is_active_) {
     std::this_thread::sleep_for(std::chrono::milliseconds(2));
     msg_received_ = false;
@@ -257,101 +622,624 @@ return_type KukaEACHardwareInterface::read(
     return return_type::OK;
   }
 
-  if (udp_replier_->ReceiveRequestOrTimeout(receive_timeout_) ==
-    Socket::ErrorCode::kSuccess)
-  {
-    auto req_message = udp_replier_->GetRequestMessage();
+  if (io_thread_options_.enabled) {
+    if (!io_thread_.Running()) {
+      const char * error = io_error_.load();
+      RCLCPP_ERROR(
+        rclcpp::get_logger("KukaEACHardwareInterface"), "%s",
+        error != nullptr ? error : "I/O thread stopped");
+      RecordFailure();
+      throw std::runtime_error(error != nullptr ? error : "I/O thread stopped");
+    }
+    // Without a new request the states are kept, the last commands are sent with the next one
+    const bool fresh = io_requests_.Update();
+    kuka_drivers_core::CycleCoordinator::Instance().OnRead(cycle_robot_, fresh);
+    if (!fresh) {
+      msg_received_ = false;
+      return return_type::OK;
+    }
+    const IORequest & request = io_requests_.Front();
+    const std::size_t joints = info_.joints.size();
+    std::copy_n(request.positions.begin(), joints, hw_position_states_.begin());
+    std::copy_n(request.torques.begin(), joints, hw_torque_states_.begin());
+    if (motion_state_.velocities != nullptr) {
+      std::copy_n(request.velocities.begin(), joints, hw_velocity_states_.begin());
+    }
+    motion_state_.ipoc = request.ipoc;
+    motion_state_.ipo_stopped = request.ipo_stopped;
+    OnRequest(request.arrival, request.timestamp);
+    return return_type::OK;
+  }
 
-    if (!nanopb::Decode<nanopb::kuka::ecs::v1::MotionStateExternal>(
-        req_message.first, req_message.second, motion_state_external_))
-    {
+  kuka_drivers_core::UdpTransport::Packet request;
+  if (udp_transport_.Receive(request, receive_timeout_) > 0) {
+    const auto arrival = CycleMonitor::Clock::now();
+
+    // Joint values are decoded directly into the state interfaces
+    tracing::PhaseBegin(tracing::Phase::DECODE, this);
+    const bool decoded = MotionStateDecoder::Decode(
+      reinterpret_cast<const uint8_t *>(request.data), request.size, motion_state_);
+    tracing::PhaseEnd(tracing::Phase::DECODE, this);
+    if (!decoded) {
+      if (metrics_.decode_failures != nullptr) {
+        metrics_.decode_failures->Add();
+      }
       RCLCPP_INFO(rclcpp::get_logger("KukaEACHardwareInterface"), "Decoding request failed");
+      RecordFailure();
       throw std::runtime_error("Decoding request failed");
     }
-    control_signal_ext_.header.ipoc = motion_state_external_.header.ipoc;
+    OnRequest(arrival, request.timestamp);
+  } else {
+    // The request is counted as late or missed when the next one arrives
+    KUKA_RT_LOG_THROTTLE(
+      rt_log_, kuka_drivers_core::RTLog::Level::WARN, 1000,
+      "Request was missed within %.1f ms, previous ipoc: %u",
+      std::chrono::duration<double, std::milli>(receive_timeout_).count(), motion_state_.ipoc);
+    msg_received_ = false;
+    // No reply is sent in this cycle, write() does not record it
+    if (flight_recorder_ != nullptr) {
+      auto & record = flight_recorder_->Current();
+      record.counter = motion_state_.ipoc;
+      record.flags = kuka_drivers_core::FlightRecorder::MISSED;
+      flight_recorder_->Commit();
+    }
+  }
+  return return_type::OK;
+}
 
-    for (size_t i = 0; i < info_.joints.size(); i++) {
-      hw_position_states_[i] = motion_state_external_.motion_state.measured_positions.values[i];
-      hw_torque_states_[i] = motion_state_external_.motion_state.measured_torques.values[i];
-      // This is necessary, as joint trajectory controller is initialized with 0 command values
-      if (!msg_received_ && motion_state_external_.header.ipoc == 0) {
-        hw_position_commands_[i] = hw_position_states_[i];
-      }
+void KukaEACHardwareInterface::OnRequest(
+  CycleMonitor::Clock::time_point arrival, std::chrono::steady_clock::time_point timestamp)
+{
+  control_signal_ext_.header.ipoc = motion_state_.ipoc;
+
+  if (cycle_monitor_.OnRequest(motion_state_.ipoc, arrival) != CycleMonitor::Result::OK) {
+    KUKA_RT_LOG_THROTTLE(
+      rt_log_, kuka_drivers_core::RTLog::Level::WARN, 1000,
+      "Request with repeated or outdated ipoc %u", motion_state_.ipoc);
+  }
+  if (cycle_monitor_.TakeWarning()) {
+    rt_log_.Log(
+      kuka_drivers_core::RTLog::Level::WARN,
+      "Packet loss reached the QoS profile (%d in a row, %d in %s ms), "
+      "the next loss aborts external control",
+      cycle_monitor_.ConsequentLosses(), cycle_monitor_.LossesInTimeframe(arrival),
+      info_.hardware_parameters.at("timeframe_ms").c_str());
+  }
+  clock_sync_.Update(motion_state_.ipoc, timestamp);
+  state_stamp_ = clock_sync_.Stamp();
+  one_way_latency_ = clock_sync_.Latency();
+  if (cycle_robot_ >= 0 && clock_sync_.Valid()) {
+    kuka_drivers_core::CycleCoordinator::Instance().OnMessage(
+      cycle_robot_, clock_sync_.SendTime(), timestamp);
+  }
+  if (link_diagnostics_ != nullptr) {
+    const auto & statistics = cycle_monitor_.statistics();
+    const double link_metrics[] = {statistics.missed_cycles, statistics.late_packets};
+    link_diagnostics_->Update(link_metrics);
+  }
+  if (metrics_group_ != nullptr) {
+    const auto & statistics = cycle_monitor_.statistics();
+    metrics_.missed_requests->Set(static_cast<uint64_t>(statistics.missed_cycles));
+    metrics_.late_requests->Set(static_cast<uint64_t>(statistics.late_packets));
+    if (clock_sync_.Valid() && one_way_latency_ > 0) {
+      metrics_.one_way_latency->Record(static_cast<uint64_t>(one_way_latency_ * 1e9));
     }
+    request_arrival_ = arrival;
+  }
 
-    if (motion_state_external_.motion_state.ipo_stopped) {
-      RCLCPP_INFO(rclcpp::get_logger("KukaEACHardwareInterface"), "Motion stopped");
+  // This is necessary, as joint trajectory controller is initialized with 0 command values
+  if (!msg_received_ && motion_state_.ipoc == 0) {
+    std::copy(
+      hw_position_states_.begin(), hw_position_states_.end(), hw_position_commands_.begin());
+    command_interpolator_.Reset(hw_position_commands_.data());
+    command_update_counter_ = 0;
+  }
+  if (recovering_) {
+    // First request of the re-opened channel, continue from where the robot stopped
+    if (motion_state_.ipoc != 0) {
+      std::copy(
+        hw_position_states_.begin(), hw_position_states_.end(), hw_position_commands_.begin());
+      command_interpolator_.Reset(hw_position_commands_.data());
+      command_update_counter_ = 0;
     }
-    msg_received_ = true;
-    receive_timeout_ = std::chrono::milliseconds(6);
-  } else {
-    RCLCPP_WARN(rclcpp::get_logger("KukaEACHardwareInterface"), "Request was missed");
-    RCLCPP_WARN(
-      rclcpp::get_logger("KukaEACHardwareInterface"),
-      "Previous ipoc: %i", motion_state_external_.header.ipoc);
-    msg_received_ = false;
+    command_filter_.Reset();
+    recovery_time_ = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - recovery_start_.load()).count();
+    control_recoveries_++;
+    recovering_ = false;
+    rt_log_.Log(
+      kuka_drivers_core::RTLog::Level::INFO, "External control re-established after %.0f ms",
+      recovery_time_ * 1000);
+  }
+
+  if (motion_state_.ipo_stopped) {
+    KUKA_RT_LOG_THROTTLE(
+      rt_log_, kuka_drivers_core::RTLog::Level::INFO, 1000, "Motion stopped");
+  }
+  msg_received_ = true;
+  receive_timeout_ = cycle_monitor_.ReceiveTimeout(fallback_timeout_);
+  if (first_request_pending_.exchange(false)) {
+    rt_log_.Log(
+      kuka_drivers_core::RTLog::Level::INFO, "First request %.1f ms after the activation",
+      std::chrono::duration<double, std::milli>(
+        kuka_drivers_core::StartupProfile::Clock::now() - activation_end_).count());
+  }
+
+  if (flight_recorder_ != nullptr) {
+    auto & record = flight_recorder_->Current();
+    record.counter = motion_state_.ipoc;
+    record.receive_time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      arrival.time_since_epoch()).count();
+    record.flags = kuka_drivers_core::FlightRecorder::RECEIVED |
+      (motion_state_.ipo_stopped ? IPO_STOPPED : 0);
+    record.mode = static_cast<uint16_t>(hw_control_mode_command_);
+    flight_recorder_->SetStates(hw_position_states_.data(), hw_position_states_.size());
+  }
+  if (state_channel_ != nullptr) {
+    auto & sample = state_channel_->Current();
+    sample.counter = motion_state_.ipoc;
+    sample.receive_time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      arrival.time_since_epoch()).count();
+    sample.mode = static_cast<uint16_t>(hw_control_mode_command_);
+    state_channel_->SetPositions(hw_position_states_.data(), hw_position_states_.size());
+    state_channel_->SetEfforts(hw_torque_states_.data(), hw_torque_states_.size());
+    state_channel_->Publish();
+  }
+  if (joint_state_publisher_ != nullptr) {
+    joint_state_publisher_->Update(
+      hw_position_states_.data(), motion_state_.velocities, hw_torque_states_.data());
+  }
+  if (state_batch_publisher_ != nullptr) {
+    state_batch_publisher_->Update(
+      motion_state_.ipoc, motion_state_.ipo_stopped ? BATCH_IPO_STOPPED : 0,
+      hw_position_states_.data(), motion_state_.velocities, hw_torque_states_.data());
   }
-  return return_type::OK;
 }
 
 return_type KukaEACHardwareInterface::write(
   const rclcpp::Time &,
-  const rclcpp::Duration &)
+  const rclcpp::Duration & period)
 {
   // If control is not started or a request is missed, do not send back anything
   if (!msg_received_) {
     return return_type::OK;
   }
 
-  // TODO(Svastits): should we separate control modes somehow?
-  std::copy(
-    hw_position_commands_.begin(),
-    hw_position_commands_.end(), control_signal_ext_.control_signal.joint_command.values);
-  std::copy(
-    hw_torque_commands_.begin(),
-    hw_torque_commands_.end(), control_signal_ext_.control_signal.joint_torque_command.values);
-  std::copy(
-    hw_stiffness_commands_.begin(),
-    hw_stiffness_commands_.end(), control_signal_ext_.control_signal.joint_attributes.stiffness);
-  std::copy(
-    hw_damping_commands_.begin(),
-    hw_damping_commands_.end(), control_signal_ext_.control_signal.joint_attributes.damping);
-
-  control_signal_ext_.control_signal.control_mode = kuka_motion_external_ExternalControlMode(
+  control_signal_ext_.control_signal.stop_ipo = stop_requested_;
+
+  const auto control_mode = kuka_motion_external_ExternalControlMode(
     static_cast<int>(hw_control_mode_command_));
+  const int encoded_mode = encoded_control_mode_.load(std::memory_order_relaxed);
+  if (static_cast<int>(control_mode) != encoded_mode) {
+    // With hand-over the mode is kept until the controllers of the new one are switched in,
+    //  without a switch it is changed after the window
+    if (!control_mode_handover_ || encoded_mode < 0 || switched_cycles_left_ > 0 ||
+      ++staged_cycles_ >= handover_window_)
+    {
+      if (control_mode_handover_ && encoded_mode >= 0) {
+        rt_log_.Log(
+          kuka_drivers_core::RTLog::Level::INFO,
+          "Control mode handed over from %d to %d, %s", encoded_mode,
+          static_cast<int>(control_mode),
+          switched_cycles_left_ > 0 ? "with the controller switch" : "without controller switch");
+      }
+      SetEncodingProfile(control_mode);
+      staged_cycles_ = 0;
+    }
+  }
+  if (switched_cycles_left_ > 0) {
+    switched_cycles_left_--;
+  }
 
-  auto encoded_bytes = nanopb::Encode<nanopb::kuka::ecs::v1::ControlSignalExternal>(
-    control_signal_ext_, out_buff_arr_, sizeof(out_buff_arr_));
-  if (encoded_bytes < 0) {
-    RCLCPP_ERROR(
-      rclcpp::get_logger(
-        "KukaEACHardwareInterface"),
-      "Encoding of control signal to out_buffer failed.");
-    throw std::runtime_error("Encoding of control signal to out_buffer failed.");
+  // Only the fields of the current control mode are copied and encoded
+  auto & control_signal = control_signal_ext_.control_signal;
+  if (control_signal.has_joint_command) {
+    if (command_interpolator_.Enabled()) {
+      // The controllers are sampled in every command_update_cycles_-th cycle
+      const double cycle_time = std::chrono::duration<double>(cycle_time_).count();
+      if (command_update_counter_++ % command_update_cycles_ == 0) {
+        command_interpolator_.SetTarget(
+          hw_position_commands_.data(), static_cast<double>(command_update_cycles_) * cycle_time);
+      }
+      std::copy_n(
+        command_interpolator_.Next(cycle_time), hw_position_commands_.size(),
+        control_signal.joint_command.values);
+    } else {
+      std::copy(
+        hw_position_commands_.begin(), hw_position_commands_.end(),
+        control_signal.joint_command.values);
+    }
+    if (!command_filter_.Apply(
+        control_signal.joint_command.values, hw_position_commands_.size(), period.seconds()))
+    {
+      rt_log_.Log(kuka_drivers_core::RTLog::Level::ERROR, "Command filtering failed");
+      RecordFailure();
+      return return_type::ERROR;
+    }
+  }
+  if (control_signal.has_joint_velocity_command) {
+    std::copy(
+      hw_velocity_commands_.begin(), hw_velocity_commands_.end(),
+      control_signal.joint_velocity_command.values);
+  }
+  if (control_signal.has_joint_torque_command) {
+    std::copy(
+      hw_torque_commands_.begin(), hw_torque_commands_.end(),
+      control_signal.joint_torque_command.values);
+  }
+  if (control_signal.has_cartesian_command) {
+    SetPose(hw_cartesian_commands_, control_signal.cartesian_command);
+  }
+  if (control_signal.has_twist_command) {
+    SetVector(&hw_twist_commands_[0], control_signal.twist_command.linear);
+    SetVector(&hw_twist_commands_[3], control_signal.twist_command.angular);
+  }
+  if (control_signal.has_wrench_command) {
+    std::copy(
+      hw_wrench_commands_.begin(), hw_wrench_commands_.end(), control_signal.wrench_command.values);
+  }
+  // The attributes rarely change, the message keeps the values of the last cycle
+  if (control_signal.has_joint_attributes) {
+    auto & attributes = control_signal.joint_attributes;
+    if (!std::equal(
+        hw_stiffness_commands_.begin(), hw_stiffness_commands_.end(), attributes.stiffness))
+    {
+      std::copy(hw_stiffness_commands_.begin(), hw_stiffness_commands_.end(), attributes.stiffness);
+    }
+    if (!std::equal(hw_damping_commands_.begin(), hw_damping_commands_.end(), attributes.damping)) {
+      std::copy(hw_damping_commands_.begin(), hw_damping_commands_.end(), attributes.damping);
+    }
   }
 
-  if (udp_replier_->SendReply(out_buff_arr_, encoded_bytes) !=
-    Socket::ErrorCode::kSuccess)
-  {
-    RCLCPP_ERROR(rclcpp::get_logger("KukaEACHardwareInterface"), "Error sending reply");
-    throw std::runtime_error("Error sending reply");
+  if (io_thread_options_.enabled) {
+    // Encoded and sent by the I/O thread as the answer to the next request
+    IOReply & reply = io_replies_.Back();
+    reply.message = control_signal_ext_;
+    reply.valid = true;
+    io_replies_.Publish();
+  } else {
+    tracing::PhaseBegin(tracing::Phase::ENCODE, this);
+    auto encoded_bytes = control_signal_encoder_.Encode(
+      control_signal_ext_, out_buff_arr_, sizeof(out_buff_arr_));
+    tracing::PhaseEnd(tracing::Phase::ENCODE, this);
+    if (encoded_bytes < 0) {
+      RCLCPP_ERROR(
+        rclcpp::get_logger(
+          "KukaEACHardwareInterface"),
+        "Encoding of control signal to out_buffer failed.");
+      RecordFailure();
+      throw std::runtime_error("Encoding of control signal to out_buffer failed.");
+    }
+
+    if (udp_transport_.Send(out_buff_arr_, static_cast<std::size_t>(encoded_bytes)) < 0) {
+      RCLCPP_ERROR(rclcpp::get_logger("KukaEACHardwareInterface"), "Error sending reply");
+      RecordFailure();
+      throw std::runtime_error("Error sending reply");
+    }
+    if (metrics_.reply_latency != nullptr) {
+      metrics_.reply_latency->Record(
+        static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+          CycleMonitor::Clock::now() - request_arrival_).count()));
+    }
+  }
+  if (flight_recorder_ != nullptr) {
+    auto & record = flight_recorder_->Current();
+    record.send_time_ns = kuka_drivers_core::FlightRecorder::Now();
+    record.flags |= kuka_drivers_core::FlightRecorder::SENT;
+    if (control_signal.has_joint_velocity_command) {
+      flight_recorder_->SetCommands(hw_velocity_commands_.data(), hw_velocity_commands_.size());
+    } else if (control_signal.has_joint_torque_command) {
+      flight_recorder_->SetCommands(hw_torque_commands_.data(), hw_torque_commands_.size());
+    } else {
+      flight_recorder_->SetCommands(hw_position_commands_.data(), hw_position_commands_.size());
+    }
+    flight_recorder_->Commit();
+  }
+  // Published with the state of the next cycle
+  if (state_channel_ != nullptr) {
+    if (control_signal.has_joint_velocity_command) {
+      state_channel_->SetCommands(hw_velocity_commands_.data(), hw_velocity_commands_.size());
+    } else if (control_signal.has_joint_torque_command) {
+      state_channel_->SetCommands(hw_torque_commands_.data(), hw_torque_commands_.size());
+    } else {
+      state_channel_->SetCommands(hw_position_commands_.data(), hw_position_commands_.size());
+    }
+  }
+  if (state_batch_publisher_ != nullptr) {
+    if (control_signal.has_joint_velocity_command) {
+      state_batch_publisher_->SetCommands(
+        hw_velocity_commands_.data(), hw_velocity_commands_.size());
+    } else if (control_signal.has_joint_torque_command) {
+      state_batch_publisher_->SetCommands(hw_torque_commands_.data(), hw_torque_commands_.size());
+    } else {
+      state_batch_publisher_->SetCommands(
+        hw_position_commands_.data(), hw_position_commands_.size());
+    }
   }
   return return_type::OK;
 }
 
+return_type KukaEACHardwareInterface::perform_command_mode_switch(
+  const std::vector<std::string> & start_interfaces, const std::vector<std::string> &)
+{
+  if (!control_mode_handover_) {
+    return return_type::OK;
+  }
+  // Called by the controller manager in the control loop, before the new controllers are
+  //  activated and updated, the mode change of write() is applied in this or in the next cycles
+  switched_cycles_left_ = handover_window_;
+  // The claimed commands start from the latest state, so that no cycle of the new controllers
+  //  sends outdated values
+  for (const auto & name : start_interfaces) {
+    SeedCommand(name);
+  }
+  return return_type::OK;
+}
+
+void KukaEACHardwareInterface::CreateChannel()
+{
+#ifdef NON_MOCK_SETUP
+  grpc::ChannelArguments channel_args;
+  // The channel would disconnect after 30 minutes without calls otherwise
+  channel_args.SetInt(GRPC_ARG_CLIENT_IDLE_TIMEOUT_MS, std::numeric_limits<int>::max());
+  // A lost connection is re-established within one probe period
+  channel_args.SetInt(
+    GRPC_ARG_MAX_RECONNECT_BACKOFF_MS, static_cast<int>(grpc_probe_period_.count()));
+  if (grpc_keepalive_.count() > 0) {
+    // Keeps the connection alive through firewalls and detects a dead controller without calls,
+    //  the controller must accept pings at this rate
+    channel_args.SetInt(GRPC_ARG_KEEPALIVE_TIME_MS, static_cast<int>(grpc_keepalive_.count()));
+    channel_args.SetInt(GRPC_ARG_KEEPALIVE_TIMEOUT_MS, static_cast<int>(grpc_deadline_.count()));
+    channel_args.SetInt(GRPC_ARG_KEEPALIVE_PERMIT_WITHOUT_CALLS, 1);
+    channel_args.SetInt(GRPC_ARG_HTTP2_MAX_PINGS_WITHOUT_DATA, 0);
+  }
+  kuka_drivers_core::StartupProfile::Scope channel_phase(startup_profile_, "on_init/grpc_channel");
+  channel_ = grpc::CreateCustomChannel(
+    info_.hardware_parameters.at("controller_ip") + ":49335",
+    grpc::InsecureChannelCredentials(), channel_args);
+  stub_ = ExternalControlService::NewStub(channel_);
+  // Start connecting now instead of at the first call in on_configure()
+  StartChannelMonitor();
+  channel_phase.Finish();
+#endif
+}
+
+void KukaEACHardwareInterface::AllocateInterfaces(const std::vector<std::string> & joint_names)
+{
+  // The order of the fields is the order of the exported interfaces of a joint
+  const std::size_t position_state = joint_storage_.AddState(hardware_interface::HW_IF_POSITION);
+  const std::size_t torque_state = joint_storage_.AddState(hardware_interface::HW_IF_EFFORT);
+  const std::size_t velocity_state = joint_storage_.AddState(hardware_interface::HW_IF_VELOCITY);
+  const std::size_t position_command =
+    joint_storage_.AddCommand(hardware_interface::HW_IF_POSITION);
+  const std::size_t velocity_command =
+    joint_storage_.AddCommand(hardware_interface::HW_IF_VELOCITY);
+  const std::size_t torque_command = joint_storage_.AddCommand(hardware_interface::HW_IF_EFFORT);
+  const std::size_t stiffness_command =
+    joint_storage_.AddCommand(hardware_interface::HW_IF_STIFFNESS, DEFAULT_STIFFNESS);
+  const std::size_t damping_command =
+    joint_storage_.AddCommand(hardware_interface::HW_IF_DAMPING, DEFAULT_DAMPING);
+  joint_storage_.Allocate(joint_names);
+  hw_position_states_ = joint_storage_.State(position_state);
+  hw_torque_states_ = joint_storage_.State(torque_state);
+  hw_velocity_states_ = joint_storage_.State(velocity_state);
+  hw_position_commands_ = joint_storage_.Command(position_command);
+  hw_velocity_commands_ = joint_storage_.Command(velocity_command);
+  hw_torque_commands_ = joint_storage_.Command(torque_command);
+  hw_stiffness_commands_ = joint_storage_.Command(stiffness_command);
+  hw_damping_commands_ = joint_storage_.Command(damping_command);
+  motion_state_.positions = hw_position_states_.data();
+  motion_state_.torques = hw_torque_states_.data();
+  motion_state_.joint_count = info_.joints.size();
+  // The measured velocities are only decoded if a joint has a velocity state interface
+  motion_state_.velocities = nullptr;
+  for (const auto & joint : info_.joints) {
+    if (HasStateInterface(joint, hardware_interface::HW_IF_VELOCITY)) {
+      motion_state_.velocities = hw_velocity_states_.data();
+    }
+  }
+  control_signal_ext_.has_header = true;
+  control_signal_ext_.has_control_signal = true;
+  // Which of the fields are sent is decided by SetEncodingProfile()
+  auto & control_signal = control_signal_ext_.control_signal;
+  control_signal.joint_command.values_count = info_.joints.size();
+  control_signal.joint_velocity_command.values_count = info_.joints.size();
+  control_signal.joint_torque_command.values_count = info_.joints.size();
+  control_signal.joint_attributes.stiffness_count = info_.joints.size();
+  control_signal.joint_attributes.damping_count = info_.joints.size();
+  control_signal.cartesian_command.has_translation = true;
+  control_signal.cartesian_command.has_rotation = true;
+  control_signal.twist_command.has_linear = true;
+  control_signal.twist_command.has_angular = true;
+  control_signal.wrench_command.values_count = hw_wrench_commands_.size();
+}
+
+void KukaEACHardwareInterface::RegisterMetrics()
+{
+  if (metrics_group_ == nullptr) {
+    return;
+  }
+  metrics_.missed_requests = &metrics_group_->AddCounter(
+    "missed_requests_total", "Requests of the robot that did not arrive in time");
+  metrics_.late_requests = &metrics_group_->AddCounter(
+    "late_requests_total", "Requests of the robot that arrived after their cycle");
+  metrics_.decode_failures = &metrics_group_->AddCounter(
+    "decode_failures_total", "Requests of the robot that could not be decoded");
+  metrics_.one_way_latency = &metrics_group_->AddHistogram(
+    "one_way_latency_seconds", "Delay of the requests from the robot controller to the host");
+  metrics_.reply_latency = &metrics_group_->AddHistogram(
+    "reply_latency_seconds", "Time from the arrival of a request until its reply is sent");
+}
+
+void KukaEACHardwareInterface::SeedCommand(const std::string & name)
+{
+  const auto separator = name.find('/');
+  if (separator == std::string::npos) {
+    return;
+  }
+  const char * interface_name = name.c_str() + separator + 1;
+  if (name.compare(0, separator, hardware_interface::TWIST_COMMAND_PREFIX) == 0) {
+    hw_twist_commands_.fill(0);
+    return;
+  }
+  if (name.compare(0, separator, hardware_interface::WRENCH_COMMAND_PREFIX) == 0) {
+    hw_wrench_commands_.fill(0);
+    return;
+  }
+  for (std::size_t i = 0; i < info_.joints.size(); i++) {
+    if (name.compare(0, separator, info_.joints[i].name) != 0) {
+      continue;
+    }
+    if (std::strcmp(interface_name, hardware_interface::HW_IF_POSITION) == 0) {
+      hw_position_commands_[i] = hw_position_states_[i];
+    } else if (std::strcmp(interface_name, hardware_interface::HW_IF_VELOCITY) == 0) {
+      hw_velocity_commands_[i] = 0;
+    } else if (std::strcmp(interface_name, hardware_interface::HW_IF_EFFORT) == 0) {
+      hw_torque_commands_[i] = hw_torque_states_[i];
+    }
+    return;
+  }
+}
+
+void KukaEACHardwareInterface::SetEncodingProfile(kuka_motion_external_ExternalControlMode mode)
+{
+  auto & control_signal = control_signal_ext_.control_signal;
+  control_signal.control_mode = mode;
+  control_signal.has_joint_command = false;
+  control_signal.has_cartesian_command = false;
+  control_signal.has_joint_velocity_command = false;
+  control_signal.has_twist_command = false;
+  control_signal.has_joint_torque_command = false;
+  control_signal.has_wrench_command = false;
+  control_signal.has_joint_attributes = false;
+  switch (mode) {
+    case kuka_motion_external_ExternalControlMode_JOINT_POSITION_CONTROL:
+      control_signal.has_joint_command = true;
+      break;
+    case kuka_motion_external_ExternalControlMode_JOINT_IMPEDANCE_CONTROL:
+      control_signal.has_joint_command = true;
+      control_signal.has_joint_attributes = true;
+      break;
+    case kuka_motion_external_ExternalControlMode_JOINT_VELOCITY_CONTROL:
+      control_signal.has_joint_velocity_command = true;
+      break;
+    case kuka_motion_external_ExternalControlMode_JOINT_TORQUE_CONTROL:
+      control_signal.has_joint_torque_command = true;
+      break;
+    case kuka_motion_external_ExternalControlMode_CARTESIAN_POSITION_CONTROL:
+      control_signal.has_cartesian_command = true;
+      break;
+    case kuka_motion_external_ExternalControlMode_CARTESIAN_VELOCITY_CONTROL:
+      control_signal.has_twist_command = true;
+      break;
+    case kuka_motion_external_ExternalControlMode_WRENCH_CONTROL:
+      control_signal.has_wrench_command = true;
+      break;
+    default:
+      // No dedicated profile, every joint field is sent
+      control_signal.has_joint_command = true;
+      control_signal.has_joint_torque_command = true;
+      control_signal.has_joint_attributes = true;
+      break;
+  }
+  if (control_signal.has_joint_attributes) {
+    // The cached attributes might be outdated after a mode without them
+    std::copy(
+      hw_stiffness_commands_.begin(), hw_stiffness_commands_.end(),
+      control_signal.joint_attributes.stiffness);
+    std::copy(
+      hw_damping_commands_.begin(), hw_damping_commands_.end(),
+      control_signal.joint_attributes.damping);
+  }
+  encoded_control_mode_ = static_cast<int>(mode);
+}
+
+void KukaEACHardwareInterface::StartObserveControl()
+{
+#ifdef NON_MOCK_SETUP
+  if (observe_stream_open_) {
+    return;
+  }
+  if (observe_thread_.joinable()) {
+    observe_thread_.join();
+  }
+  // Created before the thread, so that the stream can be cancelled at any time
+  context_ = std::make_unique<::grpc::ClientContext>();
+  observe_stream_open_ = true;
+  observe_thread_ = std::thread(&KukaEACHardwareInterface::ObserveControl, this);
+#endif
+}
+
+void KukaEACHardwareInterface::StopObserveControl()
+{
+#ifdef NON_MOCK_SETUP
+  if (context_ != nullptr) {
+    context_->TryCancel();
+  }
+#endif
+  if (observe_thread_.joinable()) {
+    observe_thread_.join();
+  }
+  observe_stream_open_ = false;
+}
+
+void KukaEACHardwareInterface::StartChannelMonitor()
+{
+#ifdef NON_MOCK_SETUP
+  StopChannelMonitor();
+  channel_monitor_stop_ = false;
+  channel_monitor_thread_ = std::thread(
+    [this] {
+      std::unique_lock<std::mutex> lk(channel_monitor_mutex_);
+      do {
+        // Also starts reconnecting an idle or failed channel, before the next call needs it
+        const bool connected = channel_->GetState(true) == GRPC_CHANNEL_READY;
+        if (connected == channel_connected_.exchange(connected)) {
+          continue;
+        }
+        if (connected) {
+          RCLCPP_INFO(rclcpp::get_logger("KukaEACHardwareInterface"), "gRPC channel connected");
+        } else {
+          RCLCPP_WARN(
+            rclcpp::get_logger("KukaEACHardwareInterface"), "gRPC channel disconnected");
+        }
+      } while (!channel_monitor_cv_.wait_for(
+        lk, grpc_probe_period_, [this] {return channel_monitor_stop_;}));
+    });
+#endif
+}
+
+void KukaEACHardwareInterface::StopChannelMonitor()
+{
+#ifdef NON_MOCK_SETUP
+  {
+    std::lock_guard<std::mutex> lk(channel_monitor_mutex_);
+    channel_monitor_stop_ = true;
+  }
+  channel_monitor_cv_.notify_all();
+  if (channel_monitor_thread_.joinable()) {
+    channel_monitor_thread_.join();
+  }
+#endif
+  channel_connected_ = false;
+}
+
 void KukaEACHardwareInterface::ObserveControl()
 {
 #ifdef NON_MOCK_SETUP
   RCLCPP_INFO(rclcpp::get_logger("KukaEACHardwareInterface"), "Observe control");
-  context_ = std::make_unique<::grpc::ClientContext>();
-  ObserveControlStateRequest obs_control;
+  // Every event is parsed into the same message on the arena, which keeps the memory of the
+  //  previous ones, so a burst of events (e.g. in a control mode switch) does not allocate.
+  //  Only the event type is handed over to the control loop.
+  alignas(std::max_align_t) char arena_block[ARENA_BLOCK_SIZE];
+  google::protobuf::Arena arena(ArenaOn(arena_block));
+  auto * obs_control = google::protobuf::Arena::CreateMessage<ObserveControlStateRequest>(&arena);
   std::unique_ptr<grpc::ClientReader<CommandState>> reader(
-    stub_->ObserveControlState(context_.get(), obs_control));
+    stub_->ObserveControlState(context_.get(), *obs_control));
 
-  CommandState response;
+  auto & response = *google::protobuf::Arena::CreateMessage<CommandState>(&arena);
 
   while (reader->Read(&response)) {
-    command_state_ = response;
     RCLCPP_INFO(
       rclcpp::get_logger(
         "KukaEACHardwareInterface"),
@@ -364,17 +1252,17 @@ void KukaEACHardwareInterface::ObserveControl()
         break;
       case CommandEvent::SAMPLING:
         RCLCPP_INFO(rclcpp::get_logger("KukaEACHardwareInterface"), "External control is active");
-        is_active_ = true;
+        PublishControlEvent(ControlEvent::SAMPLING);
         break;
       case CommandEvent::CONTROL_MODE_SWITCH:
         RCLCPP_INFO(
           rclcpp::get_logger(
             "KukaEACHardwareInterface"), "Control mode switch is in progress");
-        is_active_ = false;
+        PublishControlEvent(ControlEvent::CONTROL_MODE_SWITCH);
         break;
       case CommandEvent::STOPPED:
         RCLCPP_INFO(rclcpp::get_logger("KukaEACHardwareInterface"), "External control finished");
-        is_active_ = false;
+        PublishControlEvent(ControlEvent::STOPPED);
         break;
       case CommandEvent::ERROR:
         RCLCPP_ERROR(
@@ -382,15 +1270,182 @@ void KukaEACHardwareInterface::ObserveControl()
             "KukaEACHardwareInterface"),
           "External control stopped by an error");
         RCLCPP_ERROR(rclcpp::get_logger("KukaEACHardwareInterface"), response.message().c_str());
-        is_active_ = false;
+        PublishControlEvent(ControlEvent::ERROR);
+        StartRecovery();
         break;
       default:
         break;
     }
   }
+  // The stream was closed or cancelled, no further events arrive until it is reopened
+  if (is_active_) {
+    PublishControlEvent(ControlEvent::STOPPED);
+  }
+  observe_stream_open_ = false;
 #endif
 }
 
+void KukaEACHardwareInterface::StartRecovery()
+{
+  if (control_recovery_attempts_ == 0 || stop_requested_ || recovery_running_) {
+    return;
+  }
+  if (recoveries_in_activation_ >= max_control_recoveries_) {
+    RCLCPP_ERROR(
+      rclcpp::get_logger("KukaEACHardwareInterface"),
+      "External control was already re-established %d times in this activation, giving up",
+      recoveries_in_activation_);
+    return;
+  }
+  recoveries_in_activation_++;
+  // The previous recovery has finished, as recovery_running_ is cleared at its end
+  if (recovery_thread_.joinable()) {
+    recovery_thread_.join();
+  }
+  recovery_start_ = std::chrono::steady_clock::now();
+  recovery_running_ = true;
+  recovery_thread_ = std::thread(&KukaEACHardwareInterface::RecoverControl, this);
+}
+
+void KukaEACHardwareInterface::RecoverControl()
+{
+  // The mode of the last reply, the one requested at activation if none was sent
+  const int encoded_mode = encoded_control_mode_;
+  const int control_mode = encoded_mode >= 0 ? encoded_mode : configured_control_mode_;
+  for (int attempt = 1; attempt <= control_recovery_attempts_; ++attempt) {
+    {
+      std::unique_lock<std::mutex> lk(observe_mutex_);
+      const bool stopped = observe_cv_.wait_for(
+        lk, control_recovery_delay_, [this] {return stop_requested_.load();});
+      if (stopped) {
+        break;
+      }
+    }
+    RCLCPP_INFO(
+      rclcpp::get_logger("KukaEACHardwareInterface"),
+      "Re-opening the control channel, attempt %d of %d", attempt, control_recovery_attempts_);
+    // The first request after sampling restarts finishes the recovery in read()
+    recovering_ = true;
+    if (OpenControlChannel(control_mode)) {
+      recovery_running_ = false;
+      return;
+    }
+    recovering_ = false;
+  }
+  if (!stop_requested_) {
+    RCLCPP_ERROR(
+      rclcpp::get_logger("KukaEACHardwareInterface"),
+      "External control could not be re-established, the driver has to be reactivated");
+  }
+  recovery_running_ = false;
+}
+
+void KukaEACHardwareInterface::StopRecovery()
+{
+  {
+    std::lock_guard<std::mutex> lk(observe_mutex_);
+    stop_requested_ = true;
+  }
+  observe_cv_.notify_all();
+  if (recovery_thread_.joinable()) {
+    recovery_thread_.join();
+  }
+}
+
+void KukaEACHardwareInterface::RecordFailure()
+{
+  if (flight_recorder_ != nullptr) {
+    flight_recorder_->Current().flags |= kuka_drivers_core::FlightRecorder::ERROR;
+    flight_recorder_->Commit();
+  }
+}
+
+void KukaEACHardwareInterface::PublishControlEvent(ControlEvent event)
+{
+  {
+    std::lock_guard<std::mutex> lk(observe_mutex_);
+    is_active_ = event == ControlEvent::SAMPLING;
+  }
+  observe_cv_.notify_all();
+  if (!control_events_.Push(event)) {
+    RCLCPP_WARN(
+      rclcpp::get_logger("KukaEACHardwareInterface"),
+      "Control event queue is full, event dropped");
+  }
+}
+
+void KukaEACHardwareInterface::HandleControlEvents()
+{
+  ControlEvent event;
+  while (control_events_.Pop(event)) {
+    if (event != ControlEvent::SAMPLING) {
+      // Sampling restarts with a new first request, which might take longer to arrive
+      cycle_monitor_.Reset();
+      clock_sync_.Reset();
+      receive_timeout_ = CycleMonitor::kFirstRequestTimeout;
+      msg_received_ = false;
+      if (io_thread_options_.enabled) {
+        // The commands of the ended session must not answer the first requests of the next one
+        io_replies_.Back().valid = false;
+        io_replies_.Publish();
+      }
+    }
+  }
+}
+
+bool KukaEACHardwareInterface::ExchangeOnIOThread()
+{
+  // Returns regularly without a request, so that the stop of the thread is noticed
+  kuka_drivers_core::UdpTransport::Packet packet;
+  if (udp_transport_.Receive(packet, kIOReceiveTimeout) <= 0) {
+    return true;
+  }
+  const auto arrival = CycleMonitor::Clock::now();
+
+  IORequest & request = io_requests_.Back();
+  io_state_.positions = request.positions.data();
+  io_state_.torques = request.torques.data();
+  io_state_.velocities = motion_state_.velocities != nullptr ? request.velocities.data() : nullptr;
+  io_state_.joint_count = info_.joints.size();
+  tracing::PhaseBegin(tracing::Phase::DECODE, this);
+  const bool decoded = MotionStateDecoder::Decode(
+    reinterpret_cast<const uint8_t *>(packet.data), packet.size, io_state_);
+  tracing::PhaseEnd(tracing::Phase::DECODE, this);
+  if (!decoded) {
+    if (metrics_.decode_failures != nullptr) {
+      metrics_.decode_failures->Add();
+    }
+    io_error_ = "Decoding request failed";
+    return false;
+  }
+  request.ipoc = io_state_.ipoc;
+  request.ipo_stopped = io_state_.ipo_stopped;
+  request.arrival = arrival;
+  request.timestamp = packet.timestamp;
+  io_requests_.Publish();
+
+  // Answered with the newest commands of write(), until the first one the request is missed
+  io_replies_.Update();
+  const IOReply & reply = io_replies_.Front();
+  if (!reply.valid) {
+    return true;
+  }
+  io_message_ = reply.message;
+  io_message_.header.ipoc = io_state_.ipoc;
+  tracing::PhaseBegin(tracing::Phase::ENCODE, this);
+  const int encoded_bytes = io_encoder_.Encode(io_message_, io_buffer_, sizeof(io_buffer_));
+  tracing::PhaseEnd(tracing::Phase::ENCODE, this);
+  if (encoded_bytes < 0) {
+    io_error_ = "Encoding of control signal to out_buffer failed.";
+    return false;
+  }
+  if (udp_transport_.Send(io_buffer_, static_cast<std::size_t>(encoded_bytes)) < 0) {
+    io_error_ = "Error sending reply";
+    return false;
+  }
+  return true;
+}
+
 }  // namespace namespace kuka_eac
 
 PLUGINLIB_EXPORT_CLASS(
@@ -0,0 +1,236 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Real-time side of the robot controller for the mock setup: sends MotionStateExternal
+// requests with the configured cycle to the driver over UDP and applies the commands of the
+// ControlSignalExternal replies, so that the encoding, decoding and timing of the driver can be
+// run and profiled without a robot. Captured traffic can be sent with wire_replay instead.
+
+#include <arpa/inet.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "kuka_drivers_core/latency_histogram.hpp"
+#include "nanopb-helpers/nanopb_serialization_helper.h"
+
+namespace
+{
+volatile std::sig_atomic_t stop_requested = 0;
+
+void PrintUsage(const char * program)
+{
+  printf(
+    "Usage: %s [options]\n"
+    "  --ip <address>     IP address of the driver (default: 127.0.0.1)\n"
+    "  --port <port>      port of the driver (default: 44444)\n"
+    "  --cycle-ms <ms>    cycle time of the requests (default: 4)\n"
+    "  --joints <count>   number of joints (default: 6)\n"
+    "  --cycles <count>   number of requests, 0 runs until interrupted (default: 0)\n"
+    "  --mode-log <file>  append the steady clock time and the control mode of every reply\n"
+    "                     changing the control mode to the file\n", program);
+}
+
+void SleepUntil(std::chrono::steady_clock::time_point time_point)
+{
+  const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    time_point.time_since_epoch()).count();
+  struct timespec deadline;
+  deadline.tv_sec = ns / 1000000000;
+  deadline.tv_nsec = ns % 1000000000;
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR &&
+    !stop_requested)
+  {
+  }
+}
+}  // namespace
+
+int main(int argc, char * argv[])
+{
+  static const struct option kOptions[] = {
+    {"ip", required_argument, nullptr, 'i'},
+    {"port", required_argument, nullptr, 'p'},
+    {"cycle-ms", required_argument, nullptr, 'c'},
+    {"joints", required_argument, nullptr, 'j'},
+    {"cycles", required_argument, nullptr, 'n'},
+    {"mode-log", required_argument, nullptr, 'l'},
+    {"help", no_argument, nullptr, 'h'},
+    {nullptr, 0, nullptr, 0}};
+
+  std::string ip = "127.0.0.1";
+  int port = 44444;
+  int cycle_ms = 4;
+  int joints = 6;
+  uint64_t cycles = 0;
+  std::string mode_log_path;
+  int option;
+  while ((option = getopt_long(argc, argv, "h", kOptions, nullptr)) != -1) {
+    switch (option) {
+      case 'i': ip = optarg; break;
+      case 'p': port = std::atoi(optarg); break;
+      case 'c': cycle_ms = std::atoi(optarg); break;
+      case 'j': joints = std::atoi(optarg); break;
+      case 'n': cycles = std::strtoull(optarg, nullptr, 10); break;
+      case 'l': mode_log_path = optarg; break;
+      default:
+        PrintUsage(argv[0]);
+        return option == 'h' ? 0 : 1;
+    }
+  }
+  if (optind != argc || cycle_ms <= 0 || joints <= 0 || joints > 24) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  struct sockaddr_in driver_address;
+  memset(&driver_address, 0, sizeof(driver_address));
+  driver_address.sin_family = AF_INET;
+  driver_address.sin_addr.s_addr = inet_addr(ip.c_str());
+  driver_address.sin_port = htons(static_cast<uint16_t>(port));
+  if (fd < 0 ||
+    connect(fd, reinterpret_cast<struct sockaddr *>(&driver_address), sizeof(driver_address)) < 0)
+  {
+    fprintf(stderr, "Error connecting to %s:%i: %s\n", ip.c_str(), port, strerror(errno));
+    return 1;
+  }
+  FILE * mode_log = nullptr;
+  if (!mode_log_path.empty() && (mode_log = fopen(mode_log_path.c_str(), "a")) == nullptr) {
+    fprintf(stderr, "Error opening %s: %s\n", mode_log_path.c_str(), strerror(errno));
+    return 1;
+  }
+  std::signal(SIGINT, [](int) {stop_requested = 1;});
+
+  // Start from the home position of the mock hardware
+  kuka_ecs_v1_MotionStateExternal state = kuka_ecs_v1_MotionStateExternal_init_default;
+  state.has_header = true;
+  state.has_motion_state = true;
+  state.motion_state.control_mode = kuka_motion_external_ExternalControlMode_JOINT_POSITION_CONTROL;
+  auto & motion_state = state.motion_state;
+  motion_state.has_measured_positions = true;
+  motion_state.measured_positions.values_count = joints;
+  motion_state.has_measured_torques = true;
+  motion_state.measured_torques.values_count = joints;
+  motion_state.has_measured_velocities = true;
+  motion_state.measured_velocities.values_count = joints;
+  const double home[] = {0, -M_PI / 2, M_PI / 2, 0, M_PI / 2, 0};
+  for (int i = 0; i < joints && i < 6; ++i) {
+    motion_state.measured_positions.values[i] = home[i];
+  }
+
+  kuka_drivers_core::LatencyHistogram<> latency;
+  uint64_t sent = 0;
+  uint64_t missing_replies = 0;
+  uint64_t invalid_replies = 0;
+  uint8_t out_buffer[1500];
+  uint8_t in_buffer[1500];
+  kuka_ecs_v1_ControlSignalExternal reply;
+
+  const auto cycle = std::chrono::milliseconds(cycle_ms);
+  auto next_cycle = std::chrono::steady_clock::now();
+  for (uint32_t ipoc = 0; !stop_requested && (cycles == 0 || sent < cycles); ++ipoc) {
+    SleepUntil(next_cycle);
+    next_cycle += cycle;
+
+    state.header.ipoc = ipoc;
+    const int size = nanopb::Encode(state, out_buffer, sizeof(out_buffer));
+    const auto send_time = std::chrono::steady_clock::now();
+    if (size < 0 || send(fd, out_buffer, size, 0) < 0) {
+      fprintf(stderr, "Error in send: %s\n", strerror(errno));
+      return 1;
+    }
+    ++sent;
+
+    // The reply must arrive within the cycle, as on the real controller
+    struct pollfd poll_fd = {fd, POLLIN, 0};
+    const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+      next_cycle - std::chrono::steady_clock::now()).count();
+    ssize_t bytes = -1;
+    if (poll(&poll_fd, 1, std::max<int>(static_cast<int>(remaining), 0)) > 0) {
+      bytes = recv(fd, in_buffer, sizeof(in_buffer), 0);
+    }
+    if (bytes < 0) {
+      ++missing_replies;
+      continue;
+    }
+    latency.Record(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - send_time).count());
+    if (!nanopb::Decode(in_buffer, bytes, reply) || reply.header.ipoc != ipoc) {
+      ++invalid_replies;
+      continue;
+    }
+
+    // The commands are applied ideally: the measured values follow them in the next cycle
+    const auto & signal = reply.control_signal;
+    double previous_positions[sizeof(motion_state.measured_positions.values) / sizeof(double)];
+    std::copy_n(motion_state.measured_positions.values, joints, previous_positions);
+    if (signal.has_joint_command) {
+      std::copy(
+        signal.joint_command.values, signal.joint_command.values + std::min<int>(
+          signal.joint_command.values_count, joints), motion_state.measured_positions.values);
+    }
+    if (signal.has_joint_velocity_command) {
+      for (int i = 0; i < joints && i < signal.joint_velocity_command.values_count; ++i) {
+        motion_state.measured_positions.values[i] += signal.joint_velocity_command.values[i] *
+          std::chrono::duration<double>(cycle).count();
+      }
+    }
+    if (signal.has_joint_torque_command) {
+      std::copy(
+        signal.joint_torque_command.values, signal.joint_torque_command.values + std::min<int>(
+          signal.joint_torque_command.values_count, joints), motion_state.measured_torques.values);
+    }
+    for (int i = 0; i < joints; ++i) {
+      motion_state.measured_velocities.values[i] = (motion_state.measured_positions.values[i] -
+        previous_positions[i]) / std::chrono::duration<double>(cycle).count();
+    }
+    // The first reply in the new mode, the end of a control mode switch seen from the robot
+    if (mode_log != nullptr && signal.control_mode != motion_state.control_mode) {
+      const int64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+      fprintf(mode_log, "%" PRId64 " %d\n", now_ns, static_cast<int>(signal.control_mode));
+      fflush(mode_log);
+    }
+    motion_state.control_mode = signal.control_mode;
+    motion_state.ipo_stopped = signal.stop_ipo;
+  }
+  close(fd);
+  if (mode_log != nullptr) {
+    fclose(mode_log);
+  }
+
+  const auto snapshot = latency.GetSnapshot();
+  printf(
+    "sent: %lu, replies: %lu, missing replies: %lu, invalid replies: %lu\n", sent,
+    snapshot.count, missing_replies, invalid_replies);
+  printf(
+    "reply latency [us] p50: %lu, p90: %lu, p99: %lu, p99.9: %lu, max: %lu\n",
+    snapshot.Percentile(50) / 1000, snapshot.Percentile(90) / 1000,
+    snapshot.Percentile(99) / 1000, snapshot.Percentile(99.9) / 1000, snapshot.max_ns / 1000);
+  return 0;
+}
@@ -12,8 +12,11 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <google/protobuf/arena.h>
 #include <grpcpp/create_channel.h>
 
+#include <cstddef>
+
 #include "communication_helpers/ros2_control_tools.hpp"
 #include "communication_helpers/service_tools.hpp"
 
@@ -27,8 +30,8 @@ namespace kuka_eac
 {
 // TODO(Komaromi): Readd "control_mode_handler" controller to controller_handlers constrctor
 // after controller handler poperly implemented with working initial control mode change
-RobotManagerNode::RobotManagerNode()
-: kuka_drivers_core::ROS2BaseLCNode("robot_manager"),
+RobotManagerNode::RobotManagerNode(const rclcpp::NodeOptions & options)
+: kuka_drivers_core::ROS2BaseLCNode("robot_manager", options),
   controller_handler_({"joint_state_broadcaster", })
 #ifdef NON_MOCK_SETUP
   , control_mode_change_finished_(false)
@@ -38,7 +41,8 @@ RobotManagerNode::RobotManagerNode()
 
   auto qos = rclcpp::QoS(rclcpp::KeepLast(10));
   qos.reliable();
-  cbg_ = this->create_callback_group(rclcpp::CallbackGroupType::MutuallyExclusive);
+  // The responses awaited in the transitions and control mode changes
+  cbg_ = this->createDedicatedCallbackGroup();
   change_hardware_state_client_ =
     this->create_client<SetHardwareComponentState>(
     "controller_manager/set_hardware_component_state", qos.get_rmw_qos_profile(), cbg_
@@ -58,6 +62,11 @@ RobotManagerNode::RobotManagerNode()
   control_mode_pub_ = this->create_publisher<std_msgs::msg::UInt32>(
     "control_mode_handler/control_mode", rclcpp::SystemDefaultsQoS()
   );
+  switch_trace_ = std::make_unique<kuka_drivers_core::SwitchTrace>(*this);
+  // The profile of the last bring-up is kept for late subscribers
+  startup_profile_.SetComponent(get_fully_qualified_name());
+  startup_profile_pub_ = rclcpp::create_publisher<diagnostic_msgs::msg::DiagnosticStatus>(
+    *this, "~/startup_profile", rclcpp::QoS(rclcpp::KeepLast(1)).reliable().transient_local());
 
   // Register parameters
   this->registerParameter<std::string>(
@@ -74,6 +83,34 @@ RobotManagerNode::RobotManagerNode()
         kuka_drivers_core::ControllerType::JOINT_IMPEDANCE_CONTROLLER_TYPE,
         controller_name);
     });
+  this->registerParameter<std::string>(
+    "velocity_controller_name", "", kuka_drivers_core::ParameterSetAccessRights {true, true,
+      false, false, false}, [this](const std::string & controller_name) {
+      return this->controller_handler_.UpdateControllerName(
+        kuka_drivers_core::ControllerType::JOINT_VELOCITY_CONTROLLER_TYPE,
+        controller_name);
+    });
+  this->registerParameter<std::string>(
+    "cartesian_position_controller_name", "", kuka_drivers_core::ParameterSetAccessRights {true, true,
+      false, false, false}, [this](const std::string & controller_name) {
+      return this->controller_handler_.UpdateControllerName(
+        kuka_drivers_core::ControllerType::CARTESIAN_POSITION_CONTROLLER_TYPE,
+        controller_name);
+    });
+  this->registerParameter<std::string>(
+    "twist_controller_name", "", kuka_drivers_core::ParameterSetAccessRights {true, true,
+      false, false, false}, [this](const std::string & controller_name) {
+      return this->controller_handler_.UpdateControllerName(
+        kuka_drivers_core::ControllerType::TWIST_CONTROLLER_TYPE,
+        controller_name);
+    });
+  this->registerParameter<std::string>(
+    "wrench_controller_name", "", kuka_drivers_core::ParameterSetAccessRights {true, true,
+      false, false, false}, [this](const std::string & controller_name) {
+      return this->controller_handler_.UpdateControllerName(
+        kuka_drivers_core::ControllerType::WRENCH_CONTROLLER_TYPE,
+        controller_name);
+    });
   this->registerParameter<std::string>(
     "torque_controller_name", "", kuka_drivers_core::ParameterSetAccessRights {true, true, false,
       false, false}, [this](const std::string & controller_name) {
@@ -81,17 +118,41 @@ RobotManagerNode::RobotManagerNode()
         kuka_drivers_core::ControllerType::TORQUE_CONTROLLER_TYPE,
         controller_name);
     });
+  this->registerStaticParameter<int>(
+    "cycle_time", DEFAULT_CYCLE_TIME_MS,
+    kuka_drivers_core::ParameterSetAccessRights{true, false,
+      false, false, false}, [this](int cycle_time) {
+      return this->onCycleTimeChangeRequest(cycle_time);
+    });
+  // Switches the controllers of a new control mode in one step, in the cycle of the mode change,
+  //  needs control_mode_handover in the hardware parameters as well
+  this->registerStaticParameter<bool>(
+    "control_mode_handover", false, kuka_drivers_core::ParameterSetAccessRights {true, false,
+      false, false, false}, [](bool) {
+      return true;
+    });
   this->registerParameter<int>(
     "control_mode", static_cast<int>(ExternalControlMode::JOINT_POSITION_CONTROL),
     kuka_drivers_core::ParameterSetAccessRights{true, true,
       true, false, false}, [this](int control_mode) {
-      return this->onControlModeChangeRequest(control_mode);
+      switch_trace_->Start(
+        "control_mode " + (param_declared_ ?
+        std::to_string(this->get_parameter("control_mode").as_int()) + " -> " : "") +
+        std::to_string(control_mode));
+      const bool success = this->onControlModeChangeRequest(control_mode);
+      switch_trace_->Finish(success);
+      return success;
     });
   this->registerStaticParameter<std::string>(
     "controller_ip", "", kuka_drivers_core::ParameterSetAccessRights {true, false, false,
       false, false}, [this](const std::string &) {
       return true;
     });
+  this->registerStaticParameter<int>(
+    "control_recovery_timeout_ms", 0, kuka_drivers_core::ParameterSetAccessRights {true, false,
+      false, false, false}, [this](int timeout) {
+      return timeout >= 0;
+    });
   this->registerStaticParameter<std::string>(
     "robot_model", "lbr_iisy3_r760",
     kuka_drivers_core::ParameterSetAccessRights{true, false,
@@ -122,17 +183,37 @@ RobotManagerNode::~RobotManagerNode()
   if (observe_thread_.joinable()) {
     observe_thread_.join();
   }
+  StopRecoveryWatch();
 }
 
 rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn
 RobotManagerNode::on_configure(const rclcpp_lifecycle::State &)
+{
+  kuka_drivers_core::tracing::ScopedTransition trace(get_name(), "configure");
+  // A bring-up starts with the configuration, its profile is published if it ends here
+  startup_profile_.Reset();
+  rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn result;
+  {
+    kuka_drivers_core::StartupProfile::Scope phase(startup_profile_, "on_configure");
+    result = Configure();
+  }
+  if (result != SUCCESS) {
+    PublishStartupProfile(false);
+  }
+  return result;
+}
+
+rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn
+RobotManagerNode::Configure()
 {
   // Publish control mode paramater
   auto message = std_msgs::msg::UInt32();
   message.data = static_cast<uint32_t>(this->get_parameter("control_mode").as_int());
   control_mode_pub_->publish(message);
 
-  // Configure hardware interface
+  // Configure hardware interface, which sets the QoS profile through gRPC
+  kuka_drivers_core::StartupProfile::Scope hardware_phase(
+    startup_profile_, "on_configure/configure_hardware");
   if (!kuka_drivers_core::changeHardwareState(
       change_hardware_state_client_, robot_model_,
       State::PRIMARY_STATE_INACTIVE))
@@ -140,12 +221,15 @@ RobotManagerNode::on_configure(const rclcpp_lifecycle::State &)
     RCLCPP_ERROR(get_logger(), "Could not configure hardware interface");
     return FAILURE;
   }
+  hardware_phase.Finish();
 
   is_configured_pub_->on_activate();
   is_configured_msg_.data = true;
   is_configured_pub_->publish(is_configured_msg_);
 
   // Activate control mode handler
+  kuka_drivers_core::StartupProfile::Scope controller_phase(
+    startup_profile_, "on_configure/activate_control_mode_handler");
   if (!kuka_drivers_core::changeControllerState(
       change_controller_state_client_, {"control_mode_handler"}, {}))
   {
@@ -154,6 +238,7 @@ RobotManagerNode::on_configure(const rclcpp_lifecycle::State &)
     this->on_cleanup(get_current_state());
     return FAILURE;
   }
+  controller_phase.Finish();
 
   RCLCPP_INFO(get_logger(), "Activated control mode handler");
 
@@ -163,6 +248,7 @@ RobotManagerNode::on_configure(const rclcpp_lifecycle::State &)
 rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn
 RobotManagerNode::on_cleanup(const rclcpp_lifecycle::State &)
 {
+  kuka_drivers_core::tracing::ScopedTransition trace(get_name(), "cleanup");
   // Deactivate control mode handler
   if (!kuka_drivers_core::changeControllerState(
       change_controller_state_client_, {},
@@ -193,11 +279,18 @@ void RobotManagerNode::ObserveControl()
 {
   #ifdef NON_MOCK_SETUP
   context_ = std::make_unique<::grpc::ClientContext>();
-  kuka::ecs::v1::ObserveControlStateRequest observe_request;
+  // The events are parsed into the same message on an arena, see the hardware interface
+  alignas(std::max_align_t) char arena_block[4096];
+  google::protobuf::ArenaOptions arena_options;
+  arena_options.initial_block = arena_block;
+  arena_options.initial_block_size = sizeof(arena_block);
+  google::protobuf::Arena arena(arena_options);
+  auto * observe_request =
+    google::protobuf::Arena::CreateMessage<kuka::ecs::v1::ObserveControlStateRequest>(&arena);
   std::unique_ptr<grpc::ClientReader<kuka::ecs::v1::CommandState>> reader(
-    stub_->ObserveControlState(context_.get(), observe_request));
+    stub_->ObserveControlState(context_.get(), *observe_request));
 
-  kuka::ecs::v1::CommandState response;
+  auto & response = *google::protobuf::Arena::CreateMessage<kuka::ecs::v1::CommandState>(&arena);
 
   while (reader->Read(&response)) {
     switch (static_cast<int>(response.event())) {
@@ -206,11 +299,34 @@ void RobotManagerNode::ObserveControl()
           std::lock_guard<std::mutex> lk(control_mode_cv_m_);
           control_mode_change_finished_ = true;
         }
+        switch_trace_->Mark("control_mode_switch_event");
         RCLCPP_INFO(get_logger(), "Command mode switched in the robot controller");
         control_mode_cv_.notify_all();
         break;
-      case kuka::ecs::v1::CommandEvent::STOPPED:
+      case kuka::ecs::v1::CommandEvent::SAMPLING:
+        switch_trace_->Mark("sampling_event");
+        {
+          std::lock_guard<std::mutex> lk(recovery_m_);
+          recovery_pending_ = false;
+        }
+        recovery_cv_.notify_all();
+        break;
       case kuka::ecs::v1::CommandEvent::ERROR:
+        if (this->get_parameter("control_recovery_timeout_ms").as_int() > 0 &&
+          this->get_current_state().id() == State::PRIMARY_STATE_ACTIVE)
+        {
+          WatchRecovery();
+          break;
+        }
+        [[fallthrough]];
+      case kuka::ecs::v1::CommandEvent::STOPPED:
+        {
+          // The session ended by the error is being re-established
+          std::lock_guard<std::mutex> lk(recovery_m_);
+          if (recovery_pending_ && !recovery_cancelled_) {
+            break;
+          }
+        }
         RCLCPP_INFO(get_logger(), "External control stopped");
         terminate_ = true;
         if (this->get_current_state().id() == State::PRIMARY_STATE_ACTIVE) {
@@ -227,9 +343,67 @@ void RobotManagerNode::ObserveControl()
 #endif
 }
 
+void RobotManagerNode::WatchRecovery()
+{
+  // A previous watch has already finished, as the error follows a successful recovery
+  StopRecoveryWatch();
+  const auto timeout =
+    std::chrono::milliseconds(this->get_parameter("control_recovery_timeout_ms").as_int());
+  RCLCPP_WARN(
+    get_logger(), "External control stopped by an error, waiting %li ms for the hardware "
+    "interface to re-establish it", timeout.count());
+  recovery_pending_ = true;
+  recovery_cancelled_ = false;
+  recovery_thread_ = std::thread(
+    [this, timeout]() {
+      std::unique_lock<std::mutex> lk(recovery_m_);
+      if (recovery_cv_.wait_for(
+        lk, timeout, [this] {return !recovery_pending_ || recovery_cancelled_;}))
+      {
+        if (!recovery_cancelled_) {
+          RCLCPP_INFO(get_logger(), "External control re-established");
+        }
+        return;
+      }
+      lk.unlock();
+      RCLCPP_ERROR(get_logger(), "External control was not re-established in time");
+      terminate_ = true;
+      if (this->get_current_state().id() == State::PRIMARY_STATE_ACTIVE) {
+        this->deactivate();
+      }
+    });
+}
+
+void RobotManagerNode::StopRecoveryWatch()
+{
+  {
+    std::lock_guard<std::mutex> lk(recovery_m_);
+    recovery_cancelled_ = true;
+  }
+  recovery_cv_.notify_all();
+  if (recovery_thread_.joinable() && recovery_thread_.get_id() != std::this_thread::get_id()) {
+    recovery_thread_.join();
+  }
+}
+
 // TODO(Svastits): rollback in case of failures
 rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn
 RobotManagerNode::on_activate(const rclcpp_lifecycle::State &)
+{
+  kuka_drivers_core::tracing::ScopedTransition trace(get_name(), "activate");
+  rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn result;
+  {
+    kuka_drivers_core::StartupProfile::Scope phase(startup_profile_, "on_activate");
+    result = Activate();
+  }
+  // A reactivation after on_deactivate() is profiled on its own
+  PublishStartupProfile(result == SUCCESS);
+  startup_profile_.Reset();
+  return result;
+}
+
+rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn
+RobotManagerNode::Activate()
 {
 #ifdef NON_MOCK_SETUP
   if (context_ != nullptr) {
@@ -244,7 +418,9 @@ RobotManagerNode::on_activate(const rclcpp_lifecycle::State &)
   // Subscribe to stream of state changes
   observe_thread_ = std::thread(&RobotManagerNode::ObserveControl, this);
 
-  // Activate hardware interface
+  // Activate hardware interface, which opens the control channel through gRPC
+  kuka_drivers_core::StartupProfile::Scope hardware_phase(
+    startup_profile_, "on_activate/activate_hardware");
   if (!kuka_drivers_core::changeHardwareState(
       change_hardware_state_client_, robot_model_,
       State::PRIMARY_STATE_ACTIVE, 5000))
@@ -252,6 +428,7 @@ RobotManagerNode::on_activate(const rclcpp_lifecycle::State &)
     RCLCPP_ERROR(get_logger(), "Could not activate hardware interface");
     return FAILURE;
   }
+  hardware_phase.Finish();
 
   // Select controllers
   auto control_mode = this->get_parameter("control_mode").as_int();
@@ -274,6 +451,8 @@ RobotManagerNode::on_activate(const rclcpp_lifecycle::State &)
   }
 
   // Activate RT controller(s)
+  kuka_drivers_core::StartupProfile::Scope controller_phase(
+    startup_profile_, "on_activate/activate_controllers");
   if (!kuka_drivers_core::changeControllerState(
       change_controller_state_client_, new_controllers.first,
       new_controllers.second))
@@ -282,6 +461,7 @@ RobotManagerNode::on_activate(const rclcpp_lifecycle::State &)
     this->on_deactivate(get_current_state());
     return FAILURE;
   }
+  controller_phase.Finish();
 
   controller_handler_.ApproveControllerActivation();
   if (!controller_handler_.ApproveControllerDeactivation()) {
@@ -302,25 +482,29 @@ RobotManagerNode::on_activate(const rclcpp_lifecycle::State &)
   return SUCCESS;
 }
 
+void RobotManagerNode::PublishStartupProfile(bool successful)
+{
+  startup_profile_.Log(get_logger());
+  startup_profile_pub_->publish(startup_profile_.ToStatus(successful));
+}
+
 rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn
 RobotManagerNode::on_deactivate(const rclcpp_lifecycle::State &)
 {
+  kuka_drivers_core::tracing::ScopedTransition trace(get_name(), "deactivate");
+  StopRecoveryWatch();
   // Deactivate hardware interface
   // Deactivation was not stable with 2000 ms timeout
-  if (!kuka_drivers_core::changeHardwareState(
-      change_hardware_state_client_, robot_model_,
-      State::PRIMARY_STATE_INACTIVE, 3000))
-  {
-    RCLCPP_ERROR(get_logger(), "Could not deactivate hardware interface");
-    return ERROR;
-  }
-
-  // Stop RT controllers
-  if (!kuka_drivers_core::changeControllerState(
-      change_controller_state_client_, {},
-      controller_handler_.GetControllersForDeactivation(), SwitchController::Request::BEST_EFFORT))
-  {
-    RCLCPP_ERROR(get_logger(), "Could not stop RT controllers");
+  // The RT controllers are stopped in the same round trip
+  kuka_drivers_core::ControlTransition transition(get_logger());
+  transition.phase("deactivation")
+  .changeHardwareState(
+    change_hardware_state_client_, robot_model_, State::PRIMARY_STATE_INACTIVE, 3000)
+  .changeControllerState(
+    change_controller_state_client_, {},
+    controller_handler_.GetControllersForDeactivation(), SwitchController::Request::BEST_EFFORT);
+  if (!transition.execute()) {
+    RCLCPP_ERROR(get_logger(), "Could not deactivate hardware interface and stop RT controllers");
     return ERROR;
   }
 
@@ -342,19 +526,22 @@ bool RobotManagerNode::onControlModeChangeRequest(int control_mode)
   }
 
   RCLCPP_INFO(get_logger(), "Control mode change requested");
-  // TODO(komaromi): Remove this if a new control mode is supported
+  // TODO(komaromi): Remove this if Cartesian impedance control is supported
   if (control_mode ==
-    static_cast<int>(kuka_drivers_core::ControlMode::CARTESIAN_POSITION_CONTROL) ||
-    control_mode ==
-    static_cast<int>(kuka_drivers_core::ControlMode::CARTESIAN_IMPEDANCE_CONTROL) ||
-    control_mode == static_cast<int>(kuka_drivers_core::ControlMode::WRENCH_CONTROL) ||
-    control_mode == static_cast<int>(kuka_drivers_core::ControlMode::JOINT_VELOCITY_CONTROL) ||
-    control_mode == static_cast<int>(kuka_drivers_core::ControlMode::CARTESIAN_VELOCITY_CONTROL))
+    static_cast<int>(kuka_drivers_core::ControlMode::CARTESIAN_IMPEDANCE_CONTROL))
   {
     RCLCPP_ERROR(get_logger(), "Tried to change to a not implemented control mode");
     return false;
   }
 
+  const int cycle_time = static_cast<int>(this->get_parameter("cycle_time").as_int());
+  if (!IsCycleTimeSupported(cycle_time, control_mode)) {
+    RCLCPP_ERROR(
+      get_logger(), "Control mode %i is not supported with the cycle time of %i ms",
+      control_mode, cycle_time);
+    return false;
+  }
+
   std::pair<std::vector<std::string>, std::vector<std::string>> switch_controllers;
 
   bool is_active_state = get_current_state().id() ==
@@ -368,6 +555,19 @@ bool RobotManagerNode::onControlModeChangeRequest(int control_mode)
     RCLCPP_ERROR(get_logger(), "Error while control mode change: %s", e.what());
     return false;
   }
+  switch_trace_->Mark("controllers_for_switch");
+
+  if (is_active_state && this->get_parameter("control_mode_handover").as_bool()) {
+    if (!HandOverControlMode(control_mode, switch_controllers)) {
+      // TODO(Svastits): this can be removed if rollback is implemented properly
+      this->on_deactivate(get_current_state());
+      return false;
+    }
+    RCLCPP_INFO(
+      get_logger(), "Successfully handed over control mode to %s", ExternalControlMode_Name(
+        control_mode).c_str());
+    return true;
+  }
 
   // Activate controllers needed for the new control mode
   if (is_active_state) {
@@ -380,37 +580,24 @@ bool RobotManagerNode::onControlModeChangeRequest(int control_mode)
       return false;
     }
     controller_handler_.ApproveControllerActivation();
+    switch_trace_->Mark("activate_controllers");
   }
 
   // Publish the control mode to controller handler
   auto message = std_msgs::msg::UInt32();
   message.data = control_mode;
   control_mode_pub_->publish(message);
+  switch_trace_->Mark("control_mode_published");
   RCLCPP_INFO(get_logger(), "Control mode change process has started");
 
   if (is_active_state) {
     // The driver is in active state
 
-#ifdef NON_MOCK_SETUP
-    // Wait for ObserveControl to approve that the robot succefully changed control mode
-    std::unique_lock<std::mutex> control_mode_lk(this->control_mode_cv_m_);
-
-    if (!this->control_mode_cv_.wait_for(
-        control_mode_lk, std::chrono::milliseconds(2000), [this]() {
-          return this->control_mode_change_finished_;
-        }))
-    {
-      // Control Mode change timeout reached
-      RCLCPP_ERROR(
-        get_logger(),
-        "Timeout reached while waiting for robot to change control mode.");
+    if (!WaitForControlModeSwitch()) {
       this->on_deactivate(get_current_state());
       return false;
     }
-    control_mode_change_finished_ = false;
-    control_mode_lk.unlock();
-    RCLCPP_INFO(get_logger(), "Robot Controller finished control mode change");
-#endif
+    switch_trace_->Mark("control_mode_switch_confirmed");
 
     // Deactivate unnecessary controllers
     if (!switch_controllers.second.empty() && !kuka_drivers_core::changeControllerState(
@@ -427,6 +614,7 @@ bool RobotManagerNode::onControlModeChangeRequest(int control_mode)
         "Controller handler state is improper, active controller list was modified"
         "before approval");
     }
+    switch_trace_->Mark("deactivate_controllers");
   }
 
   RCLCPP_INFO(
@@ -436,6 +624,73 @@ bool RobotManagerNode::onControlModeChangeRequest(int control_mode)
   return true;
 }
 
+bool RobotManagerNode::HandOverControlMode(
+  int control_mode, const kuka_drivers_core::ControllerHandler::SwitchLists & switch_controllers)
+{
+  // The hardware interface keeps encoding the current mode until the controllers are switched,
+  //  the controllers of the new mode are loaded and configured at startup
+  auto message = std_msgs::msg::UInt32();
+  message.data = control_mode;
+  control_mode_pub_->publish(message);
+  switch_trace_->Mark("control_mode_published");
+
+  // The new controllers are activated and the old ones deactivated in the same cycle, in which
+  //  the hardware interface seeds their commands and changes the mode on the wire
+  if (!switch_controllers.first.empty() || !switch_controllers.second.empty()) {
+    if (!kuka_drivers_core::changeControllerState(
+        change_controller_state_client_, switch_controllers.first, switch_controllers.second))
+    {
+      RCLCPP_ERROR(get_logger(), "Could not switch controllers for new control mode");
+      return false;
+    }
+    controller_handler_.ApproveControllerActivation();
+    if (!controller_handler_.ApproveControllerDeactivation()) {
+      RCLCPP_ERROR(
+        get_logger(),
+        "Controller handler state is improper, active controller list was modified"
+        "before approval");
+    }
+    switch_trace_->Mark("switch_controllers");
+  }
+  // Only confirms the switch, the commands of the new mode are sent already
+  return WaitForControlModeSwitch();
+}
+
+bool RobotManagerNode::WaitForControlModeSwitch()
+{
+#ifdef NON_MOCK_SETUP
+  // Wait for ObserveControl to approve that the robot succefully changed control mode
+  std::unique_lock<std::mutex> control_mode_lk(this->control_mode_cv_m_);
+
+  if (!this->control_mode_cv_.wait_for(
+      control_mode_lk, std::chrono::milliseconds(2000), [this]() {
+        return this->control_mode_change_finished_;
+      }))
+  {
+    // Control Mode change timeout reached
+    RCLCPP_ERROR(
+      get_logger(),
+      "Timeout reached while waiting for robot to change control mode.");
+    return false;
+  }
+  control_mode_change_finished_ = false;
+  control_mode_lk.unlock();
+  RCLCPP_INFO(get_logger(), "Robot Controller finished control mode change");
+#endif
+  return true;
+}
+
+bool RobotManagerNode::onCycleTimeChangeRequest(int cycle_time)
+{
+  if (!IsCycleTimeSupported(cycle_time)) {
+    RCLCPP_ERROR(
+      get_logger(), "Cycle time of %i ms is not supported, use 1, 2 or 4 ms", cycle_time);
+    return false;
+  }
+  RCLCPP_INFO(get_logger(), "External control cycle time: %i ms", cycle_time);
+  return true;
+}
+
 bool RobotManagerNode::onRobotModelChangeRequest(const std::string & robot_model)
 {
   robot_model_ = robot_model;
@@ -443,15 +698,7 @@ bool RobotManagerNode::onRobotModelChangeRequest(const std::string & robot_model
 }
 }  // namespace kuka_eac
 
-int main(int argc, char * argv[])
-{
-  setvbuf(stdout, nullptr, _IONBF, BUFSIZ);
-
-  rclcpp::init(argc, argv);
-  rclcpp::executors::MultiThreadedExecutor executor;
-  auto node = std::make_shared<kuka_eac::RobotManagerNode>();
-  executor.add_node(node->get_node_base_interface());
-  executor.spin();
-  rclcpp::shutdown();
-  return 0;
-}
+#include "rclcpp_components/register_node_macro.hpp"
+
+// Loadable into the process of the controller_manager, see the composed deployment
+RCLCPP_COMPONENTS_REGISTER_NODE(kuka_eac::RobotManagerNode)
@@ -0,0 +1,117 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <benchmark/benchmark.h>
+#include <tinyxml.h>
+
+#include <string>
+#include <vector>
+
+#include "kuka_drivers_core/wire_capture.hpp"
+#include "kuka_kss_rsi_driver/rsi_command.h"
+
+namespace
+{
+using kuka_drivers_core::WireCapture;
+
+struct Command
+{
+  std::vector<double> joint_position_correction = std::vector<double>(6, 0.0);
+  uint64_t ipoc = 0;
+  bool stop = false;
+};
+
+// Commands of the replies in a session with the RSI simulator, recorded with the capture_file
+//   parameter
+const std::vector<Command> & recordedCommands()
+{
+  static const std::vector<Command> commands = []() {
+      std::vector<Command> result;
+      const char * axes[] = {"A1", "A2", "A3", "A4", "A5", "A6"};
+      for (const auto & datagram : WireCapture::ReadFile(TEST_DATA_DIR "/rsi_session.wcap")) {
+        if (datagram.direction != WireCapture::Direction::SENT) {
+          continue;
+        }
+        TiXmlDocument doc;
+        doc.Parse(datagram.data.c_str());
+        TiXmlElement * sen = doc.FirstChildElement("Sen");
+        Command command;
+        for (size_t i = 0; i < 6; ++i) {
+          sen->FirstChildElement("AK")->Attribute(axes[i], &command.joint_position_correction[i]);
+        }
+        command.ipoc = std::stoull(sen->FirstChildElement("IPOC")->FirstChild()->Value());
+        command.stop = std::string(sen->FirstChildElement("Stop")->FirstChild()->Value()) == "1";
+        result.push_back(command);
+      }
+      return result;
+    }();
+  return commands;
+}
+
+// The DOM based rendering used by RSICommand before the in-place serializer, kept as reference
+std::string renderWithTinyXml(
+  const std::vector<double> & joint_position_correction, uint64_t ipoc, bool stop)
+{
+  const char * axes[] = {"A1", "A2", "A3", "A4", "A5", "A6"};
+  TiXmlDocument doc;
+  TiXmlElement * root = new TiXmlElement("Sen");
+  root->SetAttribute("Type", "KROSHU");
+  TiXmlElement * el = new TiXmlElement("AK");
+  for (size_t i = 0; i < 6; ++i) {
+    el->SetAttribute(axes[i], std::to_string(joint_position_correction[i]));
+  }
+  root->LinkEndChild(el);
+
+  el = new TiXmlElement("Stop");
+  el->LinkEndChild(new TiXmlText(std::to_string(static_cast<int>(stop))));
+  root->LinkEndChild(el);
+
+  el = new TiXmlElement("IPOC");
+  el->LinkEndChild(new TiXmlText(std::to_string(ipoc)));
+  root->LinkEndChild(el);
+  doc.LinkEndChild(root);
+  TiXmlPrinter printer;
+  printer.SetStreamPrinting();
+  doc.Accept(&printer);
+  return printer.Str();
+}
+void BM_RenderTinyXml(benchmark::State & state)
+{
+  const auto & commands = recordedCommands();
+  std::size_t i = 0;
+  for (auto _ : state) {
+    const Command & command = commands[i++ % commands.size()];
+    std::string out_buffer =
+      renderWithTinyXml(command.joint_position_correction, command.ipoc, command.stop);
+    benchmark::DoNotOptimize(out_buffer.data());
+  }
+}
+BENCHMARK(BM_RenderTinyXml);
+
+void BM_RenderInPlace(benchmark::State & state)
+{
+  const auto & commands = recordedCommands();
+  kuka_kss_rsi_driver::RSICommand rendered;
+  std::size_t i = 0;
+  for (auto _ : state) {
+    const Command & command = commands[i++ % commands.size()];
+    benchmark::DoNotOptimize(
+      rendered.encode(command.joint_position_correction, command.ipoc, command.stop));
+    benchmark::DoNotOptimize(rendered.data());
+  }
+}
+BENCHMARK(BM_RenderInPlace);
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,94 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <benchmark/benchmark.h>
+#include <tinyxml.h>
+
+#include <string>
+#include <vector>
+
+#include "kuka_drivers_core/wire_capture.hpp"
+#include "kuka_kss_rsi_driver/rsi_state.h"
+
+namespace
+{
+using kuka_drivers_core::WireCapture;
+
+// State messages of a session of the RSI simulator, recorded with the capture_file parameter
+const std::vector<std::string> & recordedStates()
+{
+  static const std::vector<std::string> states = []() {
+      std::vector<std::string> payloads;
+      for (auto & datagram : WireCapture::ReadFile(TEST_DATA_DIR "/rsi_session.wcap")) {
+        if (datagram.direction == WireCapture::Direction::RECEIVED) {
+          payloads.push_back(std::move(datagram.data));
+        }
+      }
+      return payloads;
+    }();
+  return states;
+}
+
+// The DOM based parsing used by RSIState before the in-place parser, kept as reference
+struct TinyXmlState
+{
+  explicit TinyXmlState(const std::string & xml_doc)
+  {
+    TiXmlDocument bufferdoc;
+    bufferdoc.Parse(xml_doc.c_str());
+    TiXmlElement * rob = bufferdoc.FirstChildElement("Rob");
+    const char * axes[] = {"A1", "A2", "A3", "A4", "A5", "A6"};
+    const char * cartesian[] = {"X", "Y", "Z", "A", "B", "C"};
+    for (size_t i = 0; i < 6; ++i) {
+      rob->FirstChildElement("AIPos")->Attribute(axes[i], &positions[i]);
+      rob->FirstChildElement("ASPos")->Attribute(axes[i], &initial_positions[i]);
+      rob->FirstChildElement("RIst")->Attribute(cartesian[i], &cart_position[i]);
+      rob->FirstChildElement("RSol")->Attribute(cartesian[i], &initial_cart_position[i]);
+    }
+    ipoc = std::stoull(rob->FirstChildElement("IPOC")->FirstChild()->Value());
+  }
+
+  std::vector<double> positions = std::vector<double>(6, 0.0);
+  std::vector<double> initial_positions = std::vector<double>(6, 0.0);
+  std::vector<double> cart_position = std::vector<double>(6, 0.0);
+  std::vector<double> initial_cart_position = std::vector<double>(6, 0.0);
+  uint64_t ipoc = 0;
+};
+
+void BM_ParseTinyXml(benchmark::State & state)
+{
+  const auto & messages = recordedStates();
+  std::size_t i = 0;
+  for (auto _ : state) {
+    TinyXmlState parsed(messages[i++ % messages.size()]);
+    benchmark::DoNotOptimize(parsed.ipoc);
+  }
+}
+BENCHMARK(BM_ParseTinyXml);
+
+void BM_ParseInPlace(benchmark::State & state)
+{
+  const auto & messages = recordedStates();
+  kuka_kss_rsi_driver::RSIState parsed;
+  std::size_t i = 0;
+  for (auto _ : state) {
+    const std::string & message = messages[i++ % messages.size()];
+    benchmark::DoNotOptimize(parsed.parse(message.data(), message.size()));
+    benchmark::DoNotOptimize(parsed.ipoc);
+  }
+}
+BENCHMARK(BM_ParseInPlace);
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,104 @@
+// Copyright 2023 Svastits Áron
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_KSS_RSI_DRIVER__COMMAND_EXTRAPOLATOR_HPP_
+#define KUKA_KSS_RSI_DRIVER__COMMAND_EXTRAPOLATOR_HPP_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace kuka_kss_rsi_driver
+{
+/**
+ * Predicts the next command from the last commands sent, one cycle ahead
+ *
+ * The history is allocated in the constructor, push() and predict() do not allocate.
+ * If fewer commands are known than the method needs, a lower order prediction is used.
+ */
+class CommandExtrapolator
+{
+public:
+  enum class Method
+  {
+    HOLD,       // Repeat the last command
+    LINEAR,     // Constant velocity from the last 2 commands
+    QUADRATIC   // Constant acceleration from the last 3 commands
+  };
+
+  explicit CommandExtrapolator(Method method = Method::HOLD, std::size_t size = 0)
+  : method_(method), size_(size)
+  {
+    for (auto & command : history_) {
+      command.resize(size_, 0.0);
+    }
+  }
+
+  /**
+   * @brief Forget the history, the given command is the only one known afterwards
+   */
+  void reset(const double * command)
+  {
+    count_ = 0;
+    push(command);
+  }
+
+  void push(const double * command)
+  {
+    newest_ = (newest_ + 1) % history_.size();
+    std::copy(command, command + size_, history_[newest_].begin());
+    if (count_ < history_.size()) {
+      count_++;
+    }
+  }
+
+  /**
+   * @brief Write the predicted command into the given buffer of size() values
+   */
+  void predict(double * command) const
+  {
+    const auto & x0 = history_[newest_];
+    const auto & x1 = history_[(newest_ + history_.size() - 1) % history_.size()];
+    const auto & x2 = history_[(newest_ + history_.size() - 2) % history_.size()];
+
+    std::size_t order = method_ == Method::QUADRATIC ? 2 : method_ == Method::LINEAR ? 1 : 0;
+    if (count_ == 0) {
+      return;
+    }
+    if (order > count_ - 1) {
+      order = count_ - 1;
+    }
+
+    for (std::size_t i = 0; i < size_; ++i) {
+      switch (order) {
+        case 2: command[i] = 3 * x0[i] - 3 * x1[i] + x2[i]; break;
+        case 1: command[i] = 2 * x0[i] - x1[i]; break;
+        default: command[i] = x0[i]; break;
+      }
+    }
+  }
+
+  std::size_t size() const {return size_;}
+
+private:
+  Method method_;
+  std::size_t size_;
+  std::array<std::vector<double>, 3> history_;
+  std::size_t newest_ = 0;
+  std::size_t count_ = 0;
+};
+}  // namespace kuka_kss_rsi_driver
+
+#endif  // KUKA_KSS_RSI_DRIVER__COMMAND_EXTRAPOLATOR_HPP_
@@ -41,6 +41,8 @@
 #ifndef KUKA_KSS_RSI_DRIVER__HARDWARE_INTERFACE_HPP_
 #define KUKA_KSS_RSI_DRIVER__HARDWARE_INTERFACE_HPP_
 
+#include <array>
+#include <atomic>
 #include <vector>
 #include <string>
 #include <memory>
@@ -55,10 +57,37 @@
 
 #include "hardware_interface/system_interface.hpp"
 
+#include "kuka_drivers_core/clock_sync.hpp"
+#include "kuka_drivers_core/command_filter.hpp"
+#include "kuka_drivers_core/activity_monitor.hpp"
+#include "kuka_drivers_core/command_interpolator.hpp"
+#include "kuka_drivers_core/cycle_coordinator.hpp"
+#include "kuka_drivers_core/fault_injection.hpp"
+#include "kuka_drivers_core/flight_recorder.hpp"
+#include "kuka_drivers_core/interface_storage.hpp"
+#include "kuka_drivers_core/io_thread.hpp"
+#include "kuka_drivers_core/joint_state_publisher.hpp"
+#include "kuka_drivers_core/link_diagnostics.hpp"
+#include "kuka_drivers_core/metrics_exporter.hpp"
+#include "kuka_drivers_core/rt_log.hpp"
+#include "kuka_drivers_core/rt_log_drain.hpp"
+#include "kuka_drivers_core/startup_profile.hpp"
+#include "kuka_drivers_core/state_batch_publisher.hpp"
+#include "kuka_drivers_core/state_channel.hpp"
+#include "kuka_drivers_core/tracing.hpp"
+#include "kuka_drivers_core/tuning_parameters.hpp"
+#include "kuka_drivers_core/wire_capture.hpp"
+
+#include "kuka_kss_rsi_driver/command_extrapolator.hpp"
+#include "kuka_kss_rsi_driver/ipoc_tracker.hpp"
+#include "kuka_kss_rsi_driver/latency_diagnostics.hpp"
+#include "kuka_kss_rsi_driver/reply_watchdog.hpp"
+#include "kuka_kss_rsi_driver/shared_transport.hpp"
 #include "kuka_kss_rsi_driver/udp_server.h"
 #include "kuka_kss_rsi_driver/rsi_udp_server.h"
 #include "kuka_kss_rsi_driver/rsi_state.h"
 #include "kuka_kss_rsi_driver/rsi_command.h"
+#include "kuka_kss_rsi_driver/rsi_schema.h"
 #include "kuka_kss_rsi_driver/visibility_control.h"
 
 using hardware_interface::return_type;
@@ -94,27 +123,213 @@ public:
   return_type write(const rclcpp::Time & time, const rclcpp::Duration & period) override;
 
 private:
+  // Sets the states and the initial positions from the first state message
+  void initialize_from_state();
+  // Keeps the socket after a receive timeout and polls it for the next RSI session
+  void suspend_session();
+  // Starts over from the first state message of the next session, false if it is not usable
+  bool resume_session(ssize_t bytes, const UDPServer::Packet & packet);
+  // Whether every joint command is within resume_tolerance_ of the measured position
+  bool commands_near_states() const;
+  // Waits for the first state message through the asynchronous transport
+  CallbackReturn activate_async_transport();
+  // Logs the profile of the finished bring-up, the next one is profiled from its first phase
+  void log_startup_profile();
+  // Renders the correction of the configured mode into rsi_command_
+  bool encode_correction();
+  // Parses the state message into rsi_state_
+  bool decode_state(const UDPServer::Packet & packet);
+  // Converts RIst to meters and radians if the Cartesian state is exported
+  void update_cartesian_states();
+  // Correction values of the configured mode
+  double * correction_data();
+  // Called by the reply watchdog if write() missed the deadline
+  void send_extrapolated_reply();
+  // Stops receiving through the shared transport before the server is closed
+  void leave_shared_transport();
+  // Checks the joint interfaces against the correction mode
+  bool check_joint_interfaces();
+  // Loads the element layout of the RSI messages, if rsi_ethernet_config is set
+  bool configure_schema(std::size_t external_axes);
+  // Maps the interfaces of the GPIO components to the I/O elements of the datagrams
+  bool configure_gpios();
+  // Adds the counters and histograms of the driver, if the metrics are exported
+  void register_metrics();
+  // Writes the record of the cycle with the additional flags, if the flight recorder is enabled
+  void commit_cycle_record(uint32_t flags);
+
+  // GPIO state interface filled from an I/O element of the state message
+  class GPIOReader
+  {
+public:
+    GPIOReader(const std::string & component, const std::string & name, const double & source)
+    : component_(component), name_(name), source_(source) {}
+    const std::string & getComponent() const {return component_;}
+    const std::string & getName() const {return name_;}
+    double & getData() {return data_;}
+    void getValue() {data_ = source_;}
+
+private:
+    const std::string component_;
+    const std::string name_;
+    const double & source_;
+    double data_ = 0;
+  };
+
+  // GPIO command interface sent in an I/O element of the reply
+  class GPIOWriter
+  {
+public:
+    GPIOWriter(
+      const std::string & component, const std::string & name, double & target,
+      double initial_value)
+    : component_(component), name_(name), target_(target), data_(initial_value)
+    {
+      target_ = initial_value;
+    }
+    const std::string & getComponent() const {return component_;}
+    const std::string & getName() const {return name_;}
+    double & getData() {return data_;}
+    void setValue() {target_ = data_;}
+
+private:
+    const std::string component_;
+    const std::string name_;
+    double & target_;
+    double data_;
+  };
+
   bool stop_flag_ = false;
   bool is_active_ = false;
   std::string rsi_ip_address_ = "";
   int rsi_port_ = 0;
 
-  std::vector<double> hw_commands_;
-  std::vector<double> hw_states_;
+  // The joint states and commands in one block, the members below are views into it
+  kuka_drivers_core::InterfaceStorage joint_storage_;
+  kuka_drivers_core::InterfaceStorage::Values hw_commands_;
+  kuka_drivers_core::InterfaceStorage::Values hw_states_;
 
   // RSI related joint positions
   std::vector<double> initial_joint_pos_;
   std::vector<double> joint_pos_correction_deg_;
 
+  // Cartesian correction mode: RIst is exported instead of joint commands, the commands
+  //  are sent as RKorr relative to the pose at activation
+  bool cartesian_correction_ = false;
+  std::array<double, 6> cart_states_{};
+  std::array<double, 6> cart_commands_{};
+  std::array<double, 6> cart_correction_{};
+
   uint64_t ipoc_ = 0;
   RSIState rsi_state_;
   RSICommand rsi_command_;
+  // Elements of the deployed RSI Ethernet configuration, if rsi_ethernet_config is set
+  std::unique_ptr<RSISchema> rsi_schema_;
+  std::vector<GPIOReader> gpio_readers_;
+  std::vector<GPIOWriter> gpio_writers_;
+  int command_precision_ = 6;
+  // Codec instantiations matching the number of external axes
+  RSIState::ParseFunction parse_state_ = nullptr;
+  RSICommand::EncodeFunction encode_command_ = nullptr;
+  IPOCTracker ipoc_tracker_;
+  // Messages of the control loop, written to the rclcpp log by log_drain_
+  kuka_drivers_core::RTLog rt_log_;
+  kuka_drivers_core::RTLogDrain log_drain_{rt_log_, "KukaRSIHardwareInterface"};
+  // Phases of the bring-up, logged when the first state message was answered
+  kuka_drivers_core::StartupProfile startup_profile_{"KukaRSIHardwareInterface"};
+  // Declared before the servers, which record into it until they are destroyed
+  std::unique_ptr<kuka_drivers_core::WireCapture> wire_capture_;
+  // Optional network faults of the fault_profile parameter, applied by the server
+  std::unique_ptr<kuka_drivers_core::FaultInjector> fault_injector_;
   std::unique_ptr<UDPServer> server_;
-  std::string in_buffer_;
-  std::string out_buffer_;
+  UDPServer::Options transport_options_;
+
+  // Optional common I/O thread for all RSI robots of the process
+  std::shared_ptr<SharedRSITransport> shared_transport_;
+  int transport_id_ = -1;
+  std::chrono::microseconds sync_window_{1000};
+
+  // Optional transport replying from the receive handler with the latest commands
+  bool async_transport_ = false;
+  std::unique_ptr<kuka::rsi::RSIUDPServer> async_server_;
+  // With io_thread, read() takes the newest state of the async transport without waiting
+  kuka_drivers_core::IOThread::Options io_thread_options_;
+  // A state was read in this cycle, write() only answers those
+  bool new_state_ = true;
+  std::chrono::steady_clock::time_point last_state_time_;
+  // Index of the robot in the cycle coordinator while active, -1 without cycle_coordination
+  kuka_drivers_core::CycleCoordinator::Options cycle_coordination_options_;
+  int cycle_robot_ = -1;
+  // Wakes the control loop in idle mode, set while the driver needs the cycles of the loop
+  kuka_drivers_core::ActivityMonitor::Flag activity_;
+
+  // Optional waiting for the next session after a receive timeout, joint correction mode only
+  bool session_resume_ = false;
+  bool session_lost_ = false;
+  // After a resume the measured position is held until the commands reach it
+  bool resume_hold_ = false;
+  double resume_tolerance_ = 0.01;
+  static constexpr int RESUME_POLL_TIMEOUT_MS = 2;
+
+  std::unique_ptr<LatencyDiagnostics> latency_diagnostics_;
+  // Optional rate of the missed IPOCs and late packets, if link_diagnostics_period_ms is set
+  std::unique_ptr<kuka_drivers_core::LinkDiagnostics> link_diagnostics_;
+  std::chrono::system_clock::time_point receive_time_;
+  // Optional counters and latencies of the loop for Prometheus, if metrics_port is set
+  std::unique_ptr<kuka_drivers_core::MetricsExporter::Group> metrics_group_;
+  struct Metrics
+  {
+    kuka_drivers_core::MetricsExporter::Counter * missed_ipocs = nullptr;
+    kuka_drivers_core::MetricsExporter::Counter * late_packets = nullptr;
+    kuka_drivers_core::MetricsExporter::Counter * decode_failures = nullptr;
+    kuka_drivers_core::MetricsExporter::Histogram * one_way_latency = nullptr;
+    kuka_drivers_core::MetricsExporter::Histogram * reply_latency = nullptr;
+  } metrics_;
+
+  // Optional fallback reply if write() is not called within the deadline after receive
+  std::chrono::microseconds reply_deadline_{0};
+  CommandExtrapolator extrapolator_;
+  std::unique_ptr<ReplyWatchdog> reply_watchdog_;
+  std::atomic<uint64_t> extrapolated_replies_{0};
+  double extrapolated_cycles_ = 0;
+
+  // Optional per-cycle record of the states and corrections, see flight_recorder_dump
+  std::unique_ptr<kuka_drivers_core::FlightRecorder> flight_recorder_;
+  // Driver specific flags of the flight recorder
+  static constexpr uint32_t STALE_MESSAGE = kuka_drivers_core::FlightRecorder::DRIVER;
+  static constexpr uint32_t EXTRAPOLATED_REPLY = kuka_drivers_core::FlightRecorder::DRIVER << 1;
+  // Optional shared memory copy of the latest state for other processes, see state_channel_echo
+  std::unique_ptr<kuka_drivers_core::StateChannel> state_channel_;
+  // Optional decimated joint states, published by a separate thread
+  std::unique_ptr<kuka_drivers_core::JointStatePublisher> joint_state_publisher_;
+  // Optional batches of all states, published by a separate thread
+  std::unique_ptr<kuka_drivers_core::StateBatchPublisher> state_batch_publisher_;
+  // Filters of the joint position commands, configured by the command_* hardware parameters
+  kuka_drivers_core::JointCommandFilter command_filter_;
+  // Values of the tuning parameters, taken over at the start of read()
+  struct Tuning
+  {
+    kuka_drivers_core::CommandFilterTuning command_filter;
+  };
+  // Optional node of the tuning parameters, if tuning_parameters is set
+  std::unique_ptr<kuka_drivers_core::TuningParameters<Tuning>> tuning_;
+  std::vector<double> filtered_commands_;
+  // Commands of controllers updated only every command_update_cycles_ robot cycles
+  kuka_drivers_core::CommandInterpolator command_interpolator_;
+  std::size_t command_update_cycles_ = 1;
+  std::size_t command_update_counter_ = 0;
+  // Measured from the IPOC difference, which counts milliseconds
+  double robot_cycle_time_ = 0.004;
+  // Send time of the states on the host clock, estimated from the IPOC
+  kuka_drivers_core::ClockSync clock_sync_{1e-3};
+  double state_stamp_ = 0;
+  double one_way_latency_ = 0;
+  double clock_drift_ = 0;
 
   static constexpr double R2D = 180 / M_PI;
   static constexpr double D2R = M_PI / 180;
+  static constexpr double M2MM = 1000;
+  static constexpr double MM2M = 0.001;
 };
 }  // namespace kuka_kss_rsi_driver
 
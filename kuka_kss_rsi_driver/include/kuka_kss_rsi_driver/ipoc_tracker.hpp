@@ -0,0 +1,122 @@
+// Copyright 2023 Svastits Áron
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_KSS_RSI_DRIVER__IPOC_TRACKER_HPP_
+#define KUKA_KSS_RSI_DRIVER__IPOC_TRACKER_HPP_
+
+#include <cstdint>
+
+namespace kuka_kss_rsi_driver
+{
+/**
+ * Checks the continuity of the IPOC timestamps of the received state messages
+ *
+ * The nominal IPOC increment depends on the RSI cycle time (and controller version),
+ * therefore it is learned as the smallest increment seen since reset().
+ * The counters are stored as doubles, so that they can be exported as state interfaces.
+ */
+class IPOCTracker
+{
+public:
+  struct Statistics
+  {
+    double ipoc_delta = 0;            // IPOC difference to the previous message
+    double missed_cycles = 0;         // Cycles skipped based on the nominal IPOC increment
+    double duplicate_packets = 0;     // Messages with the same IPOC as the previous
+    double out_of_order_packets = 0;  // Messages with smaller IPOC than the previous
+    double late_packets = 0;          // Late packet counter reported by the robot (Delay)
+  };
+
+  enum class Result
+  {
+    OK,
+    DUPLICATE,
+    OUT_OF_ORDER
+  };
+
+  /**
+   * @param delay_warning_threshold: early warning is given if the Delay counter of the robot
+   *  reaches this value, 0 disables the warning
+   */
+  explicit IPOCTracker(uint64_t delay_warning_threshold = 0)
+  : delay_warning_threshold_(delay_warning_threshold) {}
+
+  /**
+   * @brief Start tracking from the given IPOC, counters are cleared
+   */
+  void reset(uint64_t ipoc)
+  {
+    last_ipoc_ = ipoc;
+    nominal_delta_ = 0;
+    warning_given_ = false;
+    statistics_ = Statistics();
+  }
+
+  /**
+   * @brief Update the statistics with a new message
+   * @returns DUPLICATE or OUT_OF_ORDER if the message is not newer than the previous one,
+   *  the state in it should not be used then
+   */
+  Result update(uint64_t ipoc, uint64_t delay)
+  {
+    statistics_.late_packets = static_cast<double>(delay);
+
+    if (ipoc == last_ipoc_) {
+      statistics_.ipoc_delta = 0;
+      statistics_.duplicate_packets++;
+      return Result::DUPLICATE;
+    }
+    if (ipoc < last_ipoc_) {
+      statistics_.ipoc_delta = -static_cast<double>(last_ipoc_ - ipoc);
+      statistics_.out_of_order_packets++;
+      return Result::OUT_OF_ORDER;
+    }
+
+    const uint64_t delta = ipoc - last_ipoc_;
+    last_ipoc_ = ipoc;
+    statistics_.ipoc_delta = static_cast<double>(delta);
+    if (nominal_delta_ == 0 || delta < nominal_delta_) {
+      nominal_delta_ = delta;
+    } else if (delta > nominal_delta_) {
+      statistics_.missed_cycles += static_cast<double>(delta / nominal_delta_ - 1);
+    }
+    return Result::OK;
+  }
+
+  /**
+   * @brief Returns true once, when the Delay counter first reaches the warning threshold
+   */
+  bool delayWarning()
+  {
+    if (warning_given_ || delay_warning_threshold_ == 0 ||
+      statistics_.late_packets < static_cast<double>(delay_warning_threshold_))
+    {
+      return false;
+    }
+    warning_given_ = true;
+    return true;
+  }
+
+  Statistics & statistics() {return statistics_;}
+
+private:
+  uint64_t delay_warning_threshold_;
+  uint64_t last_ipoc_ = 0;
+  uint64_t nominal_delta_ = 0;
+  bool warning_given_ = false;
+  Statistics statistics_;
+};
+}  // namespace kuka_kss_rsi_driver
+
+#endif  // KUKA_KSS_RSI_DRIVER__IPOC_TRACKER_HPP_
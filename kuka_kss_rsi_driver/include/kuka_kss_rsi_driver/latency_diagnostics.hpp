@@ -0,0 +1,83 @@
+// Copyright 2023 Svastits Áron
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_KSS_RSI_DRIVER__LATENCY_DIAGNOSTICS_HPP_
+#define KUKA_KSS_RSI_DRIVER__LATENCY_DIAGNOSTICS_HPP_
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "rclcpp/rclcpp.hpp"
+#include "diagnostic_msgs/msg/diagnostic_array.hpp"
+
+#include "kuka_drivers_core/latency_histogram.hpp"
+
+namespace kuka_kss_rsi_driver
+{
+/**
+ * Collects the time between the arrival of a state message and the departure of the answer
+ * and publishes its percentiles on /diagnostics.
+ *
+ * record() is called from the control loop and only touches the lock-free histogram,
+ * the publishing happens on a separate thread with its own node.
+ */
+class LatencyDiagnostics
+{
+public:
+  LatencyDiagnostics(
+    const std::string & hardware_name, std::chrono::microseconds warning_threshold,
+    std::chrono::milliseconds publish_period = std::chrono::milliseconds(1000));
+  ~LatencyDiagnostics();
+
+  void record(std::chrono::nanoseconds latency)
+  {
+    histogram_.Record(latency.count() > 0 ? static_cast<uint64_t>(latency.count()) : 0);
+  }
+
+private:
+  void publishLoop();
+
+  // 10 us buckets up to 10 ms, well above the 4 ms RSI cycle
+  kuka_drivers_core::LatencyHistogram<1000, 10000> histogram_;
+
+  std::string hardware_name_;
+  std::chrono::microseconds warning_threshold_;
+  std::chrono::milliseconds publish_period_;
+
+  rclcpp::Node::SharedPtr node_;
+  rclcpp::Publisher<diagnostic_msgs::msg::DiagnosticArray>::SharedPtr publisher_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool terminate_ = false;
+  std::thread publish_thread_;
+};
+
+/**
+ * @brief Creates the diagnostics if the latency_diagnostics hardware parameter is 'true', the
+ *  warning threshold is given by latency_warning_threshold_us (default: 2000)
+ * @returns false with the reason in error if the parameters are invalid
+ */
+bool ConfigureLatencyDiagnostics(
+  const std::unordered_map<std::string, std::string> & parameters,
+  const std::string & hardware_name, std::unique_ptr<LatencyDiagnostics> & diagnostics,
+  std::string & error);
+}  // namespace kuka_kss_rsi_driver
+
+#endif  // KUKA_KSS_RSI_DRIVER__LATENCY_DIAGNOSTICS_HPP_
@@ -0,0 +1,69 @@
+// Copyright 2023 Svastits Áron
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_KSS_RSI_DRIVER__REPLY_WATCHDOG_HPP_
+#define KUKA_KSS_RSI_DRIVER__REPLY_WATCHDOG_HPP_
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace kuka_kss_rsi_driver
+{
+/**
+ * Calls a fallback on its own thread if the reply to a state message is not sent in time
+ *
+ * arm() is called when a state message arrives, disarm() before the regular reply is sent.
+ * If the deadline passes in between, the fallback is called exactly once for that message
+ * and disarm() returns false, so the late regular reply can be dropped. The fallback runs
+ * with the internal mutex held, disarm() waits for it to finish.
+ */
+class ReplyWatchdog
+{
+public:
+  explicit ReplyWatchdog(std::function<void()> on_deadline);
+  ~ReplyWatchdog();
+
+  void arm(std::chrono::steady_clock::time_point deadline);
+
+  /**
+   * @brief Cancel the pending deadline
+   * @returns false if the fallback has already answered the current message
+   */
+  bool disarm();
+
+private:
+  enum class State
+  {
+    IDLE,
+    ARMED,
+    FIRED
+  };
+
+  void run();
+
+  std::function<void()> on_deadline_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  State state_ = State::IDLE;
+  std::chrono::steady_clock::time_point deadline_;
+  bool terminate_ = false;
+  std::thread thread_;
+};
+}  // namespace kuka_kss_rsi_driver
+
+#endif  // KUKA_KSS_RSI_DRIVER__REPLY_WATCHDOG_HPP_
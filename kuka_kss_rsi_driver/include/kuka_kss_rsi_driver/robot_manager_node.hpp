@@ -25,8 +25,11 @@
 #include "std_msgs/msg/bool.hpp"
 #include "controller_manager_msgs/srv/set_hardware_component_state.hpp"
 #include "controller_manager_msgs/srv/switch_controller.hpp"
+#include "diagnostic_msgs/msg/diagnostic_status.hpp"
 
 #include "kuka_drivers_core/ros2_base_lc_node.hpp"
+#include "kuka_drivers_core/startup_profile.hpp"
+#include "kuka_drivers_core/tracing.hpp"
 
 using CallbackReturn = rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn;
 
@@ -35,7 +38,7 @@ namespace kuka_rsi
 class RobotManagerNode : public kuka_drivers_core::ROS2BaseLCNode
 {
 public:
-  RobotManagerNode();
+  explicit RobotManagerNode(const rclcpp::NodeOptions & options = rclcpp::NodeOptions());
   ~RobotManagerNode() = default;
 
   CallbackReturn on_configure(const rclcpp_lifecycle::State &) override;
@@ -47,6 +50,12 @@ public:
   CallbackReturn on_deactivate(const rclcpp_lifecycle::State &) override;
 
 private:
+  // The transitions of a bring-up, on_configure() and on_activate() profile them
+  CallbackReturn configure();
+  CallbackReturn activate();
+  // Logs the profile of the bring-up and publishes it on ~/startup_profile
+  void publishStartupProfile(bool successful);
+
   bool onRobotModelChangeRequest(const std::string & robot_model);
 
   rclcpp::Client<controller_manager_msgs::srv::SetHardwareComponentState>::SharedPtr
@@ -59,6 +68,9 @@ private:
 
   std::shared_ptr<rclcpp_lifecycle::LifecyclePublisher<std_msgs::msg::Bool>> is_configured_pub_;
   std_msgs::msg::Bool is_configured_msg_;
+
+  kuka_drivers_core::StartupProfile startup_profile_{"robot_manager"};
+  rclcpp::Publisher<diagnostic_msgs::msg::DiagnosticStatus>::SharedPtr startup_profile_pub_;
 };
 }   // namespace kuka_rsi
 
@@ -39,46 +39,212 @@
 #ifndef KUKA_KSS_RSI_DRIVER__RSI_COMMAND_H_
 #define KUKA_KSS_RSI_DRIVER__RSI_COMMAND_H_
 
-#include <tinyxml.h>
-#include <vector>
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
 #include <string>
+#include <utility>
+#include <vector>
+
+#include "kuka_kss_rsi_driver/rsi_io_element.h"
 
 namespace kuka_kss_rsi_driver
 {
+/**
+ * Renders the <Sen> datagram answering the robot controller.
+ *
+ * The frame is written into a buffer owned by the object, so encoding in the control loop
+ * does not allocate. Values are written in fixed notation with a configurable number of
+ * fractional digits. Corrections of external axes are sent in the EK element if requested,
+ * Cartesian corrections are sent in the RKorr element instead of AK. The elements configured
+ * in io_elements are appended with their shortest exact representation, so BOOL and LONG
+ * channels receive integers. The Type of the Sen element is the SENTYPE of the Ethernet
+ * configuration, KROSHU by default.
+ */
 class RSICommand
 {
 public:
-  RSICommand() = default;
-  RSICommand(std::vector<double> joint_position_correction, uint64_t ipoc, bool stop = false)
+  static constexpr std::size_t BUFFER_SIZE = 1024;
+  static constexpr std::size_t ROBOT_AXES = 6;
+  static constexpr std::size_t MAX_EXTERNAL_AXES = 6;
+
+  explicit RSICommand(int precision = 6)
+  : precision_(precision) {}
+
+  /**
+   * @brief Render the command frame into the internal buffer
+   * @tparam ExternalAxes: number of external axis corrections (EK element) to send
+   * @param joint_position_correction: joint corrections in degrees, the 6 robot axes
+   *   followed by the external axes, must contain at least 6 + ExternalAxes values
+   * @param ipoc: timestamp of the state message the command answers
+   * @param stop: value of the Stop flag
+   * @returns false if the frame did not fit into the buffer, the content is invalid then
+   */
+  template<std::size_t ExternalAxes = 0>
+  bool encode(
+    const std::vector<double> & joint_position_correction, uint64_t ipoc, bool stop = false)
+  {
+    static_assert(ExternalAxes <= MAX_EXTERNAL_AXES, "RSI supports at most 6 external axes");
+    if (joint_position_correction.size() < ROBOT_AXES + ExternalAxes) {
+      size_ = 0;
+      return false;
+    }
+
+    char * it = buffer_.data();
+    char * const end = buffer_.data() + buffer_.size();
+
+    it = append(append(it, end, sen_start_.c_str()), end, "<AK");
+    it = appendAxes(
+      it, end, kRobotAxisAttributes, joint_position_correction.data(),
+      std::make_index_sequence<ROBOT_AXES>());
+    if constexpr (ExternalAxes > 0) {
+      it = append(it, end, "/><EK");
+      it = appendAxes(
+        it, end, kExternalAxisAttributes, joint_position_correction.data() + ROBOT_AXES,
+        std::make_index_sequence<ExternalAxes>());
+    }
+    it = appendIOElements(append(it, end, "/>"), end);
+    it = append(it, end, stop ? "<Stop>1</Stop><IPOC>" : "<Stop>0</Stop><IPOC>");
+    it = appendNumber(it, end, ipoc);
+    it = append(it, end, "</IPOC></Sen>");
+
+    size_ = it != nullptr ? static_cast<std::size_t>(it - buffer_.data()) : 0;
+    return it != nullptr;
+  }
+
+  /**
+   * @brief Render a frame with Cartesian correction into the internal buffer
+   * @param cartesian_correction: X, Y, Z correction in millimeters, A, B, C in degrees
+   * @param ipoc: timestamp of the state message the command answers
+   * @param stop: value of the Stop flag
+   * @returns false if the frame did not fit into the buffer, the content is invalid then
+   */
+  bool encodeCartesian(
+    const std::array<double, 6> & cartesian_correction, uint64_t ipoc, bool stop = false)
+  {
+    char * it = buffer_.data();
+    char * const end = buffer_.data() + buffer_.size();
+
+    it = append(append(it, end, sen_start_.c_str()), end, "<RKorr");
+    it = appendAxes(
+      it, end, kCartesianAttributes, cartesian_correction.data(),
+      std::make_index_sequence<6>());
+    it = appendIOElements(append(it, end, "/>"), end);
+    it = append(it, end, stop ? "<Stop>1</Stop><IPOC>" : "<Stop>0</Stop><IPOC>");
+    it = appendNumber(it, end, ipoc);
+    it = append(it, end, "</IPOC></Sen>");
+
+    size_ = it != nullptr ? static_cast<std::size_t>(it - buffer_.data()) : 0;
+    return it != nullptr;
+  }
+
+  using EncodeFunction = bool (RSICommand::*)(const std::vector<double> &, uint64_t, bool);
+
+  /**
+   * @brief Returns the encode() instantiation for the given number of external axes,
+   *  nullptr if the number is not supported
+   */
+  static EncodeFunction encoderFor(std::size_t external_axes)
+  {
+    static constexpr EncodeFunction kEncoders[] = {
+      &RSICommand::encode<0>, &RSICommand::encode<1>, &RSICommand::encode<2>,
+      &RSICommand::encode<3>, &RSICommand::encode<4>, &RSICommand::encode<5>,
+      &RSICommand::encode<6>};
+    return external_axes <= MAX_EXTERNAL_AXES ? kEncoders[external_axes] : nullptr;
+  }
+
+  // Sets the Type attribute of the Sen element, the SENTYPE of the Ethernet configuration
+  void setType(const std::string & type) {sen_start_ = "<Sen Type=\"" + type + "\">";}
+
+  const char * data() const {return buffer_.data();}
+  std::size_t size() const {return size_;}
+
+  // Additional elements sent in every frame
+  std::vector<IOElement> io_elements;
+
+private:
+  static constexpr const char * kRobotAxisAttributes[] =
+  {" A1=\"", " A2=\"", " A3=\"", " A4=\"", " A5=\"", " A6=\""};
+  static constexpr const char * kExternalAxisAttributes[] =
+  {" E1=\"", " E2=\"", " E3=\"", " E4=\"", " E5=\"", " E6=\""};
+  static constexpr const char * kCartesianAttributes[] =
+  {" X=\"", " Y=\"", " Z=\"", " A=\"", " B=\"", " C=\""};
+
+  // Writes the attributes one after the other, the index sequence unrolls the loop
+  template<std::size_t... Index>
+  char * appendAxes(
+    char * it, char * end, const char * const * attributes, const double * values,
+    std::index_sequence<Index...>) const
+  {
+    ((it = appendNumber(append(it, end, attributes[Index]), end, values[Index]),
+    it = append(it, end, "\"")), ...);
+    return it;
+  }
+
+  char * appendIOElements(char * it, char * end) const
+  {
+    for (const auto & element : io_elements) {
+      it = append(append(it, end, "<"), end, element.tag.c_str());
+      if (element.attributes.empty()) {
+        it = append(appendValue(append(it, end, ">"), end, element.values[0]), end, "</");
+        it = append(append(it, end, element.tag.c_str()), end, ">");
+        continue;
+      }
+      for (std::size_t i = 0; i < element.attributes.size(); ++i) {
+        it = append(append(append(it, end, " "), end, element.attributes[i].c_str()), end, "=\"");
+        it = append(appendValue(it, end, element.values[i]), end, "\"");
+      }
+      it = append(it, end, "/>");
+    }
+    return it;
+  }
+
+  // The helpers return nullptr if the buffer is exhausted and pass nullptr through
+  static char * append(char * it, char * end, const char * text)
   {
-    TiXmlDocument doc;
-    TiXmlElement * root = new TiXmlElement("Sen");
-    root->SetAttribute("Type", "KROSHU");
-    TiXmlElement * el = new TiXmlElement("AK");
-    // Add string attribute
-    el->SetAttribute("A1", std::to_string(joint_position_correction[0]));
-    el->SetAttribute("A2", std::to_string(joint_position_correction[1]));
-    el->SetAttribute("A3", std::to_string(joint_position_correction[2]));
-    el->SetAttribute("A4", std::to_string(joint_position_correction[3]));
-    el->SetAttribute("A5", std::to_string(joint_position_correction[4]));
-    el->SetAttribute("A6", std::to_string(joint_position_correction[5]));
-    root->LinkEndChild(el);
-
-    el = new TiXmlElement("Stop");
-    el->LinkEndChild(new TiXmlText(std::to_string(static_cast<int>(stop))));
-    root->LinkEndChild(el);
-
-    el = new TiXmlElement("IPOC");
-    el->LinkEndChild(new TiXmlText(std::to_string(ipoc)));
-    root->LinkEndChild(el);
-    doc.LinkEndChild(root);
-    TiXmlPrinter printer;
-    printer.SetStreamPrinting();
-    doc.Accept(&printer);
-
-    xml_doc = printer.Str();
+    if (it == nullptr) {
+      return nullptr;
+    }
+    const std::size_t length = std::strlen(text);
+    if (static_cast<std::size_t>(end - it) < length) {
+      return nullptr;
+    }
+    std::memcpy(it, text, length);
+    return it + length;
   }
-  std::string xml_doc;
+
+  char * appendNumber(char * it, char * end, double value) const
+  {
+    if (it == nullptr) {
+      return nullptr;
+    }
+    auto result = std::to_chars(it, end, value, std::chars_format::fixed, precision_);
+    return result.ec == std::errc() ? result.ptr : nullptr;
+  }
+
+  static char * appendValue(char * it, char * end, double value)
+  {
+    if (it == nullptr) {
+      return nullptr;
+    }
+    auto result = std::to_chars(it, end, value);
+    return result.ec == std::errc() ? result.ptr : nullptr;
+  }
+
+  static char * appendNumber(char * it, char * end, uint64_t value)
+  {
+    if (it == nullptr) {
+      return nullptr;
+    }
+    auto result = std::to_chars(it, end, value);
+    return result.ec == std::errc() ? result.ptr : nullptr;
+  }
+
+  int precision_;
+  std::string sen_start_ = "<Sen Type=\"KROSHU\">";
+  std::array<char, BUFFER_SIZE> buffer_{};
+  std::size_t size_ = 0;
 };
 }  // namespace kuka_kss_rsi_driver
 
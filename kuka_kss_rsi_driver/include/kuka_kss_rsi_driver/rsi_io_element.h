@@ -0,0 +1,88 @@
+// Copyright 2023 Svastits Áron
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_KSS_RSI_DRIVER__RSI_IO_ELEMENT_H_
+#define KUKA_KSS_RSI_DRIVER__RSI_IO_ELEMENT_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace kuka_kss_rsi_driver
+{
+// Maximal number of attributes of one I/O element
+constexpr std::size_t MAX_IO_ATTRIBUTES = 32;
+
+/**
+ * XML element exchanged in addition to the motion data (e.g. Digout or Tech).
+ *
+ * Values are named like the TAG in the RSI Ethernet configuration: Digout.o1 is the o1
+ * attribute of <Digout>, DiL is the content of <DiL>.
+ */
+struct IOElement
+{
+  std::string tag;
+  // Empty if the value is the content of the element
+  std::vector<std::string> attributes;
+  // One value per attribute, or a single value for the content
+  std::vector<double> values;
+};
+
+/**
+ * @brief Returns the value slot of a TAG, the element or attribute is added if it is not
+ *  configured yet. The pointer is valid until the next element or attribute is added.
+ * @returns nullptr if the element has too many attributes or content and attributes are mixed
+ */
+inline double * addIOValue(std::vector<IOElement> & elements, const std::string & tag_name)
+{
+  const std::size_t dot = tag_name.find('.');
+  const std::string tag = tag_name.substr(0, dot);
+  const std::string attribute = dot != std::string::npos ? tag_name.substr(dot + 1) : "";
+  if (tag.empty() || (dot != std::string::npos && attribute.empty())) {
+    return nullptr;
+  }
+
+  auto element = elements.begin();
+  while (element != elements.end() && element->tag != tag) {
+    ++element;
+  }
+  if (element == elements.end()) {
+    element = elements.insert(element, IOElement{tag, {}, {}});
+  }
+
+  if (attribute.empty()) {
+    if (!element->attributes.empty()) {
+      return nullptr;
+    }
+    element->values.resize(1, 0.0);
+    return element->values.data();
+  }
+  if (element->attributes.empty() && !element->values.empty()) {
+    return nullptr;
+  }
+  for (std::size_t i = 0; i < element->attributes.size(); ++i) {
+    if (element->attributes[i] == attribute) {
+      return &element->values[i];
+    }
+  }
+  if (element->attributes.size() == MAX_IO_ATTRIBUTES) {
+    return nullptr;
+  }
+  element->attributes.push_back(attribute);
+  element->values.push_back(0.0);
+  return &element->values.back();
+}
+}  // namespace kuka_kss_rsi_driver
+
+#endif  // KUKA_KSS_RSI_DRIVER__RSI_IO_ELEMENT_H_
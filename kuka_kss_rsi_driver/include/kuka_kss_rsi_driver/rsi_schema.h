@@ -0,0 +1,90 @@
+// Copyright 2023 Svastits Áron
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_KSS_RSI_DRIVER__RSI_SCHEMA_H_
+#define KUKA_KSS_RSI_DRIVER__RSI_SCHEMA_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "kuka_kss_rsi_driver/rsi_command.h"
+#include "kuka_kss_rsi_driver/rsi_state.h"
+
+namespace kuka_kss_rsi_driver
+{
+/**
+ * Elements of the RSI Ethernet configuration, the XML file of the ETHERNET object on the KRC.
+ *
+ * The file is read once at startup. configure() turns it into the tables of the codec: every
+ * element the robot sends besides the motion data is added to the I/O elements of RSIState,
+ * every element the robot expects besides the corrections to the ones of RSICommand. The
+ * parser and the encoder then handle exactly the elements of the deployed program in the same
+ * pass as the motion data, whether a ros2_control interface maps them or not, and the
+ * configuration is checked against the correction mode and the number of external axes before
+ * the robot rejects the first reply.
+ */
+class RSISchema
+{
+public:
+  struct Element
+  {
+    // As in the configuration, e.g. DEF_AIPos, AK.A1 or Digout.o1
+    std::string tag;
+    // BOOL, LONG, DOUBLE or STRING
+    std::string type;
+  };
+
+  /**
+   * @brief Reads the SENTYPE and the SEND and RECEIVE elements of the configuration file
+   * @returns false with the reason in error if the file cannot be read or is not an RSI
+   *  Ethernet configuration
+   */
+  bool load(const std::string & path, std::string & error);
+
+  /**
+   * @brief Configures the I/O elements and the Sen type of the codec from the schema
+   * @param external_axes: number of external axes of the driver
+   * @param cartesian: whether corrections are sent in RKorr instead of AK and EK
+   * @returns false with the reason in error if a motion element required by the driver is
+   *  missing or an element cannot be represented (STRING elements)
+   */
+  bool configure(
+    std::size_t external_axes, bool cartesian, RSIState & state, RSICommand & command,
+    std::string & error) const;
+
+  // Whether the robot sends the value named like an interface, e.g. Digin.i1 or Tech.T21
+  bool sends(const std::string & tag_name) const;
+
+  // Whether the robot expects the value named like an interface, e.g. Digout.o1
+  bool receives(const std::string & tag_name) const;
+
+  const std::string & senType() const {return sen_type_;}
+
+  // Elements sent by the robot (the state) and expected in the replies (the command)
+  const std::vector<Element> & sendElements() const {return send_;}
+  const std::vector<Element> & receiveElements() const {return receive_;}
+
+private:
+  // Elements of the messages handled by RSIState and RSICommand themselves
+  static bool isMotionState(const std::string & tag);
+  static bool isMotionCommand(const std::string & tag);
+
+  std::string sen_type_;
+  std::vector<Element> send_;
+  std::vector<Element> receive_;
+};
+}  // namespace kuka_kss_rsi_driver
+
+#endif  // KUKA_KSS_RSI_DRIVER__RSI_SCHEMA_H_
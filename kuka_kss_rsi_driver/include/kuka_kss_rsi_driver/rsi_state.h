@@ -39,73 +39,321 @@
 #ifndef KUKA_KSS_RSI_DRIVER__RSI_STATE_H_
 #define KUKA_KSS_RSI_DRIVER__RSI_STATE_H_
 
-#include <tinyxml.h>
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
 #include <string>
+#include <system_error>
 #include <vector>
 
+#include "kuka_kss_rsi_driver/rsi_io_element.h"
+
 namespace kuka_kss_rsi_driver
 {
+/**
+ * Holds the content of one <Rob> datagram sent by the robot controller.
+ *
+ * The datagram is scanned in place by a single-pass parser instead of building a DOM,
+ * so parsing in the control loop does not touch the heap. The parser expects the
+ * elements configured in ros_rsi_ethernet.xml, AIPos, ASPos and IPOC are mandatory,
+ * RIst, RSol and Delay are filled in if present.
+ *
+ * The number of external axes (E1-E6 in EIPos and ESPos) is a template parameter of parse(),
+ * their values are stored after the robot axes in positions and initial_positions.
+ * Attributes are mapped to their slots from the digit in their name, not by name lookup.
+ * The numbers are converted with std::from_chars, so the locale of the process does not
+ * change the decimal separator.
+ *
+ * Additional elements (e.g. Digout or Tech) can be configured in io_elements, their values
+ * are parsed in the same pass. Configuring them allocates, parsing afterwards does not.
+ */
 class RSIState
 {
-private:
-  std::string xml_doc_;
-
 public:
-  RSIState()
+  static constexpr std::size_t ROBOT_AXES = 6;
+  static constexpr std::size_t MAX_EXTERNAL_AXES = 6;
+  static constexpr std::size_t MAX_AXES = ROBOT_AXES + MAX_EXTERNAL_AXES;
+
+  using ParseFunction = bool (RSIState::*)(const char *, std::size_t);
+
+  RSIState() = default;
+
+  explicit RSIState(const std::string & xml_doc)
   {
-    xml_doc_.resize(1024);
+    parse(xml_doc.c_str(), xml_doc.size());
+  }
+
+  /**
+   * @brief Parse a datagram received from the robot controller
+   * @tparam ExternalAxes: number of external axes expected in the datagram
+   * @param buffer: pointer to the received bytes, does not have to be null-terminated
+   * @param length: number of valid bytes in the buffer
+   * @returns false if the datagram is malformed or a mandatory element is missing,
+   *   previously parsed values of the missing elements are kept in this case
+   */
+  template<std::size_t ExternalAxes = 0>
+  bool parse(const char * buffer, std::size_t length)
+  {
+    static_assert(ExternalAxes <= MAX_EXTERNAL_AXES, "RSI supports at most 6 external axes");
+    constexpr uint32_t kRobotAxesMask = (1u << ROBOT_AXES) - 1;
+    constexpr uint32_t kExternalAxesMask = (1u << ExternalAxes) - 1;
+
+    const char * it = buffer;
+    const char * const end = buffer + length;
+    bool in_rob = false;
+    bool has_aipos = false;
+    bool has_aspos = false;
+    bool has_eipos = ExternalAxes == 0;
+    bool has_espos = ExternalAxes == 0;
+    bool has_ipoc = false;
+
+    while (it < end &&
+      (it = static_cast<const char *>(std::memchr(it, '<', end - it))) != nullptr)
+    {
+      ++it;
+      if (it < end && *it == '/') {
+        // Closing tag, only the end of the Rob element is relevant
+        if (in_rob && matchesTag(it + 1, end, "Rob")) {
+          break;
+        }
+        continue;
+      }
+
+      const char * name = it;
+      while (it < end && !isNameDelimiter(*it)) {
+        ++it;
+      }
+      const std::size_t name_length = it - name;
+      const char * tag_end = static_cast<const char *>(std::memchr(it, '>', end - it));
+      if (tag_end == nullptr) {
+        return false;
+      }
+
+      if (!in_rob) {
+        in_rob = equals(name, name_length, "Rob");
+      } else if (equals(name, name_length, "AIPos")) {
+        has_aipos = (parseAttributes(it, tag_end, positions.data(), axisSlot<'A'>) &
+          kRobotAxesMask) == kRobotAxesMask;
+      } else if (equals(name, name_length, "ASPos")) {
+        has_aspos = (parseAttributes(it, tag_end, initial_positions.data(), axisSlot<'A'>) &
+          kRobotAxesMask) == kRobotAxesMask;
+      } else if (ExternalAxes > 0 && equals(name, name_length, "EIPos")) {
+        has_eipos = (parseAttributes(
+            it, tag_end, positions.data() + ROBOT_AXES,
+            axisSlot<'E'>) & kExternalAxesMask) == kExternalAxesMask;
+      } else if (ExternalAxes > 0 && equals(name, name_length, "ESPos")) {
+        has_espos = (parseAttributes(
+            it, tag_end, initial_positions.data() + ROBOT_AXES,
+            axisSlot<'E'>) & kExternalAxesMask) == kExternalAxesMask;
+      } else if (equals(name, name_length, "RIst")) {
+        parseAttributes(it, tag_end, cart_position.data(), cartesianSlot);
+      } else if (equals(name, name_length, "RSol")) {
+        parseAttributes(it, tag_end, initial_cart_position.data(), cartesianSlot);
+      } else if (equals(name, name_length, "Delay")) {
+        double delay_count = 0;
+        if (parseAttributes(it, tag_end, &delay_count, delaySlot) != 0) {
+          delay = static_cast<uint64_t>(delay_count);
+        }
+      } else if (equals(name, name_length, "IPOC")) {
+        has_ipoc = parseUnsigned(tag_end + 1, end, ipoc);
+      } else if (IOElement * io_element = findIOElement(name, name_length)) {
+        parseIOElement(*io_element, it, tag_end, end);
+      }
+      it = tag_end + 1;
+    }
+    return has_aipos && has_aspos && has_eipos && has_espos && has_ipoc;
   }
 
-  explicit RSIState(std::string xml_doc)
-  : xml_doc_(xml_doc)
+  /**
+   * @brief Returns the parse() instantiation for the given number of external axes,
+   *  nullptr if the number is not supported
+   */
+  static ParseFunction parserFor(std::size_t external_axes)
   {
-    // Parse message from robot
-    TiXmlDocument bufferdoc;
-    bufferdoc.Parse(xml_doc_.c_str());
-    // Get the Rob node:
-    TiXmlElement * rob = bufferdoc.FirstChildElement("Rob");
-    // Extract axis specific actual position
-    TiXmlElement * AIPos_el = rob->FirstChildElement("AIPos");
-    AIPos_el->Attribute("A1", &positions[0]);
-    AIPos_el->Attribute("A2", &positions[1]);
-    AIPos_el->Attribute("A3", &positions[2]);
-    AIPos_el->Attribute("A4", &positions[3]);
-    AIPos_el->Attribute("A5", &positions[4]);
-    AIPos_el->Attribute("A6", &positions[5]);
-    // Extract axis specific setpoint position
-    TiXmlElement * ASPos_el = rob->FirstChildElement("ASPos");
-    ASPos_el->Attribute("A1", &initial_positions[0]);
-    ASPos_el->Attribute("A2", &initial_positions[1]);
-    ASPos_el->Attribute("A3", &initial_positions[2]);
-    ASPos_el->Attribute("A4", &initial_positions[3]);
-    ASPos_el->Attribute("A5", &initial_positions[4]);
-    ASPos_el->Attribute("A6", &initial_positions[5]);
-    // Extract cartesian actual position
-    TiXmlElement * RIst_el = rob->FirstChildElement("RIst");
-    RIst_el->Attribute("X", &cart_position[0]);
-    RIst_el->Attribute("Y", &cart_position[1]);
-    RIst_el->Attribute("Z", &cart_position[2]);
-    RIst_el->Attribute("A", &cart_position[3]);
-    RIst_el->Attribute("B", &cart_position[4]);
-    RIst_el->Attribute("C", &cart_position[5]);
-    // Extract cartesian actual position
-    TiXmlElement * RSol_el = rob->FirstChildElement("RSol");
-    RSol_el->Attribute("X", &initial_cart_position[0]);
-    RSol_el->Attribute("Y", &initial_cart_position[1]);
-    RSol_el->Attribute("Z", &initial_cart_position[2]);
-    RSol_el->Attribute("A", &initial_cart_position[3]);
-    RSol_el->Attribute("B", &initial_cart_position[4]);
-    RSol_el->Attribute("C", &initial_cart_position[5]);
-    // Get the IPOC timestamp
-    TiXmlElement * ipoc_el = rob->FirstChildElement("IPOC");
-    ipoc = std::stoull(ipoc_el->FirstChild()->Value());
+    static constexpr ParseFunction kParsers[] = {
+      &RSIState::parse<0>, &RSIState::parse<1>, &RSIState::parse<2>, &RSIState::parse<3>,
+      &RSIState::parse<4>, &RSIState::parse<5>, &RSIState::parse<6>};
+    return external_axes <= MAX_EXTERNAL_AXES ? kParsers[external_axes] : nullptr;
   }
 
-  std::vector<double> positions = std::vector<double>(6, 0.0);
-  std::vector<double> initial_positions = std::vector<double>(6, 0.0);
-  std::vector<double> cart_position = std::vector<double>(6, 0.0);
-  std::vector<double> initial_cart_position = std::vector<double>(6, 0.0);
+  std::array<double, MAX_AXES> positions{};
+  std::array<double, MAX_AXES> initial_positions{};
+  std::array<double, 6> cart_position{};
+  std::array<double, 6> initial_cart_position{};
   uint64_t ipoc = 0;
+  uint64_t delay = 0;
+  // Additional elements parsed from the datagram
+  std::vector<IOElement> io_elements;
+
+private:
+  static bool isSpace(char c)
+  {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+  }
+
+  static bool isNameDelimiter(char c)
+  {
+    return isSpace(c) || c == '/' || c == '>';
+  }
+
+  static bool equals(const char * name, std::size_t length, const char * expected)
+  {
+    return std::strlen(expected) == length && std::memcmp(name, expected, length) == 0;
+  }
+
+  static bool matchesTag(const char * it, const char * end, const char * expected)
+  {
+    const std::size_t length = std::strlen(expected);
+    return static_cast<std::size_t>(end - it) > length &&
+           std::memcmp(it, expected, length) == 0 && isNameDelimiter(it[length]);
+  }
+
+  // Slot functions map an attribute name to the index of its value, -1 means unknown attribute
+  template<char Prefix>
+  static int axisSlot(const char * name, std::size_t length)
+  {
+    return length == 2 && name[0] == Prefix && name[1] >= '1' && name[1] <= '6' ?
+           name[1] - '1' : -1;
+  }
+
+  static int cartesianSlot(const char * name, std::size_t length)
+  {
+    if (length != 1) {
+      return -1;
+    }
+    switch (name[0]) {
+      case 'X': return 0;
+      case 'Y': return 1;
+      case 'Z': return 2;
+      case 'A': return 3;
+      case 'B': return 4;
+      case 'C': return 5;
+      default: return -1;
+    }
+  }
+
+  static int delaySlot(const char * name, std::size_t length)
+  {
+    return length == 1 && name[0] == 'D' ? 0 : -1;
+  }
+
+  // Fills the values of the known attributes in the [it, end) range of a start tag
+  // Returns the bitmask of the slots found
+  template<typename SlotFunction>
+  static uint32_t parseAttributes(
+    const char * it, const char * end, double * values, SlotFunction slot_of)
+  {
+    uint32_t found = 0;
+    while (it < end) {
+      while (it < end && isSpace(*it)) {
+        ++it;
+      }
+      const char * name = it;
+      while (it < end && *it != '=' && !isSpace(*it)) {
+        ++it;
+      }
+      const std::size_t name_length = it - name;
+
+      while (it < end && *it != '"' && *it != '\'') {
+        ++it;
+      }
+      if (it == end) {
+        break;
+      }
+      const char quote = *it++;
+      const char * value = it;
+      const char * value_end = static_cast<const char *>(std::memchr(value, quote, end - value));
+      if (value_end == nullptr) {
+        break;
+      }
+
+      const int slot = slot_of(name, name_length);
+      if (slot >= 0 && parseDouble(value, value_end, values[slot])) {
+        found |= 1u << slot;
+      }
+      it = value_end + 1;
+    }
+    return found;
+  }
+
+  IOElement * findIOElement(const char * name, std::size_t length)
+  {
+    for (auto & element : io_elements) {
+      if (element.tag.size() == length && std::memcmp(name, element.tag.data(), length) == 0) {
+        return &element;
+      }
+    }
+    return nullptr;
+  }
+
+  // it points after the element name, tag_end to the closing '>' of the start tag
+  static void parseIOElement(
+    IOElement & element, const char * it, const char * tag_end, const char * end)
+  {
+    if (!element.attributes.empty()) {
+      parseAttributes(
+        it, tag_end, element.values.data(), [&element](const char * name, std::size_t length) {
+          for (std::size_t i = 0; i < element.attributes.size(); ++i) {
+            if (equals(name, length, element.attributes[i].c_str())) {
+              return static_cast<int>(i);
+            }
+          }
+          return -1;
+        });
+    } else if (tag_end[-1] != '/') {
+      const char * text_end = static_cast<const char *>(std::memchr(tag_end, '<', end - tag_end));
+      if (text_end != nullptr) {
+        parseDouble(tag_end + 1, text_end, element.values[0]);
+      }
+    }
+  }
+
+  // The whole text up to the end tag, the value is kept if it is invalid or does not fit
+  static bool parseUnsigned(const char * it, const char * end, uint64_t & value)
+  {
+    const char * text_end = static_cast<const char *>(std::memchr(it, '<', end - it));
+    if (text_end == nullptr) {
+      return false;
+    }
+    while (it < text_end && isSpace(*it)) {
+      ++it;
+    }
+    uint64_t result = 0;
+    const auto parsed = std::from_chars(it, text_end, result);
+    const char * rest = parsed.ptr;
+    while (rest < text_end && isSpace(*rest)) {
+      ++rest;
+    }
+    if (parsed.ec != std::errc() || rest != text_end) {
+      return false;
+    }
+    value = result;
+    return true;
+  }
+
+  // The whole value, independent of the locale unlike strtod, the value is kept if invalid
+  static bool parseDouble(const char * it, const char * end, double & value)
+  {
+    while (it < end && isSpace(*it)) {
+      ++it;
+    }
+    // from_chars does not accept the sign the controller might send
+    if (it < end && *it == '+') {
+      ++it;
+    }
+    double result;
+    const auto parsed = std::from_chars(it, end, result);
+    const char * rest = parsed.ptr;
+    while (rest < end && isSpace(*rest)) {
+      ++rest;
+    }
+    if (parsed.ec != std::errc() || rest != end) {
+      return false;
+    }
+    value = result;
+    return true;
+  }
 };
 }  // namespace kuka_kss_rsi_driver
 
@@ -1,179 +1,172 @@
-#ifndef EGM_BASE_INTERFACE_H
-#define EGM_BASE_INTERFACE_H
-
-#include <boost/thread.hpp>
-
-// #include "abb_libegm_export.h"
-// // 
-// #include "egm.pb.h"         // Generated by Google Protocol Buffer compiler protoc
-// #include "egm_wrapper.pb.h" // Generated by Google Protocol Buffer compiler protoc
-
-// #include "egm_common.h"
-// #include "egm_logger.h"
-// #include "egm_udp_server.h"
-#include "generic_udp_server.h"
+// Copyright 2023 Svastits Áron
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_KSS_RSI_DRIVER__RSI_UDP_SERVER_H_
+#define KUKA_KSS_RSI_DRIVER__RSI_UDP_SERVER_H_
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "kuka_drivers_core/command_interpolator.hpp"
+#include "kuka_drivers_core/io_thread.hpp"
+#include "kuka_drivers_core/spsc_queue.hpp"
+#include "kuka_drivers_core/tracing.hpp"
+#include "kuka_drivers_core/triple_buffer.hpp"
+#include "kuka_drivers_core/wire_capture.hpp"
+#include "kuka_kss_rsi_driver/generic_udp_server.h"
+#include "kuka_kss_rsi_driver/ipoc_tracker.hpp"
+#include "kuka_kss_rsi_driver/rsi_command.h"
+#include "kuka_kss_rsi_driver/rsi_state.h"
 
 namespace kuka
 {
 namespace rsi
 {
-
 /**
- * \brief Class for processing asynchronous callbacks.
+ * \brief Reactor-style RSI transport, state messages are answered from the receive handler.
+ *
+ * The handler parses the state message, stores it for the hardware interface and replies
+ * with the latest command snapshot right away, so the reply does not wait for the next
+ * read/write cycle of the controller manager. The commands therefore reach the robot one
+ * cycle later than with the synchronous UDPServer. The io_context runs on its own thread.
  *
- * The class provides behavior for:
- * - Processing asynchronous callbacks from a UDP server. The interface receives the robot controller's
- *   outbound messages and construct inbound messages to the robot controller.
- * - This class can for example be used as a foundation for custom made user interfaces.
+ * Every message is answered also if the controller manager runs slower than RSI: the commands
+ * are handed over through a lock-free queue and the I/O thread replies with the newest one,
+ * optionally interpolating the joint corrections between the snapshots. The IPOC statistics
+ * are tracked on the I/O thread as well, so that they count the cycles of the robot. The newest
+ * state is handed over in a triple buffer, which can be waited for or taken without waiting.
  */
-class EGMBaseInterface
+class RSIUDPServer : public AbstractUDPServerInterface
 {
 public:
   /**
-   * \brief A constructor.
+   * \brief A constructor, starts receiving immediately.
    *
-   * \param io_service for operating boost asio's asynchronous functions.
-   * \param port_number for the server's UDP socket.
-   * \param configuration for the interface's configuration.
+   * \param host and port_number to bind the server's UDP socket to.
+   * \param axes number of joint corrections in the commands, including external axes.
+   * \param parse RSIState::parse() instantiation matching the number of external axes.
+   * \param encode RSICommand::encode() instantiation, nullptr sends Cartesian corrections.
+   * \param precision number of fractional digits of the corrections.
+   * \param capture optional recorder of the received and sent datagrams.
+   * \param interpolation interpolation of the joint corrections between the snapshots.
+   * \param max_rate_deg maximal change of the corrections in deg/s for velocity limited mode.
+   * \param io_thread_options priority and CPU of the I/O thread.
    */
-  EGMBaseInterface(boost::asio::io_service& io_service,
-                   const unsigned short port_number
-                   );
+  RSIUDPServer(
+    const std::string & host, uint16_t port_number, std::size_t axes,
+    kuka_kss_rsi_driver::RSIState::ParseFunction parse,
+    kuka_kss_rsi_driver::RSICommand::EncodeFunction encode, int precision,
+    kuka_drivers_core::WireCapture * capture = nullptr,
+    kuka_drivers_core::CommandInterpolator::Mode interpolation =
+    kuka_drivers_core::CommandInterpolator::Mode::NONE,
+    double max_rate_deg = 0.0,
+    const kuka_drivers_core::IOThread::Options & io_thread_options = {});
 
   /**
-   * \brief Checks if the underlying server was successfully initialized or not.
-   *
-   * \return bool indicating if the underlying server was successfully initialized or not.
+   * \brief A destructor, stops the I/O thread.
    */
-  bool isInitialized();
+  ~RSIUDPServer() override;
 
-  /**
-   * \brief Checks if an EGM communication session is connected or not.
-   *
-   * \return bool indicating if a connection exists between the interface, and the robot controller's EGM client.
-   */
-  bool isConnected();
+  bool isInitialized() const;
 
   /**
-   * \brief Retrieve the most recently received EGM status message.
+   * \brief Wait for a state message newer than the one returned by the previous call.
    *
-   * The returned status depends on the EGM communication session(s):
-   * - If no session has been active, then an empty status message is returned.
-   * - If a session is active, then the most recently received status message is returned.
-   * - If any session has been active, then the last status message from the latest session is returned.
-   *
-   * Note: EGMAct RAPID instructions specifies the frequency of EGM messages, and this affects how often
-   *       the status is updated when a communication session is active.
-   *
-   * \return wrapper::Status containing the most recently received EGM status message.
+   * \param statistics if given, set to the IPOC statistics of all messages received so far.
+   * \return false on timeout.
    */
-//   wrapper::Status getStatus();
+  bool waitForState(
+    kuka_kss_rsi_driver::RSIState & state, std::chrono::milliseconds timeout,
+    kuka_kss_rsi_driver::IPOCTracker::Statistics * statistics = nullptr);
 
   /**
-   * \brief Retrieve the interface's current configuration.
+   * \brief Take over the newest state message without waiting, like waitForState().
    *
-   * \return BaseConfiguration containing the current configurations for the interface.
+   * \return false if no newer state arrived since the previous call.
    */
-//   BaseConfiguration getConfiguration();
+  bool takeState(
+    kuka_kss_rsi_driver::RSIState & state,
+    kuka_kss_rsi_driver::IPOCTracker::Statistics * statistics = nullptr);
 
   /**
-   * \brief Update the interface's configuration (update is only applied for new EGM communication sessions).
-   *
-   * \param configuration containing the new configurations for the interface.
+   * \brief Arrival of the state returned by the last waitForState() or takeState().
    */
-//   void setConfiguration(const BaseConfiguration& configuration);
-
-protected:
-
+  std::chrono::steady_clock::time_point lastArrival() const {return states_.Front().arrival;}
 
   /**
-   * \brief Struct for containing data regarding an active EGM communication session.
+   * \brief Update the command snapshot used by the next replies, does not block.
    */
-  struct SessionData
+  void setJointCorrection(const std::vector<double> & correction_deg, bool stop);
+  void setCartesianCorrection(const std::array<double, 6> & correction, bool stop);
+
+private:
+  // Snapshot of the commands of one write(), Cartesian corrections use the first 6 values
+  struct Command
   {
-    /**
-     * \brief Container for the most recently received EGM header message.
-     */
-    // wrapper::Header header;
-
-    // /**
-    //  * \brief Container for the most recently received EGM status message.
-    //  */
-    // wrapper::Status status;
-
-    /**
-     * \brief Mutex for protecting the session data.
-     */
-    boost::mutex mutex;
+    std::array<double, kuka_kss_rsi_driver::RSIState::MAX_AXES> correction;
+    bool stop;
   };
 
-//   /**
-//    * \brief Log input, from robot controller, and output, to robot controller, into a CSV file.
-//    *
-//    * \param inputs containing the inputs from the robot controller.
-//    * \param outputs containing the outputs to the robot controller.
-//    * \param max_time specifying the max amount of time to log.
-//    */
-//   void logData(const InputContainer& inputs, const OutputContainer& outputs, const double max_time);
-
-//   /**
-//    * \brief Initialize the callback.
-//    *
-//    * \param server_data containing the UDP server's callback data.
-//    *
-//    * \return bool indicating if the initialization succeeded or not.
-//    */
-  bool initializeCallback(const UDPServerData& server_data);
-
-  /**
-   * \brief Static constant wait time [ms] used when determining if a connection has been established or not.
-   *
-   * I.e. a connection between the interface's UDP server, and a robot controller's EGM client.
-   */
-  static const unsigned int WAIT_TIME_MS = 100;
-
-//   /**
-//    * \brief Container for the inputs, to the interface, from the UDP server.
-//    */
-//   InputContainer inputs_;
-
-//   /**
-//    * \brief Container for the outputs, from the interface, to the UDP server.
-//    */
-//   OutputContainer outputs_;
-
-//   /**
-//    * \brief Container for session data (most recently received header and status messages).
-//    */
-  SessionData session_data_;
-
-  /**
-   * \brief Logger, for logging EGM messages to a CSV file.
-   */
-//   boost::shared_ptr<EGMLogger> p_logger_;
+  std::string_view callback(const UDPServerData & data) override;
+  // Takes over the newest snapshot and interpolates towards it, on the I/O thread
+  bool updateReply(uint64_t ipoc);
 
-//   /**
-//    * \brief The interface's configuration.
-//    */
-//   BaseConfigurationContainer configuration_;
+  struct StateSnapshot
+  {
+    kuka_kss_rsi_driver::RSIState state;
+    kuka_kss_rsi_driver::IPOCTracker::Statistics statistics;
+    std::chrono::steady_clock::time_point arrival;
+  };
 
-//   /**
-//    * \brief Server for managing the communication with the robot controller.
-//    */
+  boost::asio::io_context io_context_;
   UDPServer udp_server_;
 
-private:
-  /**
-   * \brief Handle callback requests from an UDP server.
-   *
-   * \param server_data containing the UDP server's callback data.
-   *
-   * \return string& containing the reply.
-   */
-  const std::string& callback(const UDPServerData& server_data);
+  kuka_kss_rsi_driver::RSIState::ParseFunction parse_;
+  kuka_kss_rsi_driver::RSICommand::EncodeFunction encode_;
+  kuka_drivers_core::WireCapture * capture_;
+
+  // Accessed only from the I/O thread
+  kuka_kss_rsi_driver::RSIState received_state_;
+  kuka_kss_rsi_driver::RSICommand command_;
+  std::vector<double> reply_joint_correction_;
+  std::array<double, 6> reply_cartesian_correction_{};
+  Command command_snapshot_{};
+  kuka_drivers_core::CommandInterpolator interpolator_;
+  kuka_kss_rsi_driver::IPOCTracker ipoc_tracker_;
+  bool tracking_ = false;
+  // IPOC of the last message and of the message the current snapshot was taken over with
+  uint64_t last_ipoc_ = 0;
+  uint64_t snapshot_ipoc_ = 0;
+
+  // Commands of the hardware interface, written only by write()
+  kuka_drivers_core::SPSCQueue<Command, 16> commands_;
+  std::size_t axes_;
+
+  // States for the hardware interface, the mutex only serves the waiting of waitForState()
+  kuka_drivers_core::TripleBuffer<StateSnapshot> states_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+
+  // Declared last, so that it is stopped before the members it uses are destroyed
+  kuka_drivers_core::IOThread io_thread_;
 };
+}  // namespace rsi
+}  // namespace kuka
 
-} // end namespace kuka
-} // end namespace rsi
-
-#endif // RSI_UDP_SERVER.H
\ No newline at end of file
+#endif  // KUKA_KSS_RSI_DRIVER__RSI_UDP_SERVER_H_
@@ -0,0 +1,99 @@
+// Copyright 2023 Svastits Áron
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_KSS_RSI_DRIVER__SHARED_TRANSPORT_HPP_
+#define KUKA_KSS_RSI_DRIVER__SHARED_TRANSPORT_HPP_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "kuka_kss_rsi_driver/udp_server.h"
+
+namespace kuka_kss_rsi_driver
+{
+/**
+ * Receives the state messages of several robots on one epoll-driven I/O thread
+ *
+ * The hardware interfaces of one process register their servers with the common instance,
+ * their frames are stored in per-robot slots as they arrive. receive() waits for the frame
+ * of the calling robot and for the frames of the other robots of the same cycle, so the
+ * first read() of the controller manager waits for the whole set and the others return
+ * immediately. Replies are still sent by the hardware interfaces on their own sockets.
+ */
+class SharedRSITransport
+{
+public:
+  // Returns the process-wide instance, it is destroyed with the last reference
+  static std::shared_ptr<SharedRSITransport> instance();
+
+  ~SharedRSITransport();
+
+  SharedRSITransport(const SharedRSITransport &) = delete;
+  SharedRSITransport & operator=(const SharedRSITransport &) = delete;
+
+  /**
+   * @brief Start receiving on the socket of the server
+   * @returns the id of the robot, -1 on failure
+   */
+  int add(UDPServer & server);
+
+  // Stop receiving for the robot, the server can be destroyed afterwards
+  void remove(int id);
+
+  /**
+   * @brief Wait for the next frame of the robot
+   * @param id: id returned by add()
+   * @param packet: view of the frame, valid until the next receive() with the same id
+   * @param timeout: maximal time to wait for the frame of the robot
+   * @param sync_window: frames of other robots arriving at most this much earlier belong to
+   *   the same cycle, after the frame of the robot is received at most this much is waited
+   *   for the others
+   * @returns the number of bytes received, 0 on timeout
+   */
+  ssize_t receive(
+    int id, UDPServer::Packet & packet, std::chrono::milliseconds timeout,
+    std::chrono::microseconds sync_window);
+
+private:
+  struct Slot
+  {
+    UDPServer * server = nullptr;
+    bool fresh = false;
+    std::size_t size = 0;
+    std::chrono::steady_clock::time_point timestamp;
+    std::chrono::system_clock::time_point kernel_timestamp;
+    std::array<char, UDPServer::BUFSIZE + 1> receive_buffer{};
+    std::array<char, UDPServer::BUFSIZE + 1> read_buffer{};
+  };
+
+  SharedRSITransport();
+  void ioLoop();
+
+  int epoll_fd_ = -1;
+  std::atomic<bool> terminate_{false};
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<std::unique_ptr<Slot>> slots_;
+  std::thread io_thread_;
+};
+}  // namespace kuka_kss_rsi_driver
+
+#endif  // KUKA_KSS_RSI_DRIVER__SHARED_TRANSPORT_HPP_
@@ -40,136 +40,116 @@
 #ifndef KUKA_KSS_RSI_DRIVER__UDP_SERVER_H_
 #define KUKA_KSS_RSI_DRIVER__UDP_SERVER_H_
 
-// Select includes
-#include <sys/time.h>
-
-#include <string.h>
-#include <stdio.h>
-#include <unistd.h>
-#include <stdlib.h>
-#include <netdb.h>
-#include <sys/types.h>
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
-
-#include <iostream>
+#include <chrono>
 #include <string>
+#include <string_view>
 #include <stdexcept>
 
 #include "rclcpp/rclcpp.hpp"
 
+#include "kuka_drivers_core/udp_transport.hpp"
+#include "kuka_drivers_core/wire_capture.hpp"
+
+// Blocking UDP server of the RSI driver, on top of the common transport of the drivers
 class UDPServer
 {
 public:
+  using ReceiveMode = kuka_drivers_core::UdpTransport::ReceiveMode;
+  using Options = kuka_drivers_core::UdpTransport::Options;
+
+  // Maximal size of a received datagram
+  static const int BUFSIZE = static_cast<int>(kuka_drivers_core::UdpTransport::BUFFER_SIZE);
+
   UDPServer(std::string host, unsigned short port)
-  : local_host_(host), local_port_(port), timeout_(
-      false)
   {
-    RCLCPP_INFO(rclcpp::get_logger("UDPServer"), "%s: %i", local_host_.c_str(), local_port_);
-    sockfd_ = socket(AF_INET, SOCK_DGRAM, 0);
-    if (sockfd_ < 0) {
-      throw std::runtime_error("Error opening socket: " + std::string(strerror(errno)));
-    }
-    optval = 1;
-    setsockopt(sockfd_, SOL_SOCKET, SO_REUSEADDR, (const void *)&optval, sizeof(int));
-    memset(&serveraddr_, 0, sizeof(serveraddr_));
-    serveraddr_.sin_family = AF_INET;
-    serveraddr_.sin_addr.s_addr = inet_addr(local_host_.c_str());
-    serveraddr_.sin_port = htons(local_port_);
-    if (bind(sockfd_, (struct sockaddr *) &serveraddr_, sizeof(serveraddr_)) < 0) {
-      throw std::runtime_error("Error binding socket: " + std::string(strerror(errno)));
+    RCLCPP_INFO(rclcpp::get_logger("UDPServer"), "%s: %i", host.c_str(), port);
+    if (!transport_.Open(host, port)) {
+      throw std::runtime_error(transport_.Error());
     }
-    clientlen_ = sizeof(clientaddr_);
-  }
-
-  ~UDPServer()
-  {
-    close(sockfd_);
   }
 
   UDPServer(UDPServer & other) = delete;
   UDPServer & operator=(const UDPServer & other) = delete;
 
+  // Timeout of the receive calls, 0 waits without limit
   bool set_timeout(int millisecs)
   {
-    if (millisecs != 0) {
-      tv_.tv_sec = millisecs / 1000;
-      tv_.tv_usec = (millisecs % 1000) * 1000;
-      timeout_ = true;
-      return timeout_;
-    } else {
-      return timeout_;
+    timeout_ = std::chrono::milliseconds(millisecs);
+    return millisecs != 0;
+  }
+
+  // Applies the receive strategy, the kernel timestamps, the socket priority and the DSCP
+  bool configure(const Options & options)
+  {
+    if (!transport_.Configure(options)) {
+      RCLCPP_ERROR(rclcpp::get_logger("UDPServer"), "%s", transport_.Error().c_str());
+      return false;
     }
+    return true;
   }
 
   ssize_t send(std::string & buffer)
   {
-    ssize_t bytes = 0;
-    bytes = sendto(
-      sockfd_, buffer.c_str(),
-      buffer.size(), 0, (struct sockaddr *) &clientaddr_, clientlen_);
+    return send(buffer.c_str(), buffer.size());
+  }
+
+  ssize_t send(const char * buffer, size_t size)
+  {
+    const ssize_t bytes = transport_.Send(buffer, size);
     if (bytes < 0) {
       RCLCPP_ERROR(rclcpp::get_logger("UDPServer"), "Error in send");
     }
-
     return bytes;
   }
 
+  /**
+   * View of the last received datagram, valid until the next receive call
+   * The data is null-terminated for convenience, size does not include the terminator
+   */
+  struct Packet
+  {
+    std::string_view data;
+    std::chrono::steady_clock::time_point timestamp;
+    // Arrival time measured by the kernel (CLOCK_REALTIME), zero if not enabled
+    std::chrono::system_clock::time_point kernel_timestamp;
+  };
+
   ssize_t recv(std::string & buffer)
   {
-    ssize_t bytes = 0;
-
-    if (timeout_) {
-      fd_set read_fds;
-      FD_ZERO(&read_fds);
-      FD_SET(sockfd_, &read_fds);
-
-      struct timeval tv;
-      tv.tv_sec = tv_.tv_sec;
-      tv.tv_usec = tv_.tv_usec;
-
-      if (select(sockfd_ + 1, &read_fds, nullptr, nullptr, &tv) < 0) {
-        return 0;
-      }
-
-      if (FD_ISSET(sockfd_, &read_fds)) {
-        memset(buffer_, 0, BUFSIZE);
-        bytes =
-          recvfrom(sockfd_, buffer_, BUFSIZE, 0, (struct sockaddr *) &clientaddr_, &clientlen_);
-        if (bytes < 0) {
-          RCLCPP_ERROR(rclcpp::get_logger("UDPServer"), "Error in receive");
-        }
-      } else {
-        return 0;
-      }
-
-    } else {
-      memset(buffer_, 0, BUFSIZE);
-      bytes = recvfrom(sockfd_, buffer_, BUFSIZE, 0, (struct sockaddr *) &clientaddr_, &clientlen_);
-      if (bytes < 0) {
-        RCLCPP_ERROR(rclcpp::get_logger("UDPServer"), "Error in receive");
-      }
+    Packet packet;
+    ssize_t bytes = recv(packet);
+    buffer.assign(packet.data.data(), packet.data.size());
+    return bytes;
+  }
+
+  ssize_t recv(Packet & packet)
+  {
+    kuka_drivers_core::UdpTransport::Packet received;
+    const ssize_t bytes = transport_.Receive(received, timeout_);
+    if (bytes < 0) {
+      RCLCPP_ERROR(rclcpp::get_logger("UDPServer"), "Error in receive");
     }
+    packet.data = std::string_view(received.data != nullptr ? received.data : "", received.size);
+    packet.timestamp = received.timestamp;
+    packet.kernel_timestamp = received.kernel_timestamp;
+    return bytes;
+  }
 
-    buffer = std::string(buffer_);
+  // Socket descriptor, for waiting on several servers with epoll
+  int fd() const {return transport_.Fd();}
 
-    return bytes;
+  // Records the received and sent datagrams into the capture, nullptr disables recording
+  void set_capture(kuka_drivers_core::WireCapture * capture) {transport_.SetCapture(capture);}
+
+  // Applies network faults to the traffic for testing, nullptr disables fault injection
+  void set_fault_injector(kuka_drivers_core::FaultInjector * faults)
+  {
+    transport_.SetFaultInjector(faults);
   }
 
 private:
-  static const int BUFSIZE = 1024;
-  std::string local_host_;
-  uint16_t local_port_;
-  bool timeout_;
-  struct timeval tv_;
-
-  int sockfd_;
-  socklen_t clientlen_;
-  struct sockaddr_in serveraddr_;
-  struct sockaddr_in clientaddr_;
-  char buffer_[BUFSIZE];
-  int optval;
+  kuka_drivers_core::UdpTransport transport_;
+  std::chrono::microseconds timeout_{0};
 };
 
 #endif  // KUKA_KSS_RSI_DRIVER__UDP_SERVER_H_
@@ -18,7 +18,8 @@ from ament_index_python.packages import get_package_share_directory
 from launch import LaunchDescription
 from launch.actions import DeclareLaunchArgument, OpaqueFunction
 from launch.substitutions import Command, FindExecutable, PathJoinSubstitution, LaunchConfiguration
-from launch_ros.actions import Node, LifecycleNode
+from launch_ros.actions import LifecycleNode, LoadComposableNodes, Node
+from launch_ros.descriptions import ComposableNode
 from launch_ros.substitutions import FindPackageShare
 
 
@@ -51,19 +52,35 @@ def launch_setup(context, *args, **kwargs):
                                     "/config/joint_trajectory_controller_config.yaml")
 
     controller_manager_node = '/controller_manager'
+    composable = LaunchConfiguration('composable').perform(context) == 'true'
 
     control_node = Node(
         package='kuka_drivers_core',
         executable='control_node',
-        parameters=[robot_description, controller_config]
-    )
-    robot_manager_node = LifecycleNode(
-        name=['robot_manager'],
-        namespace='',
-        package="kuka_kss_rsi_driver",
-        executable="robot_manager_node",
-        parameters=[{'robot_model': robot_model}]
+        parameters=[robot_description, controller_config,
+                    {'component_container': composable}]
     )
+    if composable:
+        # Loaded into the process of the control node, the topics are passed within the process
+        robot_manager_node = LoadComposableNodes(
+            target_container='/control_container',
+            composable_node_descriptions=[ComposableNode(
+                package='kuka_kss_rsi_driver',
+                plugin='kuka_rsi::RobotManagerNode',
+                name='robot_manager',
+                namespace='',
+                parameters=[{'robot_model': robot_model}],
+                extra_arguments=[{'use_intra_process_comms': True}]
+            )]
+        )
+    else:
+        robot_manager_node = LifecycleNode(
+            name=['robot_manager'],
+            namespace='',
+            package="kuka_kss_rsi_driver",
+            executable="robot_manager_node",
+            parameters=[{'robot_model': robot_model}]
+        )
     robot_state_publisher = Node(
         package='robot_state_publisher',
         executable='robot_state_publisher',
@@ -114,4 +131,8 @@ def generate_launch_description():
         'use_fake_hardware',
         default_value="false"
     ))
+    launch_arguments.append(DeclareLaunchArgument(
+        'composable',
+        default_value="false"
+    ))
     return LaunchDescription(launch_arguments + [OpaqueFunction(function=launch_setup)])
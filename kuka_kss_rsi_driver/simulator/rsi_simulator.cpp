@@ -0,0 +1,263 @@
+// Copyright 2023 Svastits Áron
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <arpa/inet.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include "rsi_simulator.hpp"
+
+namespace kuka_kss_rsi_driver
+{
+namespace
+{
+timespec toTimespec(std::chrono::steady_clock::time_point time_point)
+{
+  const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    time_point.time_since_epoch()).count();
+  timespec ts;
+  ts.tv_sec = static_cast<time_t>(ns / 1000000000);
+  ts.tv_nsec = static_cast<long>(ns % 1000000000);  // NOLINT(runtime/int)
+  return ts;
+}
+
+// steady_clock is CLOCK_MONOTONIC on Linux
+void sleepUntil(std::chrono::steady_clock::time_point time_point)
+{
+  const timespec ts = toTimespec(time_point);
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+  }
+}
+
+char * append(char * it, char * end, const char * text)
+{
+  const std::size_t length = std::strlen(text);
+  if (it == nullptr || static_cast<std::size_t>(end - it) < length) {
+    return nullptr;
+  }
+  std::memcpy(it, text, length);
+  return it + length;
+}
+
+template<typename T>
+char * appendNumber(char * it, char * end, T value)
+{
+  if (it == nullptr) {
+    return nullptr;
+  }
+  std::to_chars_result result;
+  if constexpr (std::is_floating_point_v<T>) {
+    result = std::to_chars(it, end, value, std::chars_format::fixed, 4);
+  } else {
+    result = std::to_chars(it, end, value);
+  }
+  return result.ec == std::errc() ? result.ptr : nullptr;
+}
+
+char * appendAxes(char * it, char * end, const char * tag, const std::array<double, 6> & values)
+{
+  static constexpr const char * kAttributes[] =
+  {" A1=\"", " A2=\"", " A3=\"", " A4=\"", " A5=\"", " A6=\""};
+  it = append(append(it, end, "<"), end, tag);
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    it = append(appendNumber(append(it, end, kAttributes[i]), end, values[i]), end, "\"");
+  }
+  return append(it, end, "/>");
+}
+}  // namespace
+
+RSISimulator::RSISimulator(const Config & config)
+: config_(config), random_(config.seed)
+{
+  socket_ = socket(AF_INET, SOCK_DGRAM, 0);
+  if (socket_ < 0) {
+    throw std::runtime_error("Error opening socket: " + std::string(strerror(errno)));
+  }
+  std::memset(&driver_address_, 0, sizeof(driver_address_));
+  driver_address_.sin_family = AF_INET;
+  driver_address_.sin_port = htons(config_.driver_port);
+  if (inet_pton(AF_INET, config_.driver_ip.c_str(), &driver_address_.sin_addr) != 1) {
+    close(socket_);
+    throw std::runtime_error("Invalid driver address: " + config_.driver_ip);
+  }
+}
+
+RSISimulator::~RSISimulator()
+{
+  close(socket_);
+}
+
+bool RSISimulator::run()
+{
+  auto cycle_end = std::chrono::steady_clock::now();
+  while (!terminate_ && !stop_received_ &&
+    (config_.cycles == 0 || statistics_.cycles < config_.cycles))
+  {
+    cycle_end += config_.cycle_time;
+    cycle(cycle_end);
+    if (consecutive_late_ >= config_.max_late_packets) {
+      return false;
+    }
+    sleepUntil(cycle_end);
+  }
+  return true;
+}
+
+void RSISimulator::cycle(std::chrono::steady_clock::time_point cycle_end)
+{
+  const auto cycle_start = cycle_end - config_.cycle_time;
+  if (config_.jitter.count() > 0) {
+    std::uniform_int_distribution<int64_t> jitter(0, config_.jitter.count());
+    sleepUntil(cycle_start + std::chrono::microseconds(jitter(random_)));
+  }
+
+  // The IPOC of the controller is a millisecond timestamp
+  ipoc_ += std::max<int64_t>(
+    std::chrono::duration_cast<std::chrono::milliseconds>(config_.cycle_time).count(), 1);
+  statistics_.cycles++;
+
+  const bool lost = config_.loss_probability > 0 &&
+    std::uniform_real_distribution<double>(0, 1)(random_) < config_.loss_probability;
+  std::chrono::steady_clock::time_point send_time;
+  if (lost) {
+    statistics_.lost_packets++;
+  } else {
+    char buffer[1024];
+    const std::size_t size = renderState(buffer, sizeof(buffer));
+    send_time = std::chrono::steady_clock::now();
+    sendto(
+      socket_, buffer, size, 0, reinterpret_cast<struct sockaddr *>(&driver_address_),
+      sizeof(driver_address_));
+  }
+
+  bool answered = false;
+  char reply[1025];
+  for (auto now = std::chrono::steady_clock::now(); !answered && now < cycle_end;
+    now = std::chrono::steady_clock::now())
+  {
+    struct pollfd fds = {socket_, POLLIN, 0};
+    const timespec timeout = toTimespec(std::chrono::steady_clock::time_point(cycle_end - now));
+    if (ppoll(&fds, 1, &timeout, nullptr) <= 0) {
+      continue;
+    }
+
+    ssize_t bytes;
+    while ((bytes = recv(socket_, reply, sizeof(reply) - 1, MSG_DONTWAIT)) > 0) {
+      const auto receive_time = std::chrono::steady_clock::now();
+      reply[bytes] = '\0';
+
+      std::array<double, 6> corrections{};
+      uint64_t ipoc = 0;
+      bool stop = false;
+      if (!parseReply(reply, corrections, ipoc, stop)) {
+        statistics_.malformed_replies++;
+      } else if (lost || answered || ipoc != ipoc_) {
+        statistics_.stale_replies++;
+      } else {
+        answered = true;
+        stop_received_ = stop;
+        latency_.Record(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(receive_time - send_time).count());
+        for (std::size_t i = 0; i < positions_.size(); ++i) {
+          positions_[i] = initial_positions_[i] + corrections[i];
+        }
+      }
+    }
+  }
+
+  if (answered) {
+    connected_ = true;
+    consecutive_late_ = 0;
+  } else if (connected_) {
+    statistics_.late_packets++;
+    consecutive_late_++;
+    statistics_.max_consecutive_late =
+      std::max(statistics_.max_consecutive_late, consecutive_late_);
+  }
+}
+
+std::size_t RSISimulator::renderState(char * buffer, std::size_t size) const
+{
+  char * it = buffer;
+  char * const end = buffer + size;
+  it = append(it, end, "<Rob TYPE=\"KUKA\"><RIst X=\"0.0\" Y=\"0.0\" Z=\"0.0\" A=\"0.0\" "
+    "B=\"0.0\" C=\"0.0\"/><RSol X=\"0.0\" Y=\"0.0\" Z=\"0.0\" A=\"0.0\" B=\"0.0\" C=\"0.0\"/>");
+  it = appendAxes(it, end, "AIPos", positions_);
+  it = appendAxes(it, end, "ASPos", initial_positions_);
+  it = appendNumber(append(it, end, "<Delay D=\""), end, statistics_.late_packets);
+  it = appendNumber(append(it, end, "\"/><IPOC>"), end, ipoc_);
+  it = append(it, end, "</IPOC></Rob>");
+  return it != nullptr ? static_cast<std::size_t>(it - buffer) : 0;
+}
+
+bool RSISimulator::parseReply(
+  const char * buffer, std::array<double, 6> & corrections, uint64_t & ipoc, bool & stop)
+{
+  const char * ak = std::strstr(buffer, "<AK");
+  const char * ipoc_tag = std::strstr(buffer, "<IPOC>");
+  if (ipoc_tag == nullptr) {
+    return false;
+  }
+  ipoc = std::strtoull(ipoc_tag + 6, nullptr, 10);
+
+  const char * stop_tag = std::strstr(buffer, "<Stop>");
+  stop = stop_tag != nullptr && stop_tag[6] == '1';
+
+  // Cartesian corrections (RKorr) are accepted, but not simulated
+  if (ak != nullptr) {
+    const char * ak_end = std::strchr(ak, '>');
+    char name[] = " A1=\"";
+    for (std::size_t i = 0; i < corrections.size(); ++i) {
+      name[2] = static_cast<char>('1' + i);
+      const char * attribute = std::strstr(ak, name);
+      if (attribute == nullptr || attribute > ak_end) {
+        return false;
+      }
+      // Independent of the locale, like the parser of the driver
+      const char * value_end = std::strchr(attribute + 5, '"');
+      if (value_end == nullptr ||
+        std::from_chars(attribute + 5, value_end, corrections[i]).ec != std::errc())
+      {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void RSISimulator::printReport(const char * name) const
+{
+  const auto snapshot = latency_.GetSnapshot();
+  printf(
+    "%s: cycles: %lu, lost: %lu, late: %lu (max consecutive: %lu), stale replies: %lu, "
+    "malformed replies: %lu\n", name, statistics_.cycles, statistics_.lost_packets,
+    statistics_.late_packets, statistics_.max_consecutive_late, statistics_.stale_replies,
+    statistics_.malformed_replies);
+  printf(
+    "%s: replies: %lu, reply latency [us] p50: %lu, p90: %lu, p99: %lu, p99.9: %lu, "
+    "max: %lu\n", name, snapshot.count, snapshot.Percentile(50) / 1000, snapshot.Percentile(90) / 1000,
+    snapshot.Percentile(99) / 1000, snapshot.Percentile(99.9) / 1000, snapshot.max_ns / 1000);
+}
+}  // namespace kuka_kss_rsi_driver
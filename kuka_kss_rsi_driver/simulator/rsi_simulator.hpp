@@ -0,0 +1,118 @@
+// Copyright 2023 Svastits Áron
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_KSS_RSI_DRIVER__RSI_SIMULATOR_HPP_
+#define KUKA_KSS_RSI_DRIVER__RSI_SIMULATOR_HPP_
+
+#include <netinet/in.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <string>
+
+#include "kuka_drivers_core/latency_histogram.hpp"
+
+namespace kuka_kss_rsi_driver
+{
+/**
+ * Plays the robot controller side of RSI with the timing of the KSS
+ *
+ * A <Rob> frame is sent at the start of every cycle and the <Sen> reply with the same IPOC
+ * is expected before the next cycle starts, otherwise the cycle is counted as late like the
+ * controller does, and the counter is reported in the Delay element. The joint corrections
+ * of the replies are applied to the simulated axis positions.
+ */
+class RSISimulator
+{
+public:
+  struct Config
+  {
+    std::string driver_ip = "127.0.0.1";
+    uint16_t driver_port = 59152;
+    std::chrono::microseconds cycle_time{4000};
+    // Send times are delayed by a uniformly distributed random value up to this
+    std::chrono::microseconds jitter{0};
+    // Probability of not sending the state frame in a cycle
+    double loss_probability = 0;
+    // The simulation stops after this many consecutive late cycles, like the RSI object
+    uint64_t max_late_packets = 100;
+    // Number of cycles to run, 0 runs until the Stop flag is received
+    uint64_t cycles = 0;
+    uint32_t seed = 0;
+  };
+
+  struct Statistics
+  {
+    uint64_t cycles = 0;
+    uint64_t lost_packets = 0;          // State frames dropped by loss injection
+    uint64_t late_packets = 0;          // Cycles without a reply in time, reported as Delay
+    uint64_t max_consecutive_late = 0;
+    uint64_t stale_replies = 0;         // Replies received for an earlier cycle
+    uint64_t malformed_replies = 0;
+  };
+
+  // Reply latencies in 10 us buckets up to 10 ms
+  using Histogram = kuka_drivers_core::LatencyHistogram<1000, 10000>;
+
+  explicit RSISimulator(const Config & config);
+  ~RSISimulator();
+
+  RSISimulator(const RSISimulator &) = delete;
+  RSISimulator & operator=(const RSISimulator &) = delete;
+
+  /**
+   * @brief Run the cycles with absolute timing until finished or stop() is called
+   * @returns false if the simulation was aborted because of too many late packets
+   */
+  bool run();
+
+  // Can be called from any thread
+  void stop() {terminate_ = true;}
+
+  const Statistics & statistics() const {return statistics_;}
+  const Histogram & latency() const {return latency_;}
+
+  // Prints the statistics and the reply latency distribution
+  void printReport(const char * name) const;
+
+private:
+  // Sends the state frame and waits for the reply until the next cycle starts
+  void cycle(std::chrono::steady_clock::time_point cycle_end);
+  std::size_t renderState(char * buffer, std::size_t size) const;
+  static bool parseReply(
+    const char * buffer, std::array<double, 6> & corrections, uint64_t & ipoc, bool & stop);
+
+  Config config_;
+  int socket_ = -1;
+  struct sockaddr_in driver_address_;
+
+  std::array<double, 6> initial_positions_{{0, -90, 90, 0, 90, 0}};
+  std::array<double, 6> positions_ = initial_positions_;
+  uint64_t ipoc_ = 0;
+  uint64_t consecutive_late_ = 0;
+  // Late cycles are only counted after the driver answered the first time
+  bool connected_ = false;
+  bool stop_received_ = false;
+  std::atomic<bool> terminate_{false};
+
+  std::mt19937 random_;
+  Statistics statistics_;
+  Histogram latency_;
+};
+}  // namespace kuka_kss_rsi_driver
+
+#endif  // KUKA_KSS_RSI_DRIVER__RSI_SIMULATOR_HPP_
@@ -0,0 +1,150 @@
+// Copyright 2023 Svastits Áron
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <getopt.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rsi_simulator.hpp"
+
+namespace
+{
+std::vector<std::unique_ptr<kuka_kss_rsi_driver::RSISimulator>> g_simulators;
+
+void onSignal(int)
+{
+  for (auto & simulator : g_simulators) {
+    simulator->stop();
+  }
+}
+
+void printUsage(const char * program)
+{
+  printf(
+    "Usage: %s [options]\n"
+    "  --ip <address>      IP address of the driver (default: 127.0.0.1)\n"
+    "  --port <port>       driver port, of the first robot with --robots (default: 59152)\n"
+    "  --robots <n>        number of simulated robots, robot i sends to port + i (default: 1)\n"
+    "  --cycle-ms <ms>     RSI cycle time, 4 or 12 (default: 4)\n"
+    "  --jitter-us <us>    maximal random delay of the state frames (default: 0)\n"
+    "  --loss <p>          probability of dropping a state frame (default: 0)\n"
+    "  --max-late <n>      consecutive late cycles before aborting (default: 100)\n"
+    "  --cycles <n>        number of cycles, 0 runs until the Stop flag (default: 0)\n"
+    "  --seed <n>          seed of the jitter and loss injection (default: 0)\n"
+    "  --priority <p>      run with SCHED_FIFO and the given priority\n", program);
+}
+}  // namespace
+
+int main(int argc, char * argv[])
+{
+  static const struct option kOptions[] = {
+    {"ip", required_argument, nullptr, 'i'},
+    {"port", required_argument, nullptr, 'p'},
+    {"robots", required_argument, nullptr, 'N'},
+    {"cycle-ms", required_argument, nullptr, 'c'},
+    {"jitter-us", required_argument, nullptr, 'j'},
+    {"loss", required_argument, nullptr, 'l'},
+    {"max-late", required_argument, nullptr, 'm'},
+    {"cycles", required_argument, nullptr, 'n'},
+    {"seed", required_argument, nullptr, 's'},
+    {"priority", required_argument, nullptr, 'r'},
+    {"help", no_argument, nullptr, 'h'},
+    {nullptr, 0, nullptr, 0}};
+
+  kuka_kss_rsi_driver::RSISimulator::Config config;
+  int priority = 0;
+  int robots = 1;
+  int option;
+  while ((option = getopt_long(argc, argv, "h", kOptions, nullptr)) != -1) {
+    switch (option) {
+      case 'i': config.driver_ip = optarg; break;
+      case 'p': config.driver_port = static_cast<uint16_t>(std::stoi(optarg)); break;
+      case 'N': robots = std::max(std::stoi(optarg), 1); break;
+      case 'c': config.cycle_time = std::chrono::milliseconds(std::stoi(optarg)); break;
+      case 'j': config.jitter = std::chrono::microseconds(std::stoi(optarg)); break;
+      case 'l': config.loss_probability = std::stod(optarg); break;
+      case 'm': config.max_late_packets = std::stoull(optarg); break;
+      case 'n': config.cycles = std::stoull(optarg); break;
+      case 's': config.seed = static_cast<uint32_t>(std::stoul(optarg)); break;
+      case 'r': priority = std::stoi(optarg); break;
+      default:
+        printUsage(argv[0]);
+        return option == 'h' ? 0 : 1;
+    }
+  }
+
+  if (priority > 0) {
+    struct sched_param param;
+    param.sched_priority = priority;
+    if (sched_setscheduler(0, SCHED_FIFO, &param) == -1) {
+      fprintf(stderr, "Setting SCHED_FIFO priority failed: %s\n", strerror(errno));
+      return 1;
+    }
+  }
+
+  // Each robot has its own port and IPOC stream, the priority is inherited by the threads
+  for (int i = 0; i < robots; ++i) {
+    auto robot_config = config;
+    robot_config.driver_port = static_cast<uint16_t>(config.driver_port + i);
+    robot_config.seed = config.seed + static_cast<uint32_t>(i);
+    g_simulators.push_back(std::make_unique<kuka_kss_rsi_driver::RSISimulator>(robot_config));
+  }
+  std::signal(SIGINT, onSignal);
+  std::signal(SIGTERM, onSignal);
+
+  printf(
+    "Simulating %d RSI robot(s) with %ld ms cycle time towards %s:%u\n", robots,
+    static_cast<long>(  // NOLINT(runtime/int)
+      std::chrono::duration_cast<std::chrono::milliseconds>(config.cycle_time).count()),
+    config.driver_ip.c_str(), config.driver_port);
+
+  std::vector<char> results(robots, 0);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < robots; ++i) {
+    threads.emplace_back([i, &results] {results[i] = g_simulators[i]->run();});
+  }
+  for (auto & thread : threads) {
+    thread.join();
+  }
+
+  bool success = true;
+  uint64_t late_packets = 0;
+  uint64_t cycles = 0;
+  for (int i = 0; i < robots; ++i) {
+    const std::string name = "robot_" + std::to_string(i) + " (port " +
+      std::to_string(config.driver_port + i) + ")";
+    if (!results[i]) {
+      printf("%s: aborted after %lu consecutive late packets\n", name.c_str(),
+        config.max_late_packets);
+      success = false;
+    }
+    g_simulators[i]->printReport(name.c_str());
+    late_packets += g_simulators[i]->statistics().late_packets;
+    cycles += g_simulators[i]->statistics().cycles;
+  }
+  if (robots > 1) {
+    printf("total: cycles: %lu, late: %lu\n", cycles, late_packets);
+  }
+  g_simulators.clear();
+  return success ? 0 : 1;
+}
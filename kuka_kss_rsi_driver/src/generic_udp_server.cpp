@@ -34,40 +34,35 @@
  ***********************************************************************************************************************
  */
 
-#include <boost/bind.hpp>
+#include <string>
 
-#include "kuka_kss_rsi_driver_components/generic_udp_server.h"
+#include "kuka_kss_rsi_driver/generic_udp_server.h"
 
 namespace kuka
 {
-namespace rsi{
-/***********************************************************************************************************************
- * Class definitions: UDPServer
- */
-
-UDPServer::UDPServer(boost::asio::io_service& io_service,
-                     unsigned short port_number,
-                     AbstractUDPServerInterface* p_interface)
-:
-initialized_(false),
-p_interface_(p_interface)
+namespace rsi
 {
-  bool success = true;
+UDPServer::UDPServer(
+  boost::asio::io_context & io_context, const std::string & host, uint16_t port_number,
+  AbstractUDPServerInterface * p_interface)
+: socket_(io_context),
+  p_interface_(p_interface)
+{
+  server_data_.port_number = port_number;
 
-  try
-  {
-    server_data_.port_number = port_number;
-    p_socket_.reset(new boost::asio::ip::udp::socket(io_service,
-                                                     boost::asio::ip::udp::endpoint(boost::asio::ip::udp::v4(),
-                                                                                    port_number)));
+  boost::system::error_code error;
+  const auto address = boost::asio::ip::make_address(host, error);
+  if (!error) {
+    socket_.open(boost::asio::ip::udp::v4(), error);
+  }
+  if (!error) {
+    socket_.set_option(boost::asio::socket_base::reuse_address(true), error);
   }
-  catch (std::exception e)
-  {
-    success = false;
+  if (!error) {
+    socket_.bind(boost::asio::ip::udp::endpoint(address, port_number), error);
   }
 
-  if (success)
-  {
+  if (!error) {
     initialized_ = true;
     startAsynchronousReceive();
   }
@@ -75,11 +70,8 @@ p_interface_(p_interface)
 
 UDPServer::~UDPServer()
 {
-  if (p_socket_)
-  {
-    p_socket_->close();
-    p_socket_.reset();
-  }
+  boost::system::error_code error;
+  socket_.close(error);
 }
 
 bool UDPServer::isInitialized() const
@@ -89,44 +81,38 @@ bool UDPServer::isInitialized() const
 
 void UDPServer::startAsynchronousReceive()
 {
-  if (p_socket_)
-  {
-    p_socket_->async_receive_from(boost::asio::buffer(receive_buffer_),
-                                  remote_endpoint_,
-                                  boost::bind(&UDPServer::receiveCallback,
-                                              this,
-                                              boost::asio::placeholders::error,
-                                              boost::asio::placeholders::bytes_transferred));
-  }
+  socket_.async_receive_from(
+    boost::asio::buffer(receive_buffer_, BUFFER_SIZE), remote_endpoint_,
+    [this](const boost::system::error_code & error, std::size_t bytes_transferred) {
+      receiveCallback(error, bytes_transferred);
+    });
 }
 
-void UDPServer::receiveCallback(const boost::system::error_code& error, const std::size_t bytes_transferred)
+void UDPServer::receiveCallback(
+  const boost::system::error_code & error, std::size_t bytes_transferred)
 {
-  server_data_.p_data = receive_buffer_;
-  server_data_.bytes_transferred = (int) bytes_transferred;
+  if (error == boost::asio::error::operation_aborted) {
+    // The socket was closed
+    return;
+  }
 
-  if (error == boost::system::errc::success && p_interface_)
-  {
-    // Process the received data via the callback method (creates the reply message).
-    const std::string& reply = p_interface_->callback(server_data_);
+  if (!error && p_interface_ != nullptr) {
+    receive_buffer_[bytes_transferred] = '\0';
+    server_data_.p_data = receive_buffer_;
+    server_data_.bytes_transferred = bytes_transferred;
 
-    if (!reply.empty() && p_socket_)
-    {
-      // Send the response message to the robot controller.
-      p_socket_->async_send_to(boost::asio::buffer(reply),
-                               remote_endpoint_,
-                               boost::bind(&UDPServer::sendCallback,
-                                           this,
-                                           boost::asio::placeholders::error,
-                                           boost::asio::placeholders::bytes_transferred));
+    // Process the received data via the callback method (creates the reply message)
+    const std::string_view reply = p_interface_->callback(server_data_);
+    if (!reply.empty()) {
+      // Sending a datagram does not block, answering right away keeps the reply latency low
+      boost::system::error_code send_error;
+      socket_.send_to(
+        boost::asio::buffer(reply.data(), reply.size()), remote_endpoint_, 0, send_error);
     }
   }
 
-  // Add another asynchronous operation to the boost io_service object.
+  // Add another asynchronous operation to the io_context
   startAsynchronousReceive();
 }
-
-void UDPServer::sendCallback(const boost::system::error_code& error, const std::size_t bytes_transferred) {}
-
-} // end namespace egm
-} // end namespace abb
\ No newline at end of file
+}  // namespace rsi
+}  // namespace kuka
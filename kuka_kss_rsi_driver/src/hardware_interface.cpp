@@ -41,79 +41,247 @@
 #include <stdexcept>
 #include <string>
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include "hardware_interface/types/hardware_interface_type_values.hpp"
+#include "kuka_drivers_core/hardware_interface_types.hpp"
+#include "kuka_drivers_core/hardware_parameters.hpp"
 
 #include "kuka_kss_rsi_driver/hardware_interface.hpp"
 
 namespace kuka_kss_rsi_driver
 {
+namespace
+{
+// Order of the values in RIst and RKorr
+constexpr const char * kCartesianInterfaces[] = {
+  hardware_interface::CARTESIAN_X, hardware_interface::CARTESIAN_Y,
+  hardware_interface::CARTESIAN_Z, hardware_interface::CARTESIAN_A,
+  hardware_interface::CARTESIAN_B, hardware_interface::CARTESIAN_C};
+}  // namespace
+
 CallbackReturn KukaRSIHardwareInterface::on_init(const hardware_interface::HardwareInfo & info)
 {
+  startup_profile_.Reset();
+  kuka_drivers_core::StartupProfile::Scope init_phase(startup_profile_, "on_init");
   if (hardware_interface::SystemInterface::on_init(info) != CallbackReturn::SUCCESS) {
     return CallbackReturn::ERROR;
   }
+  startup_profile_.SetComponent(info_.name);
 
-  hw_states_.resize(info_.joints.size(), 0.0);
-  hw_commands_.resize(info_.joints.size(), 0.0);
-
-  for (const hardware_interface::ComponentInfo & joint : info_.joints) {
-    if (joint.command_interfaces.size() != 1) {
-      RCLCPP_FATAL(
-        rclcpp::get_logger(
-          "KukaRSIHardwareInterface"), "expecting exactly 1 command interface");
-      return CallbackReturn::ERROR;
-    }
+  // The first 6 joints are the robot axes, the rest are external axes (E1-E6)
+  if (info_.joints.size() < RSIState::ROBOT_AXES || info_.joints.size() > RSIState::MAX_AXES) {
+    RCLCPP_FATAL(
+      rclcpp::get_logger("KukaRSIHardwareInterface"),
+      "expecting 6 robot axes and at most 6 external axes, got %zu joints", info_.joints.size());
+    return CallbackReturn::ERROR;
+  }
+  const std::size_t external_axes = info_.joints.size() - RSIState::ROBOT_AXES;
+  parse_state_ = RSIState::parserFor(external_axes);
+  encode_command_ = RSICommand::encoderFor(external_axes);
 
-    if (joint.command_interfaces[0].name != hardware_interface::HW_IF_POSITION) {
-      RCLCPP_FATAL(
-        rclcpp::get_logger(
-          "KukaRSIHardwareInterface"), "expecting only POSITION command interface");
-      return CallbackReturn::ERROR;
-    }
+  const std::size_t position_state = joint_storage_.AddState(hardware_interface::HW_IF_POSITION);
+  const std::size_t position_command =
+    joint_storage_.AddCommand(hardware_interface::HW_IF_POSITION);
+  std::vector<std::string> joint_names;
+  for (const auto & joint : info_.joints) {
+    joint_names.push_back(joint.name);
+  }
+  joint_storage_.Allocate(joint_names);
+  hw_states_ = joint_storage_.State(position_state);
+  hw_commands_ = joint_storage_.Command(position_command);
+  filtered_commands_.resize(info_.joints.size(), 0.0);
 
-    if (joint.state_interfaces.size() != 1) {
-      RCLCPP_FATAL(
-        rclcpp::get_logger(
-          "KukaRSIHardwareInterface"), "expecting exactly 1 state interface");
-      return CallbackReturn::ERROR;
-    }
+  // In Cartesian mode the joints are only monitored, the robot is commanded through RKorr
+  using Method = CommandExtrapolator::Method;
+  kuka_drivers_core::HardwareParameters parameters(info_.hardware_parameters);
+  parameters.GetChoice(
+    "correction_mode", cartesian_correction_, {{"joint", false}, {"cartesian", true}});
+  rsi_ip_address_ = parameters.String("client_ip");
+  parameters.Require("client_port", rsi_port_, 0, 65535);
+  // Number of fractional digits of the joint corrections sent to the robot
+  parameters.Get("command_precision", command_precision_, 0, 17);
+  bool shared_transport = false;
+  parameters.GetFlag("shared_transport", shared_transport);
+  parameters.Get("sync_window_us", sync_window_);
+  uint64_t delay_warning_threshold = 0;
+  parameters.Get("delay_warning_threshold", delay_warning_threshold);
+  // Optional extrapolated reply if the controllers do not finish in time
+  parameters.Get("reply_deadline_us", reply_deadline_);
+  Method extrapolation = Method::HOLD;
+  parameters.GetChoice(
+    "extrapolation", extrapolation,
+    {{"hold", Method::HOLD}, {"linear", Method::LINEAR}, {"quadratic", Method::QUADRATIC}});
+  // Optional reactor-style transport answering from the receive handler
+  parameters.GetFlag("async_transport", async_transport_);
+  // Optional waiting for the next RSI session after a receive timeout instead of deactivating
+  parameters.GetFlag("session_resume", session_resume_);
+  parameters.Get("resume_tolerance", resume_tolerance_, 0.0);
+  // Commands of controllers updated only every command_update_cycles robot cycles
+  parameters.Get("command_update_cycles", command_update_cycles_, 1);
+  if (!parameters.Ok()) {
+    RCLCPP_FATAL(rclcpp::get_logger("KukaRSIHardwareInterface"), "%s", parameters.Error().c_str());
+    return CallbackReturn::ERROR;
+  }
 
-    if (joint.state_interfaces[0].name != hardware_interface::HW_IF_POSITION) {
-      RCLCPP_FATAL(
-        rclcpp::get_logger(
-          "KukaRSIHardwareInterface"), "expecting only POSITION state interface");
-      return CallbackReturn::ERROR;
-    }
+  if (!check_joint_interfaces()) {
+    return CallbackReturn::ERROR;
   }
 
   // RSI
-  in_buffer_.resize(1024);  // udp_server.h --> #define BUFSIZE 1024
-  out_buffer_.resize(1024);
-
   initial_joint_pos_.resize(info_.joints.size(), 0.0);
   joint_pos_correction_deg_.resize(info_.joints.size(), 0.0);
   ipoc_ = 0;
-
-  rsi_ip_address_ = info_.hardware_parameters["client_ip"];
-  rsi_port_ = std::stoi(info_.hardware_parameters["client_port"]);
-
+  rsi_command_ = RSICommand(command_precision_);
+  ipoc_tracker_ = IPOCTracker(delay_warning_threshold);
   RCLCPP_INFO(
     rclcpp::get_logger("KukaRSIHardwareInterface"),
     "IP of client machine: %s:%d", rsi_ip_address_.c_str(), rsi_port_);
 
+  // Low latency receive strategy and traffic class of the replies, I/O thread, cycle
+  //  coordination and clock synchronization, see kuka_drivers_core
+  const auto & hardware_parameters = info_.hardware_parameters;
+  std::chrono::nanoseconds min_latency;
+  std::string error;
+  if (
+    !kuka_drivers_core::UdpTransport::ParseOptions(
+      hardware_parameters, transport_options_, error) ||
+    !kuka_drivers_core::IOThread::ParseOptions(hardware_parameters, io_thread_options_, error) ||
+    !kuka_drivers_core::CycleCoordinator::ParseOptions(
+      hardware_parameters, cycle_coordination_options_, error) ||
+    !kuka_drivers_core::ClockSync::ParseMinLatency(hardware_parameters, min_latency, error))
+  {
+    RCLCPP_FATAL(rclcpp::get_logger("KukaRSIHardwareInterface"), "%s", error.c_str());
+    return CallbackReturn::ERROR;
+  }
+  // The io_thread parameter uses the I/O thread of the async transport
+  async_transport_ = async_transport_ || io_thread_options_.enabled;
+
+  // Combinations the transports do not support
+  const std::pair<bool, const char *> conflicts[] = {
+    {async_transport_ && (shared_transport || reply_deadline_.count() > 0),
+      "async_transport and io_thread cannot be combined with shared_transport or "
+      "reply_deadline_us"},
+    // The cycles are started by the coordinator, read() must not wait for the state
+    {cycle_coordination_options_.enabled && !io_thread_options_.enabled,
+      "cycle_coordination requires io_thread"},
+    {async_transport_ && !transport_options_.xdp_interface.empty(),
+      "xdp_interface cannot be combined with async_transport"},
+    {async_transport_ && !parameters.String("rsi_ethernet_config").empty(),
+      "rsi_ethernet_config cannot be combined with async_transport"},
+    {async_transport_ && !info_.gpios.empty(),
+      "GPIO interfaces are not supported with async_transport"},
+    {session_resume_ && (shared_transport || async_transport_ || cartesian_correction_),
+      "session_resume cannot be combined with shared_transport, async_transport or Cartesian "
+      "correction"},
+    {!parameters.String("fault_profile").empty() && (shared_transport || async_transport_),
+      "fault_profile cannot be combined with shared_transport or async_transport"}};
+  for (const auto & conflict : conflicts) {
+    if (conflict.first) {
+      RCLCPP_FATAL(rclcpp::get_logger("KukaRSIHardwareInterface"), "%s", conflict.second);
+      return CallbackReturn::ERROR;
+    }
+  }
+
+  if (shared_transport) {
+    shared_transport_ = SharedRSITransport::instance();
+  }
+  // The IPOC counts milliseconds of the controller clock
+  clock_sync_ = kuka_drivers_core::ClockSync(1e-3, min_latency);
+  if (reply_deadline_.count() > 0) {
+    extrapolator_ = CommandExtrapolator(
+      extrapolation,
+      cartesian_correction_ ? cart_correction_.size() : joint_pos_correction_deg_.size());
+    reply_watchdog_ = std::make_unique<ReplyWatchdog>([this] {send_extrapolated_reply();});
+  }
+  if (!configure_schema(external_axes) || !configure_gpios()) {
+    return CallbackReturn::ERROR;
+  }
+
+  // Optional diagnostics, metrics, network faults, recordings, publishers, command filters,
+  //  tuning and interpolation, see the README of kuka_drivers_core
+  using LinkMetric = kuka_drivers_core::LinkDiagnostics::Metric;
+  const std::vector<LinkMetric> link_metrics = {
+    {"missed cycles", kuka_drivers_core::LinkDiagnostics::Kind::COUNTER, 1.0, 10.0, false},
+    {"late packets", kuka_drivers_core::LinkDiagnostics::Kind::COUNTER, 1.0, 10.0, false}};
+  const std::size_t joint_count = info_.joints.size();
+  if (
+    !ConfigureLatencyDiagnostics(hardware_parameters, info_.name, latency_diagnostics_, error) ||
+    !kuka_drivers_core::ConfigureLinkDiagnostics(
+      hardware_parameters, info_.name, link_metrics, link_diagnostics_, error) ||
+    !kuka_drivers_core::ConfigureMetrics(hardware_parameters, info_.name, metrics_group_, error) ||
+    !kuka_drivers_core::ConfigureFaultInjection(hardware_parameters, fault_injector_, error) ||
+    !kuka_drivers_core::ConfigureWireCapture(hardware_parameters, wire_capture_, error) ||
+    !kuka_drivers_core::ConfigureFlightRecorder(hardware_parameters, flight_recorder_, error) ||
+    !kuka_drivers_core::ConfigureStateChannel(
+      hardware_parameters, joint_count, state_channel_, error) ||
+    !kuka_drivers_core::ConfigureJointStatePublisher(
+      hardware_parameters, info_.name, joint_names, joint_state_publisher_, error) ||
+    !kuka_drivers_core::ConfigureStateBatchPublisher(
+      hardware_parameters, info_.name, joint_names, state_batch_publisher_, error) ||
+    !kuka_drivers_core::ConfigureCommandFilter(
+      hardware_parameters, joint_count, command_filter_, error) ||
+    !kuka_drivers_core::ConfigureTuningParameters(
+      hardware_parameters, info_.name, joint_count, &Tuning::command_filter, tuning_, error) ||
+    !command_interpolator_.Configure(hardware_parameters, joint_count, error))
+  {
+    RCLCPP_FATAL(rclcpp::get_logger("KukaRSIHardwareInterface"), "%s", error.c_str());
+    return CallbackReturn::ERROR;
+  }
+  if (fault_injector_ != nullptr) {
+    RCLCPP_WARN(
+      rclcpp::get_logger("KukaRSIHardwareInterface"), "Fault injection enabled: %s",
+      parameters.String("fault_profile").c_str());
+  }
+  register_metrics();
+
   return CallbackReturn::SUCCESS;
 }
 
 std::vector<hardware_interface::StateInterface> KukaRSIHardwareInterface::export_state_interfaces()
 {
   std::vector<hardware_interface::StateInterface> state_interfaces;
-  for (size_t i = 0; i < info_.joints.size(); i++) {
+  joint_storage_.ExportStateInterfaces(state_interfaces);
+
+  auto & statistics = ipoc_tracker_.statistics();
+  state_interfaces.emplace_back(
+    hardware_interface::RSI_STATE_PREFIX, hardware_interface::IPOC_DELTA,
+    &statistics.ipoc_delta);
+  state_interfaces.emplace_back(
+    hardware_interface::RSI_STATE_PREFIX, hardware_interface::MISSED_CYCLES,
+    &statistics.missed_cycles);
+  state_interfaces.emplace_back(
+    hardware_interface::RSI_STATE_PREFIX, hardware_interface::DUPLICATE_PACKETS,
+    &statistics.duplicate_packets);
+  state_interfaces.emplace_back(
+    hardware_interface::RSI_STATE_PREFIX, hardware_interface::OUT_OF_ORDER_PACKETS,
+    &statistics.out_of_order_packets);
+  state_interfaces.emplace_back(
+    hardware_interface::RSI_STATE_PREFIX, hardware_interface::LATE_PACKETS,
+    &statistics.late_packets);
+  state_interfaces.emplace_back(
+    hardware_interface::RSI_STATE_PREFIX, hardware_interface::STATE_STAMP, &state_stamp_);
+  state_interfaces.emplace_back(
+    hardware_interface::RSI_STATE_PREFIX, hardware_interface::ONE_WAY_LATENCY,
+    &one_way_latency_);
+  state_interfaces.emplace_back(
+    hardware_interface::RSI_STATE_PREFIX, hardware_interface::CLOCK_DRIFT, &clock_drift_);
+  if (reply_watchdog_ != nullptr) {
     state_interfaces.emplace_back(
-      info_.joints[i].name,
-      hardware_interface::HW_IF_POSITION,
-      &hw_states_[i]);
+      hardware_interface::RSI_STATE_PREFIX, hardware_interface::EXTRAPOLATED_CYCLES,
+      &extrapolated_cycles_);
+  }
+
+  if (cartesian_correction_) {
+    for (std::size_t i = 0; i < cart_states_.size(); ++i) {
+      state_interfaces.emplace_back(
+        hardware_interface::CARTESIAN_STATE_PREFIX, kCartesianInterfaces[i], &cart_states_[i]);
+    }
+  }
+
+  for (auto & reader : gpio_readers_) {
+    state_interfaces.emplace_back(reader.getComponent(), reader.getName(), &reader.getData());
   }
   return state_interfaces;
 }
@@ -122,53 +290,103 @@ std::vector<hardware_interface::CommandInterface> KukaRSIHardwareInterface::
 export_command_interfaces()
 {
   std::vector<hardware_interface::CommandInterface> command_interfaces;
-  for (size_t i = 0; i < info_.joints.size(); i++) {
-    command_interfaces.emplace_back(
-      info_.joints[i].name,
-      hardware_interface::HW_IF_POSITION,
-      &hw_commands_[i]);
+  for (auto & writer : gpio_writers_) {
+    command_interfaces.emplace_back(writer.getComponent(), writer.getName(), &writer.getData());
+  }
+  if (cartesian_correction_) {
+    for (std::size_t i = 0; i < cart_commands_.size(); ++i) {
+      command_interfaces.emplace_back(
+        hardware_interface::CARTESIAN_CORRECTION_PREFIX, kCartesianInterfaces[i],
+        &cart_commands_[i]);
+    }
+    return command_interfaces;
   }
+  joint_storage_.ExportCommandInterfaces(command_interfaces);
   return command_interfaces;
 }
 
 CallbackReturn KukaRSIHardwareInterface::on_activate(const rclcpp_lifecycle::State &)
 {
   stop_flag_ = false;
+  session_lost_ = false;
+  resume_hold_ = false;
+  command_filter_.Reset();
+  kuka_drivers_core::tracing::InstanceName(this, info_.name.c_str());
+  kuka_drivers_core::StartupProfile::Scope activate_phase(startup_profile_, "on_activate");
+  log_drain_.Start();
+  leave_shared_transport();
+  if (async_transport_) {
+    const CallbackReturn result = activate_async_transport();
+    if (result == CallbackReturn::SUCCESS) {
+      activate_phase.Finish();
+      log_startup_profile();
+    }
+    return result;
+  }
   // Wait for connection from robot
+  kuka_drivers_core::StartupProfile::Scope socket_phase(
+    startup_profile_, "on_activate/open_socket");
   server_.reset(new UDPServer(rsi_ip_address_, rsi_port_));
+  server_->set_capture(wire_capture_.get());
+  server_->set_fault_injector(fault_injector_.get());
   server_->set_timeout(10000);  // Set receive timeout to 10 seconds for activation
+  transport_options_.kernel_timestamps = latency_diagnostics_ != nullptr;
+  if (!server_->configure(transport_options_)) {
+    return CallbackReturn::FAILURE;
+  }
+  socket_phase.Finish();
 
 
   RCLCPP_INFO(rclcpp::get_logger("KukaRSIHardwareInterface"), "Connecting to robot . . .");
 
-  int bytes = server_->recv(in_buffer_);
-  if (bytes == 0) {
+  kuka_drivers_core::StartupProfile::Scope packet_phase(
+    startup_profile_, "on_activate/first_packet");
+  UDPServer::Packet packet;
+  int bytes = server_->recv(packet);
+  if (bytes <= 0) {
     RCLCPP_ERROR(rclcpp::get_logger("KukaRSIHardwareInterface"), "Connection timeout");
     return CallbackReturn::FAILURE;
   }
+  packet_phase.Finish();
 
   RCLCPP_INFO(rclcpp::get_logger("KukaRSIHardwareInterface"), "Got data from robot");
 
   // Drop empty <rob> frame with RSI <= 2.3
   if (bytes < 100) {
-    bytes = server_->recv(in_buffer_);
+    bytes = server_->recv(packet);
   }
 
-  rsi_state_ = RSIState(in_buffer_);
-
-  for (size_t i = 0; i < info_.joints.size(); ++i) {
-    hw_states_[i] = rsi_state_.positions[i] * KukaRSIHardwareInterface::D2R;
-    hw_commands_[i] = hw_states_[i];
-    initial_joint_pos_[i] = rsi_state_.initial_positions[i] * KukaRSIHardwareInterface::D2R;
+  if (!decode_state(packet)) {
+    RCLCPP_ERROR(rclcpp::get_logger("KukaRSIHardwareInterface"), "Malformed state message");
+    return CallbackReturn::FAILURE;
   }
-  ipoc_ = rsi_state_.ipoc;
 
-  out_buffer_ = RSICommand(joint_pos_correction_deg_, ipoc_, stop_flag_).xml_doc;
-  server_->send(out_buffer_);
+  initialize_from_state();
+
+  if (!encode_correction()) {
+    RCLCPP_ERROR(rclcpp::get_logger("KukaRSIHardwareInterface"), "Command encoding failed");
+    return CallbackReturn::FAILURE;
+  }
+  server_->send(rsi_command_.data(), rsi_command_.size());
   server_->set_timeout(1000);  // Set receive timeout to 1 second
+  if (shared_transport_ != nullptr) {
+    transport_id_ = shared_transport_->add(*server_);
+    if (transport_id_ < 0) {
+      return CallbackReturn::FAILURE;
+    }
+  }
+  if (reply_watchdog_ != nullptr) {
+    reply_watchdog_->disarm();
+    extrapolator_.reset(correction_data());
+    extrapolated_replies_ = 0;
+    extrapolated_cycles_ = 0;
+  }
 
   RCLCPP_INFO(rclcpp::get_logger("KukaRSIHardwareInterface"), "System Successfully started!");
   is_active_ = true;
+  activity_.Set();
+  activate_phase.Finish();
+  log_startup_profile();
 
   return CallbackReturn::SUCCESS;
 }
@@ -178,6 +396,19 @@ CallbackReturn KukaRSIHardwareInterface::on_deactivate(
 {
   stop_flag_ = true;
   RCLCPP_INFO(rclcpp::get_logger("KukaRSIHardwareInterface"), "Stop flag was set!");
+  kuka_drivers_core::CycleCoordinator::Instance().Leave(cycle_robot_);
+  cycle_robot_ = -1;
+  if (session_lost_) {
+    // There is no robot to send the stop flag to
+    is_active_ = false;
+    activity_.Clear();
+    session_lost_ = false;
+  }
+  if (fault_injector_ != nullptr) {
+    RCLCPP_INFO(
+      rclcpp::get_logger("KukaRSIHardwareInterface"), "Fault injection: %s",
+      fault_injector_->Summary().c_str());
+  }
   return CallbackReturn::SUCCESS;
 }
 
@@ -185,48 +416,626 @@ return_type KukaRSIHardwareInterface::read(
   const rclcpp::Time &,
   const rclcpp::Duration &)
 {
+  if (tuning_ != nullptr && tuning_->Update()) {
+    command_filter_.CopyConfiguration(tuning_->Current().command_filter.filter);
+  }
   if (!is_active_) {
     std::this_thread::sleep_for(std::chrono::milliseconds(2));
     return return_type::OK;
   }
 
-  if (server_->recv(in_buffer_) == 0) {
-    RCLCPP_ERROR(rclcpp::get_logger("KukaRSIHardwareInterface"), "No data received from robot");
-    this->on_deactivate(this->get_state());
-    return return_type::ERROR;
+  UDPServer::Packet packet;
+  // The first message of a resumed session starts the IPOC tracking
+  bool resumed = false;
+  if (async_transport_) {
+    // The message has already been answered by the I/O thread, which also tracks the IPOCs of
+    //  the messages answered while the controllers were busy
+    const std::chrono::milliseconds timeout(1000);
+    const bool received = io_thread_options_.enabled ?
+      async_server_->takeState(rsi_state_, &ipoc_tracker_.statistics()) :
+      async_server_->waitForState(rsi_state_, timeout, &ipoc_tracker_.statistics());
+    const auto now = std::chrono::steady_clock::now();
+    new_state_ = received;
+    kuka_drivers_core::CycleCoordinator::Instance().OnRead(cycle_robot_, received);
+    if (received) {
+      last_state_time_ = now;
+    } else if (io_thread_options_.enabled && now - last_state_time_ < timeout) {
+      // The controllers run at their own rate, the last state is kept until a new one arrives
+      return return_type::OK;
+    } else {
+      rt_log_.Log(kuka_drivers_core::RTLog::Level::ERROR, "No data received from robot");
+      commit_cycle_record(kuka_drivers_core::FlightRecorder::MISSED);
+      this->on_deactivate(this->get_state());
+      return return_type::ERROR;
+    }
+  } else {
+    const ssize_t bytes = shared_transport_ != nullptr ?
+      shared_transport_->receive(
+      transport_id_, packet, std::chrono::milliseconds(1000), sync_window_) :
+      server_->recv(packet);
+    if (bytes <= 0) {
+      if (session_lost_) {
+        // The robot has not started the next session yet
+        return return_type::OK;
+      }
+      rt_log_.Log(kuka_drivers_core::RTLog::Level::ERROR, "No data received from robot");
+      commit_cycle_record(kuka_drivers_core::FlightRecorder::MISSED);
+      if (session_resume_) {
+        suspend_session();
+        return return_type::OK;
+      }
+      leave_shared_transport();
+      this->on_deactivate(this->get_state());
+      return return_type::ERROR;
+    }
+    if (session_lost_) {
+      if (!resume_session(bytes, packet)) {
+        return return_type::OK;
+      }
+      resumed = true;
+    } else if (!decode_state(packet)) {
+      rt_log_.Log(kuka_drivers_core::RTLog::Level::ERROR, "Malformed state message");
+      commit_cycle_record(
+        kuka_drivers_core::FlightRecorder::RECEIVED | kuka_drivers_core::FlightRecorder::ERROR);
+      leave_shared_transport();
+      this->on_deactivate(this->get_state());
+      return return_type::ERROR;
+    }
+    // Fall back to the user space time if kernel timestamps are not available
+    receive_time_ = packet.kernel_timestamp.time_since_epoch().count() != 0 ?
+      packet.kernel_timestamp : std::chrono::system_clock::now();
+  }
+  if (flight_recorder_ != nullptr) {
+    auto & record = flight_recorder_->Current();
+    record.counter = rsi_state_.ipoc;
+    record.receive_time_ns = async_transport_ ? kuka_drivers_core::FlightRecorder::Now() :
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+      packet.timestamp.time_since_epoch()).count();
+    record.flags = kuka_drivers_core::FlightRecorder::RECEIVED;
+    record.mode = cartesian_correction_ ? 1 : 0;
+  }
+
+  if (!resumed && !async_transport_ &&
+    ipoc_tracker_.update(rsi_state_.ipoc, rsi_state_.delay) != IPOCTracker::Result::OK)
+  {
+    // Stale message, keep the state and the IPOC of the newest one
+    commit_cycle_record(STALE_MESSAGE);
+    return return_type::OK;
+  }
+  if (ipoc_tracker_.delayWarning()) {
+    rt_log_.Log(
+      kuka_drivers_core::RTLog::Level::WARN,
+      "Robot reported %lu late packets, the late packet limit might be reached soon",
+      rsi_state_.delay);
+  }
+  // The I/O thread of the async transport takes the arrival time after parsing the message
+  const auto arrival = async_transport_ ? async_server_->lastArrival() : packet.timestamp;
+  clock_sync_.Update(static_cast<int64_t>(rsi_state_.ipoc), arrival);
+  state_stamp_ = clock_sync_.Stamp();
+  one_way_latency_ = clock_sync_.Latency();
+  clock_drift_ = clock_sync_.Drift();
+  if (cycle_robot_ >= 0 && clock_sync_.Valid()) {
+    kuka_drivers_core::CycleCoordinator::Instance().OnMessage(
+      cycle_robot_, clock_sync_.SendTime(), arrival);
+  }
+  if (link_diagnostics_ != nullptr) {
+    const auto & statistics = ipoc_tracker_.statistics();
+    const double link_metrics[] = {statistics.missed_cycles, statistics.late_packets};
+    link_diagnostics_->Update(link_metrics);
+  }
+  if (metrics_group_ != nullptr) {
+    const auto & statistics = ipoc_tracker_.statistics();
+    metrics_.missed_ipocs->Set(static_cast<uint64_t>(statistics.missed_cycles));
+    metrics_.late_packets->Set(static_cast<uint64_t>(statistics.late_packets));
+    if (clock_sync_.Valid() && one_way_latency_ > 0) {
+      metrics_.one_way_latency->Record(static_cast<uint64_t>(one_way_latency_ * 1e9));
+    }
   }
-  rsi_state_ = RSIState(in_buffer_);
 
   for (std::size_t i = 0; i < info_.joints.size(); ++i) {
     hw_states_[i] = rsi_state_.positions[i] * KukaRSIHardwareInterface::D2R;
   }
+  update_cartesian_states();
+  if (!gpio_readers_.empty()) {
+    kuka_drivers_core::tracing::ScopedPhase trace(kuka_drivers_core::tracing::Phase::GPIO, this);
+    for (auto & reader : gpio_readers_) {
+      reader.getValue();
+    }
+  }
+  if (rsi_state_.ipoc > ipoc_) {
+    robot_cycle_time_ = static_cast<double>(rsi_state_.ipoc - ipoc_) * 1e-3;
+  }
   ipoc_ = rsi_state_.ipoc;
+  if (flight_recorder_ != nullptr) {
+    flight_recorder_->SetStates(hw_states_.data(), hw_states_.size());
+  }
+  if (state_channel_ != nullptr) {
+    auto & sample = state_channel_->Current();
+    sample.counter = rsi_state_.ipoc;
+    sample.receive_time_ns = async_transport_ ? kuka_drivers_core::StateChannel::Now() :
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+      packet.timestamp.time_since_epoch()).count();
+    sample.mode = cartesian_correction_ ? 1 : 0;
+    state_channel_->SetPositions(hw_states_.data(), hw_states_.size());
+    state_channel_->Publish();
+  }
+  if (joint_state_publisher_ != nullptr) {
+    joint_state_publisher_->Update(hw_states_.data(), nullptr, nullptr);
+  }
+  if (state_batch_publisher_ != nullptr) {
+    state_batch_publisher_->Update(rsi_state_.ipoc, 0, hw_states_.data(), nullptr, nullptr);
+  }
+  if (reply_watchdog_ != nullptr) {
+    extrapolated_cycles_ = static_cast<double>(extrapolated_replies_.load());
+    reply_watchdog_->arm(packet.timestamp + reply_deadline_);
+  }
   return return_type::OK;
 }
 
 return_type KukaRSIHardwareInterface::write(
   const rclcpp::Time &,
-  const rclcpp::Duration &)
+  const rclcpp::Duration & period)
 {
   // It is possible, that write is called immediately after activation
   // In this case write in that tick should be skipped to be able to read state at first
   // First cycle (with 0 ipoc) is handled in the on_activate method, so 0 ipoc means
   //  read was not called yet
-  if (!is_active_ || ipoc_ == 0) {
+  if (!is_active_ || ipoc_ == 0 || session_lost_ || !new_state_) {
     return return_type::OK;
   }
 
-  if (stop_flag_) {is_active_ = false;}
+  // The watchdog has already answered this state message with an extrapolated command
+  if (reply_watchdog_ != nullptr && !reply_watchdog_->disarm()) {
+    commit_cycle_record(EXTRAPOLATED_REPLY);
+    return return_type::OK;
+  }
 
-  for (size_t i = 0; i < info_.joints.size(); i++) {
-    joint_pos_correction_deg_[i] = (hw_commands_[i] - initial_joint_pos_[i]) *
-      KukaRSIHardwareInterface::R2D;
+  // The stop flag is sent with this reply, the loop is not needed until the next activation
+  if (stop_flag_) {
+    is_active_ = false;
+    activity_.Clear();
+  }
+
+  if (cartesian_correction_) {
+    for (std::size_t i = 0; i < cart_commands_.size(); ++i) {
+      cart_correction_[i] = cart_commands_[i] *
+        (i < 3 ? KukaRSIHardwareInterface::M2MM : KukaRSIHardwareInterface::R2D);
+    }
+  } else {
+    // The commands of the controllers are kept, the interpolator and the filters work on a copy
+    const double * controller_commands = hw_commands_.data();
+    if (resume_hold_) {
+      // After a resume the controllers might still command the positions of the lost session
+      if (commands_near_states()) {
+        resume_hold_ = false;
+        rt_log_.Log(
+          kuka_drivers_core::RTLog::Level::INFO,
+          "Commands of the controllers reached the robot position, control resumed");
+      } else {
+        controller_commands = hw_states_.data();
+      }
+    }
+    const double * joint_commands = controller_commands;
+    // The I/O thread of the async transport interpolates between the snapshots of write() itself
+    if (command_interpolator_.Enabled() && !async_transport_) {
+      // The controllers are sampled in every command_update_cycles_-th cycle
+      if (command_update_counter_++ % command_update_cycles_ == 0) {
+        command_interpolator_.SetTarget(
+          controller_commands, static_cast<double>(command_update_cycles_) * robot_cycle_time_);
+      }
+      joint_commands = command_interpolator_.Next(robot_cycle_time_);
+    }
+    if (command_filter_.Enabled()) {
+      std::copy_n(joint_commands, filtered_commands_.size(), filtered_commands_.begin());
+      if (!command_filter_.Apply(
+          filtered_commands_.data(), filtered_commands_.size(), period.seconds()))
+      {
+        rt_log_.Log(kuka_drivers_core::RTLog::Level::ERROR, "Command filtering failed");
+        commit_cycle_record(kuka_drivers_core::FlightRecorder::ERROR);
+        return return_type::ERROR;
+      }
+      joint_commands = filtered_commands_.data();
+    }
+    for (size_t i = 0; i < info_.joints.size(); i++) {
+      joint_pos_correction_deg_[i] = (joint_commands[i] - initial_joint_pos_[i]) *
+        KukaRSIHardwareInterface::R2D;
+    }
+  }
+
+  if (!gpio_writers_.empty()) {
+    kuka_drivers_core::tracing::ScopedPhase trace(kuka_drivers_core::tracing::Phase::GPIO, this);
+    for (auto & writer : gpio_writers_) {
+      writer.setValue();
+    }
+  }
+  // Published with the state of the next cycle
+  if (state_channel_ != nullptr) {
+    if (cartesian_correction_) {
+      state_channel_->SetCommands(cart_commands_.data(), cart_commands_.size());
+    } else {
+      state_channel_->SetCommands(hw_commands_.data(), hw_commands_.size());
+    }
+  }
+  if (state_batch_publisher_ != nullptr) {
+    if (cartesian_correction_) {
+      state_batch_publisher_->SetCommands(cart_commands_.data(), cart_commands_.size());
+    } else {
+      state_batch_publisher_->SetCommands(hw_commands_.data(), hw_commands_.size());
+    }
+  }
+
+  if (async_transport_) {
+    // Sent by the I/O thread as the answer to the next state message
+    if (cartesian_correction_) {
+      async_server_->setCartesianCorrection(cart_correction_, stop_flag_);
+    } else {
+      async_server_->setJointCorrection(joint_pos_correction_deg_, stop_flag_);
+    }
+    if (flight_recorder_ != nullptr) {
+      flight_recorder_->SetCommands(
+        correction_data(), cartesian_correction_ ? cart_correction_.size() : info_.joints.size());
+    }
+    commit_cycle_record(0);
+    return return_type::OK;
   }
 
-  out_buffer_ = RSICommand(joint_pos_correction_deg_, ipoc_, stop_flag_).xml_doc;
-  server_->send(out_buffer_);
+  if (!encode_correction()) {
+    rt_log_.Log(kuka_drivers_core::RTLog::Level::ERROR, "Command encoding failed");
+    commit_cycle_record(kuka_drivers_core::FlightRecorder::ERROR);
+    return return_type::ERROR;
+  }
+  server_->send(rsi_command_.data(), rsi_command_.size());
+  if (flight_recorder_ != nullptr) {
+    flight_recorder_->Current().send_time_ns = kuka_drivers_core::FlightRecorder::Now();
+    flight_recorder_->SetCommands(
+      correction_data(), cartesian_correction_ ? cart_correction_.size() : info_.joints.size());
+  }
+  commit_cycle_record(kuka_drivers_core::FlightRecorder::SENT);
+  if (!is_active_) {
+    // The robot stops sending after the stop flag, the others should not wait for it
+    leave_shared_transport();
+  }
+  if (latency_diagnostics_ != nullptr) {
+    latency_diagnostics_->record(std::chrono::system_clock::now() - receive_time_);
+  }
+  if (metrics_.reply_latency != nullptr) {
+    metrics_.reply_latency->Record(
+      static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now() - receive_time_).count()));
+  }
+  if (reply_watchdog_ != nullptr) {
+    extrapolator_.push(correction_data());
+  }
   return return_type::OK;
 }
+
+void KukaRSIHardwareInterface::initialize_from_state()
+{
+  for (size_t i = 0; i < info_.joints.size(); ++i) {
+    hw_states_[i] = rsi_state_.positions[i] * KukaRSIHardwareInterface::D2R;
+    hw_commands_[i] = hw_states_[i];
+    initial_joint_pos_[i] = rsi_state_.initial_positions[i] * KukaRSIHardwareInterface::D2R;
+  }
+  update_cartesian_states();
+  cart_commands_.fill(0.0);
+  cart_correction_.fill(0.0);
+  ipoc_ = rsi_state_.ipoc;
+  ipoc_tracker_.reset(ipoc_);
+  command_interpolator_.Reset(hw_commands_.data());
+  command_update_counter_ = 0;
+}
+
+void KukaRSIHardwareInterface::suspend_session()
+{
+  // The socket stays bound, read() polls it for the next session without blocking the loop
+  session_lost_ = true;
+  server_->set_timeout(RESUME_POLL_TIMEOUT_MS);
+  rt_log_.Log(
+    kuka_drivers_core::RTLog::Level::WARN, "RSI session lost, waiting for the next session");
+}
+
+bool KukaRSIHardwareInterface::resume_session(ssize_t bytes, const UDPServer::Packet & packet)
+{
+  // Drop empty <rob> frame with RSI <= 2.3, the next message starts the session
+  if (bytes < 100) {
+    return false;
+  }
+  if (!decode_state(packet)) {
+    rt_log_.Log(kuka_drivers_core::RTLog::Level::ERROR, "Malformed state message");
+    return false;
+  }
+
+  // A restarted RSI context starts from a smaller IPOC, the corrections are relative to its
+  //  new initial position
+  const bool new_session = rsi_state_.ipoc <= ipoc_;
+  initialize_from_state();
+  for (std::size_t i = 0; i < info_.joints.size(); ++i) {
+    joint_pos_correction_deg_[i] = (hw_states_[i] - initial_joint_pos_[i]) *
+      KukaRSIHardwareInterface::R2D;
+  }
+  command_filter_.Reset();
+  if (reply_watchdog_ != nullptr) {
+    extrapolator_.reset(correction_data());
+  }
+  server_->set_timeout(1000);
+  session_lost_ = false;
+  resume_hold_ = true;
+  rt_log_.Log(
+    kuka_drivers_core::RTLog::Level::INFO, "%s, holding the position until the commands of the "
+    "controllers are within %f rad", new_session ? "New RSI session started" :
+    "RSI session continued", resume_tolerance_);
+  return true;
+}
+
+bool KukaRSIHardwareInterface::commands_near_states() const
+{
+  for (std::size_t i = 0; i < info_.joints.size(); ++i) {
+    if (std::abs(hw_commands_[i] - hw_states_[i]) > resume_tolerance_) {
+      return false;
+    }
+  }
+  return true;
+}
+
+CallbackReturn KukaRSIHardwareInterface::activate_async_transport()
+{
+  // The new server starts with zero correction, which holds the current position
+  kuka_drivers_core::StartupProfile::Scope socket_phase(
+    startup_profile_, "on_activate/open_socket");
+  async_server_.reset();
+  async_server_ = std::make_unique<kuka::rsi::RSIUDPServer>(
+    rsi_ip_address_, rsi_port_, info_.joints.size(), parse_state_,
+    cartesian_correction_ ? nullptr : encode_command_, command_precision_, wire_capture_.get(),
+    command_interpolator_.GetMode(),
+    command_interpolator_.MaxRate() * KukaRSIHardwareInterface::R2D, io_thread_options_);
+  if (!async_server_->isInitialized()) {
+    RCLCPP_ERROR(rclcpp::get_logger("KukaRSIHardwareInterface"), "Opening socket failed");
+    return CallbackReturn::FAILURE;
+  }
+  socket_phase.Finish();
+
+  RCLCPP_INFO(rclcpp::get_logger("KukaRSIHardwareInterface"), "Connecting to robot . . .");
+  kuka_drivers_core::StartupProfile::Scope packet_phase(
+    startup_profile_, "on_activate/first_packet");
+  if (!async_server_->waitForState(rsi_state_, std::chrono::milliseconds(10000))) {
+    RCLCPP_ERROR(rclcpp::get_logger("KukaRSIHardwareInterface"), "Connection timeout");
+    return CallbackReturn::FAILURE;
+  }
+  packet_phase.Finish();
+  last_state_time_ = std::chrono::steady_clock::now();
+  new_state_ = true;
+  initialize_from_state();
+
+  if (cycle_coordination_options_.enabled) {
+    cycle_robot_ = kuka_drivers_core::CycleCoordinator::Instance().Join(
+      info_.name, cycle_coordination_options_.master);
+    if (cycle_robot_ < 0) {
+      RCLCPP_WARN(
+        rclcpp::get_logger("KukaRSIHardwareInterface"),
+        "Too many robots for the cycle coordinator, the cycles are not aligned to this one");
+    }
+  }
+
+  RCLCPP_INFO(rclcpp::get_logger("KukaRSIHardwareInterface"), "System Successfully started!");
+  is_active_ = true;
+  activity_.Set();
+  return CallbackReturn::SUCCESS;
+}
+
+void KukaRSIHardwareInterface::log_startup_profile()
+{
+  startup_profile_.Log(rclcpp::get_logger("KukaRSIHardwareInterface"));
+  startup_profile_.Reset();
+}
+
+bool KukaRSIHardwareInterface::encode_correction()
+{
+  kuka_drivers_core::tracing::ScopedPhase trace(kuka_drivers_core::tracing::Phase::ENCODE, this);
+  if (cartesian_correction_) {
+    return rsi_command_.encodeCartesian(cart_correction_, ipoc_, stop_flag_);
+  }
+  return (rsi_command_.*encode_command_)(joint_pos_correction_deg_, ipoc_, stop_flag_);
+}
+
+bool KukaRSIHardwareInterface::decode_state(const UDPServer::Packet & packet)
+{
+  kuka_drivers_core::tracing::ScopedPhase trace(kuka_drivers_core::tracing::Phase::DECODE, this);
+  const bool decoded = (rsi_state_.*parse_state_)(packet.data.data(), packet.data.size());
+  if (!decoded && metrics_.decode_failures != nullptr) {
+    metrics_.decode_failures->Add();
+  }
+  return decoded;
+}
+
+double * KukaRSIHardwareInterface::correction_data()
+{
+  return cartesian_correction_ ? cart_correction_.data() : joint_pos_correction_deg_.data();
+}
+
+void KukaRSIHardwareInterface::send_extrapolated_reply()
+{
+  // The extrapolated command is part of the history, so that consecutive misses
+  //  continue the trajectory
+  extrapolator_.predict(correction_data());
+  extrapolator_.push(correction_data());
+  if (encode_correction()) {
+    server_->send(rsi_command_.data(), rsi_command_.size());
+  }
+  extrapolated_replies_++;
+}
+
+bool KukaRSIHardwareInterface::check_joint_interfaces()
+{
+  for (const hardware_interface::ComponentInfo & joint : info_.joints) {
+    if (cartesian_correction_) {
+      if (!joint.command_interfaces.empty()) {
+        RCLCPP_FATAL(
+          rclcpp::get_logger(
+            "KukaRSIHardwareInterface"),
+          "expecting no joint command interfaces in Cartesian correction mode");
+        return false;
+      }
+    } else if (joint.command_interfaces.size() != 1) {
+      RCLCPP_FATAL(
+        rclcpp::get_logger(
+          "KukaRSIHardwareInterface"), "expecting exactly 1 command interface");
+      return false;
+    }
+
+    if (!cartesian_correction_ &&
+      joint.command_interfaces[0].name != hardware_interface::HW_IF_POSITION)
+    {
+      RCLCPP_FATAL(
+        rclcpp::get_logger(
+          "KukaRSIHardwareInterface"), "expecting only POSITION command interface");
+      return false;
+    }
+
+    if (joint.state_interfaces.size() != 1) {
+      RCLCPP_FATAL(
+        rclcpp::get_logger(
+          "KukaRSIHardwareInterface"), "expecting exactly 1 state interface");
+      return false;
+    }
+
+    if (joint.state_interfaces[0].name != hardware_interface::HW_IF_POSITION) {
+      RCLCPP_FATAL(
+        rclcpp::get_logger(
+          "KukaRSIHardwareInterface"), "expecting only POSITION state interface");
+      return false;
+    }
+  }
+  return true;
+}
+
+bool KukaRSIHardwareInterface::configure_schema(std::size_t external_axes)
+{
+  auto schema_param = info_.hardware_parameters.find("rsi_ethernet_config");
+  if (schema_param == info_.hardware_parameters.end() || schema_param->second.empty()) {
+    return true;
+  }
+  rsi_schema_ = std::make_unique<RSISchema>();
+  std::string error;
+  if (!rsi_schema_->load(schema_param->second, error) ||
+    !rsi_schema_->configure(
+      external_axes, cartesian_correction_, rsi_state_, rsi_command_, error))
+  {
+    RCLCPP_FATAL(rclcpp::get_logger("KukaRSIHardwareInterface"), "%s", error.c_str());
+    return false;
+  }
+  RCLCPP_INFO(
+    rclcpp::get_logger("KukaRSIHardwareInterface"),
+    "RSI messages of %s: %zu elements sent, %zu received by the robot",
+    schema_param->second.c_str(), rsi_schema_->sendElements().size(),
+    rsi_schema_->receiveElements().size());
+  return true;
+}
+
+void KukaRSIHardwareInterface::register_metrics()
+{
+  if (metrics_group_ == nullptr) {
+    return;
+  }
+  metrics_.missed_ipocs = &metrics_group_->AddCounter(
+    "missed_ipocs_total", "IPOCs of the robot without a state message");
+  metrics_.late_packets = &metrics_group_->AddCounter(
+    "late_packets_total", "Late replies reported by the robot controller");
+  metrics_.decode_failures = &metrics_group_->AddCounter(
+    "decode_failures_total", "State messages of the robot that could not be parsed");
+  metrics_.one_way_latency = &metrics_group_->AddHistogram(
+    "one_way_latency_seconds", "Delay of the state messages from the controller to the host");
+  metrics_.reply_latency = &metrics_group_->AddHistogram(
+    "reply_latency_seconds", "Time from the arrival of a state message until its reply is sent");
+}
+
+bool KukaRSIHardwareInterface::configure_gpios()
+{
+  // The elements are configured first, the value slots are stable only afterwards
+  for (const auto & gpio : info_.gpios) {
+    for (const auto & state_if : gpio.state_interfaces) {
+      if (rsi_schema_ != nullptr && !rsi_schema_->sends(state_if.name)) {
+        RCLCPP_FATAL(
+          rclcpp::get_logger("KukaRSIHardwareInterface"),
+          "GPIO state interface '%s' is not sent by the RSI configuration",
+          state_if.name.c_str());
+        return false;
+      }
+      if (addIOValue(rsi_state_.io_elements, state_if.name) == nullptr) {
+        RCLCPP_FATAL(
+          rclcpp::get_logger("KukaRSIHardwareInterface"),
+          "Invalid GPIO state interface '%s', expecting an RSI tag like 'Digin.i1' or 'DiL'",
+          state_if.name.c_str());
+        return false;
+      }
+    }
+    for (const auto & command_if : gpio.command_interfaces) {
+      if (rsi_schema_ != nullptr && !rsi_schema_->receives(command_if.name)) {
+        RCLCPP_FATAL(
+          rclcpp::get_logger("KukaRSIHardwareInterface"),
+          "GPIO command interface '%s' is not received by the RSI configuration",
+          command_if.name.c_str());
+        return false;
+      }
+      if (addIOValue(rsi_command_.io_elements, command_if.name) == nullptr) {
+        RCLCPP_FATAL(
+          rclcpp::get_logger("KukaRSIHardwareInterface"),
+          "Invalid GPIO command interface '%s', expecting an RSI tag like 'Digout.o1' or 'DoL'",
+          command_if.name.c_str());
+        return false;
+      }
+    }
+  }
+
+  for (const auto & gpio : info_.gpios) {
+    for (const auto & state_if : gpio.state_interfaces) {
+      gpio_readers_.emplace_back(
+        gpio.name, state_if.name, *addIOValue(rsi_state_.io_elements, state_if.name));
+    }
+    for (const auto & command_if : gpio.command_interfaces) {
+      double initial_value = 0.0;
+      if (!command_if.initial_value.empty() &&
+        !kuka_drivers_core::HardwareParameters::Convert(command_if.initial_value, initial_value))
+      {
+        RCLCPP_FATAL(
+          rclcpp::get_logger("KukaRSIHardwareInterface"),
+          "Initial value of GPIO command interface '%s' must be a number", command_if.name.c_str());
+        return false;
+      }
+      gpio_writers_.emplace_back(
+        gpio.name, command_if.name, *addIOValue(rsi_command_.io_elements, command_if.name),
+        initial_value);
+    }
+  }
+  return true;
+}
+
+void KukaRSIHardwareInterface::leave_shared_transport()
+{
+  if (shared_transport_ != nullptr && transport_id_ >= 0) {
+    shared_transport_->remove(transport_id_);
+    transport_id_ = -1;
+  }
+}
+
+void KukaRSIHardwareInterface::commit_cycle_record(uint32_t flags)
+{
+  if (flight_recorder_ == nullptr) {
+    return;
+  }
+  flight_recorder_->Current().flags |= flags;
+  flight_recorder_->Commit();
+}
+
+void KukaRSIHardwareInterface::update_cartesian_states()
+{
+  if (!cartesian_correction_) {
+    return;
+  }
+  for (std::size_t i = 0; i < cart_states_.size(); ++i) {
+    cart_states_[i] = rsi_state_.cart_position[i] *
+      (i < 3 ? KukaRSIHardwareInterface::MM2M : KukaRSIHardwareInterface::D2R);
+  }
+}
 }  // namespace namespace kuka_kss_rsi_driver
 
 PLUGINLIB_EXPORT_CLASS(
@@ -0,0 +1,121 @@
+// Copyright 2023 Svastits Áron
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "kuka_drivers_core/hardware_parameters.hpp"
+#include "kuka_kss_rsi_driver/latency_diagnostics.hpp"
+
+namespace kuka_kss_rsi_driver
+{
+LatencyDiagnostics::LatencyDiagnostics(
+  const std::string & hardware_name, std::chrono::microseconds warning_threshold,
+  std::chrono::milliseconds publish_period)
+: hardware_name_(hardware_name), warning_threshold_(warning_threshold),
+  publish_period_(publish_period)
+{
+  node_ = rclcpp::Node::make_shared(hardware_name_ + "_latency_diagnostics");
+  publisher_ = node_->create_publisher<diagnostic_msgs::msg::DiagnosticArray>(
+    "/diagnostics", rclcpp::SystemDefaultsQoS());
+  publish_thread_ = std::thread(&LatencyDiagnostics::publishLoop, this);
+}
+
+LatencyDiagnostics::~LatencyDiagnostics()
+{
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    terminate_ = true;
+  }
+  cv_.notify_all();
+  if (publish_thread_.joinable()) {
+    publish_thread_.join();
+  }
+}
+
+void LatencyDiagnostics::publishLoop()
+{
+  auto to_us = [](uint64_t ns) {return std::to_string(ns / 1000);};
+  auto previous = histogram_.GetSnapshot();
+
+  std::unique_lock<std::mutex> lk(mutex_);
+  while (!cv_.wait_for(lk, publish_period_, [this] {return terminate_;})) {
+    auto current = histogram_.GetSnapshot();
+    auto window = current - previous;
+    previous = current;
+
+    diagnostic_msgs::msg::DiagnosticStatus status;
+    status.name = hardware_name_ + ": RSI reply latency";
+    status.hardware_id = hardware_name_;
+
+    const uint64_t p99 = window.Percentile(99);
+    if (window.count == 0) {
+      status.level = diagnostic_msgs::msg::DiagnosticStatus::STALE;
+      status.message = "No messages in the last period";
+    } else if (p99 > static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(warning_threshold_).count()))
+    {
+      status.level = diagnostic_msgs::msg::DiagnosticStatus::WARN;
+      status.message = "99th percentile of reply latency above threshold";
+    } else {
+      status.level = diagnostic_msgs::msg::DiagnosticStatus::OK;
+      status.message = "OK";
+    }
+
+    const std::vector<std::pair<std::string, std::string>> values = {
+      {"samples", std::to_string(window.count)},
+      {"p50 [us]", to_us(window.Percentile(50))},
+      {"p90 [us]", to_us(window.Percentile(90))},
+      {"p99 [us]", to_us(p99)},
+      {"p99.9 [us]", to_us(window.Percentile(99.9))},
+      {"max [us]", to_us(window.interval_max_ns)},
+      {"max since start [us]", to_us(window.max_ns)},
+    };
+    for (const auto & value : values) {
+      diagnostic_msgs::msg::KeyValue key_value;
+      key_value.key = value.first;
+      key_value.value = value.second;
+      status.values.push_back(key_value);
+    }
+
+    diagnostic_msgs::msg::DiagnosticArray msg;
+    msg.header.stamp = node_->now();
+    msg.status.push_back(status);
+    publisher_->publish(msg);
+  }
+}
+
+bool ConfigureLatencyDiagnostics(
+  const std::unordered_map<std::string, std::string> & parameters,
+  const std::string & hardware_name, std::unique_ptr<LatencyDiagnostics> & diagnostics,
+  std::string & error)
+{
+  kuka_drivers_core::HardwareParameters checked(parameters);
+  bool enabled = false;
+  std::chrono::microseconds threshold(2000);
+  checked.GetFlag("latency_diagnostics", enabled);
+  checked.Get("latency_warning_threshold_us", threshold);
+  if (!checked.Ok()) {
+    error = checked.Error();
+    return false;
+  }
+  if (enabled) {
+    diagnostics = std::make_unique<LatencyDiagnostics>(hardware_name, threshold);
+  }
+  return true;
+}
+}  // namespace kuka_kss_rsi_driver
@@ -0,0 +1,71 @@
+// Copyright 2023 Svastits Áron
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <utility>
+
+#include "kuka_kss_rsi_driver/reply_watchdog.hpp"
+
+namespace kuka_kss_rsi_driver
+{
+ReplyWatchdog::ReplyWatchdog(std::function<void()> on_deadline)
+: on_deadline_(std::move(on_deadline))
+{
+  thread_ = std::thread(&ReplyWatchdog::run, this);
+}
+
+ReplyWatchdog::~ReplyWatchdog()
+{
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    terminate_ = true;
+  }
+  cv_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void ReplyWatchdog::arm(std::chrono::steady_clock::time_point deadline)
+{
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    state_ = State::ARMED;
+    deadline_ = deadline;
+  }
+  cv_.notify_one();
+}
+
+bool ReplyWatchdog::disarm()
+{
+  std::lock_guard<std::mutex> lk(mutex_);
+  const bool pending = state_ != State::FIRED;
+  state_ = State::IDLE;
+  return pending;
+}
+
+void ReplyWatchdog::run()
+{
+  std::unique_lock<std::mutex> lk(mutex_);
+  while (!terminate_) {
+    if (state_ != State::ARMED) {
+      cv_.wait(lk);
+    } else if (std::chrono::steady_clock::now() >= deadline_) {
+      state_ = State::FIRED;
+      on_deadline_();
+    } else {
+      cv_.wait_until(lk, deadline_);
+    }
+  }
+}
+}  // namespace kuka_kss_rsi_driver
@@ -0,0 +1,32 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdio>
+#include <memory>
+
+#include "rclcpp/rclcpp.hpp"
+
+#include "kuka_drivers_core/node_executor.hpp"
+#include "kuka_kss_rsi_driver/robot_manager_node.hpp"
+
+int main(int argc, char * argv[])
+{
+  setvbuf(stdout, nullptr, _IONBF, BUFSIZ);
+
+  rclcpp::init(argc, argv);
+  auto node = std::make_shared<kuka_rsi::RobotManagerNode>();
+  kuka_drivers_core::NodeExecutor(node).Spin();
+  rclcpp::shutdown();
+  return 0;
+}
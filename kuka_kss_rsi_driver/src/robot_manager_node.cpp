@@ -22,12 +22,13 @@ using namespace lifecycle_msgs::msg;  // NOLINT
 
 namespace kuka_rsi
 {
-RobotManagerNode::RobotManagerNode()
-: kuka_drivers_core::ROS2BaseLCNode("robot_manager")
+RobotManagerNode::RobotManagerNode(const rclcpp::NodeOptions & options)
+: kuka_drivers_core::ROS2BaseLCNode("robot_manager", options)
 {
   auto qos = rclcpp::QoS(rclcpp::KeepLast(10));
   qos.reliable();
-  cbg_ = this->create_callback_group(rclcpp::CallbackGroupType::MutuallyExclusive);
+  // The responses awaited in the transitions and control mode changes
+  cbg_ = this->createDedicatedCallbackGroup();
   change_hardware_state_client_ =
     this->create_client<SetHardwareComponentState>(
     "controller_manager/set_hardware_component_state", qos.get_rmw_qos_profile(), cbg_
@@ -44,6 +45,11 @@ RobotManagerNode::RobotManagerNode()
     "robot_manager/is_configured",
     is_configured_qos);
 
+  // The profile of the last bring-up is kept for late subscribers
+  startup_profile_.SetComponent(get_fully_qualified_name());
+  startup_profile_pub_ = rclcpp::create_publisher<diagnostic_msgs::msg::DiagnosticStatus>(
+    *this, "~/startup_profile", rclcpp::QoS(rclcpp::KeepLast(1)).reliable().transient_local());
+
   this->registerStaticParameter<std::string>(
     "robot_model", "kr6_r700_sixx",
     kuka_drivers_core::ParameterSetAccessRights{true, false,
@@ -54,8 +60,27 @@ RobotManagerNode::RobotManagerNode()
 
 rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn
 RobotManagerNode::on_configure(const rclcpp_lifecycle::State &)
+{
+  kuka_drivers_core::tracing::ScopedTransition trace(get_name(), "configure");
+  // A bring-up starts with the configuration, its profile is published if it ends here
+  startup_profile_.Reset();
+  CallbackReturn result;
+  {
+    kuka_drivers_core::StartupProfile::Scope phase(startup_profile_, "on_configure");
+    result = configure();
+  }
+  if (result != SUCCESS) {
+    publishStartupProfile(false);
+  }
+  return result;
+}
+
+rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn
+RobotManagerNode::configure()
 {
   // Configure hardware interface
+  kuka_drivers_core::StartupProfile::Scope hardware_phase(
+    startup_profile_, "on_configure/configure_hardware");
   if (!kuka_drivers_core::changeHardwareState(
       change_hardware_state_client_, robot_model_,
       State::PRIMARY_STATE_INACTIVE))
@@ -63,6 +88,7 @@ RobotManagerNode::on_configure(const rclcpp_lifecycle::State &)
     RCLCPP_ERROR(get_logger(), "Could not configure hardware interface");
     return FAILURE;
   }
+  hardware_phase.Finish();
 
   is_configured_pub_->on_activate();
   is_configured_msg_.data = true;
@@ -73,6 +99,7 @@ RobotManagerNode::on_configure(const rclcpp_lifecycle::State &)
 rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn
 RobotManagerNode::on_cleanup(const rclcpp_lifecycle::State &)
 {
+  kuka_drivers_core::tracing::ScopedTransition trace(get_name(), "cleanup");
   // Clean up hardware interface
   if (!kuka_drivers_core::changeHardwareState(
       change_hardware_state_client_, robot_model_,
@@ -91,11 +118,28 @@ RobotManagerNode::on_cleanup(const rclcpp_lifecycle::State &)
   return SUCCESS;
 }
 
-// TODO(Svastits): rollback in case of failures
 rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn
 RobotManagerNode::on_activate(const rclcpp_lifecycle::State &)
 {
-  // Activate hardware interface
+  kuka_drivers_core::tracing::ScopedTransition trace(get_name(), "activate");
+  CallbackReturn result;
+  {
+    kuka_drivers_core::StartupProfile::Scope phase(startup_profile_, "on_activate");
+    result = activate();
+  }
+  // A reactivation after on_deactivate() is profiled on its own
+  publishStartupProfile(result == SUCCESS);
+  startup_profile_.Reset();
+  return result;
+}
+
+// TODO(Svastits): rollback in case of failures
+rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn
+RobotManagerNode::activate()
+{
+  // Activate hardware interface, which waits for the first message of the robot
+  kuka_drivers_core::StartupProfile::Scope hardware_phase(
+    startup_profile_, "on_activate/activate_hardware");
   if (!kuka_drivers_core::changeHardwareState(
       change_hardware_state_client_, robot_model_,
       State::PRIMARY_STATE_ACTIVE, 10000))
@@ -103,8 +147,11 @@ RobotManagerNode::on_activate(const rclcpp_lifecycle::State &)
     RCLCPP_ERROR(get_logger(), "Could not activate hardware interface");
     return FAILURE;
   }
+  hardware_phase.Finish();
 
   // Activate RT controller(s)
+  kuka_drivers_core::StartupProfile::Scope controller_phase(
+    startup_profile_, "on_activate/activate_controllers");
   if (!kuka_drivers_core::changeControllerState(
       change_controller_state_client_, {"joint_state_broadcaster", "joint_trajectory_controller"},
       {}))
@@ -115,30 +162,33 @@ RobotManagerNode::on_activate(const rclcpp_lifecycle::State &)
     return FAILURE;
   }
 
+  controller_phase.Finish();
+
   RCLCPP_INFO(get_logger(), "Successfully activated controllers");
   return SUCCESS;
 }
 
+void RobotManagerNode::publishStartupProfile(bool successful)
+{
+  startup_profile_.Log(get_logger());
+  startup_profile_pub_->publish(startup_profile_.ToStatus(successful));
+}
+
 rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn
 RobotManagerNode::on_deactivate(const rclcpp_lifecycle::State &)
 {
-  // Deactivate hardware interface
-  if (!kuka_drivers_core::changeHardwareState(
-      change_hardware_state_client_, robot_model_,
-      State::PRIMARY_STATE_INACTIVE))
-  {
-    RCLCPP_ERROR(get_logger(), "Could not deactivate hardware interface");
-    return ERROR;
-  }
-
-  // Stop RT controllers
+  kuka_drivers_core::tracing::ScopedTransition trace(get_name(), "deactivate");
+  // Deactivate hardware interface and stop RT controllers in one round trip
   // With best effort strictness, deactivation succeeds if specific controller is not active
-  if (!kuka_drivers_core::changeControllerState(
-      change_controller_state_client_, {},
-      {"joint_state_broadcaster", "joint_trajectory_controller"},
-      SwitchController::Request::BEST_EFFORT))
-  {
-    RCLCPP_ERROR(get_logger(), "Could not stop controllers");
+  kuka_drivers_core::ControlTransition transition(get_logger());
+  transition.phase("deactivation")
+  .changeHardwareState(change_hardware_state_client_, robot_model_, State::PRIMARY_STATE_INACTIVE)
+  .changeControllerState(
+    change_controller_state_client_, {},
+    {"joint_state_broadcaster", "joint_trajectory_controller"},
+    SwitchController::Request::BEST_EFFORT);
+  if (!transition.execute()) {
+    RCLCPP_ERROR(get_logger(), "Could not deactivate hardware interface and stop controllers");
     return ERROR;
   }
 
@@ -153,15 +203,7 @@ bool RobotManagerNode::onRobotModelChangeRequest(const std::string & robot_model
 }
 }  // namespace kuka_rsi
 
-int main(int argc, char * argv[])
-{
-  setvbuf(stdout, nullptr, _IONBF, BUFSIZ);
-
-  rclcpp::init(argc, argv);
-  rclcpp::executors::MultiThreadedExecutor executor;
-  auto node = std::make_shared<kuka_rsi::RobotManagerNode>();
-  executor.add_node(node->get_node_base_interface());
-  executor.spin();
-  rclcpp::shutdown();
-  return 0;
-}
+#include "rclcpp_components/register_node_macro.hpp"
+
+// Loadable into the process of the controller_manager, see the composed deployment
+RCLCPP_COMPONENTS_REGISTER_NODE(kuka_rsi::RobotManagerNode)
@@ -0,0 +1,215 @@
+// Copyright 2023 Svastits Áron
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <tinyxml.h>
+
+#include <string>
+#include <vector>
+
+#include "kuka_kss_rsi_driver/rsi_schema.h"
+
+namespace kuka_kss_rsi_driver
+{
+namespace
+{
+const char * const DEF_PREFIX = "DEF_";
+
+bool isInternal(const std::string & tag)
+{
+  return tag.compare(0, 4, DEF_PREFIX) == 0;
+}
+
+// Element part of a tag, e.g. Digout for Digout.o1
+std::string elementOf(const std::string & tag)
+{
+  return tag.substr(0, tag.find('.'));
+}
+
+bool contains(const std::vector<RSISchema::Element> & elements, const std::string & tag)
+{
+  for (const auto & element : elements) {
+    if (element.tag == tag) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool readElements(
+  const TiXmlElement & root, const char * section_name, std::vector<RSISchema::Element> & elements,
+  std::string & error)
+{
+  const TiXmlElement * section = root.FirstChildElement(section_name);
+  const TiXmlElement * list = section != nullptr ? section->FirstChildElement("ELEMENTS") : nullptr;
+  if (list == nullptr) {
+    error = std::string("missing ") + section_name + "/ELEMENTS";
+    return false;
+  }
+  for (const TiXmlElement * element = list->FirstChildElement("ELEMENT"); element != nullptr;
+    element = element->NextSiblingElement("ELEMENT"))
+  {
+    const char * tag = element->Attribute("TAG");
+    const char * type = element->Attribute("TYPE");
+    if (tag == nullptr || *tag == '\0') {
+      error = std::string("ELEMENT without TAG in ") + section_name;
+      return false;
+    }
+    elements.push_back({tag, type != nullptr ? type : "DOUBLE"});
+  }
+  return true;
+}
+}  // namespace
+
+bool RSISchema::load(const std::string & path, std::string & error)
+{
+  sen_type_.clear();
+  send_.clear();
+  receive_.clear();
+
+  TiXmlDocument document;
+  if (!document.LoadFile(path.c_str())) {
+    error = "Could not read the RSI configuration " + path + ": " + document.ErrorDesc();
+    return false;
+  }
+  const TiXmlElement * root = document.RootElement();
+  const TiXmlElement * config = root != nullptr ? root->FirstChildElement("CONFIG") : nullptr;
+  const TiXmlElement * sen_type =
+    config != nullptr ? config->FirstChildElement("SENTYPE") : nullptr;
+  if (sen_type == nullptr || sen_type->GetText() == nullptr) {
+    error = "Invalid RSI configuration " + path + ": missing CONFIG/SENTYPE";
+    return false;
+  }
+  sen_type_ = sen_type->GetText();
+
+  std::string section_error;
+  if (!readElements(*root, "SEND", send_, section_error) ||
+    !readElements(*root, "RECEIVE", receive_, section_error))
+  {
+    error = "Invalid RSI configuration " + path + ": " + section_error;
+    return false;
+  }
+  return true;
+}
+
+bool RSISchema::configure(
+  std::size_t external_axes, bool cartesian, RSIState & state, RSICommand & command,
+  std::string & error) const
+{
+  // The parser rejects every message without the mandatory elements
+  std::vector<std::string> required_send = {"DEF_AIPos", "DEF_ASPos"};
+  if (external_axes > 0) {
+    required_send.insert(required_send.end(), {"DEF_EIPos", "DEF_ESPos"});
+  }
+  if (cartesian) {
+    required_send.push_back("DEF_RIst");
+  }
+  for (const auto & tag : required_send) {
+    if (!contains(send_, tag)) {
+      error = "The RSI configuration does not send " + tag;
+      return false;
+    }
+  }
+
+  // The corrections not expected by the robot would not move it
+  std::vector<std::string> required_receive;
+  if (cartesian) {
+    for (const char * attribute : {"X", "Y", "Z", "A", "B", "C"}) {
+      required_receive.push_back(std::string("RKorr.") + attribute);
+    }
+  } else {
+    for (std::size_t i = 1; i <= RSIState::ROBOT_AXES; ++i) {
+      required_receive.push_back("AK.A" + std::to_string(i));
+    }
+    for (std::size_t i = 1; i <= external_axes; ++i) {
+      required_receive.push_back("EK.E" + std::to_string(i));
+    }
+  }
+  for (const auto & tag : required_receive) {
+    if (!contains(receive_, tag)) {
+      error = "The RSI configuration does not receive " + tag;
+      return false;
+    }
+  }
+
+  for (const auto & element : send_) {
+    // The internal values other than the motion data are only parsed if an interface maps them
+    if (isInternal(element.tag)) {
+      continue;
+    }
+    if (element.type == "STRING") {
+      error = "STRING element " + element.tag + " of the RSI configuration is not supported";
+      return false;
+    }
+    if (addIOValue(state.io_elements, element.tag) == nullptr) {
+      error = "Invalid element " + element.tag + " in the SEND section of the RSI configuration";
+      return false;
+    }
+  }
+  for (const auto & element : receive_) {
+    if (isMotionCommand(element.tag)) {
+      continue;
+    }
+    if (element.type == "STRING") {
+      error = "STRING element " + element.tag + " of the RSI configuration is not supported";
+      return false;
+    }
+    if (addIOValue(command.io_elements, element.tag) == nullptr) {
+      error = "Invalid element " + element.tag + " in the RECEIVE section of the RSI configuration";
+      return false;
+    }
+  }
+  command.setType(sen_type_);
+  return true;
+}
+
+bool RSISchema::sends(const std::string & tag_name) const
+{
+  const std::string element = elementOf(tag_name);
+  for (const auto & sent : send_) {
+    if (!isInternal(sent.tag)) {
+      if (sent.tag == tag_name) {
+        return true;
+      }
+    } else if (!isMotionState(sent.tag) && elementOf(sent.tag.substr(4)) == element) {
+      // The attributes of internal values like DEF_Tech.T2 are named by the controller
+      return true;
+    }
+  }
+  return false;
+}
+
+bool RSISchema::receives(const std::string & tag_name) const
+{
+  return !isMotionCommand(tag_name) && contains(receive_, tag_name);
+}
+
+bool RSISchema::isMotionState(const std::string & tag)
+{
+  for (const char * motion :
+    {"DEF_RIst", "DEF_RSol", "DEF_AIPos", "DEF_ASPos", "DEF_EIPos", "DEF_ESPos", "DEF_Delay"})
+  {
+    if (tag == motion) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool RSISchema::isMotionCommand(const std::string & tag)
+{
+  const std::string element = elementOf(tag);
+  return element == "AK" || element == "EK" || element == "RKorr" || element == "Stop" ||
+         element == "IPOC";
+}
+}  // namespace kuka_kss_rsi_driver
@@ -0,0 +1,200 @@
+// Copyright 2023 Svastits Áron
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "kuka_kss_rsi_driver/rsi_udp_server.h"
+
+namespace kuka
+{
+namespace rsi
+{
+RSIUDPServer::RSIUDPServer(
+  const std::string & host, uint16_t port_number, std::size_t axes,
+  kuka_kss_rsi_driver::RSIState::ParseFunction parse,
+  kuka_kss_rsi_driver::RSICommand::EncodeFunction encode, int precision,
+  kuka_drivers_core::WireCapture * capture,
+  kuka_drivers_core::CommandInterpolator::Mode interpolation, double max_rate_deg,
+  const kuka_drivers_core::IOThread::Options & io_thread_options)
+: udp_server_(io_context_, host, port_number, this),
+  parse_(parse),
+  encode_(encode),
+  capture_(capture),
+  command_(precision),
+  reply_joint_correction_(axes, 0.0),
+  axes_(std::min(axes, command_snapshot_.correction.size()))
+{
+  // Zero correction holds the position the robot had when RSI was started
+  if (encode_ != nullptr) {
+    interpolator_.Configure(interpolation, axes_, max_rate_deg);
+    interpolator_.Reset(command_snapshot_.correction.data());
+  }
+  // run_for() returns regularly, so that the stop of the thread is noticed, the thread ends
+  //  like run() if the server has no work left
+  io_thread_.Start(
+    [this] {
+      io_context_.run_for(std::chrono::milliseconds(10));
+      return !io_context_.stopped();
+    }, io_thread_options);
+}
+
+RSIUDPServer::~RSIUDPServer()
+{
+  io_context_.stop();
+  io_thread_.Stop();
+}
+
+bool RSIUDPServer::isInitialized() const
+{
+  return udp_server_.isInitialized();
+}
+
+bool RSIUDPServer::waitForState(
+  kuka_kss_rsi_driver::RSIState & state, std::chrono::milliseconds timeout,
+  kuka_kss_rsi_driver::IPOCTracker::Statistics * statistics)
+{
+  {
+    std::unique_lock<std::mutex> lk(mutex_);
+    if (!cv_.wait_for(lk, timeout, [this] {return states_.Fresh();})) {
+      return false;
+    }
+  }
+  return takeState(state, statistics);
+}
+
+bool RSIUDPServer::takeState(
+  kuka_kss_rsi_driver::RSIState & state,
+  kuka_kss_rsi_driver::IPOCTracker::Statistics * statistics)
+{
+  if (!states_.Update()) {
+    return false;
+  }
+  const StateSnapshot & snapshot = states_.Front();
+  state = snapshot.state;
+  if (statistics != nullptr) {
+    *statistics = snapshot.statistics;
+  }
+  return true;
+}
+
+void RSIUDPServer::setJointCorrection(const std::vector<double> & correction_deg, bool stop)
+{
+  Command command{};
+  std::copy_n(
+    correction_deg.begin(), std::min(correction_deg.size(), axes_), command.correction.begin());
+  command.stop = stop;
+  // write() follows the state messages and every message empties the queue, it fills up only
+  //  if the robot stopped sending, the snapshot would not be sent then anyway
+  commands_.Push(command);
+}
+
+void RSIUDPServer::setCartesianCorrection(const std::array<double, 6> & correction, bool stop)
+{
+  Command command{};
+  std::copy(correction.begin(), correction.end(), command.correction.begin());
+  command.stop = stop;
+  commands_.Push(command);
+}
+
+bool RSIUDPServer::updateReply(uint64_t ipoc)
+{
+  // Several snapshots might have been written since the last message, only the newest counts
+  bool updated = false;
+  while (commands_.Pop(command_snapshot_)) {
+    updated = true;
+  }
+  const double cycle_time = last_ipoc_ != 0 && ipoc > last_ipoc_ ?
+    static_cast<double>(ipoc - last_ipoc_) * 1e-3 : 0.0;
+  last_ipoc_ = ipoc;
+
+  if (encode_ == nullptr) {
+    std::copy_n(
+      command_snapshot_.correction.begin(), reply_cartesian_correction_.size(),
+      reply_cartesian_correction_.begin());
+  } else if (!interpolator_.Enabled()) {
+    std::copy_n(command_snapshot_.correction.begin(), axes_, reply_joint_correction_.begin());
+  } else {
+    if (updated) {
+      // The next snapshot is expected after as many cycles as this one took
+      const double duration = snapshot_ipoc_ != 0 && ipoc > snapshot_ipoc_ ?
+        static_cast<double>(ipoc - snapshot_ipoc_) * 1e-3 : cycle_time;
+      interpolator_.SetTarget(command_snapshot_.correction.data(), duration);
+      snapshot_ipoc_ = ipoc;
+    }
+    if (cycle_time > 0.0) {
+      const double * correction = interpolator_.Next(cycle_time);
+      std::copy_n(correction, axes_, reply_joint_correction_.begin());
+    }
+  }
+  return command_snapshot_.stop;
+}
+
+std::string_view RSIUDPServer::callback(const UDPServerData & data)
+{
+  if (capture_ != nullptr) {
+    capture_->Record(
+      kuka_drivers_core::WireCapture::Direction::RECEIVED, data.p_data, data.bytes_transferred);
+  }
+  namespace tracing = kuka_drivers_core::tracing;
+  tracing::PhaseBegin(tracing::Phase::DECODE, this);
+  const bool parsed = (received_state_.*parse_)(data.p_data, data.bytes_transferred);
+  tracing::PhaseEnd(tracing::Phase::DECODE, this);
+  if (!parsed) {
+    // Malformed message, it is not answered and the robot counts a late packet
+    return {};
+  }
+
+  // Stale messages are answered as well, but their state is not passed on
+  bool newer = true;
+  if (!tracking_) {
+    ipoc_tracker_.reset(received_state_.ipoc);
+    tracking_ = true;
+  } else {
+    newer = ipoc_tracker_.update(received_state_.ipoc, received_state_.delay) ==
+      kuka_kss_rsi_driver::IPOCTracker::Result::OK;
+  }
+  if (newer) {
+    StateSnapshot & snapshot = states_.Back();
+    snapshot.state = received_state_;
+    snapshot.statistics = ipoc_tracker_.statistics();
+    snapshot.arrival = std::chrono::steady_clock::now();
+    states_.Publish();
+    {
+      // A waitForState() between its check and its wait must not miss the notification
+      std::lock_guard<std::mutex> lk(mutex_);
+    }
+    cv_.notify_one();
+  }
+
+  const bool stop = newer ? updateReply(received_state_.ipoc) : command_snapshot_.stop;
+
+  tracing::PhaseBegin(tracing::Phase::ENCODE, this);
+  const bool encoded = encode_ != nullptr ?
+    (command_.*encode_)(reply_joint_correction_, received_state_.ipoc, stop) :
+    command_.encodeCartesian(reply_cartesian_correction_, received_state_.ipoc, stop);
+  tracing::PhaseEnd(tracing::Phase::ENCODE, this);
+  if (!encoded) {
+    return {};
+  }
+  // Recorded before the handler sends it, the reply is sent without further processing
+  if (capture_ != nullptr) {
+    capture_->Record(
+      kuka_drivers_core::WireCapture::Direction::SENT, command_.data(), command_.size());
+  }
+  return std::string_view(command_.data(), command_.size());
+}
+}  // namespace rsi
+}  // namespace kuka
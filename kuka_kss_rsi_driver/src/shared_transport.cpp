@@ -0,0 +1,172 @@
+// Copyright 2023 Svastits Áron
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sys/epoll.h>
+
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "kuka_kss_rsi_driver/shared_transport.hpp"
+
+namespace kuka_kss_rsi_driver
+{
+std::shared_ptr<SharedRSITransport> SharedRSITransport::instance()
+{
+  static std::mutex instance_mutex;
+  static std::weak_ptr<SharedRSITransport> instance;
+
+  std::lock_guard<std::mutex> lk(instance_mutex);
+  auto transport = instance.lock();
+  if (transport == nullptr) {
+    transport.reset(new SharedRSITransport());
+    instance = transport;
+  }
+  return transport;
+}
+
+SharedRSITransport::SharedRSITransport()
+{
+  epoll_fd_ = epoll_create1(0);
+  if (epoll_fd_ < 0) {
+    throw std::runtime_error("Error creating epoll instance: " + std::string(strerror(errno)));
+  }
+  io_thread_ = std::thread(&SharedRSITransport::ioLoop, this);
+}
+
+SharedRSITransport::~SharedRSITransport()
+{
+  terminate_ = true;
+  if (io_thread_.joinable()) {
+    io_thread_.join();
+  }
+  close(epoll_fd_);
+}
+
+int SharedRSITransport::add(UDPServer & server)
+{
+  std::lock_guard<std::mutex> lk(mutex_);
+  std::size_t id = 0;
+  while (id < slots_.size() && slots_[id] != nullptr) {
+    ++id;
+  }
+
+  struct epoll_event event;
+  event.events = EPOLLIN;
+  event.data.u32 = static_cast<uint32_t>(id);
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, server.fd(), &event) < 0) {
+    RCLCPP_ERROR(
+      rclcpp::get_logger("SharedRSITransport"), "Adding socket to epoll failed: %s",
+      strerror(errno));
+    return -1;
+  }
+
+  auto slot = std::make_unique<Slot>();
+  slot->server = &server;
+  slot->timestamp = std::chrono::steady_clock::now();
+  if (id == slots_.size()) {
+    slots_.push_back(std::move(slot));
+  } else {
+    slots_[id] = std::move(slot);
+  }
+  return static_cast<int>(id);
+}
+
+void SharedRSITransport::remove(int id)
+{
+  std::lock_guard<std::mutex> lk(mutex_);
+  if (id < 0 || static_cast<std::size_t>(id) >= slots_.size() || slots_[id] == nullptr) {
+    return;
+  }
+  epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, slots_[id]->server->fd(), nullptr);
+  slots_[id].reset();
+  // Robots waiting for this one can continue
+  cv_.notify_all();
+}
+
+ssize_t SharedRSITransport::receive(
+  int id, UDPServer::Packet & packet, std::chrono::milliseconds timeout,
+  std::chrono::microseconds sync_window)
+{
+  packet.data = std::string_view();
+
+  std::unique_lock<std::mutex> lk(mutex_);
+  if (id < 0 || static_cast<std::size_t>(id) >= slots_.size() || slots_[id] == nullptr) {
+    return -1;
+  }
+  Slot & slot = *slots_[id];
+
+  if (!cv_.wait_for(lk, timeout, [&slot] {return slot.fresh;})) {
+    return 0;
+  }
+
+  // Wait until every robot has delivered its frame of this cycle
+  const auto cycle_start = slot.timestamp - sync_window;
+  cv_.wait_until(
+    lk, slot.timestamp + sync_window, [this, &cycle_start] {
+      for (const auto & other : slots_) {
+        if (other != nullptr && other->timestamp < cycle_start) {
+          return false;
+        }
+      }
+      return true;
+    });
+
+  std::memcpy(slot.read_buffer.data(), slot.receive_buffer.data(), slot.size + 1);
+  slot.fresh = false;
+  packet.data = std::string_view(slot.read_buffer.data(), slot.size);
+  packet.timestamp = slot.timestamp;
+  packet.kernel_timestamp = slot.kernel_timestamp;
+  return static_cast<ssize_t>(slot.size);
+}
+
+void SharedRSITransport::ioLoop()
+{
+  constexpr int kMaxEvents = 16;
+  struct epoll_event events[kMaxEvents];
+
+  while (!terminate_) {
+    // The timeout is only needed to notice termination
+    const int count = epoll_wait(epoll_fd_, events, kMaxEvents, 100);
+    if (count <= 0) {
+      continue;
+    }
+
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      for (int i = 0; i < count; ++i) {
+        const std::size_t id = events[i].data.u32;
+        // The robot might have been removed since epoll_wait returned
+        if (id >= slots_.size() || slots_[id] == nullptr) {
+          continue;
+        }
+        Slot & slot = *slots_[id];
+        UDPServer::Packet packet;
+        if (slot.server->recv(packet) <= 0) {
+          continue;
+        }
+        // Newer frames overwrite the unread ones, only the latest state is relevant
+        std::memcpy(slot.receive_buffer.data(), packet.data.data(), packet.data.size());
+        slot.receive_buffer[packet.data.size()] = '\0';
+        slot.size = packet.data.size();
+        slot.timestamp = packet.timestamp;
+        slot.kernel_timestamp = packet.kernel_timestamp;
+        slot.fresh = true;
+      }
+    }
+    cv_.notify_all();
+  }
+}
+}  // namespace kuka_kss_rsi_driver
@@ -0,0 +1,72 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "kuka_kss_rsi_driver/rsi_state.h"
+
+using kuka_kss_rsi_driver::RSIState;
+
+namespace
+{
+std::string StateMessage(const std::string & ipoc)
+{
+  return
+    "<Rob TYPE=\"KUKA\">"
+    "<AIPos A1=\"0.0\" A2=\"-90.0\" A3=\"90.0\" A4=\"0.0\" A5=\"90.0\" A6=\"0.0\"/>"
+    "<ASPos A1=\"0.0\" A2=\"-90.0\" A3=\"90.0\" A4=\"0.0\" A5=\"90.0\" A6=\"0.0\"/>"
+    "<IPOC>" + ipoc + "</IPOC>"
+    "</Rob>";
+}
+
+bool Parse(RSIState & state, const std::string & message)
+{
+  return state.parse(message.c_str(), message.size());
+}
+}  // namespace
+
+TEST(RSIState, ParsesTheIPOC)
+{
+  RSIState state;
+  EXPECT_TRUE(Parse(state, StateMessage("4208108015")));
+  EXPECT_EQ(state.ipoc, 4208108015u);
+  EXPECT_DOUBLE_EQ(state.positions[1], -90.0);
+  EXPECT_TRUE(Parse(state, StateMessage(" 4208108016\n")));
+  EXPECT_EQ(state.ipoc, 4208108016u);
+  EXPECT_TRUE(Parse(state, StateMessage("18446744073709551615")));
+  EXPECT_EQ(state.ipoc, 18446744073709551615u);
+}
+
+TEST(RSIState, RejectsInvalidIPOCs)
+{
+  RSIState state;
+  ASSERT_TRUE(Parse(state, StateMessage("4208108015")));
+  for (const char * ipoc : {
+      "", " ", "12ab", "12 34", "-1", "+12", "0x10", "1.5", "18446744073709551616",
+      "12345678901234567890123"})
+  {
+    EXPECT_FALSE(Parse(state, StateMessage(ipoc))) << "'" << ipoc << "'";
+    EXPECT_EQ(state.ipoc, 4208108015u) << "'" << ipoc << "'";
+  }
+}
+
+TEST(RSIState, RejectsAnUnterminatedIPOC)
+{
+  RSIState state;
+  const std::string message = StateMessage("4208108015");
+  EXPECT_FALSE(Parse(state, message.substr(0, message.find("</IPOC>"))));
+  EXPECT_EQ(state.ipoc, 0u);
+}
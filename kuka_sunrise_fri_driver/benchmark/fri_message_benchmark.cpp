@@ -0,0 +1,146 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <benchmark/benchmark.h>
+#include <pb_decode.h>
+
+#include <array>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "fri_client_sdk/friLBRState.h"
+#include "friCommandMessageEncoder.h"
+#include "friMonitoringMessageDecoder.h"
+#include "kuka_drivers_core/wire_capture.hpp"
+#include "pb_frimessages_callbacks.h"
+
+namespace
+{
+using kuka_drivers_core::WireCapture;
+
+constexpr int kJoints = KUKA::FRI::LBRState::NUMBER_OF_JOINTS;
+
+// Datagrams of a commanding session of the LBR, with the joint values encoded unpacked like the
+//   callbacks of the SDK encode them
+std::vector<std::string> recordedPayloads(WireCapture::Direction direction)
+{
+  std::vector<std::string> payloads;
+  for (auto & datagram : WireCapture::ReadFile(TEST_DATA_DIR "/fri_session.wcap")) {
+    if (datagram.direction == direction) {
+      payloads.push_back(std::move(datagram.data));
+    }
+  }
+  return payloads;
+}
+
+const std::vector<std::string> & recordedMonitoringMessages()
+{
+  static const auto messages = recordedPayloads(WireCapture::Direction::RECEIVED);
+  return messages;
+}
+
+struct Command
+{
+  uint32_t sequence_counter;
+  std::array<double, kJoints> joint_positions;
+};
+
+// The joint position commands of the client in the recorded session
+const std::vector<Command> & recordedCommands()
+{
+  static const auto commands = []() {
+      std::vector<Command> result;
+      tRepeatedDoubleArguments positions;
+      init_repeatedDouble(&positions);
+      for (const auto & payload : recordedPayloads(WireCapture::Direction::SENT)) {
+        FRICommandMessage message = FRICommandMessage_init_zero;
+        map_repeatedDouble(
+          FRI_MANAGER_NANOPB_DECODE, kJoints, &message.commandData.jointPosition.value,
+          &positions);
+        pb_istream_t stream = pb_istream_from_buffer(
+          reinterpret_cast<const uint8_t *>(payload.data()), payload.size());
+        if (pb_decode(&stream, FRICommandMessage_fields, &message) &&
+          message.commandData.has_jointPosition)
+        {
+          Command command;
+          command.sequence_counter = message.header.sequenceCounter;
+          std::copy_n(positions.value, kJoints, command.joint_positions.begin());
+          result.push_back(command);
+        }
+      }
+      free_repeatedDouble(&positions);
+      return result;
+    }();
+  return commands;
+}
+
+// Replaces the specialized decode callbacks with the generic ones
+void useGenericDecoding(FRIMonitoringMessage & message)
+{
+  for (JointValues * field : {&message.monitorData.measuredJointPosition,
+      &message.monitorData.measuredTorque, &message.monitorData.commandedJointPosition,
+      &message.monitorData.commandedTorque, &message.monitorData.externalTorque,
+      &message.ipoData.jointPosition})
+  {
+    field->value.funcs.decode = &decode_repeatedDouble;
+  }
+}
+
+void BM_Decode(benchmark::State & state, bool generic)
+{
+  // decode() takes a mutable buffer, the recorded messages are copied once
+  std::vector<std::string> messages = recordedMonitoringMessages();
+  FRIMonitoringMessage message = FRIMonitoringMessage_init_zero;
+  KUKA::FRI::MonitoringMessageDecoder decoder(&message, kJoints);
+  if (generic) {
+    useGenericDecoding(message);
+  }
+  std::size_t i = 0;
+  for (auto _ : state) {
+    std::string & buffer = messages[i++ % messages.size()];
+    benchmark::DoNotOptimize(decoder.decode(&buffer[0], static_cast<int>(buffer.size())));
+  }
+}
+BENCHMARK_CAPTURE(BM_Decode, generic, true);
+BENCHMARK_CAPTURE(BM_Decode, fixed, false);
+
+void BM_Encode(benchmark::State & state, bool generic)
+{
+  const auto & commands = recordedCommands();
+  char buffer[KUKA::FRI::FRI_COMMAND_MSG_MAX_SIZE];
+  int size = 0;
+  FRICommandMessage message = FRICommandMessage_init_zero;
+  KUKA::FRI::CommandMessageEncoder encoder(&message, kJoints);
+  message.header.messageIdentifier = 0x34001;
+  message.has_commandData = true;
+  message.commandData.has_jointPosition = true;
+  if (generic) {
+    message.commandData.jointPosition.value.funcs.encode = &encode_repeatedDouble;
+  }
+  auto * positions =
+    static_cast<tRepeatedDoubleArguments *>(message.commandData.jointPosition.value.arg);
+  std::size_t i = 0;
+  for (auto _ : state) {
+    const Command & command = commands[i++ % commands.size()];
+    message.header.sequenceCounter = command.sequence_counter;
+    std::memcpy(positions->value, command.joint_positions.data(), sizeof(command.joint_positions));
+    benchmark::DoNotOptimize(encoder.encode(buffer, size));
+  }
+}
+BENCHMARK_CAPTURE(BM_Encode, generic, true);
+BENCHMARK_CAPTURE(BM_Encode, fixed, false);
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -1,34 +1,62 @@
-#ifndef FRI__HWIFCLIENTAPPLICATION_HPP_
-#define FRI__HWIFCLIENTAPPLICATION_HPP_
-
-#include <string>
-
-#include <fri_client_sdk/friClientApplication.h>
-#include <fri_client_sdk/friConnectionIf.h>
-#include <fri_client_sdk/friClientIf.h>
-#include <fri_client_sdk/friTransformationClient.h>
-#include <friClientData.h>
-
-
-namespace KUKA
-{
-namespace FRI
-{
-
-class HWIFClientApplication : public ClientApplication
-{
-public:
-  HWIFClientApplication(IConnection & connection, IClient & client);
-
-  bool client_app_read();
-  void client_app_update();
-  bool client_app_write();
-
-private:
-  int size_;
-};
-
-}
-}  // namespace KUKA::FRI
-
-#endif  // FRI__HWIFCLIENTAPPLICATION_HPP_
+#ifndef FRI__HWIFCLIENTAPPLICATION_HPP_
+#define FRI__HWIFCLIENTAPPLICATION_HPP_
+
+#include <cstdint>
+#include <string>
+
+#include <fri_client_sdk/friClientApplication.h>
+#include <fri_client_sdk/friConnectionIf.h>
+#include <fri_client_sdk/friClientIf.h>
+#include <fri_client_sdk/friTransformationClient.h>
+#include <friClientData.h>
+
+namespace kuka_drivers_core
+{
+class RTLog;
+}
+
+namespace KUKA
+{
+namespace FRI
+{
+
+class HWIFClientApplication : public ClientApplication
+{
+public:
+  HWIFClientApplication(IConnection & connection, IClient & client);
+  HWIFClientApplication(
+    IConnection & connection, IClient & client,
+    TransformationClient & trafoClient);
+
+  bool client_app_read();
+  void client_app_update();
+  bool client_app_write();
+
+  // Errors of the cycle are reported into the log instead of std::cout if it is set
+  void set_log(kuka_drivers_core::RTLog * log);
+
+  // Sequence counter of the last monitoring message
+  uint32_t sequence_counter() const;
+
+  // Sequence counter of the last command the robot received before the last monitoring message
+  uint32_t reflected_sequence_counter() const;
+
+  // Sequence counter of the command sent by the last client_app_write(), false if it sent none
+  bool sent_sequence_counter(uint32_t & counter) const;
+
+  // Only the selected fields of the monitoring messages are decoded
+  void set_decode_selection(const MonitoringMessageDecoder::Selection & selection);
+
+private:
+  void log_error(const char * format, ...);
+
+  int size_;
+  bool sent_ = false;
+  uint32_t sent_counter_ = 0;
+  kuka_drivers_core::RTLog * log_ = nullptr;
+};
+
+}
+}  // namespace KUKA::FRI
+
+#endif  // FRI__HWIFCLIENTAPPLICATION_HPP_
@@ -123,6 +123,22 @@ public:
      */
   LBRCommand & robotCommand() {return _robotCommand;}
 
+  /**
+     * \brief Decode joint values of the monitoring message directly into external arrays.
+     *
+     * The getters of robotState() return the given arrays afterwards, so the values need not
+     * be copied after each received message. The arrays must hold LBRState::NUMBER_OF_JOINTS
+     * values and stay valid while the client is used, passing NULL restores the internal
+     * storage of the values. The values of a message that cannot be decoded are undefined.
+     *
+     * @param measuredJointPosition storage of the measured joint positions (in rad)
+     * @param measuredTorque storage of the measured joint torques (in Nm)
+     * @param externalTorque storage of the estimated external torques (in Nm)
+     */
+  void setJointValueStorage(
+    double * measuredJointPosition, double * measuredTorque,
+    double * externalTorque);
+
 private:
   LBRState _robotState;          //!< wrapper class for the FRI monitoring message
   LBRCommand _robotCommand;      //!< wrapper class for the FRI command message
@@ -63,6 +63,7 @@ cost of any service and repair.
 
 // forward declarations
 typedef struct _FRICommandMessage FRICommandMessage;
+typedef struct _FriIOValue FriIOValue;
 
 /** Kuka namespace */
 namespace KUKA
@@ -146,10 +147,89 @@ public:
      */
   void setAnalogIOValue(const char * name, const double value);
 
+  /**
+     * \brief Set boolean output value by its index in the monitoring message.
+     *
+     * @throw FRIException Throws a FRIException if more outputs are set than can be registered.
+     * @throw FRIException May throw an FRIException if the IO is of wrong type, unknown or not an output.
+     * @param index Index of the IO (see LBRState::getIOIndex()).
+     * @param value Boolean value to set.
+     */
+  void setBooleanIOValue(int index, const bool value);
+
+  /**
+     * \brief Set digital output value by its index in the monitoring message.
+     *
+     * @throw FRIException Throws a FRIException if more outputs are set than can be registered.
+     * @throw FRIException May throw an FRIException if the IO is of wrong type, unknown or not an output.
+     * @param index Index of the IO (see LBRState::getIOIndex()).
+     * @param value Digital value to set.
+     */
+  void setDigitalIOValue(int index, const unsigned long long value);
+
+  /**
+     * \brief Set analog output value by its index in the monitoring message.
+     *
+     * @throw FRIException Throws a FRIException if more outputs are set than can be registered.
+     * @throw FRIException May throw an FRIException if the IO is of wrong type, unknown or not an output.
+     * @param index Index of the IO (see LBRState::getIOIndex()).
+     * @param value Analog value to set.
+     */
+  void setAnalogIOValue(int index, const double value);
+
+  /**
+     * \brief Prepare a slot for writing a boolean output with setIOSlotValue().
+     *
+     * The IO is validated and its write request is built once, the slot is kept until it is
+     * prepared again, e.g. because the index of the IO changed in a new session.
+     *
+     * @throw FRIException Throws a FRIException if the slot is not between 0 and MAX_IO_SLOTS - 1.
+     * @throw FRIException May throw an FRIException if the IO is of wrong type, unknown or not an output.
+     * @param slot Slot of the output.
+     * @param index Index of the IO (see LBRState::getIOIndex()).
+     */
+  void prepareBooleanIOSlot(int slot, int index);
+
+  /**
+     * \brief Prepare a slot for writing a digital output with setIOSlotValue().
+     *
+     * @throw FRIException Throws a FRIException if the slot is not between 0 and MAX_IO_SLOTS - 1.
+     * @throw FRIException May throw an FRIException if the IO is of wrong type, unknown or not an output.
+     * @param slot Slot of the output.
+     * @param index Index of the IO (see LBRState::getIOIndex()).
+     */
+  void prepareDigitalIOSlot(int slot, int index);
+
+  /**
+     * \brief Prepare a slot for writing an analog output with setIOSlotValue().
+     *
+     * @throw FRIException Throws a FRIException if the slot is not between 0 and MAX_IO_SLOTS - 1.
+     * @throw FRIException May throw an FRIException if the IO is of wrong type, unknown or not an output.
+     * @param slot Slot of the output.
+     * @param index Index of the IO (see LBRState::getIOIndex()).
+     */
+  void prepareAnalogIOSlot(int slot, int index);
+
+  /**
+     * \brief Set the value of a prepared output slot.
+     *
+     * The prepared write request is copied into the command message without searching or
+     * validating the IO again. Boolean and digital outputs receive the value converted to an
+     * integer.
+     *
+     * @throw FRIException Throws a FRIException if more outputs are set than can be registered.
+     * @param slot Slot of the output (see prepareBooleanIOSlot() and the like).
+     * @param value Value to set.
+     */
+  void setIOSlotValue(int slot, const double value);
+
+  static const int MAX_IO_SLOTS = 10;                 //!< number of outputs that can be set in one command message
+
 protected:
   static const int LBRCOMMANDMESSAGEID = 0x34001;     //!< type identifier for the FRI command message corresponding to a KUKA LBR robot
   FRICommandMessage * _cmdMessage;                    //!< FRI command message (protobuf struct)
   FRIMonitoringMessage * _monMessage;                    //!< FRI monitoring message (protobuf struct)
+  FriIOValue * _ioSlots;                              //!< prepared write requests, MAX_IO_SLOTS of them
 
 };
 
@@ -264,6 +264,50 @@ public:
      */
   double getAnalogIOValue(const char * name) const;
 
+  /**
+     * \brief Get the index of an IO in the monitoring message.
+     *
+     * The IOs of the monitoring message are fixed for an FRI session, so the value of an IO
+     * can be accessed by its index instead of its name while the number of IOs is unchanged.
+     * @param name Full name of the IO (Syntax "IOGroupName.IOName").
+     * @return Returns the index of the IO or -1 if the IO is unknown.
+     */
+  int getIOIndex(const char * name) const;
+
+  /**
+     * \brief Get the number of IOs in the monitoring message.
+     *
+     * @return Returns the number of IOs, 0 if the message has no monitoring data.
+     */
+  int getIOCount() const;
+
+  /**
+     * \brief Get boolean IO value by its index.
+     *
+     * @throw FRIException May throw an FRIException if the IO is of wrong type or unknown.
+     * @param index Index of the IO (see getIOIndex()).
+     * @return Returns IO's boolean value.
+     */
+  bool getBooleanIOValue(int index) const;
+
+  /**
+     * \brief Get digital IO value by its index.
+     *
+     * @throw FRIException May throw an FRIException if the IO is of wrong type or unknown.
+     * @param index Index of the IO (see getIOIndex()).
+     * @return Returns IO's digital value.
+     */
+  unsigned long long getDigitalIOValue(int index) const;
+
+  /**
+     * \brief Get analog IO value by its index.
+     *
+     * @throw FRIException May throw an FRIException if the IO is of wrong type or unknown.
+     * @param index Index of the IO (see getIOIndex()).
+     * @return Returns IO's analog value.
+     */
+  double getAnalogIOValue(int index) const;
+
 protected:
   static const int LBRMONITORMESSAGEID = 0x245142;       //!< type identifier for the FRI monitoring message corresponding to a KUKA LBR robot
   FRIMonitoringMessage * _message;                       //!< FRI monitoring message (protobuf struct)
@@ -77,9 +77,23 @@ cost of any service and repair.
    #include <netinet/in.h>
    #include <arpa/inet.h>
 #endif
+// Modification (kuka_drivers contributors): common transport of the drivers on unix
+#ifdef __unix__
+   #include "kuka_drivers_core/udp_transport.hpp"
+#endif
+// End of modification
 
 #include <fri_client_sdk/friConnectionIf.h>
 
+// Modification (kuka_drivers contributors): wire capture
+namespace kuka_drivers_core
+{
+class WireCapture;
+class FaultInjector;
+class RTLog;
+}
+// End of modification
+
 /** Kuka namespace */
 namespace KUKA
 {
@@ -146,11 +160,77 @@ public:
      */
   virtual bool send(const char * buffer, int size);
 
+  // Modification (kuka_drivers contributors): common transport of the drivers on unix
+#ifdef __unix__
+  /**
+     * \brief Set the receive strategy, kernel timestamps, socket priority and DSCP of the
+     * transport, must be called before open().
+     *
+     * @param options The options of the transport
+     */
+  void setTransportOptions(const kuka_drivers_core::UdpTransport::Options & options);
+#endif
+  // End of modification
+
+  // Modification (kuka_drivers contributors): wire capture
+  /**
+     * \brief Record the received and sent messages into the capture.
+     *
+     * @param capture The recorder, must outlive the connection, NULL disables recording
+     *                (only supported with the common transport on unix)
+     */
+  void setCapture(kuka_drivers_core::WireCapture * capture);
+  // End of modification
+
+  // Modification (kuka_drivers contributors): fault injection
+  /**
+     * \brief Apply network faults to the received and sent messages for testing.
+     *
+     * @param faults The injector, must outlive the connection, NULL disables fault injection
+     *               (only supported with the common transport on unix)
+     */
+  void setFaultInjector(kuka_drivers_core::FaultInjector * faults);
+  // End of modification
+
+  // Modification (kuka_drivers contributors): real-time logging
+  /**
+     * \brief Report receive errors into the log instead of printing them.
+     *
+     * @param log The log ring, must outlive the connection, NULL restores printing
+     *            (only supported with the common transport on unix)
+     */
+  void setLog(kuka_drivers_core::RTLog * log);
+  // End of modification
+
+  // Modification (kuka_drivers contributors): shared receive thread
+  /**
+     * \brief Socket handle, to wait for the messages of several connections at once.
+     *
+     * @return The handle, or -1 if the connection is not open
+     */
+#ifdef __unix__
+  int getSocket() const {return _transport.Fd();}
+#else
+  int getSocket() const {return _udpSock;}
+#endif
+  // End of modification
+
 private:
+  // Modification (kuka_drivers contributors): common transport of the drivers on unix
+#ifdef __unix__
+  kuka_drivers_core::UdpTransport _transport;
+  kuka_drivers_core::UdpTransport::Options _transportOptions;
+  unsigned int _receiveTimeout;
+  kuka_drivers_core::RTLog * _log;
+#else
+  // End of modification
   int _udpSock;                              //!< UDP socket handle
   struct sockaddr_in _controllerAddr;        //!< the controller's socket address
   unsigned int _receiveTimeout;
   fd_set _filedescriptor;
+  // Modification (kuka_drivers contributors): common transport of the drivers on unix
+#endif
+  // End of modification
 
 };
 
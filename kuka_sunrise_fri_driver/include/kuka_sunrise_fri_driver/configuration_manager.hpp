@@ -15,6 +15,7 @@
 #ifndef KUKA_SUNRISE_FRI_DRIVER__CONFIGURATION_MANAGER_HPP_
 #define KUKA_SUNRISE_FRI_DRIVER__CONFIGURATION_MANAGER_HPP_
 
+#include <functional>
 #include <map>
 #include <vector>
 #include <memory>
@@ -27,9 +28,12 @@
 #include "std_srvs/srv/trigger.hpp"
 #include "kuka_driver_interfaces/srv/set_int.hpp"
 #include "controller_manager_msgs/srv/list_controllers.hpp"
+#include "rcl_interfaces/srv/set_parameters.hpp"
 #include "kuka_sunrise_fri_driver/fri_connection.hpp"
+#include "communication_helpers/service_tools.hpp"
 
 #include "kuka_drivers_core/ros2_base_lc_node.hpp"
+#include "kuka_drivers_core/switch_trace.hpp"
 
 namespace kuka_sunrise_fri_driver
 {
@@ -39,41 +43,106 @@ class RobotManager;
 class ConfigurationManager
 {
 public:
+  // Sends the command mode command and activates the given controller instead of the current
+  //  one, used if the command mode is changed in active state
+  using CommandModeSwitch =
+    std::function<bool(const FRIConnection::Command &, const std::string & controller_name)>;
+  // Restarts the FRI session with the given send period and receive multiplier of the robot,
+  //  used if they are changed in active state. retime_hardware is called after the restart and
+  //  applies the new timing to the hardware interface and the control loop
+  using SessionRestart = std::function<bool(
+        int send_period_ms, int receive_multiplier,
+        const std::function<bool()> & retime_hardware)>;
+
   ConfigurationManager(
     std::shared_ptr<kuka_drivers_core::ROS2BaseLCNode> robot_manager_node,
-    std::shared_ptr<FRIConnection> fri_connection);
+    std::shared_ptr<FRIConnection> fri_connection,
+    CommandModeSwitch command_mode_switch = nullptr, SessionRestart session_restart = nullptr,
+    std::shared_ptr<kuka_drivers_core::SwitchTrace> switch_trace = nullptr);
 
 private:
   bool configured_ = false;
   bool position_controller_available_ = false;
   bool torque_controller_available_ = false;
+  bool wrench_controller_available_ = false;
   std::shared_ptr<kuka_drivers_core::ROS2BaseLCNode> robot_manager_node_;
   std::shared_ptr<FRIConnection> fri_connection_;
+  CommandModeSwitch command_mode_switch_;
+  SessionRestart session_restart_;
+  std::shared_ptr<kuka_drivers_core::SwitchTrace> switch_trace_;
   rclcpp::CallbackGroup::SharedPtr cbg_;
   rclcpp::CallbackGroup::SharedPtr param_cbg_;
   rclcpp::Client<kuka_driver_interfaces::srv::SetInt>::SharedPtr receive_multiplier_client_;
   rclcpp::Client<controller_manager_msgs::srv::ListControllers>::SharedPtr get_controllers_client_;
+  rclcpp::Client<rcl_interfaces::srv::SetParameters>::SharedPtr update_rate_client_;
   rclcpp::Service<std_srvs::srv::Trigger>::SharedPtr set_parameter_service_;
 
   std::vector<double> joint_stiffness_ = std::vector<double>(7, 1000.0);
   std::vector<double> joint_damping_ = std::vector<double>(7, 0.7);
+  // Translational (x, y, z) values first, then the rotational (a, b, c) ones
+  std::vector<double> cartesian_stiffness_ = {2000.0, 2000.0, 2000.0, 200.0, 200.0, 200.0};
+  std::vector<double> cartesian_damping_ = std::vector<double>(6, 0.7);
 
   const std::string POSITION_COMMAND = "position";
   const std::string TORQUE_COMMAND = "torque";
+  const std::string WRENCH_COMMAND = "wrench";
   const std::string POSITION_CONTROL = "position";
   const std::string IMPEDANCE_CONTROL = "joint_impedance";
+  const std::string CARTESIAN_IMPEDANCE_CONTROL = "cartesian_impedance";
 
   bool onCommandModeChangeRequest(const std::string & command_mode) const;
   bool onControlModeChangeRequest(const std::string & control_mode) const;
   bool onJointStiffnessChangeRequest(const std::vector<double> & joint_stiffness);
   bool onJointDampingChangeRequest(const std::vector<double> & joint_damping);
+  bool onCartesianStiffnessChangeRequest(const std::vector<double> & cartesian_stiffness);
+  bool onCartesianDampingChangeRequest(const std::vector<double> & cartesian_damping);
   bool onSendPeriodChangeRequest(const int & send_period) const;
   bool onReceiveMultiplierChangeRequest(const int & receive_multiplier) const;
+  bool onClientPortChangeRequest(const int & client_port) const;
   bool onControllerIpChangeRequest(const std::string & controller_ip) const;
-  bool onControllerNameChangeRequest(const std::string & controller_name, bool position);
-  bool setCommandMode(const std::string & control_mode) const;
+  bool onControllerNameChangeRequest(
+    const std::string & controller_name,
+    const std::string & command_mode);
+  // Starts the trace of a mode switch requested by a parameter batch, finished at its end
+  void traceSwitch(const std::string & parameter, const std::string & value) const;
+  // Sends the command mode to the robot application, or switches it online if active
+  bool applyCommandMode(const std::string & command_mode) const;
   bool setReceiveMultiplier(int receive_multiplier) const;
+  // Changes the update_rate of the control loop of the controller_manager
+  bool setUpdateRate(int update_rate) const;
+  // Applies the send period and receive multiplier set in active state at the end of the batch
+  bool applyRetiming();
+  // Waits for the receive multiplier set during a parameter batch, true if none is pending
+  bool awaitReceiveMultiplier() const;
+  // Looks up the controller in the cached list, which is only requested again if the name is
+  //  not found in it, e.g. because the controller was loaded after the last request
+  bool findController(const std::string & controller_name, bool & found);
+  void requestControllerList();
+  void cancelControllerList();
+  // Sends the command, or only collects it while the initial parameters are registered
+  bool sendCommand(const FRIConnection::Command & command) const;
+  // Collect the commands of a parameter batch and send them together at its end
+  void beginCommandBatch();
+  bool endCommandBatch(bool successful);
+  bool sendDeferredCommands();
   void setParameters(std_srvs::srv::Trigger::Response::SharedPtr response);
+  void registerParameters();
+
+  bool defer_commands_ = false;
+  bool batch_started_ = false;
+  mutable std::vector<FRIConnection::Command> deferred_commands_;
+  mutable std::shared_ptr<kuka_drivers_core::ServiceCall<kuka_driver_interfaces::srv::SetInt>>
+  receive_multiplier_call_;
+
+  std::shared_ptr<kuka_drivers_core::ServiceCall<controller_manager_msgs::srv::ListControllers>>
+  controller_list_call_;
+  std::vector<std::string> loaded_controllers_;
+  bool controller_list_valid_ = false;
+
+  // New timing of the parameter batch in active state, 0 if unchanged
+  mutable int pending_send_period_ = 0;
+  mutable int pending_receive_multiplier_ = 0;
+  mutable bool tracing_switch_ = false;
 };
 }  // namespace kuka_sunrise_fri_driver
 
@@ -0,0 +1,93 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_SUNRISE_FRI_DRIVER__FRAME_STREAMER_HPP_
+#define KUKA_SUNRISE_FRI_DRIVER__FRAME_STREAMER_HPP_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "geometry_msgs/msg/transform_stamped.hpp"
+#include "rclcpp/rclcpp.hpp"
+#include "kuka_drivers_core/spsc_queue.hpp"
+
+#include "fri_client_sdk/friTransformationClient.h"
+
+namespace kuka_sunrise_fri_driver
+{
+/**
+ * @brief Transformation client providing the frames requested by the robot application
+ *
+ * The frames are received on a topic as TransformStamped messages, the child frame selects the
+ * transformation ID. The subscriber thread hands the matrices over to the control loop through
+ * a lock-free queue, provide() only copies the latest matrix of each requested frame into the
+ * command message. Frames without a new value are repeated with their previous timestamp, as
+ * the SDK requires.
+ */
+class FrameStreamer : public KUKA::FRI::TransformationClient
+{
+public:
+  // Maximal number of transformations in a command message
+  static constexpr std::size_t kMaxFrames = 5;
+
+  FrameStreamer() = default;
+  ~FrameStreamer() override;
+
+  // Returns false if more frames are given than can be sent, must be called before start()
+  bool configure(const std::vector<std::string> & ids);
+
+  bool enabled() const {return !frames_.empty();}
+
+  // Subscribes to the topic and spins a node in a separate thread
+  void start(const std::string & node_name, const std::string & topic);
+  void stop();
+
+  // Called by the control loop
+  void provide() override;
+
+private:
+  // Translation in millimeters, as expected by the controller
+  using Matrix = double[3][4];
+
+  struct Update
+  {
+    std::size_t index;
+    Matrix matrix;
+  };
+
+  struct Frame
+  {
+    std::string id;
+    Matrix matrix;
+    bool valid = false;
+    unsigned int sec = 0;
+    unsigned int nanosec = 0;
+  };
+
+  void onTransform(const geometry_msgs::msg::TransformStamped::SharedPtr msg);
+
+  std::vector<Frame> frames_;
+  kuka_drivers_core::SPSCQueue<Update, 32> updates_;
+
+  rclcpp::Node::SharedPtr node_;
+  rclcpp::Subscription<geometry_msgs::msg::TransformStamped>::SharedPtr subscription_;
+  std::shared_ptr<rclcpp::executors::SingleThreadedExecutor> executor_;
+  std::thread spin_thread_;
+};
+}  // namespace kuka_sunrise_fri_driver
+
+#endif  // KUKA_SUNRISE_FRI_DRIVER__FRAME_STREAMER_HPP_
@@ -19,6 +19,11 @@
 #include <functional>
 #include <vector>
 #include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "kuka_drivers_core/spsc_queue.hpp"
 
 namespace kuka_sunrise_fri_driver
 {
@@ -44,20 +49,40 @@ enum CommandSuccess : std::uint8_t
 
 enum ControlModeID : std::uint8_t
 {
-  POSITION_CONTROL_MODE = 1, JOINT_IMPEDANCE_CONTROL_MODE = 2
+  POSITION_CONTROL_MODE = 1, JOINT_IMPEDANCE_CONTROL_MODE = 2, CARTESIAN_IMPEDANCE_CONTROL_MODE = 3
 };
 
 enum ClientCommandModeID : std::uint8_t
 {
-  POSITION_COMMAND_MODE = 1, TORQUE_COMMAND_MODE = 3
+  POSITION_COMMAND_MODE = 1, WRENCH_COMMAND_MODE = 2, TORQUE_COMMAND_MODE = 3
 };
 
 static const std::vector<std::uint8_t> FRI_CONFIG_HEADER = {0xAC, 0xED, 0x00, 0x05, 0x77, 0x0C};
 static const std::vector<std::uint8_t> CONTROL_MODE_HEADER = {0xAC, 0xED, 0x00, 0x05, 0x77, 0x70};
+// Block data of 12 doubles: Cartesian stiffness and damping
+static const std::vector<std::uint8_t> CARTESIAN_CONTROL_MODE_HEADER =
+{0xAC, 0xED, 0x00, 0x05, 0x77, 0x60};
 
 class FRIConnection
 {
 public:
+  struct Command
+  {
+    CommandID id;
+    std::vector<std::uint8_t> data;
+  };
+
+  // Serialized commands for sendCommandsAndWait()
+  static Command makePositionControlModeCommand();
+  static Command makeJointImpedanceControlModeCommand(
+    const std::vector<double> & joint_stiffness,
+    const std::vector<double> & joint_damping);
+  static Command makeCartesianImpedanceControlModeCommand(
+    const std::vector<double> & cartesian_stiffness,
+    const std::vector<double> & cartesian_damping);
+  static Command makeClientCommandModeCommand(ClientCommandModeID client_command_mode);
+  static Command makeFRIConfigCommand(int remote_port, int send_period_ms, int receive_multiplier);
+
   FRIConnection(
     std::function<void(void)> handle_control_ended_error_callback,
     std::function<void(void)> handle_fri_ended_callback);
@@ -72,6 +97,10 @@ public:
   bool setJointImpedanceControlMode(
     const std::vector<double> & joint_stiffness,
     const std::vector<double> & joint_damping);
+  // Stiffness and damping of x, y, z, a, b, c, in N/m and Nm/rad, damping ratios are 0.1..1
+  bool setCartesianImpedanceControlMode(
+    const std::vector<double> & cartesian_stiffness,
+    const std::vector<double> & cartesian_damping);
   bool setClientCommandMode(ClientCommandModeID client_command_mode);
   // bool getControlMode();
   bool setFRIConfig(int remote_port, int send_period_ms, int receive_multiplier);
@@ -79,28 +108,63 @@ public:
 
   bool isConnected();
 
+  /**
+   * @brief Sends the commands back to back and waits for all of the replies
+   *
+   * The robot application executes the commands in order, the replies are matched to the
+   * commands by their ID.
+   * @returns the success of each command, in the order of the commands
+   */
+  std::vector<bool> sendCommandsAndWait(const std::vector<Command> & commands);
+
 private:
   std::unique_ptr<TCPConnection> tcp_connection_;
 
   std::function<void(void)> handleControlEndedError_;
   std::function<void(void)> handleFRIEndedError_;
 
-  void handleReceivedTCPData(const std::vector<std::uint8_t> & data);
+  void handleReceivedTCPData(const std::uint8_t * data, std::size_t size);
   void connectionLostCallback(const char * server_addr, int server_port);
 
-  CommandState last_command_state_;
-  CommandID last_command_id_;
-  CommandSuccess last_command_success_;
-
-  bool answer_wanted_;
-  bool answer_received_;
+  // Events of the event loop of the TCP connection, handled by error_worker_
+  enum class ErrorEvent
+  {
+    CONTROL_ENDED,
+    FRI_ENDED,
+    CONNECTION_LOST
+  };
+  void postErrorEvent(ErrorEvent event);
+  void handleErrorEvents();
+
+  kuka_drivers_core::SPSCQueue<ErrorEvent, 8> error_events_;
+  std::thread error_worker_;
+  bool error_worker_running_ = true;
+  std::mutex error_mutex_;
+  std::condition_variable error_cv_;
+
+  // Kept for reconnecting after the connection is lost
+  std::string server_addr_;
+  int server_port_ = 0;
+
+  // Commands sent by sendCommandsAndWait() and their results, guarded by m_
+  std::vector<CommandID> pending_ids_;
+  std::vector<bool> answered_;
+  std::vector<bool> results_;
+  std::size_t answers_remaining_ = 0;
   std::mutex m_;
   std::condition_variable cv_;
+  // Serializes the batches of the callers
+  std::mutex send_mutex_;
 
-  // void wait();
-  bool assertLastCommandSuccess(CommandID command_id);
+  // Completes the first unanswered command with the ID, or the oldest one if the ID is unknown
+  void completeCommand(const CommandID * command_id, bool success);
+  void completeAllCommands();
   bool sendCommandAndWait(CommandID command_id);
-  bool sendCommandAndWait(CommandID command_id, const std::vector<std::uint8_t> & command_data);
+  bool sendCommandAndWait(const Command & command);
+  // Control mode, block data header, then the values as big endian doubles
+  static std::vector<std::uint8_t> serializeImpedance(
+    ControlModeID control_mode, const std::vector<std::uint8_t> & header,
+    const std::vector<double> & stiffness, const std::vector<double> & damping);
 };
 
 }  // namespace kuka_sunrise_fri_driver
@@ -15,8 +15,11 @@
 #ifndef KUKA_SUNRISE_FRI_DRIVER__HARDWARE_INTERFACE_HPP_
 #define KUKA_SUNRISE_FRI_DRIVER__HARDWARE_INTERFACE_HPP_
 
+#include <array>
+#include <atomic>
 #include <condition_variable>
 #include <memory>
+#include <thread>
 #include <vector>
 #include <string>
 #include <unordered_map>
@@ -26,11 +29,36 @@
 
 #include "hardware_interface/system_interface.hpp"
 #include "kuka_driver_interfaces/srv/set_int.hpp"
+#include "kuka_drivers_core/clock_sync.hpp"
+#include "kuka_drivers_core/command_filter.hpp"
+#include "kuka_drivers_core/activity_monitor.hpp"
+#include "kuka_drivers_core/command_interpolator.hpp"
+#include "kuka_drivers_core/cycle_coordinator.hpp"
+#include "kuka_drivers_core/fault_injection.hpp"
+#include "kuka_drivers_core/flight_recorder.hpp"
+#include "kuka_drivers_core/interface_storage.hpp"
+#include "kuka_drivers_core/joint_state_publisher.hpp"
+#include "kuka_drivers_core/link_diagnostics.hpp"
+#include "kuka_drivers_core/metrics_exporter.hpp"
+#include "kuka_drivers_core/rt_log.hpp"
+#include "kuka_drivers_core/rt_log_drain.hpp"
+#include "kuka_drivers_core/startup_profile.hpp"
+#include "kuka_drivers_core/state_batch_publisher.hpp"
+#include "kuka_drivers_core/state_channel.hpp"
+#include "kuka_drivers_core/tracing.hpp"
+#include "kuka_drivers_core/tuning_parameters.hpp"
+#include "kuka_drivers_core/wire_capture.hpp"
 
 #include "fri_client_sdk/friLBRClient.h"
 #include "fri_client_sdk/HWIFClientApplication.hpp"
 #include "fri_client_sdk/friUdpConnection.h"
 #include "fri_client_sdk/friClientIf.h"
+#include "fri_client_sdk/friException.h"
+#include "kuka_sunrise_fri_driver/frame_streamer.hpp"
+#include "kuka_sunrise_fri_driver/loop_latency.hpp"
+#include "kuka_sunrise_fri_driver/receive_group.hpp"
+#include "kuka_sunrise_fri_driver/state_event_publisher.hpp"
+#include "kuka_sunrise_fri_driver/state_recorder.hpp"
 #include "kuka_sunrise_fri_driver/visibility_control.h"
 
 using CallbackReturn = rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn;
@@ -56,7 +84,8 @@ public:
   RCLCPP_SHARED_PTR_DEFINITIONS(KukaFRIHardwareInterface)
 
   KUKA_SUNRISE_FRI_DRIVER_PUBLIC KukaFRIHardwareInterface()
-  : client_application_(udp_connection_, *this) {}
+  : connection_(udp_connection_), client_application_(connection_, *this, frame_streamer_) {}
+  KUKA_SUNRISE_FRI_DRIVER_PUBLIC ~KukaFRIHardwareInterface();
   KUKA_SUNRISE_FRI_DRIVER_PUBLIC CallbackReturn on_init(
     const hardware_interface::HardwareInfo & info) override;
   KUKA_SUNRISE_FRI_DRIVER_PUBLIC CallbackReturn on_activate(
@@ -80,6 +109,9 @@ public:
 
   KUKA_SUNRISE_FRI_DRIVER_PUBLIC void waitForCommand() final;
   KUKA_SUNRISE_FRI_DRIVER_PUBLIC void command() final;
+  KUKA_SUNRISE_FRI_DRIVER_PUBLIC void onStateChange(
+    KUKA::FRI::ESessionState oldState,
+    KUKA::FRI::ESessionState newState) final;
 
   class InvalidGPIOTypeException : public std::runtime_error
   {
@@ -94,7 +126,72 @@ public:
 private:
   bool is_active_ = false;
   bool active_read_ = false;
+  // Declared before the connection, which records into it
+  std::unique_ptr<kuka_drivers_core::WireCapture> wire_capture_;
+  // Optional network faults of the fault_profile parameter, applied by the connection
+  std::unique_ptr<kuka_drivers_core::FaultInjector> fault_injector_;
+  // Messages of the control loop, written to the rclcpp log by log_drain_
+  kuka_drivers_core::RTLog rt_log_;
+  kuka_drivers_core::RTLogDrain log_drain_{rt_log_, "KukaFRIHardwareInterface"};
+  // Phases of the bring-up, logged at the end of on_activate()
+  kuka_drivers_core::StartupProfile startup_profile_{"KukaFRIHardwareInterface"};
+  // The delay of the first monitoring message after the activation is logged from read()
+  kuka_drivers_core::StartupProfile::Clock::time_point activation_end_;
+  std::atomic<bool> first_message_pending_{false};
   KUKA::FRI::UdpConnection udp_connection_;
+  // Receives through the shared thread of the robots in the process, if receive_group is set
+  GroupedConnection connection_;
+  // The connection is read by its own thread, if io_thread is set
+  bool io_thread_ = false;
+  // Index of the robot in the cycle coordinator while active, -1 without cycle_coordination
+  kuka_drivers_core::CycleCoordinator::Options cycle_coordination_options_;
+  int cycle_robot_ = -1;
+  // Wakes the control loop in idle mode, set while the driver needs the cycles of the loop
+  kuka_drivers_core::ActivityMonitor::Flag activity_;
+  int client_port_ = 30200;
+  // Provides the frames requested by the robot application, if streamed_frames is set
+  FrameStreamer frame_streamer_;
+  std::string streamed_frames_topic_;
+  // Records the state of every cycle, if state_recording_file is set
+  StateRecorder state_recorder_;
+  // Per-cycle record of the states and commands, if flight_recorder_file is set
+  std::unique_ptr<kuka_drivers_core::FlightRecorder> flight_recorder_;
+  // Latest state in shared memory for other processes, if state_channel_file is set
+  std::unique_ptr<kuka_drivers_core::StateChannel> state_channel_;
+  // Decimated joint states published by a separate thread, if joint_state_decimation is set
+  std::unique_ptr<kuka_drivers_core::JointStatePublisher> joint_state_publisher_;
+  // Every state in batches published by a separate thread, if state_batch_size is set
+  std::unique_ptr<kuka_drivers_core::StateBatchPublisher> state_batch_publisher_;
+  std::unique_ptr<StateEventPublisher> state_events_;
+  // Trend of the connection quality and tracking performance, if link_diagnostics_period_ms is set
+  std::unique_ptr<kuka_drivers_core::LinkDiagnostics> link_diagnostics_;
+  // Loop from the monitoring messages to the commands and back, published if
+  //  loop_latency_diagnostics is set
+  LoopLatency loop_latency_;
+  std::unique_ptr<LoopLatencyDiagnostics> loop_latency_diagnostics_;
+  // Optional link state and loop latencies for Prometheus, if metrics_port is set
+  std::unique_ptr<kuka_drivers_core::MetricsExporter::Group> metrics_group_;
+  struct Metrics
+  {
+    kuka_drivers_core::MetricsExporter::Gauge * connection_quality = nullptr;
+    kuka_drivers_core::MetricsExporter::Gauge * session_state = nullptr;
+    kuka_drivers_core::MetricsExporter::Counter * late_answers = nullptr;
+    kuka_drivers_core::MetricsExporter::Histogram * round_trip_latency = nullptr;
+    kuka_drivers_core::MetricsExporter::Histogram * host_latency = nullptr;
+  } metrics_;
+  // Arrival on the steady clock and controller timestamp of the last monitoring message
+  int64_t arrival_ns_ = 0;
+  int64_t robot_ns_ = 0;
+  // Filters of the joint position commands, configured by the command_* hardware parameters
+  kuka_drivers_core::JointCommandFilter command_filter_;
+  // Values of the tuning parameters, taken over at the start of read()
+  struct Tuning
+  {
+    kuka_drivers_core::CommandFilterTuning command_filter;
+  };
+  // Optional node of the tuning parameters, if tuning_parameters is set
+  std::unique_ptr<kuka_drivers_core::TuningParameters<Tuning>> tuning_;
+  std::vector<double> filtered_commands_;
   KUKA::FRI::HWIFClientApplication client_application_;
 
   rclcpp::Service<kuka_driver_interfaces::srv::SetInt>::SharedPtr set_receive_multiplier_service_;
@@ -102,16 +199,36 @@ private:
 
   // Command interface must be of type double, but controller can set only integers
   // this is a temporary solution, until runtime parameters are supported for hardware interfaces
+  // The robot manager changes it at runtime through the fri_configuration_controller
   double receive_multiplier_ = 1;
   int receive_counter_ = 0;
+  // Multiplier of the current controller cycle, receive_multiplier_ can change at any time
+  int applied_receive_multiplier_ = 1;
   bool torque_command_mode_ = false;
+  // Smooths the commands between the controller updates if receive_multiplier_ is above 1
+  kuka_drivers_core::CommandInterpolator command_interpolator_;
+  // Joint values are decoded into the state interfaces, set if the robot has 7 joints
+  bool zero_copy_states_ = false;
+  // Only the state is streamed, no joint command interfaces are exported
+  bool monitoring_only_ = false;
+  // Only the fields of the monitoring messages behind the exported interfaces are decoded
+  bool selective_decode_ = false;
 
-  // State and command interfaces
-  std::vector<double> hw_commands_;
-  std::vector<double> hw_states_;
-  std::vector<double> hw_torques_ext_;
-  std::vector<double> hw_torques_;
-  std::vector<double> hw_effort_command_;
+  // State and command interfaces of the joints in one block, the members below are views into it
+  kuka_drivers_core::InterfaceStorage joint_storage_;
+  using JointValues = kuka_drivers_core::InterfaceStorage::Values;
+
+  JointValues hw_commands_;
+  JointValues hw_states_;
+  JointValues hw_torques_ext_;
+  JointValues hw_torques_;
+  JointValues hw_effort_command_;
+  // Values of the monitoring message exported for performance monitoring
+  JointValues hw_commanded_positions_;
+  JointValues hw_commanded_torques_;
+  JointValues hw_ipo_positions_;
+  // Forces along and torques around the A, B, C axes of the motion center, in wrench command mode
+  std::array<double, 6> hw_wrench_commands_{};
 
   struct RobotState
   {
@@ -125,9 +242,56 @@ private:
     double operation_mode_ = 0;
     double drive_state_ = 0;
     double overlay_type_ = 0;
+    double timestamp_sec_ = 0;
+    double timestamp_nanosec_ = 0;
+    double receive_latency_ = 0;
+    double state_stamp_ = 0;
+    double one_way_latency_ = 0;
+    double clock_drift_ = 0;
+    double round_trip_latency_ = 0;
+    double host_latency_ = 0;
+    double late_answers_ = 0;
   };
 
   RobotState robot_state_;
+  // Send time of the monitoring messages on the host clock, estimated from their timestamp
+  kuka_drivers_core::ClockSync clock_sync_{1e-9};
+
+  // The commands of the active client command mode
+  KUKA_SUNRISE_FRI_DRIVER_LOCAL const JointValues & interpolatedCommands() const
+  {
+    return robot_state_.command_mode_ == KUKA::FRI::EClientCommandMode::TORQUE ?
+           hw_effort_command_ : hw_commands_;
+  }
+
+  // Writes the interface and publishes the change, the value of the FRIStateEvent constant
+  //  state identifies the enum
+  template<typename EnumType>
+  void updateState(uint8_t state_id, double & state, EnumType value)
+  {
+    const double new_state = static_cast<double>(value);
+    if (state != new_state) {
+      if (state_events_ != nullptr) {
+        state_events_->Push(
+          state_id, static_cast<int32_t>(state), static_cast<int32_t>(new_state));
+      }
+      state = new_state;
+    }
+  }
+
+  // Allocates the joint interfaces, decoded into directly if the sizes match
+  KUKA_SUNRISE_FRI_DRIVER_LOCAL void allocateInterfaces(
+    const std::vector<std::string> & joint_names);
+  // Checks the GPIO component and maps its interfaces to the I/O of FRI
+  KUKA_SUNRISE_FRI_DRIVER_LOCAL bool configureGPIOs();
+  // Checks the command and state interfaces of the joints
+  KUKA_SUNRISE_FRI_DRIVER_LOCAL bool checkJointInterfaces();
+  // Adds the gauges, counters and histograms of the driver, if the metrics are exported
+  KUKA_SUNRISE_FRI_DRIVER_LOCAL void registerMetrics();
+  // Holds the position of the interpolator and restarts the filters at a command mode change
+  KUKA_SUNRISE_FRI_DRIVER_LOCAL void handOverCommands();
+  // Counts the FRI cycles, true in the cycles in which the controllers are sampled
+  KUKA_SUNRISE_FRI_DRIVER_LOCAL bool controllerCycle();
 
   KUKA_SUNRISE_FRI_DRIVER_LOCAL IOTypes getType(const std::string & type_string) const
   {
@@ -137,30 +301,60 @@ private:
     } else {throw InvalidGPIOTypeException(type_string);}
   }
 
+  // Resolves the name of an IO to its index in the monitoring message, which is kept until the
+  // next session or until the number of IOs in the message changes
+  class GPIOIndex
+  {
+public:
+    explicit GPIOIndex(const std::string & name)
+    : name_(name) {}
+    const std::string & getName() const {return name_;}
+    int get(const KUKA::FRI::LBRState & state)
+    {
+      const int io_count = state.getIOCount();
+      if (index_ < 0 || io_count != io_count_) {
+        index_ = state.getIOIndex(name_.c_str());
+        io_count_ = io_count;
+        if (index_ < 0) {
+          throw KUKA::FRI::FRIException("Could not locate IO %s in monitor message.", name_.c_str());
+        }
+      }
+      return index_;
+    }
+    void reset() {index_ = -1;}
+
+private:
+    const std::string name_;
+    int index_ = -1;
+    int io_count_ = 0;
+  };
+
   class GPIOReader
   {
 public:
     double & getData() {return data_;}
-    const std::string & getName() const {return name_;}
+    const std::string & getName() const {return index_.getName();}
     GPIOReader(const std::string & name, IOTypes type, const KUKA::FRI::LBRState & state)
-    : name_(name), type_(type), state_(state) {}
+    : index_(name), type_(type), state_(state) {}
     void getValue()
     {
+      const int index = index_.get(state_);
       switch (type_) {
         case IOTypes::ANALOG:
-          data_ = state_.getAnalogIOValue(name_.c_str());
+          data_ = state_.getAnalogIOValue(index);
           break;
         case IOTypes::DIGITAL:
-          data_ = static_cast<double>(state_.getDigitalIOValue(name_.c_str()));
+          data_ = static_cast<double>(state_.getDigitalIOValue(index));
           break;
         case IOTypes::BOOLEAN:
-          data_ = state_.getBooleanIOValue(name_.c_str());
+          data_ = state_.getBooleanIOValue(index);
           break;
       }
     }
+    void resetIndex() {index_.reset();}
 
 private:
-    const std::string name_;
+    GPIOIndex index_;
     IOTypes type_;
     const KUKA::FRI::LBRState & state_;
     double data_;
@@ -170,34 +364,61 @@ private:
   {
 public:
     double & getData() {return data_;}
-    const std::string & getName() const {return name_;}
+    const std::string & getName() const {return index_.getName();}
     GPIOWriter(
       const std::string & name, IOTypes type, KUKA::FRI::LBRCommand & command,
-      double initial_value)
-    : name_(name), type_(type), command_(command), data_(initial_value) {}
-    void setValue()
+      const KUKA::FRI::LBRState & state, double initial_value)
+    : index_(name), type_(type), command_(command), state_(state), data_(initial_value) {}
+    // Writes the output through its slot of the command message if it changed or refresh is set
+    void setValue(int slot, bool refresh)
     {
-      switch (type_) {
-        case IOTypes::ANALOG:
-          command_.setAnalogIOValue(name_.c_str(), data_);
-          break;
-        case IOTypes::DIGITAL:
-          command_.setDigitalIOValue(name_.c_str(), static_cast<uint64_t>(data_));
-          break;
-        case IOTypes::BOOLEAN:
-          command_.setBooleanIOValue(name_.c_str(), static_cast<bool>(data_));
-          break;
+      const int index = index_.get(state_);
+      // The write request is built once for the index of the IO in the monitoring message
+      if (index != slot_index_) {
+        switch (type_) {
+          case IOTypes::ANALOG:
+            command_.prepareAnalogIOSlot(slot, index);
+            break;
+          case IOTypes::DIGITAL:
+            command_.prepareDigitalIOSlot(slot, index);
+            break;
+          case IOTypes::BOOLEAN:
+            command_.prepareBooleanIOSlot(slot, index);
+            break;
+        }
+        slot_index_ = index;
+        refresh = true;
       }
+      if (refresh || data_ != sent_data_) {
+        command_.setIOSlotValue(slot, data_);
+        sent_data_ = data_;
+      }
+    }
+    void resetIndex()
+    {
+      index_.reset();
+      slot_index_ = -1;
     }
 
 private:
-    const std::string name_;
+    GPIOIndex index_;
     IOTypes type_;
     KUKA::FRI::LBRCommand & command_;
+    const KUKA::FRI::LBRState & state_;
     double data_;
+    // Index the slot was prepared for and the value sent last
+    int slot_index_ = -1;
+    double sent_data_ = 0;
   };
 
+  // The robot keeps the outputs, unchanged ones are repeated after this many commands in case a
+  //  command message was lost
+  static constexpr int GPIO_REFRESH_COMMANDS = 100;
+
+  KUKA_SUNRISE_FRI_DRIVER_LOCAL void resetGPIOIndices();
+
   std::vector<GPIOWriter> gpio_inputs_;
+  int gpio_refresh_counter_ = 0;
   std::vector<GPIOReader> gpio_outputs_;
 };
 }  // namespace kuka_sunrise_fri_driver
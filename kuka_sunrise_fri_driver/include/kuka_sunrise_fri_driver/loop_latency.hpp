@@ -0,0 +1,161 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_SUNRISE_FRI_DRIVER__LOOP_LATENCY_HPP_
+#define KUKA_SUNRISE_FRI_DRIVER__LOOP_LATENCY_HPP_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "rclcpp/rclcpp.hpp"
+#include "diagnostic_msgs/msg/diagnostic_array.hpp"
+
+#include "kuka_drivers_core/latency_histogram.hpp"
+
+namespace kuka_sunrise_fri_driver
+{
+/**
+ * @brief Measures the loop between the monitoring messages and the commands answering them
+ *
+ * The send time of every command is kept in a small ring by its sequence counter, together with
+ *  the arrival and the controller timestamp of the monitoring message it answers. The monitoring
+ *  messages reflect the sequence counter of the last command the controller received, the first
+ *  one reflecting a command closes its loop:
+ *  - the host latency is the time from the arrival of the answered message to the send of the
+ *    command, spent in the driver and in the controllers
+ *  - the round trip is the time on the controller clock from the answered message to the first
+ *    message reflecting the command, the loop the robot sees. It is one send period if the
+ *    command arrived in time, a command reflected by a later message than the next one is late
+ *  A late command with a small host latency was delayed by the network.
+ *
+ * OnSend() and OnMonitoring() are called from the control loop, they only touch the ring and the
+ *  lock-free histograms, which can be read from any thread.
+ */
+class LoopLatency
+{
+public:
+  static constexpr std::size_t RING_SIZE = 64;
+
+  // 50 us buckets up to 100 ms, the longest send period
+  using RoundTripHistogram = kuka_drivers_core::LatencyHistogram<2000, 50000>;
+  // 10 us buckets up to 10 ms
+  using HostHistogram = kuka_drivers_core::LatencyHistogram<1000, 10000>;
+
+  struct Sample
+  {
+    int64_t round_trip_ns;
+    int64_t host_ns;
+    bool late;
+  };
+
+  /**
+   * @brief Called after a command was sent
+   * @param command_counter: sequence counter of the command
+   * @param send_ns: send time of the command on the steady clock
+   * @param answered_counter: sequence counter of the monitoring message answered by the command
+   * @param answered_arrival_ns: arrival of that message on the steady clock
+   * @param answered_robot_ns: controller timestamp of that message
+   */
+  void OnSend(
+    uint32_t command_counter, int64_t send_ns, uint32_t answered_counter,
+    int64_t answered_arrival_ns, int64_t answered_robot_ns);
+
+  /**
+   * @brief Called for every monitoring message
+   * @returns true with the measurement in sample if the message is the first one reflecting a
+   *  command of the ring
+   */
+  bool OnMonitoring(uint32_t counter, uint32_t reflected_counter, int64_t robot_ns, Sample & sample);
+
+  // Forgets the commands of the last session, the histograms are kept
+  void Reset();
+
+  uint64_t LateAnswers() const {return late_answers_.load(std::memory_order_relaxed);}
+  const RoundTripHistogram & RoundTrip() const {return round_trip_;}
+  const HostHistogram & Host() const {return host_;}
+
+private:
+  struct Entry
+  {
+    uint32_t command_counter = 0;
+    uint32_t answered_counter = 0;
+    int64_t send_ns = 0;
+    int64_t answered_arrival_ns = 0;
+    int64_t answered_robot_ns = 0;
+    bool pending = false;
+  };
+
+  std::array<Entry, RING_SIZE> ring_;
+  RoundTripHistogram round_trip_;
+  HostHistogram host_;
+  std::atomic<uint64_t> late_answers_{0};
+};
+
+/**
+ * @brief Publishes the percentiles of the loop latency on /diagnostics, from its own thread and
+ *  node
+ *
+ * The status is a warning if a command was late or the 99th percentile of the host latency
+ *  exceeded the threshold in the last period.
+ */
+class LoopLatencyDiagnostics
+{
+public:
+  LoopLatencyDiagnostics(
+    const std::string & hardware_name, const LoopLatency & loop_latency,
+    std::chrono::microseconds warning_threshold,
+    std::chrono::milliseconds publish_period = std::chrono::milliseconds(1000));
+  ~LoopLatencyDiagnostics();
+
+  LoopLatencyDiagnostics(const LoopLatencyDiagnostics &) = delete;
+  LoopLatencyDiagnostics & operator=(const LoopLatencyDiagnostics &) = delete;
+
+private:
+  void publishLoop();
+
+  std::string hardware_name_;
+  const LoopLatency & loop_latency_;
+  std::chrono::microseconds warning_threshold_;
+  std::chrono::milliseconds publish_period_;
+
+  rclcpp::Node::SharedPtr node_;
+  rclcpp::Publisher<diagnostic_msgs::msg::DiagnosticArray>::SharedPtr publisher_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool terminate_ = false;
+  std::thread publish_thread_;
+};
+
+/**
+ * @brief Creates the diagnostics if the loop_latency_diagnostics hardware parameter is 'true',
+ *  the warning threshold is given by loop_latency_warning_threshold_us (default: 500)
+ * @returns false with the reason in error if the parameters are invalid
+ */
+bool ConfigureLoopLatencyDiagnostics(
+  const std::unordered_map<std::string, std::string> & parameters,
+  const std::string & hardware_name, const LoopLatency & loop_latency,
+  std::unique_ptr<LoopLatencyDiagnostics> & diagnostics, std::string & error);
+}  // namespace kuka_sunrise_fri_driver
+
+#endif  // KUKA_SUNRISE_FRI_DRIVER__LOOP_LATENCY_HPP_
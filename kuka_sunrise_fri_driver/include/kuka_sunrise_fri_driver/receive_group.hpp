@@ -0,0 +1,163 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_SUNRISE_FRI_DRIVER__RECEIVE_GROUP_HPP_
+#define KUKA_SUNRISE_FRI_DRIVER__RECEIVE_GROUP_HPP_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "fri_client_sdk/friConnectionIf.h"
+#include "fri_client_sdk/friUdpConnection.h"
+#include "kuka_drivers_core/io_thread.hpp"
+#include "kuka_drivers_core/triple_buffer.hpp"
+
+namespace kuka_sunrise_fri_driver
+{
+/**
+ * @brief Receive thread shared by the FRI hardware interfaces of one process
+ *
+ * The sessions of several robots are not synchronized, so the sequential reads of the control
+ * loop would each block until the message of their own robot arrives. The thread of the group
+ * waits on the sockets of all members at once, and hands the messages of a cycle over together:
+ * when every member received a new message, or when the gather timeout has passed since the
+ * first one. Groups are shared by name within the process.
+ */
+class ReceiveGroup
+{
+public:
+  static constexpr std::size_t kMaxMembers = 4;
+  // Equal to FRI_MONITOR_MSG_MAX_SIZE
+  static constexpr int kMaxMessageSize = 1500;
+
+  // Returns the group with the given name, which is created if it does not exist yet
+  static std::shared_ptr<ReceiveGroup> get(const std::string & name);
+
+  ReceiveGroup() = default;
+  ~ReceiveGroup();
+
+  ReceiveGroup(const ReceiveGroup &) = delete;
+  ReceiveGroup & operator=(const ReceiveGroup &) = delete;
+
+  // Time to wait for the other members after the first message of a cycle
+  void setGatherTimeout(std::chrono::microseconds timeout) {gather_timeout_ = timeout;}
+  std::chrono::microseconds gatherTimeout() const {return gather_timeout_.load();}
+
+  /**
+   * @brief Add an open connection, the thread is started with the first member
+   * @returns the index of the member, or -1 if the group is full
+   */
+  int join(KUKA::FRI::UdpConnection & connection);
+
+  // Remove the member, the thread is stopped after the last one
+  void leave(int member);
+
+  /**
+   * @brief Wait for the next message of the member, called by its control loop
+   * @returns the size of the message, or -1 if the member left the group in the meantime
+   */
+  int receive(int member, char * buffer, int max_size);
+
+private:
+  struct Member
+  {
+    KUKA::FRI::UdpConnection * connection = nullptr;
+    // Only accessed by the thread of the group
+    std::array<char, kMaxMessageSize> pending;
+    int pending_size = 0;
+    // Handed over to the control loop
+    std::array<char, kMaxMessageSize> ready;
+    int ready_size = 0;
+  };
+
+  void run();
+  void receiveMessages(const bool * readable);
+  void handOver();
+
+  // Serializes join() and leave()
+  std::mutex membership_mutex_;
+  // Protects the members, held while receiving, never while waiting
+  std::mutex mutex_;
+  std::condition_variable ready_cv_;
+  std::array<Member, kMaxMembers> members_;
+  std::chrono::steady_clock::time_point first_pending_;
+  std::atomic<std::chrono::microseconds> gather_timeout_{std::chrono::microseconds(500)};
+  std::atomic<bool> running_{false};
+  std::thread thread_;
+};
+
+/**
+ * @brief Connection of the client application, receiving through a group if it is set
+ *
+ * With the I/O thread, the connection is read by its own thread instead, which keeps the newest
+ *  message in a triple buffer, receive() takes it over without waiting. The messages are
+ *  decoded by the client application in read(), whose callbacks are bound to its state.
+ * The messages are sent directly through the UDP connection.
+ */
+class GroupedConnection : public KUKA::FRI::IConnection
+{
+public:
+  explicit GroupedConnection(KUKA::FRI::UdpConnection & connection)
+  : connection_(connection) {}
+  ~GroupedConnection() override;
+
+  // Must be called before open(), without a group the connection receives directly
+  void setGroup(std::shared_ptr<ReceiveGroup> group) {group_ = std::move(group);}
+
+  // Must be called before open(), the connection is read by an I/O thread if enabled
+  void setIOThread(const kuka_drivers_core::IOThread::Options & options)
+  {
+    io_thread_options_ = options;
+  }
+
+  // A message was received by the I/O thread or the thread failed, receive() returns at once
+  bool ready() const {return datagrams_.Fresh() || !io_thread_.Running();}
+
+  // Arrival of the message returned by the last receive() of the I/O thread
+  std::chrono::steady_clock::time_point lastArrival() const {return datagrams_.Front().arrival;}
+
+  bool open(int port, const char * remote_host) override;
+  void close() override;
+  bool isOpen() const override {return connection_.isOpen();}
+  int receive(char * buffer, int max_size) override;
+  bool send(const char * buffer, int size) override {return connection_.send(buffer, size);}
+
+private:
+  struct Datagram
+  {
+    std::array<char, ReceiveGroup::kMaxMessageSize> data;
+    int size;
+    std::chrono::steady_clock::time_point arrival;
+  };
+
+  // Runs on io_thread_, waits for the next message of the connection
+  bool receiveOnIOThread();
+
+  KUKA::FRI::UdpConnection & connection_;
+  std::shared_ptr<ReceiveGroup> group_;
+  int member_ = -1;
+  kuka_drivers_core::IOThread::Options io_thread_options_;
+  kuka_drivers_core::TripleBuffer<Datagram> datagrams_;
+  kuka_drivers_core::IOThread io_thread_;
+};
+}  // namespace kuka_sunrise_fri_driver
+
+#endif  // KUKA_SUNRISE_FRI_DRIVER__RECEIVE_GROUP_HPP_
@@ -16,6 +16,7 @@
 #define KUKA_SUNRISE_FRI_DRIVER__ROBOT_MANAGER_NODE_HPP_
 
 #include <atomic>
+#include <functional>
 #include <memory>
 #include <string>
 
@@ -25,8 +26,13 @@
 #include "std_msgs/msg/bool.hpp"
 #include "controller_manager_msgs/srv/set_hardware_component_state.hpp"
 #include "controller_manager_msgs/srv/switch_controller.hpp"
+#include "diagnostic_msgs/msg/diagnostic_status.hpp"
+#include "kuka_driver_interfaces/msg/fri_state_event.hpp"
 
 #include "kuka_drivers_core/ros2_base_lc_node.hpp"
+#include "kuka_drivers_core/startup_profile.hpp"
+#include "kuka_drivers_core/switch_trace.hpp"
+#include "kuka_drivers_core/tracing.hpp"
 
 #include "kuka_sunrise_fri_driver/fri_connection.hpp"
 #include "kuka_sunrise_fri_driver/configuration_manager.hpp"
@@ -37,7 +43,7 @@ namespace kuka_sunrise_fri_driver
 class RobotManagerNode : public kuka_drivers_core::ROS2BaseLCNode
 {
 public:
-  RobotManagerNode();
+  explicit RobotManagerNode(const rclcpp::NodeOptions & options = rclcpp::NodeOptions());
 
   virtual rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn
   on_configure(const rclcpp_lifecycle::State &);
@@ -57,21 +63,45 @@ public:
 private:
   std::shared_ptr<FRIConnection> fri_connection_;
   std::unique_ptr<ConfigurationManager> configuration_manager_;
+  // Phases of the mode switches, started by the configuration manager
+  std::shared_ptr<kuka_drivers_core::SwitchTrace> switch_trace_;
+  kuka_drivers_core::StartupProfile startup_profile_{"robot_manager"};
+  rclcpp::Publisher<diagnostic_msgs::msg::DiagnosticStatus>::SharedPtr startup_profile_pub_;
   rclcpp::Client<std_srvs::srv::Trigger>::SharedPtr set_parameter_client_;
   rclcpp::Client<controller_manager_msgs::srv::SetHardwareComponentState>::SharedPtr
     change_hardware_state_client_;
   rclcpp::Client<controller_manager_msgs::srv::SwitchController>::SharedPtr
     change_controller_state_client_;
   rclcpp::CallbackGroup::SharedPtr cbg_;
+  // The events are handled next to the service calls of the transitions they can trigger
+  rclcpp::CallbackGroup::SharedPtr event_cbg_;
+  rclcpp::Subscription<kuka_driver_interfaces::msg::FRIStateEvent>::SharedPtr state_event_sub_;
   rclcpp_lifecycle::LifecyclePublisher<std_msgs::msg::Bool>::SharedPtr
     command_state_changed_publisher_;
   std::shared_ptr<rclcpp_lifecycle::LifecyclePublisher<std_msgs::msg::Bool>> is_configured_pub_;
   std_msgs::msg::Bool is_configured_msg_;
   std::string controller_name_;
   std::string robot_model_;
-
+  // Set at activation, no controllers are active and control is not activated
+  bool monitoring_only_ = false;
+  // The end of the session is expected while it is restarted with a new timing
+  std::atomic<bool> restarting_session_{false};
+
+  // The transitions of a bring-up, on_configure() and on_activate() profile them
+  rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn configure();
+  rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn activate();
+  // Logs the profile of the bring-up and publishes it on ~/startup_profile
+  void publishStartupProfile(bool successful);
+  // Changes the command mode in active state, keeping the FRI session
+  bool switchCommandMode(
+    const FRIConnection::Command & command, const std::string & controller_name);
+  // Restarts the FRI session with a new timing in active state, see ConfigurationManager
+  bool restartFRISession(
+    int send_period_ms, int receive_multiplier, const std::function<bool()> & retime_hardware);
   void handleControlEndedError();
   void handleFRIEndedError();
+  // Changes of the FRI state published by the hardware interface in the cycle they happened
+  void onStateEvent(const kuka_driver_interfaces::msg::FRIStateEvent::SharedPtr event);
   bool onRobotModelChangeRequest(const std::string & robot_model);
 };
 
@@ -0,0 +1,82 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_SUNRISE_FRI_DRIVER__STATE_EVENT_PUBLISHER_HPP_
+#define KUKA_SUNRISE_FRI_DRIVER__STATE_EVENT_PUBLISHER_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+#include "kuka_driver_interfaces/msg/fri_state_event.hpp"
+#include "rclcpp/rclcpp.hpp"
+#include "kuka_drivers_core/spsc_queue.hpp"
+
+namespace kuka_sunrise_fri_driver
+{
+/**
+ * @brief Publishes the changes of the FRI state enums (session, safety, drive state etc.)
+ *
+ * The control loop pushes a change into a lock-free queue in the cycle it was decoded, without
+ * locks, allocations or system calls. A separate thread with its own node publishes every event
+ * as FRIStateEvent, so that e.g. the robot manager can react to the end of the commanding state
+ * or a safety stop right away instead of polling the state interfaces.
+ */
+class StateEventPublisher
+{
+public:
+  /**
+   * @param node_name: name of the node of the publisher thread
+   * @param topic: topic of the events
+   */
+  StateEventPublisher(const std::string & node_name, const std::string & topic);
+  ~StateEventPublisher();
+
+  StateEventPublisher(const StateEventPublisher &) = delete;
+  StateEventPublisher & operator=(const StateEventPublisher &) = delete;
+
+  /**
+   * @brief Called from the control loop on a change
+   * @param state: one of the constants of FRIStateEvent, e.g. SESSION_STATE
+   */
+  void Push(uint8_t state, int32_t old_value, int32_t new_value);
+
+  // Number of events not taken over by the publisher thread in time
+  uint64_t Dropped() const {return dropped_.load(std::memory_order_relaxed);}
+
+private:
+  struct Event
+  {
+    // CLOCK_REALTIME time of the change
+    int64_t stamp_ns;
+    uint8_t state;
+    int32_t old_value;
+    int32_t new_value;
+  };
+
+  void PublishLoop();
+
+  kuka_drivers_core::SPSCQueue<Event, 64> queue_;
+  std::atomic<uint64_t> dropped_{0};
+
+  rclcpp::Node::SharedPtr node_;
+  rclcpp::Publisher<kuka_driver_interfaces::msg::FRIStateEvent>::SharedPtr publisher_;
+
+  std::atomic<bool> terminate_{false};
+  std::thread publish_thread_;
+};
+}  // namespace kuka_sunrise_fri_driver
+
+#endif  // KUKA_SUNRISE_FRI_DRIVER__STATE_EVENT_PUBLISHER_HPP_
@@ -0,0 +1,92 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_SUNRISE_FRI_DRIVER__STATE_RECORDER_HPP_
+#define KUKA_SUNRISE_FRI_DRIVER__STATE_RECORDER_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#include "kuka_drivers_core/spsc_queue.hpp"
+
+#include "fri_client_sdk/friLBRState.h"
+
+namespace kuka_sunrise_fri_driver
+{
+/**
+ * @brief Records the robot state of every FRI cycle into a CSV file
+ *
+ * The control loop only copies the sample into a lock-free ring, a separate thread writes the
+ * queued samples to the file. If the writer cannot keep up, the samples are dropped and
+ * counted instead of blocking the control loop.
+ */
+class StateRecorder
+{
+public:
+  static constexpr std::size_t kJoints = KUKA::FRI::LBRState::NUMBER_OF_JOINTS;
+  // Number of slots, about 4 seconds of samples with a 1 ms send period
+  static constexpr std::size_t kCapacity = 4096;
+
+  struct Sample
+  {
+    // CLOCK_REALTIME (system_clock) time of the reception
+    int64_t receive_time_ns;
+    uint32_t timestamp_sec;
+    uint32_t timestamp_nanosec;
+    int32_t session_state;
+    int32_t connection_quality;
+    double position[kJoints];
+    double torque[kJoints];
+    double external_torque[kJoints];
+  };
+
+  StateRecorder() = default;
+  ~StateRecorder();
+
+  StateRecorder(const StateRecorder &) = delete;
+  StateRecorder & operator=(const StateRecorder &) = delete;
+
+  // Creates (or overwrites) the file and writes the header, returns false on error
+  bool open(const std::string & path);
+
+  bool enabled() const {return file_ != nullptr;}
+
+  // Starts and stops the writer thread
+  void start();
+  void stop();
+
+  // Called by the control loop
+  void record(const Sample & sample)
+  {
+    if (!samples_.Push(sample)) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+private:
+  void writeSamples();
+
+  std::FILE * file_ = nullptr;
+  kuka_drivers_core::SPSCQueue<Sample, kCapacity> samples_;
+  std::atomic<std::size_t> dropped_{0};
+  std::atomic<bool> running_{false};
+  std::thread writer_thread_;
+};
+}  // namespace kuka_sunrise_fri_driver
+
+#endif  // KUKA_SUNRISE_FRI_DRIVER__STATE_RECORDER_HPP_
@@ -18,44 +18,69 @@
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <unistd.h>
-#include <pthread.h>
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <stdexcept>
 #include <string>
-#include <functional>
+#include <thread>
 #include <vector>
-#include <atomic>
 
 namespace kuka_sunrise_fri_driver
 {
 
+/**
+ * @brief TCP client of the control channel of the robot application
+ *
+ * The messages in both directions are prefixed with their length as an unsigned 16 bit
+ * big-endian integer. They are received by one event loop thread into a fixed buffer and passed
+ * to the callback without copying, the data is only valid during the call.
+ */
 class TCPConnection
 {
 public:
+  // Longest message that can be sent or received, longer received ones are skipped
+  static constexpr std::size_t kMaxMessageSize = 1022;
+
   TCPConnection(
     const char * server_addr, const int server_port,
-    std::function<void(const std::vector<std::uint8_t> &)> data_received_callback,
+    std::function<void(const std::uint8_t * data, std::size_t size)> data_received_callback,
     std::function<void(const char * server_addr, const int server_port)> connection_lost_callback);
 
   bool sendByte(std::uint8_t data);
   bool sendBytes(const std::vector<std::uint8_t> & data);
+  // Sends the data as one message
+  bool sendMessage(const std::uint8_t * data, std::size_t size);
+  // Stops and joins the event loop, must not be called from the callbacks
   void closeConnection();
 
   ~TCPConnection();
   TCPConnection(const TCPConnection &) = delete;
   TCPConnection & operator=(const TCPConnection &) = delete;
-  TCPConnection & operator=(TCPConnection && from);
 
 private:
-  static void * listen_helper(void * tcpConnection);
+  static constexpr std::size_t kHeaderSize = 2;
+
   void listen();
-  std::function<void(const std::vector<std::uint8_t> &)> dataReceivedCallback_;
+  // Passes the complete messages of the buffer to the callback and keeps the rest
+  void dispatchMessages();
+
+  std::function<void(const std::uint8_t *, std::size_t)> dataReceivedCallback_;
   std::function<void(const char *, int)> connectionLostCallback_;
 
   int socket_desc_;
+  // Written by closeConnection() to wake up the event loop
+  int wakeup_pipe_[2] = {-1, -1};
   struct sockaddr_in server_;
-  pthread_t read_thread_;
+  std::thread read_thread_;
   std::atomic_bool cancelled_;
+
+  std::uint8_t buffer_[kHeaderSize + kMaxMessageSize];
+  std::size_t buffered_ = 0;
+  // Remaining bytes of a message that does not fit into the buffer
+  std::size_t discarded_ = 0;
 };
 
 }  // namespace kuka_sunrise_fri_driver
@@ -17,7 +17,8 @@ from ament_index_python.packages import get_package_share_directory
 from launch import LaunchDescription
 from launch.actions import DeclareLaunchArgument, OpaqueFunction
 from launch.substitutions import Command, FindExecutable, PathJoinSubstitution, LaunchConfiguration
-from launch_ros.actions import Node, LifecycleNode
+from launch_ros.actions import LifecycleNode, LoadComposableNodes, Node
+from launch_ros.descriptions import ComposableNode
 from launch_ros.substitutions import FindPackageShare
 
 
@@ -45,26 +46,48 @@ def launch_setup(context, *args, **kwargs):
 
     joint_traj_controller_config = (get_package_share_directory('kuka_sunrise_fri_driver') +
                                     "/config/joint_trajectory_controller_config.yaml")
+    wrench_controller_config = (get_package_share_directory('kuka_sunrise_fri_driver') +
+                                "/config/wrench_controller_config.yaml")
 
     driver_config = (get_package_share_directory('kuka_sunrise_fri_driver') +
                      "/config/driver_config.yaml")
 
     controller_manager_node = '/controller_manager'
+    composable = LaunchConfiguration('composable').perform(context) == 'true'
 
     control_node = Node(
         package='kuka_drivers_core',
         executable='control_node',
-        parameters=[robot_description, controller_config]
-    )
-    robot_manager_node = LifecycleNode(
-        name=['robot_manager'],
-        namespace='',
-        package="kuka_sunrise_fri_driver",
-        executable="robot_manager_node",
-        parameters=[driver_config, {'robot_model': robot_model.perform(context)},
-                    {'position_controller_name': 'joint_trajectory_controller'},
-                    {'torque_controller_name': ''}]
+        parameters=[robot_description, controller_config,
+                    {'component_container': composable}]
     )
+    if composable:
+        # Loaded into the process of the control node, the topics are passed within the process
+        robot_manager_node = LoadComposableNodes(
+            target_container='/control_container',
+            composable_node_descriptions=[ComposableNode(
+                package='kuka_sunrise_fri_driver',
+                plugin='kuka_sunrise_fri_driver::RobotManagerNode',
+                name='robot_manager',
+                namespace='',
+                parameters=[driver_config, {'robot_model': robot_model.perform(context)},
+                            {'position_controller_name': 'joint_trajectory_controller'},
+                            {'torque_controller_name': ''},
+                            {'wrench_controller_name': 'wrench_controller'}],
+                extra_arguments=[{'use_intra_process_comms': True}]
+            )]
+        )
+    else:
+        robot_manager_node = LifecycleNode(
+            name=['robot_manager'],
+            namespace='',
+            package="kuka_sunrise_fri_driver",
+            executable="robot_manager_node",
+            parameters=[driver_config, {'robot_model': robot_model.perform(context)},
+                        {'position_controller_name': 'joint_trajectory_controller'},
+                        {'torque_controller_name': ''},
+                        {'wrench_controller_name': 'wrench_controller'}]
+        )
     robot_state_publisher = Node(
         package='robot_state_publisher',
         executable='robot_state_publisher',
@@ -84,6 +107,7 @@ def launch_setup(context, *args, **kwargs):
     controller_names_and_config = [
         ("joint_state_broadcaster", []),
         ("joint_trajectory_controller", joint_traj_controller_config),
+        ("wrench_controller", wrench_controller_config),
         ("fri_configuration_controller", []),
         ("fri_state_broadcaster", [])
     ]
@@ -106,4 +130,8 @@ def generate_launch_description():
         'robot_model',
         default_value='lbr_iiwa14_r820'
     ))
+    launch_arguments.append(DeclareLaunchArgument(
+        'composable',
+        default_value="false"
+    ))
     return LaunchDescription(launch_arguments + [OpaqueFunction(function=launch_setup)])
@@ -209,13 +209,7 @@ public class FRIManager{
 		}
 		@Override
 		public CommandResult activateControl(){
-			FRIJointOverlay friJointOverlay = 
-					new FRIJointOverlay(FRIManager.this._FRISession, FRIManager.this._clientCommandMode);
-			//friJointOverlay.overrideJointAcceleration(20.0);
-			PositionHold motion = 
-					new PositionHold(FRIManager.this._controlMode, -1, null);
-			FRIManager.this._motionContainer = 
-					FRIManager.this._lbr.moveAsync(motion.addMotionOverlay(friJointOverlay));
+			FRIManager.this.startOverlay();
 			return CommandResult.EXECUTED;
 		}
 		@Override
@@ -236,6 +230,28 @@ public class FRIManager{
 			FRIManager.this._motionContainer.cancel();
 			return CommandResult.EXECUTED;
 		}
+		/* The command mode of an overlay is fixed, the overlay is restarted with the new mode
+		 * in the running FRI session, without ending it */
+		@Override
+		public CommandResult setCommandMode(ClientCommandMode clientCommandMode){
+			if(clientCommandMode == FRIManager.this._clientCommandMode){
+				return CommandResult.EXECUTED;
+			}
+			FRIManager.this._motionContainer.cancel();
+			FRIManager.this._clientCommandMode = clientCommandMode;
+			FRIManager.this.startOverlay();
+			return CommandResult.EXECUTED;
+		}
+	}
+	
+	private void startOverlay(){
+		FRIJointOverlay friJointOverlay = 
+				new FRIJointOverlay(_FRISession, _clientCommandMode);
+		//friJointOverlay.overrideJointAcceleration(20.0);
+		PositionHold motion = 
+				new PositionHold(_controlMode, -1, null);
+		_motionContainer = 
+				_lbr.moveAsync(motion.addMotionOverlay(friJointOverlay));
 	}
 	
 	private class FRIMotionErrorHandler implements IErrorHandler{
@@ -95,11 +95,16 @@ public class TCPConnection{
 		}
 	}
 	
-	public void sendBytes(byte[] message){
+	// Messages are prefixed with their length as an unsigned short, as the client expects
+	public synchronized void sendBytes(byte[] message){
 		if(_tcpClient != null && _tcpClient.isConnected() && !_tcpClient.isClosed()){
 			try{
+				byte[] frame = new byte[message.length + 2];
+				frame[0] = (byte)((message.length >> 8) & 0xFF);
+				frame[1] = (byte)(message.length & 0xFF);
+				System.arraycopy(message, 0, frame, 2, message.length);
 				DataOutputStream outToClient = new DataOutputStream(_tcpClient.getOutputStream());
-				outToClient.write(message);
+				outToClient.write(frame);
 				//outToClient.close();
 			}catch(IOException e){
 				e.printStackTrace();
@@ -147,13 +152,19 @@ public class TCPConnection{
 		System.out.println("Connection established.");
 	}
 	
+	// Messages are prefixed with their length as an unsigned short, several commands may be
+	// received back to back. They are handled in order, so the replies keep the same order.
 	private void handleIncomingData() throws IOException{
-		BufferedReader inFromClient = new BufferedReader(new InputStreamReader(_tcpClient.getInputStream()));
+		DataInputStream inFromClient = new DataInputStream(new BufferedInputStream(_tcpClient.getInputStream()));
 		while(_tcpClient.isClosed() == false){
-			int dataLength = -2;
-			char[] charArray = new char[1024];
+			byte[] byteArray = null;
 			try{
-				dataLength = inFromClient.read(charArray);
+				int dataLength = inFromClient.readUnsignedShort();
+				byteArray = new byte[dataLength];
+				inFromClient.readFully(byteArray);
+			} catch (EOFException e) {
+				_ROS2Connection.handleConnectionLost();
+				break;
 			} catch (SocketException e) {
 				if(_closeRequested){
 					break;
@@ -162,23 +173,11 @@ public class TCPConnection{
 					throw e;
 				}
 			}
-			if(dataLength < 0){
-				_ROS2Connection.handleConnectionLost();
-				break;
-			}
 
-			byte[] byteArray = Arrays.copyOf(new String(charArray).getBytes(), dataLength);
-			String byteHexString = DatatypeConverter.printHexBinary(byteArray);
-			
-			if(_incomingData != null){
-				System.out.println("ERROR: Previous data not yet processed! Skipping data: " + byteHexString);
-			}
-			else{
-				_incomingData = byteArray;
-				//System.out.println("New data received: " + byteHexString + ", " + _incomingData);
-				_ROS2Connection.handleMessageFromROS(_incomingData);
-				_incomingData = null;
-			}
+			_incomingData = byteArray;
+			//System.out.println("New data received: " + DatatypeConverter.printHexBinary(byteArray));
+			_ROS2Connection.handleMessageFromROS(_incomingData);
+			_incomingData = null;
 		}
 	}
 	
@@ -0,0 +1,58 @@
+package ros2.serialization;
+
+import java.io.Externalizable;
+import java.io.IOException;
+import java.io.ObjectInput;
+import java.io.ObjectOutput;
+
+import com.kuka.roboticsAPI.geometricModel.CartDOF;
+import com.kuka.roboticsAPI.motionModel.controlModeModel.CartesianImpedanceControlMode;
+import com.kuka.roboticsAPI.motionModel.controlModeModel.IMotionControlMode;
+
+public class CartesianImpedanceControlModeExternalizable extends CartesianImpedanceControlMode implements Externalizable{
+
+	public final static int length = 96;
+	
+	private static final CartDOF[] DOFS = {CartDOF.X, CartDOF.Y, CartDOF.Z, CartDOF.A, CartDOF.B, CartDOF.C};
+	
+	private double[] _stiffness = {2000, 2000, 2000, 200, 200, 200};
+	private double[] _damping = {0.7, 0.7, 0.7, 0.7, 0.7, 0.7};
+	
+	public CartesianImpedanceControlModeExternalizable(){
+		super();
+		applyParameters();
+	}
+	
+	public IMotionControlMode toControlMode(){
+		return (IMotionControlMode)this;
+	}
+	
+	private void applyParameters(){
+		for(int i = 0; i < DOFS.length; i++){
+			parametrize(DOFS[i]).setStiffness(_stiffness[i]).setDamping(_damping[i]);
+		}
+	}
+	
+	@Override
+	public void writeExternal(ObjectOutput out) throws IOException {
+		for(double cartesianStiffness : _stiffness){
+			out.writeDouble(cartesianStiffness);
+		}
+		for(double cartesianDamping : _damping){
+			out.writeDouble(cartesianDamping);
+		}
+	}
+
+	@Override
+	public void readExternal(ObjectInput in) throws IOException,
+			ClassNotFoundException {
+		for(int i = 0; i < _stiffness.length; i++){
+			_stiffness[i] = in.readDouble();
+		}
+		for(int i = 0; i < _damping.length; i++){
+			_damping[i] = in.readDouble();
+		}
+		applyParameters();
+	}
+
+}
@@ -0,0 +1,579 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <pb_decode.h>
+#include <pb_encode.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "communication_helpers/serialization.hpp"
+#include "kuka_sunrise_fri_driver/fri_connection.hpp"
+
+#include "fri_simulator.hpp"
+
+namespace kuka_sunrise_fri_driver
+{
+namespace
+{
+constexpr std::size_t kMessageSize = 1500;
+// Message identifiers of the LBR, protected members of LBRState and LBRCommand
+constexpr uint32_t kMonitoringMessageId = 0x245142;
+constexpr uint32_t kCommandMessageId = 0x34001;
+
+timespec toTimespec(std::chrono::steady_clock::time_point time_point)
+{
+  const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    time_point.time_since_epoch()).count();
+  timespec ts;
+  ts.tv_sec = static_cast<time_t>(ns / 1000000000);
+  ts.tv_nsec = static_cast<long>(ns % 1000000000);  // NOLINT(runtime/int)
+  return ts;
+}
+
+// steady_clock is CLOCK_MONOTONIC on Linux
+void sleepUntil(std::chrono::steady_clock::time_point time_point)
+{
+  const timespec ts = toTimespec(time_point);
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+  }
+}
+
+const char * stateName(FRISessionState state)
+{
+  switch (state) {
+    case FRISessionState_MONITORING_WAIT: return "MONITORING_WAIT";
+    case FRISessionState_MONITORING_READY: return "MONITORING_READY";
+    case FRISessionState_COMMANDING_WAIT: return "COMMANDING_WAIT";
+    case FRISessionState_COMMANDING_ACTIVE: return "COMMANDING_ACTIVE";
+    case FRISessionState_IDLE:
+    default: return "IDLE";
+  }
+}
+}  // namespace
+
+FRISimulator::FRISimulator(const Config & config)
+: config_(config), send_period_ms_(std::max(config.send_period_ms, 1)),
+  receive_multiplier_(std::max(config.receive_multiplier, 1))
+{
+  udp_socket_ = socket(AF_INET, SOCK_DGRAM, 0);
+  if (udp_socket_ < 0) {
+    throw std::runtime_error("Error opening socket: " + std::string(strerror(errno)));
+  }
+  std::memset(&client_address_, 0, sizeof(client_address_));
+  client_address_.sin_family = AF_INET;
+  if (inet_pton(AF_INET, config_.driver_ip.c_str(), &client_address_.sin_addr) != 1) {
+    close(udp_socket_);
+    throw std::runtime_error("Invalid driver address: " + config_.driver_ip);
+  }
+  setClientPort(config_.client_port);
+  if (!config_.mode_log.empty()) {
+    mode_log_ = std::fopen(config_.mode_log.c_str(), "a");
+    if (mode_log_ == nullptr) {
+      close(udp_socket_);
+      throw std::runtime_error("Error opening " + config_.mode_log + ": " + strerror(errno));
+    }
+  }
+
+  if (!config_.autostart) {
+    listen_socket_ = socket(AF_INET, SOCK_STREAM, 0);
+    const int reuse = 1;
+    setsockopt(listen_socket_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    struct sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(config_.tcp_port);
+    if (listen_socket_ < 0 ||
+      bind(listen_socket_, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) < 0 ||
+      listen(listen_socket_, 1) < 0)
+    {
+      const std::string error = strerror(errno);
+      close(udp_socket_);
+      if (listen_socket_ >= 0) {
+        close(listen_socket_);
+      }
+      throw std::runtime_error(
+              "Error listening on port " + std::to_string(config_.tcp_port) + ": " + error);
+    }
+    fcntl(listen_socket_, F_SETFL, O_NONBLOCK);
+  } else {
+    session_state_ = FRISessionState_COMMANDING_WAIT;
+  }
+
+  // The joint values are encoded and decoded by the callbacks of the client SDK, the storage is
+  //  allocated once
+  monitoring_message_ = FRIMonitoringMessage_init_zero;
+  JointValues * values[] = {
+    &monitoring_message_.monitorData.measuredJointPosition,
+    &monitoring_message_.monitorData.measuredTorque,
+    &monitoring_message_.monitorData.commandedJointPosition,
+    &monitoring_message_.monitorData.commandedTorque,
+    &monitoring_message_.monitorData.externalTorque,
+    &monitoring_message_.ipoData.jointPosition};
+  for (std::size_t i = 0; i < monitoring_values_.size(); ++i) {
+    init_repeatedDouble(&monitoring_values_[i]);
+    map_repeatedDouble(
+      FRI_MANAGER_NANOPB_ENCODE, JOINTS, &values[i]->value, &monitoring_values_[i]);
+  }
+  init_repeatedInt(&drive_states_);
+  map_repeatedInt(
+    FRI_MANAGER_NANOPB_ENCODE, JOINTS, &monitoring_message_.robotInfo.driveState, &drive_states_);
+  std::fill(drive_states_.value, drive_states_.value + JOINTS, DriveState_ACTIVE);
+
+  monitoring_message_.header.messageIdentifier = kMonitoringMessageId;
+  monitoring_message_.has_connectionInfo = true;
+  monitoring_message_.connectionInfo.has_sendPeriod = true;
+  monitoring_message_.connectionInfo.has_receiveMultiplier = true;
+  monitoring_message_.has_robotInfo = true;
+  monitoring_message_.robotInfo.has_numberOfJoints = true;
+  monitoring_message_.robotInfo.numberOfJoints = JOINTS;
+  monitoring_message_.robotInfo.has_safetyState = true;
+  monitoring_message_.robotInfo.safetyState = SafetyState_NORMAL_OPERATION;
+  monitoring_message_.robotInfo.has_operationMode = true;
+  monitoring_message_.robotInfo.operationMode = OperationMode_AUTOMATIC_MODE;
+  monitoring_message_.robotInfo.has_controlMode = true;
+  monitoring_message_.has_monitorData = true;
+  monitoring_message_.monitorData.has_measuredJointPosition = true;
+  monitoring_message_.monitorData.has_measuredTorque = true;
+  monitoring_message_.monitorData.has_commandedJointPosition = true;
+  monitoring_message_.monitorData.has_commandedTorque = true;
+  monitoring_message_.monitorData.has_externalTorque = true;
+  monitoring_message_.monitorData.has_timestamp = true;
+  monitoring_message_.has_ipoData = true;
+  monitoring_message_.ipoData.has_jointPosition = true;
+  monitoring_message_.ipoData.has_clientCommandMode = true;
+  monitoring_message_.ipoData.has_overlayType = true;
+  monitoring_message_.ipoData.overlayType = OverlayType_JOINT;
+  monitoring_message_.ipoData.has_trackingPerformance = true;
+  monitoring_message_.ipoData.trackingPerformance = 1.0;
+
+  command_message_ = FRICommandMessage_init_zero;
+  init_repeatedDouble(&command_positions_);
+  map_repeatedDouble(
+    FRI_MANAGER_NANOPB_DECODE, JOINTS, &command_message_.commandData.jointPosition.value,
+    &command_positions_);
+  init_repeatedDouble(&command_torques_);
+  map_repeatedDouble(
+    FRI_MANAGER_NANOPB_DECODE, JOINTS, &command_message_.commandData.jointTorque.value,
+    &command_torques_);
+}
+
+FRISimulator::~FRISimulator()
+{
+  closeControl();
+  if (listen_socket_ >= 0) {
+    close(listen_socket_);
+  }
+  close(udp_socket_);
+  for (auto & values : monitoring_values_) {
+    free_repeatedDouble(&values);
+  }
+  free_repeatedInt(&drive_states_);
+  free_repeatedDouble(&command_positions_);
+  free_repeatedDouble(&command_torques_);
+  if (mode_log_ != nullptr) {
+    std::fclose(mode_log_);
+  }
+}
+
+void FRISimulator::run()
+{
+  auto cycle_end = std::chrono::steady_clock::now();
+  while (!terminate_ &&
+    (config_.cycles == 0 || statistics_.cycles < config_.cycles))
+  {
+    // The send period can be changed by the robot manager while the session is idle
+    cycle_end += std::chrono::milliseconds(send_period_ms_);
+    if (!config_.autostart) {
+      serveControl();
+    }
+    if (session_state_ != FRISessionState_IDLE) {
+      cycle(cycle_end);
+    }
+    if (session_state_ != reported_state_) {
+      printf("FRI session state changed to %s\n", stateName(session_state_));
+      reported_state_ = session_state_;
+    }
+    sleepUntil(cycle_end);
+  }
+}
+
+void FRISimulator::serveControl()
+{
+  if (control_socket_ < 0) {
+    control_socket_ = accept(listen_socket_, nullptr, nullptr);
+    if (control_socket_ < 0) {
+      return;
+    }
+    fcntl(control_socket_, F_SETFL, O_NONBLOCK);
+    control_buffered_ = 0;
+    printf("Robot manager connected\n");
+  }
+
+  ssize_t bytes;
+  while ((bytes = recv(
+      control_socket_, control_buffer_.data() + control_buffered_,
+      control_buffer_.size() - control_buffered_, 0)) > 0)
+  {
+    control_buffered_ += static_cast<std::size_t>(bytes);
+    std::size_t offset = 0;
+    while (control_buffered_ - offset >= 2) {
+      const std::size_t size = (control_buffer_[offset] << 8) | control_buffer_[offset + 1];
+      if (size > control_buffer_.size() - 2) {
+        printf("Request of %zu bytes is too long, closing the connection\n", size);
+        closeControl();
+        return;
+      }
+      if (control_buffered_ - offset < 2 + size) {
+        break;
+      }
+      handleRequest(control_buffer_.data() + offset + 2, size);
+      offset += 2 + size;
+      if (control_socket_ < 0) {
+        return;
+      }
+    }
+    std::memmove(
+      control_buffer_.data(), control_buffer_.data() + offset, control_buffered_ - offset);
+    control_buffered_ -= offset;
+  }
+  if (bytes == 0 || (bytes < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+    printf("Robot manager disconnected\n");
+    closeControl();
+    session_state_ = FRISessionState_IDLE;
+    control_requested_ = false;
+  }
+}
+
+void FRISimulator::handleRequest(const uint8_t * data, std::size_t size)
+{
+  statistics_.control_requests++;
+  if (size == 0) {
+    statistics_.rejected_requests++;
+    const uint8_t reply[] = {UNKNOWN};
+    sendReply(reply, sizeof(reply));
+    return;
+  }
+
+  const auto id = static_cast<CommandID>(data[0]);
+  kuka_drivers_core::BufferReader reader(data + 1, size - 1);
+  bool accepted = true;
+  bool success = true;
+  switch (id) {
+    case CONNECT:
+      break;
+    case DISCONNECT:
+      session_state_ = FRISessionState_IDLE;
+      control_requested_ = false;
+      break;
+    case START_FRI:
+      success = session_state_ == FRISessionState_IDLE;
+      if (success) {
+        session_state_ = FRISessionState_MONITORING_WAIT;
+        connected_ = false;
+        cycles_without_command_ = 0;
+      }
+      break;
+    case END_FRI:
+      session_state_ = FRISessionState_IDLE;
+      control_requested_ = false;
+      break;
+    case ACTIVATE_CONTROL:
+      // Commanding starts as soon as the client answers the monitoring messages
+      success = session_state_ != FRISessionState_IDLE;
+      control_requested_ = success;
+      break;
+    case DEACTIVATE_CONTROL:
+      control_requested_ = false;
+      if (session_state_ == FRISessionState_COMMANDING_WAIT ||
+        session_state_ == FRISessionState_COMMANDING_ACTIVE)
+      {
+        session_state_ = FRISessionState_MONITORING_READY;
+      }
+      break;
+    case SET_FRI_CONFIG:
+      {
+        std::int32_t client_port = 0;
+        std::int32_t send_period_ms = 0;
+        std::int32_t receive_multiplier = 0;
+        success = reader.skip(FRI_CONFIG_HEADER.size()) &&
+          std::equal(FRI_CONFIG_HEADER.begin(), FRI_CONFIG_HEADER.end(), data + 1) &&
+          reader.readInt32(client_port) && reader.readInt32(send_period_ms) &&
+          reader.readInt32(receive_multiplier) && client_port > 0 && client_port < 65536 &&
+          send_period_ms > 0 && receive_multiplier > 0 && session_state_ == FRISessionState_IDLE;
+        if (success) {
+          setClientPort(static_cast<uint16_t>(client_port));
+          send_period_ms_ = send_period_ms;
+          receive_multiplier_ = receive_multiplier;
+        }
+      }
+      break;
+    case SET_CONTROL_MODE:
+      {
+        // The impedance parameters are accepted, but not simulated
+        std::uint8_t mode = 0;
+        success = reader.readUint8(mode) && session_state_ != FRISessionState_COMMANDING_ACTIVE;
+        if (success && mode == POSITION_CONTROL_MODE) {
+          control_mode_ = ControlMode_POSITION_CONTROLMODE;
+        } else if (success && mode == JOINT_IMPEDANCE_CONTROL_MODE) {
+          control_mode_ = ControlMode_JOINT_IMPEDANCE_CONTROLMODE;
+        } else if (success && mode == CARTESIAN_IMPEDANCE_CONTROL_MODE) {
+          control_mode_ = ControlMode_CARTESIAN_IMPEDANCE_CONTROLMODE;
+        } else {
+          success = false;
+        }
+      }
+      break;
+    case SET_COMMAND_MODE:
+      {
+        std::uint8_t mode = 0;
+        success = reader.readUint8(mode) && mode >= POSITION_COMMAND_MODE &&
+          mode <= TORQUE_COMMAND_MODE;
+        // While commanding the robot application restarts the overlay with the new mode
+        if (success && command_mode_ != static_cast<ClientCommandMode>(mode) &&
+          session_state_ == FRISessionState_COMMANDING_ACTIVE)
+        {
+          session_state_ = FRISessionState_COMMANDING_WAIT;
+        }
+        if (success) {
+          command_mode_ = static_cast<ClientCommandMode>(mode);
+        }
+      }
+      break;
+    default:
+      // The GET commands are not used by the robot manager
+      accepted = false;
+      break;
+  }
+
+  if (!accepted) {
+    statistics_.rejected_requests++;
+    const uint8_t reply[] = {REJECTED, data[0]};
+    sendReply(reply, sizeof(reply));
+    return;
+  }
+  statistics_.rejected_requests += !success;
+  const uint8_t reply[] = {ACCEPTED, data[0], success ? SUCCESS : NO_SUCCESS};
+  // The connection is closed by the robot manager after DISCONNECT
+  sendReply(reply, sizeof(reply));
+}
+
+void FRISimulator::sendReply(const uint8_t * data, std::size_t size)
+{
+  if (control_socket_ < 0) {
+    return;
+  }
+  uint8_t frame[16];
+  frame[0] = static_cast<uint8_t>(size >> 8);
+  frame[1] = static_cast<uint8_t>(size & 0xFF);
+  std::memcpy(frame + 2, data, size);
+  if (send(control_socket_, frame, size + 2, MSG_NOSIGNAL) != static_cast<ssize_t>(size + 2)) {
+    printf("Sending the reply to the robot manager failed\n");
+  }
+}
+
+void FRISimulator::closeControl()
+{
+  if (control_socket_ >= 0) {
+    close(control_socket_);
+    control_socket_ = -1;
+  }
+}
+
+void FRISimulator::cycle(std::chrono::steady_clock::time_point cycle_end)
+{
+  statistics_.cycles++;
+
+  char buffer[kMessageSize];
+  const std::size_t size = encodeMonitoring(buffer, sizeof(buffer));
+  send_times_[sequence_counter_ % send_times_.size()] = std::chrono::steady_clock::now();
+  if (size > 0) {
+    sendto(
+      udp_socket_, buffer, size, 0, reinterpret_cast<struct sockaddr *>(&client_address_),
+      sizeof(client_address_));
+  }
+  sequence_counter_++;
+
+  bool answered = false;
+  for (auto now = std::chrono::steady_clock::now(); now < cycle_end;
+    now = std::chrono::steady_clock::now())
+  {
+    struct pollfd fds = {udp_socket_, POLLIN, 0};
+    const timespec timeout = toTimespec(std::chrono::steady_clock::time_point(cycle_end - now));
+    if (ppoll(&fds, 1, &timeout, nullptr) <= 0) {
+      continue;
+    }
+    ssize_t bytes;
+    while ((bytes = recv(udp_socket_, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0) {
+      handleCommand(buffer, static_cast<std::size_t>(bytes));
+      answered = true;
+    }
+    // With a receive multiplier one command is expected in several cycles
+    if (answered) {
+      break;
+    }
+  }
+
+  if (answered) {
+    connected_ = true;
+    cycles_without_command_ = 0;
+    if (session_state_ == FRISessionState_MONITORING_WAIT) {
+      session_state_ = FRISessionState_MONITORING_READY;
+    }
+    if (control_requested_ && session_state_ == FRISessionState_MONITORING_READY) {
+      session_state_ = FRISessionState_COMMANDING_WAIT;
+    } else if (session_state_ == FRISessionState_COMMANDING_WAIT) {
+      session_state_ = FRISessionState_COMMANDING_ACTIVE;
+      // The first command of the overlay, also after a command mode switch
+      if (mode_log_ != nullptr) {
+        const int64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch()).count();
+        std::fprintf(mode_log_, "%" PRId64 " %d\n", now_ns, static_cast<int>(command_mode_));
+        std::fflush(mode_log_);
+      }
+    }
+  } else if (connected_ &&
+    ++cycles_without_command_ % static_cast<uint64_t>(receive_multiplier_) == 0)
+  {
+    const uint64_t consecutive = cycles_without_command_ / receive_multiplier_;
+    statistics_.missing_commands++;
+    statistics_.max_consecutive_missing =
+      std::max(statistics_.max_consecutive_missing, consecutive);
+    if (consecutive >= config_.max_missing_commands &&
+      (session_state_ == FRISessionState_COMMANDING_WAIT ||
+      session_state_ == FRISessionState_COMMANDING_ACTIVE))
+    {
+      statistics_.control_ended++;
+      control_requested_ = config_.autostart;
+      session_state_ = config_.autostart ? FRISessionState_COMMANDING_WAIT :
+        FRISessionState_MONITORING_READY;
+      connected_ = false;
+      const uint8_t reply[] = {ERROR_CONTROL_ENDED};
+      sendReply(reply, sizeof(reply));
+    }
+  }
+}
+
+void FRISimulator::handleCommand(const char * buffer, std::size_t size)
+{
+  command_message_.has_commandData = false;
+  command_message_.commandData.has_jointPosition = false;
+  command_message_.commandData.has_jointTorque = false;
+  command_positions_.size = 0;
+  command_torques_.size = 0;
+  pb_istream_t stream =
+    pb_istream_from_buffer(reinterpret_cast<const uint8_t *>(buffer), size);
+  if (!pb_decode(&stream, FRICommandMessage_fields, &command_message_) ||
+    command_message_.header.messageIdentifier != kCommandMessageId)
+  {
+    statistics_.malformed_commands++;
+    return;
+  }
+
+  const uint32_t reflected = command_message_.header.reflectedSequenceCounter;
+  if (reflected + 1 != sequence_counter_) {
+    statistics_.late_commands++;
+  }
+  if (sequence_counter_ - reflected - 1 < send_times_.size()) {
+    latency_.Record(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - send_times_[reflected % send_times_.size()]).count());
+  }
+  statistics_.commands++;
+
+  // The commands are only followed while commanding, the robot is perfectly stiff
+  if (session_state_ != FRISessionState_COMMANDING_ACTIVE || !command_message_.has_commandData) {
+    return;
+  }
+  if (command_message_.commandData.has_jointPosition) {
+    std::copy_n(command_positions_.value, JOINTS, commanded_positions_.begin());
+    positions_ = commanded_positions_;
+  }
+  if (command_message_.commandData.has_jointTorque) {
+    std::copy_n(command_torques_.value, JOINTS, commanded_torques_.begin());
+    torques_ = commanded_torques_;
+  }
+}
+
+std::size_t FRISimulator::encodeMonitoring(char * buffer, std::size_t size)
+{
+  monitoring_message_.header.sequenceCounter = sequence_counter_;
+  // Like the controller, the last received command is reflected
+  monitoring_message_.header.reflectedSequenceCounter = command_message_.header.sequenceCounter;
+  monitoring_message_.connectionInfo.sessionState = session_state_;
+  monitoring_message_.connectionInfo.quality = cycles_without_command_ <
+    static_cast<uint64_t>(receive_multiplier_) ? FRIConnectionQuality_EXCELLENT :
+    FRIConnectionQuality_POOR;
+  monitoring_message_.connectionInfo.sendPeriod = static_cast<uint32_t>(send_period_ms_);
+  monitoring_message_.connectionInfo.receiveMultiplier = static_cast<uint32_t>(receive_multiplier_);
+  monitoring_message_.robotInfo.controlMode = control_mode_;
+  monitoring_message_.ipoData.clientCommandMode = command_mode_;
+
+  const auto now = std::chrono::system_clock::now().time_since_epoch();
+  const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+  monitoring_message_.monitorData.timestamp.sec = static_cast<uint32_t>(ns / 1000000000);
+  monitoring_message_.monitorData.timestamp.nanosec = static_cast<uint32_t>(ns % 1000000000);
+
+  // Measured and commanded position and torque, external torque and interpolated position
+  const std::array<double, JOINTS> external_torques{};
+  const std::array<double, JOINTS> * sources[] = {
+    &positions_, &torques_, &commanded_positions_, &commanded_torques_, &external_torques,
+    &commanded_positions_};
+  for (std::size_t i = 0; i < monitoring_values_.size(); ++i) {
+    std::copy(sources[i]->begin(), sources[i]->end(), monitoring_values_[i].value);
+  }
+
+  pb_ostream_t stream = pb_ostream_from_buffer(reinterpret_cast<uint8_t *>(buffer), size);
+  if (!pb_encode(&stream, FRIMonitoringMessage_fields, &monitoring_message_)) {
+    printf("Could not encode monitoring message: %s\n", PB_GET_ERROR(&stream));
+    return 0;
+  }
+  return stream.bytes_written;
+}
+
+void FRISimulator::setClientPort(uint16_t port)
+{
+  client_address_.sin_port = htons(port);
+}
+
+void FRISimulator::printReport(const char * name) const
+{
+  const auto snapshot = latency_.GetSnapshot();
+  printf(
+    "%s: cycles: %lu, commands: %lu, missing: %lu (max consecutive: %lu), late: %lu, "
+    "malformed: %lu, control ended: %lu\n", name, statistics_.cycles, statistics_.commands,
+    statistics_.missing_commands, statistics_.max_consecutive_missing, statistics_.late_commands,
+    statistics_.malformed_commands, statistics_.control_ended);
+  printf(
+    "%s: robot manager requests: %lu, rejected: %lu\n", name, statistics_.control_requests,
+    statistics_.rejected_requests);
+  printf(
+    "%s: command latency [us] p50: %lu, p90: %lu, p99: %lu, p99.9: %lu, max: %lu\n", name,
+    snapshot.Percentile(50) / 1000, snapshot.Percentile(90) / 1000,
+    snapshot.Percentile(99) / 1000, snapshot.Percentile(99.9) / 1000, snapshot.max_ns / 1000);
+}
+}  // namespace kuka_sunrise_fri_driver
@@ -0,0 +1,162 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KUKA_SUNRISE_FRI_DRIVER__FRI_SIMULATOR_HPP_
+#define KUKA_SUNRISE_FRI_DRIVER__FRI_SIMULATOR_HPP_
+
+#include <netinet/in.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "FRIMessages.pb.h"
+#include "pb_frimessages_callbacks.h"
+
+#include "kuka_drivers_core/latency_histogram.hpp"
+
+namespace kuka_sunrise_fri_driver
+{
+/**
+ * Plays the Sunrise cabinet side of FRI: the robot application and the FRI session
+ *
+ * The commands of the robot manager (FRIConnection) are answered on the TCP port like the robot
+ * application does, the FRI configuration, control mode and client command mode are taken
+ * over. After START_FRI a FRIMonitoringMessage is sent to the client port in every send period
+ * and a FRICommandMessage is expected every receive multiplier cycles, ACTIVATE_CONTROL moves
+ * the session to COMMANDING_WAIT and to COMMANDING_ACTIVE with the first command. The joint
+ * positions and torques of the commands are applied to the simulated robot. If too many
+ * commands are missing while commanding, the control is ended with ERROR_CONTROL_ENDED like the
+ * FRI timeout of the robot application. A new client command mode while commanding restarts the
+ * overlay, the session returns to COMMANDING_WAIT.
+ */
+class FRISimulator
+{
+public:
+  static constexpr int JOINTS = 7;
+
+  struct Config
+  {
+    std::string driver_ip = "127.0.0.1";
+    // Port of the robot application, the robot manager always connects to 30000
+    uint16_t tcp_port = 30000;
+    // Used until the robot manager sends SET_FRI_CONFIG
+    uint16_t client_port = 30200;
+    int send_period_ms = 1;
+    int receive_multiplier = 1;
+    // Starts the session in COMMANDING_WAIT without the TCP protocol, for the RT path alone
+    bool autostart = false;
+    // Consecutive missing commands before the control is ended
+    uint64_t max_missing_commands = 100;
+    // Number of cycles to run, 0 runs until stop() is called
+    uint64_t cycles = 0;
+    // If set, the first command of every overlay is logged here as "<steady clock ns> <mode>"
+    std::string mode_log;
+  };
+
+  struct Statistics
+  {
+    uint64_t cycles = 0;                // Monitoring messages sent
+    uint64_t commands = 0;
+    uint64_t missing_commands = 0;      // Receive multiplier cycles without a command
+    uint64_t max_consecutive_missing = 0;
+    uint64_t late_commands = 0;         // Commands reflecting an earlier monitoring message
+    uint64_t malformed_commands = 0;
+    uint64_t control_requests = 0;      // Commands of the robot manager over TCP
+    uint64_t rejected_requests = 0;
+    uint64_t control_ended = 0;         // Sessions ended because of missing commands
+  };
+
+  // Command latencies in 10 us buckets up to 10 ms
+  using Histogram = kuka_drivers_core::LatencyHistogram<1000, 10000>;
+
+  explicit FRISimulator(const Config & config);
+  ~FRISimulator();
+
+  FRISimulator(const FRISimulator &) = delete;
+  FRISimulator & operator=(const FRISimulator &) = delete;
+
+  // Run with absolute timing until finished or stop() is called, the robot manager can reconnect
+  void run();
+
+  // Can be called from any thread
+  void stop() {terminate_ = true;}
+
+  const Statistics & statistics() const {return statistics_;}
+  const Histogram & latency() const {return latency_;}
+
+  // Prints the statistics and the command latency distribution
+  void printReport(const char * name) const;
+
+private:
+  // Accepts the robot manager and answers the received requests, never blocks
+  void serveControl();
+  void handleRequest(const uint8_t * data, std::size_t size);
+  void sendReply(const uint8_t * data, std::size_t size);
+  void closeControl();
+
+  // Sends the monitoring message and receives the commands until the cycle ends
+  void cycle(std::chrono::steady_clock::time_point cycle_end);
+  void handleCommand(const char * buffer, std::size_t size);
+  std::size_t encodeMonitoring(char * buffer, std::size_t size);
+  void setClientPort(uint16_t port);
+
+  Config config_;
+  int udp_socket_ = -1;
+  int listen_socket_ = -1;
+  int control_socket_ = -1;
+  struct sockaddr_in client_address_;
+
+  // Requests of the robot manager, framed by a two byte big-endian length
+  std::array<uint8_t, 4096> control_buffer_;
+  std::size_t control_buffered_ = 0;
+
+  FRISessionState session_state_ = FRISessionState_IDLE;
+  FRISessionState reported_state_ = FRISessionState_IDLE;
+  bool control_requested_ = false;
+  ControlMode control_mode_ = ControlMode_POSITION_CONTROLMODE;
+  ClientCommandMode command_mode_ = ClientCommandMode_POSITION;
+  int send_period_ms_;
+  int receive_multiplier_;
+
+  std::array<double, JOINTS> positions_{{0, 0.5, 0, -1.5, 0, 1.0, 0}};
+  std::array<double, JOINTS> torques_{};
+  std::array<double, JOINTS> commanded_positions_ = positions_;
+  std::array<double, JOINTS> commanded_torques_{};
+
+  uint32_t sequence_counter_ = 0;
+  // Send times of the latest monitoring messages by sequence counter, for the latencies
+  std::array<std::chrono::steady_clock::time_point, 64> send_times_;
+  uint64_t cycles_without_command_ = 0;
+  // Missing commands are only counted after the first command of the session
+  bool connected_ = false;
+  std::atomic<bool> terminate_{false};
+
+  FRIMonitoringMessage monitoring_message_;
+  std::array<tRepeatedDoubleArguments, 6> monitoring_values_;
+  tRepeatedIntArguments drive_states_;
+  FRICommandMessage command_message_;
+  tRepeatedDoubleArguments command_positions_;
+  tRepeatedDoubleArguments command_torques_;
+
+  Statistics statistics_;
+  Histogram latency_;
+  std::FILE * mode_log_ = nullptr;
+};
+}  // namespace kuka_sunrise_fri_driver
+
+#endif  // KUKA_SUNRISE_FRI_DRIVER__FRI_SIMULATOR_HPP_
@@ -0,0 +1,126 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <getopt.h>
+#include <sched.h>
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "fri_simulator.hpp"
+
+namespace
+{
+std::unique_ptr<kuka_sunrise_fri_driver::FRISimulator> g_simulator;
+
+void onSignal(int)
+{
+  if (g_simulator != nullptr) {
+    g_simulator->stop();
+  }
+}
+
+void printUsage(const char * program)
+{
+  printf(
+    "Usage: %s [options]\n"
+    "  --ip <address>              IP address of the driver (default: 127.0.0.1)\n"
+    "  --tcp-port <port>           port of the robot manager connection (default: 30000)\n"
+    "  --client-port <port>        client port until set by the robot manager (default: 30200)\n"
+    "  --send-period-ms <ms>       send period until set by the robot manager (default: 1)\n"
+    "  --receive-multiplier <n>    receive multiplier until set by the robot manager "
+    "(default: 1)\n"
+    "  --autostart                 start commanding without the robot manager\n"
+    "  --max-missing <n>           consecutive missing commands before ending the control "
+    "(default: 100)\n"
+    "  --cycles <n>                number of monitoring messages, 0 runs until interrupted "
+    "(default: 0)\n"
+    "  --priority <p>              run with SCHED_FIFO and the given priority\n"
+    "  --mode-log <file>           append the steady clock time and the command mode of the\n"
+    "                              first command of every overlay to the file\n", program);
+}
+}  // namespace
+
+int main(int argc, char * argv[])
+{
+  static const struct option kOptions[] = {
+    {"ip", required_argument, nullptr, 'i'},
+    {"tcp-port", required_argument, nullptr, 't'},
+    {"client-port", required_argument, nullptr, 'p'},
+    {"send-period-ms", required_argument, nullptr, 's'},
+    {"receive-multiplier", required_argument, nullptr, 'm'},
+    {"autostart", no_argument, nullptr, 'a'},
+    {"max-missing", required_argument, nullptr, 'x'},
+    {"cycles", required_argument, nullptr, 'n'},
+    {"priority", required_argument, nullptr, 'r'},
+    {"mode-log", required_argument, nullptr, 'l'},
+    {"help", no_argument, nullptr, 'h'},
+    {nullptr, 0, nullptr, 0}};
+
+  kuka_sunrise_fri_driver::FRISimulator::Config config;
+  int priority = 0;
+  int option;
+  while ((option = getopt_long(argc, argv, "h", kOptions, nullptr)) != -1) {
+    switch (option) {
+      case 'i': config.driver_ip = optarg; break;
+      case 't': config.tcp_port = static_cast<uint16_t>(std::stoi(optarg)); break;
+      case 'p': config.client_port = static_cast<uint16_t>(std::stoi(optarg)); break;
+      case 's': config.send_period_ms = std::stoi(optarg); break;
+      case 'm': config.receive_multiplier = std::stoi(optarg); break;
+      case 'a': config.autostart = true; break;
+      case 'x': config.max_missing_commands = std::stoull(optarg); break;
+      case 'n': config.cycles = std::stoull(optarg); break;
+      case 'r': priority = std::stoi(optarg); break;
+      case 'l': config.mode_log = optarg; break;
+      default:
+        printUsage(argv[0]);
+        return option == 'h' ? 0 : 1;
+    }
+  }
+
+  if (priority > 0) {
+    struct sched_param param;
+    param.sched_priority = priority;
+    if (sched_setscheduler(0, SCHED_FIFO, &param) == -1) {
+      fprintf(stderr, "Setting SCHED_FIFO priority failed: %s\n", strerror(errno));
+      return 1;
+    }
+  }
+
+  try {
+    g_simulator = std::make_unique<kuka_sunrise_fri_driver::FRISimulator>(config);
+  } catch (const std::runtime_error & e) {
+    fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+  std::signal(SIGINT, onSignal);
+  std::signal(SIGTERM, onSignal);
+
+  if (config.autostart) {
+    printf(
+      "Simulating an LBR commanding towards %s:%u with %d ms send period\n",
+      config.driver_ip.c_str(), config.client_port, config.send_period_ms);
+  } else {
+    printf("Simulating an LBR, waiting for the robot manager on port %u\n", config.tcp_port);
+  }
+  g_simulator->run();
+  g_simulator->printReport("fri_simulator");
+  g_simulator.reset();
+  return 0;
+}
@@ -12,24 +12,29 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <chrono>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "kuka_sunrise_fri_driver/configuration_manager.hpp"
-#include "communication_helpers/service_tools.hpp"
 
 namespace kuka_sunrise_fri_driver
 {
 ConfigurationManager::ConfigurationManager(
   std::shared_ptr<kuka_drivers_core::ROS2BaseLCNode> robot_manager_node,
-  std::shared_ptr<FRIConnection> fri_connection)
-: robot_manager_node_(robot_manager_node), fri_connection_(fri_connection)
+  std::shared_ptr<FRIConnection> fri_connection, CommandModeSwitch command_mode_switch,
+  SessionRestart session_restart, std::shared_ptr<kuka_drivers_core::SwitchTrace> switch_trace)
+: robot_manager_node_(robot_manager_node), fri_connection_(fri_connection),
+  command_mode_switch_(command_mode_switch), session_restart_(session_restart),
+  switch_trace_(switch_trace)
 {
   auto qos = rclcpp::QoS(rclcpp::KeepLast(10));
   qos.reliable();
-  cbg_ = robot_manager_node->create_callback_group(
-    rclcpp::CallbackGroupType::MutuallyExclusive);
+  // The responses awaited by the parameter requests served in param_cbg_
+  cbg_ = robot_manager_node->createDedicatedCallbackGroup();
   param_cbg_ = robot_manager_node->create_callback_group(
     rclcpp::CallbackGroupType::MutuallyExclusive);
   receive_multiplier_client_ = robot_manager_node->create_client<
@@ -53,12 +58,24 @@ ConfigurationManager::ConfigurationManager(
   get_controllers_client_ =
     robot_manager_node->create_client<controller_manager_msgs::srv::ListControllers>(
     "controller_manager/list_controllers", qos.get_rmw_qos_profile(), cbg_);
+  update_rate_client_ = robot_manager_node->create_client<rcl_interfaces::srv::SetParameters>(
+    "controller_manager/set_parameters", qos.get_rmw_qos_profile(), cbg_);
+
+  // The commands of parameters set together, e.g. impedance values and control mode, are sent
+  //   in one batch after all of their callbacks succeeded
+  robot_manager_node_->registerBatchHooks(
+    [this]() {
+      beginCommandBatch();
+    }, [this](bool successful) {
+      return endCommandBatch(successful);
+    });
 }
 
 bool ConfigurationManager::onCommandModeChangeRequest(const std::string & command_mode) const
 {
+  traceSwitch("command_mode", command_mode);
   if (command_mode == POSITION_COMMAND) {
-    if (!position_controller_available_ || !setCommandMode(POSITION_COMMAND)) {
+    if (!position_controller_available_ || !applyCommandMode(POSITION_COMMAND)) {
       return false;
     }
   } else if (command_mode == TORQUE_COMMAND) {
@@ -74,13 +91,31 @@ bool ConfigurationManager::onCommandModeChangeRequest(const std::string & comman
         "Unable to set torque command mode, if send period is bigger than 5 [ms]");
       return false;
     }
-    if (!torque_controller_available_ || !setCommandMode(TORQUE_COMMAND)) {
+    if (!torque_controller_available_ || !applyCommandMode(TORQUE_COMMAND)) {
+      return false;
+    }
+  } else if (command_mode == WRENCH_COMMAND) {
+    if (robot_manager_node_->get_parameter("control_mode").as_string() !=
+      CARTESIAN_IMPEDANCE_CONTROL)
+    {
+      RCLCPP_ERROR(
+        robot_manager_node_->get_logger(),
+        "Unable to set wrench command mode, if control mode is not 'cartesian impedance'");
+      return false;
+    }
+    if (robot_manager_node_->get_parameter("send_period_ms").as_int() > 5) {
+      RCLCPP_ERROR(
+        robot_manager_node_->get_logger(),
+        "Unable to set wrench command mode, if send period is bigger than 5 [ms]");
+      return false;
+    }
+    if (!wrench_controller_available_ || !applyCommandMode(WRENCH_COMMAND)) {
       return false;
     }
   } else {
     RCLCPP_ERROR(
-      robot_manager_node_->get_logger(), "Command mode should be '%s' or '%s'",
-      POSITION_COMMAND.c_str(), TORQUE_COMMAND.c_str());
+      robot_manager_node_->get_logger(), "Command mode should be '%s', '%s' or '%s'",
+      POSITION_COMMAND.c_str(), TORQUE_COMMAND.c_str(), WRENCH_COMMAND.c_str());
     return false;
   }
   RCLCPP_INFO(robot_manager_node_->get_logger(), "Successfully set command mode");
@@ -89,21 +124,25 @@ bool ConfigurationManager::onCommandModeChangeRequest(const std::string & comman
 
 bool ConfigurationManager::onControlModeChangeRequest(const std::string & control_mode) const
 {
+  traceSwitch("control_mode", control_mode);
   if (control_mode == POSITION_CONTROL) {
-    return fri_connection_->setPositionControlMode();
+    return sendCommand(FRIConnection::makePositionControlModeCommand());
   } else if (control_mode == IMPEDANCE_CONTROL) {
     try {
-      return fri_connection_->setJointImpedanceControlMode(
-        joint_stiffness_,
-        joint_damping_);
+      return sendCommand(
+        FRIConnection::makeJointImpedanceControlModeCommand(joint_stiffness_, joint_damping_));
     } catch (const std::exception & e) {
       RCLCPP_ERROR(robot_manager_node_->get_logger(), e.what());
     }
     return false;
+  } else if (control_mode == CARTESIAN_IMPEDANCE_CONTROL) {
+    return sendCommand(
+      FRIConnection::makeCartesianImpedanceControlModeCommand(
+        cartesian_stiffness_, cartesian_damping_));
   } else {
     RCLCPP_ERROR(
-      robot_manager_node_->get_logger(), "Control mode should be '%s' or '%s'",
-      POSITION_CONTROL.c_str(), IMPEDANCE_CONTROL.c_str());
+      robot_manager_node_->get_logger(), "Control mode should be '%s', '%s' or '%s'",
+      POSITION_CONTROL.c_str(), IMPEDANCE_CONTROL.c_str(), CARTESIAN_IMPEDANCE_CONTROL.c_str());
     return false;
   }
 }
@@ -146,6 +185,49 @@ bool ConfigurationManager::onJointDampingChangeRequest(const std::vector<double>
   return true;
 }
 
+bool ConfigurationManager::onCartesianStiffnessChangeRequest(
+  const std::vector<double> & cartesian_stiffness)
+{
+  if (cartesian_stiffness.size() != 6) {
+    RCLCPP_ERROR(
+      robot_manager_node_->get_logger(),
+      "Invalid parameter array length for parameter cartesian stiffness");
+    return false;
+  }
+  for (std::size_t i = 0; i < cartesian_stiffness.size(); i++) {
+    // Limits of the Cartesian impedance controller for the translational and rotational axes
+    const double max_stiffness = i < 3 ? 5000 : 300;
+    if (cartesian_stiffness[i] < 0 || cartesian_stiffness[i] > max_stiffness) {
+      RCLCPP_ERROR(
+        robot_manager_node_->get_logger(),
+        "Cartesian stiffness values must be >=0 && <=5000 (translation) or <=300 (rotation)");
+      return false;
+    }
+  }
+  cartesian_stiffness_ = cartesian_stiffness;
+  return true;
+}
+
+bool ConfigurationManager::onCartesianDampingChangeRequest(
+  const std::vector<double> & cartesian_damping)
+{
+  if (cartesian_damping.size() != 6) {
+    RCLCPP_ERROR(
+      robot_manager_node_->get_logger(),
+      "Invalid parameter array length for parameter cartesian damping");
+    return false;
+  }
+  for (double cd : cartesian_damping) {
+    if (cd < 0.1 || cd > 1) {
+      RCLCPP_ERROR(
+        robot_manager_node_->get_logger(), "Cartesian damping values must be >=0.1 && <=1");
+      return false;
+    }
+  }
+  cartesian_damping_ = cartesian_damping;
+  return true;
+}
+
 bool ConfigurationManager::onSendPeriodChangeRequest(const int & send_period) const
 {
   if (send_period < 1 || send_period > 100) {
@@ -154,6 +236,24 @@ bool ConfigurationManager::onSendPeriodChangeRequest(const int & send_period) co
       "Send period milliseconds must be >=1 && <=100");
     return false;
   }
+  if (robot_manager_node_->get_current_state().id() ==
+    lifecycle_msgs::msg::State::PRIMARY_STATE_ACTIVE)
+  {
+    if (!session_restart_) {
+      RCLCPP_ERROR(robot_manager_node_->get_logger(), "Send period cannot be changed while active");
+      return false;
+    }
+    if (robot_manager_node_->get_parameter("command_mode").as_string() != POSITION_COMMAND &&
+      send_period > 5)
+    {
+      RCLCPP_ERROR(
+        robot_manager_node_->get_logger(),
+        "Send period must not be bigger than 5 [ms] in torque and wrench command mode");
+      return false;
+    }
+    // Applied at the end of the batch, together with a new receive multiplier
+    pending_send_period_ = send_period;
+  }
   return true;
 }
 
@@ -163,12 +263,28 @@ bool ConfigurationManager::onReceiveMultiplierChangeRequest(const int & receive_
     RCLCPP_ERROR(robot_manager_node_->get_logger(), "Receive multiplier must be >=1");
     return false;
   }
+  if (robot_manager_node_->get_current_state().id() ==
+    lifecycle_msgs::msg::State::PRIMARY_STATE_ACTIVE)
+  {
+    pending_receive_multiplier_ = receive_multiplier;
+    return true;
+  }
   if (!setReceiveMultiplier(receive_multiplier)) {
     return false;
   }
   return true;
 }
 
+bool ConfigurationManager::onClientPortChangeRequest(const int & client_port) const
+{
+  if (client_port < 30200 || client_port > 30209) {
+    RCLCPP_ERROR(
+      robot_manager_node_->get_logger(), "Client port must be between 30200 and 30209");
+    return false;
+  }
+  return true;
+}
+
 bool ConfigurationManager::onControllerIpChangeRequest(const std::string & controller_ip) const
 {
   // Check IP validity
@@ -202,35 +318,28 @@ bool ConfigurationManager::onControllerIpChangeRequest(const std::string & contr
 
 bool ConfigurationManager::onControllerNameChangeRequest(
   const std::string & controller_name,
-  bool position)
+  const std::string & command_mode)
 {
-  auto request = std::make_shared<controller_manager_msgs::srv::ListControllers::Request>();
-  auto response =
-    kuka_drivers_core::sendRequest<controller_manager_msgs::srv::ListControllers::Response>(
-    get_controllers_client_, request, 0, 1000);
-
-  if (!response) {
-    RCLCPP_ERROR(robot_manager_node_->get_logger(), "Could not get controller names");
-    return false;
-  }
+  bool & controller_available = command_mode == POSITION_COMMAND ?
+    position_controller_available_ : (command_mode == TORQUE_COMMAND ?
+    torque_controller_available_ : wrench_controller_available_);
 
   if (controller_name == "") {
     RCLCPP_WARN(
       robot_manager_node_->get_logger(), "Controller for %s command mode not available",
-      position ? POSITION_COMMAND.c_str() : TORQUE_COMMAND.c_str());
-    if (position) {position_controller_available_ = false;} else {
-      torque_controller_available_ = false;
-    }
+      command_mode.c_str());
+    controller_available = false;
     return true;
   }
 
-  for (const auto & controller : response->controller) {
-    if (controller_name == controller.name) {
-      if (position) {position_controller_available_ = true;} else {
-        torque_controller_available_ = true;
-      }
-      return true;
-    }
+  bool found = false;
+  if (!findController(controller_name, found)) {
+    RCLCPP_ERROR(robot_manager_node_->get_logger(), "Could not get controller names");
+    return false;
+  }
+  if (found) {
+    controller_available = true;
+    return true;
   }
   RCLCPP_ERROR(
     robot_manager_node_->get_logger(), "Controller name '%s' not available",
@@ -238,24 +347,209 @@ bool ConfigurationManager::onControllerNameChangeRequest(
   return false;
 }
 
-bool ConfigurationManager::setCommandMode(const std::string & command_mode) const
+bool ConfigurationManager::findController(const std::string & controller_name, bool & found)
+{
+  const auto contains = [this, &controller_name]() {
+      return std::find(
+        loaded_controllers_.begin(), loaded_controllers_.end(),
+        controller_name) != loaded_controllers_.end();
+    };
+  if (controller_list_valid_ && contains()) {
+    found = true;
+    return true;
+  }
+
+  // A request sent at the start of the registration is reused, it is answered in the meantime
+  requestControllerList();
+  auto call = std::move(controller_list_call_);
+  if (!call->waitFor(std::chrono::milliseconds(1000))) {
+    return false;
+  }
+  loaded_controllers_.clear();
+  for (const auto & controller : call->response()->controller) {
+    loaded_controllers_.push_back(controller.name);
+  }
+  controller_list_valid_ = true;
+  found = contains();
+  return true;
+}
+
+void ConfigurationManager::requestControllerList()
+{
+  if (!controller_list_call_) {
+    controller_list_call_ = kuka_drivers_core::sendRequestAsync(
+      get_controllers_client_,
+      std::make_shared<controller_manager_msgs::srv::ListControllers::Request>());
+  }
+}
+
+void ConfigurationManager::cancelControllerList()
+{
+  if (controller_list_call_) {
+    controller_list_call_->cancel();
+    controller_list_call_.reset();
+  }
+}
+
+void ConfigurationManager::traceSwitch(
+  const std::string & parameter, const std::string & value) const
+{
+  // The initial values are not switches, the first mode of a batch describes it
+  if (!switch_trace_ || !batch_started_ || tracing_switch_) {
+    return;
+  }
+  switch_trace_->Start(
+    parameter + " " + robot_manager_node_->get_parameter(parameter).as_string() + " -> " +
+    value);
+  tracing_switch_ = true;
+}
+
+bool ConfigurationManager::applyCommandMode(const std::string & command_mode) const
 {
   ClientCommandModeID client_command_mode;
   if (command_mode == POSITION_COMMAND) {
     client_command_mode = POSITION_COMMAND_MODE;
   } else if (command_mode == TORQUE_COMMAND) {
     client_command_mode = TORQUE_COMMAND_MODE;
+  } else if (command_mode == WRENCH_COMMAND) {
+    client_command_mode = WRENCH_COMMAND_MODE;
   } else {
     RCLCPP_ERROR(robot_manager_node_->get_logger(), "Invalid control mode");
     return false;
   }
-  if (fri_connection_) {
-    fri_connection_->setClientCommandMode(client_command_mode);
-  } else {
+  if (!fri_connection_) {
     RCLCPP_ERROR(robot_manager_node_->get_logger(), "Robot Manager not available");
     return false;
   }
-  return true;
+  const auto command = FRIConnection::makeClientCommandModeCommand(client_command_mode);
+  // While commanding, the robot manager switches the controllers around the mode change of
+  //  the robot application, the FRI session is kept
+  if (command_mode_switch_ && robot_manager_node_->get_current_state().id() ==
+    lifecycle_msgs::msg::State::PRIMARY_STATE_ACTIVE)
+  {
+    return command_mode_switch_(
+      command,
+      robot_manager_node_->get_parameter(command_mode + "_controller_name").as_string());
+  }
+  return sendCommand(command);
+}
+
+bool ConfigurationManager::sendCommand(const FRIConnection::Command & command) const
+{
+  if (defer_commands_) {
+    deferred_commands_.push_back(command);
+    return true;
+  }
+  return fri_connection_->sendCommandsAndWait({command}).front();
+}
+
+void ConfigurationManager::beginCommandBatch()
+{
+  // The registration of the initial parameters collects the commands itself
+  batch_started_ = !defer_commands_;
+  if (batch_started_) {
+    defer_commands_ = true;
+    deferred_commands_.clear();
+  }
+}
+
+bool ConfigurationManager::endCommandBatch(bool successful)
+{
+  if (!batch_started_) {
+    return true;
+  }
+  batch_started_ = false;
+  defer_commands_ = false;
+  if (!successful) {
+    deferred_commands_.clear();
+    pending_send_period_ = 0;
+    pending_receive_multiplier_ = 0;
+    // The request was already sent, it is not left pending
+    awaitReceiveMultiplier();
+  }
+  const bool applied = !successful || (sendDeferredCommands() && applyRetiming());
+  if (tracing_switch_) {
+    switch_trace_->Finish(successful && applied);
+    tracing_switch_ = false;
+  }
+  return applied;
+}
+
+bool ConfigurationManager::applyRetiming()
+{
+  if (pending_send_period_ == 0 && pending_receive_multiplier_ == 0) {
+    return true;
+  }
+  // The parameters still have their previous values until the batch succeeded
+  const auto current_send_period =
+    static_cast<int>(robot_manager_node_->get_parameter("send_period_ms").as_int());
+  const auto current_receive_multiplier =
+    static_cast<int>(robot_manager_node_->get_parameter("receive_multiplier").as_int());
+  const int send_period = pending_send_period_ != 0 ? pending_send_period_ : current_send_period;
+  const int receive_multiplier = pending_receive_multiplier_ != 0 ?
+    pending_receive_multiplier_ : current_receive_multiplier;
+  pending_send_period_ = 0;
+  pending_receive_multiplier_ = 0;
+  if (send_period == current_send_period && receive_multiplier == current_receive_multiplier) {
+    return true;
+  }
+  // The control loop runs with the controllers, at 1/N of the FRI rate
+  const int controller_period_ms = send_period * receive_multiplier;
+  if (controller_period_ms > 1000) {
+    RCLCPP_ERROR(
+      robot_manager_node_->get_logger(),
+      "Send period times receive multiplier must not be bigger than 1000 [ms]");
+    return false;
+  }
+  const auto retime_hardware = [this, receive_multiplier, controller_period_ms]() {
+      return setUpdateRate(1000 / controller_period_ms) &&
+             setReceiveMultiplier(receive_multiplier);
+    };
+
+  // With interpolated commands the robot expects a command in every cycle, a new receive
+  //  multiplier only changes the sampling of the controllers and the session is kept
+  const bool interpolate_commands =
+    robot_manager_node_->get_parameter("interpolate_commands").as_bool();
+  if (interpolate_commands && send_period == current_send_period) {
+    if (!retime_hardware()) {
+      return false;
+    }
+    RCLCPP_INFO(
+      robot_manager_node_->get_logger(), "Controllers are sampled every %d FRI cycles",
+      receive_multiplier);
+    return true;
+  }
+  if (!session_restart_) {
+    RCLCPP_ERROR(
+      robot_manager_node_->get_logger(), "Receive multiplier cannot be changed while active");
+    return false;
+  }
+  return session_restart_(
+    send_period, interpolate_commands ? 1 : receive_multiplier, retime_hardware);
+}
+
+bool ConfigurationManager::sendDeferredCommands()
+{
+  bool ok = true;
+  if (!deferred_commands_.empty()) {
+    const auto results = fri_connection_->sendCommandsAndWait(deferred_commands_);
+    if (tracing_switch_) {
+      switch_trace_->Mark("commands_sent");
+    }
+    for (std::size_t i = 0; i < results.size(); ++i) {
+      if (!results[i]) {
+        RCLCPP_ERROR(
+          robot_manager_node_->get_logger(), "Command %d of the parameters failed",
+          static_cast<int>(deferred_commands_[i].id));
+        ok = false;
+        break;
+      }
+    }
+    deferred_commands_.clear();
+  }
+  // The hardware interface has set the receive multiplier while the robot application
+  //  executed the commands
+  return awaitReceiveMultiplier() && ok;
 }
 
 bool ConfigurationManager::setReceiveMultiplier(int receive_multiplier) const
@@ -263,10 +557,38 @@ bool ConfigurationManager::setReceiveMultiplier(int receive_multiplier) const
   // Set receive multiplier of hardware interface through controller manager service
   auto request = std::make_shared<kuka_driver_interfaces::srv::SetInt::Request>();
   request->data = receive_multiplier;
-  auto response = kuka_drivers_core::sendRequest<kuka_driver_interfaces::srv::SetInt::Response>(
-    receive_multiplier_client_, request, 0, 1000);
+  receive_multiplier_call_ = kuka_drivers_core::sendRequestAsync(
+    receive_multiplier_client_, request);
+  // In a batch the response is awaited together with the replies of the robot application
+  if (defer_commands_) {
+    return true;
+  }
+  return awaitReceiveMultiplier();
+}
+
+bool ConfigurationManager::setUpdateRate(int update_rate) const
+{
+  // The control loop takes over the new period at the start of its next cycle
+  auto request = std::make_shared<rcl_interfaces::srv::SetParameters::Request>();
+  request->parameters.push_back(
+    rclcpp::Parameter("update_rate", static_cast<int64_t>(update_rate)).to_parameter_msg());
+  auto call = kuka_drivers_core::sendRequestAsync(update_rate_client_, request);
+  if (!call->waitFor(std::chrono::milliseconds(1000)) || call->response()->results.empty() ||
+    !call->response()->results.front().successful)
+  {
+    RCLCPP_ERROR(robot_manager_node_->get_logger(), "Could not set update_rate");
+    return false;
+  }
+  return true;
+}
 
-  if (!response || !response->success) {
+bool ConfigurationManager::awaitReceiveMultiplier() const
+{
+  if (!receive_multiplier_call_) {
+    return true;
+  }
+  auto call = std::move(receive_multiplier_call_);
+  if (!call->waitFor(std::chrono::milliseconds(1000)) || !call->response()->success) {
     RCLCPP_ERROR(robot_manager_node_->get_logger(), "Could not set receive_multiplier");
     return false;
   }
@@ -285,8 +607,33 @@ void ConfigurationManager::setParameters(std_srvs::srv::Trigger::Response::Share
   // Parameter exceptions are intentionally not caught, because in case of an invalid
   //   parameter type (or value), the nodes must be launched again with changed parameters
   //   because they could not be declared, therefore change is not possible in runtime
+  // The commands of the initial values are sent together after the registration, so that the
+  //   robot application executes them without waiting for each reply
+  // The controllers are listed while the parameters before the controller names are declared
+  defer_commands_ = true;
+  deferred_commands_.clear();
+  requestControllerList();
+  try {
+    registerParameters();
+  } catch (...) {
+    defer_commands_ = false;
+    cancelControllerList();
+    awaitReceiveMultiplier();
+    throw;
+  }
+  defer_commands_ = false;
+  // Not awaited if no controller name is set
+  cancelControllerList();
+  // The parameters are declared, the registration must not be repeated
+  configured_ = true;
+
+  response->success = sendDeferredCommands();
+}
+
+void ConfigurationManager::registerParameters()
+{
   robot_manager_node_->registerParameter<int>(
-    "send_period_ms", 10, kuka_drivers_core::ParameterSetAccessRights {false, true, false, false,
+    "send_period_ms", 10, kuka_drivers_core::ParameterSetAccessRights {false, true, true, false,
       true}, [this](const int & send_period) {
       return this->onSendPeriodChangeRequest(send_period);
     });
@@ -303,6 +650,18 @@ void ConfigurationManager::setParameters(std_srvs::srv::Trigger::Response::Share
       return this->onJointDampingChangeRequest(joint_damping);
     });
 
+  robot_manager_node_->registerParameter<std::vector<double>>(
+    "cartesian_stiffness", cartesian_stiffness_, kuka_drivers_core::ParameterSetAccessRights {
+      false, true, true, false, true}, [this](const std::vector<double> & cartesian_stiffness) {
+      return this->onCartesianStiffnessChangeRequest(cartesian_stiffness);
+    });
+
+  robot_manager_node_->registerParameter<std::vector<double>>(
+    "cartesian_damping", cartesian_damping_, kuka_drivers_core::ParameterSetAccessRights {
+      false, true, true, false, true}, [this](const std::vector<double> & cartesian_damping) {
+      return this->onCartesianDampingChangeRequest(cartesian_damping);
+    });
+
   robot_manager_node_->registerParameter<std::string>(
     "control_mode", POSITION_CONTROL, kuka_drivers_core::ParameterSetAccessRights {false, true,
       true,
@@ -313,13 +672,19 @@ void ConfigurationManager::setParameters(std_srvs::srv::Trigger::Response::Share
   robot_manager_node_->registerParameter<std::string>(
     "position_controller_name", "", kuka_drivers_core::ParameterSetAccessRights {false, true,
       false, false, true}, [this](const std::string & controller_name) {
-      return this->onControllerNameChangeRequest(controller_name, true);
+      return this->onControllerNameChangeRequest(controller_name, POSITION_COMMAND);
     });
 
   robot_manager_node_->registerParameter<std::string>(
     "torque_controller_name", "", kuka_drivers_core::ParameterSetAccessRights {false, true,
       false, false, true}, [this](const std::string & controller_name) {
-      return this->onControllerNameChangeRequest(controller_name, false);
+      return this->onControllerNameChangeRequest(controller_name, TORQUE_COMMAND);
+    });
+
+  robot_manager_node_->registerParameter<std::string>(
+    "wrench_controller_name", "", kuka_drivers_core::ParameterSetAccessRights {false, true,
+      false, false, true}, [this](const std::string & controller_name) {
+      return this->onControllerNameChangeRequest(controller_name, WRENCH_COMMAND);
     });
 
   robot_manager_node_->registerParameter<std::string>(
@@ -330,13 +695,30 @@ void ConfigurationManager::setParameters(std_srvs::srv::Trigger::Response::Share
     });
 
   robot_manager_node_->registerParameter<int>(
-    "receive_multiplier", 1, kuka_drivers_core::ParameterSetAccessRights {false, true, false,
+    "receive_multiplier", 1, kuka_drivers_core::ParameterSetAccessRights {false, true, true,
       false,
       true}, [this](const int & receive_multiplier) {
       return this->onReceiveMultiplierChangeRequest(receive_multiplier);
     });
 
-  configured_ = true;
-  response->success = true;
+  robot_manager_node_->registerParameter<bool>(
+    "interpolate_commands", false, kuka_drivers_core::ParameterSetAccessRights {false, true,
+      false, false, true}, [](const bool &) {
+      return true;
+    });
+
+  // Port of the hardware interface, FRI allows the range 30200-30209
+  robot_manager_node_->registerParameter<int>(
+    "client_port", 30200, kuka_drivers_core::ParameterSetAccessRights {false, true, false,
+      false, true}, [this](const int & client_port) {
+      return this->onClientPortChangeRequest(client_port);
+    });
+
+  // Only the state is streamed, no controllers are activated and the robot is not commanded
+  robot_manager_node_->registerParameter<bool>(
+    "monitoring_only", false, kuka_drivers_core::ParameterSetAccessRights {false, true,
+      false, false, true}, [](const bool &) {
+      return true;
+    });
 }
 }  // namespace kuka_sunrise_fri_driver
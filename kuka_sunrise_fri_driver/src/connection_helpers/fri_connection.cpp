@@ -28,25 +28,35 @@ FRIConnection::FRIConnection(
   std::function<void(void)> handle_control_ended_error_callback,
   std::function<void(void)> handle_fri_ended_callback)
 : handleControlEndedError_(handle_control_ended_error_callback),
-  handleFRIEndedError_(handle_fri_ended_callback), last_command_state_(ACCEPTED),
-  last_command_id_(CONNECT), last_command_success_(NO_SUCCESS), answer_wanted_(false),
-  answer_received_(false)
+  handleFRIEndedError_(handle_fri_ended_callback)
 {
+  error_worker_ = std::thread(&FRIConnection::handleErrorEvents, this);
 }
 
 FRIConnection::~FRIConnection()
 {
   disconnect();
+  {
+    std::lock_guard<std::mutex> lk(error_mutex_);
+    error_worker_running_ = false;
+  }
+  error_cv_.notify_one();
+  error_worker_.join();
 }
 
 bool FRIConnection::connect(const char * server_addr, int server_port)
 {
   // TODO(resizoltan) check if already connected
+  server_addr_ = server_addr;
+  server_port_ = server_port;
+  tcp_connection_.reset();
   try {
     tcp_connection_ = std::make_unique<TCPConnection>(
       server_addr,
       server_port,
-      [this](std::vector<std::uint8_t> data) {this->handleReceivedTCPData(data);},
+      [this](const std::uint8_t * data, std::size_t size) {
+        this->handleReceivedTCPData(data, size);
+      },
       [this](const char * server_addr,
       int server_port) {this->connectionLostCallback(server_addr, server_port);});
   } catch (...) {
@@ -91,59 +101,93 @@ bool FRIConnection::deactivateControl()
   return sendCommandAndWait(DEACTIVATE_CONTROL);
 }
 
-bool FRIConnection::setPositionControlMode()
+FRIConnection::Command FRIConnection::makePositionControlModeCommand()
 {
-  std::vector<std::uint8_t> command_data = {POSITION_CONTROL_MODE};
-  return sendCommandAndWait(SET_CONTROL_MODE, command_data);
+  return Command{SET_CONTROL_MODE, {POSITION_CONTROL_MODE}};
 }
 
-bool FRIConnection::setJointImpedanceControlMode(
+FRIConnection::Command FRIConnection::makeJointImpedanceControlModeCommand(
   const std::vector<double> & joint_stiffness,
   const std::vector<double> & joint_damping)
 {
-  int msg_size = 0;
-  printf("Sizeof(double) = %lu\n", sizeof(double));
-  printf(
-    "Joint_stiffness size: %lu, joint damping size: %lu\n", joint_stiffness.size(),
-    joint_damping.size());
-  std::vector<std::uint8_t> serialized;
-  serialized.reserve(1 + CONTROL_MODE_HEADER.size() + 2 * 7 * sizeof(double));
-  serialized.emplace_back(JOINT_IMPEDANCE_CONTROL_MODE);
-  msg_size++;
-  for (std::uint8_t byte : CONTROL_MODE_HEADER) {
-    serialized.emplace_back(byte);
-    msg_size++;
-  }
-  for (double js : joint_stiffness) {
-    printf("js = %lf\n", js);
-    msg_size += kuka_drivers_core::serializeNext(js, serialized);
+  return Command{SET_CONTROL_MODE, serializeImpedance(
+      JOINT_IMPEDANCE_CONTROL_MODE, CONTROL_MODE_HEADER, joint_stiffness, joint_damping)};
+}
+
+FRIConnection::Command FRIConnection::makeCartesianImpedanceControlModeCommand(
+  const std::vector<double> & cartesian_stiffness,
+  const std::vector<double> & cartesian_damping)
+{
+  return Command{SET_CONTROL_MODE, serializeImpedance(
+      CARTESIAN_IMPEDANCE_CONTROL_MODE, CARTESIAN_CONTROL_MODE_HEADER, cartesian_stiffness,
+      cartesian_damping)};
+}
+
+std::vector<std::uint8_t> FRIConnection::serializeImpedance(
+  ControlModeID control_mode, const std::vector<std::uint8_t> & header,
+  const std::vector<double> & stiffness, const std::vector<double> & damping)
+{
+  // Sized exactly, so the writer cannot run out of space
+  std::vector<std::uint8_t> serialized(
+    1 + header.size() + (stiffness.size() + damping.size()) * sizeof(double));
+  kuka_drivers_core::BufferWriter writer(serialized.data(), serialized.size());
+  writer.writeUint8(control_mode);
+  writer.writeBytes(header.data(), header.size());
+  for (double value : stiffness) {
+    writer.writeDouble(value);
   }
-  for (double jd : joint_damping) {
-    printf("jd = %lf\n", jd);
-    msg_size += kuka_drivers_core::serializeNext(jd, serialized);
+  for (double value : damping) {
+    writer.writeDouble(value);
   }
-  return sendCommandAndWait(SET_CONTROL_MODE, serialized);
+  return serialized;
+}
+
+FRIConnection::Command FRIConnection::makeClientCommandModeCommand(
+  ClientCommandModeID client_command_mode)
+{
+  return Command{SET_COMMAND_MODE, {client_command_mode}};
+}
+
+FRIConnection::Command FRIConnection::makeFRIConfigCommand(
+  int remote_port, int send_period_ms, int receive_multiplier)
+{
+  std::vector<std::uint8_t> serialized(FRI_CONFIG_HEADER.size() + 3 * sizeof(std::int32_t));
+  kuka_drivers_core::BufferWriter writer(serialized.data(), serialized.size());
+  writer.writeBytes(FRI_CONFIG_HEADER.data(), FRI_CONFIG_HEADER.size());
+  writer.writeInt32(remote_port);
+  writer.writeInt32(send_period_ms);
+  writer.writeInt32(receive_multiplier);
+  return Command{SET_FRI_CONFIG, serialized};
+}
+
+bool FRIConnection::setPositionControlMode()
+{
+  return sendCommandAndWait(makePositionControlModeCommand());
+}
+
+bool FRIConnection::setJointImpedanceControlMode(
+  const std::vector<double> & joint_stiffness,
+  const std::vector<double> & joint_damping)
+{
+  return sendCommandAndWait(makeJointImpedanceControlModeCommand(joint_stiffness, joint_damping));
+}
+
+bool FRIConnection::setCartesianImpedanceControlMode(
+  const std::vector<double> & cartesian_stiffness,
+  const std::vector<double> & cartesian_damping)
+{
+  return sendCommandAndWait(
+    makeCartesianImpedanceControlModeCommand(cartesian_stiffness, cartesian_damping));
 }
 
 bool FRIConnection::setClientCommandMode(ClientCommandModeID client_command_mode)
 {
-  std::vector<std::uint8_t> command_data = {client_command_mode};
-  return sendCommandAndWait(SET_COMMAND_MODE, command_data);
+  return sendCommandAndWait(makeClientCommandModeCommand(client_command_mode));
 }
 
 bool FRIConnection::setFRIConfig(int remote_port, int send_period_ms, int receive_multiplier)
 {
-  std::vector<std::uint8_t> serialized;
-  serialized.reserve(FRI_CONFIG_HEADER.size() + 3 * sizeof(int));
-  int msg_size = 0;
-  for (std::uint8_t byte : FRI_CONFIG_HEADER) {
-    serialized.emplace_back(byte);
-    msg_size++;
-  }
-  msg_size += kuka_drivers_core::serializeNext(remote_port, serialized);
-  msg_size += kuka_drivers_core::serializeNext(send_period_ms, serialized);
-  msg_size += kuka_drivers_core::serializeNext(receive_multiplier, serialized);
-  return sendCommandAndWait(SET_FRI_CONFIG, serialized);
+  return sendCommandAndWait(makeFRIConfigCommand(remote_port, send_period_ms, receive_multiplier));
 }
 
 bool FRIConnection::isConnected()
@@ -155,129 +199,173 @@ bool FRIConnection::isConnected()
   }
 }
 
-
-bool FRIConnection::assertLastCommandSuccess(CommandID command_id)
+bool FRIConnection::sendCommandAndWait(CommandID command_id)
 {
-  // TODO(resizoltan) more sophisticated introspection
-  if (last_command_state_ == ACCEPTED && last_command_id_ == command_id &&
-    last_command_success_ == SUCCESS)
-  {
-    return true;
-  } else {
-    return false;
-  }
+  return sendCommandAndWait(Command{command_id, {}});
 }
 
-bool FRIConnection::sendCommandAndWait(CommandID command_id)
+bool FRIConnection::sendCommandAndWait(const Command & command)
 {
-  answer_wanted_ = true;
-  tcp_connection_->sendByte(command_id);
-  std::unique_lock<std::mutex> lk(m_);
-  cv_.wait(
-    lk, [this]
-    {return answer_received_;});
-  answer_received_ = false;
-  answer_wanted_ = false;
-  return assertLastCommandSuccess(command_id);
+  return sendCommandsAndWait({command}).front();
 }
 
-bool FRIConnection::sendCommandAndWait(
-  CommandID command_id,
-  const std::vector<std::uint8_t> & command_data)
+std::vector<bool> FRIConnection::sendCommandsAndWait(const std::vector<Command> & commands)
 {
+  std::lock_guard<std::mutex> send_lk(send_mutex_);
+  if (commands.empty()) {
+    return {};
+  }
+  {
+    std::lock_guard<std::mutex> lk(m_);
+    pending_ids_.clear();
+    for (const auto & command : commands) {
+      pending_ids_.push_back(command.id);
+    }
+    answered_.assign(commands.size(), false);
+    results_.assign(commands.size(), false);
+    answers_remaining_ = commands.size();
+  }
+
   std::vector<std::uint8_t> msg;
-  msg.push_back(command_id);
-  msg.insert(msg.end(), command_data.begin(), command_data.end());
-  answer_wanted_ = true;
-  tcp_connection_->sendBytes(msg);
+  for (const auto & command : commands) {
+    msg.clear();
+    msg.push_back(command.id);
+    msg.insert(msg.end(), command.data.begin(), command.data.end());
+    if (!tcp_connection_ || !tcp_connection_->sendBytes(msg)) {
+      std::lock_guard<std::mutex> lk(m_);
+      completeAllCommands();
+      break;
+    }
+  }
+
   std::unique_lock<std::mutex> lk(m_);
   cv_.wait(
     lk, [this]
-    {return answer_received_;});
-  answer_received_ = false;
-  answer_wanted_ = false;
-  return assertLastCommandSuccess(command_id);
+    {return answers_remaining_ == 0;});
+  return results_;
 }
 
-void FRIConnection::handleReceivedTCPData(const std::vector<std::uint8_t> & data)
+void FRIConnection::completeCommand(const CommandID * command_id, bool success)
 {
-  if (data.size() == 0) {
+  for (std::size_t i = 0; i < pending_ids_.size(); ++i) {
+    if (!answered_[i] && (command_id == nullptr || pending_ids_[i] == *command_id)) {
+      answered_[i] = true;
+      results_[i] = success;
+      if (--answers_remaining_ == 0) {
+        cv_.notify_one();
+      }
+      return;
+    }
+  }
+  // Replies to an unknown command ID complete the oldest command as failed
+  if (command_id != nullptr) {
+    completeCommand(nullptr, false);
+  }
+}
+
+void FRIConnection::completeAllCommands()
+{
+  while (answers_remaining_ > 0) {
+    completeCommand(nullptr, false);
+  }
+}
+
+void FRIConnection::handleReceivedTCPData(const std::uint8_t * data, std::size_t size)
+{
+  if (size == 0) {
     return;
   }
-  pthread_t handler_thread;
   std::lock_guard<std::mutex> lk(m_);
-  // TODO(resizoltan) handle invalid data
+  const bool answer_wanted = answers_remaining_ > 0;
   switch ((CommandState)data[0]) {
     case ACCEPTED:
-      if (data.size() < 3) {
-        // TODO(resizoltan) error
+      if (size < 3) {
+        completeCommand(nullptr, false);
+        break;
+      }
+      {
+        const auto command_id = static_cast<CommandID>(data[1]);
+        completeCommand(&command_id, static_cast<CommandSuccess>(data[2]) == SUCCESS);
       }
-      last_command_state_ = ACCEPTED;
-      last_command_id_ = (CommandID)data[1];
-      last_command_success_ = (CommandSuccess)data[2];
-      answer_received_ = true;
-      cv_.notify_one();
       break;
     case REJECTED:
-      if (data.size() < 2) {
-        // TODO(resizoltan) error
+      if (size < 2) {
+        completeCommand(nullptr, false);
+        break;
+      }
+      {
+        const auto command_id = static_cast<CommandID>(data[1]);
+        completeCommand(&command_id, false);
       }
-      last_command_state_ = REJECTED;
-      last_command_id_ = (CommandID)data[1];
-      answer_received_ = true;
-      cv_.notify_one();
-      break;
-    case UNKNOWN:
-      last_command_state_ = UNKNOWN;
-      answer_received_ = true;
-      cv_.notify_one();
       break;
     case ERROR_CONTROL_ENDED:
-      if (answer_wanted_) {
-        last_command_state_ = ERROR_CONTROL_ENDED;
-        answer_received_ = true;
-        cv_.notify_one();
+      if (answer_wanted) {
+        completeCommand(nullptr, false);
       } else {
-        pthread_create(
-          &handler_thread,
-          nullptr,
-          [](void * self) -> void * {
-            static_cast<FRIConnection *>(self)->handleControlEndedError_();
-            return nullptr;
-          },
-          this);
-        pthread_detach(handler_thread);  // TODO(resizoltan) ther might be a better way to do this
+        postErrorEvent(ErrorEvent::CONTROL_ENDED);
       }
       break;
     case ERROR_FRI_ENDED:
-      if (answer_wanted_) {
-        last_command_state_ = ERROR_FRI_ENDED;
-        answer_received_ = true;
-        cv_.notify_one();
+      if (answer_wanted) {
+        completeCommand(nullptr, false);
       } else {
-        pthread_create(
-          &handler_thread,
-          nullptr,
-          [](void * self) -> void * {
-            static_cast<FRIConnection *>(self)->handleFRIEndedError_();
-            return nullptr;
-          },
-          this);
-        pthread_detach(handler_thread);  // TODO(resizoltan) ther might be a better way to do this
+        postErrorEvent(ErrorEvent::FRI_ENDED);
       }
       break;
+    case UNKNOWN:
     default:
-      last_command_state_ = UNKNOWN;
-      answer_received_ = true;
-      cv_.notify_one();
+      completeCommand(nullptr, false);
       break;
   }
 }
 
-void FRIConnection::connectionLostCallback(const char * server_addr, int server_port)
+void FRIConnection::connectionLostCallback(const char *, int)
 {
-  printf("Connection lost, trying to reconnect");
-  connect(server_addr, server_port);
+  printf("Connection lost, trying to reconnect\n");
+  {
+    // The pending commands are not answered anymore
+    std::lock_guard<std::mutex> lk(m_);
+    completeAllCommands();
+  }
+  // The connection is replaced by the worker, as the event loop cannot join itself
+  postErrorEvent(ErrorEvent::CONNECTION_LOST);
+}
+
+void FRIConnection::postErrorEvent(ErrorEvent event)
+{
+  // Only the event loop of the TCP connection produces events
+  if (!error_events_.Push(event)) {
+    printf("Error event queue is full, dropping event\n");
+    return;
+  }
+  std::lock_guard<std::mutex> lk(error_mutex_);
+  error_cv_.notify_one();
+}
+
+void FRIConnection::handleErrorEvents()
+{
+  std::unique_lock<std::mutex> lk(error_mutex_);
+  while (error_worker_running_) {
+    ErrorEvent event;
+    if (!error_events_.Pop(event)) {
+      error_cv_.wait(lk);
+      continue;
+    }
+    // The handlers may send commands, which are answered by the event loop
+    lk.unlock();
+    switch (event) {
+      case ErrorEvent::CONTROL_ENDED:
+        handleControlEndedError_();
+        break;
+      case ErrorEvent::FRI_ENDED:
+        handleFRIEndedError_();
+        break;
+      case ErrorEvent::CONNECTION_LOST:
+        connect(server_addr_.c_str(), server_port_);
+        break;
+    }
+    lk.lock();
+  }
 }
 
 }  // namespace kuka_sunrise_fri_driver
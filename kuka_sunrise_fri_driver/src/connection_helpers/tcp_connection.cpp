@@ -12,6 +12,12 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <poll.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
 #include <stdexcept>
 #include <vector>
 #include <string>
@@ -23,7 +29,7 @@ namespace kuka_sunrise_fri_driver
 
 TCPConnection::TCPConnection(
   const char * server_addr, int server_port,
-  std::function<void(const std::vector<std::uint8_t> &)> data_received_callback,
+  std::function<void(const std::uint8_t *, std::size_t)> data_received_callback,
   std::function<void(const char * server_addr, const int server_port)> connection_lost_callback)
 : dataReceivedCallback_(data_received_callback), connectionLostCallback_(
     connection_lost_callback), socket_desc_(socket(AF_INET, SOCK_STREAM, 0)), cancelled_(false)
@@ -40,69 +46,129 @@ TCPConnection::TCPConnection(
   server_.sin_family = AF_INET;
   server_.sin_port = htons(server_port);
   if (connect(socket_desc_, (struct sockaddr *)&server_, sizeof(server_))) {
+    close(socket_desc_);
     throw std::runtime_error("Could not connect to server");
   }
-  pthread_create(&read_thread_, NULL, &TCPConnection::listen_helper, this);
+  if (pipe(wakeup_pipe_) == -1) {
+    close(socket_desc_);
+    throw std::runtime_error("Could not create wakeup pipe");
+  }
+  read_thread_ = std::thread(&TCPConnection::listen, this);
 }
 
 bool TCPConnection::sendByte(std::uint8_t data)
 {
-  int sent_length = write(socket_desc_, &data, 1);
-  if (sent_length < 0) {
-    return false;
-  }  // TODO(resizoltan) handle other kind of errors?
-  return true;
+  return sendMessage(&data, 1);
 }
 
 bool TCPConnection::sendBytes(const std::vector<std::uint8_t> & data)
 {
-  int sent_length = write(socket_desc_, data.data(), data.size());
-  if (sent_length < 0) {
+  return sendMessage(data.data(), data.size());
+}
+
+bool TCPConnection::sendMessage(const std::uint8_t * data, std::size_t size)
+{
+  if (size > kMaxMessageSize) {
     return false;
-  }  // TODO(resizoltan) handle other kind of errors?
+  }
+  std::uint8_t frame[kHeaderSize + kMaxMessageSize];
+  frame[0] = static_cast<std::uint8_t>(size >> 8);
+  frame[1] = static_cast<std::uint8_t>(size & 0xFF);
+  std::memcpy(frame + kHeaderSize, data, size);
+  std::size_t sent = 0;
+  while (sent < kHeaderSize + size) {
+    const ssize_t length = write(socket_desc_, frame + sent, kHeaderSize + size - sent);
+    if (length < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    sent += length;
+  }
   return true;
 }
 
 void TCPConnection::closeConnection()
 {
-  // TODO(resizoltan) what happens upon multiple calls to close?
-  cancelled_.store(true);
-  pthread_cancel(read_thread_);
-  close(socket_desc_);
-  // pthread_join(read_thread_, NULL);
-  // TODO(resizoltan) handle errors of close?
+  if (!cancelled_.exchange(true)) {
+    const std::uint8_t wakeup = 0;
+    if (write(wakeup_pipe_[1], &wakeup, 1) < 0) {
+      // The event loop still stops at the shutdown of the socket
+    }
+    shutdown(socket_desc_, SHUT_RDWR);
+  }
+  if (read_thread_.joinable()) {
+    read_thread_.join();
+  }
+  if (socket_desc_ != -1) {
+    close(socket_desc_);
+    close(wakeup_pipe_[0]);
+    close(wakeup_pipe_[1]);
+    socket_desc_ = -1;
+  }
 }
 
 TCPConnection::~TCPConnection()
 {
   closeConnection();
-  // TODO(resizoltan) handle errors of close?
-}
-
-void * TCPConnection::listen_helper(void * tcpConnection)
-{
-  reinterpret_cast<TCPConnection *>(tcpConnection)->listen();
-  return NULL;
 }
 
 void TCPConnection::listen()
 {
-  std::uint8_t msg_buffer[300];
+  struct pollfd descriptors[2] = {{socket_desc_, POLLIN, 0}, {wakeup_pipe_[0], POLLIN, 0}};
   while (!cancelled_.load()) {
-    int length = recv(socket_desc_, msg_buffer, 300, 0);
-    if (length < 0) {
-      if (cancelled_.load()) {
-        break;
+    if (poll(descriptors, 2, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
       }
-      // TODO(resizoltan) handle error
-    } else if (length == 0) {  // TODO(resizoltan) is this the way to check for connection loss?
-      connectionLostCallback_(inet_ntoa(server_.sin_addr), ntohs(server_.sin_port));
       break;
-    } else {
-      std::vector<std::uint8_t> server_msg(msg_buffer, msg_buffer + length);
-      dataReceivedCallback_(server_msg);
     }
+    if (descriptors[1].revents != 0 || cancelled_.load()) {
+      break;
+    }
+    if (descriptors[0].revents == 0) {
+      continue;
+    }
+    const ssize_t length = recv(socket_desc_, buffer_ + buffered_, sizeof(buffer_) - buffered_, 0);
+    if (length < 0 && (errno == EINTR || errno == EAGAIN)) {
+      continue;
+    }
+    if (length <= 0) {
+      if (!cancelled_.load()) {
+        connectionLostCallback_(inet_ntoa(server_.sin_addr), ntohs(server_.sin_port));
+      }
+      break;
+    }
+    buffered_ += length;
+    dispatchMessages();
+  }
+}
+
+void TCPConnection::dispatchMessages()
+{
+  std::size_t offset = 0;
+  if (discarded_ > 0) {
+    offset = std::min(discarded_, buffered_);
+    discarded_ -= offset;
+  }
+  while (buffered_ - offset >= kHeaderSize) {
+    const std::size_t size = (buffer_[offset] << 8) | buffer_[offset + 1];
+    if (size > kMaxMessageSize) {
+      printf("Skipping message of %zu bytes from the robot application\n", size);
+      const std::size_t available = std::min(buffered_ - offset, kHeaderSize + size);
+      discarded_ = kHeaderSize + size - available;
+      offset += available;
+      continue;
+    }
+    if (buffered_ - offset < kHeaderSize + size) {
+      break;
+    }
+    dataReceivedCallback_(buffer_ + offset + kHeaderSize, size);
+    offset += kHeaderSize + size;
   }
+  std::memmove(buffer_, buffer_ + offset, buffered_ - offset);
+  buffered_ -= offset;
 }
 
 }  // namespace kuka_sunrise_fri_driver
@@ -0,0 +1,136 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <pthread.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "kuka_sunrise_fri_driver/frame_streamer.hpp"
+
+namespace kuka_sunrise_fri_driver
+{
+FrameStreamer::~FrameStreamer()
+{
+  stop();
+}
+
+bool FrameStreamer::configure(const std::vector<std::string> & ids)
+{
+  if (ids.size() > kMaxFrames) {
+    return false;
+  }
+  frames_.clear();
+  frames_.resize(ids.size());
+  for (std::size_t i = 0; i < ids.size(); ++i) {
+    frames_[i].id = ids[i];
+  }
+  return true;
+}
+
+void FrameStreamer::start(const std::string & node_name, const std::string & topic)
+{
+  if (!enabled() || spin_thread_.joinable()) {
+    return;
+  }
+  if (!node_) {
+    node_ = rclcpp::Node::make_shared(node_name);
+    subscription_ = node_->create_subscription<geometry_msgs::msg::TransformStamped>(
+      topic, rclcpp::SystemDefaultsQoS(),
+      [this](const geometry_msgs::msg::TransformStamped::SharedPtr msg) {onTransform(msg);});
+    executor_ = std::make_shared<rclcpp::executors::SingleThreadedExecutor>();
+    executor_->add_node(node_);
+  }
+  spin_thread_ = std::thread(
+    [this]() {
+      // Threads inherit the real-time scheduling of the control loop, which is not needed here
+      struct sched_param param;
+      param.sched_priority = 0;
+      pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+      executor_->spin();
+    });
+}
+
+void FrameStreamer::stop()
+{
+  if (executor_) {
+    executor_->cancel();
+  }
+  if (spin_thread_.joinable()) {
+    spin_thread_.join();
+  }
+}
+
+void FrameStreamer::onTransform(const geometry_msgs::msg::TransformStamped::SharedPtr msg)
+{
+  Update update;
+  for (update.index = 0; update.index < frames_.size(); ++update.index) {
+    if (frames_[update.index].id == msg->child_frame_id) {
+      break;
+    }
+  }
+  if (update.index == frames_.size()) {
+    RCLCPP_WARN_ONCE(
+      node_->get_logger(), "Frame %s is not streamed to the controller",
+      msg->child_frame_id.c_str());
+    return;
+  }
+
+  const auto & q = msg->transform.rotation;
+  const auto & t = msg->transform.translation;
+  update.matrix[0][0] = 1 - 2 * (q.y * q.y + q.z * q.z);
+  update.matrix[0][1] = 2 * (q.x * q.y - q.z * q.w);
+  update.matrix[0][2] = 2 * (q.x * q.z + q.y * q.w);
+  update.matrix[1][0] = 2 * (q.x * q.y + q.z * q.w);
+  update.matrix[1][1] = 1 - 2 * (q.x * q.x + q.z * q.z);
+  update.matrix[1][2] = 2 * (q.y * q.z - q.x * q.w);
+  update.matrix[2][0] = 2 * (q.x * q.z - q.y * q.w);
+  update.matrix[2][1] = 2 * (q.y * q.z + q.x * q.w);
+  update.matrix[2][2] = 1 - 2 * (q.x * q.x + q.y * q.y);
+  update.matrix[0][3] = t.x * 1000;
+  update.matrix[1][3] = t.y * 1000;
+  update.matrix[2][3] = t.z * 1000;
+
+  if (!updates_.Push(update)) {
+    RCLCPP_WARN_THROTTLE(
+      node_->get_logger(), *node_->get_clock(), 1000,
+      "Frame updates are not consumed by the control loop, dropping %s",
+      msg->child_frame_id.c_str());
+  }
+}
+
+void FrameStreamer::provide()
+{
+  // The ROS clock is not synchronized to the controller, so new values get the timestamp of the
+  //  monitoring message in which they are first sent
+  Update update;
+  while (updates_.Pop(update)) {
+    Frame & frame = frames_[update.index];
+    std::memcpy(frame.matrix, update.matrix, sizeof(frame.matrix));
+    frame.valid = true;
+    frame.sec = getTimestampSec();
+    frame.nanosec = getTimestampNanoSec();
+  }
+
+  for (const char * requested : getRequestedTransformationIDs()) {
+    for (const Frame & frame : frames_) {
+      if (frame.valid && std::strcmp(frame.id.c_str(), requested) == 0) {
+        setTransformation(requested, frame.matrix, frame.sec, frame.nanosec);
+        break;
+      }
+    }
+  }
+}
+}  // namespace kuka_sunrise_fri_driver
@@ -1,119 +1,180 @@
-#include <fri_client_sdk/HWIFClientApplication.hpp>
-#include <iostream>
-
-
-namespace KUKA
-{
-namespace FRI
-{
-
-HWIFClientApplication::HWIFClientApplication(IConnection & connection, IClient & client)
-: ClientApplication(connection, client) {}
-
-bool HWIFClientApplication::client_app_read()
-{
-  if (!_connection.isOpen()) {
-    std::cout << "Error: client application is not connected!" << std::endl;
-    return false;
-  }
-
-  // **************************************************************************
-  // Receive and decode new monitoring message
-  // **************************************************************************
-  size_ = _connection.receive(_data->receiveBuffer, FRI_MONITOR_MSG_MAX_SIZE);
-
-  if (size_ <= 0) { // TODO: size_ == 0 -> connection closed (maybe go to IDLE instead of stopping?)
-    std::cout << "Error: failed while trying to receive monitoring message!" << std::endl;
-    return false;
-  }
-
-  if (!_data->decoder.decode(_data->receiveBuffer, size_)) {
-    std::cout << "Error: failed to decode message" << std::endl;
-    return false;
-  }
-
-  // check message type (so that our wrappers match)
-  if (_data->expectedMonitorMsgID != _data->monitoringMsg.header.messageIdentifier) {
-    std::cout << "Error: incompatible IDs for received message, got: " <<
-      _data->monitoringMsg.header.messageIdentifier << " expected: " <<
-      _data->expectedMonitorMsgID << std::endl;
-    return false;
-  }
-
-  return true;
-}
-
-void HWIFClientApplication::client_app_update()
-{
-  // **************************************************************************
-  // callbacks
-  // **************************************************************************
-  // reset commmand message before callbacks
-  _data->resetCommandMessage();
-
-  // callbacks for robot client
-  ESessionState currentState = (ESessionState)_data->monitoringMsg.connectionInfo.sessionState;
-
-  if (_data->lastState != currentState) {
-    _robotClient->onStateChange(_data->lastState, currentState);
-    _data->lastState = currentState;
-  }
-
-  switch (currentState) {
-    case MONITORING_WAIT:
-    case MONITORING_READY:
-      _robotClient->monitor();
-      break;
-    case COMMANDING_WAIT:
-      _robotClient->waitForCommand();
-      break;
-    case COMMANDING_ACTIVE:
-      _robotClient->command();
-      break;
-    case IDLE:
-    default:
-      return;    // nothing to send back
-  }
-
-  // callback for transformation client
-  if (_trafoClient != NULL) {
-    _trafoClient->provide();
-  }
-}
-
-
-bool HWIFClientApplication::client_app_write()
-{
-  // **************************************************************************
-  // Encode and send command message
-  // **************************************************************************
-
-  _data->lastSendCounter++;
-  // check if its time to send an answer
-  if (_data->lastSendCounter >= _data->monitoringMsg.connectionInfo.receiveMultiplier) {
-    _data->lastSendCounter = 0;
-
-    // set sequence counters
-    _data->commandMsg.header.sequenceCounter = _data->sequenceCounter++;
-    _data->commandMsg.header.reflectedSequenceCounter =
-      _data->monitoringMsg.header.sequenceCounter;
-
-    if (!_data->encoder.encode(_data->sendBuffer, size_)) {
-      return false;
-    }
-
-    if (!_connection.isOpen()) {
-      std::cout << "Client application connection closed" << std::endl;
-      return false;
-    }
-
-    if (!_connection.send(_data->sendBuffer, size_)) {
-      std::cout << "Error: failed while trying to send command message!" << std::endl;
-      return false;
-    }
-  }
-
-  return true;
-}
-}
-}  // namespace KUKA::FRI
+#include <fri_client_sdk/HWIFClientApplication.hpp>
+#include <cstdarg>
+#include <cstdio>
+
+#include "kuka_drivers_core/rt_log.hpp"
+#include "kuka_drivers_core/tracing.hpp"
+
+
+namespace KUKA
+{
+namespace FRI
+{
+
+HWIFClientApplication::HWIFClientApplication(IConnection & connection, IClient & client)
+: ClientApplication(connection, client) {}
+
+HWIFClientApplication::HWIFClientApplication(
+  IConnection & connection, IClient & client,
+  TransformationClient & trafoClient)
+: ClientApplication(connection, client, trafoClient) {}
+
+bool HWIFClientApplication::client_app_read()
+{
+  if (!_connection.isOpen()) {
+    log_error("Error: client application is not connected!");
+    return false;
+  }
+
+  // **************************************************************************
+  // Receive and decode new monitoring message
+  // **************************************************************************
+  size_ = _connection.receive(_data->receiveBuffer, FRI_MONITOR_MSG_MAX_SIZE);
+
+  if (size_ <= 0) { // TODO: size_ == 0 -> connection closed (maybe go to IDLE instead of stopping?)
+    log_error("Error: failed while trying to receive monitoring message!");
+    return false;
+  }
+
+  namespace tracing = kuka_drivers_core::tracing;
+  tracing::PhaseBegin(tracing::Phase::DECODE, this);
+  const bool decoded = _data->decoder.decode(_data->receiveBuffer, size_);
+  tracing::PhaseEnd(tracing::Phase::DECODE, this);
+  if (!decoded) {
+    log_error("Error: failed to decode message");
+    return false;
+  }
+
+  // check message type (so that our wrappers match)
+  if (_data->expectedMonitorMsgID != _data->monitoringMsg.header.messageIdentifier) {
+    log_error(
+      "Error: incompatible IDs for received message, got: %u expected: %u",
+      static_cast<unsigned int>(_data->monitoringMsg.header.messageIdentifier),
+      static_cast<unsigned int>(_data->expectedMonitorMsgID));
+    return false;
+  }
+
+  return true;
+}
+
+void HWIFClientApplication::client_app_update()
+{
+  // **************************************************************************
+  // callbacks
+  // **************************************************************************
+  // reset commmand message before callbacks
+  _data->resetCommandMessage();
+
+  // callbacks for robot client
+  ESessionState currentState = (ESessionState)_data->monitoringMsg.connectionInfo.sessionState;
+
+  if (_data->lastState != currentState) {
+    _robotClient->onStateChange(_data->lastState, currentState);
+    _data->lastState = currentState;
+  }
+
+  switch (currentState) {
+    case MONITORING_WAIT:
+    case MONITORING_READY:
+      _robotClient->monitor();
+      break;
+    case COMMANDING_WAIT:
+      _robotClient->waitForCommand();
+      break;
+    case COMMANDING_ACTIVE:
+      _robotClient->command();
+      break;
+    case IDLE:
+    default:
+      return;    // nothing to send back
+  }
+
+  // callback for transformation client
+  if (_trafoClient != NULL) {
+    _trafoClient->provide();
+  }
+}
+
+
+bool HWIFClientApplication::client_app_write()
+{
+  // **************************************************************************
+  // Encode and send command message
+  // **************************************************************************
+
+  sent_ = false;
+  _data->lastSendCounter++;
+  // check if its time to send an answer
+  if (_data->lastSendCounter >= _data->monitoringMsg.connectionInfo.receiveMultiplier) {
+    _data->lastSendCounter = 0;
+
+    // set sequence counters
+    sent_counter_ = _data->sequenceCounter;
+    _data->commandMsg.header.sequenceCounter = _data->sequenceCounter++;
+    _data->commandMsg.header.reflectedSequenceCounter =
+      _data->monitoringMsg.header.sequenceCounter;
+
+    namespace tracing = kuka_drivers_core::tracing;
+    tracing::PhaseBegin(tracing::Phase::ENCODE, this);
+    const bool encoded = _data->encoder.encode(_data->sendBuffer, size_);
+    tracing::PhaseEnd(tracing::Phase::ENCODE, this);
+    if (!encoded) {
+      return false;
+    }
+
+    if (!_connection.isOpen()) {
+      log_error("Client application connection closed");
+      return false;
+    }
+
+    if (!_connection.send(_data->sendBuffer, size_)) {
+      log_error("Error: failed while trying to send command message!");
+      return false;
+    }
+    sent_ = true;
+  }
+
+  return true;
+}
+
+void HWIFClientApplication::set_log(kuka_drivers_core::RTLog * log)
+{
+  log_ = log;
+}
+
+uint32_t HWIFClientApplication::sequence_counter() const
+{
+  return _data->monitoringMsg.header.sequenceCounter;
+}
+
+uint32_t HWIFClientApplication::reflected_sequence_counter() const
+{
+  return _data->monitoringMsg.header.reflectedSequenceCounter;
+}
+
+bool HWIFClientApplication::sent_sequence_counter(uint32_t & counter) const
+{
+  counter = sent_counter_;
+  return sent_;
+}
+
+void HWIFClientApplication::set_decode_selection(
+  const MonitoringMessageDecoder::Selection & selection)
+{
+  _data->decoder.setSelection(selection);
+}
+
+void HWIFClientApplication::log_error(const char * format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  if (log_ != nullptr) {
+    log_->LogV(kuka_drivers_core::RTLog::Level::ERROR, format, args);
+  } else {
+    vprintf(format, args);
+    printf("\n");
+  }
+  va_end(args);
+}
+}
+}  // namespace KUKA::FRI
@@ -92,6 +92,8 @@ struct ClientData
   const size_t MAX_REQUESTED_TRANSFORMATIONS;      //!< maximum count of requested transformations
   const size_t MAX_SIZE_TRANSFORMATION_ID;         //!< maximum size in bytes of a transformation ID
   std::vector<const char *> requestedTrafoIDs;     //!< list of requested transformation ids
+  //! write requests prepared by LBRCommand, copied into the command message when set
+  FriIOValue ioSlots[sizeof(MessageCommandData::writeIORequest) / sizeof(FriIOValue)];
 
   ClientData(int numDofs)
   : decoder(&monitoringMsg, numDofs),
@@ -141,6 +143,24 @@ struct ClientData
     return getIOValue(message, name, FriIOType_ANALOG);
   }
 
+  //******************************************************************************
+  static const FriIOValue & getBooleanIOValue(const FRIMonitoringMessage * message, int index)
+  {
+    return getIOValue(message, index, FriIOType_BOOLEAN);
+  }
+
+  //******************************************************************************
+  static const FriIOValue & getDigitalIOValue(const FRIMonitoringMessage * message, int index)
+  {
+    return getIOValue(message, index, FriIOType_DIGITAL);
+  }
+
+  //******************************************************************************
+  static const FriIOValue & getAnalogIOValue(const FRIMonitoringMessage * message, int index)
+  {
+    return getIOValue(message, index, FriIOType_ANALOG);
+  }
+
   //******************************************************************************
   static void setBooleanIOValue(
     FRICommandMessage * message, const char * name, const bool value,
@@ -165,60 +185,158 @@ struct ClientData
     setIOValue(message, name, monMessage, FriIOType_ANALOG).analogValue = value;
   }
 
-protected:
   //******************************************************************************
-  static const FriIOValue & getIOValue(
-    const FRIMonitoringMessage * message, const char * name,
+  static void setBooleanIOValue(
+    FRICommandMessage * message, int index, const bool value,
+    const FRIMonitoringMessage * monMessage)
+  {
+    setIOValue(message, index, monMessage, FriIOType_BOOLEAN).digitalValue = value;
+  }
+
+  //******************************************************************************
+  static void setDigitalIOValue(
+    FRICommandMessage * message, int index, const unsigned long long value,
+    const FRIMonitoringMessage * monMessage)
+  {
+    setIOValue(message, index, monMessage, FriIOType_DIGITAL).digitalValue = value;
+  }
+
+  //******************************************************************************
+  static void setAnalogIOValue(
+    FRICommandMessage * message, int index, const double value,
+    const FRIMonitoringMessage * monMessage)
+  {
+    setIOValue(message, index, monMessage, FriIOType_ANALOG).analogValue = value;
+  }
+
+  //******************************************************************************
+  static void prepareIOSlot(
+    FriIOValue & slot, int index, const FRIMonitoringMessage * monMessage,
     const FriIOType ioType)
+  {
+    // validated like a write request, the name is terminated in the monitoring message
+    const FriIOValue & monValue = getIOValue(monMessage, index, ioType);
+    if (monValue.direction != FriIODirection_OUTPUT) {
+      throw FRIException("IO %s is not an output value.", monValue.name);
+    }
+    memcpy(slot.name, monValue.name, sizeof(slot.name));
+    slot.name[sizeof(slot.name) - 1] = 0;       // ensure termination
+    slot.type = ioType;
+    slot.has_digitalValue = (ioType == FriIOType_DIGITAL | ioType == FriIOType_BOOLEAN);
+    slot.digitalValue = 0;
+    slot.has_analogValue = (ioType == FriIOType_ANALOG);
+    slot.analogValue = 0;
+    slot.direction = FriIODirection_OUTPUT;
+  }
+
+  //******************************************************************************
+  static void writeIOSlot(FRICommandMessage * message, const FriIOValue & slot)
+  {
+    MessageCommandData & cmdData = message->commandData;
+    const size_t maxIOs = sizeof(cmdData.writeIORequest) / sizeof(cmdData.writeIORequest[0]);
+    if (cmdData.writeIORequest_count >= maxIOs) {
+      throw FRIException("Exceeded maximum number of IOs that can be set.");
+    }
+    cmdData.writeIORequest[cmdData.writeIORequest_count++] = slot;
+    message->has_commandData = true;
+  }
+
+  //******************************************************************************
+  static int findIOIndex(const FRIMonitoringMessage * message, const char * name)
   {
     if (message != NULL && message->has_monitorData == true) {
       const MessageMonitorData & monData = message->monitorData;
-      const bool analogValue = (ioType == FriIOType_ANALOG);
-      const bool digitalValue = (ioType == FriIOType_DIGITAL | ioType == FriIOType_BOOLEAN);
       for (size_t i = 0; i < monData.readIORequest_count; i++) {
-        const FriIOValue & ioValue = monData.readIORequest[i];
-        if (strcmp(name, ioValue.name) == 0) {
-          if (ioValue.type == ioType &&
-            ioValue.has_digitalValue == digitalValue &&
-            ioValue.has_analogValue == analogValue)
-          {
-            return ioValue;
-          }
-
-          const char * ioTypeName;
-          switch (ioType) {
-            case FriIOType_ANALOG: ioTypeName = "analog value"; break;
-            case FriIOType_DIGITAL: ioTypeName = "digital value"; break;
-            case FriIOType_BOOLEAN: ioTypeName = "boolean"; break;
-            default: ioTypeName = "?"; break;
-          }
-
-          throw FRIException("IO %s is not of type %s.", name, ioTypeName);
+        if (strcmp(name, monData.readIORequest[i].name) == 0) {
+          return static_cast<int>(i);
         }
       }
     }
+    return -1;
+  }
+
+  //******************************************************************************
+  static int getIOCount(const FRIMonitoringMessage * message)
+  {
+    if (message != NULL && message->has_monitorData == true) {
+      return static_cast<int>(message->monitorData.readIORequest_count);
+    }
+    return 0;
+  }
 
-    throw FRIException("Could not locate IO %s in monitor message.", name);
+protected:
+  //******************************************************************************
+  static const FriIOValue & getIOValue(
+    const FRIMonitoringMessage * message, const char * name,
+    const FriIOType ioType)
+  {
+    const int index = findIOIndex(message, name);
+    if (index < 0) {
+      throw FRIException("Could not locate IO %s in monitor message.", name);
+    }
+    return getIOValue(message, index, ioType);
+  }
+
+  //******************************************************************************
+  static const FriIOValue & getIOValue(
+    const FRIMonitoringMessage * message, const int index,
+    const FriIOType ioType)
+  {
+    if (index < 0 || index >= getIOCount(message)) {
+      throw FRIException("Invalid IO index for the monitor message.");
+    }
+    const FriIOValue & ioValue = message->monitorData.readIORequest[index];
+    const bool analogValue = (ioType == FriIOType_ANALOG);
+    const bool digitalValue = (ioType == FriIOType_DIGITAL | ioType == FriIOType_BOOLEAN);
+    if (ioValue.type == ioType &&
+      ioValue.has_digitalValue == digitalValue &&
+      ioValue.has_analogValue == analogValue)
+    {
+      return ioValue;
+    }
+
+    const char * ioTypeName;
+    switch (ioType) {
+      case FriIOType_ANALOG: ioTypeName = "analog value"; break;
+      case FriIOType_DIGITAL: ioTypeName = "digital value"; break;
+      case FriIOType_BOOLEAN: ioTypeName = "boolean"; break;
+      default: ioTypeName = "?"; break;
+    }
+
+    throw FRIException("IO %s is not of type %s.", ioValue.name, ioTypeName);
   }
 
   //******************************************************************************
   static FriIOValue & setIOValue(
     FRICommandMessage * message, const char * name,
     const FRIMonitoringMessage * monMessage, const FriIOType ioType)
+  {
+    const int index = findIOIndex(monMessage, name);
+    if (index < 0) {
+      throw FRIException("Could not locate IO %s in monitor message.", name);
+    }
+    return setIOValue(message, index, monMessage, ioType);
+  }
+
+  //******************************************************************************
+  static FriIOValue & setIOValue(
+    FRICommandMessage * message, const int index,
+    const FRIMonitoringMessage * monMessage, const FriIOType ioType)
   {
     MessageCommandData & cmdData = message->commandData;
     const size_t maxIOs = sizeof(cmdData.writeIORequest) / sizeof(cmdData.writeIORequest[0]);
     if (cmdData.writeIORequest_count < maxIOs) {
       // call getter which will raise an exception if the output doesn't exist
       // or is of wrong type.
-      if (getIOValue(monMessage, name, ioType).direction != FriIODirection_OUTPUT) {
-        throw FRIException("IO %s is not an output value.", name);
+      const FriIOValue & monValue = getIOValue(monMessage, index, ioType);
+      if (monValue.direction != FriIODirection_OUTPUT) {
+        throw FRIException("IO %s is not an output value.", monValue.name);
       }
 
-      // add IO value to command message
+      // add IO value to command message, the name is terminated in the monitoring message
       FriIOValue & ioValue = cmdData.writeIORequest[cmdData.writeIORequest_count];
 
-      strncpy(ioValue.name, name, sizeof(ioValue.name) - 1);
+      memcpy(ioValue.name, monValue.name, sizeof(ioValue.name));
       ioValue.name[sizeof(ioValue.name) - 1] = 0;       // ensure termination
       ioValue.type = ioType;
       ioValue.has_digitalValue = (ioType == FriIOType_DIGITAL | ioType == FriIOType_BOOLEAN);
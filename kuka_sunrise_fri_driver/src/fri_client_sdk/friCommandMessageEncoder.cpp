@@ -60,6 +60,10 @@ cost of any service and repair.
 #include <cstdio>
 #include <friCommandMessageEncoder.h>
 #include <pb_encode.h>
+// Modification (kuka_drivers contributors): encoding specialized on the number of joints
+#include <fri_client_sdk/friLBRState.h>
+#include <pb_frimessages_fixed_callbacks.hpp>
+// End of modification
 
 using namespace KUKA::FRI;
 
@@ -93,14 +97,28 @@ void CommandMessageEncoder::initMessage()
   m_pMessage->commandData.writeIORequest_count = 0;
 
   // allocate and map memory for protobuf repeated structures
-  map_repeatedDouble(
-    FRI_MANAGER_NANOPB_ENCODE, m_nNum,
-    &m_pMessage->commandData.jointPosition.value,
-    &m_tRecvContainer.jointPosition);
-  map_repeatedDouble(
-    FRI_MANAGER_NANOPB_ENCODE, m_nNum,
-    &m_pMessage->commandData.jointTorque.value,
-    &m_tRecvContainer.jointTorque);
+  // Modification (kuka_drivers contributors): the joint commands of the LBR are encoded with the
+  // callbacks specialized on its number of joints
+  if (m_nNum == LBRState::NUMBER_OF_JOINTS) {
+    map_fixedRepeatedDouble<LBRState::NUMBER_OF_JOINTS>(
+      FRI_MANAGER_NANOPB_ENCODE,
+      &m_pMessage->commandData.jointPosition.value,
+      &m_tRecvContainer.jointPosition);
+    map_fixedRepeatedDouble<LBRState::NUMBER_OF_JOINTS>(
+      FRI_MANAGER_NANOPB_ENCODE,
+      &m_pMessage->commandData.jointTorque.value,
+      &m_tRecvContainer.jointTorque);
+  } else {
+    map_repeatedDouble(
+      FRI_MANAGER_NANOPB_ENCODE, m_nNum,
+      &m_pMessage->commandData.jointPosition.value,
+      &m_tRecvContainer.jointPosition);
+    map_repeatedDouble(
+      FRI_MANAGER_NANOPB_ENCODE, m_nNum,
+      &m_pMessage->commandData.jointTorque.value,
+      &m_tRecvContainer.jointTorque);
+  }
+  // End of modification
 
   // nanopb encoding needs to know how many elements the static array contains
   // a Cartesian wrench feed forward vector always contains 6 elements
@@ -61,6 +61,7 @@ cost of any service and repair.
 #include <iostream>
 #include <fri_client_sdk/friLBRClient.h>
 #include <friClientData.h>
+#include <pb_frimessages_callbacks.h>
 
 using namespace KUKA::FRI;
 char FRIException::_buffer[1024] = {0};
@@ -103,6 +104,20 @@ void LBRClient::command()
   robotCommand().setJointPosition(robotState().getIpoJointPosition());
 }
 
+//******************************************************************************
+void LBRClient::setJointValueStorage(
+  double * measuredJointPosition, double * measuredTorque,
+  double * externalTorque)
+{
+  MessageMonitorData & monData = _robotState._message->monitorData;
+  redirect_repeatedDouble(
+    (tRepeatedDoubleArguments *)monData.measuredJointPosition.value.arg, measuredJointPosition);
+  redirect_repeatedDouble(
+    (tRepeatedDoubleArguments *)monData.measuredTorque.value.arg, measuredTorque);
+  redirect_repeatedDouble(
+    (tRepeatedDoubleArguments *)monData.externalTorque.value.arg, externalTorque);
+}
+
 //******************************************************************************
 ClientData * LBRClient::createData()
 {
@@ -112,6 +127,7 @@ ClientData * LBRClient::createData()
   _robotState._message = &data->monitoringMsg;
   _robotCommand._cmdMessage = &data->commandMsg;
   _robotCommand._monMessage = &data->monitoringMsg;
+  _robotCommand._ioSlots = data->ioSlots;
 
   // set specific message IDs
   data->expectedMonitorMsgID = _robotState.LBRMONITORMESSAGEID;
@@ -111,3 +111,64 @@ void LBRCommand::setDigitalIOValue(const char * name, const unsigned long long v
 {
   ClientData::setDigitalIOValue(_cmdMessage, name, value, _monMessage);
 }
+
+//******************************************************************************
+void LBRCommand::setBooleanIOValue(int index, const bool value)
+{
+  ClientData::setBooleanIOValue(_cmdMessage, index, value, _monMessage);
+}
+
+//******************************************************************************
+void LBRCommand::setAnalogIOValue(int index, const double value)
+{
+  ClientData::setAnalogIOValue(_cmdMessage, index, value, _monMessage);
+}
+
+//******************************************************************************
+void LBRCommand::setDigitalIOValue(int index, const unsigned long long value)
+{
+  ClientData::setDigitalIOValue(_cmdMessage, index, value, _monMessage);
+}
+
+static_assert(
+  sizeof(ClientData::ioSlots) / sizeof(FriIOValue) == LBRCommand::MAX_IO_SLOTS,
+  "The slots must cover the write requests of the command message");
+
+//******************************************************************************
+static FriIOValue & checkIOSlot(FriIOValue * slots, int slot)
+{
+  if (slot < 0 || slot >= LBRCommand::MAX_IO_SLOTS) {
+    throw FRIException("Invalid IO slot.");
+  }
+  return slots[slot];
+}
+
+//******************************************************************************
+void LBRCommand::prepareBooleanIOSlot(int slot, int index)
+{
+  ClientData::prepareIOSlot(checkIOSlot(_ioSlots, slot), index, _monMessage, FriIOType_BOOLEAN);
+}
+
+//******************************************************************************
+void LBRCommand::prepareDigitalIOSlot(int slot, int index)
+{
+  ClientData::prepareIOSlot(checkIOSlot(_ioSlots, slot), index, _monMessage, FriIOType_DIGITAL);
+}
+
+//******************************************************************************
+void LBRCommand::prepareAnalogIOSlot(int slot, int index)
+{
+  ClientData::prepareIOSlot(checkIOSlot(_ioSlots, slot), index, _monMessage, FriIOType_ANALOG);
+}
+
+//******************************************************************************
+void LBRCommand::setIOSlotValue(int slot, const double value)
+{
+  FriIOValue & ioValue = checkIOSlot(_ioSlots, slot);
+  if (ioValue.has_analogValue) {
+    ioValue.analogValue = value;
+  } else {
+    ioValue.digitalValue = static_cast<uint64_t>(value);
+  }
+  ClientData::writeIOSlot(_cmdMessage, ioValue);
+}
@@ -225,6 +225,36 @@ double LBRState::getAnalogIOValue(const char * name) const
   return ClientData::getAnalogIOValue(_message, name).analogValue;
 }
 
+//******************************************************************************
+int LBRState::getIOIndex(const char * name) const
+{
+  return ClientData::findIOIndex(_message, name);
+}
+
+//******************************************************************************
+int LBRState::getIOCount() const
+{
+  return ClientData::getIOCount(_message);
+}
+
+//******************************************************************************
+bool LBRState::getBooleanIOValue(int index) const
+{
+  return ClientData::getBooleanIOValue(_message, index).digitalValue != 0;
+}
+
+//******************************************************************************
+unsigned long long LBRState::getDigitalIOValue(int index) const
+{
+  return ClientData::getDigitalIOValue(_message, index).digitalValue;
+}
+
+//******************************************************************************
+double LBRState::getAnalogIOValue(int index) const
+{
+  return ClientData::getAnalogIOValue(_message, index).analogValue;
+}
+
 //******************************************************************************
 /*const std::vector<const char*>& LBRState::getRequestedIO_IDs() const
 {
@@ -57,16 +57,100 @@ cost of any service and repair.
 \file
 \version {1.15}
 */
+#include <algorithm>
 #include <cstdio>
 #include <friMonitoringMessageDecoder.h>
 #include <pb_decode.h>
+// Modification (kuka_drivers contributors): decoding specialized on the number of joints
+#include <fri_client_sdk/friLBRState.h>
+#include <pb_frimessages_fixed_callbacks.hpp>
+// End of modification
 
 
 using namespace KUKA::FRI;
 
+// Modification (kuka_drivers contributors): descriptors of the monitoring message without the IO
+// values and / or the requested transformations, the other fields are the same as in
+// FRIMessages.pb.h. The omitted fields are skipped by pb_decode() as unknown fields.
+typedef MessageMonitorData MessageMonitorDataNoIO;
+#define MessageMonitorDataNoIO_FIELDLIST(X, a) \
+X(a, STATIC,   OPTIONAL, MESSAGE,  measuredJointPosition,   1) \
+X(a, STATIC,   OPTIONAL, MESSAGE,  measuredTorque,    2) \
+X(a, STATIC,   OPTIONAL, MESSAGE,  commandedJointPosition,   3) \
+X(a, STATIC,   OPTIONAL, MESSAGE,  commandedTorque,   4) \
+X(a, STATIC,   OPTIONAL, MESSAGE,  externalTorque,    5) \
+X(a, STATIC,   OPTIONAL, MESSAGE,  timestamp,        15)
+#define MessageMonitorDataNoIO_CALLBACK NULL
+#define MessageMonitorDataNoIO_DEFAULT NULL
+#define MessageMonitorDataNoIO_measuredJointPosition_MSGTYPE JointValues
+#define MessageMonitorDataNoIO_measuredTorque_MSGTYPE JointValues
+#define MessageMonitorDataNoIO_commandedJointPosition_MSGTYPE JointValues
+#define MessageMonitorDataNoIO_commandedTorque_MSGTYPE JointValues
+#define MessageMonitorDataNoIO_externalTorque_MSGTYPE JointValues
+#define MessageMonitorDataNoIO_timestamp_MSGTYPE TimeStamp
+PB_BIND(MessageMonitorDataNoIO, MessageMonitorDataNoIO, 2)
+
+typedef FRIMonitoringMessage FRIMonitoringMessageNoIO;
+#define FRIMonitoringMessageNoIO_FIELDLIST(X, a) \
+X(a, STATIC,   REQUIRED, MESSAGE,  header,            1) \
+X(a, STATIC,   OPTIONAL, MESSAGE,  robotInfo,         2) \
+X(a, STATIC,   OPTIONAL, MESSAGE,  monitorData,       3) \
+X(a, STATIC,   OPTIONAL, MESSAGE,  connectionInfo,    4) \
+X(a, STATIC,   OPTIONAL, MESSAGE,  ipoData,           5) \
+X(a, STATIC,   REPEATED, MESSAGE,  requestedTransformations,   6) \
+X(a, STATIC,   OPTIONAL, MESSAGE,  endOfMessageData,  15)
+#define FRIMonitoringMessageNoIO_CALLBACK NULL
+#define FRIMonitoringMessageNoIO_DEFAULT NULL
+#define FRIMonitoringMessageNoIO_header_MSGTYPE MessageHeader
+#define FRIMonitoringMessageNoIO_robotInfo_MSGTYPE RobotInfo
+#define FRIMonitoringMessageNoIO_monitorData_MSGTYPE MessageMonitorDataNoIO
+#define FRIMonitoringMessageNoIO_connectionInfo_MSGTYPE ConnectionInfo
+#define FRIMonitoringMessageNoIO_ipoData_MSGTYPE MessageIpoData
+#define FRIMonitoringMessageNoIO_requestedTransformations_MSGTYPE Transformation
+#define FRIMonitoringMessageNoIO_endOfMessageData_MSGTYPE MessageEndOf
+PB_BIND(FRIMonitoringMessageNoIO, FRIMonitoringMessageNoIO, 2)
+
+typedef FRIMonitoringMessage FRIMonitoringMessageNoTrafo;
+#define FRIMonitoringMessageNoTrafo_FIELDLIST(X, a) \
+X(a, STATIC,   REQUIRED, MESSAGE,  header,            1) \
+X(a, STATIC,   OPTIONAL, MESSAGE,  robotInfo,         2) \
+X(a, STATIC,   OPTIONAL, MESSAGE,  monitorData,       3) \
+X(a, STATIC,   OPTIONAL, MESSAGE,  connectionInfo,    4) \
+X(a, STATIC,   OPTIONAL, MESSAGE,  ipoData,           5) \
+X(a, STATIC,   OPTIONAL, MESSAGE,  endOfMessageData,  15)
+#define FRIMonitoringMessageNoTrafo_CALLBACK NULL
+#define FRIMonitoringMessageNoTrafo_DEFAULT NULL
+#define FRIMonitoringMessageNoTrafo_header_MSGTYPE MessageHeader
+#define FRIMonitoringMessageNoTrafo_robotInfo_MSGTYPE RobotInfo
+#define FRIMonitoringMessageNoTrafo_monitorData_MSGTYPE MessageMonitorData
+#define FRIMonitoringMessageNoTrafo_connectionInfo_MSGTYPE ConnectionInfo
+#define FRIMonitoringMessageNoTrafo_ipoData_MSGTYPE MessageIpoData
+#define FRIMonitoringMessageNoTrafo_endOfMessageData_MSGTYPE MessageEndOf
+PB_BIND(FRIMonitoringMessageNoTrafo, FRIMonitoringMessageNoTrafo, 2)
+
+typedef FRIMonitoringMessage FRIMonitoringMessageNoIONoTrafo;
+#define FRIMonitoringMessageNoIONoTrafo_FIELDLIST(X, a) \
+X(a, STATIC,   REQUIRED, MESSAGE,  header,            1) \
+X(a, STATIC,   OPTIONAL, MESSAGE,  robotInfo,         2) \
+X(a, STATIC,   OPTIONAL, MESSAGE,  monitorData,       3) \
+X(a, STATIC,   OPTIONAL, MESSAGE,  connectionInfo,    4) \
+X(a, STATIC,   OPTIONAL, MESSAGE,  ipoData,           5) \
+X(a, STATIC,   OPTIONAL, MESSAGE,  endOfMessageData,  15)
+#define FRIMonitoringMessageNoIONoTrafo_CALLBACK NULL
+#define FRIMonitoringMessageNoIONoTrafo_DEFAULT NULL
+#define FRIMonitoringMessageNoIONoTrafo_header_MSGTYPE MessageHeader
+#define FRIMonitoringMessageNoIONoTrafo_robotInfo_MSGTYPE RobotInfo
+#define FRIMonitoringMessageNoIONoTrafo_monitorData_MSGTYPE MessageMonitorDataNoIO
+#define FRIMonitoringMessageNoIONoTrafo_connectionInfo_MSGTYPE ConnectionInfo
+#define FRIMonitoringMessageNoIONoTrafo_ipoData_MSGTYPE MessageIpoData
+#define FRIMonitoringMessageNoIONoTrafo_endOfMessageData_MSGTYPE MessageEndOf
+PB_BIND(FRIMonitoringMessageNoIONoTrafo, FRIMonitoringMessageNoIONoTrafo, 2)
+// End of modification
+
 //******************************************************************************
 MonitoringMessageDecoder::MonitoringMessageDecoder(FRIMonitoringMessage * pMessage, int num)
-: m_nNum(num), m_pMessage(pMessage)
+: m_nNum(num), m_pMessage(pMessage), m_pFields(FRIMonitoringMessage_fields),
+  m_decodeValues(NULL)
 {
   initMessage();
 }
@@ -101,35 +185,32 @@ void MonitoringMessageDecoder::initMessage()
   m_pMessage->monitorData.readIORequest_count = 0;
 
   // allocate and map memory for protobuf repeated structures
-  map_repeatedDouble(
-    FRI_MANAGER_NANOPB_DECODE, m_nNum,
+  // Modification (kuka_drivers contributors): the joint values of the LBR are decoded with the
+  // callbacks specialized on its number of joints
+  pb_callback_t * const values[] = {
     &m_pMessage->monitorData.measuredJointPosition.value,
-    &m_tSendContainer.m_AxQMsrLocal);
-
-  map_repeatedDouble(
-    FRI_MANAGER_NANOPB_DECODE, m_nNum,
     &m_pMessage->monitorData.measuredTorque.value,
-    &m_tSendContainer.m_AxTauMsrLocal);
-
-  map_repeatedDouble(
-    FRI_MANAGER_NANOPB_DECODE, m_nNum,
     &m_pMessage->monitorData.commandedJointPosition.value,
-    &m_tSendContainer.m_AxQCmdT1mLocal);
-
-  map_repeatedDouble(
-    FRI_MANAGER_NANOPB_DECODE, m_nNum,
     &m_pMessage->monitorData.commandedTorque.value,
-    &m_tSendContainer.m_AxTauCmdLocal);
-
-  map_repeatedDouble(
-    FRI_MANAGER_NANOPB_DECODE, m_nNum,
     &m_pMessage->monitorData.externalTorque.value,
-    &m_tSendContainer.m_AxTauExtMsrLocal);
-
-  map_repeatedDouble(
-    FRI_MANAGER_NANOPB_DECODE, m_nNum,
-    &m_pMessage->ipoData.jointPosition.value,
-    &m_tSendContainer.m_AxQCmdIPO);
+    &m_pMessage->ipoData.jointPosition.value};
+  tRepeatedDoubleArguments * const containers[] = {
+    &m_tSendContainer.m_AxQMsrLocal,
+    &m_tSendContainer.m_AxTauMsrLocal,
+    &m_tSendContainer.m_AxQCmdT1mLocal,
+    &m_tSendContainer.m_AxTauCmdLocal,
+    &m_tSendContainer.m_AxTauExtMsrLocal,
+    &m_tSendContainer.m_AxQCmdIPO};
+  for (std::size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i) {
+    if (m_nNum == LBRState::NUMBER_OF_JOINTS) {
+      map_fixedRepeatedDouble<LBRState::NUMBER_OF_JOINTS>(
+        FRI_MANAGER_NANOPB_DECODE, values[i], containers[i]);
+    } else {
+      map_repeatedDouble(FRI_MANAGER_NANOPB_DECODE, m_nNum, values[i], containers[i]);
+    }
+  }
+  m_decodeValues = values[0]->funcs.decode;
+  // End of modification
 
   map_repeatedInt(
     FRI_MANAGER_NANOPB_DECODE, m_nNum,
@@ -137,12 +218,56 @@ void MonitoringMessageDecoder::initMessage()
     &m_tSendContainer.m_AxDriveStateLocal);
 }
 
+// Modification (kuka_drivers contributors): decoding of the fields the client needs only
+//******************************************************************************
+void MonitoringMessageDecoder::setSelection(const Selection & selection)
+{
+  pb_callback_t * const values[] = {
+    &m_pMessage->monitorData.commandedJointPosition.value,
+    &m_pMessage->monitorData.commandedTorque.value,
+    &m_pMessage->monitorData.externalTorque.value,
+    &m_pMessage->ipoData.jointPosition.value};
+  tRepeatedDoubleArguments * const containers[] = {
+    &m_tSendContainer.m_AxQCmdT1mLocal,
+    &m_tSendContainer.m_AxTauCmdLocal,
+    &m_tSendContainer.m_AxTauExtMsrLocal,
+    &m_tSendContainer.m_AxQCmdIPO};
+  const bool selected[] = {
+    selection.commandedJointPosition,
+    selection.commandedTorque,
+    selection.externalTorque,
+    selection.ipoJointPosition};
+  for (std::size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i) {
+    if (selected[i]) {
+      values[i]->funcs.decode = m_decodeValues;
+    } else {
+      values[i]->funcs.decode = &decode_skippedRepeatedDouble;
+      // The values of earlier messages would look valid
+      std::fill_n(containers[i]->value, m_nNum, 0.0);
+      containers[i]->size = 0;
+    }
+  }
+
+  if (selection.ioValues) {
+    m_pFields = selection.transformations ?
+      FRIMonitoringMessage_fields : &FRIMonitoringMessageNoTrafo_msg;
+  } else {
+    m_pFields = selection.transformations ?
+      &FRIMonitoringMessageNoIO_msg : &FRIMonitoringMessageNoIONoTrafo_msg;
+  }
+  m_pMessage->monitorData.readIORequest_count = 0;
+  m_pMessage->requestedTransformations_count = 0;
+}
+// End of modification
+
 //******************************************************************************
 bool MonitoringMessageDecoder::decode(char * buffer, int size)
 {
   pb_istream_t stream = pb_istream_from_buffer((uint8_t *)buffer, size);
 
-  bool status = pb_decode(&stream, FRIMonitoringMessage_fields, m_pMessage);
+  // Modification (kuka_drivers contributors): decoding of the fields the client needs only
+  bool status = pb_decode(&stream, m_pFields, m_pMessage);
+  // End of modification
   if (!status) {
     printf("!!decoding error: %s!!\n", PB_GET_ERROR(&stream));
   }
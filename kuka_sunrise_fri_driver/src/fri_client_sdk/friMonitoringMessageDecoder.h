@@ -82,6 +82,30 @@ public:
 
   bool decode(char * buffer, int size);
 
+  // Modification (kuka_drivers contributors): decoding of the fields the client needs only
+  /**
+   * \brief Fields of the monitoring message that are decoded, the measured joint positions and
+   * torques, the drive states and the message header are always decoded.
+   *
+   * The joint values that are not selected are skipped on the wire by a callback, the accessors
+   * return zeros for them. Without the IO values or the transformations the message is decoded
+   * with a descriptor that does not contain them, their tags are skipped as unknown fields and
+   * their counts stay 0.
+   */
+  struct Selection
+  {
+    bool commandedJointPosition = true;
+    bool commandedTorque = true;
+    bool externalTorque = true;
+    bool ipoJointPosition = true;
+    bool ioValues = true;
+    bool transformations = true;
+  };
+
+  // Must not be called while a message is decoded
+  void setSelection(const Selection & selection);
+  // End of modification
+
 private:
   struct LocalMonitoringDataContainer
   {
@@ -120,6 +144,10 @@ private:
 
   LocalMonitoringDataContainer m_tSendContainer;
   FRIMonitoringMessage * m_pMessage;
+  // Modification (kuka_drivers contributors): decoding of the fields the client needs only
+  const pb_msgdesc_t * m_pFields;
+  bool (* m_decodeValues)(pb_istream_t * stream, const pb_field_t * field, void ** arg);
+  // End of modification
 
   void initMessage();
 };
@@ -64,6 +64,9 @@ cost of any service and repair.
 #endif
 
 #include <fri_client_sdk/friUdpConnection.h>
+// Modification (kuka_drivers contributors): real-time logging
+#include "kuka_drivers_core/rt_log.hpp"
+// End of modification
 
 
 #ifdef WIN32
@@ -76,6 +79,114 @@ cost of any service and repair.
 
 using namespace KUKA::FRI;
 
+// Modification (kuka_drivers contributors): common transport of the drivers on unix
+#ifdef __unix__
+//******************************************************************************
+UdpConnection::UdpConnection(unsigned int receiveTimeout)
+: _receiveTimeout(receiveTimeout),
+  _log(NULL)
+{
+}
+
+//******************************************************************************
+UdpConnection::~UdpConnection()
+{
+  close();
+}
+
+//******************************************************************************
+bool UdpConnection::open(int port, const char * controllerAddress)
+{
+  if (!_transport.Open("", static_cast<uint16_t>(port), _transportOptions)) {
+    printf("opening port number %d failed: %s\n", port, _transport.Error().c_str());
+    return false;
+  }
+  if (controllerAddress && !_transport.Connect(controllerAddress, static_cast<uint16_t>(port))) {
+    printf("connecting to controller with address %s failed !\n", controllerAddress);
+    close();
+    return false;
+  }
+  return true;
+}
+
+//******************************************************************************
+void UdpConnection::close()
+{
+  _transport.Close();
+}
+
+//******************************************************************************
+bool UdpConnection::isOpen() const
+{
+  return _transport.IsOpen();
+}
+
+//******************************************************************************
+int UdpConnection::receive(char * buffer, int maxSize)
+{
+  if (!isOpen() || maxSize <= 0) {
+    return -1;
+  }
+  // One byte of the buffer is kept for the terminator of the transport
+  kuka_drivers_core::UdpTransport::Packet packet;
+  const ssize_t received = _transport.ReceiveInto(
+    buffer, static_cast<std::size_t>(maxSize), packet,
+    std::chrono::milliseconds(_receiveTimeout));
+  if (received == 0) {
+    if (_log != NULL) {
+      _log->Log(
+        kuka_drivers_core::RTLog::Level::ERROR,
+        "The connection has timed out. Timeout is %u", _receiveTimeout);
+    } else {
+      printf("The connection has timed out. Timeout is %d\n", _receiveTimeout);
+    }
+    return -1;
+  }
+  if (received < 0) {
+    if (_log != NULL) {
+      _log->Log(
+        kuka_drivers_core::RTLog::Level::ERROR, "An error has occured (%s)",
+        _transport.Error().c_str());
+    } else {
+      printf("An error has occured \n");
+    }
+    return -1;
+  }
+  return static_cast<int>(received);
+}
+
+//******************************************************************************
+bool UdpConnection::send(const char * buffer, int size)
+{
+  return isOpen() && size >= 0 &&
+         _transport.Send(buffer, static_cast<std::size_t>(size)) == size;
+}
+
+//******************************************************************************
+void UdpConnection::setTransportOptions(const kuka_drivers_core::UdpTransport::Options & options)
+{
+  _transportOptions = options;
+}
+
+//******************************************************************************
+void UdpConnection::setCapture(kuka_drivers_core::WireCapture * capture)
+{
+  _transport.SetCapture(capture);
+}
+
+//******************************************************************************
+void UdpConnection::setFaultInjector(kuka_drivers_core::FaultInjector * faults)
+{
+  _transport.SetFaultInjector(faults);
+}
+
+//******************************************************************************
+void UdpConnection::setLog(kuka_drivers_core::RTLog * log)
+{
+  _log = log;
+}
+#else
+// End of modification
 //******************************************************************************
 UdpConnection::UdpConnection(unsigned int receiveTimeout)
 : _udpSock(-1),
@@ -232,3 +343,18 @@ bool UdpConnection::send(const char * buffer, int size)
   }
   return false;
 }
+
+// Modification (kuka_drivers contributors): common transport of the drivers on unix
+void UdpConnection::setCapture(kuka_drivers_core::WireCapture *)
+{
+}
+
+void UdpConnection::setFaultInjector(kuka_drivers_core::FaultInjector *)
+{
+}
+
+void UdpConnection::setLog(kuka_drivers_core::RTLog *)
+{
+}
+#endif
+// End of modification
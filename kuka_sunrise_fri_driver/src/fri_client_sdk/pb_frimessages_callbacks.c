@@ -210,11 +210,18 @@ void map_repeatedDouble(eNanopbCallbackDirection dir, int numDOF, pb_callback_t
    if (numDOF > 0)
    {
       arg->value = (double*) malloc(numDOF * sizeof(double));
-
+      arg->buffer = arg->value;
    }
    values->arg = arg;
 }
 
+void redirect_repeatedDouble(tRepeatedDoubleArguments *arg, double *storage)
+{
+   // decoding continues with the first element in the new storage
+   arg->size = 0;
+   arg->value = (storage != NULL) ? storage : arg->buffer;
+}
+
 void map_repeatedInt(eNanopbCallbackDirection dir, int numDOF, pb_callback_t *values, tRepeatedIntArguments *arg)
 {
    // IMPORTANT: the callbacks are stored in a union, therefor a message object
@@ -245,6 +252,7 @@ void init_repeatedDouble(tRepeatedDoubleArguments *arg)
    arg->size = 0;
    arg->max_size = 0;
    arg->value = NULL;
+   arg->buffer = NULL;
 }
 
 void init_repeatedInt(tRepeatedIntArguments *arg)
@@ -256,8 +264,9 @@ void init_repeatedInt(tRepeatedIntArguments *arg)
 
 void free_repeatedDouble(tRepeatedDoubleArguments *arg)
 {
-   if (arg->value != NULL)
-      free(arg->value);
+   // external storage is not owned
+   if (arg->buffer != NULL)
+      free(arg->buffer);
 }
 
 void free_repeatedInt(tRepeatedIntArguments *arg)
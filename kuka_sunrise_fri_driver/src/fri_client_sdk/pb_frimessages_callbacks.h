@@ -73,6 +73,7 @@ typedef struct repeatedDoubleArguments
   size_t size;
   size_t max_size;
   double * value;
+  double * buffer;  //!< allocated storage, value points to external storage if it differs
 } tRepeatedDoubleArguments;
 
 /** container for repeated integer elements */
@@ -115,6 +116,9 @@ void map_repeatedInt(
   eNanopbCallbackDirection dir, int numDOF,
   pb_callback_t * values, tRepeatedIntArguments * arg);
 
+/** decode into external storage of max_size elements, NULL restores the allocated storage */
+void redirect_repeatedDouble(tRepeatedDoubleArguments * arg, double * storage);
+
 void init_repeatedDouble(tRepeatedDoubleArguments * arg);
 
 void init_repeatedInt(tRepeatedIntArguments * arg);
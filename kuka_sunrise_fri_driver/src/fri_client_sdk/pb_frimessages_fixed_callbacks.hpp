@@ -0,0 +1,135 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PB_FRIMESSAGES_FIXED_CALLBACKS_HPP_
+#define PB_FRIMESSAGES_FIXED_CALLBACKS_HPP_
+
+#include <pb_decode.h>
+#include <pb_encode.h>
+#include <pb_frimessages_callbacks.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Repeated double callbacks of the joint values with the number of joints known at compile time.
+// They use the same argument container as the generic callbacks, so the accessors of the SDK are
+// unchanged. On little-endian targets a packed array of all joints is copied in one read and the
+// unpacked fields of the command message are assembled in one buffer with a single write.
+
+#if defined(PB_LITTLE_ENDIAN_8BIT) && PB_LITTLE_ENDIAN_8BIT
+#define FRI_FIXED_CALLBACKS_MEMCPY 1
+#else
+#define FRI_FIXED_CALLBACKS_MEMCPY 0
+#endif
+
+namespace KUKA
+{
+namespace FRI
+{
+
+template<std::size_t N>
+bool decode_fixedRepeatedDouble(pb_istream_t * stream, const pb_field_t *, void ** arg)
+{
+  if (arg == NULL || *arg == NULL) {
+    return false;
+  }
+  tRepeatedDoubleArguments * arguments = static_cast<tRepeatedDoubleArguments *>(*arg);
+  if (arguments->value == NULL) {
+    // Skipped, the packed array must still be consumed
+    return pb_read(stream, NULL, stream->bytes_left);
+  }
+
+#if FRI_FIXED_CALLBACKS_MEMCPY
+  // Packed array of all joints
+  if (arguments->size == 0 && stream->bytes_left == N * sizeof(double)) {
+    return pb_read(
+      stream, reinterpret_cast<pb_byte_t *>(arguments->value), N * sizeof(double));
+  }
+#endif
+
+  // One element of an unpacked field, or of a packed array of unexpected length
+  if (!pb_decode_fixed64(stream, &arguments->value[arguments->size])) {
+    return false;
+  }
+  if (++arguments->size >= N) {
+    arguments->size = 0;
+  }
+  return true;
+}
+
+template<std::size_t N>
+bool encode_fixedRepeatedDouble(pb_ostream_t * stream, const pb_field_t * field, void * const * arg)
+{
+  if (arg == NULL || *arg == NULL) {
+    return false;
+  }
+  const tRepeatedDoubleArguments * arguments = static_cast<const tRepeatedDoubleArguments *>(*arg);
+  const double * values = arguments->value;
+
+#if FRI_FIXED_CALLBACKS_MEMCPY
+  // Every element is sent with its own tag, as by encode_repeatedDouble()
+  pb_byte_t tag[5];
+  std::size_t tag_size = 0;
+  uint32_t key = (static_cast<uint32_t>(field->tag) << 3) | PB_WT_64BIT;
+  while (key >= 0x80) {
+    tag[tag_size++] = static_cast<pb_byte_t>(key | 0x80);
+    key >>= 7;
+  }
+  tag[tag_size++] = static_cast<pb_byte_t>(key);
+
+  pb_byte_t buffer[N * (sizeof(tag) + sizeof(double))];
+  pb_byte_t * it = buffer;
+  for (std::size_t i = 0; i < N; ++i) {
+    std::memcpy(it, tag, tag_size);
+    it += tag_size;
+    std::memcpy(it, &values[i], sizeof(double));
+    it += sizeof(double);
+  }
+  return pb_write(stream, buffer, it - buffer);
+#else
+  for (std::size_t i = 0; i < N; ++i) {
+    if (!pb_encode_tag_for_field(stream, field) || !pb_encode_fixed64(stream, &values[i])) {
+      return false;
+    }
+  }
+  return true;
+#endif
+}
+
+// Consumes joint values the client does not need, the container keeps its values. Packed arrays
+// are passed in one substream, the elements of unpacked fields in a substream each.
+inline bool decode_skippedRepeatedDouble(pb_istream_t * stream, const pb_field_t *, void **)
+{
+  return pb_read(stream, NULL, stream->bytes_left);
+}
+
+// Allocates the container like map_repeatedDouble() and sets the fixed size callback
+template<std::size_t N>
+void map_fixedRepeatedDouble(
+  eNanopbCallbackDirection dir, pb_callback_t * values,
+  tRepeatedDoubleArguments * arg)
+{
+  map_repeatedDouble(dir, static_cast<int>(N), values, arg);
+  if (dir == FRI_MANAGER_NANOPB_ENCODE) {
+    values->funcs.encode = &encode_fixedRepeatedDouble<N>;
+  } else {
+    values->funcs.decode = &decode_fixedRepeatedDouble<N>;
+  }
+}
+
+}  // namespace FRI
+}  // namespace KUKA
+
+#endif  // PB_FRIMESSAGES_FIXED_CALLBACKS_HPP_
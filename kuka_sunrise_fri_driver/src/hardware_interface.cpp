@@ -12,10 +12,13 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <chrono>
 #include <memory>
 
 #include <hardware_interface/types/hardware_interface_type_values.hpp>
 #include "kuka_drivers_core/hardware_interface_types.hpp"
+#include "kuka_drivers_core/hardware_parameters.hpp"
 
 #include "kuka_sunrise_fri_driver/hardware_interface.hpp"
 
@@ -24,20 +27,215 @@ namespace kuka_sunrise_fri_driver
 CallbackReturn KukaFRIHardwareInterface::on_init(
   const hardware_interface::HardwareInfo & system_info)
 {
+  startup_profile_.Reset();
+  kuka_drivers_core::StartupProfile::Scope init_phase(startup_profile_, "on_init");
   if (hardware_interface::SystemInterface::on_init(system_info) != CallbackReturn::SUCCESS) {
     return CallbackReturn::ERROR;
   }
-  hw_states_.resize(info_.joints.size());
-  hw_commands_.resize(info_.joints.size());
-  hw_torques_.resize(info_.joints.size());
-  hw_torques_ext_.resize(info_.joints.size());
-  hw_effort_command_.resize(info_.joints.size());
+  startup_profile_.SetComponent(info_.name);
+  std::vector<std::string> joint_names;
+  for (const auto & joint : info_.joints) {
+    joint_names.push_back(joint.name);
+  }
+  allocateInterfaces(joint_names);
+  if (!configureGPIOs() || !checkJointInterfaces()) {
+    return CallbackReturn::ERROR;
+  }
+
+  // Numeric parameters and flags
+  kuka_drivers_core::HardwareParameters parameters(info_.hardware_parameters);
+  // Several robots in one process need different ports, see client_port of the robot manager
+  parameters.Get("client_port", client_port_, 30200, 30209);
+  parameters.GetFlag("monitoring_only", monitoring_only_);
+  // Optional decoding of only the fields of the monitoring messages the interfaces are built from,
+  //  the performance monitoring interfaces are not exported then
+  parameters.GetFlag("selective_decode", selective_decode_);
+  // Robots of the same receive group get the messages of a cycle together from a shared thread
+  const std::string receive_group = parameters.String("receive_group");
+  if (!receive_group.empty()) {
+    auto group = ReceiveGroup::get(receive_group);
+    auto gather_timeout = group->gatherTimeout();
+    parameters.Get("receive_group_timeout_us", gather_timeout);
+    group->setGatherTimeout(gather_timeout);
+    connection_.setGroup(group);
+  }
+  if (!parameters.Ok()) {
+    RCLCPP_FATAL(rclcpp::get_logger("KukaFRIHardwareInterface"), "%s", parameters.Error().c_str());
+    return CallbackReturn::ERROR;
+  }
+
+  // Low latency receive strategy and traffic class of the commands, I/O thread, cycle
+  //  coordination, clock synchronization and interpolation, see kuka_drivers_core
+  const auto & hardware_parameters = info_.hardware_parameters;
+  kuka_drivers_core::UdpTransport::Options transport_options;
+  kuka_drivers_core::IOThread::Options io_thread_options;
+  std::chrono::nanoseconds min_latency;
+  std::string error;
+  if (
+    !kuka_drivers_core::UdpTransport::ParseOptions(hardware_parameters, transport_options, error) ||
+    !kuka_drivers_core::IOThread::ParseOptions(hardware_parameters, io_thread_options, error) ||
+    !kuka_drivers_core::CycleCoordinator::ParseOptions(
+      hardware_parameters, cycle_coordination_options_, error) ||
+    !kuka_drivers_core::ClockSync::ParseMinLatency(hardware_parameters, min_latency, error) ||
+    !command_interpolator_.Configure(hardware_parameters, info_.joints.size(), error))
+  {
+    RCLCPP_FATAL(rclcpp::get_logger("KukaFRIHardwareInterface"), "%s", error.c_str());
+    return CallbackReturn::ERROR;
+  }
+  if (io_thread_options.enabled &&
+    (!receive_group.empty() || !transport_options.xdp_interface.empty()))
+  {
+    RCLCPP_FATAL(
+      rclcpp::get_logger("KukaFRIHardwareInterface"),
+      "io_thread cannot be combined with receive_group and xdp_interface");
+    return CallbackReturn::ERROR;
+  }
+  // The cycles are started by the coordinator, read() must not wait for the message
+  if (cycle_coordination_options_.enabled && !io_thread_options.enabled) {
+    RCLCPP_FATAL(
+      rclcpp::get_logger("KukaFRIHardwareInterface"), "cycle_coordination requires io_thread");
+    return CallbackReturn::ERROR;
+  }
+  udp_connection_.setTransportOptions(transport_options);
+  io_thread_ = io_thread_options.enabled;
+  connection_.setIOThread(io_thread_options);
+  // The timestamps of the monitoring messages count nanoseconds of the controller clock
+  clock_sync_ = kuka_drivers_core::ClockSync(1e-9, min_latency);
+
+  // Optional frames streamed to the robot application, given as comma separated IDs
+  const std::string frames = parameters.String("streamed_frames");
+  if (!frames.empty()) {
+    std::vector<std::string> frame_ids;
+    std::size_t i = 0, pos;
+    while ((pos = frames.find(',', i)) != std::string::npos) {
+      frame_ids.push_back(frames.substr(i, pos - i));
+      i = pos + 1;
+    }
+    frame_ids.push_back(frames.substr(i));
+    if (!frame_streamer_.configure(frame_ids)) {
+      RCLCPP_FATAL(
+        rclcpp::get_logger("KukaFRIHardwareInterface"),
+        "At most %zu frames can be streamed to FRI", FrameStreamer::kMaxFrames);
+      return CallbackReturn::ERROR;
+    }
+    streamed_frames_topic_ = parameters.String("streamed_frames_topic", "streamed_frames");
+  }
+
+  if (selective_decode_) {
+    KUKA::FRI::MonitoringMessageDecoder::Selection selection;
+    selection.commandedJointPosition = false;
+    selection.commandedTorque = false;
+    // The interpolator position is the base of the torque and wrench commands
+    selection.ipoJointPosition = !monitoring_only_;
+    selection.ioValues = !gpio_outputs_.empty() || !gpio_inputs_.empty();
+    selection.transformations = frame_streamer_.enabled();
+    client_application_.set_decode_selection(selection);
+  }
+
+  // Optional recording of the state of every cycle into a CSV file
+  const std::string recording_file = parameters.String("state_recording_file");
+  if (!recording_file.empty() && !state_recorder_.open(recording_file)) {
+    RCLCPP_FATAL(
+      rclcpp::get_logger("KukaFRIHardwareInterface"), "Error opening state recording file %s: %s",
+      recording_file.c_str(), strerror(errno));
+    return CallbackReturn::ERROR;
+  }
+
+  // Errors of the control loop are logged by a separate thread
+  udp_connection_.setLog(&rt_log_);
+  client_application_.set_log(&rt_log_);
+
+  // Changes of the session, safety, drive etc. state are published when they are decoded
+  const std::string events_topic = parameters.String("state_events_topic", "fri_state_events");
+  if (!events_topic.empty()) {
+    state_events_ = std::make_unique<StateEventPublisher>(
+      info_.name + "_state_events", events_topic);
+  }
+
+  // Optional diagnostics, metrics, network faults, recordings, publishers, command filters and
+  //  tuning, see the README of kuka_drivers_core
+  // The trend diagnostics of the link warn before the connection quality drops to POOR
+  //  (the enum values are POOR = 0, FAIR = 1, GOOD = 2, EXCELLENT = 3)
+  using LinkMetric = kuka_drivers_core::LinkDiagnostics::Metric;
+  const std::vector<LinkMetric> link_metrics = {
+    {"connection quality", kuka_drivers_core::LinkDiagnostics::Kind::LEVEL, 2.5, 1.5, true},
+    {"tracking performance", kuka_drivers_core::LinkDiagnostics::Kind::LEVEL, 0.9, 0.5, true}};
+  const std::size_t joint_count = info_.joints.size();
+  if (
+    !kuka_drivers_core::ConfigureLinkDiagnostics(
+      hardware_parameters, info_.name, link_metrics, link_diagnostics_, error) ||
+    !ConfigureLoopLatencyDiagnostics(
+      hardware_parameters, info_.name, loop_latency_, loop_latency_diagnostics_, error) ||
+    !kuka_drivers_core::ConfigureMetrics(hardware_parameters, info_.name, metrics_group_, error) ||
+    !kuka_drivers_core::ConfigureFaultInjection(hardware_parameters, fault_injector_, error) ||
+    !kuka_drivers_core::ConfigureWireCapture(hardware_parameters, wire_capture_, error) ||
+    !kuka_drivers_core::ConfigureFlightRecorder(hardware_parameters, flight_recorder_, error) ||
+    !kuka_drivers_core::ConfigureStateChannel(
+      hardware_parameters, joint_count, state_channel_, error) ||
+    !kuka_drivers_core::ConfigureJointStatePublisher(
+      hardware_parameters, info_.name, joint_names, joint_state_publisher_, error) ||
+    !kuka_drivers_core::ConfigureStateBatchPublisher(
+      hardware_parameters, info_.name, joint_names, state_batch_publisher_, error) ||
+    !kuka_drivers_core::ConfigureCommandFilter(
+      hardware_parameters, joint_count, command_filter_, error) ||
+    !kuka_drivers_core::ConfigureTuningParameters(
+      hardware_parameters, info_.name, joint_count, &Tuning::command_filter, tuning_, error))
+  {
+    RCLCPP_FATAL(rclcpp::get_logger("KukaFRIHardwareInterface"), "%s", error.c_str());
+    return CallbackReturn::ERROR;
+  }
+  if (fault_injector_ != nullptr) {
+    RCLCPP_WARN(
+      rclcpp::get_logger("KukaFRIHardwareInterface"), "Fault injection enabled: %s",
+      parameters.String("fault_profile").c_str());
+  }
+  udp_connection_.setCapture(wire_capture_.get());
+  udp_connection_.setFaultInjector(fault_injector_.get());
+  registerMetrics();
+  return CallbackReturn::SUCCESS;
+}
+
+void KukaFRIHardwareInterface::allocateInterfaces(const std::vector<std::string> & joint_names)
+{
+  // The order of the fields is the order of the exported interfaces of a joint
+  const std::size_t position_state = joint_storage_.AddState(hardware_interface::HW_IF_POSITION);
+  const std::size_t torque_state = joint_storage_.AddState(hardware_interface::HW_IF_EFFORT);
+  const std::size_t external_torque_state =
+    joint_storage_.AddState(hardware_interface::HW_IF_EXTERNAL_TORQUE);
+  const std::size_t commanded_position_state =
+    joint_storage_.AddState(hardware_interface::HW_IF_COMMANDED_POSITION);
+  const std::size_t commanded_torque_state =
+    joint_storage_.AddState(hardware_interface::HW_IF_COMMANDED_EFFORT);
+  const std::size_t ipo_position_state =
+    joint_storage_.AddState(hardware_interface::HW_IF_IPO_POSITION);
+  const std::size_t position_command =
+    joint_storage_.AddCommand(hardware_interface::HW_IF_POSITION);
+  const std::size_t effort_command = joint_storage_.AddCommand(hardware_interface::HW_IF_EFFORT);
+  joint_storage_.Allocate(joint_names);
+  hw_states_ = joint_storage_.State(position_state);
+  hw_torques_ = joint_storage_.State(torque_state);
+  hw_torques_ext_ = joint_storage_.State(external_torque_state);
+  hw_commanded_positions_ = joint_storage_.State(commanded_position_state);
+  hw_commanded_torques_ = joint_storage_.State(commanded_torque_state);
+  hw_ipo_positions_ = joint_storage_.State(ipo_position_state);
+  hw_commands_ = joint_storage_.Command(position_command);
+  hw_effort_command_ = joint_storage_.Command(effort_command);
+  filtered_commands_.resize(info_.joints.size());
+
+  // The joint values are decoded directly into the state interfaces if the sizes match
+  zero_copy_states_ = info_.joints.size() == KUKA::FRI::LBRState::NUMBER_OF_JOINTS;
+  if (zero_copy_states_) {
+    setJointValueStorage(hw_states_.data(), hw_torques_.data(), hw_torques_ext_.data());
+  }
+}
 
+bool KukaFRIHardwareInterface::configureGPIOs()
+{
   if (info_.gpios.size() != 1) {
     RCLCPP_FATAL(
       rclcpp::get_logger("KukaFRIHardwareInterface"),
       "expecting exactly 1 GPIO");
-    return CallbackReturn::ERROR;
+    return false;
   }
 
   if (info_.gpios[0].command_interfaces.size() > 10 ||
@@ -46,7 +244,7 @@ CallbackReturn KukaFRIHardwareInterface::on_init(
     RCLCPP_FATAL(
       rclcpp::get_logger("KukaFRIHardwareInterface"),
       "A maximum of 10 inputs and outputs can be registered to FRI");
-    return CallbackReturn::ERROR;
+    return false;
   }
 
   for (const auto & state_if : info_.gpios[0].state_interfaces) {
@@ -54,110 +252,212 @@ CallbackReturn KukaFRIHardwareInterface::on_init(
   }
 
   for (const auto & command_if : info_.gpios[0].command_interfaces) {
+    double initial_value = 0.0;
+    if (!command_if.initial_value.empty() &&
+      !kuka_drivers_core::HardwareParameters::Convert(command_if.initial_value, initial_value))
+    {
+      RCLCPP_FATAL(
+        rclcpp::get_logger("KukaFRIHardwareInterface"),
+        "Initial value of GPIO command interface '%s' must be a number", command_if.name.c_str());
+      return false;
+    }
     gpio_inputs_.emplace_back(
       command_if.name, getType(command_if.data_type),
-      robotCommand(), std::stod(command_if.initial_value));
+      robotCommand(), robotState(), initial_value);
   }
+  return true;
+}
 
-
+bool KukaFRIHardwareInterface::checkJointInterfaces()
+{
   for (const hardware_interface::ComponentInfo & joint : info_.joints) {
     if (joint.command_interfaces.size() != 2) {
       RCLCPP_FATAL(
         rclcpp::get_logger("KukaFRIHardwareInterface"),
         "expecting exactly 2 command interface");
-      return CallbackReturn::ERROR;
+      return false;
     }
 
     if (joint.command_interfaces[0].name != hardware_interface::HW_IF_POSITION) {
       RCLCPP_FATAL(
         rclcpp::get_logger(
           "KukaFRIHardwareInterface"), "expecting POSITION command interface as first");
-      return CallbackReturn::ERROR;
+      return false;
     }
 
     if (joint.command_interfaces[1].name != hardware_interface::HW_IF_EFFORT) {
       RCLCPP_FATAL(
         rclcpp::get_logger(
           "KukaFRIHardwareInterface"), "expecting EFFORT command interface as second");
-      return CallbackReturn::ERROR;
+      return false;
     }
 
     if (joint.state_interfaces.size() != 3) {
       RCLCPP_FATAL(
         rclcpp::get_logger(
           "KukaFRIHardwareInterface"), "expecting exactly 3 state interface");
-      return CallbackReturn::ERROR;
+      return false;
     }
 
     if (joint.state_interfaces[0].name != hardware_interface::HW_IF_POSITION) {
       RCLCPP_FATAL(
         rclcpp::get_logger(
           "KukaFRIHardwareInterface"), "expecting POSITION state interface as first");
-      return CallbackReturn::ERROR;
+      return false;
     }
 
     if (joint.state_interfaces[1].name != hardware_interface::HW_IF_EFFORT) {
       RCLCPP_FATAL(
         rclcpp::get_logger(
           "KukaFRIHardwareInterface"), "expecting EFFORT state interface as second");
-      return CallbackReturn::ERROR;
+      return false;
     }
 
     if (joint.state_interfaces[2].name != "external_torque") {
       RCLCPP_FATAL(
         rclcpp::get_logger(
           "KukaFRIHardwareInterface"), "expecting 'external torque' state interface as third");
-      return CallbackReturn::ERROR;
+      return false;
     }
   }
+  return true;
+}
 
-  struct sched_param param;
-  param.sched_priority = 95;
-  if (sched_setscheduler(0, SCHED_FIFO, &param) == -1) {
-    RCLCPP_ERROR(rclcpp::get_logger("KukaEACHardwareInterface"), "setscheduler error");
-    RCLCPP_ERROR(rclcpp::get_logger("KukaEACHardwareInterface"), strerror(errno));
-    return CallbackReturn::ERROR;
+void KukaFRIHardwareInterface::registerMetrics()
+{
+  if (metrics_group_ == nullptr) {
+    return;
   }
-
-  return CallbackReturn::SUCCESS;
+  metrics_.connection_quality = &metrics_group_->AddGauge(
+    "connection_quality", "FRI connection quality (POOR = 0 ... EXCELLENT = 3)");
+  metrics_.session_state = &metrics_group_->AddGauge(
+    "session_state", "FRI session state (IDLE = 0 ... COMMANDING_ACTIVE = 4)");
+  metrics_.late_answers = &metrics_group_->AddCounter(
+    "late_answers_total", "Monitoring messages answered after the next one arrived");
+  metrics_.round_trip_latency = &metrics_group_->AddHistogram(
+    "round_trip_latency_seconds", "Time from a monitoring message until it reflects a command");
+  metrics_.host_latency = &metrics_group_->AddHistogram(
+    "host_latency_seconds", "Time from the arrival of a monitoring message until its answer");
 }
 
 CallbackReturn KukaFRIHardwareInterface::on_activate(const rclcpp_lifecycle::State &)
 {
-  if (!client_application_.connect(30200, nullptr)) {
+  kuka_drivers_core::StartupProfile::Scope activate_phase(startup_profile_, "on_activate");
+  command_filter_.Reset();
+  kuka_drivers_core::StartupProfile::Scope connect_phase(startup_profile_, "on_activate/connect");
+  if (!client_application_.connect(client_port_, nullptr)) {
     RCLCPP_ERROR(rclcpp::get_logger("KukaFRIHardwareInterface"), "Could not connect");
     return CallbackReturn::FAILURE;
   }
+  connect_phase.Finish();
+  // The IOs of the new session are resolved at the first read
+  resetGPIOIndices();
+  kuka_drivers_core::tracing::InstanceName(this, info_.name.c_str());
+  kuka_drivers_core::tracing::InstanceName(&client_application_, info_.name.c_str());
+  loop_latency_.Reset();
+  robot_state_.late_answers_ = 0;
+  log_drain_.Start();
+  frame_streamer_.start(info_.name + "_frame_streamer", streamed_frames_topic_);
+  state_recorder_.start();
+  if (cycle_coordination_options_.enabled) {
+    cycle_robot_ = kuka_drivers_core::CycleCoordinator::Instance().Join(
+      info_.name, cycle_coordination_options_.master);
+    if (cycle_robot_ < 0) {
+      RCLCPP_WARN(
+        rclcpp::get_logger("KukaFRIHardwareInterface"),
+        "Too many robots for the cycle coordinator, the cycles are not aligned to this one");
+    }
+  }
+  // The next bring-up (after a deactivation) is profiled from its first phase
+  activate_phase.Finish();
+  startup_profile_.Log(rclcpp::get_logger("KukaFRIHardwareInterface"));
+  startup_profile_.Reset();
+  activation_end_ = kuka_drivers_core::StartupProfile::Clock::now();
+  first_message_pending_ = true;
   is_active_ = true;
+  activity_.Set();
   return CallbackReturn::SUCCESS;
 }
 
 CallbackReturn KukaFRIHardwareInterface::on_deactivate(const rclcpp_lifecycle::State &)
 {
+  kuka_drivers_core::CycleCoordinator::Instance().Leave(cycle_robot_);
+  cycle_robot_ = -1;
   client_application_.disconnect();
   is_active_ = false;
+  activity_.Clear();
+  frame_streamer_.stop();
+  state_recorder_.stop();
+  log_drain_.Stop();
+  if (fault_injector_ != nullptr) {
+    RCLCPP_INFO(
+      rclcpp::get_logger("KukaFRIHardwareInterface"), "Fault injection: %s",
+      fault_injector_->Summary().c_str());
+  }
   return CallbackReturn::SUCCESS;
 }
 
+KukaFRIHardwareInterface::~KukaFRIHardwareInterface()
+{
+  log_drain_.Stop();
+}
+
+void KukaFRIHardwareInterface::onStateChange(
+  KUKA::FRI::ESessionState oldState,
+  KUKA::FRI::ESessionState newState)
+{
+  rt_log_.Log(
+    kuka_drivers_core::RTLog::Level::INFO, "FRI session state changed from %d to %d",
+    static_cast<int>(oldState), static_cast<int>(newState));
+}
+
 void KukaFRIHardwareInterface::waitForCommand()
 {
-  hw_commands_ = hw_states_;
-  hw_effort_command_ = hw_torques_;
+  std::copy(hw_states_.begin(), hw_states_.end(), hw_commands_.begin());
+  std::copy(hw_torques_.begin(), hw_torques_.end(), hw_effort_command_.begin());
+  hw_wrench_commands_.fill(0);
   // TODO(Svastits): is this really the purpose of waitForCommand?
   rclcpp::Time stamp = ros_clock_.now();
-  if (++receive_counter_ == receive_multiplier_) {
+  if (command_interpolator_.Enabled()) {
+    // Commanding starts from the current state
+    command_interpolator_.Reset(interpolatedCommands().data());
+    updateCommand(stamp);
+    controllerCycle();
+    return;
+  }
+  if (controllerCycle()) {
     updateCommand(stamp);
-    receive_counter_ = 0;
   }
 }
 
 void KukaFRIHardwareInterface::command()
 {
   rclcpp::Time stamp = ros_clock_.now();
-  if (++receive_counter_ == receive_multiplier_) {
+  if (command_interpolator_.Enabled()) {
+    // The controllers are sampled every receive_multiplier_ cycles, the commands of the cycles
+    //  in between are interpolated
+    if (controllerCycle()) {
+      command_interpolator_.SetTarget(
+        interpolatedCommands().data(), applied_receive_multiplier_ * robotState().getSampleTime());
+    }
     updateCommand(stamp);
-    receive_counter_ = 0;
+    return;
+  }
+  if (controllerCycle()) {
+    updateCommand(stamp);
+  }
+}
+
+bool KukaFRIHardwareInterface::controllerCycle()
+{
+  if (++receive_counter_ < applied_receive_multiplier_) {
+    return false;
   }
+  // A changed multiplier is taken over at the boundary of the controller cycles, so the counter
+  //  can never pass it
+  receive_counter_ = 0;
+  applied_receive_multiplier_ = std::max(1, static_cast<int>(receive_multiplier_));
+  return true;
 }
 
 
@@ -165,6 +465,9 @@ hardware_interface::return_type KukaFRIHardwareInterface::read(
   const rclcpp::Time &,
   const rclcpp::Duration &)
 {
+  if (tuning_ != nullptr && tuning_->Update()) {
+    command_filter_.CopyConfiguration(tuning_->Current().command_filter.filter);
+  }
   // Read is called in inactive state, check is necessary
   if (!is_active_) {
     active_read_ = false;
@@ -172,35 +475,201 @@ hardware_interface::return_type KukaFRIHardwareInterface::read(
     std::this_thread::sleep_for(std::chrono::milliseconds(1));
     return hardware_interface::return_type::OK;
   }
+  // With the I/O thread, a cycle without a new message neither decodes nor answers one
+  if (io_thread_) {
+    const bool fresh = connection_.ready();
+    kuka_drivers_core::CycleCoordinator::Instance().OnRead(cycle_robot_, fresh);
+    if (!fresh) {
+      active_read_ = false;
+      return hardware_interface::return_type::OK;
+    }
+  }
   active_read_ = true;
 
   if (!client_application_.client_app_read()) {
-    RCLCPP_ERROR(
-      rclcpp::get_logger(
-        "KukaFRIHardwareInterface"), "Failed to read data from controller");
+    rt_log_.Log(kuka_drivers_core::RTLog::Level::ERROR, "Failed to read data from controller");
+    if (flight_recorder_ != nullptr) {
+      flight_recorder_->Current().flags =
+        kuka_drivers_core::FlightRecorder::MISSED | kuka_drivers_core::FlightRecorder::ERROR;
+      flight_recorder_->Commit();
+    }
     return hardware_interface::return_type::ERROR;
   }
+  // The I/O thread notes the arrival, the message may have waited for the cycle since then
+  const auto arrival = io_thread_ ? connection_.lastArrival() : std::chrono::steady_clock::now();
+  if (first_message_pending_.exchange(false)) {
+    rt_log_.Log(
+      kuka_drivers_core::RTLog::Level::INFO,
+      "First monitoring message %.1f ms after the activation",
+      std::chrono::duration<double, std::milli>(arrival - activation_end_).count());
+  }
+  if (flight_recorder_ != nullptr) {
+    auto & record = flight_recorder_->Current();
+    record.counter = client_application_.sequence_counter();
+    record.receive_time_ns = kuka_drivers_core::FlightRecorder::Now();
+    record.flags = kuka_drivers_core::FlightRecorder::RECEIVED;
+    record.mode = static_cast<uint16_t>(robotState().getClientCommandMode());
+    flight_recorder_->SetStates(
+      robotState().getMeasuredJointPosition(), KUKA::FRI::LBRState::NUMBER_OF_JOINTS);
+  }
+  if (state_channel_ != nullptr) {
+    auto & sample = state_channel_->Current();
+    sample.counter = client_application_.sequence_counter();
+    sample.receive_time_ns = kuka_drivers_core::StateChannel::Now();
+    sample.mode = static_cast<uint16_t>(robotState().getClientCommandMode());
+    state_channel_->SetPositions(
+      robotState().getMeasuredJointPosition(), KUKA::FRI::LBRState::NUMBER_OF_JOINTS);
+    state_channel_->SetEfforts(
+      robotState().getMeasuredTorque(), KUKA::FRI::LBRState::NUMBER_OF_JOINTS);
+    state_channel_->SetExternalEfforts(
+      robotState().getExternalTorque(), KUKA::FRI::LBRState::NUMBER_OF_JOINTS);
+    state_channel_->Publish();
+  }
+  if (joint_state_publisher_ != nullptr) {
+    joint_state_publisher_->Update(
+      robotState().getMeasuredJointPosition(), nullptr, robotState().getMeasuredTorque());
+  }
+  if (state_batch_publisher_ != nullptr) {
+    state_batch_publisher_->Update(
+      client_application_.sequence_counter(), 0, robotState().getMeasuredJointPosition(),
+      nullptr, robotState().getMeasuredTorque());
+  }
+  const int64_t receive_time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
 
   // get the position and efforts and share them with exposed state interfaces
-  const double * position = robotState().getMeasuredJointPosition();
-  hw_states_.assign(position, position + KUKA::FRI::LBRState::NUMBER_OF_JOINTS);
-  const double * torque = robotState().getMeasuredTorque();
-  hw_torques_.assign(torque, torque + KUKA::FRI::LBRState::NUMBER_OF_JOINTS);
-  const double * external_torque = robotState().getExternalTorque();
-  hw_torques_ext_.assign(external_torque, external_torque + KUKA::FRI::LBRState::NUMBER_OF_JOINTS);
+  if (!zero_copy_states_) {
+    // The exported interfaces stay where they are, only the common joints are copied
+    const std::size_t state_joints = std::min<std::size_t>(
+      hw_states_.size(), KUKA::FRI::LBRState::NUMBER_OF_JOINTS);
+    std::copy_n(robotState().getMeasuredJointPosition(), state_joints, hw_states_.data());
+    std::copy_n(robotState().getMeasuredTorque(), state_joints, hw_torques_.data());
+    std::copy_n(robotState().getExternalTorque(), state_joints, hw_torques_ext_.data());
+  }
 
-  robot_state_.tracking_performance_ = robotState().getTrackingPerformance();
-  robot_state_.session_state_ = robotState().getSessionState();
-  robot_state_.connection_quality_ = robotState().getConnectionQuality();
-  robot_state_.command_mode_ = robotState().getClientCommandMode();
-  robot_state_.safety_state_ = robotState().getSafetyState();
-  robot_state_.control_mode_ = robotState().getControlMode();
-  robot_state_.operation_mode_ = robotState().getOperationMode();
-  robot_state_.drive_state_ = robotState().getDriveState();
-  robot_state_.overlay_type_ = robotState().getOverlayType();
+  const std::size_t joints = std::min<std::size_t>(
+    hw_commanded_positions_.size(), KUKA::FRI::LBRState::NUMBER_OF_JOINTS);
+  if (!selective_decode_) {
+    std::copy_n(robotState().getCommandedJointPosition(), joints, hw_commanded_positions_.data());
+    std::copy_n(robotState().getCommandedTorque(), joints, hw_commanded_torques_.data());
+  }
+  // The interpolator position is only sent in commanding states, otherwise the SDK throws
+  if (!selective_decode_ &&
+    (robotState().getSessionState() == KUKA::FRI::ESessionState::COMMANDING_WAIT ||
+    robotState().getSessionState() == KUKA::FRI::ESessionState::COMMANDING_ACTIVE))
+  {
+    std::copy_n(robotState().getIpoJointPosition(), joints, hw_ipo_positions_.data());
+  }
 
-  for (auto & output : gpio_outputs_) {
-    output.getValue();
+  // The latency is only meaningful if the clocks of the controller and the host are synchronized,
+  //  integer arithmetic keeps the nanosecond resolution of the timestamps
+  const unsigned int timestamp_sec = robotState().getTimestampSec();
+  const unsigned int timestamp_nanosec = robotState().getTimestampNanoSec();
+  robot_state_.timestamp_sec_ = timestamp_sec;
+  robot_state_.timestamp_nanosec_ = timestamp_nanosec;
+  robot_state_.receive_latency_ = static_cast<double>(
+    receive_time_ns - (static_cast<int64_t>(timestamp_sec) * 1000000000 + timestamp_nanosec)) *
+    1e-9;
+  clock_sync_.Update(
+    static_cast<int64_t>(timestamp_sec) * 1000000000 + timestamp_nanosec, arrival);
+  robot_state_.state_stamp_ = clock_sync_.Stamp();
+  arrival_ns_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    arrival.time_since_epoch()).count();
+  robot_ns_ = static_cast<int64_t>(timestamp_sec) * 1000000000 + timestamp_nanosec;
+  // The message reflecting a command closes its loop, a late one was answered in a later cycle
+  LoopLatency::Sample loop;
+  if (loop_latency_.OnMonitoring(
+      client_application_.sequence_counter(), client_application_.reflected_sequence_counter(),
+      robot_ns_, loop))
+  {
+    robot_state_.round_trip_latency_ = static_cast<double>(loop.round_trip_ns) * 1e-9;
+    robot_state_.host_latency_ = static_cast<double>(loop.host_ns) * 1e-9;
+    if (loop.late) {
+      robot_state_.late_answers_++;
+    }
+    if (metrics_group_ != nullptr) {
+      if (loop.late) {
+        metrics_.late_answers->Add();
+      }
+      metrics_.round_trip_latency->Record(
+        static_cast<uint64_t>(std::max<int64_t>(loop.round_trip_ns, 0)));
+      metrics_.host_latency->Record(static_cast<uint64_t>(std::max<int64_t>(loop.host_ns, 0)));
+    }
+  }
+  robot_state_.one_way_latency_ = clock_sync_.Latency();
+  robot_state_.clock_drift_ = clock_sync_.Drift();
+  if (cycle_robot_ >= 0 && clock_sync_.Valid()) {
+    kuka_drivers_core::CycleCoordinator::Instance().OnMessage(
+      cycle_robot_, clock_sync_.SendTime(), arrival);
+  }
+
+  if (state_recorder_.enabled()) {
+    StateRecorder::Sample sample;
+    sample.receive_time_ns = receive_time_ns;
+    sample.timestamp_sec = timestamp_sec;
+    sample.timestamp_nanosec = timestamp_nanosec;
+    sample.session_state = static_cast<int32_t>(robotState().getSessionState());
+    sample.connection_quality = static_cast<int32_t>(robotState().getConnectionQuality());
+    std::copy_n(robotState().getMeasuredJointPosition(), StateRecorder::kJoints, sample.position);
+    std::copy_n(robotState().getMeasuredTorque(), StateRecorder::kJoints, sample.torque);
+    std::copy_n(
+      robotState().getExternalTorque(), StateRecorder::kJoints, sample.external_torque);
+    state_recorder_.record(sample);
+  }
+
+  robot_state_.tracking_performance_ = robotState().getTrackingPerformance();
+  if (link_diagnostics_ != nullptr) {
+    // The tracking performance is only valid while commanding, the robot holds the position
+    //  perfectly otherwise
+    const double link_metrics[] = {
+      static_cast<double>(robotState().getConnectionQuality()),
+      robotState().getSessionState() == KUKA::FRI::ESessionState::COMMANDING_ACTIVE ?
+      robot_state_.tracking_performance_ : 1.0};
+    link_diagnostics_->Update(link_metrics);
+  }
+  if (metrics_group_ != nullptr) {
+    metrics_.connection_quality->Set(static_cast<double>(robotState().getConnectionQuality()));
+    metrics_.session_state->Set(static_cast<double>(robotState().getSessionState()));
+  }
+  // A new FRI session might come with other IOs
+  if (robot_state_.session_state_ == KUKA::FRI::ESessionState::IDLE &&
+    robotState().getSessionState() != KUKA::FRI::ESessionState::IDLE)
+  {
+    resetGPIOIndices();
+  }
+  // The command mode can be switched while commanding, the overlay of the robot application is
+  //  restarted with the new mode
+  if (!monitoring_only_ &&
+    robot_state_.command_mode_ != KUKA::FRI::EClientCommandMode::NO_COMMAND_MODE &&
+    robot_state_.command_mode_ != static_cast<double>(robotState().getClientCommandMode()))
+  {
+    handOverCommands();
+  }
+  // The enum values rarely change, the interfaces are only written on change
+  using StateEvent = kuka_driver_interfaces::msg::FRIStateEvent;
+  updateState(
+    StateEvent::SESSION_STATE, robot_state_.session_state_, robotState().getSessionState());
+  updateState(
+    StateEvent::CONNECTION_QUALITY, robot_state_.connection_quality_,
+    robotState().getConnectionQuality());
+  updateState(
+    StateEvent::COMMAND_MODE, robot_state_.command_mode_, robotState().getClientCommandMode());
+  updateState(
+    StateEvent::SAFETY_STATE, robot_state_.safety_state_, robotState().getSafetyState());
+  updateState(
+    StateEvent::CONTROL_MODE, robot_state_.control_mode_, robotState().getControlMode());
+  updateState(
+    StateEvent::OPERATION_MODE, robot_state_.operation_mode_, robotState().getOperationMode());
+  updateState(
+    StateEvent::DRIVE_STATE, robot_state_.drive_state_, robotState().getDriveState());
+  updateState(
+    StateEvent::OVERLAY_TYPE, robot_state_.overlay_type_, robotState().getOverlayType());
+
+  if (!gpio_outputs_.empty()) {
+    kuka_drivers_core::tracing::ScopedPhase trace(kuka_drivers_core::tracing::Phase::GPIO, this);
+    for (auto & output : gpio_outputs_) {
+      output.getValue();
+    }
   }
 
   return hardware_interface::return_type::OK;
@@ -211,6 +680,8 @@ hardware_interface::return_type KukaFRIHardwareInterface::write(
   const rclcpp::Duration &)
 {
   // Client app update and read must be called if read has been called in current cycle
+  // The controller expects an answer to every monitoring message, also in monitoring only mode,
+  //  in the monitoring states it only contains the header
   if (!active_read_) {
     RCLCPP_DEBUG(rclcpp::get_logger("KukaFRIHardwareInterface"), "Hardware interface not active");
     return hardware_interface::return_type::OK;
@@ -220,10 +691,36 @@ hardware_interface::return_type KukaFRIHardwareInterface::write(
   //  this updates the command to be sent based on the output of the controller update
   client_application_.client_app_update();
 
-  if (!client_application_.client_app_write() && is_active_) {
-    RCLCPP_ERROR(
-      rclcpp::get_logger(
-        "KukaFRIHardwareInterface"), "Could not send command to controller");
+  const bool sent = client_application_.client_app_write();
+  uint32_t command_counter;
+  if (client_application_.sent_sequence_counter(command_counter)) {
+    loop_latency_.OnSend(
+      command_counter, std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count(),
+      client_application_.sequence_counter(), arrival_ns_, robot_ns_);
+  }
+  if (flight_recorder_ != nullptr) {
+    auto & record = flight_recorder_->Current();
+    record.send_time_ns = kuka_drivers_core::FlightRecorder::Now();
+    record.flags |= sent ? kuka_drivers_core::FlightRecorder::SENT :
+      kuka_drivers_core::FlightRecorder::ERROR;
+    if (!monitoring_only_) {
+      const JointValues & commands = interpolatedCommands();
+      flight_recorder_->SetCommands(commands.data(), commands.size());
+    }
+    flight_recorder_->Commit();
+  }
+  // Published with the state of the next cycle
+  if (state_channel_ != nullptr && !monitoring_only_) {
+    const JointValues & commands = interpolatedCommands();
+    state_channel_->SetCommands(commands.data(), commands.size());
+  }
+  if (state_batch_publisher_ != nullptr && sent && !monitoring_only_) {
+    const JointValues & commands = interpolatedCommands();
+    state_batch_publisher_->SetCommands(commands.data(), commands.size());
+  }
+  if (!sent && is_active_) {
+    rt_log_.Log(kuka_drivers_core::RTLog::Level::ERROR, "Could not send command to controller");
     return hardware_interface::return_type::ERROR;
   }
 
@@ -233,23 +730,90 @@ hardware_interface::return_type KukaFRIHardwareInterface::write(
 void KukaFRIHardwareInterface::updateCommand(const rclcpp::Time &)
 {
   if (!is_active_) {
-    RCLCPP_ERROR(
-      rclcpp::get_logger(
-        "KukaFRIHardwareInterface"), "Hardware inactive, exiting updateCommand");
+    rt_log_.Log(
+      kuka_drivers_core::RTLog::Level::ERROR, "Hardware inactive, exiting updateCommand");
     return;
   }
+  const bool interpolate = command_interpolator_.Enabled();
   if (robot_state_.command_mode_ == KUKA::FRI::EClientCommandMode::TORQUE) {
-    const double * joint_torques_ = hw_effort_command_.data();
+    const double * joint_torques_ = interpolate ?
+      command_interpolator_.Next(robotState().getSampleTime()) : hw_effort_command_.data();
     robotCommand().setJointPosition(robotState().getIpoJointPosition());
     robotCommand().setTorque(joint_torques_);
+  } else if (robot_state_.command_mode_ == KUKA::FRI::EClientCommandMode::WRENCH) {
+    // The wrench is applied on top of the current interpolated position
+    robotCommand().setJointPosition(robotState().getIpoJointPosition());
+    robotCommand().setWrench(hw_wrench_commands_.data());
   } else if (robot_state_.command_mode_ == KUKA::FRI::EClientCommandMode::POSITION) {
-    const double * joint_positions_ = hw_commands_.data();
+    const double * joint_positions_ = interpolate ?
+      command_interpolator_.Next(robotState().getSampleTime()) : hw_commands_.data();
+    // The commands of the controllers are kept, the filters work on a copy
+    if (command_filter_.Enabled()) {
+      std::copy_n(joint_positions_, filtered_commands_.size(), filtered_commands_.begin());
+      if (command_filter_.Apply(
+          filtered_commands_.data(), filtered_commands_.size(), robotState().getSampleTime()))
+      {
+        joint_positions_ = filtered_commands_.data();
+      } else {
+        // The unfiltered commands are not sent, the robot holds the interpolated position
+        rt_log_.Log(kuka_drivers_core::RTLog::Level::ERROR, "Command filtering failed");
+        joint_positions_ = robotState().getIpoJointPosition();
+      }
+    }
     robotCommand().setJointPosition(joint_positions_);
   } else {
-    RCLCPP_ERROR(rclcpp::get_logger("KukaFRIHardwareInterface"), "Unsupported command mode");
+    rt_log_.Log(kuka_drivers_core::RTLog::Level::ERROR, "Unsupported command mode");
+  }
+  // Only the changed outputs are sent, all of them until commanding is active, as the robot only
+  //  applies the writes of the active overlay
+  bool refresh = robotState().getSessionState() != KUKA::FRI::ESessionState::COMMANDING_ACTIVE;
+  if (refresh || ++gpio_refresh_counter_ >= GPIO_REFRESH_COMMANDS) {
+    gpio_refresh_counter_ = 0;
+    refresh = true;
+  }
+  if (!gpio_inputs_.empty()) {
+    kuka_drivers_core::tracing::ScopedPhase trace(kuka_drivers_core::tracing::Phase::GPIO, this);
+    for (std::size_t i = 0; i < gpio_inputs_.size(); ++i) {
+      gpio_inputs_[i].setValue(static_cast<int>(i), refresh);
+    }
+  }
+}
+
+void KukaFRIHardwareInterface::handOverCommands()
+{
+  // The position of the interpolator is where the robot is held until the controller of the new
+  //  mode is active, the measured one lags behind it in the impedance control modes
+  const auto session_state = robotState().getSessionState();
+  if (session_state == KUKA::FRI::ESessionState::COMMANDING_WAIT ||
+    session_state == KUKA::FRI::ESessionState::COMMANDING_ACTIVE)
+  {
+    std::copy(hw_ipo_positions_.begin(), hw_ipo_positions_.end(), hw_commands_.begin());
+  } else {
+    std::copy(hw_states_.begin(), hw_states_.end(), hw_commands_.begin());
+  }
+  // No additional torque or wrench until they are commanded in the new mode
+  std::fill(hw_effort_command_.begin(), hw_effort_command_.end(), 0.0);
+  hw_wrench_commands_.fill(0);
+  command_filter_.Reset();
+  const int old_mode = static_cast<int>(robot_state_.command_mode_);
+  updateState(
+    kuka_driver_interfaces::msg::FRIStateEvent::COMMAND_MODE, robot_state_.command_mode_,
+    robotState().getClientCommandMode());
+  if (command_interpolator_.Enabled()) {
+    command_interpolator_.Reset(interpolatedCommands().data());
+  }
+  rt_log_.Log(
+    kuka_drivers_core::RTLog::Level::INFO, "Client command mode changed from %d to %d", old_mode,
+    static_cast<int>(robot_state_.command_mode_));
+}
+
+void KukaFRIHardwareInterface::resetGPIOIndices()
+{
+  for (auto & output : gpio_outputs_) {
+    output.resetIndex();
   }
   for (auto & input : gpio_inputs_) {
-    input.setValue();
+    input.resetIndex();
   }
 }
 
@@ -284,6 +848,33 @@ std::vector<hardware_interface::StateInterface> KukaFRIHardwareInterface::export
   state_interfaces.emplace_back(
     hardware_interface::FRI_STATE_PREFIX, hardware_interface::TRACKING_PERFORMANCE,
     &robot_state_.tracking_performance_);
+  state_interfaces.emplace_back(
+    hardware_interface::FRI_STATE_PREFIX, hardware_interface::TIMESTAMP_SEC,
+    &robot_state_.timestamp_sec_);
+  state_interfaces.emplace_back(
+    hardware_interface::FRI_STATE_PREFIX, hardware_interface::TIMESTAMP_NANOSEC,
+    &robot_state_.timestamp_nanosec_);
+  state_interfaces.emplace_back(
+    hardware_interface::FRI_STATE_PREFIX, hardware_interface::RECEIVE_LATENCY,
+    &robot_state_.receive_latency_);
+  state_interfaces.emplace_back(
+    hardware_interface::FRI_STATE_PREFIX, hardware_interface::STATE_STAMP,
+    &robot_state_.state_stamp_);
+  state_interfaces.emplace_back(
+    hardware_interface::FRI_STATE_PREFIX, hardware_interface::ONE_WAY_LATENCY,
+    &robot_state_.one_way_latency_);
+  state_interfaces.emplace_back(
+    hardware_interface::FRI_STATE_PREFIX, hardware_interface::CLOCK_DRIFT,
+    &robot_state_.clock_drift_);
+  state_interfaces.emplace_back(
+    hardware_interface::FRI_STATE_PREFIX, hardware_interface::ROUND_TRIP_LATENCY,
+    &robot_state_.round_trip_latency_);
+  state_interfaces.emplace_back(
+    hardware_interface::FRI_STATE_PREFIX, hardware_interface::HOST_LATENCY,
+    &robot_state_.host_latency_);
+  state_interfaces.emplace_back(
+    hardware_interface::FRI_STATE_PREFIX, hardware_interface::LATE_ANSWERS,
+    &robot_state_.late_answers_);
 
   // Register I/O outputs (read access)
   for (auto & output : gpio_outputs_) {
@@ -292,19 +883,14 @@ std::vector<hardware_interface::StateInterface> KukaFRIHardwareInterface::export
       &output.getData());
   }
 
-  for (size_t i = 0; i < info_.joints.size(); i++) {
-    state_interfaces.emplace_back(
-      info_.joints[i].name, hardware_interface::HW_IF_POSITION,
-      &hw_states_[i]);
-
-    state_interfaces.emplace_back(
-      info_.joints[i].name, hardware_interface::HW_IF_EFFORT,
-      &hw_torques_[i]);
-
-    state_interfaces.emplace_back(
-      info_.joints[i].name, hardware_interface::HW_IF_EXTERNAL_TORQUE,
-      &hw_torques_ext_[i]);
-  }
+  // The commanded and interpolator values are not part of the joint description, they are used
+  //  by performance monitoring controllers
+  joint_storage_.ExportStateInterfaces(
+    state_interfaces, [this](std::size_t, const std::string & interface) {
+      return !selective_decode_ || interface == hardware_interface::HW_IF_POSITION ||
+      interface == hardware_interface::HW_IF_EFFORT ||
+      interface == hardware_interface::HW_IF_EXTERNAL_TORQUE;
+    });
   return state_interfaces;
 }
 
@@ -316,6 +902,10 @@ export_command_interfaces()
   command_interfaces.emplace_back(
     hardware_interface::CONFIG_PREFIX,
     hardware_interface::RECEIVE_MULTIPLIER, &receive_multiplier_);
+  // Without command interfaces no commanding controller can be activated
+  if (monitoring_only_) {
+    return command_interfaces;
+  }
 
   // Register I/O inputs (write access)
   for (auto & input : gpio_inputs_) {
@@ -324,13 +914,15 @@ export_command_interfaces()
       &input.getData());
   }
 
-  for (size_t i = 0; i < info_.joints.size(); i++) {
-    command_interfaces.emplace_back(
-      info_.joints[i].name, hardware_interface::HW_IF_POSITION,
-      &hw_commands_[i]);
+  joint_storage_.ExportCommandInterfaces(command_interfaces);
+
+  static constexpr const char * kWrenchInterfaces[] = {
+    hardware_interface::WRENCH_FORCE_X, hardware_interface::WRENCH_FORCE_Y,
+    hardware_interface::WRENCH_FORCE_Z, hardware_interface::WRENCH_TORQUE_A,
+    hardware_interface::WRENCH_TORQUE_B, hardware_interface::WRENCH_TORQUE_C};
+  for (size_t i = 0; i < hw_wrench_commands_.size(); i++) {
     command_interfaces.emplace_back(
-      info_.joints[i].name, hardware_interface::HW_IF_EFFORT,
-      &hw_effort_command_[i]);
+      hardware_interface::WRENCH_COMMAND_PREFIX, kWrenchInterfaces[i], &hw_wrench_commands_[i]);
   }
   return command_interfaces;
 }
@@ -0,0 +1,179 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "kuka_drivers_core/hardware_parameters.hpp"
+#include "kuka_sunrise_fri_driver/loop_latency.hpp"
+
+namespace kuka_sunrise_fri_driver
+{
+void LoopLatency::OnSend(
+  uint32_t command_counter, int64_t send_ns, uint32_t answered_counter,
+  int64_t answered_arrival_ns, int64_t answered_robot_ns)
+{
+  Entry & entry = ring_[command_counter % RING_SIZE];
+  entry.command_counter = command_counter;
+  entry.answered_counter = answered_counter;
+  entry.send_ns = send_ns;
+  entry.answered_arrival_ns = answered_arrival_ns;
+  entry.answered_robot_ns = answered_robot_ns;
+  entry.pending = true;
+}
+
+bool LoopLatency::OnMonitoring(
+  uint32_t counter, uint32_t reflected_counter, int64_t robot_ns, Sample & sample)
+{
+  // Further messages reflect the same command until the next one arrives, only the first counts
+  Entry & entry = ring_[reflected_counter % RING_SIZE];
+  if (!entry.pending || entry.command_counter != reflected_counter) {
+    return false;
+  }
+  entry.pending = false;
+
+  sample.round_trip_ns = robot_ns - entry.answered_robot_ns;
+  sample.host_ns = entry.send_ns - entry.answered_arrival_ns;
+  // The counters wrap around, the difference is still right in unsigned arithmetic
+  sample.late = counter - entry.answered_counter > 1;
+  round_trip_.Record(sample.round_trip_ns > 0 ? static_cast<uint64_t>(sample.round_trip_ns) : 0);
+  host_.Record(sample.host_ns > 0 ? static_cast<uint64_t>(sample.host_ns) : 0);
+  if (sample.late) {
+    late_answers_.fetch_add(1, std::memory_order_relaxed);
+  }
+  return true;
+}
+
+void LoopLatency::Reset()
+{
+  for (auto & entry : ring_) {
+    entry.pending = false;
+  }
+}
+
+LoopLatencyDiagnostics::LoopLatencyDiagnostics(
+  const std::string & hardware_name, const LoopLatency & loop_latency,
+  std::chrono::microseconds warning_threshold, std::chrono::milliseconds publish_period)
+: hardware_name_(hardware_name), loop_latency_(loop_latency),
+  warning_threshold_(warning_threshold), publish_period_(publish_period)
+{
+  node_ = rclcpp::Node::make_shared(hardware_name_ + "_loop_latency_diagnostics");
+  publisher_ = node_->create_publisher<diagnostic_msgs::msg::DiagnosticArray>(
+    "/diagnostics", rclcpp::SystemDefaultsQoS());
+  publish_thread_ = std::thread(&LoopLatencyDiagnostics::publishLoop, this);
+}
+
+LoopLatencyDiagnostics::~LoopLatencyDiagnostics()
+{
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    terminate_ = true;
+  }
+  cv_.notify_all();
+  if (publish_thread_.joinable()) {
+    publish_thread_.join();
+  }
+}
+
+void LoopLatencyDiagnostics::publishLoop()
+{
+  auto to_us = [](uint64_t ns) {return std::to_string(ns / 1000);};
+  auto previous_round_trip = loop_latency_.RoundTrip().GetSnapshot();
+  auto previous_host = loop_latency_.Host().GetSnapshot();
+  uint64_t previous_late = loop_latency_.LateAnswers();
+
+  std::unique_lock<std::mutex> lk(mutex_);
+  while (!cv_.wait_for(lk, publish_period_, [this] {return terminate_;})) {
+    auto current_round_trip = loop_latency_.RoundTrip().GetSnapshot();
+    auto current_host = loop_latency_.Host().GetSnapshot();
+    const uint64_t current_late = loop_latency_.LateAnswers();
+    auto round_trip = current_round_trip - previous_round_trip;
+    auto host = current_host - previous_host;
+    const uint64_t late = current_late - previous_late;
+    previous_round_trip = current_round_trip;
+    previous_host = current_host;
+    previous_late = current_late;
+
+    diagnostic_msgs::msg::DiagnosticStatus status;
+    status.name = hardware_name_ + ": FRI loop latency";
+    status.hardware_id = hardware_name_;
+
+    const uint64_t host_p99 = host.Percentile(99);
+    const bool host_slow = host_p99 > static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(warning_threshold_).count());
+    if (round_trip.count == 0) {
+      status.level = diagnostic_msgs::msg::DiagnosticStatus::STALE;
+      status.message = "No answered commands in the last period";
+    } else if (late > 0 && !host_slow) {
+      status.level = diagnostic_msgs::msg::DiagnosticStatus::WARN;
+      status.message = "Late commands, delayed by the network";
+    } else if (host_slow) {
+      status.level = diagnostic_msgs::msg::DiagnosticStatus::WARN;
+      status.message = "99th percentile of host latency above threshold";
+    } else {
+      status.level = diagnostic_msgs::msg::DiagnosticStatus::OK;
+      status.message = "OK";
+    }
+
+    const std::vector<std::pair<std::string, std::string>> values = {
+      {"samples", std::to_string(round_trip.count)},
+      {"late commands", std::to_string(late)},
+      {"round trip p50 [us]", to_us(round_trip.Percentile(50))},
+      {"round trip p99 [us]", to_us(round_trip.Percentile(99))},
+      {"round trip max [us]", to_us(round_trip.interval_max_ns)},
+      {"round trip max since start [us]", to_us(round_trip.max_ns)},
+      {"host p50 [us]", to_us(host.Percentile(50))},
+      {"host p90 [us]", to_us(host.Percentile(90))},
+      {"host p99 [us]", to_us(host_p99)},
+      {"host p99.9 [us]", to_us(host.Percentile(99.9))},
+      {"host max [us]", to_us(host.interval_max_ns)},
+      {"host max since start [us]", to_us(host.max_ns)},
+    };
+    for (const auto & value : values) {
+      diagnostic_msgs::msg::KeyValue key_value;
+      key_value.key = value.first;
+      key_value.value = value.second;
+      status.values.push_back(key_value);
+    }
+
+    diagnostic_msgs::msg::DiagnosticArray msg;
+    msg.header.stamp = node_->now();
+    msg.status.push_back(status);
+    publisher_->publish(msg);
+  }
+}
+
+bool ConfigureLoopLatencyDiagnostics(
+  const std::unordered_map<std::string, std::string> & parameters,
+  const std::string & hardware_name, const LoopLatency & loop_latency,
+  std::unique_ptr<LoopLatencyDiagnostics> & diagnostics, std::string & error)
+{
+  kuka_drivers_core::HardwareParameters checked(parameters);
+  bool enabled = false;
+  std::chrono::microseconds threshold(500);
+  checked.GetFlag("loop_latency_diagnostics", enabled);
+  checked.Get("loop_latency_warning_threshold_us", threshold);
+  if (!checked.Ok()) {
+    error = checked.Error();
+    return false;
+  }
+  if (enabled) {
+    diagnostics = std::make_unique<LoopLatencyDiagnostics>(hardware_name, loop_latency, threshold);
+  }
+  return true;
+}
+}  // namespace kuka_sunrise_fri_driver
@@ -0,0 +1,291 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <poll.h>
+#include <pthread.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "rclcpp/rclcpp.hpp"
+
+#include "kuka_sunrise_fri_driver/receive_group.hpp"
+
+namespace kuka_sunrise_fri_driver
+{
+std::shared_ptr<ReceiveGroup> ReceiveGroup::get(const std::string & name)
+{
+  static std::mutex registry_mutex;
+  static std::map<std::string, std::weak_ptr<ReceiveGroup>> registry;
+
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  auto group = registry[name].lock();
+  if (!group) {
+    group = std::make_shared<ReceiveGroup>();
+    registry[name] = group;
+  }
+  return group;
+}
+
+ReceiveGroup::~ReceiveGroup()
+{
+  running_ = false;
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+int ReceiveGroup::join(KUKA::FRI::UdpConnection & connection)
+{
+  std::lock_guard<std::mutex> membership_lock(membership_mutex_);
+  int member = -1;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (std::size_t i = 0; i < kMaxMembers; ++i) {
+      if (members_[i].connection == nullptr) {
+        members_[i].connection = &connection;
+        members_[i].pending_size = 0;
+        members_[i].ready_size = 0;
+        member = static_cast<int>(i);
+        break;
+      }
+    }
+  }
+  if (member >= 0 && !thread_.joinable()) {
+    running_ = true;
+    thread_ = std::thread(&ReceiveGroup::run, this);
+  }
+  return member;
+}
+
+void ReceiveGroup::leave(int member)
+{
+  std::lock_guard<std::mutex> membership_lock(membership_mutex_);
+  bool empty = true;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    members_[member].connection = nullptr;
+    for (const Member & other : members_) {
+      empty = empty && other.connection == nullptr;
+    }
+  }
+  // Wakes up the control loop of the member, if it is waiting
+  ready_cv_.notify_all();
+  if (empty && thread_.joinable()) {
+    running_ = false;
+    thread_.join();
+  }
+}
+
+int ReceiveGroup::receive(int member, char * buffer, int max_size)
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  Member & self = members_[member];
+  ready_cv_.wait(lock, [&self]() {return self.ready_size > 0 || self.connection == nullptr;});
+  if (self.connection == nullptr) {
+    return -1;
+  }
+  const int size = std::min(self.ready_size, max_size);
+  std::memcpy(buffer, self.ready.data(), size);
+  self.ready_size = 0;
+  return size;
+}
+
+void ReceiveGroup::run()
+{
+  // The messages are on the path of the control loop, the thread needs the same priority
+  struct sched_param param;
+  param.sched_priority = 95;
+  if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0) {
+    RCLCPP_WARN(
+      rclcpp::get_logger("KukaFRIHardwareInterface"),
+      "Could not set real-time priority of the receive thread");
+  }
+
+  struct pollfd descriptors[kMaxMembers];
+  std::size_t indices[kMaxMembers];
+  bool readable[kMaxMembers];
+  while (running_) {
+    std::size_t count = 0;
+    bool pending = false;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (std::size_t i = 0; i < kMaxMembers; ++i) {
+        if (members_[i].connection != nullptr) {
+          descriptors[count].fd = members_[i].connection->getSocket();
+          descriptors[count].events = POLLIN;
+          descriptors[count].revents = 0;
+          indices[count++] = i;
+          pending = pending || members_[i].pending_size > 0;
+        }
+      }
+    }
+
+    // Members and the stop request are checked at least every 10 ms
+    std::chrono::nanoseconds timeout = std::chrono::milliseconds(10);
+    if (pending) {
+      timeout = std::max(
+        std::chrono::nanoseconds(0),
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+          first_pending_ + gather_timeout_.load() - std::chrono::steady_clock::now()));
+    }
+    struct timespec timeout_spec;
+    timeout_spec.tv_sec = static_cast<time_t>(timeout.count() / 1000000000);
+    timeout_spec.tv_nsec = static_cast<long>(timeout.count() % 1000000000);  // NOLINT
+    if (ppoll(descriptors, count, &timeout_spec, nullptr) < 0) {
+      continue;
+    }
+
+    std::fill(readable, readable + kMaxMembers, false);
+    for (std::size_t i = 0; i < count; ++i) {
+      readable[indices[i]] = (descriptors[i].revents & POLLIN) != 0;
+    }
+    receiveMessages(readable);
+    handOver();
+  }
+}
+
+void ReceiveGroup::receiveMessages(const bool * readable)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (std::size_t i = 0; i < kMaxMembers; ++i) {
+    Member & member = members_[i];
+    if (!readable[i] || member.connection == nullptr) {
+      continue;
+    }
+    // A newer message of the same member replaces the previous one
+    const bool first = std::none_of(
+      members_.begin(), members_.end(), [](const Member & other) {
+        return other.connection != nullptr && other.pending_size > 0;
+      });
+    const int size = member.connection->receive(member.pending.data(), kMaxMessageSize);
+    if (size > 0) {
+      member.pending_size = size;
+      if (first) {
+        first_pending_ = std::chrono::steady_clock::now();
+      }
+    }
+  }
+}
+
+void ReceiveGroup::handOver()
+{
+  bool notify = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool any = false;
+    bool all = true;
+    for (const Member & member : members_) {
+      if (member.connection != nullptr) {
+        any = any || member.pending_size > 0;
+        all = all && member.pending_size > 0;
+      }
+    }
+    if (!any ||
+      (!all && std::chrono::steady_clock::now() < first_pending_ + gather_timeout_.load()))
+    {
+      return;
+    }
+    for (Member & member : members_) {
+      if (member.connection != nullptr && member.pending_size > 0) {
+        std::memcpy(member.ready.data(), member.pending.data(), member.pending_size);
+        member.ready_size = member.pending_size;
+        member.pending_size = 0;
+        notify = true;
+      }
+    }
+  }
+  if (notify) {
+    ready_cv_.notify_all();
+  }
+}
+
+GroupedConnection::~GroupedConnection()
+{
+  close();
+}
+
+bool GroupedConnection::open(int port, const char * remote_host)
+{
+  if (!connection_.open(port, remote_host)) {
+    return false;
+  }
+  if (group_) {
+    member_ = group_->join(connection_);
+    if (member_ < 0) {
+      connection_.close();
+      return false;
+    }
+  } else if (io_thread_options_.enabled) {
+    // A message of the previous connection must not be answered
+    datagrams_.Update();
+    io_thread_.Start([this]() {return receiveOnIOThread();}, io_thread_options_);
+  }
+  return true;
+}
+
+void GroupedConnection::close()
+{
+  if (group_ && member_ >= 0) {
+    group_->leave(member_);
+    member_ = -1;
+  }
+  io_thread_.Stop();
+  connection_.close();
+}
+
+int GroupedConnection::receive(char * buffer, int max_size)
+{
+  if (group_ && member_ >= 0) {
+    return group_->receive(member_, buffer, max_size);
+  }
+  if (io_thread_options_.enabled) {
+    if (!datagrams_.Update()) {
+      // Only called if ready(), so either the thread failed or close() was called
+      return -1;
+    }
+    const Datagram & datagram = datagrams_.Front();
+    const int size = std::min(datagram.size, max_size);
+    std::memcpy(buffer, datagram.data.data(), size);
+    return size;
+  }
+  return connection_.receive(buffer, max_size);
+}
+
+bool GroupedConnection::receiveOnIOThread()
+{
+  // The stop request is checked at least every 10 ms
+  struct pollfd descriptor = {connection_.getSocket(), POLLIN, 0};
+  const int ready = poll(&descriptor, 1, 10);
+  if (ready == 0 || (ready < 0 && errno == EINTR)) {
+    return true;
+  }
+  if (ready < 0) {
+    return false;
+  }
+  // A newer message replaces the one not taken over by the control loop yet
+  Datagram & datagram = datagrams_.Back();
+  datagram.size = connection_.receive(datagram.data.data(), ReceiveGroup::kMaxMessageSize);
+  if (datagram.size <= 0) {
+    return false;
+  }
+  datagram.arrival = std::chrono::steady_clock::now();
+  datagrams_.Publish();
+  return true;
+}
+}  // namespace kuka_sunrise_fri_driver
@@ -13,9 +13,11 @@
 // limitations under the License.
 
 #include <memory>
+#include <string>
 
 #include "communication_helpers/service_tools.hpp"
 #include "communication_helpers/ros2_control_tools.hpp"
+#include "fri_client_sdk/friClientIf.h"
 
 #include "kuka_sunrise_fri_driver/robot_manager_node.hpp"
 
@@ -23,8 +25,8 @@ using namespace controller_manager_msgs::srv;  // NOLINT
 
 namespace kuka_sunrise_fri_driver
 {
-RobotManagerNode::RobotManagerNode()
-: kuka_drivers_core::ROS2BaseLCNode("robot_manager")
+RobotManagerNode::RobotManagerNode(const rclcpp::NodeOptions & options)
+: kuka_drivers_core::ROS2BaseLCNode("robot_manager", options)
 {
   // Controllers do not support the cleanup transition (as of now)
   // Therefore controllers are loaded and configured at startup, only activation
@@ -42,7 +44,8 @@ RobotManagerNode::RobotManagerNode()
     {this->handleFRIEndedError();});
   auto qos = rclcpp::QoS(rclcpp::KeepLast(10));
   qos.reliable();
-  cbg_ = this->create_callback_group(rclcpp::CallbackGroupType::MutuallyExclusive);
+  // The responses awaited in the transitions and command mode changes
+  cbg_ = this->createDedicatedCallbackGroup();
   change_hardware_state_client_ =
     this->create_client<SetHardwareComponentState>(
     "controller_manager/set_hardware_component_state", qos.get_rmw_qos_profile(), cbg_);
@@ -51,9 +54,25 @@ RobotManagerNode::RobotManagerNode()
     "controller_manager/switch_controller", qos.get_rmw_qos_profile(), cbg_);
   command_state_changed_publisher_ = this->create_publisher<std_msgs::msg::Bool>(
     "robot_manager/commanding_state_changed", qos);
+  switch_trace_ = std::make_shared<kuka_drivers_core::SwitchTrace>(*this);
+  // The profile of the last bring-up is kept for late subscribers
+  startup_profile_.SetComponent(get_fully_qualified_name());
+  startup_profile_pub_ = rclcpp::create_publisher<diagnostic_msgs::msg::DiagnosticStatus>(
+    *this, "~/startup_profile", rclcpp::QoS(rclcpp::KeepLast(1)).reliable().transient_local());
   set_parameter_client_ = this->create_client<std_srvs::srv::Trigger>(
     "configuration_manager/set_params", ::rmw_qos_profile_default, cbg_);
 
+  // The hardware interface publishes the changes of the session, safety and drive state, the
+  //  end of the FRI session is handled without waiting for the robot application
+  event_cbg_ = this->createDedicatedCallbackGroup();
+  rclcpp::SubscriptionOptions event_options;
+  event_options.callback_group = event_cbg_;
+  state_event_sub_ = this->create_subscription<kuka_driver_interfaces::msg::FRIStateEvent>(
+    "fri_state_events", rclcpp::QoS(rclcpp::KeepLast(64)).reliable(),
+    [this](const kuka_driver_interfaces::msg::FRIStateEvent::SharedPtr event) {
+      this->onStateEvent(event);
+    }, event_options);
+
   auto is_configured_qos = rclcpp::QoS(rclcpp::KeepLast(1));
   is_configured_qos.best_effort();
 
@@ -71,8 +90,27 @@ RobotManagerNode::RobotManagerNode()
 
 rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn
 RobotManagerNode::on_configure(const rclcpp_lifecycle::State &)
+{
+  kuka_drivers_core::tracing::ScopedTransition trace(get_name(), "configure");
+  // A bring-up starts with the configuration, its profile is published if it ends here
+  startup_profile_.Reset();
+  rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn result;
+  {
+    kuka_drivers_core::StartupProfile::Scope phase(startup_profile_, "on_configure");
+    result = configure();
+  }
+  if (result != SUCCESS) {
+    publishStartupProfile(false);
+  }
+  return result;
+}
+
+rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn
+RobotManagerNode::configure()
 {
   // Configure hardware interface
+  kuka_drivers_core::StartupProfile::Scope hardware_phase(
+    startup_profile_, "on_configure/configure_hardware");
   if (!kuka_drivers_core::changeHardwareState(
       change_hardware_state_client_, robot_model_,
       lifecycle_msgs::msg::State::PRIMARY_STATE_INACTIVE))
@@ -80,6 +118,7 @@ RobotManagerNode::on_configure(const rclcpp_lifecycle::State &)
     RCLCPP_ERROR(get_logger(), "Could not configure hardware interface");
     return FAILURE;
   }
+  hardware_phase.Finish();
 
   auto result = SUCCESS;
 
@@ -88,11 +127,20 @@ RobotManagerNode::on_configure(const rclcpp_lifecycle::State &)
   if (!configuration_manager_) {
     configuration_manager_ = std::make_unique<ConfigurationManager>(
       std::dynamic_pointer_cast<kuka_drivers_core::ROS2BaseLCNode>(
-        this->shared_from_this()), fri_connection_);
+        this->shared_from_this()), fri_connection_,
+      [this](const FRIConnection::Command & command, const std::string & controller_name) {
+        return this->switchCommandMode(command, controller_name);
+      },
+      [this](
+        int send_period_ms, int receive_multiplier, const std::function<bool()> & retime_hardware) {
+        return this->restartFRISession(send_period_ms, receive_multiplier, retime_hardware);
+      }, switch_trace_);
   }
   RCLCPP_INFO(get_logger(), "Successfully set 'controller_ip' parameter");
 
   // Start non-RT controllers
+  kuka_drivers_core::StartupProfile::Scope controller_phase(
+    startup_profile_, "on_configure/activate_configuration_controllers");
   if (!kuka_drivers_core::changeControllerState(
       change_controller_state_client_, {"fri_configuration_controller", "fri_state_broadcaster"},
       {}))
@@ -100,8 +148,11 @@ RobotManagerNode::on_configure(const rclcpp_lifecycle::State &)
     RCLCPP_ERROR(get_logger(), "Could not activate configuration controllers");
     result = FAILURE;
   }
+  controller_phase.Finish();
 
   const char * controller_ip = this->get_parameter("controller_ip").as_string().c_str();
+  kuka_drivers_core::StartupProfile::Scope connect_phase(
+    startup_profile_, "on_configure/fri_connect");
   if (!fri_connection_->isConnected()) {
     if (!fri_connection_->connect(controller_ip, 30000)) {
       RCLCPP_ERROR(get_logger(), "could not connect");
@@ -111,9 +162,12 @@ RobotManagerNode::on_configure(const rclcpp_lifecycle::State &)
     RCLCPP_ERROR(get_logger(), "Robot manager is connected in inactive state");
     return ERROR;
   }
+  connect_phase.Finish();
   RCLCPP_INFO(get_logger(), "Successfully connected to FRI");
 
   if (result == SUCCESS) {
+    kuka_drivers_core::StartupProfile::Scope parameter_phase(
+      startup_profile_, "on_configure/set_parameters");
     auto trigger_request =
       std::make_shared<std_srvs::srv::Trigger::Request>();
     auto response = kuka_drivers_core::sendRequest<std_srvs::srv::Trigger::Response>(
@@ -138,6 +192,7 @@ RobotManagerNode::on_configure(const rclcpp_lifecycle::State &)
 rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn
 RobotManagerNode::on_cleanup(const rclcpp_lifecycle::State &)
 {
+  kuka_drivers_core::tracing::ScopedTransition trace(get_name(), "cleanup");
   if (fri_connection_->isConnected() && !fri_connection_->disconnect()) {
     RCLCPP_ERROR(get_logger(), "could not disconnect");
     return ERROR;
@@ -178,21 +233,48 @@ RobotManagerNode::on_cleanup(const rclcpp_lifecycle::State &)
 // TODO(Svastits): check if we have to send unconfigured msg to control node
 rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn
 RobotManagerNode::on_activate(const rclcpp_lifecycle::State &)
+{
+  kuka_drivers_core::tracing::ScopedTransition trace(get_name(), "activate");
+  rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn result;
+  {
+    kuka_drivers_core::StartupProfile::Scope phase(startup_profile_, "on_activate");
+    result = activate();
+  }
+  // A reactivation after on_deactivate() is profiled on its own
+  publishStartupProfile(result == SUCCESS);
+  startup_profile_.Reset();
+  return result;
+}
+
+rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn
+RobotManagerNode::activate()
 {
   if (!fri_connection_->isConnected()) {
     RCLCPP_ERROR(get_logger(), "not connected");
     return ERROR;
   }
+  monitoring_only_ = this->get_parameter("monitoring_only").as_bool();
 
   auto send_period_ms = static_cast<int>(this->get_parameter("send_period_ms").as_int());
   auto receive_multiplier = static_cast<int>(this->get_parameter("receive_multiplier").as_int());
-  if (!fri_connection_->setFRIConfig(30200, send_period_ms, receive_multiplier)) {
+  // With interpolated commands the robot expects a command in every cycle, the receive
+  //  multiplier only sets how often the hardware interface samples the controllers
+  if (this->get_parameter("interpolate_commands").as_bool()) {
+    receive_multiplier = 1;
+  }
+  const auto client_port = static_cast<int>(this->get_parameter("client_port").as_int());
+  kuka_drivers_core::StartupProfile::Scope config_phase(
+    startup_profile_, "on_activate/set_fri_config");
+  if (!fri_connection_->setFRIConfig(client_port, send_period_ms, receive_multiplier)) {
     RCLCPP_ERROR(get_logger(), "could not set FRI config");
     return FAILURE;
   }
+  config_phase.Finish();
   RCLCPP_INFO(get_logger(), "Successfully set FRI config");
 
   // Activate hardware interface
+  kuka_drivers_core::StartupProfile::Scope hardware_phase(
+    startup_profile_, "on_activate/activate_hardware");
   if (!kuka_drivers_core::changeHardwareState(
       change_hardware_state_client_, robot_model_,
       lifecycle_msgs::msg::State::PRIMARY_STATE_ACTIVE))
@@ -201,43 +283,45 @@ RobotManagerNode::on_activate(const rclcpp_lifecycle::State &)
     // 'unset config' does not exist, safe to return
     return FAILURE;
   }
+  hardware_phase.Finish();
 
   // Start FRI (in monitoring mode)
+  kuka_drivers_core::StartupProfile::Scope start_phase(startup_profile_, "on_activate/start_fri");
   if (!fri_connection_->startFRI()) {
     RCLCPP_ERROR(get_logger(), "Could not start FRI");
     this->on_deactivate(get_current_state());
     return FAILURE;
   }
+  start_phase.Finish();
   RCLCPP_INFO(get_logger(), "Started FRI");
 
-  // Activate joint state broadcaster
-  // The other controller must be started later so that it can initialize internal state
-  //   with broadcaster information -> TODO(Svastits): validate whether this is true
-  if (!kuka_drivers_core::changeControllerState(
-      change_controller_state_client_, {"joint_state_broadcaster"},
-      {}))
-  {
-    RCLCPP_ERROR(get_logger(), "Could not activate joint state broadcaster");
-    this->on_deactivate(get_current_state());
-    return FAILURE;
+  // The session stays in the monitoring states, the state is available without controllers
+  if (monitoring_only_) {
+    RCLCPP_INFO(get_logger(), "Monitoring only, the robot is not commanded");
+    return SUCCESS;
   }
 
-  auto position_controller_name = this->get_parameter("position_controller_name").as_string();
-  auto torque_controller_name = this->get_parameter("torque_controller_name").as_string();
-  controller_name_ = (this->get_parameter("command_mode").as_string() ==
-    "position") ? position_controller_name : torque_controller_name;
-  // Activate RT commander
+  const auto command_mode = this->get_parameter("command_mode").as_string();
+  controller_name_ = this->get_parameter(command_mode + "_controller_name").as_string();
+  // Activate joint state broadcaster and RT commander with one switch
+  // The commander reads the state interfaces of the hardware on activation, not the
+  //   broadcaster, so they can be activated in the same update cycle
+  kuka_drivers_core::StartupProfile::Scope controller_phase(
+    startup_profile_, "on_activate/activate_controllers");
   if (!kuka_drivers_core::changeControllerState(
-      change_controller_state_client_, {controller_name_},
+      change_controller_state_client_, {"joint_state_broadcaster", controller_name_},
       {}))
   {
-    RCLCPP_ERROR(get_logger(), "Could not activate RT controller");
+    RCLCPP_ERROR(get_logger(), "Could not activate RT controllers");
     this->on_deactivate(get_current_state());
     return FAILURE;
   }
+  controller_phase.Finish();
   command_state_changed_publisher_->on_activate();
 
   // Start commanding mode
+  kuka_drivers_core::StartupProfile::Scope control_phase(
+    startup_profile_, "on_activate/activate_control");
   if (!activateControl()) {
     this->on_deactivate(get_current_state());
     return FAILURE;
@@ -246,15 +330,22 @@ RobotManagerNode::on_activate(const rclcpp_lifecycle::State &)
   return SUCCESS;
 }
 
+void RobotManagerNode::publishStartupProfile(bool successful)
+{
+  startup_profile_.Log(get_logger());
+  startup_profile_pub_->publish(startup_profile_.ToStatus(successful));
+}
+
 rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn
 RobotManagerNode::on_deactivate(const rclcpp_lifecycle::State &)
 {
+  kuka_drivers_core::tracing::ScopedTransition trace(get_name(), "deactivate");
   if (!fri_connection_->isConnected()) {
     RCLCPP_ERROR(get_logger(), "Not connected");
     return ERROR;
   }
 
-  if (!this->deactivateControl()) {
+  if (!monitoring_only_ && !this->deactivateControl()) {
     RCLCPP_ERROR(get_logger(), "Could not deactivate control");
     return ERROR;
   }
@@ -264,23 +355,20 @@ RobotManagerNode::on_deactivate(const rclcpp_lifecycle::State &)
     return ERROR;
   }
 
-  // Deactivate hardware interface
+  // Deactivate hardware interface and stop RT controllers in one round trip
   // If it is inactive, deactivation will also succeed
-  if (!kuka_drivers_core::changeHardwareState(
-      change_hardware_state_client_, robot_model_,
-      lifecycle_msgs::msg::State::PRIMARY_STATE_INACTIVE))
-  {
-    RCLCPP_ERROR(get_logger(), "Could not deactivate hardware interface");
-    return ERROR;
-  }
-
-  // Stop RT controllers
   // With best effort strictness, deactivation succeeds if specific controller is not active
-  if (!kuka_drivers_core::changeControllerState(
+  kuka_drivers_core::ControlTransition transition(get_logger());
+  transition.phase("deactivation").changeHardwareState(
+    change_hardware_state_client_, robot_model_,
+    lifecycle_msgs::msg::State::PRIMARY_STATE_INACTIVE);
+  if (!monitoring_only_) {
+    transition.changeControllerState(
       change_controller_state_client_, {},
-      {controller_name_, "joint_state_broadcaster"}, SwitchController::Request::BEST_EFFORT))
-  {
-    RCLCPP_ERROR(get_logger(), "Could not deactivate controllers");
+      {controller_name_, "joint_state_broadcaster"}, SwitchController::Request::BEST_EFFORT);
+  }
+  if (!transition.execute()) {
+    RCLCPP_ERROR(get_logger(), "Could not deactivate hardware interface and controllers");
     return ERROR;
   }
 
@@ -328,18 +416,129 @@ bool RobotManagerNode::deactivateControl()
   return true;
 }
 
+bool RobotManagerNode::switchCommandMode(
+  const FRIConnection::Command & command, const std::string & controller_name)
+{
+  // The robot application restarts the overlay with the new mode in the running FRI session,
+  //  the hardware interface hands the commands over at the first cycle of the new mode
+  if (!fri_connection_->sendCommandsAndWait({command}).front()) {
+    RCLCPP_ERROR(get_logger(), "Could not switch command mode");
+    return false;
+  }
+  switch_trace_->Mark("command_mode_sent");
+  if (monitoring_only_ || controller_name == controller_name_) {
+    return true;
+  }
+
+  // The controllers are loaded and configured at startup, the controller of the new mode is
+  //  activated with the deactivation of the old one, after the hand-over it starts from the
+  //  current state
+  if (!kuka_drivers_core::changeControllerState(
+      change_controller_state_client_, {controller_name}, {controller_name_}))
+  {
+    // The commands of the new mode would not be updated, the robot is stopped instead
+    RCLCPP_ERROR(
+      get_logger(), "Could not activate controller '%s', deactivating control",
+      controller_name.c_str());
+    this->deactivateControl();
+    return false;
+  }
+  switch_trace_->Mark("switch_controllers");
+  controller_name_ = controller_name;
+  RCLCPP_INFO(
+    get_logger(), "Switched command mode online, active controller: %s", controller_name.c_str());
+  return true;
+}
+
+bool RobotManagerNode::restartFRISession(
+  int send_period_ms, int receive_multiplier, const std::function<bool()> & retime_hardware)
+{
+  // The configuration of FRI is fixed for a session, the robot holds its position while the
+  //  session is restarted, the hardware interface and the controllers stay active
+  restarting_session_ = true;
+  if (!monitoring_only_ && !this->deactivateControl()) {
+    restarting_session_ = false;
+    RCLCPP_ERROR(get_logger(), "Could not deactivate control for the new timing");
+    return false;
+  }
+  const auto client_port = static_cast<int>(this->get_parameter("client_port").as_int());
+  // The hardware interface and the loop are retimed once the new session has started, so they do
+  //  not keep a timing that was not applied to the robot
+  const bool restarted = fri_connection_->endFRI() &&
+    fri_connection_->setFRIConfig(client_port, send_period_ms, receive_multiplier) &&
+    fri_connection_->startFRI();
+  restarting_session_ = false;
+  if (!restarted || !retime_hardware() || (!monitoring_only_ && !this->activateControl())) {
+    RCLCPP_ERROR(get_logger(), "Could not restart FRI with the new timing, deactivating");
+    this->LifecycleNode::deactivate();
+    return false;
+  }
+  RCLCPP_INFO(
+    get_logger(), "Restarted FRI with a send period of %d ms and a receive multiplier of %d",
+    send_period_ms, receive_multiplier);
+  return true;
+}
+
 void RobotManagerNode::handleControlEndedError()
 {
+  if (restarting_session_) {
+    return;
+  }
   RCLCPP_INFO(get_logger(), "Control ended");
   this->LifecycleNode::deactivate();
 }
 
 void RobotManagerNode::handleFRIEndedError()
 {
+  // Both the state events and the robot application report the end of the session
+  if (restarting_session_ ||
+    get_current_state().id() != lifecycle_msgs::msg::State::PRIMARY_STATE_ACTIVE)
+  {
+    return;
+  }
   RCLCPP_INFO(get_logger(), "FRI ended");
   this->LifecycleNode::deactivate();
 }
 
+void RobotManagerNode::onStateEvent(
+  const kuka_driver_interfaces::msg::FRIStateEvent::SharedPtr event)
+{
+  using StateEvent = kuka_driver_interfaces::msg::FRIStateEvent;
+  switch (event->state) {
+    case StateEvent::SESSION_STATE:
+      RCLCPP_INFO(
+        get_logger(), "FRI session state changed from %d to %d", event->old_value,
+        event->new_value);
+      if (event->new_value == KUKA::FRI::ESessionState::IDLE) {
+        handleFRIEndedError();
+      }
+      break;
+    case StateEvent::SAFETY_STATE:
+      if (event->new_value != KUKA::FRI::ESafetyState::NORMAL_OPERATION) {
+        RCLCPP_WARN(get_logger(), "Safety stop of level %d", event->new_value - 1);
+      } else {
+        RCLCPP_INFO(get_logger(), "Safety stop released");
+      }
+      break;
+    case StateEvent::DRIVE_STATE:
+      RCLCPP_INFO(
+        get_logger(), "Drive state changed from %d to %d", event->old_value, event->new_value);
+      break;
+    case StateEvent::COMMAND_MODE:
+      // The first cycle of the hardware interface in the new mode
+      switch_trace_->Mark("command_mode_event");
+      RCLCPP_INFO(
+        get_logger(), "Client command mode changed from %d to %d", event->old_value,
+        event->new_value);
+      break;
+    default:
+      RCLCPP_DEBUG(
+        get_logger(), "FRI state %u changed from %d to %d", event->state, event->old_value,
+        event->new_value);
+      break;
+  }
+}
+
 bool RobotManagerNode::onRobotModelChangeRequest(const std::string & robot_model)
 {
   robot_model_ = robot_model;
@@ -348,15 +547,7 @@ bool RobotManagerNode::onRobotModelChangeRequest(const std::string & robot_model
 
 }  // namespace kuka_sunrise_fri_driver
 
-int main(int argc, char * argv[])
-{
-  setvbuf(stdout, nullptr, _IONBF, BUFSIZ);
-
-  rclcpp::init(argc, argv);
-  rclcpp::executors::MultiThreadedExecutor executor;
-  auto node = std::make_shared<kuka_sunrise_fri_driver::RobotManagerNode>();
-  executor.add_node(node->get_node_base_interface());
-  executor.spin();
-  rclcpp::shutdown();
-  return 0;
-}
+#include "rclcpp_components/register_node_macro.hpp"
+
+// Loadable into the process of the controller_manager, see the composed deployment
+RCLCPP_COMPONENTS_REGISTER_NODE(kuka_sunrise_fri_driver::RobotManagerNode)
@@ -0,0 +1,75 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <pthread.h>
+
+#include <chrono>
+#include <string>
+
+#include "kuka_sunrise_fri_driver/state_event_publisher.hpp"
+
+namespace kuka_sunrise_fri_driver
+{
+StateEventPublisher::StateEventPublisher(const std::string & node_name, const std::string & topic)
+{
+  node_ = rclcpp::Node::make_shared(node_name);
+  // Every event counts, the subscribers must not miss a change
+  publisher_ = node_->create_publisher<kuka_driver_interfaces::msg::FRIStateEvent>(
+    topic, rclcpp::QoS(rclcpp::KeepLast(64)).reliable());
+  publish_thread_ = std::thread(&StateEventPublisher::PublishLoop, this);
+}
+
+StateEventPublisher::~StateEventPublisher()
+{
+  terminate_ = true;
+  if (publish_thread_.joinable()) {
+    publish_thread_.join();
+  }
+}
+
+void StateEventPublisher::Push(uint8_t state, int32_t old_value, int32_t new_value)
+{
+  Event event;
+  event.stamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+  event.state = state;
+  event.old_value = old_value;
+  event.new_value = new_value;
+  if (!queue_.Push(event)) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void StateEventPublisher::PublishLoop()
+{
+  // Threads inherit the real-time scheduling of the control loop, which is not needed here
+  struct sched_param param;
+  param.sched_priority = 0;
+  pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+
+  kuka_driver_interfaces::msg::FRIStateEvent message;
+  Event event;
+  while (!terminate_) {
+    if (!queue_.Pop(event)) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      continue;
+    }
+    message.stamp = rclcpp::Time(event.stamp_ns, RCL_SYSTEM_TIME);
+    message.state = event.state;
+    message.old_value = event.old_value;
+    message.new_value = event.new_value;
+    publisher_->publish(message);
+  }
+}
+}  // namespace kuka_sunrise_fri_driver
@@ -0,0 +1,105 @@
+// Copyright 2023 Áron Svastits
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <pthread.h>
+
+#include <chrono>
+#include <string>
+
+#include "rclcpp/rclcpp.hpp"
+
+#include "kuka_sunrise_fri_driver/state_recorder.hpp"
+
+namespace kuka_sunrise_fri_driver
+{
+StateRecorder::~StateRecorder()
+{
+  stop();
+  if (file_ != nullptr) {
+    std::fclose(file_);
+  }
+}
+
+bool StateRecorder::open(const std::string & path)
+{
+  if (file_ != nullptr) {
+    std::fclose(file_);
+  }
+  file_ = std::fopen(path.c_str(), "w");
+  if (file_ == nullptr) {
+    return false;
+  }
+  std::fprintf(
+    file_, "receive_time_ns,timestamp_sec,timestamp_nanosec,session_state,connection_quality");
+  for (const char * name : {"position", "torque", "external_torque"}) {
+    for (std::size_t i = 1; i <= kJoints; ++i) {
+      std::fprintf(file_, ",%s_%zu", name, i);
+    }
+  }
+  std::fprintf(file_, "\n");
+  return true;
+}
+
+void StateRecorder::start()
+{
+  if (!enabled() || writer_thread_.joinable()) {
+    return;
+  }
+  running_ = true;
+  writer_thread_ = std::thread(
+    [this]() {
+      // Threads inherit the real-time scheduling of the control loop, which is not needed here
+      struct sched_param param;
+      param.sched_priority = 0;
+      pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+      while (running_) {
+        writeSamples();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+      writeSamples();
+      std::fflush(file_);
+    });
+}
+
+void StateRecorder::stop()
+{
+  running_ = false;
+  if (writer_thread_.joinable()) {
+    writer_thread_.join();
+  }
+}
+
+void StateRecorder::writeSamples()
+{
+  Sample sample;
+  while (samples_.Pop(sample)) {
+    std::fprintf(
+      file_, "%lld,%u,%u,%d,%d", static_cast<long long>(sample.receive_time_ns),
+      sample.timestamp_sec, sample.timestamp_nanosec, sample.session_state,
+      sample.connection_quality);
+    for (const double * values : {sample.position, sample.torque, sample.external_torque}) {
+      for (std::size_t i = 0; i < kJoints; ++i) {
+        std::fprintf(file_, ",%.9g", values[i]);
+      }
+    }
+    std::fprintf(file_, "\n");
+  }
+  const std::size_t dropped = dropped_.exchange(0, std::memory_order_relaxed);
+  if (dropped > 0) {
+    RCLCPP_WARN(
+      rclcpp::get_logger("KukaFRIHardwareInterface"),
+      "%zu state samples were dropped, as the recorder could not keep up", dropped);
+  }
+}
+}  // namespace kuka_sunrise_fri_driver